@@ -10,8 +10,8 @@
 * @author Richard Collins <richard.collins@bristol.ac.uk>
 */
 #include "Drift.h"
+#include <algorithm>
 #include <future>
-#include "Algorithms/Alignment/Filter.h"
 #include "Algorithms/Logging/Logger.h"
 #include "Algorithms/Util/Maths.h"
 
@@ -70,13 +70,51 @@ namespace cqp
 
         }
 
+        void Drift::Histogram(const DetectionView& detections,
+                              uint_fast16_t numBins,
+                              PicoSeconds windowWidth,
+                              std::vector<uint64_t>& counts)
+        {
+            counts.resize(numBins, 0);
+            const auto binWidth = (windowWidth / numBins).count();
+            const auto window = windowWidth.count();
+            const auto times = detections.times;
+            // for each detection
+            //   count the bin ids
+            for(size_t index = 0; index < detections.size(); index++)
+            {
+                const uint_fast16_t bin = (DivNearest(times[index] % window, binWidth)) % numBins;
+                counts[bin]++;
+            }
+
+        }
+
+        void Drift::Histogram(const DetectionView& detections,
+                              uint_fast16_t numBins,
+                              PicoSeconds windowWidth,
+                              ChannelHistograms& counts)
+        {
+            for(auto& hist : counts)
+            {
+                hist.resize(numBins, 0);
+            }
+            const auto binWidth = (windowWidth / numBins).count();
+            const auto window = windowWidth.count();
+            const auto times = detections.times;
+            const auto values = detections.values;
+            // for each detection
+            //   count the bin ids
+            for(size_t index = 0; index < detections.size(); index++)
+            {
+                const uint_fast16_t bin = DivNearest(times[index] % window, binWidth);
+                counts[values[index]][bin]++;
+            }
+
+        }
+
         double Drift::FindPeak(DetectionReportList::const_iterator sampleStart,
                                DetectionReportList::const_iterator sampleEnd) const
         {
-            using namespace std;
-            using namespace std::chrono;
-
-            const int_fast16_t binsCentre = driftBins / 2;
             std::vector<uint64_t> histogram;
             /*LOGDEBUG("Look from " + to_string(sampleStart->time.count()) + " to " +
                      to_string(sampleEnd->time.count()) + " in " +
@@ -85,6 +123,22 @@ namespace cqp
 
             // create a histogram of the sample
             Histogram(sampleStart, sampleEnd, driftBins, slotWidth, histogram);
+            return PeakCentre(histogram);
+        } // FindPeak
+
+        double Drift::FindPeak(const DetectionView& sample) const
+        {
+            std::vector<uint64_t> histogram;
+            // create a histogram of the sample
+            Histogram(sample, driftBins, slotWidth, histogram);
+            return PeakCentre(histogram);
+        } // FindPeak
+
+        double Drift::PeakCentre(const std::vector<uint64_t>& histogram) const
+        {
+            using namespace std;
+
+            const int_fast16_t binsCentre = driftBins / 2;
 
             // get the extents of the graphs to find the centre of the transmission.
             const auto maxIt = std::max_element(histogram.cbegin(), histogram.cend());
@@ -116,24 +170,34 @@ namespace cqp
 
             //LOGDEBUG("Peak: " + to_string(result.count()));
             return average;
-        } // FindPeak
+        } // PeakCentre
 
         ChannelOffsets Drift::ChannelFindPeak(DetectionReportList::const_iterator sampleStart,
                                               DetectionReportList::const_iterator sampleEnd) const
+        {
+            ChannelHistograms channelHistograms;
+            Histogram(sampleStart, sampleEnd, driftBins, slotWidth, channelHistograms);
+            return ChannelCentres(channelHistograms);
+        } // ChannelFindPeak
+
+        ChannelOffsets Drift::ChannelFindPeak(const DetectionView& detections) const
+        {
+            ChannelHistograms channelHistograms;
+            Histogram(detections, driftBins, slotWidth, channelHistograms);
+            return ChannelCentres(channelHistograms);
+        } // ChannelFindPeak
+
+        ChannelOffsets Drift::ChannelCentres(const ChannelHistograms& channelHistograms) const
         {
             using namespace std;
-            using namespace std::chrono;
 
             const uint_fast16_t binsCentre = driftBins / 2;
 
-            ChannelHistograms channelHistograms;
             ChannelOffsets channelCentres;
 
-            Histogram(sampleStart, sampleEnd, driftBins, slotWidth, channelHistograms);
-
             uint_fast8_t channelIndex = 0;
 
-            for(auto hist : channelHistograms)
+            for(const auto& hist : channelHistograms)
             {
 
                 // get the extents of the graphs to find the centre of the transmission.
@@ -167,14 +231,38 @@ namespace cqp
             }
 
             return channelCentres;
-        } // FindPeak
+        } // ChannelCentres
 
 
         void Drift::GetPeaks(const DetectionReportList::const_iterator& start,
                              const DetectionReportList::const_iterator& end,
                              std::vector<double>& peaks, std::vector<double>::const_iterator& maximum)
         {
-            using namespace std;
+            SamplePeaks(static_cast<size_t>(std::distance(start, end)), [&start](size_t index)
+            {
+                return start[static_cast<ptrdiff_t>(index)].time;
+            }, [this, start](size_t first, size_t last)
+            {
+                return FindPeak(start + static_cast<ptrdiff_t>(first), start + static_cast<ptrdiff_t>(last));
+            }, peaks, maximum);
+        } // GetPeaks
+
+        void Drift::GetPeaks(const DetectionView& detections,
+                             std::vector<double>& peaks, std::vector<double>::const_iterator& maximum)
+        {
+            SamplePeaks(detections.size(), [&detections](size_t index)
+            {
+                return detections.Time(index);
+            }, [this, detections](size_t first, size_t last)
+            {
+                return FindPeak(detections.Slice(first, last));
+            }, peaks, maximum);
+        } // GetPeaks
+
+        template<typename TimeAt, typename PeakOf>
+        void Drift::SamplePeaks(size_t count, TimeAt timeAt, PeakOf peakOf,
+                                std::vector<double>& peaks, std::vector<double>::const_iterator& maximum)
+        {
             /*
              * Take just enough data to detect the signal over the noise
              * find the centre of the detection mass when the edge goes over 3db
@@ -190,40 +278,55 @@ namespace cqp
             // split the input in a number of samples
             // the data will be split to the nearest slotwidth
 
-            auto sampleStart = start;
-            auto sampleEnd = end;
+            size_t sampleStart = 0;
             uint_fast16_t sampleIndex = 1;
 
             // this will produce a sawtooth graph, the number of peaks depends on how often the drift pushes the peak past a slot edge
 
             std::vector<std::future<double>> peakFutures;
 
-            while(distance(sampleStart, end) > 1)
+            while(count - sampleStart > 1)
             {
-                DetectionReport cutoff;
-                cutoff.time = start->time + driftSampleTime * sampleIndex;
-                // use the binary search to find the point in the data where the time is past our sample time limit
-                Filter::FindThreshold<DetectionReport>(sampleStart, sampleEnd, cutoff, sampleEnd, [](const auto& left, const auto& right)
+                const PicoSeconds cutoff = timeAt(0) + driftSampleTime * sampleIndex;
+                // use a binary search to find the first detection past our sample time limit
+                size_t sampleEnd = sampleStart;
+                size_t remaining = count - sampleStart;
+                while(remaining > 0)
                 {
-                    return left.time > right.time;
-                });
+                    const size_t half = remaining / 2;
+                    if(timeAt(sampleEnd + half) <= cutoff)
+                    {
+                        sampleEnd += half + 1;
+                        remaining -= half + 1;
+                    }
+                    else
+                    {
+                        remaining = half;
+                    }
+                }
 
-                if(sampleEnd != (end - 1) || sampleEnd->time - sampleStart->time >= driftSampleTime)
+                // the last sample is only used if it's long enough
+                if(sampleEnd < count || timeAt(count - 1) - timeAt(sampleStart) >= driftSampleTime)
                 {
                     peakFutures.emplace_back(
-                        workQueue.Enqueue([&, sampleStart, sampleEnd]()
+                        workQueue.Enqueue([peakOf, sampleStart, sampleEnd]()
                     {
-                        return FindPeak(sampleStart, sampleEnd);
+                        return peakOf(sampleStart, sampleEnd);
                     })
                     );
                 }
-                //LOGDEBUG("Searching for peak in " + to_string(distance(sampleStart, sampleEnd)) + " samples");
+                //LOGDEBUG("Searching for peak in " + to_string(sampleEnd - sampleStart) + " samples");
                 // set the start of the next sample
                 sampleStart = sampleEnd;
-                sampleEnd = end;
                 sampleIndex++;
             } // while samples left
 
+            CollectPeaks(peakFutures, peaks, maximum);
+        } // SamplePeaks
+
+        void Drift::CollectPeaks(std::vector<std::future<double>>& peakFutures,
+                                 std::vector<double>& peaks, std::vector<double>::const_iterator& maximum)
+        {
             // set the size now to the max iterator doesn't get invalidated
             peaks.resize(peakFutures.size());
             maximum = peaks.end();
@@ -251,7 +354,7 @@ namespace cqp
              |_________    |_________
             */
 
-        } // GetPeaks
+        } // CollectPeaks
 
         double Drift::Calculate(const DetectionReportList::const_iterator& start,
                                 const DetectionReportList::const_iterator& end)
@@ -262,7 +365,22 @@ namespace cqp
             std::vector<double>::const_iterator maximum = peaks.end();
 
             GetPeaks(start, end, peaks, maximum);
+            return DriftFromPeaks(peaks, maximum);
+        } // CalculateDrift
+
+        double Drift::Calculate(const DetectionView& detections)
+        {
+            std::vector<double> peaks;
+            std::vector<double>::const_iterator maximum = peaks.end();
 
+            GetPeaks(detections, peaks, maximum);
+            return DriftFromPeaks(peaks, maximum);
+        } // CalculateDrift
+
+        double Drift::DriftFromPeaks(const std::vector<double>& peaks,
+                                     std::vector<double>::const_iterator maximum) const
+        {
+            using namespace std;
             double drift = 0.0;
             if(!peaks.empty())
             {
@@ -298,7 +416,7 @@ namespace cqp
             }
 
             return drift;
-        } // CalculateDrift
+        } // DriftFromPeaks
 
     } // namespace align
 } // namespace cqp
@@ -12,6 +12,7 @@
 #pragma once
 #include "Algorithms/Datatypes/Chrono.h"
 #include "Algorithms/Datatypes/DetectionReport.h"
+#include "Algorithms/Datatypes/DetectionFrame.h"
 #include "Algorithms/Alignment/AlignmentTypes.h"
 #include "Algorithms/Util/ProcessingQueue.h"
 
@@ -58,6 +59,22 @@ namespace cqp {
             ChannelOffsets ChannelFindPeak(DetectionReportList::const_iterator sampleStart,
                                   DetectionReportList::const_iterator sampleEnd) const;
 
+            /**
+             * @brief CalculateDrift
+             * successivly sample the data and measure the disance between peaks to detect clock drift
+             * @param detections The data to sample
+             * @return Picoseconds drift
+             */
+            double Calculate(const DetectionView& detections);
+
+            /**
+             * @brief ChannelFindPeak
+             * Find the offset between the channels
+             * @param detections The data to sample
+             * @return The relative offsets between the channels
+             */
+            ChannelOffsets ChannelFindPeak(const DetectionView& detections) const;
+
         protected: // methods
 
             /// A list of histograms, one for each channel
@@ -88,6 +105,26 @@ namespace cqp {
                            PicoSeconds windowWidth,
                            ChannelHistograms& counts);
 
+            /**
+             * @copydoc Histogram
+             * @details Only the time column is read.
+             * @param[in] detections The data to count
+             */
+            static void Histogram(const DetectionView& detections,
+                           uint_fast16_t numBins,
+                           PicoSeconds windowWidth,
+                           std::vector<uint64_t>& counts);
+
+            /**
+             * @copydoc Histogram
+             * @details This plots a histogram for each channel's tags.
+             * @param[in] detections The data to count
+             */
+            static void Histogram(const DetectionView& detections,
+                           uint_fast16_t numBins,
+                           PicoSeconds windowWidth,
+                           ChannelHistograms& counts);
+
             /**
              * @brief FindPeak
              * Createa histogram of the data and find the highest count
@@ -109,6 +146,77 @@ namespace cqp {
                           const DetectionReportList::const_iterator& end,
                           std::vector<double>& peaks,
                           std::vector<double>::const_iterator& maximum);
+
+            /**
+             * @brief FindPeak
+             * Createa histogram of the data and find the highest count
+             * @param sample The data to read
+             * @return The centre of the peak as a percentage of the histogram
+             */
+            double FindPeak(const DetectionView& sample) const;
+
+            /**
+             * @brief GetPeaks Runs FindPeak over a complete data set to produce a list of peaks
+             * @param detections The data to sample
+             * @param[out] peaks The position in bins of the peaks
+             * @param maximum The highest value found
+             */
+            void GetPeaks(const DetectionView& detections,
+                          std::vector<double>& peaks,
+                          std::vector<double>::const_iterator& maximum);
+
+            /**
+             * @brief SamplePeaks
+             * Shared implementation of GetPeaks
+             * @tparam TimeAt Callable which returns the time of a detection by index
+             * @tparam PeakOf Callable which returns the peak of the detections from a first index to one past a last index
+             * @param count The number of detections
+             * @param timeAt Reads the time of each detection
+             * @param peakOf Finds the peak of each sample
+             * @param[out] peaks The position in bins of the peaks
+             * @param maximum The highest value found
+             */
+            template<typename TimeAt, typename PeakOf>
+            void SamplePeaks(size_t count, TimeAt timeAt, PeakOf peakOf,
+                             std::vector<double>& peaks,
+                             std::vector<double>::const_iterator& maximum);
+
+            /**
+             * @brief PeakCentre
+             * Find the centre of the highest peak in a histogram
+             * @param histogram The counts for each bin
+             * @return The centre of the peak as a percentage of the histogram
+             */
+            double PeakCentre(const std::vector<uint64_t>& histogram) const;
+
+            /**
+             * @brief ChannelCentres
+             * Find the centre of the highest peak for each channel
+             * @param channelHistograms The counts for each bin of each channel
+             * @return The relative offsets between the channels
+             */
+            ChannelOffsets ChannelCentres(const ChannelHistograms& channelHistograms) const;
+
+            /**
+             * @brief CollectPeaks
+             * Wait for the peaks being calculated
+             * @param peakFutures The peaks being calculated
+             * @param[out] peaks The position in bins of the peaks
+             * @param maximum The highest value found
+             */
+            static void CollectPeaks(std::vector<std::future<double>>& peakFutures,
+                                     std::vector<double>& peaks,
+                                     std::vector<double>::const_iterator& maximum);
+
+            /**
+             * @brief DriftFromPeaks
+             * Measure the slope of the peaks
+             * @param peaks The position in bins of the peaks
+             * @param maximum The highest value found
+             * @return Picoseconds drift
+             */
+            double DriftFromPeaks(const std::vector<double>& peaks,
+                                  std::vector<double>::const_iterator maximum) const;
         protected:
             /// The number of histogram bins to use when calculating drift
             BinID driftBins;
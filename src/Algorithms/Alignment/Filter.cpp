@@ -14,41 +14,41 @@ namespace cqp
 
         }
 
-        bool Filter::Isolate(const std::vector<double>& filter, size_t stride, double threshold, bool findStart,
-                             DetectionReportList::const_iterator begin, DetectionReportList::const_iterator end,
-                             IteratorPair& edgeRange)
+        /**
+         * @brief FindEdge
+         * Calculate an acceptance edge
+         * @tparam TimeAt Callable which returns the time in picoseconds of a detection by index
+         * @param filter The filter to apply to the data for smoothing
+         * @param stride How many elements to reduce the data set by when detecting the transmission
+         * @param threshold The signal level which signifies a valid transmission as a percentage (0 - 1)
+         * @param findStart true = look for the start of transmission, otherwise look for the end
+         * @param numElements The number of detections
+         * @param timeAt Reads the time of each detection
+         * @param[out] first The offset of the start of the range within which the edge has been found
+         * @param[out] second The offset of the end of the range within which the edge has been found
+         * @return true on success
+         */
+        template<typename TimeAt>
+        static bool FindEdge(const std::vector<double>& filter, size_t stride, double threshold, bool findStart,
+                             size_t numElements, TimeAt timeAt, ssize_t& first, ssize_t& second)
         {
             bool result = false;
             using namespace std;
-            // set defaults for error condition
-            edgeRange.first = begin;
-            edgeRange.second = end;
-            const auto numElements = static_cast<size_t>(abs(distance(begin, end)));
-
 
             if(numElements > stride)
             {
-                auto prevTagIt = begin;
-
                 // difference the values
                 vector<uint64_t> diffs;
                 diffs.reserve(numElements / stride);
                 // the first element of diffs will equal the first element of timetags
-                for(auto tagIt = begin + static_cast<uint32_t>(stride);
-                        tagIt < end;
-                        tagIt += static_cast<uint32_t>(stride))
+                for(auto index = stride; index < numElements; index += stride)
                 {
-                    if(tagIt < end)
-                    {
-                        diffs.push_back(tagIt->time.count() - prevTagIt->time.count());
-                    }
-                    // this tag now become the previous for the next iteration
-                    prevTagIt = tagIt;
+                    diffs.push_back(timeAt(index) - timeAt(index - stride));
                 }
                 // convolve the data to find the start of transmission
                 vector<uint64_t> convolved;
 
-                if(ConvolveValid(diffs.begin(), diffs.end(), filter.begin(), filter.end(), convolved))
+                if(Filter::ConvolveValid(diffs.begin(), diffs.end(), filter.begin(), filter.end(), convolved))
                 {
                     const auto minima = *min_element(convolved.begin(), convolved.end());
                     const auto maxima = *max_element(convolved.begin(), convolved.end());
@@ -83,8 +83,8 @@ namespace cqp
                             const auto edgeOffset = (static_cast<size_t>(distance(convolved.cbegin(), edge)) + (filter.size() / 2 - 1)) * stride;
                             // store the offsets we've calculated
                             // the convolution process reduces the width of the graph, losing the rightmost edge
-                            edgeRange.first = begin + static_cast<ssize_t>(edgeOffset - stride + 1);
-                            edgeRange.second = begin + static_cast<ssize_t>(edgeOffset + stride - 1);
+                            first = static_cast<ssize_t>(edgeOffset - stride + 1);
+                            second = static_cast<ssize_t>(edgeOffset + stride - 1);
                         }
                     }
                 }// else {
@@ -96,6 +96,57 @@ namespace cqp
                 LOGWARN("stride is wider than data");
             }
 
+            return result;
+        } // FindEdge
+
+        bool Filter::Isolate(const std::vector<double>& filter, size_t stride, double threshold, bool findStart,
+                             DetectionReportList::const_iterator begin, DetectionReportList::const_iterator end,
+                             IteratorPair& edgeRange)
+        {
+            // set defaults for error condition
+            edgeRange.first = begin;
+            edgeRange.second = end;
+            const auto numElements = static_cast<size_t>(std::abs(std::distance(begin, end)));
+            ssize_t first = 0;
+            ssize_t second = 0;
+
+            const bool result = FindEdge(filter, stride, threshold, findStart, numElements, [&begin](size_t index)
+            {
+                return begin[static_cast<ssize_t>(index)].time.count();
+            }, first, second);
+
+            if(result)
+            {
+                edgeRange.first = begin + first;
+                edgeRange.second = begin + second;
+            }
+
+            return result;
+        }
+
+        bool Filter::Isolate(const std::vector<double>& filter, size_t stride, double threshold, bool findStart,
+                             const DetectionView& detections, IndexPair& edgeRange)
+        {
+            // set defaults for error condition
+            edgeRange.first = 0;
+            edgeRange.second = detections.size();
+            ssize_t first = 0;
+            ssize_t second = 0;
+            const auto times = detections.times;
+
+            const bool result = FindEdge(filter, stride, threshold, findStart, detections.size(), [times](size_t index)
+            {
+                return times[index];
+            }, first, second);
+
+            if(result)
+            {
+                // keep the range inside the data
+                const auto last = static_cast<ssize_t>(detections.size());
+                edgeRange.first = static_cast<size_t>(std::min(std::max<ssize_t>(first, 0), last));
+                edgeRange.second = static_cast<size_t>(std::min(std::max<ssize_t>(second, 0), last));
+            }
+
             return result;
         }
 
@@ -130,5 +181,41 @@ namespace cqp
             return result;
         }
 
+
+        bool Filter::Isolate(const DetectionView& detections, size_t& start, size_t& end) const
+        {
+            using namespace std;
+            bool result = false;
+
+            IndexPair startEdgeRange;
+            // Look for the rough area where the window starts
+            result = Isolate(filter, initialStride, courseThreshold, true, detections, startEdgeRange);
+            if(result)
+            {
+                LOGDEBUG("Course start: " + to_string(startEdgeRange.first) + " to " + to_string(startEdgeRange.second));
+                // Repeat the process with a fine grain approach within that window
+                const auto sliceStart = startEdgeRange.first;
+                IndexPair fineRange;
+                Isolate(filter, 1, fineThreshold, true, detections.Slice(sliceStart, startEdgeRange.second), fineRange);
+                startEdgeRange = {sliceStart + fineRange.first, sliceStart + fineRange.second};
+            }
+            start = startEdgeRange.first;
+
+            IndexPair endEdgeRange;
+            // Look for the rough area where the window ends, starting from the send of the window start
+            result = Isolate(filter, initialStride, courseThreshold, false, detections.Slice(startEdgeRange.second, detections.size()), endEdgeRange);
+            endEdgeRange.first += startEdgeRange.second;
+            endEdgeRange.second += startEdgeRange.second;
+            if(result)
+            {
+                // Repeat the process with a fine grain approach within that window
+                IndexPair fineRange;
+                result = Isolate(filter, 1, fineThreshold, false, detections.Slice(endEdgeRange.first, endEdgeRange.second), fineRange);
+                endEdgeRange.first += fineRange.first;
+            }
+            end = endEdgeRange.first;
+            return result;
+        }
+
     } // namespace align
 } // namespace cqp
@@ -7,6 +7,7 @@
 #include <map>
 #include "Algorithms/Datatypes/Chrono.h"
 #include "Algorithms/Datatypes/DetectionReport.h"
+#include "Algorithms/Datatypes/DetectionFrame.h"
 #include <functional>
 
 namespace cqp {
@@ -73,6 +74,33 @@ namespace cqp {
                          DetectionReportList::const_iterator& start,
                          DetectionReportList::const_iterator& end) const;
 
+            /// A pair of indexes to mark two points
+            using IndexPair = std::pair<size_t, size_t>;
+
+            /**
+             * @brief Isolate
+             * Static isolate method to calculate an acceptance edge, reading only the time column
+             * @param filter The filter to apply to the data for smoothing
+             * @param stride How many elements to reduce the data set by when detecting the transmission
+             * @param threshold The signal level which signifies a valid transmission as a percentage (0 - 1)
+             * @param findStart true = look for the start of transmission, otherwise look for the end
+             * @param detections The data to search
+             * @param[out] edgeRange The indexes within detections between which the edge has been found
+             * @return true on success
+             */
+            static bool Isolate(const std::vector<double>& filter, size_t stride, double threshold, bool findStart,
+                                const DetectionView& detections, IndexPair& edgeRange);
+
+            /**
+             * @brief Isolate
+             * Find the start and end of transmission by looking for an increase in detections
+             * @param detections Raw detections
+             * @param[out] start The index of the start of detections
+             * @param[out] end The index of the end of detections
+             * @return true on success
+             */
+            bool Isolate(const DetectionView& detections, size_t& start, size_t& end) const;
+
 
             /**
              * @brief Gaussian
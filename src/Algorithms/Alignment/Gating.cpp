@@ -32,78 +32,361 @@ namespace cqp
 
         }
 
-        void Gating::CountDetections(const PicoSeconds& frameStart,
-                                     const DetectionReportList::const_iterator& start,
-                                     const DetectionReportList::const_iterator& end,
-                                     Gating::CountsByBin& counts,
-                                     ResultsByBinBySlot& slotResults) const
+        /**
+         * @brief ChunkBounds
+         * Split a list of detections between threads
+         * @param count The number of detections
+         * @return The start of each chunk followed by the end of the last chunk
+         */
+        static std::vector<size_t> ChunkBounds(size_t count)
         {
             using namespace std;
-            counts.resize(numBins, 0);
-            slotResults.resize(numBins);
+            size_t numChunks = max<size_t>(1, min<size_t>(thread::hardware_concurrency(),
+                                           count / Gating::MinDetectionsPerThread));
+            vector<size_t> bounds(numChunks + 1);
+            for(auto chunk = 0u; chunk <= numChunks; chunk++)
+            {
+                bounds[chunk] = count * chunk / numChunks;
+            }
+            return bounds;
+        }
 
-            //const double scaledDrift = (drift * PicoSecondOffset::period::den).count();
-            // for each detection
-            //   calculate it's slot and bin ids and store a reference to the original data
-            //   count the bin ids
-            for(auto detection = start; detection != end; ++detection)
+        /**
+         * @brief CountChunks
+         * Build a histogram of the detections, split between threads
+         * @tparam Place Callable which finds the slot and bin of a detection by index
+         * @param numDetections The number of detections
+         * @param numBins The size of the histogram
+         * @param place Finds the slot and bin of each detection
+         * @param[out] counts The histogram of the data
+         * @param[out] slots The slot of each detection
+         * @param[out] bins The bin of each detection
+         */
+        template<typename Place>
+        static void CountChunks(size_t numDetections, BinID numBins, Place place,
+                                Gating::CountsByBin& counts,
+                                Gating::SlotsByDetection& slots,
+                                Gating::BinsByDetection& bins)
+        {
+            using namespace std;
+            const auto bounds = ChunkBounds(numDetections);
+            const auto numChunks = bounds.size() - 1;
+
+            counts.assign(numBins, 0);
+            slots.resize(numDetections);
+            bins.resize(numDetections);
+
+            // each chunk has it's own histogram so that there is no sharing between threads
+            vector<Gating::CountsByBin> chunkCounts(numChunks);
+            auto countChunk = [&](size_t chunk)
+            {
+                auto& myCounts = chunkCounts[chunk];
+                myCounts.assign(numBins, 0);
+                for(auto index = bounds[chunk]; index < bounds[chunk + 1]; index++)
+                {
+                    place(index, slots[index], bins[index]);
+                    myCounts[bins[index]]++;
+                }
+            };
+
+            vector<future<void>> tasks;
+            for(auto chunk = 1u; chunk < numChunks; chunk++)
             {
-                using namespace std::chrono;
-                // calculate the offset in whole picoseconds (signed)
-                const PicoSecondOffset offset { static_cast<PicoSecondOffset::rep>(round(drift * detection->time.count())) };
+                tasks.emplace_back(async(launch::async, countChunk, chunk));
+            }
+            countChunk(0);
 
-                // offset the time without the original value being converted to a float
-                PicoSeconds  adjustedTime = detection->time - frameStart;
-                // if the offset is positive, don't wrap past 0
-                if(offset < AttoSeconds(0) || adjustedTime > offset)
+            for(auto chunk = 0u; chunk < numChunks; chunk++)
+            {
+                if(chunk > 0)
                 {
-                    adjustedTime += channelCorrections[detection->value];
-                    adjustedTime -= offset;
+                    tasks[chunk - 1].wait();
                 }
-                // C++ truncates on integer division
-                const SlotID slot = DivNearest(adjustedTime.count(), slotWidth.count());
+                for(auto bin = 0u; bin < numBins; bin++)
+                {
+                    counts[bin] += chunkCounts[chunk][bin];
+                }
+            }
+        } // CountChunks
 
-                const auto fromSlotStart = adjustedTime % slotWidth;
-                //const BinID bin = div_to_nearest(fromSlotStart.count(), pulseWidth.count()) % numBins;
-                const BinID bin = (fromSlotStart.count() / txJitter.count()) % numBins;
-                // store the value as a bin for later access
-                slotResults[bin][slot].push_back(detection->value);
-                counts[bin]++;
+        void Gating::SlotAndBin(const PicoSeconds& frameStart, const DetectionReport& detection,
+                                SlotID& slot, BinID& bin) const
+        {
+            SlotAndBin(frameStart, detection.time, detection.value, slot, bin);
+        }
+
+        void Gating::SlotAndBin(const PicoSeconds& frameStart, PicoSeconds time, Qubit value,
+                                SlotID& slot, BinID& bin) const
+        {
+            using namespace std;
+            // calculate the offset in whole picoseconds (signed)
+            const PicoSecondOffset offset { static_cast<PicoSecondOffset::rep>(round(drift * time.count())) };
+
+            // offset the time without the original value being converted to a float
+            PicoSeconds  adjustedTime = time - frameStart;
+            // if the offset is positive, don't wrap past 0
+            if(offset < AttoSeconds(0) || adjustedTime > offset)
+            {
+                adjustedTime += channelCorrections[value];
+                adjustedTime -= offset;
             }
+            // C++ truncates on integer division
+            slot = DivNearest(adjustedTime.count(), slotWidth.count());
 
+            const auto fromSlotStart = adjustedTime % slotWidth;
+            bin = (fromSlotStart.count() / txJitter.count()) % numBins;
         }
 
-        void Gating::GateResults(const Gating::CountsByBin& counts, const Gating::ResultsByBinBySlot& slotResults,
-                                 ValidSlots& validSlots, QubitList& results, double* peakWidth) const
+        size_t Gating::FindPeak(const CountsByBin& counts, BinID& lower, BinID& upper) const
         {
             using namespace std;
             // find the peak from the counts
-            const size_t peakIndex = static_cast<size_t>(distance(counts.cbegin(), max_element(counts.cbegin(), counts.cend())));
+            const BinID peakIndex = static_cast<BinID>(distance(counts.cbegin(), max_element(counts.cbegin(), counts.cend())));
             const auto minValue = *min_element(counts.cbegin(), counts.cend());
             const auto cutoff = static_cast<size_t>(minValue + (counts[peakIndex] - minValue) * acceptanceRatio);
-            auto upper = peakIndex;
-            auto lower = peakIndex;
+            upper = peakIndex;
+            lower = peakIndex;
+
+            auto nextLower = lower;
+            while(counts[nextLower] > cutoff && nextLower != (peakIndex + 1) % numBins)
+            {
+                lower = nextLower;
+                nextLower = (numBins + nextLower - 1) % numBins;
+            }
+
+            while(counts[upper] > cutoff && upper != (numBins + peakIndex - 1) % numBins)
+            {
+                upper = (upper + 1) % numBins;
+            }
+
+            LOGDEBUG(" lower=" + to_string(lower) + "Peak=" + to_string(peakIndex) + " upper=" + to_string(upper));
+            return (numBins + upper - lower) % numBins;
+        }
+
+        SlotID Gating::PeakSlotOffset(BinID binId, BinID lower, BinID upper) const
+        {
+            // the first bin which SlotAndBin rounds up to the next slot
+            const auto middle = static_cast<BinID>((slotWidth / 2) / txJitter);
+            const bool crossesMiddle = (lower <= upper) ? (lower < middle && middle < upper) : (lower < middle || middle < upper);
+
+            // move the bins before the middle up to join the rest of the peak
+            return (crossesMiddle && binId < middle) ? 1 : 0;
+        } // PeakSlotOffset
+
+        void Gating::CountDetections(const PicoSeconds& frameStart,
+                                     const DetectionReportList::const_iterator& start,
+                                     const DetectionReportList::const_iterator& end,
+                                     Gating::CountsByBin& counts,
+                                     SlotsByDetection& slots,
+                                     BinsByDetection& bins) const
+        {
+            CountChunks(static_cast<size_t>(std::distance(start, end)), numBins,
+                        [&](size_t index, SlotID& slot, BinID& bin)
+            {
+                SlotAndBin(frameStart, start[static_cast<ptrdiff_t>(index)], slot, bin);
+            }, counts, slots, bins);
+        }
+
+        void Gating::CountDetections(const PicoSeconds& frameStart,
+                                     const DetectionView& detections,
+                                     Gating::CountsByBin& counts,
+                                     SlotsByDetection& slots,
+                                     BinsByDetection& bins) const
+        {
+            const auto times = detections.times;
+            const auto values = detections.values;
+            CountChunks(detections.size(), numBins,
+                        [&](size_t index, SlotID& slot, BinID& bin)
+            {
+                SlotAndBin(frameStart, PicoSeconds(times[index]), values[index], slot, bin);
+            }, counts, slots, bins);
+        }
+
+        void Gating::GateResults(const CountsByBin& counts,
+                                 const DetectionReportList::const_iterator& start,
+                                 const SlotsByDetection& slots,
+                                 const BinsByDetection& bins,
+                                 ValidSlots& validSlots,
+                                 QubitList& results,
+                                 double* peakWidth) const
+        {
+            GateDetections(counts, [&start](size_t index)
+            {
+                return start[static_cast<ptrdiff_t>(index)].value;
+            }, slots, bins, validSlots, results, peakWidth);
+        }
+
+        void Gating::GateResults(const CountsByBin& counts,
+                                 const DetectionView& detections,
+                                 const SlotsByDetection& slots,
+                                 const BinsByDetection& bins,
+                                 ValidSlots& validSlots,
+                                 QubitList& results,
+                                 double* peakWidth) const
+        {
+            const auto values = detections.values;
+            GateDetections(counts, [values](size_t index)
+            {
+                return values[index];
+            }, slots, bins, validSlots, results, peakWidth);
+        }
+
+        template<typename ValueAt>
+        void Gating::GateDetections(const CountsByBin& counts,
+                                    ValueAt valueAt,
+                                    const SlotsByDetection& slots,
+                                    const BinsByDetection& bins,
+                                    ValidSlots& validSlots,
+                                    QubitList& results,
+                                    double* peakWidth) const
+        {
+            using namespace std;
+            BinID lower = 0;
+            BinID upper = 0;
+            const auto binCount = FindPeak(counts, lower, upper);
+
+            if(peakWidth)
+            {
+                *peakWidth = (binCount / static_cast<double>(numBins));
+            }
+
+            // The amount to add to the slot id for each bin or -1 if the bin is rejected
+            vector<int_fast8_t> slotOffsets(numBins, -1);
+            for(auto binId = lower; binId != upper; binId = (binId + 1) % numBins)
+            {
+                slotOffsets[binId] = static_cast<int_fast8_t>(PeakSlotOffset(binId, lower, upper));
+            }
 
+            const auto bounds = ChunkBounds(slots.size());
+            const auto numChunks = bounds.size() - 1;
+            // count how many each chunk will produce so that they can write into the output at the same time
+            vector<size_t> outputStart(numChunks + 1, 0);
+            for(auto chunk = 0u; chunk < numChunks; chunk++)
             {
-                auto findLower = std::async(std::launch::async, [&]()
+                size_t accepted = 0;
+                for(auto index = bounds[chunk]; index < bounds[chunk + 1]; index++)
                 {
-                    auto nextLower = lower;
-                    while(counts[nextLower] > cutoff && nextLower != (peakIndex + 1) % numBins)
+                    accepted += slotOffsets[bins[index]] >= 0;
+                }
+                outputStart[chunk + 1] = outputStart[chunk] + accepted;
+            }
+
+            const auto firstSlot = validSlots.size();
+            const auto firstResult = results.size();
+            const auto numAccepted = outputStart[numChunks];
+            validSlots.resize(firstSlot + numAccepted);
+            results.resize(firstResult + numAccepted);
+
+            auto gateChunk = [&](size_t chunk)
+            {
+                auto slotOut = validSlots.begin() + static_cast<ptrdiff_t>(firstSlot + outputStart[chunk]);
+                auto resultOut = results.begin() + static_cast<ptrdiff_t>(firstResult + outputStart[chunk]);
+                for(auto index = bounds[chunk]; index < bounds[chunk + 1]; index++)
+                {
+                    const auto offset = slotOffsets[bins[index]];
+                    if(offset >= 0)
                     {
-                        lower = nextLower;
-                        nextLower = (numBins + nextLower - 1) % numBins;
+                        *slotOut++ = slots[index] + static_cast<SlotID>(offset);
+                        *resultOut++ = valueAt(index);
                     }
+                }
+            };
+
+            vector<future<void>> tasks;
+            for(auto chunk = 1u; chunk < numChunks; chunk++)
+            {
+                tasks.emplace_back(async(launch::async, gateChunk, chunk));
+            }
+            gateChunk(0);
+            for(auto& task : tasks)
+            {
+                task.wait();
+            }
+
+            auto slotsBegin = validSlots.begin() + static_cast<ptrdiff_t>(firstSlot);
+            auto resultsBegin = results.begin() + static_cast<ptrdiff_t>(firstResult);
+            if(!is_sorted(slotsBegin, validSlots.end()))
+            {
+                // drift and channel corrections can move a detection past its neighbours
+                vector<pair<SlotID, Qubit>> sorted(numAccepted);
+                for(auto index = 0u; index < numAccepted; index++)
+                {
+                    sorted[index] = {slotsBegin[index], resultsBegin[index]};
+                }
+                stable_sort(sorted.begin(), sorted.end(), [](const pair<SlotID, Qubit>& left, const pair<SlotID, Qubit>& right)
+                {
+                    return left.first < right.first;
                 });
+                for(auto index = 0u; index < numAccepted; index++)
+                {
+                    slotsBegin[index] = sorted[index].first;
+                    resultsBegin[index] = sorted[index].second;
+                }
+            }
 
-                while(counts[upper] > cutoff && upper != (peakIndex - 1) % numBins)
+            // collapse any slots with more than one detection
+            uint_fast16_t multiSlots = 0;
+            size_t outputIndex = 0;
+            size_t index = 0;
+            while(index < numAccepted)
+            {
+                auto runEnd = index + 1;
+                while(runEnd < numAccepted && slotsBegin[runEnd] == slotsBegin[index])
                 {
-                    upper = (upper + 1) % numBins;
+                    runEnd++;
                 }
 
-                findLower.wait();
+                slotsBegin[outputIndex] = slotsBegin[index];
+                if(runEnd - index == 1)
+                {
+                    resultsBegin[outputIndex] = resultsBegin[index];
+                }
+                else
+                {
+                    multiSlots++;
+                    // pick a qubit at random
+                    resultsBegin[outputIndex] = resultsBegin[index + rng->RandULong() % (runEnd - index)];
+                }
+                outputIndex++;
+                index = runEnd;
             }
 
-            LOGDEBUG(" lower=" + to_string(lower) + "Peak=" + to_string(peakIndex) + " upper=" + to_string(upper));
+            validSlots.resize(firstSlot + outputIndex);
+            results.resize(firstResult + outputIndex);
+
+            LOGDEBUG("Number of multi-qubit slots: " + to_string(multiSlots));
+        } // GateDetections
+
+        void Gating::CountDetections(const PicoSeconds& frameStart,
+                                     const DetectionReportList::const_iterator& start,
+                                     const DetectionReportList::const_iterator& end,
+                                     Gating::CountsByBin& counts,
+                                     ResultsByBinBySlot& slotResults) const
+        {
+            using namespace std;
+            counts.resize(numBins, 0);
+            slotResults.resize(numBins);
+
+            for(auto detection = start; detection != end; ++detection)
+            {
+                SlotID slot = 0;
+                BinID bin = 0;
+                SlotAndBin(frameStart, *detection, slot, bin);
+                // store the value as a bin for later access
+                slotResults[bin][slot].push_back(detection->value);
+                counts[bin]++;
+            }
+
+        }
+
+        void Gating::GateResults(const Gating::CountsByBin& counts, const Gating::ResultsByBinBySlot& slotResults,
+                                 ValidSlots& validSlots, QubitList& results, double* peakWidth) const
+        {
+            using namespace std;
+            BinID lower = 0;
+            BinID upper = 0;
+            FindPeak(counts, lower, upper);
+
             map<SlotID, QubitList> qubitsBySlot;
             // walk through each bin, wrapping around to the start if the upper bin < lower bin
 
@@ -111,13 +394,7 @@ namespace cqp
 
             for(auto binId = lower; binId != upper; binId = (binId + 1) % numBins)
             {
-                SlotID slotOffset = 0;
-                // If the bin ID is less than the lower limit we're left of bin 0
-                if(upper < lower && binId < upper)
-                {
-                    // the peak wraps around, adjust the slot id for bins to the left
-                    slotOffset = 1;
-                }
+                const SlotID slotOffset = PeakSlotOffset(binId, lower, upper);
                 binCount++;
                 for(const auto& slot : slotResults[binId])
                 {
@@ -163,7 +440,7 @@ namespace cqp
 
             // results now contains a contiguous list of qubits
             // validSlots tells the caller which slots were used to create that list.
-        } // CountDetections
+        } // GateResults
 
         void Gating::ExtractQubits(const DetectionReportList::const_iterator& start,
                                    const DetectionReportList::const_iterator& end,
@@ -174,11 +451,12 @@ namespace cqp
 
             LOGDEBUG("Drift = " + std::to_string(drift) + "s/s");
             CountsByBin counts;
-            ResultsByBinBySlot resultsBySlot;
-            CountDetections(start->time, start, end, counts, resultsBySlot);
+            SlotsByDetection slots;
+            BinsByDetection bins;
+            CountDetections(start->time, start, end, counts, slots, bins);
 
             double peakWidth = 0.0;
-            GateResults(counts, resultsBySlot, validSlots, results, &peakWidth);
+            GateResults(counts, start, slots, bins, validSlots, results, &peakWidth);
 
             stats.PeakWidth.Update(peakWidth);
             stats.Drift.Update(drift);
@@ -188,5 +466,25 @@ namespace cqp
 
         }
 
+        void Gating::ExtractQubits(const DetectionView& detections,
+                                   ValidSlots& validSlots,
+                                   QubitList& results)
+        {
+            LOGDEBUG("Drift = " + std::to_string(drift) + "s/s");
+            CountsByBin counts;
+            SlotsByDetection slots;
+            BinsByDetection bins;
+            const PicoSeconds frameStart = detections.empty() ? PicoSeconds(0) : detections.Time(0);
+            CountDetections(frameStart, detections, counts, slots, bins);
+
+            double peakWidth = 0.0;
+            GateResults(counts, detections, slots, bins, validSlots, results, &peakWidth);
+
+            stats.PeakWidth.Update(peakWidth);
+            stats.Drift.Update(drift);
+
+            LOGDEBUG("Peak width: " + std::to_string(peakWidth * 100.0) + "%");
+        }
+
     } // namespace align
 } // namespace cqp
@@ -15,6 +15,7 @@
 #include <vector>
 #include "Algorithms/Datatypes/Qubits.h"
 #include "Algorithms/Datatypes/DetectionReport.h"
+#include "Algorithms/Datatypes/DetectionFrame.h"
 #include "Algorithms/algorithms_export.h"
 #include <set>
 #include "Algorithms/Random/IRandom.h"
@@ -52,6 +53,13 @@ namespace cqp
             using CountsByBin = std::vector<BinID>;
             /// A list of slot ids
             using ValidSlots = std::vector<SlotID>;
+            /// The slot of each detection, in the same order as the detections
+            using SlotsByDetection = std::vector<SlotID>;
+            /// The bin of each detection, in the same order as the detections
+            using BinsByDetection = std::vector<BinID>;
+
+            /// The smallest number of detections which will be given to a thread
+            static constexpr size_t MinDetectionsPerThread = 1u << 16;
 
         public: // methods
 
@@ -79,6 +87,7 @@ namespace cqp
              *      Gating -> Gating : CalculateDrift
              *  end alt
              *  Gating -> Gating : CountDetections
+             *  note right : flat histogram
              *  Gating -> Gating : GateResults
              *  @enduml
              * @param[in] start The start of the raw data
@@ -91,6 +100,17 @@ namespace cqp
                                ValidSlots& validSlots,
                                QubitList& results);
 
+            /**
+             * @brief ExtractQubits
+             * Perform detection counting, drift calculation, scoring, etc to produce a list of qubits from raw detections.
+             * @param[in] detections The raw data
+             * @param[out] validSlots A list of slot id which were successfully extracted
+             * @param[out] results The qubit values for each slot id in validSlots
+             */
+            void ExtractQubits(const DetectionView& detections,
+                               ValidSlots& validSlots,
+                               QubitList& results);
+
             /**
              * @brief SetDrift
              * Change the drift value used for ExtractQubits when calculateDrift is set to false
@@ -123,10 +143,93 @@ namespace cqp
                 channelCorrections = newChannelCorrections;
             }
 
+            /**
+             * @brief CountDetections
+             * Build a histogram of the data while applying drift.
+             * Also returns the slot and bin of every detection.
+             * The detections are split between threads in chunks.
+             * @param[in] frameStart The estimated frame start time which will be used to offset all time values
+             * @param[in] start Start of data to count
+             * @param[in] end End of data to count
+             * @param[out] counts The histogram of the data
+             * @param[out] slots The slot of each detection
+             * @param[out] bins The bin of each detection
+             */
+            void CountDetections(const PicoSeconds& frameStart,
+                                 const DetectionReportList::const_iterator& start,
+                                 const DetectionReportList::const_iterator& end,
+                                 CountsByBin& counts,
+                                 SlotsByDetection& slots,
+                                 BinsByDetection& bins) const;
+
+            /**
+             * @brief GateResults
+             * Filter out detections which dont pass the acceptance value.
+             * Accepted detections are written straight to the output in detection order,
+             * slots with more than one detection are then reduced to one at random.
+             * @param[in] counts Histogram of detections
+             * @param[in] start The detections which were passed to CountDetections
+             * @param[in] slots The slot of each detection
+             * @param[in] bins The bin of each detection
+             * @param[out] validSlots The slots which contain valid detections
+             * Gaurenteed to be in assending order
+             * @param[out] results The usable qubit values
+             * @param[out] peakWidth Optional. if not null, will be filled with the percentage (0 - 1) of the histogram which was accepted.
+             * The larger the width the more noise is present
+             */
+            void GateResults(const CountsByBin& counts,
+                             const DetectionReportList::const_iterator& start,
+                             const SlotsByDetection& slots,
+                             const BinsByDetection& bins,
+                             ValidSlots& validSlots,
+                             QubitList& results,
+                             double* peakWidth = nullptr) const;
+
+            /**
+             * @brief CountDetections
+             * Build a histogram of the data while applying drift.
+             * Also returns the slot and bin of every detection.
+             * The detections are split between threads in chunks.
+             * @param[in] frameStart The estimated frame start time which will be used to offset all time values
+             * @param[in] detections The data to count
+             * @param[out] counts The histogram of the data
+             * @param[out] slots The slot of each detection
+             * @param[out] bins The bin of each detection
+             */
+            void CountDetections(const PicoSeconds& frameStart,
+                                 const DetectionView& detections,
+                                 CountsByBin& counts,
+                                 SlotsByDetection& slots,
+                                 BinsByDetection& bins) const;
+
+            /**
+             * @brief GateResults
+             * Filter out detections which dont pass the acceptance value.
+             * Accepted detections are written straight to the output in detection order,
+             * slots with more than one detection are then reduced to one at random.
+             * @param[in] counts Histogram of detections
+             * @param[in] detections The detections which were passed to CountDetections
+             * @param[in] slots The slot of each detection
+             * @param[in] bins The bin of each detection
+             * @param[out] validSlots The slots which contain valid detections
+             * Gaurenteed to be in assending order
+             * @param[out] results The usable qubit values
+             * @param[out] peakWidth Optional. if not null, will be filled with the percentage (0 - 1) of the histogram which was accepted.
+             * The larger the width the more noise is present
+             */
+            void GateResults(const CountsByBin& counts,
+                             const DetectionView& detections,
+                             const SlotsByDetection& slots,
+                             const BinsByDetection& bins,
+                             ValidSlots& validSlots,
+                             QubitList& results,
+                             double* peakWidth = nullptr) const;
+
             /**
              * @brief CountDetections
              * Build a historgram of the data while applying drift.
              * Also returns the qubits seperated by slot
+             * @details This is slower than the flat version and is kept as a reference
              * @param[in] frameStart The estimated frame start time which will be used to offset all time values
              * @param[in] start Start of data to count
              * @param[in] end End of data to count
@@ -142,6 +245,7 @@ namespace cqp
             /**
              * @brief GateResults
              * Filter out detections which dont pass the acceptance value
+             * @details This is slower than the flat version and is kept as a reference
              * @param[in] counts Histogram of detections
              * @param[in] slotResults qubit values to be filtered
              * @param[out] validSlots The slots which contain valid detections
@@ -231,6 +335,73 @@ namespace cqp
             /// Provides access to the stats generated by this class
             stats;
 
+        protected: // methods
+
+            /**
+             * @brief SlotAndBin
+             * Apply the drift and channel corrections to a detection
+             * @param[in] frameStart The estimated frame start time
+             * @param[in] detection The detection to place
+             * @param[out] slot The slot the detection falls in
+             * @param[out] bin The bin within the slot
+             */
+            void SlotAndBin(const PicoSeconds& frameStart, const DetectionReport& detection,
+                            SlotID& slot, BinID& bin) const;
+
+            /**
+             * @brief SlotAndBin
+             * Apply the drift and channel corrections to a detection
+             * @param[in] frameStart The estimated frame start time
+             * @param[in] time The time of the detection
+             * @param[in] value The value of the detection
+             * @param[out] slot The slot the detection falls in
+             * @param[out] bin The bin within the slot
+             */
+            void SlotAndBin(const PicoSeconds& frameStart, PicoSeconds time, Qubit value,
+                            SlotID& slot, BinID& bin) const;
+
+            /**
+             * @brief GateDetections
+             * Shared implementation of the flat GateResults
+             * @tparam ValueAt Callable which returns the value of a detection by index
+             * @param[in] counts Histogram of detections
+             * @param[in] valueAt Reads the value of each detection
+             * @param[in] slots The slot of each detection
+             * @param[in] bins The bin of each detection
+             * @param[out] validSlots The slots which contain valid detections
+             * @param[out] results The usable qubit values
+             * @param[out] peakWidth Optional. The percentage (0 - 1) of the histogram which was accepted.
+             */
+            template<typename ValueAt>
+            void GateDetections(const CountsByBin& counts,
+                                ValueAt valueAt,
+                                const SlotsByDetection& slots,
+                                const BinsByDetection& bins,
+                                ValidSlots& validSlots,
+                                QubitList& results,
+                                double* peakWidth) const;
+
+            /**
+             * @brief FindPeak
+             * Find the bins which are above the acceptance ratio around the peak
+             * @param[in] counts Histogram of detections
+             * @param[out] lower The first bin to accept
+             * @param[out] upper One past the last bin to accept, this will be less than lower if the peak wraps
+             * @return The number of bins accepted
+             */
+            size_t FindPeak(const CountsByBin& counts, BinID& lower, BinID& upper) const;
+
+            /**
+             * @brief PeakSlotOffset
+             * Slots are rounded to the nearest, so detections in the second half of a slot have been counted in the next slot.
+             * A peak which wraps past bin 0 is already in one slot, one which crosses the middle of the slot is split.
+             * @param binId A bin in the peak
+             * @param lower The first bin of the peak
+             * @param upper One past the last bin of the peak
+             * @return The amount to add to the slot of detections in this bin so that the whole peak is in one slot
+             */
+            SlotID PeakSlotOffset(BinID binId, BinID lower, BinID upper) const;
+
         protected: // members
             /// radom number generator for choosing from multiple qubits
             std::shared_ptr<IRandom> rng;
@@ -1,73 +1,279 @@
 #include "Offsetting.h"
 #include <atomic>
 #include <algorithm>
+#include "Algorithms/Datatypes/PackedQubits.h"
+#include "Algorithms/Util/FFT.h"
+#include <cmath>
 
 namespace cqp
 {
     namespace align
     {
 
-        Offsetting::Offsetting(size_t samples):
-            samples(samples)
+        /// The number of distinct qubit values, bits 1 and 2 are the basis
+        static constexpr size_t numSymbols = 8;
+        /// The smallest number of offsets to score with one transform
+        static constexpr size_t minCorrelationBlock = 4096;
+
+        /// Marks a slot in a truth window which has no known value
+        static constexpr Qubit noValue = 0xFF;
+
+        /**
+         * @brief ListWindow
+         * @param truth Values which are known to be true
+         * @return A function which fills a window with the values from truth
+         */
+        static std::function<void(int64_t, QubitList&)> ListWindow(const QubitList& truth)
         {
+            return [&truth](int64_t firstSlot, QubitList& window)
+            {
+                for(size_t index = 0; index < window.size(); index++)
+                {
+                    const auto slot = firstSlot + static_cast<int64_t>(index);
+                    window[index] = (slot >= 0 && slot < static_cast<int64_t>(truth.size())) ? truth[static_cast<size_t>(slot)] : noValue;
+                }
+            };
+        }
 
+        /**
+         * @brief MarkersWindow
+         * @param markers Values which are known to be true, indexed by slot id
+         * @return A function which fills a window with the values from markers
+         */
+        static std::function<void(int64_t, QubitList&)> MarkersWindow(const QubitsBySlot& markers)
+        {
+            return [&markers](int64_t firstSlot, QubitList& window)
+            {
+                std::fill(window.begin(), window.end(), noValue);
+                for(const auto& marker : markers)
+                {
+                    const auto index = static_cast<int64_t>(marker.first) - firstSlot;
+                    if(index >= 0 && index < static_cast<int64_t>(window.size()))
+                    {
+                        window[static_cast<size_t>(index)] = marker.second;
+                    }
+                }
+            };
         }
 
-        Offsetting::Confidence Offsetting::HighestValue(const QubitsBySlot markers, const std::vector<SlotID>& validSlots, const QubitList& irregular, int64_t from, int64_t to)
+        /**
+         * @brief PackedSpectra
+         * Transform the indicator of each pair of qubit values which share a basis,
+         * the even value is the real part and the odd value is the imaginary part.
+         * @param values The qubit values to transform, others are ignored
+         * @param count The number of values
+         * @param size The size of the transform
+         * @param used Which bases to transform
+         * @param[out] spectra The transform of each value
+         */
+        static void PackedSpectra(const Qubit* values, size_t count, size_t size,
+                                  const std::array<bool, numSymbols / 2>& used,
+                                  std::array<ComplexList, numSymbols>& spectra)
         {
-            std::mutex resultsMutex;
-            std::condition_variable resultsCv;
-            // counter to provide the next value in the sequence
-            std::atomic_long counter(from);
+            using namespace std;
+            ComplexList packed;
+            for(auto basis = 0u; basis < used.size(); basis++)
+            {
+                if(used[basis])
+                {
+                    packed.assign(size, 0.0);
+                    for(size_t index = 0; index < count; index++)
+                    {
+                        if(values[index] >> 1 == basis)
+                        {
+                            packed[index] = (values[index] & 1) ? Complex(0.0, 1.0) : Complex(1.0, 0.0);
+                        }
+                    }
+                    FFT(packed);
+
+                    // separate the two real transforms
+                    auto& even = spectra[basis * 2];
+                    auto& odd = spectra[basis * 2 + 1];
+                    even.resize(size);
+                    odd.resize(size);
+                    for(size_t index = 0; index < size; index++)
+                    {
+                        const auto mirror = conj(packed[(size - index) % size]);
+                        even[index] = (packed[index] + mirror) * 0.5;
+                        // divide by 2i
+                        const auto difference = packed[index] - mirror;
+                        odd[index] = Complex(difference.imag() * 0.5, difference.real() * -0.5);
+                    }
+                }
+            }
+        }
 
-            // result
-            Confidence highest {0.0, 0};
-            // the number of times the process will run
-            const size_t totalIterations = static_cast<size_t>(to - from + 1);
-            // the number of times the process has run
-            size_t numProcessed = 0;
+        Offsetting::Offsetting(size_t samples, Method method):
+            samples(samples), method(method)
+        {
 
-            // action to perform on every iteration, compare the values with an offset
-            auto processLambda = [&](int64_t offset)
+        }
+
+        std::vector<Offsetting::Confidence> Offsetting::Correlate(const TruthWindow& truthWindow, const std::vector<SlotID>& validSlots,
+                const QubitList& irregular, int64_t from, int64_t to,
+                size_t maxSamples, size_t numResults)
+        {
+            using namespace std;
+            vector<Confidence> best;
+
+            size_t numValues = min(irregular.size(), validSlots.size());
+            if(maxSamples > 0)
+            {
+                numValues = min(numValues, maxSamples);
+            }
+            if(numValues == 0 || to < from || numResults == 0)
             {
-                double confidence = CompareValues(markers, validSlots, irregular, offset);
+                return best;
+            }
+
+            // keep the transforms to a reasonable size
+            const SlotID firstSlot = validSlots[0];
+            numValues = static_cast<size_t>(distance(validSlots.cbegin(),
+                                            lower_bound(validSlots.cbegin(), validSlots.cbegin() + static_cast<ptrdiff_t>(numValues),
+                                                        firstSlot + MaxCorrelationSpan)));
+
+            // the values are placed by their slot relative to the first one
+            const size_t span = validSlots[numValues - 1] - firstSlot + 1;
+            const size_t numOffsets = static_cast<size_t>(to - from) + 1;
+            const size_t blockSize = min(numOffsets, max(span, minCorrelationBlock));
+            const size_t size = FFTSize(span + blockSize - 1);
+
+            QubitList window(size, noValue);
+            for(size_t index = 0; index < numValues; index++)
+            {
+                window[validSlots[index] - firstSlot] = irregular[index];
+            }
 
-                /*lock scope*/
+            array<bool, numSymbols / 2> used {};
+            for(const auto value : window)
+            {
+                if(value < numSymbols)
                 {
-                    std::lock_guard<std::mutex> lock(resultsMutex);
-                    numProcessed++;
-                    // store the value if it's the highest
-                    if(confidence > highest.value)
+                    used[value >> 1] = true;
+                }
+            }
+
+            array<ComplexList, numSymbols> irregularSpectra;
+            PackedSpectra(window.data(), window.size(), size, used, irregularSpectra);
+
+            array<ComplexList, numSymbols> truthSpectra;
+            ComplexList combined(size);
+
+            for(size_t blockStart = 0; blockStart < numOffsets; blockStart += blockSize)
+            {
+                const auto blockOffset = from + static_cast<int64_t>(blockStart);
+                truthWindow(static_cast<int64_t>(firstSlot) + blockOffset, window);
+                PackedSpectra(window.data(), window.size(), size, used, truthSpectra);
+
+                // the real part counts matching values and the imaginary part counts matching bases
+                fill(combined.begin(), combined.end(), 0.0);
+                for(auto basis = 0u; basis < used.size(); basis++)
+                {
+                    if(used[basis])
                     {
-                        highest.value = confidence;
-                        highest.offset = offset;
+                        const auto& truthEven = truthSpectra[basis * 2];
+                        const auto& truthOdd = truthSpectra[basis * 2 + 1];
+                        const auto& irregularEven = irregularSpectra[basis * 2];
+                        const auto& irregularOdd = irregularSpectra[basis * 2 + 1];
+                        for(size_t index = 0; index < size; index++)
+                        {
+                            const auto values = Multiply(truthEven[index], conj(irregularEven[index])) +
+                                                Multiply(truthOdd[index], conj(irregularOdd[index]));
+                            const auto bases = Multiply(truthEven[index] + truthOdd[index],
+                                                        conj(irregularEven[index] + irregularOdd[index]));
+                            // multiply by i
+                            combined[index] += values + Complex(-bases.imag(), bases.real());
+                        }
                     }
-                }/*lock scope*/
+                }
+                FFT(combined, true);
 
-                resultsCv.notify_one();
-            };
+                const size_t blockEnd = min(blockSize, numOffsets - blockStart);
+                for(size_t index = 0; index < blockEnd; index++)
+                {
+                    const auto validCount = round(combined[index].real());
+                    const auto basesMatched = round(combined[index].imag());
+                    // a few values at the edge of the range will often match by chance
+                    if(basesMatched >= MinBasesMatched)
+                    {
+                        const Confidence score {validCount / basesMatched, blockOffset + static_cast<int64_t>(index)};
+                        // keep the list sorted, best first, earliest offset first
+                        auto position = upper_bound(best.begin(), best.end(), score, [](const Confidence& left, const Confidence& right)
+                        {
+                            return left.value > right.value;
+                        });
+                        if(static_cast<size_t>(distance(best.begin(), position)) < numResults)
+                        {
+                            best.insert(position, score);
+                            if(best.size() > numResults)
+                            {
+                                best.pop_back();
+                            }
+                        }
+                    }
+                } // for each offset in the block
+            } // for each block
 
-            // function to return the next number in the sequence
-            auto nextValLambda = [&](int64_t& nextVal)
-            {
-                nextVal = counter.fetch_add(1);
-                return nextVal < to;
-            };
+            return best;
+        }
 
-            // start the process
-            rangeWorker.ProcessSequence(processLambda, nextValLambda);
+        std::vector<Offsetting::Confidence> Offsetting::Correlate(const QubitList& truth, const std::vector<SlotID>& validSlots,
+                const QubitList& irregular, int64_t from, int64_t to,
+                size_t maxSamples, size_t numResults)
+        {
+            return Correlate(ListWindow(truth), validSlots, irregular, from, to, maxSamples, numResults);
+        }
 
-            // wait for all the values to be processed
-            std::unique_lock<std::mutex> lock(resultsMutex);
-            resultsCv.wait(lock, [&]()
+        std::vector<Offsetting::Confidence> Offsetting::Correlate(const QubitsBySlot& markers, const std::vector<SlotID>& validSlots,
+                const QubitList& irregular, int64_t from, int64_t to,
+                size_t maxSamples, size_t numResults)
+        {
+            return Correlate(MarkersWindow(markers), validSlots, irregular, from, to, maxSamples, numResults);
+        }
+
+        Offsetting::Confidence Offsetting::Search(const TruthWindow& truthWindow, const CompareFunc& compare,
+                const std::vector<SlotID>& validSlots,
+                const QubitList& irregular, int64_t from, int64_t to)
+        {
+            Confidence highest {0.0, 0};
+            if(method == Method::Correlation)
             {
-                return numProcessed == totalIterations;
-            });
+                const auto best = Correlate(truthWindow, validSlots, irregular, from, to, samples, 1);
+                if(!best.empty())
+                {
+                    highest = best[0];
+                }
+                else
+                {
+                    // sparse values or a span wider than MaxCorrelationSpan leave too few to score
+                    highest = BruteForce(compare, from, to);
+                }
+            }
+            else
+            {
+                // a few values are enough to rule out most offsets
+                const size_t coarseSamples = samples > 0 ? std::min(samples, CoarseSamples) : CoarseSamples;
+                const auto candidates = Correlate(truthWindow, validSlots, irregular, from, to, coarseSamples, CoarseCandidates);
+                for(const auto& candidate : candidates)
+                {
+                    const double confidence = compare(candidate.offset);
+                    if(confidence > highest.value)
+                    {
+                        highest.value = confidence;
+                        highest.offset = candidate.offset;
+                    }
+                }
+
+                if(candidates.empty())
+                {
+                    highest = BruteForce(compare, from, to);
+                }
+            }
 
             return highest;
         }
 
-        Offsetting::Confidence Offsetting::HighestValue(const QubitList& truth, const std::vector<SlotID>& validSlots, const QubitList& irregular, int64_t from, int64_t to)
+        Offsetting::Confidence Offsetting::BruteForce(const CompareFunc& compare, int64_t from, int64_t to)
         {
             std::mutex resultsMutex;
             std::condition_variable resultsCv;
@@ -84,7 +290,7 @@ namespace cqp
             // action to perform on every iteration, compare the values with an offset
             auto processLambda = [&](int64_t offset)
             {
-                double confidence = CompareValues(truth, validSlots, irregular, offset);
+                double confidence = compare(offset);
 
                 /*lock scope*/
                 {
@@ -121,6 +327,36 @@ namespace cqp
             return highest;
         }
 
+        Offsetting::Confidence Offsetting::HighestValue(const QubitsBySlot markers, const std::vector<SlotID>& validSlots, const QubitList& irregular, int64_t from, int64_t to)
+        {
+            auto compare = [&](int64_t offset)
+            {
+                return CompareValues(markers, validSlots, irregular, offset);
+            };
+
+            if(method != Method::BruteForce)
+            {
+                return Search(MarkersWindow(markers), compare, validSlots, irregular, from, to);
+            }
+
+            return BruteForce(compare, from, to);
+        }
+
+        Offsetting::Confidence Offsetting::HighestValue(const QubitList& truth, const std::vector<SlotID>& validSlots, const QubitList& irregular, int64_t from, int64_t to)
+        {
+            auto compare = [&](int64_t offset)
+            {
+                return CompareValues(truth, validSlots, irregular, offset);
+            };
+
+            if(method != Method::BruteForce)
+            {
+                return Search(ListWindow(truth), compare, validSlots, irregular, from, to);
+            }
+
+            return BruteForce(compare, from, to);
+        }
+
         double Offsetting::CompareValues(const QubitList& truth, const std::vector<uint64_t>& validSlots,
                                          const QubitList& irregular,
                                          int64_t offset)
@@ -130,29 +366,28 @@ namespace cqp
             size_t validCount = 0;
             const size_t minSamples = 1u;
             // the number of elements to skip each time
-            const auto step = irregular.size() / std::max(minSamples, samples);
+            const auto step = std::max<size_t>(1u, irregular.size() / std::max(minSamples, samples));
             const auto numToCheck = irregular.size();
 
-            // step through a sample of values.
+            // gather the samples which are in range so they can be compared a word at a time
+            QubitList aliceSamples;
+            QubitList bobSamples;
+            aliceSamples.reserve(numToCheck / step + 1);
+            bobSamples.reserve(numToCheck / step + 1);
+
             for(uint64_t index = 0; index < numToCheck; index = index + step)
             {
                 const auto adjusted = offset + static_cast<int64_t>(validSlots[index]);
-                const auto& aliceQubit = truth[static_cast<size_t>(adjusted)];
-                const auto& bobQubit = irregular[index];
-
-                if(adjusted >= 0 && adjusted < static_cast<int64_t>(truth.size()) &&
-                        QubitHelper::Base(aliceQubit) == QubitHelper::Base(bobQubit))
+                if(adjusted >= 0 && adjusted < static_cast<int64_t>(truth.size()))
                 {
-                    // its within the range and the basis sent matches the basis measured
-                    basesMatched++;
-                    if(aliceQubit == bobQubit)
-                    {
-                        validCount++;
-                    }
+                    aliceSamples.push_back(truth[static_cast<size_t>(adjusted)]);
+                    bobSamples.push_back(irregular[index]);
                 }
-
             } // for each sample
 
+            // count the bases sent which match the bases measured and the values which match
+            PackedQubits::CountMatches(aliceSamples.data(), bobSamples.data(), aliceSamples.size(), basesMatched, validCount);
+
             confidence = static_cast<double>(validCount) / basesMatched;
 
             return confidence;
@@ -175,12 +410,13 @@ namespace cqp
                     // use a binary search to find the value
                     const auto bobIndex = lower_bound(validSlots.cbegin(), validSlots.cend(), adjustedSlot);
                     // this may return with a "close" match but not the value we're looking for
-                    if(bobIndex != validSlots.end() && *bobIndex < irregular.size() && *bobIndex == static_cast<SlotID>(adjustedSlot))
+                    const auto position = static_cast<size_t>(distance(validSlots.cbegin(), bobIndex));
+                    if(bobIndex != validSlots.end() && position < irregular.size() && *bobIndex == static_cast<SlotID>(adjustedSlot))
                     {
-                        if(QubitHelper::Base(marker.second) == QubitHelper::Base(irregular[*bobIndex]))
+                        if(QubitHelper::Base(marker.second) == QubitHelper::Base(irregular[position]))
                         {
                             basesMatched++;
-                            if(marker.second == irregular[*bobIndex])
+                            if(marker.second == irregular[position])
                             {
                                 validCount++;
                             } // if values match
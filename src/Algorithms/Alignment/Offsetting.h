@@ -1,6 +1,7 @@
 #pragma once
 #include "Algorithms/Datatypes/Qubits.h"
 #include "Algorithms/Util/RangeProcessing.h"
+#include <functional>
 
 namespace cqp {
     namespace align {
@@ -15,12 +16,33 @@ namespace cqp {
         public:
             /// The number of values to check in a data set
             static constexpr size_t DefaultSamples = 1000;
+            /// The number of values used to find candidates with Method::CoarseToFine
+            static constexpr size_t CoarseSamples = 512;
+            /// The number of candidates checked with Method::CoarseToFine
+            static constexpr size_t CoarseCandidates = 8;
+            /// The largest span of slots which will be correlated at once, this limits the memory used
+            static constexpr size_t MaxCorrelationSpan = 1u << 20;
+            /// Offsets which overlap so little that fewer bases than this match are not scored by Correlate
+            static constexpr size_t MinBasesMatched = 32;
+
+            /// How the offsets are searched
+            enum class Method
+            {
+                /// Call CompareValues for every offset, this is kept as a reference
+                BruteForce,
+                /// Score every offset at once with an FFT cross correlation,
+                /// offsets are checked one at a time if too few values overlap
+                Correlation,
+                /// Find candidates with a correlation of a few values then check them with CompareValues
+                CoarseToFine
+            };
 
             /**
              * @brief Offsetting
              * @param samples The number of values to check in a data set
+             * @param method How the offsets are searched
              */
-            explicit Offsetting(size_t samples = DefaultSamples);
+            explicit Offsetting(size_t samples = DefaultSamples, Method method = Method::BruteForce);
 
             /**
              * @brief The Confidence struct
@@ -36,6 +58,9 @@ namespace cqp {
             /**
              * @brief HighestValue
              * Find the best match between the two datasets.
+             * @details With Method::Correlation, up to samples values are taken from the start of
+             * irregular rather than spread over the whole list.
+             * validSlots must be in ascending order.
              * @param truth Values which are known to be true
              * @param validSlots The slots for The slot ids which the irregular values relate to
              * @param irregular The values which have an unknown validity and start offset
@@ -49,6 +74,7 @@ namespace cqp {
             /**
              * @brief HighestValue
              * Find the best match between the two datasets.
+             * @details validSlots must be in ascending order.
              * @param markers Values which are known to be true, indexed by slot id
              * @param validSlots The slots for The slot ids which the irregular values relate to
              * @param irregular The values which have an unknown validity and start offset
@@ -83,9 +109,95 @@ namespace cqp {
              */
             double CompareValues(const QubitsBySlot markers,  const std::vector<uint64_t>& validSlots,
                                  const QubitList& irregular, int64_t offset);
-        protected:
+
+            /**
+             * @brief Correlate
+             * Score every offset in the range with an FFT cross correlation of the values.
+             * The number of matching bases and values at each offset are counted by correlating each possible
+             * qubit value separately, two values are transformed at a time and summed before one inverse transform.
+             * @param truth Values which are known to be true
+             * @param validSlots The slot ids which the irregular values relate to, in ascending order
+             * @param irregular The values which have an unknown validity and start offset
+             * @param from The offset starting point
+             * @param to The offset end point
+             * @param maxSamples The number of irregular values to use, 0 for all of them
+             * @param numResults The number of offsets to return
+             * @return The highest scoring offsets, best first
+             */
+            std::vector<Confidence> Correlate(const QubitList& truth, const std::vector<SlotID>& validSlots,
+                                              const QubitList& irregular, int64_t from, int64_t to,
+                                              size_t maxSamples, size_t numResults = 1);
+
+            /**
+             * @brief Correlate
+             * Score every offset in the range with an FFT cross correlation of the values.
+             * @param markers Values which are known to be true, indexed by slot id
+             * @param validSlots The slot ids which the irregular values relate to, in ascending order
+             * @param irregular The values which have an unknown validity and start offset
+             * @param from The offset starting point
+             * @param to The offset end point
+             * @param maxSamples The number of irregular values to use, 0 for all of them
+             * @param numResults The number of offsets to return
+             * @return The highest scoring offsets, best first
+             */
+            std::vector<Confidence> Correlate(const QubitsBySlot& markers, const std::vector<SlotID>& validSlots,
+                                              const QubitList& irregular, int64_t from, int64_t to,
+                                              size_t maxSamples, size_t numResults = 1);
+        protected: // types
+            /// Fills the window with the known values from the first slot onwards, unknown values are set to 0xFF
+            using TruthWindow = std::function<void(int64_t firstSlot, QubitList& window)>;
+            /// Scores a single offset
+            using CompareFunc = std::function<double(int64_t offset)>;
+
+        protected: // methods
+
+            /**
+             * @brief Correlate
+             * Score every offset in the range with an FFT cross correlation of the values.
+             * @param truthWindow Provides the known values
+             * @param validSlots The slot ids which the irregular values relate to, in ascending order
+             * @param irregular The values which have an unknown validity and start offset
+             * @param from The offset starting point
+             * @param to The offset end point
+             * @param maxSamples The number of irregular values to use, 0 for all of them
+             * @param numResults The number of offsets to return
+             * @return The highest scoring offsets, best first
+             */
+            std::vector<Confidence> Correlate(const TruthWindow& truthWindow, const std::vector<SlotID>& validSlots,
+                                              const QubitList& irregular, int64_t from, int64_t to,
+                                              size_t maxSamples, size_t numResults);
+
+            /**
+             * @brief BruteForce
+             * Score every offset in the range with compare
+             * @param compare Scores a single offset
+             * @param from The offset starting point
+             * @param to The offset end point
+             * @return The highest scoring offset and its confidence value
+             */
+            Confidence BruteForce(const CompareFunc& compare, int64_t from, int64_t to);
+
+            /**
+             * @brief Search
+             * Perform a Correlation or CoarseToFine search, falling back to BruteForce when the
+             * correlation finds no offset with enough matching bases
+             * @param truthWindow Provides the known values
+             * @param compare Scores a single offset for the fine search
+             * @param validSlots The slot ids which the irregular values relate to, in ascending order
+             * @param irregular The values which have an unknown validity and start offset
+             * @param from The offset starting point
+             * @param to The offset end point
+             * @return The highest scoring offset and its confidence value
+             */
+            Confidence Search(const TruthWindow& truthWindow, const CompareFunc& compare,
+                              const std::vector<SlotID>& validSlots,
+                              const QubitList& irregular, int64_t from, int64_t to);
+
+        protected: // members
             /// The number of values to check in a data set
             size_t samples;
+            /// How the offsets are searched
+            Method method;
             /// process the different offsets
             RangeProcessing<int64_t> rangeWorker;
         };
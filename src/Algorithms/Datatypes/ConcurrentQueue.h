@@ -13,12 +13,16 @@
 #include <queue>
 #include <deque>
 #include <condition_variable>
+#include <mutex>
+#include <chrono>
 
 namespace cqp
 {
     /**
      * @brief The ConcurrentQueue class
      * thread save queue class with blocking pop and push
+     * @details This has no size limit, for bounded hand offs between threads
+     * SpscQueue and MpmcQueue avoid the lock.
      * @tparam T The storage data type
      * @tparam _Sequence The storage class which holds T
      */
@@ -50,7 +54,7 @@ namespace cqp
             if(waitResult)
             {
                 // extract the value
-                out = TheQueue::front();
+                out = std::move(TheQueue::front());
                 // remove the extracted item from the queue
                 TheQueue::pop();
             }
@@ -75,7 +79,7 @@ namespace cqp
             });
 
             // extract the value
-            T result = TheQueue::front();
+            T result = std::move(TheQueue::front());
             // remove the extracted item from the queue
             TheQueue::pop();
             return result;
@@ -97,6 +101,22 @@ namespace cqp
             dataAvailable.notify_one();
         }
 
+        /**
+         * @brief push
+         * Add an item to the queue without copying it
+         * @param value data to add
+         */
+        void push(T&& value)
+        {
+            // get a lock on the mutex
+            std::unique_lock<std::mutex> lock(changeMutex);
+            // add the data
+            TheQueue::push(std::move(value));
+            lock.unlock();
+            // release any waiting thread
+            dataAvailable.notify_one();
+        }
+
         /// Default Constructor
         ConcurrentQueue()=default;
         /// Copy constructor (disabled)
@@ -0,0 +1,48 @@
+/*!
+* @file
+* @brief DetectionFrame
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "DetectionFrame.h"
+
+namespace cqp
+{
+
+    DetectionFrame::DetectionFrame(const DetectionReportList& reports)
+    {
+        Append(reports.cbegin(), reports.cend());
+    }
+
+    void DetectionFrame::Append(DetectionReportList::const_iterator begin, DetectionReportList::const_iterator end)
+    {
+        const auto firstIndex = times.size();
+        const auto count = static_cast<size_t>(std::distance(begin, end));
+        times.resize(firstIndex + count);
+        values.resize(firstIndex + count);
+
+        for(size_t index = 0; index < count; index++)
+        {
+            times[firstIndex + index] = begin[static_cast<ptrdiff_t>(index)].time.count();
+            values[firstIndex + index] = begin[static_cast<ptrdiff_t>(index)].value;
+        }
+    } // Append
+
+    void DetectionFrame::ToReports(DetectionReportList& reports) const
+    {
+        const auto firstIndex = reports.size();
+        reports.resize(firstIndex + times.size());
+
+        for(size_t index = 0; index < times.size(); index++)
+        {
+            reports[firstIndex + index].time = PicoSeconds(times[index]);
+            reports[firstIndex + index].value = values[index];
+        }
+    } // ToReports
+
+} // namespace cqp
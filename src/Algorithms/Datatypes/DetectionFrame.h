@@ -0,0 +1,265 @@
+/*!
+* @file
+* @brief DetectionFrame
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#pragma once
+#include "Algorithms/algorithms_export.h"
+#include "Algorithms/Datatypes/DetectionReport.h"
+#include <cstdlib>
+#include <new>
+#include <vector>
+#if defined(_WIN32)
+    #include <malloc.h>
+#endif
+
+namespace cqp
+{
+
+    /**
+     * @brief The AlignedAllocator struct
+     * Allocates storage on a boundary suitable for wide vector loads
+     * @tparam T The type to allocate
+     * @tparam Alignment The alignment in bytes, must be a power of 2
+     */
+    template<typename T, size_t Alignment = 64>
+    struct AlignedAllocator
+    {
+        /// The type being allocated
+        using value_type = T;
+
+        /// Allows the container to allocate other types with the same alignment
+        template<typename U>
+        struct rebind
+        {
+            /// The allocator for U
+            using other = AlignedAllocator<U, Alignment>;
+        };
+
+        /// Default constructor
+        AlignedAllocator() noexcept = default;
+
+        /// Copy from an allocator of another type
+        template<typename U>
+        AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+        /**
+         * @brief allocate
+         * @param count The number of elements
+         * @return Storage for count elements
+         */
+        T* allocate(size_t count)
+        {
+            void* result = nullptr;
+#if defined(_WIN32)
+            result = _aligned_malloc(count * sizeof(T), Alignment);
+#else
+            if(posix_memalign(&result, Alignment, count * sizeof(T)) != 0)
+            {
+                result = nullptr;
+            }
+#endif
+            if(result == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+            return static_cast<T*>(result);
+        }
+
+        /**
+         * @brief deallocate
+         * @param data Storage returned by allocate
+         */
+        void deallocate(T* data, size_t) noexcept
+        {
+#if defined(_WIN32)
+            _aligned_free(data);
+#else
+            free(data);
+#endif
+        }
+    };
+
+    /// All aligned allocators are interchangeable
+    template<typename T, typename U, size_t Alignment>
+    bool operator==(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) noexcept
+    {
+        return true;
+    }
+
+    /// All aligned allocators are interchangeable
+    template<typename T, typename U, size_t Alignment>
+    bool operator!=(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) noexcept
+    {
+        return false;
+    }
+
+    /// The time of each detection in picoseconds
+    using TimeColumn = std::vector<PicoSeconds::rep, AlignedAllocator<PicoSeconds::rep>>;
+    /// The value of each detection
+    using ValueColumn = std::vector<Qubit, AlignedAllocator<Qubit>>;
+
+    /**
+     * @brief The DetectionFrame struct
+     * Detections stored as separate time and value columns.
+     * @details
+     * A DetectionReportList interleaves the time and value of each detection so a pass which only
+     * needs the times has to read the values as well. Keeping them apart lets each pass
+     * read only the column it needs and lets the compiler vectorise the time arithmetic.
+     * Use DetectionView to share the frame, or part of it, without copying.
+     */
+    struct ALGORITHMS_EXPORT DetectionFrame
+    {
+        /// The time of each detection, in ascending order
+        TimeColumn times;
+        /// The value of each detection, the same length as times
+        ValueColumn values;
+
+        /// Default constructor
+        DetectionFrame() = default;
+
+        /**
+         * @brief DetectionFrame
+         * Construct the frame from a list of detections
+         * @param reports The detections to copy
+         */
+        explicit DetectionFrame(const DetectionReportList& reports);
+
+        /// @return The number of detections
+        size_t size() const noexcept
+        {
+            return times.size();
+        }
+
+        /// @return true if there are no detections
+        bool empty() const noexcept
+        {
+            return times.empty();
+        }
+
+        /**
+         * @brief reserve
+         * Make room for detections without reallocating
+         * @param count The number of detections to make room for
+         */
+        void reserve(size_t count)
+        {
+            times.reserve(count);
+            values.reserve(count);
+        }
+
+        /// Remove all the detections
+        void clear() noexcept
+        {
+            times.clear();
+            values.clear();
+        }
+
+        /**
+         * @brief push_back
+         * Add a detection to the end of the frame
+         * @param time The time of the detection
+         * @param value The value of the detection
+         */
+        void push_back(PicoSeconds time, Qubit value)
+        {
+            times.push_back(time.count());
+            values.push_back(value);
+        }
+
+        /**
+         * @brief Append
+         * Add detections to the end of the frame
+         * @param begin The first detection to add
+         * @param end One past the last detection to add
+         */
+        void Append(DetectionReportList::const_iterator begin, DetectionReportList::const_iterator end);
+
+        /**
+         * @brief ToReports
+         * Convert the frame back to a list of detections
+         * @param[out] reports The detections will be appended to this
+         */
+        void ToReports(DetectionReportList& reports) const;
+    };
+
+    /**
+     * @brief The DetectionView struct
+     * A non-owning, read only view of some or all of a DetectionFrame.
+     * @details The frame must not be changed while the view is in use.
+     */
+    struct ALGORITHMS_EXPORT DetectionView
+    {
+        /// The time of each detection in picoseconds
+        const PicoSeconds::rep* times = nullptr;
+        /// The value of each detection
+        const Qubit* values = nullptr;
+        /// The number of detections
+        size_t count = 0;
+
+        /// Default constructor, the view is empty
+        DetectionView() = default;
+
+        /**
+         * @brief DetectionView
+         * View the columns of a frame
+         * @param frame The detections
+         */
+        DetectionView(const DetectionFrame& frame) noexcept :
+            times{frame.times.data()}, values{frame.values.data()}, count{frame.size()}
+        {
+        }
+
+        /**
+         * @brief DetectionView
+         * View some columns
+         * @param times The time of each detection in picoseconds
+         * @param values The value of each detection
+         * @param count The number of detections
+         */
+        DetectionView(const PicoSeconds::rep* times, const Qubit* values, size_t count) noexcept :
+            times{times}, values{values}, count{count}
+        {
+        }
+
+        /// @return The number of detections
+        size_t size() const noexcept
+        {
+            return count;
+        }
+
+        /// @return true if there are no detections
+        bool empty() const noexcept
+        {
+            return count == 0;
+        }
+
+        /**
+         * @brief Time
+         * @param index The detection to read
+         * @return The time of the detection
+         */
+        PicoSeconds Time(size_t index) const noexcept
+        {
+            return PicoSeconds(times[index]);
+        }
+
+        /**
+         * @brief Slice
+         * @param first The first detection to include
+         * @param last One past the last detection to include
+         * @return A view of part of this view
+         */
+        DetectionView Slice(size_t first, size_t last) const noexcept
+        {
+            return DetectionView(times + first, values + first, last - first);
+        }
+    };
+
+} // namespace cqp
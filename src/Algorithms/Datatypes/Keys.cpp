@@ -0,0 +1,64 @@
+/*!
+* @file
+* @brief Keys
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "Keys.h"
+#include <cstring>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define CQP_KEYS_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define CQP_KEYS_SSE2
+#endif
+
+namespace cqp
+{
+
+    void XorBytes(uint8_t* destination, const uint8_t* source, size_t length) noexcept
+    {
+        size_t index = 0;
+
+#if defined(CQP_KEYS_AVX2)
+        for(; index + sizeof(__m256i) <= length; index += sizeof(__m256i))
+        {
+            const __m256i left = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(destination + index));
+            const __m256i right = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + index));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + index), _mm256_xor_si256(left, right));
+        }
+#elif defined(CQP_KEYS_SSE2)
+        for(; index + sizeof(__m128i) <= length; index += sizeof(__m128i))
+        {
+            const __m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i*>(destination + index));
+            const __m128i right = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + index));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + index), _mm_xor_si128(left, right));
+        }
+#endif
+
+        // whole words, memcpy avoids unaligned access
+        for(; index + sizeof(uint64_t) <= length; index += sizeof(uint64_t))
+        {
+            uint64_t left;
+            uint64_t right;
+            std::memcpy(&left, destination + index, sizeof(left));
+            std::memcpy(&right, source + index, sizeof(right));
+            left ^= right;
+            std::memcpy(destination + index, &left, sizeof(left));
+        }
+
+        // the tail
+        for(; index < length; index++)
+        {
+            destination[index] ^= source[index];
+        }
+    } // XorBytes
+
+} // namespace cqp
@@ -13,6 +13,7 @@
 #include "Algorithms/Datatypes/Base.h"
 #include "Algorithms/Datatypes/Framing.h"
 #include "Algorithms/Datatypes/URI.h"
+#include <algorithm>
 #include <iomanip>
 #include <vector>
 
@@ -22,6 +23,30 @@ namespace cqp
     /// A sequence number for identifying individual keys
     using KeyID = uint64_t;
 
+    /**
+     * @brief XorBytes
+     * destination[i] ^= source[i] for each byte, using vector instructions where available
+     * @param destination The bytes to change
+     * @param source The bytes to xor with
+     * @param length The number of bytes to process
+     */
+    ALGORITHMS_EXPORT void XorBytes(uint8_t* destination, const uint8_t* source, size_t length) noexcept;
+
+    /**
+     * XOr a sequence of bytes into a data block, up to the length of the shorter one
+     * @tparam T A contiguous sequence of bytes
+     * @param destination The block to change
+     * @param source the bytes to xor with destination
+     * @return destination
+     */
+    template<typename T>
+    DataBlock& XorInto(DataBlock& destination, const T& source) noexcept
+    {
+        XorBytes(destination.data(), reinterpret_cast<const uint8_t*>(source.data()),
+                 std::min<size_t>(destination.size(), source.size()));
+        return destination;
+    }
+
     /// A pre shared key type
     class ALGORITHMS_EXPORT PSK : public DataBlock
     {
@@ -41,35 +66,7 @@ namespace cqp
          * @return this object
          */
         template<typename T>
-        PSK &operator ^=(const T& right) noexcept
-        {
-            // Tests were done with optimising this by using the full word width,
-            // no measurable improvement was found when running in release mode,
-            // for readability it is left to the compiler to optimise
-            /*
-             * const uint8_t bytesInWord = sizeof(size_t);
-             *
-             * if(size() % bytesInWord == 0)
-             * {
-             *     // do multi byte xor
-             *     const size_t maxIndex = size() / bytesInWord;
-             *     const size_t* rightBig = reinterpret_cast<const size_t*>(&right[0]);
-             *     size_t* resultBig = reinterpret_cast<size_t*>(&(*this)[0]);
-             *
-             *     for(size_t index = 0; index < maxIndex; index++)
-             *     {
-             *         resultBig[index] ^= rightBig[index];
-             *     }
-             * }
-             */
-            // do byte by byte
-            for(size_t index = 0; (index < size()) && (index < right.size()); index++)
-            {
-                (*this)[index] ^= static_cast<unsigned char>(right[index]);
-            }
-
-            return *this;
-        }
+        PSK &operator ^=(const T& right) noexcept;
 
         /**
          * @brief ToString
@@ -88,6 +85,13 @@ namespace cqp
         } // ToString
     }; // class PSK
 
+    template<typename T>
+    PSK& PSK::operator ^=(const T& right) noexcept
+    {
+        XorInto(*this, right);
+        return *this;
+    }
+
     /// Initialisation vector type for encryption algorithms
     using IV = DataBlock;
 
@@ -0,0 +1,718 @@
+/*!
+* @file
+* @brief LockFreeQueue
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+
+namespace cqp
+{
+    /// Size used to keep values which are changed by different threads apart
+    constexpr size_t cacheLineSize = 64;
+
+    /**
+     * @brief The QueueSignal class
+     * Lets a thread sleep until a queue changes.
+     * The mutex is only used when a thread is waiting, so the queue operations stay lock free
+     * while the consumer keeps up.
+     */
+    class QueueSignal
+    {
+    public:
+        /**
+         * @brief WaitFor
+         * Wait until ready returns true
+         * @param timeout How long to wait
+         * @param ready Checks the queue, called with the mutex held
+         * @return The result of ready
+         */
+        template<typename Predicate>
+        bool WaitFor(const std::chrono::microseconds& timeout, Predicate ready)
+        {
+            bool result = ready();
+            if(!result)
+            {
+                std::unique_lock<std::mutex> lock(waitMutex);
+                waiters.fetch_add(1);
+                // pairs with the fence in Notify, either we see the change or it sees us waiting
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                result = changed.wait_for(lock, timeout, ready);
+                waiters.fetch_sub(1);
+            }
+            return result;
+        }
+
+        /**
+         * @brief Notify
+         * Wake any waiting threads, call after changing the queue
+         */
+        void Notify()
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if(waiters.load(std::memory_order_relaxed) > 0)
+            {
+                /*lock scope*/
+                {
+                    // the waiter is either asleep or hasn't checked the queue yet
+                    std::lock_guard<std::mutex> lock(waitMutex);
+                }/*lock scope*/
+                changed.notify_all();
+            }
+        }
+
+    protected:
+        /// The number of threads in WaitFor
+        std::atomic<unsigned> waiters {0};
+        /// Only used when sleeping
+        std::mutex waitMutex;
+        /// Used to wake waiting threads
+        std::condition_variable changed;
+    };
+
+    /**
+     * @brief RoundUpPowerOf2
+     * @param value The value to round
+     * @return The smallest power of 2 which is >= value, at least 2
+     */
+    inline size_t RoundUpPowerOf2(size_t value) noexcept
+    {
+        size_t result = 2;
+        while(result < value)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    /**
+     * @brief The SpscQueue class
+     * A bounded queue for one producer thread and one consumer thread which doesn't lock.
+     * Elements are moved in and out so move only types such as std::unique_ptr can be used.
+     * @tparam T The element type
+     */
+    template<typename T>
+    class SpscQueue
+    {
+    public:
+        /**
+         * @brief SpscQueue
+         * Constructor
+         * @param capacity The number of elements which can be stored, rounded up to a power of 2
+         */
+        explicit SpscQueue(size_t capacity) :
+            mask{RoundUpPowerOf2(capacity) - 1},
+            storage{new Storage[mask + 1]}
+        {
+        }
+
+        /// Copy constructor (disabled)
+        SpscQueue(const SpscQueue&) = delete;
+        /**
+         * @brief operator =
+         * Assignment (disabled)
+         * @return this
+         */
+        SpscQueue& operator=(const SpscQueue&) = delete;
+
+        /// Destructor
+        ~SpscQueue()
+        {
+            for(size_t pos = tail.load(); pos != head.load(); pos++)
+            {
+                reinterpret_cast<T*>(&storage[pos & mask])->~T();
+            }
+        }
+
+        /**
+         * @brief capacity
+         * @return The number of elements which can be stored
+         */
+        size_t capacity() const noexcept
+        {
+            return mask + 1;
+        }
+
+        /**
+         * @brief size
+         * @return The number of elements stored, may be out of date by the time it is used
+         */
+        size_t size() const noexcept
+        {
+            return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief empty
+         * @return true if there was nothing in the queue
+         */
+        bool empty() const noexcept
+        {
+            return size() == 0;
+        }
+
+        /**
+         * @brief TryPush
+         * Add an element without waiting, producer only
+         * @param value The element to move into the queue, unchanged on failure
+         * @return false if the queue is full
+         */
+        bool TryPush(T&& value)
+        {
+            const size_t pos = head.load(std::memory_order_relaxed);
+            bool result = HasSpace(pos, 1);
+            if(result)
+            {
+                new(&storage[pos & mask]) T(std::move(value));
+                head.store(pos + 1, std::memory_order_release);
+                notEmpty.Notify();
+            }
+            return result;
+        }
+
+        /**
+         * @brief PushBatch
+         * Add as many elements as will fit without waiting, producer only
+         * @param values The first element to move into the queue
+         * @param count The number of elements available
+         * @return The number of elements added
+         */
+        template<typename Iterator>
+        size_t PushBatch(Iterator values, size_t count)
+        {
+            const size_t pos = head.load(std::memory_order_relaxed);
+            size_t added = 0;
+            while(added < count && HasSpace(pos + added, 1))
+            {
+                new(&storage[(pos + added) & mask]) T(std::move(*values));
+                ++values;
+                added++;
+            }
+
+            if(added > 0)
+            {
+                // publish them all at once
+                head.store(pos + added, std::memory_order_release);
+                notEmpty.Notify();
+            }
+            return added;
+        }
+
+        /**
+         * @brief Push
+         * Add an element, waiting for space if the queue is full, producer only
+         * @param value The element to move into the queue, unchanged on failure
+         * @param timeout How long to wait for space
+         * @return false if there was no space before the timeout
+         */
+        bool Push(T&& value, const std::chrono::microseconds& timeout)
+        {
+            bool result = TryPush(std::move(value));
+            if(!result)
+            {
+                const bool spaceAvailable = notFull.WaitFor(timeout, [&]()
+                {
+                    return HasSpace(head.load(std::memory_order_relaxed), 1);
+                });
+
+                if(spaceAvailable)
+                {
+                    result = TryPush(std::move(value));
+                }
+            }
+            return result;
+        }
+
+        /**
+         * @brief TryPop
+         * Remove the oldest element without waiting, consumer only
+         * @param[out] out The element, unchanged if the queue is empty
+         * @return false if the queue is empty
+         */
+        bool TryPop(T& out)
+        {
+            const size_t pos = tail.load(std::memory_order_relaxed);
+            bool result = HasData(pos, 1);
+            if(result)
+            {
+                T& element = *reinterpret_cast<T*>(&storage[pos & mask]);
+                out = std::move(element);
+                element.~T();
+                tail.store(pos + 1, std::memory_order_release);
+                notFull.Notify();
+            }
+            return result;
+        }
+
+        /**
+         * @brief PopBatch
+         * Remove up to maxCount of the oldest elements without waiting, consumer only
+         * @param out Where to move the elements to
+         * @param maxCount The maximum number of elements to remove
+         * @return The number of elements removed
+         */
+        template<typename OutputIterator>
+        size_t PopBatch(OutputIterator out, size_t maxCount)
+        {
+            const size_t pos = tail.load(std::memory_order_relaxed);
+            size_t removed = 0;
+            while(removed < maxCount && HasData(pos + removed, 1))
+            {
+                T& element = *reinterpret_cast<T*>(&storage[(pos + removed) & mask]);
+                *out = std::move(element);
+                ++out;
+                element.~T();
+                removed++;
+            }
+
+            if(removed > 0)
+            {
+                // release all the slots at once
+                tail.store(pos + removed, std::memory_order_release);
+                notFull.Notify();
+            }
+            return removed;
+        }
+
+        /**
+         * @brief Pop
+         * Remove the oldest element, waiting for one if the queue is empty, consumer only
+         * @param[out] out The element, unchanged on failure
+         * @param timeout How long to wait for an element
+         * @return false if nothing arrived before the timeout
+         */
+        bool Pop(T& out, const std::chrono::microseconds& timeout)
+        {
+            bool result = TryPop(out);
+            if(!result)
+            {
+                const bool dataAvailable = notEmpty.WaitFor(timeout, [&]()
+                {
+                    return HasData(tail.load(std::memory_order_relaxed), 1);
+                });
+
+                if(dataAvailable)
+                {
+                    result = TryPop(out);
+                }
+            }
+            return result;
+        }
+
+    protected:
+        /// Raw storage for an element
+        using Storage = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+        /**
+         * @brief HasSpace
+         * @param pos The position to write to
+         * @param count The number of elements needed
+         * @return true if count elements can be written at pos
+         */
+        bool HasSpace(size_t pos, size_t count)
+        {
+            if(pos + count - cachedTail > capacity())
+            {
+                // only read the consumers position when the cached value is used up
+                cachedTail = tail.load(std::memory_order_acquire);
+            }
+            return pos + count - cachedTail <= capacity();
+        }
+
+        /**
+         * @brief HasData
+         * @param pos The position to read from
+         * @param count The number of elements needed
+         * @return true if count elements can be read at pos
+         */
+        bool HasData(size_t pos, size_t count)
+        {
+            if(cachedHead - pos < count)
+            {
+                // only read the producers position when the cached value is used up
+                cachedHead = head.load(std::memory_order_acquire);
+            }
+            return cachedHead - pos >= count;
+        }
+
+        /// capacity - 1, used to wrap the positions
+        const size_t mask;
+        /// The elements
+        std::unique_ptr<Storage[]> storage;
+
+        /// @cond
+        char pad0[cacheLineSize];
+        /// @endcond
+        /// The next position to write, only changed by the producer
+        std::atomic<size_t> head {0};
+        /// The producers copy of tail
+        size_t cachedTail = 0;
+        /// @cond
+        char pad1[cacheLineSize];
+        /// @endcond
+        /// The next position to read, only changed by the consumer
+        std::atomic<size_t> tail {0};
+        /// The consumers copy of head
+        size_t cachedHead = 0;
+        /// @cond
+        char pad2[cacheLineSize];
+        /// @endcond
+
+        /// Wakes the consumer
+        QueueSignal notEmpty;
+        /// Wakes the producer
+        QueueSignal notFull;
+    }; // SpscQueue
+
+    /**
+     * @brief The MpmcQueue class
+     * A bounded queue for any number of producers and consumers which doesn't lock.
+     * Each slot has a sequence number which says whether it is ready to be written or read,
+     * threads claim a slot by advancing the shared position with a compare and swap.
+     * Elements are moved in and out so move only types such as std::unique_ptr can be used.
+     * @tparam T The element type
+     */
+    template<typename T>
+    class MpmcQueue
+    {
+    public:
+        /**
+         * @brief MpmcQueue
+         * Constructor
+         * @param capacity The number of elements which can be stored, rounded up to a power of 2
+         */
+        explicit MpmcQueue(size_t capacity) :
+            mask{RoundUpPowerOf2(capacity) - 1},
+            cells{new Cell[mask + 1]}
+        {
+            for(size_t index = 0; index <= mask; index++)
+            {
+                cells[index].sequence.store(index, std::memory_order_relaxed);
+            }
+        }
+
+        /// Copy constructor (disabled)
+        MpmcQueue(const MpmcQueue&) = delete;
+        /**
+         * @brief operator =
+         * Assignment (disabled)
+         * @return this
+         */
+        MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+        /// Destructor
+        ~MpmcQueue()
+        {
+            for(size_t pos = dequeuePos.load(); pos != enqueuePos.load(); pos++)
+            {
+                reinterpret_cast<T*>(&cells[pos & mask].storage)->~T();
+            }
+        }
+
+        /**
+         * @brief capacity
+         * @return The number of elements which can be stored
+         */
+        size_t capacity() const noexcept
+        {
+            return mask + 1;
+        }
+
+        /**
+         * @brief size
+         * @return The number of elements stored, may be out of date by the time it is used
+         */
+        size_t size() const noexcept
+        {
+            const size_t dequeued = dequeuePos.load(std::memory_order_acquire);
+            const size_t enqueued = enqueuePos.load(std::memory_order_acquire);
+            // the positions are read separately so they may cross
+            return enqueued > dequeued ? enqueued - dequeued : 0;
+        }
+
+        /**
+         * @brief empty
+         * @return true if there was nothing in the queue
+         */
+        bool empty() const noexcept
+        {
+            return size() == 0;
+        }
+
+        /**
+         * @brief TryPush
+         * Add an element without waiting
+         * @param value The element to move into the queue, unchanged on failure
+         * @return false if the queue is full
+         */
+        bool TryPush(T&& value)
+        {
+            const bool result = Enqueue(std::move(value));
+            if(result)
+            {
+                notEmpty.Notify();
+            }
+            return result;
+        }
+
+        /**
+         * @brief PushBatch
+         * Add as many elements as will fit without waiting, consumers are only woken once
+         * @param values The first element to move into the queue
+         * @param count The number of elements available
+         * @return The number of elements added
+         */
+        template<typename Iterator>
+        size_t PushBatch(Iterator values, size_t count)
+        {
+            size_t added = 0;
+            while(added < count && Enqueue(std::move(*values)))
+            {
+                ++values;
+                added++;
+            }
+            if(added > 0)
+            {
+                notEmpty.Notify();
+            }
+            return added;
+        }
+
+        /**
+         * @brief Push
+         * Add an element, waiting for space if the queue is full
+         * @param value The element to move into the queue, unchanged on failure
+         * @param timeout How long to wait for space
+         * @return false if there was no space before the timeout
+         */
+        bool Push(T&& value, const std::chrono::microseconds& timeout)
+        {
+            using namespace std::chrono;
+            const auto end = steady_clock::now() + timeout;
+            bool result = TryPush(std::move(value));
+            bool spaceAvailable = true;
+            // another producer may take the space so keep trying until the time runs out
+            while(!result && spaceAvailable)
+            {
+                spaceAvailable = notFull.WaitFor(duration_cast<microseconds>(end - steady_clock::now()), [&]()
+                {
+                    return size() < capacity();
+                });
+
+                if(spaceAvailable)
+                {
+                    result = TryPush(std::move(value));
+                }
+            }
+            return result;
+        }
+
+        /**
+         * @brief TryPop
+         * Remove the oldest element without waiting
+         * @param[out] out The element, unchanged if the queue is empty
+         * @return false if the queue is empty
+         */
+        bool TryPop(T& out)
+        {
+            const bool result = Dequeue(out);
+            if(result)
+            {
+                notFull.Notify();
+            }
+            return result;
+        }
+
+        /**
+         * @brief PopBatch
+         * Remove up to maxCount of the oldest elements without waiting, producers are only woken once
+         * @param out Where to move the elements to
+         * @param maxCount The maximum number of elements to remove
+         * @return The number of elements removed
+         */
+        template<typename OutputIterator>
+        size_t PopBatch(OutputIterator out, size_t maxCount)
+        {
+            size_t removed = 0;
+            T value;
+            while(removed < maxCount && Dequeue(value))
+            {
+                *out = std::move(value);
+                ++out;
+                removed++;
+            }
+            if(removed > 0)
+            {
+                notFull.Notify();
+            }
+            return removed;
+        }
+
+        /**
+         * @brief Pop
+         * Remove the oldest element, waiting for one if the queue is empty
+         * @param[out] out The element, unchanged on failure
+         * @param timeout How long to wait for an element
+         * @return false if nothing arrived before the timeout
+         */
+        bool Pop(T& out, const std::chrono::microseconds& timeout)
+        {
+            using namespace std::chrono;
+            const auto end = steady_clock::now() + timeout;
+            bool result = TryPop(out);
+            bool dataAvailable = true;
+            // another consumer may take the element so keep trying until the time runs out
+            while(!result && dataAvailable)
+            {
+                dataAvailable = notEmpty.WaitFor(duration_cast<microseconds>(end - steady_clock::now()), [&]()
+                {
+                    return size() > 0;
+                });
+
+                if(dataAvailable)
+                {
+                    result = TryPop(out);
+                }
+            }
+            return result;
+        }
+
+    protected:
+        /// A slot in the queue
+        struct Cell
+        {
+            /// equals the position when the cell can be written, position + 1 when it can be read
+            std::atomic<size_t> sequence;
+            /// Raw storage for the element
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+        };
+
+        /**
+         * @brief Enqueue
+         * @param value The element to move into the queue
+         * @return false if the queue is full
+         */
+        bool Enqueue(T&& value)
+        {
+            bool result = false;
+            size_t pos = enqueuePos.load(std::memory_order_relaxed);
+            Cell* cell = nullptr;
+            for(;;)
+            {
+                cell = &cells[pos & mask];
+                const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                const auto diff = static_cast<std::ptrdiff_t>(sequence - pos);
+                if(diff == 0)
+                {
+                    // the cell is free, try and claim it
+                    if(enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        result = true;
+                        break; // for
+                    }
+                }
+                else if(diff < 0)
+                {
+                    // the cell still holds an element from the last time around, the queue is full
+                    break; // for
+                }
+                else
+                {
+                    // another producer got there first
+                    pos = enqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+
+            if(result)
+            {
+                new(&cell->storage) T(std::move(value));
+                // make it available to consumers
+                cell->sequence.store(pos + 1, std::memory_order_release);
+            }
+            return result;
+        }
+
+        /**
+         * @brief Dequeue
+         * @param[out] out The element
+         * @return false if the queue is empty
+         */
+        bool Dequeue(T& out)
+        {
+            bool result = false;
+            size_t pos = dequeuePos.load(std::memory_order_relaxed);
+            Cell* cell = nullptr;
+            for(;;)
+            {
+                cell = &cells[pos & mask];
+                const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                const auto diff = static_cast<std::ptrdiff_t>(sequence - (pos + 1));
+                if(diff == 0)
+                {
+                    // the cell is full, try and claim it
+                    if(dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        result = true;
+                        break; // for
+                    }
+                }
+                else if(diff < 0)
+                {
+                    // nothing has been written to the cell yet, the queue is empty
+                    break; // for
+                }
+                else
+                {
+                    // another consumer got there first
+                    pos = dequeuePos.load(std::memory_order_relaxed);
+                }
+            }
+
+            if(result)
+            {
+                T& element = *reinterpret_cast<T*>(&cell->storage);
+                out = std::move(element);
+                element.~T();
+                // make it available to producers on the next time around
+                cell->sequence.store(pos + mask + 1, std::memory_order_release);
+            }
+            return result;
+        }
+
+        /// capacity - 1, used to wrap the positions
+        const size_t mask;
+        /// The elements
+        std::unique_ptr<Cell[]> cells;
+
+        /// @cond
+        char pad0[cacheLineSize];
+        /// @endcond
+        /// The next position to write
+        std::atomic<size_t> enqueuePos {0};
+        /// @cond
+        char pad1[cacheLineSize];
+        /// @endcond
+        /// The next position to read
+        std::atomic<size_t> dequeuePos {0};
+        /// @cond
+        char pad2[cacheLineSize];
+        /// @endcond
+
+        /// Wakes consumers
+        QueueSignal notEmpty;
+        /// Wakes producers
+        QueueSignal notFull;
+    }; // MpmcQueue
+
+} // namespace cqp
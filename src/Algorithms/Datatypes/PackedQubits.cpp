@@ -0,0 +1,282 @@
+/*!
+* @file
+* @brief PackedQubits
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "PackedQubits.h"
+#include <algorithm>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define CQP_QUBITS_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define CQP_QUBITS_SSE2
+#endif
+
+namespace cqp
+{
+    /// One in the bottom bit of every byte
+    static const uint64_t lowBits = 0x0101010101010101ull;
+    /// One in the top bit of every byte
+    static const uint64_t highBits = 0x8080808080808080ull;
+
+    /**
+     * @brief Load8
+     * @param bytes source
+     * @return 8 bytes as a little endian word
+     */
+    static inline uint64_t Load8(const Qubit* bytes) noexcept
+    {
+        uint64_t result = 0;
+        for(unsigned index = 0; index < 8; index++)
+        {
+            result |= static_cast<uint64_t>(bytes[index]) << (8 * index);
+        }
+        return result;
+    }
+
+    /**
+     * @brief GatherBits
+     * Collect one bit from each of 8 bytes
+     * @param word 8 bytes, the first in the least significant byte
+     * @param bit The bit to take from each byte
+     * @return The bits with the first byte in bit 0
+     */
+    static inline uint64_t GatherBits(uint64_t word, unsigned bit) noexcept
+    {
+        // the multiply moves the bit from byte n to bit 56 + n, no two products overlap
+        return (((word >> bit) & lowBits) * 0x0102040810204080ull) >> 56;
+    }
+
+    /**
+     * @brief NonZeroBytes
+     * @param word 8 bytes
+     * @return The top bit of each byte is set if that byte was not 0
+     */
+    static inline uint64_t NonZeroBytes(uint64_t word) noexcept
+    {
+        return (((word & ~highBits) + ~highBits) | word) & highBits;
+    }
+
+    /**
+     * @brief AppendBits
+     * Add bits to the end of a bit string
+     * @param dest The bits to add to, bits past destBits must be 0
+     * @param destBits The number of bits in dest
+     * @param source The bits to add, bits past sourceBits must be 0
+     * @param sourceBits The number of bits in source
+     */
+    static void AppendBits(PackedBits& dest, size_t destBits, const PackedBits& source, size_t sourceBits)
+    {
+        const size_t shift = destBits % bitsPerWord;
+        dest.resize((destBits + sourceBits + bitsPerWord - 1) / bitsPerWord, 0);
+        size_t outWord = destBits / bitsPerWord;
+
+        if(shift == 0)
+        {
+            std::copy(source.begin(), source.begin() + static_cast<std::ptrdiff_t>((sourceBits + bitsPerWord - 1) / bitsPerWord),
+                      dest.begin() + static_cast<std::ptrdiff_t>(outWord));
+        }
+        else
+        {
+            for(size_t word = 0; word < (sourceBits + bitsPerWord - 1) / bitsPerWord; word++)
+            {
+                dest[outWord] |= source[word] << shift;
+                outWord++;
+                if(outWord < dest.size())
+                {
+                    dest[outWord] = source[word] >> (bitsPerWord - shift);
+                }
+            }
+        }
+    }
+
+    PackedBits PackedQubits::ExtractPlane(const Qubit* qubits, size_t count, Plane plane)
+    {
+        const unsigned bit = static_cast<unsigned>(plane);
+        PackedBits result((count + bitsPerWord - 1) / bitsPerWord, 0);
+        size_t index = 0;
+
+#if defined(CQP_QUBITS_AVX2)
+        for(; index + 32 <= count; index += 32)
+        {
+            // move the wanted bit to the top of each byte, the bits shifted in from the byte below are ignored
+            const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(qubits + index));
+            const __m256i shifted = _mm256_slli_epi64(bytes, static_cast<int>(7 - bit));
+            const uint64_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(shifted));
+            result[index / bitsPerWord] |= mask << (index % bitsPerWord);
+        }
+#elif defined(CQP_QUBITS_SSE2)
+        for(; index + 16 <= count; index += 16)
+        {
+            // move the wanted bit to the top of each byte, the bits shifted in from the byte below are ignored
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(qubits + index));
+            const __m128i shifted = _mm_slli_epi64(bytes, static_cast<int>(7 - bit));
+            const uint64_t mask = static_cast<uint32_t>(_mm_movemask_epi8(shifted));
+            result[index / bitsPerWord] |= mask << (index % bitsPerWord);
+        }
+#endif
+        for(; index + 8 <= count; index += 8)
+        {
+            result[index / bitsPerWord] |= GatherBits(Load8(qubits + index), bit) << (index % bitsPerWord);
+        }
+        for(; index < count; index++)
+        {
+            result[index / bitsPerWord] |= static_cast<uint64_t>((qubits[index] >> bit) & 1u) << (index % bitsPerWord);
+        }
+
+        return result;
+    }
+
+    void PackedQubits::CountMatches(const Qubit* left, const Qubit* right, size_t count,
+                                    size_t& basesMatched, size_t& valuesMatched) noexcept
+    {
+        basesMatched = 0;
+        valuesMatched = 0;
+        size_t index = 0;
+
+#if defined(CQP_QUBITS_AVX2)
+        const __m256i basisBits = _mm256_set1_epi8(static_cast<char>(0x06));
+        const __m256i zero = _mm256_setzero_si256();
+        for(; index + 32 <= count; index += 32)
+        {
+            const __m256i diff = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(left + index)),
+                                                  _mm256_loadu_si256(reinterpret_cast<const __m256i*>(right + index)));
+            const __m256i basisEqual = _mm256_cmpeq_epi8(_mm256_and_si256(diff, basisBits), zero);
+            const __m256i valueEqual = _mm256_cmpeq_epi8(diff, zero);
+            basesMatched += PopCount(static_cast<uint32_t>(_mm256_movemask_epi8(basisEqual)));
+            valuesMatched += PopCount(static_cast<uint32_t>(_mm256_movemask_epi8(valueEqual)));
+        }
+#elif defined(CQP_QUBITS_SSE2)
+        const __m128i basisBits = _mm_set1_epi8(static_cast<char>(0x06));
+        const __m128i zero = _mm_setzero_si128();
+        for(; index + 16 <= count; index += 16)
+        {
+            const __m128i diff = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(left + index)),
+                                               _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + index)));
+            const __m128i basisEqual = _mm_cmpeq_epi8(_mm_and_si128(diff, basisBits), zero);
+            const __m128i valueEqual = _mm_cmpeq_epi8(diff, zero);
+            basesMatched += PopCount(static_cast<uint32_t>(_mm_movemask_epi8(basisEqual)));
+            valuesMatched += PopCount(static_cast<uint32_t>(_mm_movemask_epi8(valueEqual)));
+        }
+#endif
+        for(; index + 8 <= count; index += 8)
+        {
+            const uint64_t diff = Load8(left + index) ^ Load8(right + index);
+            basesMatched += 8u - PopCount(NonZeroBytes(diff & (lowBits * 0x06u)));
+            valuesMatched += 8u - PopCount(NonZeroBytes(diff));
+        }
+        for(; index < count; index++)
+        {
+            if(QubitHelper::Base(left[index]) == QubitHelper::Base(right[index]))
+            {
+                basesMatched++;
+                if(left[index] == right[index])
+                {
+                    valuesMatched++;
+                }
+            }
+        }
+    }
+
+    PackedQubits::PackedQubits(const QubitList& qubits)
+    {
+        Append(qubits.data(), qubits.size());
+    }
+
+    void PackedQubits::resize(size_t count)
+    {
+        const size_t words = (count + bitsPerWord - 1) / bitsPerWord;
+        values.resize(words, 0);
+        basisLow.resize(words, 0);
+        basisHigh.resize(words, 0);
+
+        if(count < numQubits && count % bitsPerWord != 0)
+        {
+            // keep the bits past the end clear
+            const uint64_t mask = (uint64_t(1) << (count % bitsPerWord)) - 1u;
+            values.back() &= mask;
+            basisLow.back() &= mask;
+            basisHigh.back() &= mask;
+        }
+        numQubits = count;
+    }
+
+    void PackedQubits::Append(const Qubit* qubits, size_t count)
+    {
+        AppendBits(values, numQubits, ExtractPlane(qubits, count, Plane::Value), count);
+        AppendBits(basisLow, numQubits, ExtractPlane(qubits, count, Plane::BasisLow), count);
+        AppendBits(basisHigh, numQubits, ExtractPlane(qubits, count, Plane::BasisHigh), count);
+        numQubits += count;
+    }
+
+    void PackedQubits::Set(size_t index, Qubit value) noexcept
+    {
+        const Qubit current = (*this)[index];
+        if((current ^ value) & 0x01)
+        {
+            FlipBit(values, index);
+        }
+        if((current ^ value) & 0x02)
+        {
+            FlipBit(basisLow, index);
+        }
+        if((current ^ value) & 0x04)
+        {
+            FlipBit(basisHigh, index);
+        }
+    }
+
+    QubitList PackedQubits::ToQubitList() const
+    {
+        QubitList result(numQubits);
+        for(size_t index = 0; index < numQubits; index++)
+        {
+            result[index] = (*this)[index];
+        }
+        return result;
+    }
+
+    PackedBits PackedQubits::BasisMask(Basis basis) const
+    {
+        const uint64_t lowFill = (static_cast<uint8_t>(basis) & 0x02) ? ~uint64_t(0) : 0;
+        const uint64_t highFill = (static_cast<uint8_t>(basis) & 0x04) ? ~uint64_t(0) : 0;
+        PackedBits result(values.size());
+
+        for(size_t word = 0; word < result.size(); word++)
+        {
+            result[word] = ~((basisLow[word] ^ lowFill) | (basisHigh[word] ^ highFill));
+        }
+
+        if(numQubits % bitsPerWord != 0)
+        {
+            result.back() &= (uint64_t(1) << (numQubits % bitsPerWord)) - 1u;
+        }
+        return result;
+    }
+
+    PackedBits PackedQubits::BasisMatches(const PackedQubits& other) const
+    {
+        const size_t count = std::min(numQubits, other.numQubits);
+        PackedBits result((count + bitsPerWord - 1) / bitsPerWord);
+
+        for(size_t word = 0; word < result.size(); word++)
+        {
+            result[word] = ~((basisLow[word] ^ other.basisLow[word]) | (basisHigh[word] ^ other.basisHigh[word]));
+        }
+
+        if(count % bitsPerWord != 0)
+        {
+            result.back() &= (uint64_t(1) << (count % bitsPerWord)) - 1u;
+        }
+        return result;
+    }
+
+} // namespace cqp
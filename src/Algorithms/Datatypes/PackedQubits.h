@@ -0,0 +1,177 @@
+/*!
+* @file
+* @brief PackedQubits
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#pragma once
+#include "Algorithms/algorithms_export.h"
+#include "Algorithms/Datatypes/Qubits.h"
+#include "Algorithms/Util/Bits.h"
+
+namespace cqp
+{
+
+    /**
+     * @brief The PackedQubits class
+     * A list of qubits stored as bit planes, one for the bit value and two for the basis,
+     * so that whole words of qubits can be tested at once.
+     * @details
+     * A QubitList uses a byte per qubit, this uses 3 bits. Bits past the end of the list are always 0.
+     */
+    class ALGORITHMS_EXPORT PackedQubits
+    {
+    public:
+        /// Which bit of a Qubit each plane stores
+        enum class Plane : uint8_t
+        {
+            Value = 0,
+            BasisLow = 1,
+            BasisHigh = 2
+        };
+
+        /**
+         * @brief PackedQubits
+         * Constructor
+         */
+        PackedQubits() = default;
+
+        /**
+         * @brief PackedQubits
+         * Construct from unpacked qubits
+         * @param qubits The qubits to store
+         */
+        explicit PackedQubits(const QubitList& qubits);
+
+        /**
+         * @brief size
+         * @return The number of qubits stored
+         */
+        size_t size() const noexcept
+        {
+            return numQubits;
+        }
+
+        /**
+         * @brief empty
+         * @return true if there are no qubits
+         */
+        bool empty() const noexcept
+        {
+            return numQubits == 0;
+        }
+
+        /**
+         * @brief resize
+         * Change the number of qubits, new qubits are BB84::Zero
+         * @param count The new length
+         */
+        void resize(size_t count);
+
+        /**
+         * @brief Append
+         * Add qubits to the end of the list
+         * @param qubits The first qubit to add
+         * @param count The number of qubits to add
+         */
+        void Append(const Qubit* qubits, size_t count);
+
+        /**
+         * @brief operator []
+         * @param index The qubit to get, must be less than size()
+         * @return The qubit at index
+         */
+        Qubit operator[](size_t index) const noexcept
+        {
+            return static_cast<Qubit>(GetBit(values, index) |
+                                      (GetBit(basisLow, index) << 1) |
+                                      (GetBit(basisHigh, index) << 2));
+        }
+
+        /**
+         * @brief BasisAt
+         * @param index The qubit to get, must be less than size()
+         * @return The basis of the qubit at index
+         */
+        Basis BasisAt(size_t index) const noexcept
+        {
+            return static_cast<Basis>((GetBit(basisLow, index) << 1) | (GetBit(basisHigh, index) << 2));
+        }
+
+        /**
+         * @brief Set
+         * Change one qubit
+         * @param index The qubit to change, must be less than size()
+         * @param value The new value
+         */
+        void Set(size_t index, Qubit value) noexcept;
+
+        /**
+         * @brief ToQubitList
+         * @return The qubits, one per byte
+         */
+        QubitList ToQubitList() const;
+
+        /**
+         * @brief Values
+         * @return The bit value of every qubit
+         */
+        const PackedBits& Values() const noexcept
+        {
+            return values;
+        }
+
+        /**
+         * @brief BasisMask
+         * @param basis The basis to look for
+         * @return A bit for each qubit, set if it is in basis
+         */
+        PackedBits BasisMask(Basis basis) const;
+
+        /**
+         * @brief BasisMatches
+         * Compare the bases of two lists
+         * @param other The list to compare with
+         * @return A bit for each qubit in the shorter list, set if the bases are the same
+         */
+        PackedBits BasisMatches(const PackedQubits& other) const;
+
+        /**
+         * @brief ExtractPlane
+         * Collect one bit of each qubit into a bit string
+         * @param qubits The first qubit
+         * @param count The number of qubits
+         * @param plane Which bit to collect
+         * @return The bits, least significant bit first, bits past count are 0
+         */
+        static PackedBits ExtractPlane(const Qubit* qubits, size_t count, Plane plane);
+
+        /**
+         * @brief CountMatches
+         * Compare two lists of unpacked qubits
+         * @param left The first list
+         * @param right The second list
+         * @param count The number of qubits in each list
+         * @param[out] basesMatched The number of qubits with the same basis
+         * @param[out] valuesMatched The number of qubits which are identical
+         */
+        static void CountMatches(const Qubit* left, const Qubit* right, size_t count,
+                                 size_t& basesMatched, size_t& valuesMatched) noexcept;
+
+    protected:
+        /// The number of qubits stored
+        size_t numQubits = 0;
+        /// Bit 0 of each qubit
+        PackedBits values;
+        /// Bit 1 of each qubit
+        PackedBits basisLow;
+        /// Bit 2 of each qubit
+        PackedBits basisHigh;
+    }; // PackedQubits
+
+} // namespace cqp
@@ -84,7 +84,7 @@ namespace cqp
     }; // Qubit
 
     /// A list of Qubits
-    /// @todo override the vector functions to improve storage performance
+    /// @see PackedQubits for a compact form which can be processed a word at a time
     using QubitList = std::vector<Qubit>;
 
     /// A dictionary of QubitLists indexed by SequenceNumber
@@ -10,14 +10,13 @@
 * @author Richard Collins <richard.collins@bristol.ac.uk>
 */
 #pragma once
-#include <mutex>
-#include <condition_variable>
-#include <array>
+#include "Algorithms/Datatypes/LockFreeQueue.h"
 #include <chrono>
 
 namespace cqp
 {
     /// A blocking buffer which has a fixed size. Callers are blocked until the action can be performed
+    /// @details The storage is an MpmcQueue so Max is rounded up to a power of 2
     template<class T, size_t Max>
     class RingBuffer
     {
@@ -28,7 +27,7 @@ namespace cqp
         /// @return true if the buffer is full
         bool IsFull()
         {
-            return numElements == Max;
+            return buffer.size() >= buffer.capacity();
         }
 
         /// Add an item to the buffer, will block until a space is available or until tel_time timeout
@@ -37,37 +36,8 @@ namespace cqp
         /// @return true if the item was sucessfull added to the buffer
         bool Push(const T& in, const std::chrono::microseconds& rel_time)
         {
-            bool result = false;
-            // Lock the continous variable so that it can be checked
-            std::unique_lock<std::mutex> lock(fullCVLock);
-            // Wait for space to add more elements
-            bool spaceAvailable = fullCV.wait_for(lock, rel_time, [&]()
-            {
-                return (numElements < Max);
-            });
-
-            if(spaceAvailable)
-            {
-                {
-                    // Get a lock on the buffer it's self
-                    std::lock_guard<std::mutex> lock(changeMutex);
-                    // Store the data
-                    buffer[head] = in;
-                    // Move the head pointer, acounting for wrapping
-                    head++;
-                    if (head >= Max)
-                    {
-                        head = 0;
-                    }
-
-                    numElements++;
-                    result = true;
-                }
-                // If anything is waiting for the buffer to become non-empty, this will wake them up.
-                emptyCV.notify_one();
-            }
-
-            return result;
+            T value(in);
+            return buffer.Push(std::move(value), rel_time);
         }
 
         /// Push data onto the buffer.
@@ -76,8 +46,9 @@ namespace cqp
         void Push(const T& in)
         {
             using namespace std::chrono;
-            // repeatly call push until it succeeds
-            while(!Push(in, microseconds(10)));
+            T value(in);
+            // sleeps until space is available
+            while(!buffer.Push(std::move(value), seconds(1)));
         }
 
         /// Return a item from the buffer
@@ -85,47 +56,16 @@ namespace cqp
         /// @return the data removed from the buffer
         T Pop()
         {
-            // lock for the continous varuable
-            std::unique_lock<std::mutex> lock(emptyCVLock);
-            // Wait until there are some elements to extract
-            emptyCV.wait(lock, [&]()
-            {
-                return numElements > 0;
-            });
-
+            using namespace std::chrono;
             T result;
-
-            {
-                // Lock the buffer
-                std::lock_guard<std::mutex> lock(changeMutex);
-                // extract the value
-                result = buffer[tail];
-                tail++;
-                if (tail >= Max)
-                {
-                    tail = 0;
-                }
-                numElements--;
-            }
-            // Notify any waiting push calls that there is now room for one more.
-            fullCV.notify_one();
+            // sleeps until an element is available
+            while(!buffer.Pop(result, seconds(1)));
 
             return result;
         }
 
     protected:
         /// The storage for the data
-        std::array<T, Max> buffer {};
-
-        /// @cond
-        std::mutex changeMutex;
-        std::mutex emptyCVLock;
-        std::mutex fullCVLock;
-        std::condition_variable emptyCV;
-        std::condition_variable fullCV;
-        size_t head = 0;
-        size_t tail = 0;
-        size_t numElements = 0;
-        /// @endcond
+        MpmcQueue<T> buffer {Max};
     };
 }
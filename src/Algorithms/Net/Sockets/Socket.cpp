@@ -25,6 +25,7 @@
     #include <netdb.h>
     #include <arpa/inet.h>
     #include <fcntl.h>
+    #include <poll.h>
 #elif defined(WIN32)
     #include <Winsock2.h>
     #include <ws2tcpip.h>
@@ -418,5 +419,104 @@ namespace cqp
             return result;
         }
 
+        bool Socket::ReadMany(std::vector<PacketBuffer>& packets, size_t& packetsReceived)
+        {
+            bool result = false;
+            packetsReceived = 0;
+#if defined(__linux)
+            std::vector<struct iovec> buffers(packets.size());
+            std::vector<struct mmsghdr> headers(packets.size());
+            for(size_t index = 0; index < packets.size(); index++)
+            {
+                buffers[index].iov_base = packets[index].data;
+                buffers[index].iov_len = packets[index].length;
+                headers[index].msg_hdr.msg_iov = &buffers[index];
+                headers[index].msg_hdr.msg_iovlen = 1;
+            }
+
+            // block for the first packet, then take whatever else is already queued
+            int received = ::recvmmsg(handle, headers.data(), static_cast<unsigned int>(headers.size()), MSG_WAITFORONE, nullptr);
+            if(received >= 0)
+            {
+                packetsReceived = static_cast<size_t>(received);
+                for(size_t index = 0; index < packetsReceived; index++)
+                {
+                    packets[index].bytes = headers[index].msg_len;
+                }
+                result = true;
+            }
+            else if(errno == EAGAIN || errno == EINTR)
+            {
+                // timeout
+                result = true;
+            }
+            else
+            {
+                LOGERROR("Socket Error:" + std::to_string(errno) + " " +  ::strerror(errno));
+            }
+#else
+            if(!packets.empty())
+            {
+                result = Read(packets[0].data, packets[0].length, packets[0].bytes);
+                if(result && packets[0].bytes > 0)
+                {
+                    packetsReceived = 1;
+                }
+            }
+#endif
+            return result;
+        }
+
+        bool Socket::WriteMany(const std::vector<PacketBuffer>& packets, size_t numPackets)
+        {
+            bool result = true;
+            numPackets = std::min(numPackets, packets.size());
+#if defined(__linux)
+            std::vector<struct iovec> buffers(numPackets);
+            std::vector<struct mmsghdr> headers(numPackets);
+            for(size_t index = 0; index < numPackets; index++)
+            {
+                buffers[index].iov_base = packets[index].data;
+                buffers[index].iov_len = packets[index].bytes;
+                headers[index].msg_hdr.msg_iov = &buffers[index];
+                headers[index].msg_hdr.msg_iovlen = 1;
+            }
+
+            size_t sent = 0;
+            while(result && sent < numPackets)
+            {
+                // the kernel may not take all of them in one go
+                int sentThisTime = ::sendmmsg(handle, &headers[sent], static_cast<unsigned int>(numPackets - sent), 0);
+                if(sentThisTime > 0)
+                {
+                    sent += static_cast<size_t>(sentThisTime);
+                }
+                else if(sentThisTime < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                {
+                    // non-blocking and the buffers are full, wait until the rest can be sent
+                    struct pollfd waitFor {};
+                    waitFor.fd = handle;
+                    waitFor.events = POLLOUT;
+                    if(::poll(&waitFor, 1, -1) < 0 && errno != EINTR)
+                    {
+                        LOGERROR(::strerror(errno));
+                        result = false;
+                    }
+                }
+                else if(sentThisTime == 0 || errno != EINTR)
+                {
+                    LOGERROR(::strerror(errno));
+                    result = false;
+                }
+            }
+#else
+            for(size_t index = 0; result && index < numPackets; index++)
+            {
+                result = Write(packets[index].data, packets[index].bytes);
+            }
+#endif
+            return result;
+        }
+
     } // namespace net
 } // namespace cqp
@@ -15,6 +15,7 @@
 #include <array>
 #include <memory>
 #include <string>
+#include <vector>
 
 struct sockaddr;
 struct sockaddr_storage;
@@ -203,6 +204,20 @@ namespace cqp
             return !(lhs == rhs);
         }
 
+        /**
+         * @brief The PacketBuffer struct
+         * Storage for one packet when sending or receiving many at once
+         */
+        struct ALGORITHMS_EXPORT PacketBuffer
+        {
+            /// The packet data
+            void* data = nullptr;
+            /// The size of the storage pointed to by data
+            size_t length = 0;
+            /// The number of bytes in the packet
+            size_t bytes = 0;
+        };
+
         /**
          * @brief The Socket class
          * Provides access to network sockets
@@ -280,6 +295,26 @@ namespace cqp
              */
             bool Write(const void* data, size_t length);
 
+            /**
+             * @brief ReadMany
+             * Read several packets with one system call. Waits until at least one packet is available
+             * then returns any others which are already waiting.
+             * @param[in,out] packets Destinations for the packets, bytes is set for each packet received
+             * @param[out] packetsReceived The number of packets read, 0 if the read timed out
+             * @return true on success
+             */
+            bool ReadMany(std::vector<PacketBuffer>& packets, size_t& packetsReceived);
+
+            /**
+             * @brief WriteMany
+             * Send several packets with as few system calls as possible.
+             * Returns once all the packets have been sent, even if the socket is not blocking.
+             * @param packets The packets to send, the first bytes of each one is sent
+             * @param numPackets The number of packets to send from the start of packets
+             * @return true on success
+             */
+            bool WriteMany(const std::vector<PacketBuffer>& packets, size_t numPackets);
+
         protected:
             /// The device handle
             int handle = 0;
@@ -0,0 +1,155 @@
+/*!
+* @file
+* @brief Bits
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "Algorithms/Datatypes/Base.h"
+
+namespace cqp
+{
+    /// Storage for a bit string, 64 bits at a time
+    using PackedBits = std::vector<uint64_t>;
+
+    /// number of bits in each element of PackedBits
+    constexpr size_t bitsPerWord = 64;
+
+    /**
+     * @brief PopCount
+     * @param value word to count
+     * @return The number of bits set in value
+     */
+    inline uint_fast8_t PopCount(uint64_t value) noexcept
+    {
+#if defined(__GNUC__)
+        return static_cast<uint_fast8_t>(__builtin_popcountll(value));
+#else
+        value = value - ((value >> 1) & 0x5555555555555555ull);
+        value = (value & 0x3333333333333333ull) + ((value >> 2) & 0x3333333333333333ull);
+        value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+        return static_cast<uint_fast8_t>((value * 0x0101010101010101ull) >> 56);
+#endif
+    }
+
+    /**
+     * @brief Parity
+     * @param value word to check
+     * @return true if an odd number of bits are set
+     */
+    inline bool Parity(uint64_t value) noexcept
+    {
+#if defined(__GNUC__)
+        return __builtin_parityll(value) != 0;
+#else
+        return (PopCount(value) & 1u) != 0;
+#endif
+    }
+
+    /**
+     * @brief GetBit
+     * @param bits packed bit string
+     * @param index bit to read
+     * @return the value of the bit
+     */
+    inline bool GetBit(const PackedBits& bits, size_t index) noexcept
+    {
+        return (bits[index / bitsPerWord] >> (index % bitsPerWord)) & 1u;
+    }
+
+    /**
+     * @brief FlipBit
+     * Invert a single bit
+     * @param bits packed bit string
+     * @param index bit to change
+     */
+    inline void FlipBit(PackedBits& bits, size_t index) noexcept
+    {
+        bits[index / bitsPerWord] ^= uint64_t(1) << (index % bitsPerWord);
+    }
+
+    /**
+     * @brief RangeParity
+     * Calculate the parity of a contiguous range of bits by folding whole words together
+     * @param bits packed bit string
+     * @param start first bit in the range
+     * @param length number of bits in the range
+     * @return true if an odd number of bits are set in the range
+     */
+    inline bool RangeParity(const PackedBits& bits, size_t start, size_t length) noexcept
+    {
+        uint64_t folded = 0;
+        if(length > 0)
+        {
+            const size_t end = start + length;
+            const size_t firstWord = start / bitsPerWord;
+            const size_t lastWord = (end - 1) / bitsPerWord;
+            const uint64_t firstMask = ~uint64_t(0) << (start % bitsPerWord);
+            const uint64_t lastMask = ~uint64_t(0) >> (bitsPerWord - 1 - ((end - 1) % bitsPerWord));
+
+            if(firstWord == lastWord)
+            {
+                folded = bits[firstWord] & firstMask & lastMask;
+            }
+            else
+            {
+                folded = (bits[firstWord] & firstMask) ^ (bits[lastWord] & lastMask);
+                for(size_t word = firstWord + 1; word < lastWord; word++)
+                {
+                    folded ^= bits[word];
+                }
+            }
+        }
+        return Parity(folded);
+    }
+
+    /**
+     * @brief PackBits
+     * Convert a byte packed bit string, least significant bit first, into words
+     * @param data source bits
+     * @return The bits of data, the unused bits at the end are 0
+     */
+    inline PackedBits PackBits(const JaggedDataBlock& data)
+    {
+        PackedBits result((data.NumBits() + bitsPerWord - 1) / bitsPerWord, 0);
+        const size_t numBits = data.NumBits();
+        for(size_t index = 0; index < data.size(); index++)
+        {
+            uint64_t byte = data[index];
+            if(index == data.size() - 1 && numBits % 8 != 0)
+            {
+                // mask off the invalid bits
+                byte &= (1u << (numBits % 8)) - 1u;
+            }
+            result[index / sizeof(uint64_t)] |= byte << (8 * (index % sizeof(uint64_t)));
+        }
+        return result;
+    }
+
+    /**
+     * @brief UnpackBits
+     * Convert words back into a byte packed bit string
+     * @param bits source bits
+     * @param numBits The number of valid bits in bits
+     * @return the bits as bytes, least significant bit first
+     */
+    inline JaggedDataBlock UnpackBits(const PackedBits& bits, size_t numBits)
+    {
+        JaggedDataBlock result;
+        result.resize((numBits + 7) / 8);
+        for(size_t index = 0; index < result.size(); index++)
+        {
+            result[index] = static_cast<uint8_t>(bits[index / sizeof(uint64_t)] >> (8 * (index % sizeof(uint64_t))));
+        }
+        result.bitsInLastByte = static_cast<uint8_t>(numBits % 8);
+        return result;
+    }
+} // namespace cqp
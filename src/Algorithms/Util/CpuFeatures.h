@@ -0,0 +1,57 @@
+/*!
+* @file
+* @brief CpuFeatures
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#pragma once
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    /// Functions can be built for instruction sets which the rest of the build doesn't assume
+    #define CQP_CPU_DISPATCH
+    /// Build a function for extra instruction sets, eg CQP_CPU_TARGET("avx2")
+    #define CQP_CPU_TARGET(features) __attribute__((target(features)))
+#endif
+
+namespace cqp
+{
+    namespace cpu
+    {
+        /**
+         * @brief HasAvx2
+         * @return true if AVX2 instructions can be used on this machine
+         */
+        inline bool HasAvx2() noexcept
+        {
+#if defined(__AVX2__)
+            return true;
+#elif defined(CQP_CPU_DISPATCH)
+            static const bool result = __builtin_cpu_supports("avx2") != 0;
+            return result;
+#else
+            return false;
+#endif
+        }
+
+        /**
+         * @brief HasBmi2
+         * @return true if BMI2 instructions, such as pext, can be used on this machine
+         */
+        inline bool HasBmi2() noexcept
+        {
+#if defined(__BMI2__)
+            return true;
+#elif defined(CQP_CPU_DISPATCH)
+            static const bool result = __builtin_cpu_supports("bmi2") != 0;
+            return result;
+#else
+            return false;
+#endif
+        }
+    } // namespace cpu
+} // namespace cqp
@@ -1,53 +1,136 @@
 #include "DataFile.h"
 #include <fstream>
 #include "Algorithms/Logging/Logger.h"
+#include "Algorithms/Util/MappedFile.h"
+#include "Algorithms/Util/PortableEndian.h"
 #include <chrono>
 #include <cmath>
+#include <cstring>
+#include <future>
+#include <thread>
 #if defined(WIN32)
-    #include "Algorithms/Util/PortableEndian.h"
     #include <windows.h>
 #endif
 
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define CQP_NOX_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define CQP_NOX_SSE2
+#endif
+
 namespace cqp
 {
     namespace fs
     {
 
+        size_t DataFile::minBytesPerThread = 4 * 1024 * 1024;
+        size_t DataFile::maxThreads = 0;
+
+        /**
+         * @brief ChunkBounds
+         * Split a list of items between threads
+         * @param count The number of items
+         * @param itemBytes The size of each item in the file
+         * @return The start of each chunk followed by the end of the last chunk
+         */
+        static std::vector<size_t> ChunkBounds(size_t count, size_t itemBytes)
+        {
+            using namespace std;
+            const size_t threads = DataFile::maxThreads != 0 ? DataFile::maxThreads : thread::hardware_concurrency();
+            const size_t numChunks = max<size_t>(1, min<size_t>(threads,
+                                                 count * itemBytes / max<size_t>(1, DataFile::minBytesPerThread)));
+            vector<size_t> bounds(numChunks + 1);
+            for(auto chunk = 0u; chunk <= numChunks; chunk++)
+            {
+                bounds[chunk] = count * chunk / numChunks;
+            }
+            return bounds;
+        }
+
+        /**
+         * @brief ProcessChunks
+         * Call action for each chunk, using a thread for each one
+         * @param numChunks The number of chunks
+         * @param action Function taking the chunk number
+         */
+        template<typename Action>
+        static void ProcessChunks(size_t numChunks, Action action)
+        {
+            using namespace std;
+            vector<future<void>> tasks;
+            for(auto chunk = 1u; chunk < numChunks; chunk++)
+            {
+                tasks.emplace_back(async(launch::async, action, chunk));
+            }
+            action(0);
+
+            for(auto& task : tasks)
+            {
+                task.get();
+            }
+        }
+
+        void DataFile::UnpackQubits(const std::vector<Qubit>& channelMappings, const uint8_t* data, size_t count, Qubit* output)
+        {
+            // the four qubits for every possible byte, the first qubit is in the top bits
+            Qubit table[256][4];
+            for(unsigned packed = 0; packed < 256; packed++)
+            {
+                table[packed][0] = channelMappings[(packed & 0b11000000) >> 6];
+                table[packed][1] = channelMappings[(packed & 0b00110000) >> 4];
+                table[packed][2] = channelMappings[(packed & 0b00001100) >> 2];
+                table[packed][3] = channelMappings[packed & 0b00000011];
+            }
+
+            const size_t wholeBytes = count / 4;
+            for(size_t index = 0; index < wholeBytes; index++)
+            {
+                std::memcpy(output + index * 4, table[data[index]], 4);
+            }
+
+            // a partial byte at the end
+            if(count % 4 != 0)
+            {
+                std::memcpy(output + wholeBytes * 4, table[data[wholeBytes]], count % 4);
+            }
+        } // UnpackQubits
+
         bool DataFile::ReadPackedQubits(const std::string& inFileName, QubitList& output, uint64_t maxValues,
                                         const std::vector<Qubit>& channelMappings)
         {
-            bool result = true;
-            std::ifstream inFile(inFileName, std::ios::in | std::ios::binary);
-            if (inFile)
+            bool result = false;
+            MappedFile inFile;
+            if(channelMappings.size() < 4)
+            {
+                LOGERROR("Packed qubits need 4 channel mappings");
+            }
+            else if (inFile.Open(inFileName))
             {
                 // qubits packed 4/byte
-                inFile.seekg(0, std::ios::end);
-                auto qubitsToGet = static_cast<uint64_t>(inFile.tellg() * 4);
+                auto qubitsToGet = static_cast<uint64_t>(inFile.size()) * 4;
                 if(maxValues != 0)
                 {
                     qubitsToGet = std::min(maxValues, qubitsToGet);
                 }
-                inFile.seekg(0, std::ios::beg);
-                output.reserve(qubitsToGet);
 
-                while(!inFile.eof() && output.size() < qubitsToGet)
+                const size_t start = output.size();
+                output.resize(start + qubitsToGet);
+
+                // split on whole bytes
+                const auto bounds = ChunkBounds(qubitsToGet / 4, 1);
+                ProcessChunks(bounds.size() - 1, [&](size_t chunk)
                 {
-                    char packedQubits;
-                    inFile.read(&packedQubits, sizeof (packedQubits));
-                    // shift each pair of bits to LSB and store in the output
-                    output.push_back(channelMappings[(packedQubits & 0b11000000) >> 6]);
-                    output.push_back(channelMappings[(packedQubits & 0b00110000) >> 4]);
-                    output.push_back(channelMappings[(packedQubits & 0b00001100) >> 2]);
-                    output.push_back(channelMappings[packedQubits & 0b00000011]);
-                }
-                inFile.close();
+                    const size_t first = bounds[chunk] * 4;
+                    // the last chunk picks up any partial byte
+                    const size_t last = (chunk == bounds.size() - 2) ? qubitsToGet : bounds[chunk + 1] * 4;
+                    UnpackQubits(channelMappings, inFile.data() + bounds[chunk], last - first, output.data() + start + first);
+                });
+
                 LOGDEBUG("Loaded " + std::to_string(output.size()) + " Qubits.");
                 result = true;
             }
-            else
-            {
-                LOGERROR("Failed to open " + inFileName);
-            }
 
             return result;
         }
@@ -55,48 +138,47 @@ namespace cqp
         bool DataFile::WriteQubits(const QubitList& source, const std::string& outFileName)
         {
             bool result = false;
-            std::ofstream outFile(outFileName, std::ios::out | std::ios::binary);
-            if (outFile)
+            MappedFile outFile;
+            // round up to the nearest byte
+            const size_t numBytes = (source.size() + 3) / 4;
+
+            if (outFile.Create(outFileName, numBytes))
             {
-                // for each 4 qubits
-                for(uint64_t index = 0; index < source.size(); index += 4)
+                const size_t wholeBytes = source.size() / 4;
+                const auto bounds = ChunkBounds(wholeBytes, 1);
+                ProcessChunks(bounds.size() - 1, [&](size_t chunk)
                 {
-                    uint8_t buffer {0};
-
-                    // pack the quits into a byte
-                    buffer = static_cast<uint8_t>(source[index] |
-                                                  (source[index+1] << 2) |
-                                                  (source[index+2] << 4) |
-                                                  (source[index+3] << 6));
-                    outFile.write(reinterpret_cast<char*>(&buffer), sizeof (buffer));
-                }
+                    uint8_t* const buffer = outFile.data();
+                    for(size_t byte = bounds[chunk]; byte < bounds[chunk + 1]; byte++)
+                    {
+                        const size_t index = byte * 4;
+                        // pack the quits into a byte
+                        buffer[byte] = static_cast<uint8_t>(source[index] |
+                                                            (source[index+1] << 2) |
+                                                            (source[index+2] << 4) |
+                                                            (source[index+3] << 6));
+                    }
+                });
 
                 // check if there are any unwritten qubits
-                const uint8_t remainder = source.size() % 4;
+                const size_t remainder = source.size() % 4;
                 if(remainder != 0)
                 {
                     LOGWARN("file will be padded with trailing zeros to the nearest byte");
                     uint8_t shiftOffset {0};
                     uint8_t buffer {0};
 
-                    for(uint64_t index = source.size() - remainder - 1; index < source.size(); index++)
+                    for(size_t index = source.size() - remainder; index < source.size(); index++)
                     {
-                        buffer |= source[index] << shiftOffset;
-
+                        buffer |= static_cast<uint8_t>(source[index] << shiftOffset);
                         shiftOffset += 2;
                     }
                     // store the remainder
-                    outFile.write(reinterpret_cast<char*>(&buffer), sizeof (buffer));
+                    outFile.data()[wholeBytes] = buffer;
                 }
-                outFile.close();
+                result = outFile.Close();
 
                 LOGDEBUG("Wrote " + std::to_string(source.size()) + " Qubits.");
-                result = true;
-
-            }
-            else
-            {
-                LOGERROR("Failed to open " + outFileName);
             }
 
             return result;
@@ -104,132 +186,141 @@ namespace cqp
 
         const std::vector<Qubit> DataFile::DefaultCahnnelMappings = { 0, 1, 2, 3 };
 
-        bool DataFile::ReadNOXDetections(const std::string& inFileName, DetectionReportList& output,
-                                         const  std::vector<Qubit>& channelMappings, bool waitForConfig, uint64_t maxCourseTime)
+        /**
+         * @brief ReadNoxWord
+         * @param data A NOX message
+         * @return The message in host order
+         */
+        static inline uint64_t ReadNoxWord(const uint8_t* data) noexcept
         {
+            uint64_t word;
+            std::memcpy(&word, data, sizeof(word));
+            return be64toh(word);
+        }
 
-            bool result = true;
-            std::ifstream inFile(inFileName, std::ios::in | std::ios::binary);
-            if (inFile)
+        bool DataFile::ReadNOXDetections(const std::string& inFileName, DetectionReportList& output,
+                                         const std::vector<Qubit>& channelMappings,
+                                         bool waitForConfig, uint64_t maxCourseTime)
+        {
+            using namespace std;
+            bool result = false;
+            MappedFile inFile;
+            if (inFile.Open(inFileName))
             {
-                // qubits packed 4/byte
-                inFile.seekg(0, std::ios::end);
-                const auto fileSize = inFile.tellg() * 4;
-                const size_t numRecords = static_cast<size_t>(fileSize / 8);
-                if(fileSize % 8 != 0)
+                const size_t numRecords = inFile.size() / NoxReport::messageBytes;
+                if(inFile.size() % NoxReport::messageBytes != 0)
                 {
                     LOGERROR("File is invalid.");
                 }
                 else
                 {
-                    uint64_t droppedDetections = 0;
-                    inFile.seekg(0, std::ios::beg);
-                    output.reserve(numRecords);
-                    bool gotConfig = !waitForConfig;
-                    bool keepReading = true;
+                    const uint8_t* const data = inFile.data();
+                    const auto configType = static_cast<uint8_t>(NoxReport::MessageType::Config);
+                    const auto detectionType = static_cast<uint8_t>(NoxReport::MessageType::Detection);
 
-                    do
+                    size_t firstRecord = 0;
+                    if(waitForConfig)
                     {
-                        NoxReport noxReport;
-                        NoxReport::Buffer buffer {0};
+                        // drop everything up to the first config record
+                        while(firstRecord < numRecords && data[firstRecord * NoxReport::messageBytes] != configType)
+                        {
+                            firstRecord++;
+                        }
+                    }
+
+                    const auto bounds = ChunkBounds(numRecords - firstRecord, NoxReport::messageBytes);
+                    const size_t numChunks = bounds.size() - 1;
+                    // each chunk is decoded separately then joined in order
+                    vector<DetectionReportList> chunkOutputs(numChunks);
+                    vector<size_t> chunkDropped(numChunks, 0);
+                    // whether a chunk reached maxCourseTime
+                    vector<uint8_t> chunkStopped(numChunks, false);
 
-                        inFile.read(reinterpret_cast<char*>(&buffer), sizeof (buffer));
-                        noxReport.messageType = static_cast<NoxReport::MessageType>(buffer[0]);
+                    ProcessChunks(numChunks, [&](size_t chunk)
+                    {
+                        const size_t first = firstRecord + bounds[chunk];
+                        size_t last = firstRecord + bounds[chunk + 1];
 
-                        if(!inFile.eof())
+                        if(maxCourseTime != 0)
                         {
-                            if(noxReport.LoadRaw(buffer))
+                            // stop at the first detection which reaches the time limit
+                            for(size_t record = first; record < last; record++)
                             {
-
-                                if(gotConfig && noxReport.messageType == NoxReport::MessageType::Detection)
+                                const uint8_t* message = data + record * NoxReport::messageBytes;
+                                if(message[0] == detectionType && ((ReadNoxWord(message) >> 20) & 0xFFFFFFFFFull) >= maxCourseTime)
                                 {
-                                    if(maxCourseTime != 0 && noxReport.detection.coarse >= maxCourseTime)
-                                    {
-                                        keepReading = false;
-                                    }
-                                    else
-                                    {
-                                        if(noxReport.detection.channel < channelMappings.size())
-                                        {
-                                            output.push_back(
-                                            {
-                                                noxReport.GetTime(),
-                                                channelMappings[noxReport.detection.channel]
-                                            });
-                                        }
-                                        else
-                                        {
-                                            LOGWARN("Channel " + std::to_string(noxReport.detection.channel) + " not mapped.");
-                                            droppedDetections++;
-                                        }
-                                    }
-                                }
-                                else if(noxReport.messageType == NoxReport::MessageType::Config)
-                                {
-                                    gotConfig = true;
-
+                                    last = record;
+                                    chunkStopped[chunk] = true;
+                                    break; // for
                                 }
                             }
-                            else
-                            {
-                                LOGERROR("Failed to decode buffer");
-                            }
+                        }
+
+                        chunkDropped[chunk] = DecodeNoxDetections(channelMappings, data + first * NoxReport::messageBytes,
+                                              (last - first) * NoxReport::messageBytes, chunkOutputs[chunk]);
+                    });
 
-                            result = true;
+                    // join the chunks up to the first one which stopped
+                    size_t numDetections = 0;
+                    size_t numChunksUsed = 0;
+                    uint64_t droppedDetections = 0;
+                    while(numChunksUsed < numChunks)
+                    {
+                        numDetections += chunkOutputs[numChunksUsed].size();
+                        droppedDetections += chunkDropped[numChunksUsed];
+                        if(chunkStopped[numChunksUsed++])
+                        {
+                            break; // while
                         }
                     }
-                    while(!inFile.eof() && keepReading);
-                    inFile.close();
+
+                    output.reserve(output.size() + numDetections);
+                    for(size_t chunk = 0; chunk < numChunksUsed; chunk++)
+                    {
+                        output.insert(output.end(), chunkOutputs[chunk].begin(), chunkOutputs[chunk].end());
+                        // free the memory as we go
+                        DetectionReportList().swap(chunkOutputs[chunk]);
+                    }
+
                     LOGINFO("Read " + std::to_string(output.size()) + " detections. Dropped " + std::to_string(droppedDetections) + " detections");
+                    result = true;
                 }
             }
-            else
-            {
-                LOGERROR("Failed to open " + inFileName);
-                result = false;
-            }
 
             return result;
         }
 
+        void DataFile::DecodeDetectionReports(const uint8_t* data, size_t count, DetectionReport* output)
+        {
+            for(size_t index = 0; index < count; index++)
+            {
+                const uint8_t* const record = data + index * detectionRecordBytes;
+                uint64_t time;
+                std::memcpy(&time, record, sizeof(time));
+                output[index].time = PicoSeconds(be64toh(time));
+                output[index].value = record[sizeof(time)];
+            }
+        } // DecodeDetectionReports
+
         bool DataFile::ReadDetectionReportList(const std::string& inFileName, DetectionReportList& output)
         {
             bool result = false;
-            std::ifstream inFile(inFileName, std::ios::in | std::ios::binary);
-            if (inFile)
+            MappedFile inFile;
+            if (inFile.Open(inFileName))
             {
-                inFile.seekg(0, std::ios::end);
-                const uint64_t numRecords = static_cast<uint64_t>(inFile.tellg()) / (sizeof(uint64_t) + sizeof(Qubit));
-                output.reserve(numRecords);
-                inFile.seekg(0, std::ios::beg);
+                const size_t numRecords = inFile.size() / detectionRecordBytes;
+                const size_t start = output.size();
+                output.resize(start + numRecords);
 
-                do
+                const auto bounds = ChunkBounds(numRecords, detectionRecordBytes);
+                ProcessChunks(bounds.size() - 1, [&](size_t chunk)
                 {
-                    uint64_t time {0};
-                    Qubit value;
-                    inFile.read(reinterpret_cast<char*>(&time), sizeof (time));
-                    inFile.read(reinterpret_cast<char*>(&value), sizeof (value));
-                    if(!inFile.eof())
-                    {
-#if defined(__unix__)
-                        output.push_back(
-                        {
-                            PicoSeconds(be64toh(time)), value
-                        });
-#elif defined(WIN32)
-                        LOGERROR("TODO");
-#endif
-                    }
-                }
-                while(!inFile.eof());
+                    DecodeDetectionReports(inFile.data() + bounds[chunk] * detectionRecordBytes,
+                                           bounds[chunk + 1] - bounds[chunk], output.data() + start + bounds[chunk]);
+                });
 
-                inFile.close();
                 result = true;
             }
-            else
-            {
-                LOGERROR("Failed to open " + inFileName);
-            }
 
             return result;
         }
@@ -237,22 +328,21 @@ namespace cqp
         bool DataFile::WriteDetectionReportList(const DetectionReportList& source, const std::string& outFileName)
         {
             bool result = false;
-            std::ofstream outFile(outFileName, std::ios::out | std::ios::binary);
-            if (outFile)
+            MappedFile outFile;
+            if (outFile.Create(outFileName, source.size() * detectionRecordBytes))
             {
-                for(const auto & report : source)
+                const auto bounds = ChunkBounds(source.size(), detectionRecordBytes);
+                ProcessChunks(bounds.size() - 1, [&](size_t chunk)
                 {
-                    const uint64_t time = htobe64(report.time.count());
-                    outFile.write(reinterpret_cast<const char*>(&time), sizeof(time));
-                    outFile.write(reinterpret_cast<const char*>(&report.value), sizeof (report.value));
-                }
-                outFile.close();
-                result = true;
-
-            }
-            else
-            {
-                LOGERROR("Failed to open " + outFileName);
+                    for(size_t index = bounds[chunk]; index < bounds[chunk + 1]; index++)
+                    {
+                        uint8_t* const record = outFile.data() + index * detectionRecordBytes;
+                        const uint64_t time = htobe64(source[index].time.count());
+                        std::memcpy(record, &time, sizeof(time));
+                        record[sizeof(time)] = source[index].value;
+                    }
+                });
+                result = outFile.Close();
             }
 
             return result;
@@ -306,5 +396,143 @@ namespace cqp
             return result;
         }
 
+        /// The coarse count in a NOX message once it is in host order
+        static constexpr uint64_t noxCoarseMask = 0x00FFFFFFFFF00000ull;
+        /// The fine count in a NOX message once it is in host order
+        static constexpr uint64_t noxFineMask = 0x0000000000000FFFull;
+        /// The number of messages decoded together
+        static constexpr size_t noxBlock = 4;
+
+        /**
+         * @brief NoxTicks
+         * @param word A NOX message in host order
+         * @return The coarse and fine counts as a number of fine ticks
+         */
+        static inline uint64_t NoxTicks(uint64_t word) noexcept
+        {
+            // the coarse count sits directly above the fine count once the channel is removed
+            return ((word & noxCoarseMask) >> 8) | (word & noxFineMask);
+        }
+
+        size_t DataFile::DecodeNoxDetections(const std::vector<Qubit>& channelMappings,
+                                             const uint8_t* data, size_t length,
+                                             DetectionReportList& output)
+        {
+            using std::chrono::duration_cast;
+            const auto detectionType = static_cast<uint64_t>(NoxReport::MessageType::Detection);
+            const auto configType = static_cast<uint64_t>(NoxReport::MessageType::Config);
+
+            // map the raw channel nibble, which counts from 1, straight to a qubit
+            Qubit channelTable[16] {};
+            uint16_t validChannels = 0;
+            for(size_t nibble = 1; nibble < 16 && nibble <= channelMappings.size(); nibble++)
+            {
+                channelTable[nibble] = channelMappings[nibble - 1];
+                validChannels |= static_cast<uint16_t>(1u << nibble);
+            }
+
+            const size_t numMessages = length / NoxReport::messageBytes;
+            const size_t start = output.size();
+            // make room for every message being a detection, the unused space is removed at the end
+            output.resize(start + numMessages);
+            DetectionReport* const destination = output.data() + start;
+            size_t used = 0;
+            size_t dropped = 0;
+
+            // message words in host order
+            alignas(32) uint64_t words[noxBlock];
+            // times for each message
+            alignas(32) uint64_t ticks[noxBlock];
+
+            size_t message = 0;
+            while(message < numMessages)
+            {
+                const size_t blockSize = std::min(noxBlock, numMessages - message);
+                const uint8_t* const source = data + message * NoxReport::messageBytes;
+                // one bit per message which has the detection type
+                unsigned detections = 0;
+
+                if(blockSize == noxBlock)
+                {
+#if defined(CQP_NOX_AVX2)
+                    // reverse the bytes within each 64 bit message
+                    const __m256i byteSwap = _mm256_setr_epi8(
+                                                 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                                 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+                    const __m256i raw = _mm256_shuffle_epi8(
+                                            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source)), byteSwap);
+                    const __m256i times = _mm256_or_si256(
+                                              _mm256_srli_epi64(_mm256_and_si256(raw, _mm256_set1_epi64x(noxCoarseMask)), 8),
+                                              _mm256_and_si256(raw, _mm256_set1_epi64x(noxFineMask)));
+                    // the type ends up in the top half of each word, which is the half movemask reads
+                    const __m256i types = _mm256_srli_epi32(raw, 24);
+                    const __m256i isDetection = _mm256_cmpeq_epi32(types, _mm256_set1_epi32(static_cast<int>(detectionType)));
+
+                    _mm256_store_si256(reinterpret_cast<__m256i*>(words), raw);
+                    _mm256_store_si256(reinterpret_cast<__m256i*>(ticks), times);
+                    detections = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(isDetection)));
+#elif defined(CQP_NOX_SSE2)
+                    for(size_t half = 0; half < noxBlock; half += 2)
+                    {
+                        __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + half * NoxReport::messageBytes));
+                        // swap the bytes in each 16 bit word then reverse the 16 bit words
+                        raw = _mm_or_si128(_mm_slli_epi16(raw, 8), _mm_srli_epi16(raw, 8));
+                        raw = _mm_shufflelo_epi16(raw, _MM_SHUFFLE(0, 1, 2, 3));
+                        raw = _mm_shufflehi_epi16(raw, _MM_SHUFFLE(0, 1, 2, 3));
+
+                        const __m128i times = _mm_or_si128(
+                                                  _mm_srli_epi64(_mm_and_si128(raw, _mm_set1_epi64x(noxCoarseMask)), 8),
+                                                  _mm_and_si128(raw, _mm_set1_epi64x(noxFineMask)));
+                        const __m128i types = _mm_srli_epi32(raw, 24);
+                        const __m128i isDetection = _mm_cmpeq_epi32(types, _mm_set1_epi32(static_cast<int>(detectionType)));
+
+                        _mm_store_si128(reinterpret_cast<__m128i*>(words + half), raw);
+                        _mm_store_si128(reinterpret_cast<__m128i*>(ticks + half), times);
+                        detections |= static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(isDetection))) << half;
+                    }
+#else
+                    for(size_t index = 0; index < noxBlock; index++)
+                    {
+                        uint64_t word;
+                        std::memcpy(&word, source + index * NoxReport::messageBytes, sizeof(word));
+                        words[index] = be64toh(word);
+                        ticks[index] = NoxTicks(words[index]);
+                        detections |= static_cast<unsigned>((words[index] >> 56) == detectionType) << index;
+                    }
+#endif
+                }
+                else
+                {
+                    // the tail
+                    for(size_t index = 0; index < blockSize; index++)
+                    {
+                        uint64_t word;
+                        std::memcpy(&word, source + index * NoxReport::messageBytes, sizeof(word));
+                        words[index] = be64toh(word);
+                        ticks[index] = NoxTicks(words[index]);
+                        detections |= static_cast<unsigned>((words[index] >> 56) == detectionType) << index;
+                    }
+                }
+
+                // compact the detections into the output
+                for(size_t index = 0; index < blockSize; index++)
+                {
+                    const unsigned nibble = static_cast<unsigned>(words[index] >> 12) & 0x0Fu;
+                    const bool keep = ((detections >> index) & (validChannels >> nibble) & 1u) != 0;
+
+                    // always written, only kept if it's valid
+                    destination[used].time = duration_cast<PicoSeconds>(NoxReport::FineTime(ticks[index]));
+                    destination[used].value = channelTable[nibble];
+                    used += keep;
+                    dropped += !keep && (words[index] >> 56) != configType;
+                }
+
+                message += blockSize;
+            } // while messages
+
+            output.resize(start + used);
+            return dropped;
+        } // DecodeNoxDetections
+
     } // namespace fs
 } // namespace cqp
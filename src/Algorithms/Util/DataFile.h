@@ -22,11 +22,17 @@ namespace cqp {
             /// Specifies that channel 0 == BB84::Zero, channel 1 == BB84::One, etc
             static const std::vector<Qubit> DefaultCahnnelMappings; // = { 0, 1, 2, 3 };
 
+            /// The smallest number of bytes worth giving to another thread when reading or writing a file
+            static size_t minBytesPerThread;
+            /// The most threads used to read or write a file, 0 = one per core
+            static size_t maxThreads;
+
             /**
              * @brief ReadPackedQubits
              * Read a list of qubits from a packed binary file. The file is assumed to be in network order
              * @details
              * 2 bits per qubit, 4 qubits per byte.
+             * The file is mapped into memory and large files are decoded by several threads.
              * @param inFileName
              * @param output
              * @param maxValues Maximum number of values to get. 0 = no limit
@@ -57,6 +63,8 @@ namespace cqp {
              * | 44 - 47    | 4         | blank                 |
              * | 48 - 51    | 4         | channel               |
              * | 52 - 63    | 12        | Fine count            |
+             *
+             * The file is mapped into memory and large files are decoded by several threads.
              * @param inFileName
              * @param output
              * @param channelMappings Defines how the values in the file relate to the qubit values returned
@@ -153,6 +161,44 @@ namespace cqp {
             static bool DecodeNoxDetection(const std::vector<Qubit>& channelMappings,
                                            const NoxReport::Buffer& buffer,
                                            DetectionReport& output);
+
+            /**
+             * @brief DecodeNoxDetections
+             * Convert a block of NOX messages into detections, config messages are skipped.
+             * @details
+             * Several messages are decoded at once with vector instructions where available,
+             * the output is resized once and detections are compacted into it.
+             * @param[in] channelMappings How to map the raw channel numbers to qubits
+             * @param[in] data The raw messages
+             * @param[in] length The number of bytes in data, any partial message at the end is ignored
+             * @param[in,out] output The detections are appended to this
+             * @return The number of messages which were invalid or had an unmapped channel
+             */
+            static size_t DecodeNoxDetections(const std::vector<Qubit>& channelMappings,
+                                              const uint8_t* data, size_t length,
+                                              DetectionReportList& output);
+
+            /// The number of bytes for each detection written by WriteDetectionReportList
+            static constexpr size_t detectionRecordBytes = sizeof(uint64_t) + sizeof(Qubit);
+
+            /**
+             * @brief DecodeDetectionReports
+             * Convert records written by WriteDetectionReportList
+             * @param[in] data The raw records
+             * @param[in] count The number of records to convert
+             * @param[out] output Destination for count detections
+             */
+            static void DecodeDetectionReports(const uint8_t* data, size_t count, DetectionReport* output);
+
+            /**
+             * @brief UnpackQubits
+             * Convert qubits packed 4 per byte, as read by ReadPackedQubits
+             * @param[in] channelMappings defines a mapping between the read and the stored values, must have 4 values
+             * @param[in] data The packed qubits
+             * @param[in] count The number of qubits to convert
+             * @param[out] output Destination for count qubits
+             */
+            static void UnpackQubits(const std::vector<Qubit>& channelMappings, const uint8_t* data, size_t count, Qubit* output);
         }; // DataFile class
 
     } // namespace fs
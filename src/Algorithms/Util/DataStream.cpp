@@ -0,0 +1,121 @@
+/*!
+* @file
+* @brief DataStream
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "DataStream.h"
+#include "Algorithms/Logging/Logger.h"
+#include <algorithm>
+
+namespace cqp
+{
+    namespace fs
+    {
+        constexpr size_t DetectionStream::defaultBlockSize;
+        constexpr size_t QubitStream::defaultBlockSize;
+
+        DetectionStream::DetectionStream(const std::string& fileName, Format format,
+                                         const std::vector<Qubit>& channelMappings, bool waitForConfig) :
+            format{format},
+            channelMappings{channelMappings}
+        {
+            if(format == Format::Nox)
+            {
+                recordBytes = DataFile::NoxReport::messageBytes;
+            }
+            else
+            {
+                recordBytes = DataFile::detectionRecordBytes;
+            }
+
+            if(file.Open(fileName))
+            {
+                if(file.size() % recordBytes != 0)
+                {
+                    LOGWARN("File has a partial record at the end");
+                }
+
+                if(format == Format::Nox && waitForConfig)
+                {
+                    // drop everything up to the first config record
+                    const auto configType = static_cast<uint8_t>(DataFile::NoxReport::MessageType::Config);
+                    while(position + recordBytes <= file.size() && file.data()[position] != configType)
+                    {
+                        position += recordBytes;
+                    }
+                }
+            }
+        }
+
+        bool DetectionStream::Next(cqp::DetectionReportList& output, size_t maxRecords)
+        {
+            output.clear();
+            const size_t numRecords = std::min((file.size() - position) / recordBytes, std::max<size_t>(1, maxRecords));
+            const bool result = numRecords > 0;
+
+            if(result)
+            {
+                if(format == Format::Nox)
+                {
+                    const size_t dropped = DataFile::DecodeNoxDetections(channelMappings, file.data() + position,
+                                           numRecords * recordBytes, output);
+                    if(dropped > 0)
+                    {
+                        LOGWARN("Dropped " + std::to_string(dropped) + " detections");
+                    }
+                }
+                else
+                {
+                    output.resize(numRecords);
+                    DataFile::DecodeDetectionReports(file.data() + position, numRecords, output.data());
+                }
+
+                // the records won't be read again
+                file.Release(position, numRecords * recordBytes);
+                position += numRecords * recordBytes;
+            }
+
+            return result;
+        } // Next
+
+        QubitStream::QubitStream(const std::string& fileName, const std::vector<Qubit>& channelMappings) :
+            channelMappings{channelMappings}
+        {
+            if(channelMappings.size() < 4)
+            {
+                LOGERROR("Packed qubits need 4 channel mappings");
+            }
+            else
+            {
+                file.Open(fileName);
+            }
+        }
+
+        bool QubitStream::Next(QubitList& output, size_t maxQubits)
+        {
+            output.clear();
+            // qubits packed 4/byte
+            const size_t numBytes = std::min(file.size() - position, std::max<size_t>(1, (maxQubits + 3) / 4));
+            const bool result = numBytes > 0;
+
+            if(result)
+            {
+                output.resize(numBytes * 4);
+                DataFile::UnpackQubits(channelMappings, file.data() + position, output.size(), output.data());
+
+                // the bytes won't be read again
+                file.Release(position, numBytes);
+                position += numBytes;
+            }
+
+            return result;
+        } // Next
+
+    } // namespace fs
+} // namespace cqp
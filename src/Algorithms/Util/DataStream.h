@@ -0,0 +1,267 @@
+/*!
+* @file
+* @brief DataStream
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#pragma once
+#include "Algorithms/Util/DataFile.h"
+#include "Algorithms/Util/MappedFile.h"
+#include <iterator>
+
+namespace cqp
+{
+    namespace fs
+    {
+        /**
+         * @brief The BlockIterator class
+         * Steps through every value in a stream, reading a block at a time
+         * @tparam Stream The stream to read, provides bool Next(List&)
+         * @tparam List The type of list which the stream fills
+         */
+        template<typename Stream, typename List>
+        class BlockIterator
+        {
+        public: // types
+            /// @{
+            /// iterator traits
+            using iterator_category = std::input_iterator_tag;
+            using value_type = typename List::value_type;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const value_type*;
+            using reference = const value_type&;
+            /// @}
+
+        public: // methods
+            /// Construct the end iterator
+            BlockIterator() = default;
+
+            /**
+             * @brief BlockIterator
+             * Start reading from the stream
+             * @param stream The stream to read, must outlive the iterator
+             */
+            explicit BlockIterator(Stream* stream) :
+                stream{stream}
+            {
+                Fetch();
+            }
+
+            /// @return The current value
+            reference operator*() const
+            {
+                return block[index];
+            }
+
+            /// @return The current value
+            pointer operator->() const
+            {
+                return &block[index];
+            }
+
+            /// Move to the next value
+            /// @return this iterator
+            BlockIterator& operator++()
+            {
+                if(++index >= block.size())
+                {
+                    Fetch();
+                }
+                return *this;
+            }
+
+            /**
+             * @brief operator ==
+             * @param other iterator to compare
+             * @return true if both have reached the end or both are reading the same stream
+             */
+            bool operator==(const BlockIterator& other) const
+            {
+                return stream == other.stream;
+            }
+
+            /**
+             * @brief operator !=
+             * @param other iterator to compare
+             * @return false if both have reached the end or both are reading the same stream
+             */
+            bool operator!=(const BlockIterator& other) const
+            {
+                return stream != other.stream;
+            }
+
+        protected: // methods
+            /// Read the next non-empty block, becomes the end iterator when there are no more
+            void Fetch()
+            {
+                index = 0;
+                block.clear();
+                while(stream && block.empty())
+                {
+                    if(!stream->Next(block))
+                    {
+                        stream = nullptr;
+                    }
+                }
+            }
+
+        protected: // members
+            /// The stream being read, null at the end
+            Stream* stream = nullptr;
+            /// The values read from the stream
+            List block;
+            /// The position in block
+            size_t index = 0;
+        }; // BlockIterator
+
+        /**
+         * @brief The DetectionStream class
+         * Reads a file of detections a block at a time so that captures larger than memory can be processed.
+         * @details
+         * The file is mapped into memory and the parts which have been read are released.
+         * @code
+         * fs::DetectionStream stream("capture.bin", fs::DetectionStream::Format::Nox);
+         * for(const auto& detection : stream)
+         * {
+         *     // ...
+         * }
+         * @endcode
+         */
+        class ALGORITHMS_EXPORT DetectionStream
+        {
+        public: // types
+            /// The layout of the file
+            enum class Format
+            {
+                /// As read by DataFile::ReadNOXDetections
+                Nox,
+                /// As read by DataFile::ReadDetectionReportList
+                DetectionReportList
+            };
+
+            /// The iterator for the detections
+            using iterator = BlockIterator<DetectionStream, cqp::DetectionReportList>;
+
+            /// The default number of records to read at a time
+            static constexpr size_t defaultBlockSize = 1024 * 1024;
+
+        public: // methods
+            /**
+             * @brief DetectionStream
+             * Constructor, opens the file
+             * @param fileName The file to read
+             * @param format The layout of the file
+             * @param channelMappings Defines how the values in a NOX file relate to the qubit values returned
+             * @param waitForConfig For NOX files, drop records before the first config record
+             */
+            DetectionStream(const std::string& fileName, Format format,
+                            const std::vector<Qubit>& channelMappings = DataFile::DefaultCahnnelMappings,
+                            bool waitForConfig = true);
+
+            /// @return true if the file was opened
+            bool IsOpen() const noexcept
+            {
+                return file.IsOpen();
+            }
+
+            /**
+             * @brief Next
+             * Read the next block of detections
+             * @param[out] output Replaced with the detections, may be empty if the records were not detections
+             * @param maxRecords The number of records to read
+             * @return false if there were no more records
+             */
+            bool Next(cqp::DetectionReportList& output, size_t maxRecords = defaultBlockSize);
+
+            /// @return An iterator to the remaining detections
+            iterator begin()
+            {
+                return iterator(this);
+            }
+
+            /// @return The end iterator
+            iterator end()
+            {
+                return iterator();
+            }
+
+        protected: // members
+            /// The file being read
+            MappedFile file;
+            /// The layout of the file
+            const Format format;
+            /// how channels are mapped to qubits
+            const std::vector<Qubit> channelMappings;
+            /// The number of bytes which have been read
+            size_t position = 0;
+            /// The size of each record
+            size_t recordBytes = 0;
+        }; // DetectionStream
+
+        /**
+         * @brief The QubitStream class
+         * Reads a file of packed qubits a block at a time so that files larger than memory can be processed.
+         * @see DataFile::ReadPackedQubits
+         */
+        class ALGORITHMS_EXPORT QubitStream
+        {
+        public: // types
+            /// The iterator for the qubits
+            using iterator = BlockIterator<QubitStream, QubitList>;
+
+            /// The default number of qubits to read at a time
+            static constexpr size_t defaultBlockSize = 4 * 1024 * 1024;
+
+        public: // methods
+            /**
+             * @brief QubitStream
+             * Constructor, opens the file
+             * @param fileName The file to read
+             * @param channelMappings defines a mapping between the read and the stored values, must have 4 values
+             */
+            QubitStream(const std::string& fileName,
+                        const std::vector<Qubit>& channelMappings = DataFile::DefaultCahnnelMappings);
+
+            /// @return true if the file was opened
+            bool IsOpen() const noexcept
+            {
+                return file.IsOpen();
+            }
+
+            /**
+             * @brief Next
+             * Read the next block of qubits
+             * @param[out] output Replaced with the qubits
+             * @param maxQubits The number of qubits to read, rounded up to a whole byte
+             * @return false if there were no more qubits
+             */
+            bool Next(QubitList& output, size_t maxQubits = defaultBlockSize);
+
+            /// @return An iterator to the remaining qubits
+            iterator begin()
+            {
+                return iterator(this);
+            }
+
+            /// @return The end iterator
+            iterator end()
+            {
+                return iterator();
+            }
+
+        protected: // members
+            /// The file being read
+            MappedFile file;
+            /// how channels are mapped to qubits
+            const std::vector<Qubit> channelMappings;
+            /// The number of bytes which have been read
+            size_t position = 0;
+        }; // QubitStream
+
+    } // namespace fs
+} // namespace cqp
@@ -0,0 +1,401 @@
+/*!
+* @file
+* @brief DetectionArchive
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "DetectionArchive.h"
+#include "Algorithms/Logging/Logger.h"
+#include "Algorithms/Util/PortableEndian.h"
+#include <algorithm>
+#include <cstring>
+
+namespace cqp
+{
+    namespace fs
+    {
+        constexpr size_t DetectionArchiveWriter::defaultBlockSize;
+
+        /// Store a little endian value
+        static inline void Put64(uint8_t* destination, uint64_t value) noexcept
+        {
+            value = htole64(value);
+            std::memcpy(destination, &value, sizeof(value));
+        }
+
+        /// Store a little endian value
+        static inline void Put32(uint8_t* destination, uint32_t value) noexcept
+        {
+            value = htole32(value);
+            std::memcpy(destination, &value, sizeof(value));
+        }
+
+        /// Read a little endian value
+        static inline uint64_t Get64(const uint8_t* source) noexcept
+        {
+            uint64_t value;
+            std::memcpy(&value, source, sizeof(value));
+            return le64toh(value);
+        }
+
+        /// Read a little endian value
+        static inline uint32_t Get32(const uint8_t* source) noexcept
+        {
+            uint32_t value;
+            std::memcpy(&value, source, sizeof(value));
+            return le32toh(value);
+        }
+
+        /**
+         * @brief BlockBytes
+         * @param count The number of detections in the block
+         * @param timeBits The number of bits for each time delta
+         * @return The size of a block in bytes
+         */
+        static inline uint64_t BlockBytes(uint64_t count, unsigned timeBits) noexcept
+        {
+            return archive::blockHeaderBytes + (count * timeBits + 63) / 64 * sizeof(uint64_t) + (count + 3) / 4;
+        }
+
+        // ******* DetectionArchiveWriter **************
+
+        DetectionArchiveWriter::DetectionArchiveWriter(size_t blockSize) :
+            blockSize{std::max<size_t>(1, std::min<size_t>(blockSize, UINT32_MAX))}
+        {
+        }
+
+        DetectionArchiveWriter::~DetectionArchiveWriter()
+        {
+            Close();
+        }
+
+        bool DetectionArchiveWriter::Open(const std::string& fileName)
+        {
+            Close();
+            outFile.open(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+            if(outFile.is_open())
+            {
+                outFile.write(archive::fileMagic, sizeof(archive::fileMagic));
+            }
+            else
+            {
+                LOGERROR("Failed to open " + fileName);
+            }
+            return outFile.good();
+        } // Open
+
+        bool DetectionArchiveWriter::Write(const ProtocolDetectionReport& report)
+        {
+            using namespace std::chrono;
+            bool result = outFile.is_open();
+            const auto& detections = report.detections;
+
+            const auto tooBig = [](const DetectionReport& detection)
+            {
+                return detection.value > archive::maxValue;
+            };
+
+            if(result && std::any_of(detections.begin(), detections.end(), tooBig))
+            {
+                LOGERROR("Detection values must fit in 2 bits");
+                result = false;
+            }
+
+            const int64_t epoc = duration_cast<nanoseconds>(report.epoc.time_since_epoch()).count();
+            size_t first = 0;
+
+            // an empty report still gets a block so that the frame is recorded
+            while(result && (first < detections.size() || first == 0))
+            {
+                const size_t count = std::min(blockSize, detections.size() - first);
+                const uint64_t firstTime = (count > 0) ? detections[first].time.count() : 0;
+
+                // find the size of the time deltas
+                uint64_t allDeltas = 0;
+                uint64_t previous = firstTime;
+                for(size_t index = first; index < first + count; index++)
+                {
+                    const uint64_t time = detections[index].time.count();
+                    const auto delta = static_cast<int64_t>(time - previous);
+                    // zig-zag so that small negative values stay small
+                    allDeltas |= (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63);
+                    previous = time;
+                }
+                unsigned timeBits = 0;
+                while(timeBits < 64 && (allDeltas >> timeBits) != 0)
+                {
+                    timeBits++;
+                }
+
+                buffer.assign(BlockBytes(count, timeBits), 0);
+                Put64(&buffer[0], report.frame);
+                Put64(&buffer[8], static_cast<uint64_t>(epoc));
+                Put32(&buffer[16], static_cast<uint32_t>(count));
+                buffer[20] = static_cast<uint8_t>(timeBits);
+                Put64(&buffer[24], firstTime);
+
+                // pack the time deltas
+                uint8_t* const timeColumn = &buffer[archive::blockHeaderBytes];
+                const size_t timeWords = (count * timeBits + 63) / 64;
+                std::vector<uint64_t> words(timeWords, 0);
+                previous = firstTime;
+                uint64_t bitPos = 0;
+                for(size_t index = first; index < first + count; index++)
+                {
+                    const uint64_t time = detections[index].time.count();
+                    const auto delta = static_cast<int64_t>(time - previous);
+                    const uint64_t zigZag = (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63);
+                    previous = time;
+
+                    if(timeBits > 0)
+                    {
+                        const size_t word = bitPos / 64;
+                        const unsigned shift = bitPos % 64;
+                        words[word] |= zigZag << shift;
+                        if(shift + timeBits > 64)
+                        {
+                            words[word + 1] |= zigZag >> (64 - shift);
+                        }
+                        bitPos += timeBits;
+                    }
+                }
+                for(size_t word = 0; word < timeWords; word++)
+                {
+                    Put64(timeColumn + word * sizeof(uint64_t), words[word]);
+                }
+
+                // pack the values
+                uint8_t* const valueColumn = timeColumn + timeWords * sizeof(uint64_t);
+                for(size_t index = 0; index < count; index++)
+                {
+                    valueColumn[index / 4] |= static_cast<uint8_t>(detections[first + index].value << (2 * (index % 4)));
+                }
+
+                archive::BlockInfo info;
+                info.offset = static_cast<uint64_t>(outFile.tellp());
+                info.frame = report.frame;
+                info.epoc = epoc;
+                info.count = static_cast<uint32_t>(count);
+                info.firstTime = PicoSeconds(firstTime);
+
+                outFile.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+                result = outFile.good();
+                if(result)
+                {
+                    index.push_back(info);
+                }
+
+                first += std::max<size_t>(count, 1);
+            } // while detections
+
+            return result;
+        } // Write
+
+        bool DetectionArchiveWriter::Close()
+        {
+            bool result = true;
+            if(outFile.is_open())
+            {
+                const auto indexOffset = static_cast<uint64_t>(outFile.tellp());
+                buffer.assign(index.size() * archive::indexEntryBytes + archive::footerBytes, 0);
+                uint8_t* entry = buffer.data();
+                for(const auto& info : index)
+                {
+                    Put64(entry, info.offset);
+                    Put64(entry + 8, info.frame);
+                    Put64(entry + 16, static_cast<uint64_t>(info.epoc));
+                    Put32(entry + 24, info.count);
+                    Put64(entry + 32, info.firstTime.count());
+                    entry += archive::indexEntryBytes;
+                }
+                Put64(entry, indexOffset);
+                Put64(entry + 8, index.size());
+                std::memcpy(entry + 16, archive::indexMagic, sizeof(archive::indexMagic));
+
+                outFile.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+                result = outFile.good();
+                outFile.close();
+                index.clear();
+                buffer.clear();
+            }
+            return result;
+        } // Close
+
+        // ******* DetectionArchiveReader **************
+
+        bool DetectionArchiveReader::Open(const std::string& fileName)
+        {
+            using namespace archive;
+            bool result = false;
+            index.clear();
+
+            if(file.Open(fileName))
+            {
+                const uint8_t* const data = file.data();
+                const size_t size = file.size();
+
+                if(size < sizeof(fileMagic) || std::memcmp(data, fileMagic, sizeof(fileMagic)) != 0)
+                {
+                    LOGERROR(fileName + " is not a detection archive");
+                }
+                else if(size >= sizeof(fileMagic) + footerBytes &&
+                        std::memcmp(data + size - sizeof(indexMagic), indexMagic, sizeof(indexMagic)) == 0)
+                {
+                    const uint8_t* const footer = data + size - footerBytes;
+                    const uint64_t indexOffset = Get64(footer);
+                    const uint64_t numBlocks = Get64(footer + 8);
+
+                    if(indexOffset + numBlocks * indexEntryBytes + footerBytes == size)
+                    {
+                        index.resize(numBlocks);
+                        const uint8_t* entry = data + indexOffset;
+                        for(auto& info : index)
+                        {
+                            info.offset = Get64(entry);
+                            info.frame = Get64(entry + 8);
+                            info.epoc = static_cast<int64_t>(Get64(entry + 16));
+                            info.count = Get32(entry + 24);
+                            info.firstTime = PicoSeconds(Get64(entry + 32));
+                            entry += indexEntryBytes;
+                        }
+                        result = true;
+                    }
+                    else
+                    {
+                        LOGWARN("Archive index is invalid, rebuilding");
+                        result = RebuildIndex();
+                    }
+                }
+                else
+                {
+                    LOGWARN("Archive was not closed, rebuilding index");
+                    result = RebuildIndex();
+                }
+            }
+
+            return result;
+        } // Open
+
+        bool DetectionArchiveReader::RebuildIndex()
+        {
+            using namespace archive;
+            index.clear();
+            uint64_t offset = sizeof(fileMagic);
+
+            while(offset + blockHeaderBytes <= file.size())
+            {
+                const uint8_t* const header = file.data() + offset;
+                archive::BlockInfo info;
+                info.offset = offset;
+                info.frame = Get64(header);
+                info.epoc = static_cast<int64_t>(Get64(header + 8));
+                info.count = Get32(header + 16);
+                info.firstTime = PicoSeconds(Get64(header + 24));
+                const unsigned timeBits = header[20];
+
+                const uint64_t blockBytes = BlockBytes(info.count, timeBits);
+                if(timeBits > 64 || offset + blockBytes > file.size())
+                {
+                    LOGWARN("Archive ends with a partial block");
+                    break; // while
+                }
+                index.push_back(info);
+                offset += blockBytes;
+            }
+
+            return true;
+        } // RebuildIndex
+
+        bool DetectionArchiveReader::ReadBlock(size_t block, DetectionReportList& output) const
+        {
+            bool result = false;
+            if(block < index.size())
+            {
+                const uint8_t* const header = file.data() + index[block].offset;
+                const uint32_t count = Get32(header + 16);
+                const unsigned timeBits = header[20];
+                const uint64_t firstTime = Get64(header + 24);
+
+                if(timeBits <= 64 && index[block].offset + BlockBytes(count, timeBits) <= file.size())
+                {
+                    const uint8_t* const timeColumn = header + archive::blockHeaderBytes;
+                    const size_t timeWords = (static_cast<uint64_t>(count) * timeBits + 63) / 64;
+                    const uint8_t* const valueColumn = timeColumn + timeWords * sizeof(uint64_t);
+                    const uint64_t mask = (timeBits == 64) ? ~0ull : ((1ull << timeBits) - 1);
+
+                    const size_t start = output.size();
+                    output.resize(start + count);
+                    DetectionReport* const destination = output.data() + start;
+
+                    uint64_t time = firstTime;
+                    uint64_t bitPos = 0;
+                    for(size_t index = 0; index < count; index++)
+                    {
+                        uint64_t zigZag = 0;
+                        if(timeBits > 0)
+                        {
+                            const size_t word = bitPos / 64;
+                            const unsigned shift = bitPos % 64;
+                            zigZag = Get64(timeColumn + word * sizeof(uint64_t)) >> shift;
+                            if(shift + timeBits > 64)
+                            {
+                                zigZag |= Get64(timeColumn + (word + 1) * sizeof(uint64_t)) << (64 - shift);
+                            }
+                            zigZag &= mask;
+                            bitPos += timeBits;
+                        }
+                        // undo the zig-zag
+                        time += (zigZag >> 1) ^ (0 - (zigZag & 1));
+
+                        destination[index].time = PicoSeconds(time);
+                        destination[index].value = (valueColumn[index / 4] >> (2 * (index % 4))) & archive::maxValue;
+                    }
+                    result = true;
+                }
+                else
+                {
+                    LOGERROR("Archive block " + std::to_string(block) + " is invalid");
+                }
+            }
+
+            return result;
+        } // ReadBlock
+
+        bool DetectionArchiveReader::ReadReport(size_t& nextBlock, ProtocolDetectionReport& report) const
+        {
+            using namespace std::chrono;
+            bool result = nextBlock < index.size();
+            if(result)
+            {
+                const auto& first = index[nextBlock];
+                report.frame = first.frame;
+                report.epoc = high_resolution_clock::time_point(
+                                  duration_cast<high_resolution_clock::duration>(nanoseconds(first.epoc)));
+                report.detections.clear();
+
+                // find the end of the frame
+                size_t lastBlock = nextBlock;
+                size_t numDetections = 0;
+                while(lastBlock < index.size() && index[lastBlock].frame == first.frame && index[lastBlock].epoc == first.epoc)
+                {
+                    numDetections += index[lastBlock].count;
+                    lastBlock++;
+                }
+
+                report.detections.reserve(numDetections);
+                for(; nextBlock < lastBlock && result; nextBlock++)
+                {
+                    result = ReadBlock(nextBlock, report.detections);
+                }
+            }
+
+            return result;
+        } // ReadReport
+
+    } // namespace fs
+} // namespace cqp
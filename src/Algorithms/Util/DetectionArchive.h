@@ -0,0 +1,194 @@
+/*!
+* @file
+* @brief DetectionArchive
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#pragma once
+#include "Algorithms/Datatypes/DetectionReport.h"
+#include "Algorithms/Util/MappedFile.h"
+#include <fstream>
+
+namespace cqp
+{
+    namespace fs
+    {
+        /**
+         * @brief Describes the layout of a detection archive
+         * @details
+         * An archive stores detections as columns in blocks which can each be decoded on their own.
+         * All values are little endian.
+         *
+         * | Section | Contents |
+         * | Header  | 8 byte magic "CQPDARC\1" |
+         * | Blocks  | One or more blocks for each frame |
+         * | Index   | One entry for each block |
+         * | Footer  | 8 byte index offset, 8 byte number of blocks, 8 byte magic "CQPDIDX\1" |
+         *
+         * Each block:
+         * | Bytes | Contents |
+         * | 8     | Frame number |
+         * | 8     | Epoc, nanoseconds since the clock epoc |
+         * | 4     | Number of detections |
+         * | 1     | Bits per time delta |
+         * | 3     | Reserved |
+         * | 8     | Time of the first detection in picoseconds |
+         * | n     | The difference between each time and the one before, zig-zag encoded and bit packed into 64 bit words |
+         * | n     | The detection values, 2 bits each, 4 per byte, the first value is in the bottom bits |
+         *
+         * Each index entry has the block offset, frame number, epoc, number of detections and first time.
+         * If the archive was not closed properly the index is rebuilt from the blocks.
+         */
+        namespace archive
+        {
+            /// The header at the start of the file
+            static constexpr char fileMagic[8] = {'C', 'Q', 'P', 'D', 'A', 'R', 'C', 1};
+            /// The magic at the end of the footer
+            static constexpr char indexMagic[8] = {'C', 'Q', 'P', 'D', 'I', 'D', 'X', 1};
+            /// The bytes before the packed data in a block
+            static constexpr size_t blockHeaderBytes = 32;
+            /// The bytes in each index entry
+            static constexpr size_t indexEntryBytes = 40;
+            /// The bytes in the footer
+            static constexpr size_t footerBytes = 24;
+            /// The largest detection value which can be stored
+            static constexpr Qubit maxValue = 3;
+
+            /// The details of a block
+            struct BlockInfo
+            {
+                /// Where the block starts in the file
+                uint64_t offset = 0;
+                /// The frame the detections belong to
+                SequenceNumber frame = 0;
+                /// The epoc of the frame in nanoseconds
+                int64_t epoc = 0;
+                /// The number of detections in the block
+                uint32_t count = 0;
+                /// The time of the first detection
+                PicoSeconds firstTime {0};
+            };
+        } // namespace archive
+
+        /**
+         * @brief The DetectionArchiveWriter class
+         * Writes detection reports into a compressed columnar archive.
+         * @see archive
+         */
+        class ALGORITHMS_EXPORT DetectionArchiveWriter
+        {
+        public:
+            /// The default number of detections in each block
+            static constexpr size_t defaultBlockSize = 64 * 1024;
+
+            /**
+             * @brief DetectionArchiveWriter
+             * Constructor
+             * @param blockSize The maximum number of detections in each block
+             */
+            explicit DetectionArchiveWriter(size_t blockSize = defaultBlockSize);
+
+            /// Destructor, closes the archive
+            ~DetectionArchiveWriter();
+
+            /**
+             * @brief Open
+             * Create a new archive
+             * @param fileName The file to create
+             * @return true on success
+             */
+            bool Open(const std::string& fileName);
+
+            /**
+             * @brief Write
+             * Add a report to the archive
+             * @param report The report to store, detection values must be no greater than archive::maxValue
+             * @return true on success
+             */
+            bool Write(const ProtocolDetectionReport& report);
+
+            /**
+             * @brief Close
+             * Write the index and close the file
+             * @return true on success
+             */
+            bool Close();
+
+            /// @return true if the archive is open
+            bool IsOpen() const
+            {
+                return outFile.is_open();
+            }
+
+        protected: // members
+            /// The maximum number of detections in each block
+            const size_t blockSize;
+            /// The archive
+            std::ofstream outFile;
+            /// The blocks which have been written
+            std::vector<archive::BlockInfo> index;
+            /// storage for the block being written
+            std::vector<uint8_t> buffer;
+        }; // DetectionArchiveWriter
+
+        /**
+         * @brief The DetectionArchiveReader class
+         * Reads detection reports from an archive created by DetectionArchiveWriter
+         */
+        class ALGORITHMS_EXPORT DetectionArchiveReader
+        {
+        public:
+            /**
+             * @brief Open
+             * Open an archive and read its index
+             * @param fileName The archive to read
+             * @return true on success
+             */
+            bool Open(const std::string& fileName);
+
+            /// @return The blocks in the archive
+            const std::vector<archive::BlockInfo>& GetIndex() const
+            {
+                return index;
+            }
+
+            /**
+             * @brief ReadBlock
+             * Decode a single block
+             * @param block The position of the block in the index
+             * @param[in,out] output The detections are appended to this
+             * @return true on success
+             */
+            bool ReadBlock(size_t block, DetectionReportList& output) const;
+
+            /**
+             * @brief ReadReport
+             * Read all the blocks for a frame
+             * @param[in,out] nextBlock The first block of the frame, updated to the first block of the next frame
+             * @param[out] report The frame which was read
+             * @return false if there are no more blocks or a block could not be read
+             */
+            bool ReadReport(size_t& nextBlock, ProtocolDetectionReport& report) const;
+
+        protected: // methods
+            /**
+             * @brief RebuildIndex
+             * Create the index by walking through the blocks
+             * @return true if the blocks were valid
+             */
+            bool RebuildIndex();
+
+        protected: // members
+            /// The archive
+            MappedFile file;
+            /// The blocks in the file
+            std::vector<archive::BlockInfo> index;
+        }; // DetectionArchiveReader
+
+    } // namespace fs
+} // namespace cqp
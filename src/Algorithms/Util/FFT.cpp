@@ -0,0 +1,119 @@
+/*!
+* @file
+* @brief FFT
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "FFT.h"
+#include <cmath>
+#include <utility>
+
+namespace cqp
+{
+
+    /// The number of values which are transformed together in the early stages, small enough to stay in cache
+    static constexpr size_t cacheBlockSize = 1u << 13;
+
+    size_t FFTSize(size_t minSize)
+    {
+        size_t result = 1;
+        while(result < minSize)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    bool FFT(ComplexList& values, bool inverse)
+    {
+        using namespace std;
+        const size_t size = values.size();
+        if(size == 0 || (size & (size - 1)) != 0)
+        {
+            return false;
+        }
+
+        // put the values in bit reversed order
+        for(size_t index = 1, reversed = 0; index < size; index++)
+        {
+            size_t bit = size >> 1;
+            for(; reversed & bit; bit >>= 1)
+            {
+                reversed ^= bit;
+            }
+            reversed ^= bit;
+
+            if(index < reversed)
+            {
+                swap(values[index], values[reversed]);
+            }
+        }
+
+        // the twiddle factors for each stage, the stage which combines pairs of length half starts at twiddles[half]
+        const double direction = inverse ? 1.0 : -1.0;
+        ComplexList twiddles(size);
+        for(size_t index = 0; index < size / 2; index++)
+        {
+            twiddles[size / 2 + index] = polar(1.0, direction * 2.0 * M_PI * index / size);
+        }
+        for(size_t half = size / 4; half > 0; half /= 2)
+        {
+            for(size_t index = 0; index < half; index++)
+            {
+                twiddles[half + index] = twiddles[half * 2 + index * 2];
+            }
+        }
+
+        Complex* const data = values.data();
+        // perform the butterflies for one stage over part of the values
+        auto stage = [&](size_t length, size_t first, size_t last)
+        {
+            const size_t half = length / 2;
+            const Complex* const factors = &twiddles[half];
+            for(size_t start = first; start < last; start += length)
+            {
+                Complex* const low = data + start;
+                Complex* const high = low + half;
+                for(size_t index = 0; index < half; index++)
+                {
+                    const Complex even = low[index];
+                    const Complex odd = Multiply(high[index], factors[index]);
+                    low[index] = even + odd;
+                    high[index] = even - odd;
+                }
+            }
+        };
+
+        // the early stages only touch values which are close together so do them a cache sized block at a time
+        const size_t blockSize = min(size, cacheBlockSize);
+        for(size_t first = 0; first < size; first += blockSize)
+        {
+            for(size_t length = 2; length <= blockSize; length <<= 1)
+            {
+                stage(length, first, first + blockSize);
+            }
+        }
+
+        for(size_t length = blockSize * 2; length <= size; length <<= 1)
+        {
+            stage(length, 0, size);
+        }
+
+        if(inverse)
+        {
+            const double scale = 1.0 / size;
+            for(auto& value : values)
+            {
+                value *= scale;
+            }
+        }
+
+        return true;
+    }
+
+} // namespace cqp
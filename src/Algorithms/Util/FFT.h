@@ -0,0 +1,55 @@
+/*!
+* @file
+* @brief FFT
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#pragma once
+#include "Algorithms/algorithms_export.h"
+#include <complex>
+#include <vector>
+#include <cstddef>
+
+namespace cqp
+{
+
+    /// A value for fourier transforms
+    using Complex = std::complex<double>;
+    /// A list of values for fourier transforms
+    using ComplexList = std::vector<Complex>;
+
+    /**
+     * @brief Multiply
+     * Multiply two complex numbers without the checks for infinity which std::complex performs
+     * @param left
+     * @param right
+     * @return left * right
+     */
+    inline Complex Multiply(const Complex& left, const Complex& right)
+    {
+        return Complex(left.real() * right.real() - left.imag() * right.imag(),
+                       left.real() * right.imag() + left.imag() * right.real());
+    }
+
+    /**
+     * @brief FFT
+     * Perform an in place radix-2 fast fourier transform
+     * @param[in,out] values The values to transform, the size must be a power of 2
+     * @param inverse Perform the inverse transform, the result is scaled by 1/N
+     * @return false if the size is not a power of 2
+     */
+    ALGORITHMS_EXPORT bool FFT(ComplexList& values, bool inverse = false);
+
+    /**
+     * @brief FFTSize
+     * @param minSize The number of values which need to fit
+     * @return The smallest power of 2 which is at least minSize
+     */
+    ALGORITHMS_EXPORT size_t FFTSize(size_t minSize);
+
+} // namespace cqp
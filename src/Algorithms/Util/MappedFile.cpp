@@ -0,0 +1,186 @@
+/*!
+* @file
+* @brief MappedFile
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "MappedFile.h"
+#include "Algorithms/Logging/Logger.h"
+#include <algorithm>
+#include <fstream>
+#if defined(__unix__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace cqp
+{
+    namespace fs
+    {
+
+        MappedFile::~MappedFile()
+        {
+            Close();
+        }
+
+        bool MappedFile::Open(const std::string& name)
+        {
+            Close();
+#if defined(__unix__)
+            const int handle = ::open(name.c_str(), O_RDONLY);
+            if(handle >= 0)
+            {
+                struct stat fileStat {};
+                if(::fstat(handle, &fileStat) == 0)
+                {
+                    length = static_cast<size_t>(fileStat.st_size);
+                    isOpen = true;
+                    if(length > 0)
+                    {
+                        void* mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, handle, 0);
+                        if(mapped != MAP_FAILED)
+                        {
+                            memory = static_cast<uint8_t*>(mapped);
+                            // the file is normally read from start to finish
+                            ::madvise(mapped, length, MADV_SEQUENTIAL);
+                        }
+                        else
+                        {
+                            LOGERROR("Failed to map " + name);
+                            isOpen = false;
+                            length = 0;
+                        }
+                    }
+                }
+                ::close(handle);
+            }
+#else
+            std::ifstream inFile(name, std::ios::in | std::ios::binary | std::ios::ate);
+            if(inFile)
+            {
+                buffer.resize(static_cast<size_t>(inFile.tellg()));
+                inFile.seekg(0, std::ios::beg);
+                inFile.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+                memory = buffer.data();
+                length = buffer.size();
+                isOpen = true;
+            }
+#endif
+            if(!isOpen)
+            {
+                LOGERROR("Failed to open " + name);
+            }
+            return isOpen;
+        } // Open
+
+        bool MappedFile::Create(const std::string& name, size_t newLength)
+        {
+            Close();
+            fileName = name;
+            writable = true;
+#if defined(__unix__)
+            const int handle = ::open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if(handle >= 0)
+            {
+                if(::ftruncate(handle, static_cast<off_t>(newLength)) == 0)
+                {
+                    length = newLength;
+                    isOpen = true;
+                    if(length > 0)
+                    {
+                        void* mapped = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, handle, 0);
+                        if(mapped != MAP_FAILED)
+                        {
+                            memory = static_cast<uint8_t*>(mapped);
+                        }
+                        else
+                        {
+                            LOGERROR("Failed to map " + name);
+                            isOpen = false;
+                            length = 0;
+                        }
+                    }
+                }
+                ::close(handle);
+            }
+#else
+            buffer.resize(newLength);
+            memory = buffer.data();
+            length = newLength;
+            isOpen = true;
+#endif
+            if(!isOpen)
+            {
+                LOGERROR("Failed to create " + name);
+                writable = false;
+            }
+            return isOpen;
+        } // Create
+
+        bool MappedFile::Close()
+        {
+            bool result = true;
+            if(isOpen)
+            {
+#if defined(__unix__)
+                if(memory)
+                {
+                    if(writable)
+                    {
+                        result = ::msync(memory, length, MS_SYNC) == 0;
+                    }
+                    ::munmap(memory, length);
+                }
+#else
+                if(writable)
+                {
+                    std::ofstream outFile(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+                    outFile.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+                    result = outFile.good();
+                }
+                buffer.clear();
+                buffer.shrink_to_fit();
+#endif
+                if(!result)
+                {
+                    LOGERROR("Failed to write " + fileName);
+                }
+            }
+
+            memory = nullptr;
+            length = 0;
+            isOpen = false;
+            writable = false;
+            fileName.clear();
+            return result;
+        } // Close
+
+        void MappedFile::Release(size_t offset, size_t releaseLength)
+        {
+#if defined(__unix__)
+            if(memory && !writable && offset < length)
+            {
+                // madvise needs a page aligned start
+                const auto pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+                const size_t start = offset - offset % pageSize;
+                const size_t end = std::min(length, offset + releaseLength);
+                if(end > start)
+                {
+                    ::madvise(memory + start, end - start, MADV_DONTNEED);
+                }
+            }
+#else
+            (void)offset;
+            (void)releaseLength;
+#endif
+        } // Release
+
+    } // namespace fs
+} // namespace cqp
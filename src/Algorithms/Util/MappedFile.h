@@ -0,0 +1,115 @@
+/*!
+* @file
+* @brief MappedFile
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#pragma once
+#include "Algorithms/algorithms_export.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cqp
+{
+    namespace fs
+    {
+        /**
+         * @brief The MappedFile class
+         * Provides the contents of a file as memory, the file is mapped into memory where the platform
+         * allows it, otherwise it is read into a buffer.
+         * The file is unmapped when the object is destroyed.
+         */
+        class ALGORITHMS_EXPORT MappedFile
+        {
+        public:
+            /// Default constructor
+            MappedFile() = default;
+
+            /// Destructor
+            ~MappedFile();
+
+            /// The mapping cannot be copied
+            MappedFile(const MappedFile&) = delete;
+            /// The mapping cannot be copied
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            /**
+             * @brief Open
+             * Map an existing file for reading
+             * @param fileName The file to open
+             * @return true on success
+             */
+            bool Open(const std::string& fileName);
+
+            /**
+             * @brief Create
+             * Create or truncate a file and map it for writing
+             * @param fileName The file to create
+             * @param length The size of the file in bytes
+             * @return true on success
+             */
+            bool Create(const std::string& fileName, size_t length);
+
+            /**
+             * @brief Close
+             * Unmap the file, any changes are written to the file
+             * @return true if the changes were written
+             */
+            bool Close();
+
+            /**
+             * @brief Release
+             * Tell the system that a range of the file will not be needed again so that the memory
+             * can be reused. Used when streaming through large files.
+             * @param offset The start of the range
+             * @param length The number of bytes
+             */
+            void Release(size_t offset, size_t length);
+
+            /// @return The contents of the file
+            const uint8_t* data() const noexcept
+            {
+                return memory;
+            }
+
+            /// @return The contents of the file
+            uint8_t* data() noexcept
+            {
+                return memory;
+            }
+
+            /// @return The number of bytes in the file
+            size_t size() const noexcept
+            {
+                return length;
+            }
+
+            /// @return true if a file is open
+            bool IsOpen() const noexcept
+            {
+                return isOpen;
+            }
+
+        protected: // members
+            /// The file contents
+            uint8_t* memory = nullptr;
+            /// Size of the contents
+            size_t length = 0;
+            /// Whether a file is open
+            bool isOpen = false;
+            /// whether the contents are written back to the file
+            bool writable = false;
+            /// The file being written
+            std::string fileName;
+            /// Holds the contents when the file cannot be mapped
+            std::vector<uint8_t> buffer;
+        }; // MappedFile
+
+    } // namespace fs
+} // namespace cqp
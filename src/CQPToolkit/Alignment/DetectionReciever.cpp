@@ -161,16 +161,22 @@ namespace cqp
                     grpc::Status result;
                     high_resolution_clock::time_point timerStart = high_resolution_clock::now();
 
+                    // split the detections into columns so each pass only reads what it needs
+                    const DetectionFrame frame(report->detections);
+                    // the frame now holds the detections
+                    DetectionReportList().swap(report->detections);
+
                     // isolate the transmission
-                    DetectionReportList::const_iterator start;
-                    DetectionReportList::const_iterator end;
-                    filter.Isolate(report->detections, start, end);
+                    size_t start = 0;
+                    size_t end = 0;
+                    filter.Isolate(frame, start, end);
+                    const DetectionView transmission = DetectionView(frame).Slice(start, end);
 
                     // extract the qubits
                     std::unique_ptr<QubitList> results{new QubitList()};
                     Gating::ValidSlots validSlots;
-                    gating.SetDrift(drift.Calculate(start, end));
-                    gating.ExtractQubits(start, end, validSlots, *results);
+                    gating.SetDrift(drift.Calculate(transmission));
+                    gating.ExtractQubits(transmission, validSlots, *results);
 
                     auto otherSide = remote::IAlignment::NewStub(transmitter);
 
@@ -190,14 +196,15 @@ namespace cqp
 
                         if(result.ok())
                         {
-                            align::Offsetting offsetting(0);
+                            // offsets are checked one at a time if the markers are too sparse to correlate
+                            align::Offsetting offsetting(0, align::Offsetting::Method::Correlation);
                             QubitsBySlot markers;
                             markers.reserve(response.markers().size());
                             for(const auto & marker : response.markers())
                             {
                                 markers.emplace(marker.first, marker.second);
                             }
-                            auto highest = offsetting.HighestValue(markers, validSlots, *results, 0, 1000);
+                            auto highest = offsetting.HighestValue(markers, validSlots, *results, 0, maxSlotOffset);
 
                             if(highest.value > filterMatchMinimum)
                             {
@@ -134,6 +134,8 @@ namespace cqp
             align::Drift drift;
             /// The minimum matching percentage to accept alignment
             const double filterMatchMinimum = 0.8;
+            /// The largest slot offset to search for when matching markers
+            const int64_t maxSlotOffset = 100000;
         };
 
     } // namespace align
@@ -0,0 +1,105 @@
+/*!
+* @file
+* @brief MarkerServer
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "MarkerServer.h"
+#include "Algorithms/Logging/Logger.h"
+
+namespace cqp
+{
+    namespace align
+    {
+
+        constexpr size_t MarkerServer::DefaultMaxFrames;
+
+        MarkerServer::MarkerServer(size_t maxFrames) :
+            maxFrames{maxFrames}
+        {
+        }
+
+        void MarkerServer::OnEmitterReport(std::unique_ptr<EmitterReport> report)
+        {
+            using namespace std;
+            LOGTRACE("Receiving emitter report");
+            /*lock scope*/
+            {
+                lock_guard<mutex> lock(framesMutex);
+                auto& emissions = frames[report->frame];
+                // a frame can be sent in several bursts
+                emissions.Append(report->emissions.data(), report->emissions.size());
+                nextFrame = max(nextFrame, report->frame + 1);
+
+                // the detector has given up on the oldest frames
+                while(frames.size() > maxFrames)
+                {
+                    LOGWARN("Markers for frame " + to_string(frames.begin()->first) + " were never requested");
+                    frames.erase(frames.begin());
+                }
+            } /*lock scope*/
+            framesCv.notify_all();
+
+            Emit(&IEmitterEventCallback::OnEmitterReport, move(report));
+        } // OnEmitterReport
+
+        grpc::Status MarkerServer::GetAlignmentMarkers(grpc::ServerContext* context, const remote::MarkersRequest* request, remote::MarkersResponse* response)
+        {
+            using namespace std;
+            LOGTRACE("Markers requested");
+            grpc::Status result;
+            PackedQubits emissions;
+
+            /*lock scope*/
+            {
+                unique_lock<mutex> lock(framesMutex);
+                bool dataReady = false;
+                // check for the caller giving up while waiting for the frame
+                while(!dataReady && !context->IsCancelled())
+                {
+                    dataReady = framesCv.wait_for(lock, chrono::milliseconds(100), [&]()
+                    {
+                        return frames.find(request->frameid()) != frames.end() || request->frameid() < nextFrame;
+                    });
+                }
+
+                auto frame = frames.find(request->frameid());
+                if(frame != frames.end())
+                {
+                    // the markers are only sent once, earlier frames will not be asked for
+                    emissions = move(frame->second);
+                    frames.erase(frames.begin(), ++frame);
+                }
+                else if(dataReady)
+                {
+                    result = grpc::Status(grpc::StatusCode::NOT_FOUND, "Frame " + to_string(request->frameid()) + " is not available");
+                }
+                else
+                {
+                    result = grpc::Status(grpc::StatusCode::CANCELLED, "Markers request cancelled");
+                }
+            } /*lock scope*/
+
+            if(result.ok())
+            {
+                // find how many markers to send, upto the number available
+                const auto markersToSend = min<uint64_t>(emissions.size(), request->numofmarkers());
+                auto& markers = *response->mutable_markers();
+                while(markers.size() < markersToSend)
+                {
+                    const auto index = rng.RandULong() % emissions.size();
+                    markers.insert({index, remote::BB84::Type(emissions[index])});
+                }
+                LOGDEBUG("Sent " + to_string(markersToSend) + " markers out of " + to_string(emissions.size()) + " emissions.");
+            }
+
+            return result;
+        } // GetAlignmentMarkers
+
+    } // namespace align
+} // namespace cqp
@@ -0,0 +1,77 @@
+/*!
+* @file
+* @brief MarkerServer
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#pragma once
+#include "Algorithms/Random/RandomNumber.h"
+#include "Algorithms/Datatypes/PackedQubits.h"
+#include "CQPToolkit/Interfaces/IEmitterEventPublisher.h"
+#include "Algorithms/Util/Provider.h"
+#include "QKDInterfaces/IAlignment.grpc.pb.h"
+#include "CQPToolkit/cqptoolkit_export.h"
+#include <condition_variable>
+#include <map>
+#include <mutex>
+
+namespace cqp
+{
+    namespace align
+    {
+
+        /**
+         * @brief The MarkerServer class
+         * Gives the detector a random sample of the emissions so that it can find which slot each detection belongs to.
+         * The emitter reports are passed on unchanged, the detector decides which slots are kept.
+         * @see SlotAlignment
+         */
+        class CQPTOOLKIT_EXPORT MarkerServer : public Provider<IEmitterEventCallback>,
+            public remote::IAlignment::Service,
+            public virtual IEmitterEventCallback
+        {
+        public:
+            /// The number of frames which are kept waiting for the markers to be requested
+            static constexpr size_t DefaultMaxFrames = 16;
+
+            /**
+             * @brief MarkerServer
+             * Constructor
+             * @param maxFrames The number of frames which are kept waiting for the markers to be requested,
+             * older frames are dropped
+             */
+            explicit MarkerServer(size_t maxFrames = DefaultMaxFrames);
+
+            /// @copydoc IEmitterEventCallback::OnEmitterReport
+            void OnEmitterReport(std::unique_ptr<EmitterReport> report) override;
+
+            ///@{
+            /// @name IAlignment interface
+
+            ///@copydoc remote::IAlignment::GetAlignmentMarkers
+            grpc::Status GetAlignmentMarkers(grpc::ServerContext* context, const remote::MarkersRequest* request, remote::MarkersResponse* response) override;
+            ///@}
+
+        protected: // members
+            /// The emissions for each frame which hasn't had it's markers requested
+            std::map<SequenceNumber, PackedQubits> frames;
+            /// One more than the newest frame which has been received
+            SequenceNumber nextFrame = 0;
+            /// The number of frames to keep
+            const size_t maxFrames;
+            /// A source of randomness
+            RandomNumber rng;
+
+            /// protects frames
+            std::mutex framesMutex;
+            /// used for waiting for new data to arrive
+            std::condition_variable framesCv;
+        }; // class MarkerServer
+
+    } // namespace align
+} // namespace cqp
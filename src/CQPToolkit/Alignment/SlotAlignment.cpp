@@ -0,0 +1,204 @@
+/*!
+* @file
+* @brief SlotAlignment
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "SlotAlignment.h"
+#include "QKDInterfaces/IAlignment.grpc.pb.h"
+#include "CQPToolkit/Util/GrpcLogger.h"
+#include "Algorithms/Alignment/Offsetting.h"
+#include "Algorithms/Datatypes/DetectionFrame.h"
+
+namespace cqp
+{
+    namespace align
+    {
+
+        constexpr double SlotAlignment::DefaultMarkerRatio;
+
+        SlotAlignment::SlotAlignment(const SystemParameters& parameters, const PicoSeconds& driftSampleTime,
+                                     double markerRatio) :
+            parameters{parameters},
+            markerRatio{markerRatio},
+            gating{std::make_shared<RandomNumber>(), parameters.slotWidth, parameters.pulseWidth},
+            drift(parameters.slotWidth, parameters.pulseWidth, driftSampleTime)
+        {
+        }
+
+        SlotAlignment::~SlotAlignment()
+        {
+            Disconnect();
+        }
+
+        void SlotAlignment::OnPhotonReport(std::unique_ptr<ProtocolDetectionReport> report)
+        {
+            using namespace std;
+            // collect incoming data, the work is done on our thread so that the detector isn't held up
+            LOGTRACE("Receiving photon report");
+            {
+                unique_lock<mutex> lock(accessMutex);
+                // the detector can produce frames much faster than they can be aligned,
+                // hold it up instead of letting the frames pile up on both sides
+                threadConditional.wait(lock, [&]()
+                {
+                    return receivedData.size() < maxWaitingReports || state != State::Started;
+                });
+                receivedData.push(move(report));
+            }
+            threadConditional.notify_all();
+        }
+
+        void SlotAlignment::Connect(std::shared_ptr<grpc::ChannelInterface> channel)
+        {
+            transmitter = channel;
+
+            while(!receivedData.empty())
+            {
+                receivedData.pop();
+            }
+            Start();
+        }
+
+        void SlotAlignment::Disconnect()
+        {
+            Stop(true);
+            transmitter.reset();
+            while(!receivedData.empty())
+            {
+                receivedData.pop();
+            }
+        }
+
+        void SlotAlignment::AlignSlots(const QubitsBySlot& markers, const Gating::ValidSlots& validSlots,
+                                       const QubitList& qubits, int64_t offset, uint64_t slotsPerFrame,
+                                       DetectionReportList& detections)
+        {
+            detections.clear();
+            detections.reserve(validSlots.size());
+            for(size_t index = 0; index < validSlots.size() && index < qubits.size(); index++)
+            {
+                const int64_t slot = static_cast<int64_t>(validSlots[index]) + offset;
+                // markers have been seen by everyone so they can't be used for key
+                if(slot >= 0 && (slotsPerFrame == 0 || static_cast<uint64_t>(slot) < slotsPerFrame) &&
+                        markers.find(static_cast<SlotID>(slot)) == markers.end())
+                {
+                    detections.push_back({PicoSeconds(slot), qubits[index]});
+                }
+            }
+        } // AlignSlots
+
+        grpc::Status SlotAlignment::Align(ProtocolDetectionReport& report)
+        {
+            using namespace std;
+            grpc::Status result;
+
+            // split the detections into columns so each pass only reads what it needs
+            const DetectionFrame frame(report.detections);
+            // the frame now holds the detections
+            DetectionReportList().swap(report.detections);
+
+            // the whole frame is transmission, extract the qubits
+            QubitList qubits;
+            Gating::ValidSlots validSlots;
+            gating.SetDrift(drift.Calculate(frame));
+            gating.ExtractQubits(frame, validSlots, qubits);
+
+            if(validSlots.empty())
+            {
+                result = grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, "No detections in frame " + to_string(report.frame));
+            }
+            else
+            {
+                auto otherSide = remote::IAlignment::NewStub(transmitter);
+                grpc::ClientContext ctx;
+                remote::MarkersRequest request;
+                remote::MarkersResponse response;
+
+                request.set_frameid(report.frame);
+                request.set_sendallbasis(false);
+                request.set_numofmarkers(static_cast<uint64_t>((validSlots.back() - validSlots.front() + 1) * markerRatio));
+                result = LogStatus(otherSide->GetAlignmentMarkers(&ctx, request, &response));
+
+                if(result.ok())
+                {
+                    QubitsBySlot markers;
+                    markers.reserve(response.markers().size());
+                    for(const auto& marker : response.markers())
+                    {
+                        markers.emplace(marker.first, static_cast<Qubit>(marker.second));
+                    }
+
+                    // the markers are too sparse to check each offset one at a time
+                    Offsetting offsetting(offsetSamples, Offsetting::Method::Correlation);
+                    const auto highest = offsetting.HighestValue(markers, validSlots, qubits, 0, maxSlotOffset);
+
+                    if(highest.value > matchMinimum)
+                    {
+                        AlignSlots(markers, validSlots, qubits, highest.offset, parameters.slotsPerFrame, report.detections);
+                    }
+                    else
+                    {
+                        LOGERROR("Match of " + to_string(highest.value) + " is too low to generate key");
+                        result = grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, "Can't find match");
+                    }
+                }
+            }
+
+            return result;
+        } // Align
+
+        void SlotAlignment::DoWork()
+        {
+            using namespace std;
+            while(!ShouldStop())
+            {
+                unique_ptr<ProtocolDetectionReport> report;
+
+                /*lock scope*/
+                {
+                    unique_lock<mutex> lock(accessMutex);
+                    bool dataReady = false;
+                    threadConditional.wait(lock, [&]()
+                    {
+                        dataReady = !receivedData.empty();
+                        return dataReady || state != State::Started;
+                    });
+
+                    if(dataReady)
+                    {
+                        report = move(receivedData.front());
+                        receivedData.pop();
+                    }
+                } /*lock scope*/
+
+                if(report)
+                {
+                    // let the detector continue
+                    threadConditional.notify_all();
+
+                    using std::chrono::high_resolution_clock;
+                    const auto timerStart = high_resolution_clock::now();
+
+                    if(!report->detections.empty() && !Align(*report).ok())
+                    {
+                        // the frame is still passed on so that the emitter can drop it too
+                        report->detections.clear();
+                    }
+
+                    stats.timeTaken.Update(high_resolution_clock::now() - timerStart);
+                    stats.overhead.Update(0.0L);
+                    stats.qubitsProcessed.Update(report->detections.size());
+
+                    Emit(&IDetectionEventCallback::OnPhotonReport, move(report));
+                }
+            } // while keepGoing
+        } // DoWork
+
+    } // namespace align
+} // namespace cqp
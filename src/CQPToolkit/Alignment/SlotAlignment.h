@@ -0,0 +1,147 @@
+/*!
+* @file
+* @brief SlotAlignment
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#pragma once
+#include "CQPToolkit/Alignment/Stats.h"
+#include "Algorithms/Random/RandomNumber.h"
+#include "CQPToolkit/Interfaces/IDetectionEventPublisher.h"
+#include "CQPToolkit/Interfaces/IRemoteComms.h"
+#include "CQPToolkit/cqptoolkit_export.h"
+#include "Algorithms/Util/Provider.h"
+#include <Algorithms/Util/WorkerThread.h>
+#include "Algorithms/Alignment/Gating.h"
+#include "Algorithms/Alignment/Drift.h"
+#include "Algorithms/Datatypes/Framing.h"
+#include <grpc++/channel.h>
+
+namespace cqp
+{
+    namespace align
+    {
+
+        /**
+         * @brief The SlotAlignment class
+         * Turns raw time tags into detections which are indexed by the slot they were emitted in.
+         * @details
+         * The drift is removed and the detections are gated, a sample of the emissions is then
+         * requested from the MarkerServer to find the offset between the detector slots and the emitter slots.
+         * The detections in the reports which are passed on have the emitter slot id as their time,
+         * the slots which were sent as markers are removed.
+         * A report with no detections is passed on if the frame can't be aligned so that both sides
+         * drop the frame together.
+         * OnPhotonReport blocks while too many reports are waiting to be aligned.
+         * @see MarkerServer
+         */
+        class CQPTOOLKIT_EXPORT SlotAlignment : public Provider<IDetectionEventCallback>,
+        /* Interfaces */
+            public virtual IDetectionEventCallback,
+            public virtual IRemoteComms,
+            protected WorkerThread
+        {
+        public:
+            /// The number of markers requested, as a fraction of the slots covered by the detections
+            static constexpr double DefaultMarkerRatio = 0.05;
+
+            /**
+             * @brief SlotAlignment
+             * Constructor
+             * @param parameters The slot width and jitter of the system,
+             * detections which are aligned beyond slotsPerFrame are dropped unless it's 0
+             * @param driftSampleTime The time over which each drift sample is taken, it needs to be shorter than a frame
+             * @param markerRatio The number of markers requested, as a fraction of the slots covered by the detections
+             */
+            SlotAlignment(const SystemParameters& parameters, const PicoSeconds& driftSampleTime,
+                          double markerRatio = DefaultMarkerRatio);
+
+            /// destructor
+            ~SlotAlignment() override;
+
+            /// @{
+            /// @name IDetectionEventCallback Interface
+
+            /// @copydoc IDetectionEventCallback::OnPhotonReport
+            void OnPhotonReport(std::unique_ptr<ProtocolDetectionReport> report) override;
+
+            /// @}
+
+            ///@{
+            /// @name IRemoteComms interface
+
+            /**
+             * @brief Connect Connect to the MarkerServer on the other side
+             * @param channel
+             */
+            void Connect(std::shared_ptr<grpc::ChannelInterface> channel) override;
+
+            /**
+             * @brief Disconnect
+             */
+            void Disconnect() override;
+
+            ///@}
+
+            /**
+             * @brief AlignSlots
+             * Replace the detector slots with the emitter slots
+             * @param markers The emissions sent by the MarkerServer, indexed by emitter slot
+             * @param validSlots The detector slots of the qubits, in ascending order
+             * @param qubits The detected values
+             * @param offset Added to the detector slot to get the emitter slot
+             * @param slotsPerFrame The number of emitter slots in a frame, 0 for no limit
+             * @param[out] detections The qubits with the emitter slot as their time, markers and slots outside the frame are left out
+             */
+            static void AlignSlots(const QubitsBySlot& markers, const Gating::ValidSlots& validSlots,
+                                   const QubitList& qubits, int64_t offset, uint64_t slotsPerFrame,
+                                   DetectionReportList& detections);
+
+            /// Statistics collected by this class
+            Statistics stats;
+
+        protected: // methods
+            /**
+             * @brief DoWork
+             * Align the reports as they arrive
+             */
+            void DoWork() override;
+
+            /**
+             * @brief Align
+             * Replace the detections with ones indexed by emitter slot
+             * @param[in,out] report The time tags to align, the detections are empty on failure
+             * @return The status of the request for markers
+             */
+            grpc::Status Align(ProtocolDetectionReport& report);
+
+        protected: // members
+            /// storage for incoming data
+            ProtocolDetectionReportList receivedData;
+            /// The other side of the conversation
+            std::shared_ptr<grpc::ChannelInterface> transmitter;
+            /// The slot width and jitter of the system
+            const SystemParameters parameters;
+            /// The number of markers requested, as a fraction of the slots covered by the detections
+            const double markerRatio;
+            /// For extracting the real detections from the noise
+            Gating gating;
+            /// for calculating drift
+            Drift drift;
+            /// The minimum matching percentage to accept alignment
+            const double matchMinimum = 0.8;
+            /// The largest slot offset to search for when matching markers
+            const int64_t maxSlotOffset = 100000;
+            /// The number of detections compared with the markers, enough to overlap with plenty of markers
+            const size_t offsetSamples = 4000;
+            /// The number of reports which can wait to be aligned before the detector is held up
+            const size_t maxWaitingReports = 4;
+        }; // class SlotAlignment
+
+    } // namespace align
+} // namespace cqp
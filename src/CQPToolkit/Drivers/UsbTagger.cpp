@@ -14,7 +14,9 @@
 #include "CQPToolkit/Drivers/Usb.h"
 #include "CQPToolkit/Drivers/Serial.h"
 #include "Algorithms/Util/DataFile.h"
+#include "Algorithms/Util/DetectionArchive.h"
 #include "Algorithms/Util/ProcessingQueue.h"
+#include "Algorithms/Datatypes/LockFreeQueue.h"
 #include "Algorithms/Util/Threading.h"
 #include "QKDInterfaces/Device.pb.h"
 
@@ -32,7 +34,7 @@ namespace cqp
      * @startuml
         participant "Usb" as usb
         participant "DataPusher" as dp
-        participant "data : queue" as data
+        participant "data : SpscQueue" as data
         participant "report" as report
         boundary "IDetectionEventCallback" as listener
 
@@ -115,6 +117,12 @@ namespace cqp
 
         void ReturnBuffer(DataBlockPtr buffer);
 
+        /**
+         * @brief SetArchive
+         * @param newArchive Where to record reports before they are sent, null to stop recording
+         */
+        void SetArchive(fs::DetectionArchiveWriter* newArchive);
+
     protected: // members
 
         void ReadDataAsync(std::unique_ptr<DataBlock> data);
@@ -129,17 +137,25 @@ namespace cqp
         /// how channels are mapped to qubits
         const std::vector<Qubit>& channelMappings;
 
-        std::mutex unusedQueueMutex;
+        /// The number of buffers which can wait to be processed
+        static constexpr size_t maxQueuedBuffers = 64;
+        /// Only used by Stop to wait for processing to finish
         std::mutex processingQueueMutex;
         std::condition_variable dataReadyCv;
         std::unique_ptr<ProtocolDetectionReport> report;
         std::atomic_bool shutdown {false};
         bool keepReading = true;
         std::thread processor;
-        std::queue<DataBlockPtr> unusedBuffers;
-        std::queue<DataBlockPtr> processingQueue;
+        /// Empty buffers for the reader
+        MpmcQueue<DataBlockPtr> unusedBuffers {maxQueuedBuffers};
+        /// Buffers from the reader for the converter
+        SpscQueue<DataBlockPtr> processingQueue {maxQueuedBuffers};
+        /// Buffers which have been read but not converted
+        std::atomic<size_t> unprocessed {0};
         SequenceNumber frame = 1;
         ::libusb_transfer* activeTransfer = nullptr;
+        /// Where reports are recorded, protected by processingQueueMutex
+        fs::DetectionArchiveWriter* archive = nullptr;
     };
 
     // ******* DataPusher methods **************
@@ -214,9 +230,14 @@ namespace cqp
             unique_lock<mutex> lock(processingQueueMutex);
             dataReadyCv.wait(lock, [&]()
             {
-                return processingQueue.empty();
+                return unprocessed == 0;
             });
 
+            if(archive && report && !archive->Write(*report))
+            {
+                LOGERROR("Failed to archive frame " + std::to_string(report->frame));
+            }
+
             if(provider)
             {
                 if(report)
@@ -249,15 +270,12 @@ namespace cqp
     {
         activeTransfer = nullptr;
 
+        unprocessed++;
+        // move the data onto the processing queue, this wakes the converter
+        while(!processingQueue.Push(move(data), chrono::seconds(1)))
         {
-            /*lock scope*/
-            unique_lock<mutex> lock(processingQueueMutex);
-            // move the data onto the processing queue
-            processingQueue.push(move(data));
-        }/*lock scope*/
-
-        // trigger the converter to process it
-        dataReadyCv.notify_all();
+            LOGWARN("Detection processing is falling behind");
+        }
 
         if(!shutdown && keepReading)
         {
@@ -272,56 +290,24 @@ namespace cqp
     {
         LOGTRACE("");
         using NoxReport = fs::DataFile::NoxReport;
-        NoxReport devReport;
         DataBlockPtr data;
 
         while(!shutdown)
         {
-            {
-                /*lock scope*/
-                unique_lock<mutex> lock(processingQueueMutex);
-                dataReadyCv.wait(lock, [&]()
-                {
-                    return !processingQueue.empty() || shutdown;
-                });
-
-                if(!shutdown)
-                {
-                    data = move(processingQueue.front());
-                    // dont pop yet, do it when we've finished
-                }
-            }/*lock scope*/
+            // wake up periodically to check for shutdown
+            processingQueue.Pop(data, chrono::milliseconds(100));
 
             if(data && report)
             {
                 LOGTRACE("Processing data");
                 if(data->size() % NoxReport::messageBytes == 0)
                 {
-                    const auto numDetections = data->size() / NoxReport::messageBytes;
-                    // reserve space for the new items
-                    report->detections.reserve(report->detections.size() + numDetections);
-
-                    for(size_t offset = 0u; offset < data->size(); offset += NoxReport::messageBytes)
+                    // decode the whole transfer at once
+                    const size_t dropped = fs::DataFile::DecodeNoxDetections(channelMappings, data->data(), data->size(), report->detections);
+                    if(dropped > 0)
                     {
-                        // read the report
-                        if(devReport.LoadRaw(&(*data)[offset]))
-                        {
-                            if(devReport.messageType == NoxReport::MessageType::Detection &&
-                                    devReport.detection.channel < channelMappings.size())
-                            {
-                                report->detections.push_back({devReport.GetTime(), channelMappings[devReport.detection.channel]});
-                            }
-                            else if(devReport.messageType == NoxReport::MessageType::Config)
-                            {
-                                //LOGINFO("Got Config message");
-                            }
-                            else
-                            {
-                                LOGERROR("Invalid message");
-                            }
-                        } // if report valid
-
-                    } // for each message
+                        LOGERROR(std::to_string(dropped) + " invalid messages");
+                    }
                 }
                 else
                 {
@@ -333,15 +319,17 @@ namespace cqp
                 ReturnBuffer(move(data));
                 data.reset();
 
+                if(--unprocessed == 0)
                 {
-                    /*lock scope*/
-                    unique_lock<mutex> lock(processingQueueMutex);
-                    processingQueue.pop();
-                }/*lock scope*/
+                    {
+                        /*lock scope*/
+                        // make sure Stop is either waiting or hasn't checked yet
+                        lock_guard<mutex> lock(processingQueueMutex);
+                    }/*lock scope*/
+                    // trigger anything waiting for us to finish
+                    dataReadyCv.notify_one();
+                }
             } // if data
-
-            // trigger anything waiting for us to finish
-            dataReadyCv.notify_one();
         }// while !stopProcessing
 
     } // ConvertData
@@ -352,20 +340,11 @@ namespace cqp
         using namespace std;
         DataBlockPtr result;
 
+        if(!unusedBuffers.TryPop(result))
         {
-            /* lock scope*/
-            unique_lock<mutex> lock(unusedQueueMutex);
-            if(unusedBuffers.empty())
-            {
-                // there are no free buffers, make another
-                result = make_unique<DataBlock>(maxBulkRead);
-            }
-            else
-            {
-                result = move(unusedBuffers.front());
-                unusedBuffers.pop();
-            }
-        }/* lock scope*/
+            // there are no free buffers, make another
+            result = make_unique<DataBlock>(maxBulkRead);
+        }
 
         // prepare the buffer for receiving data
         result->resize(maxBulkRead);
@@ -373,14 +352,20 @@ namespace cqp
         return result;
     }
 
+    void UsbTagger::DataPusher::SetArchive(fs::DetectionArchiveWriter* newArchive)
+    {
+        lock_guard<mutex> lock(processingQueueMutex);
+        archive = newArchive;
+    }
+
     void UsbTagger::DataPusher::ReturnBuffer(UsbTagger::DataPusher::DataBlockPtr buffer)
     {
         LOGTRACE("");
         using namespace std;
         buffer->clear();
         buffer->resize(maxBulkRead);
-        unique_lock<mutex> lock(unusedQueueMutex);
-        unusedBuffers.push(move(buffer));
+        // if there are already plenty of spare buffers this one is freed
+        unusedBuffers.TryPush(move(buffer));
     }
 
     // ******* UsbTagger methods **************
@@ -536,4 +521,27 @@ namespace cqp
     {
         channelMappings = mapping;
     }
+
+    bool UsbTagger::SetArchive(const std::string& fileName)
+    {
+        bool result = true;
+        // stop the old archive being used before it's closed
+        if(dataPusher)
+        {
+            dataPusher->SetArchive(nullptr);
+        }
+        archive.reset();
+
+        if(!fileName.empty())
+        {
+            archive = make_unique<fs::DetectionArchiveWriter>();
+            result = archive->Open(fileName);
+            if(result && dataPusher)
+            {
+                dataPusher->SetArchive(archive.get());
+            }
+        }
+
+        return result;
+    }
 } // namespace cqp
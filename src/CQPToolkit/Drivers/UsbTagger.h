@@ -25,6 +25,10 @@ namespace cqp
     {
         class DeviceConfig;
     }
+    namespace fs
+    {
+        class DetectionArchiveWriter;
+    }
     class Usb;
 
     /// Class for controlling the "RWN 11" time tagger and coincidence counter built at UOB.
@@ -92,6 +96,15 @@ namespace cqp
          */
         void SetChannelMappings(const std::vector<Qubit>& mapping);
 
+        /**
+         * @brief SetArchive
+         * Record every detection report to an archive before it is passed on
+         * @see fs::DetectionArchiveWriter
+         * @param fileName The archive to create, empty to stop recording
+         * @return true if the archive was created
+         */
+        bool SetArchive(const std::string& fileName);
+
     protected: // members
         /// Impl class for managing the incomming data
         class DataPusher;
@@ -100,6 +113,8 @@ namespace cqp
         std::unique_ptr<Serial> configPort;
         /// Transfers the results using bulk transfer
         std::unique_ptr<Usb> dataPort;
+        /// Where the reports are recorded, must outlive dataPusher
+        std::unique_ptr<fs::DetectionArchiveWriter> archive;
         /// pulls data from the device and proceses it
         std::unique_ptr<DataPusher> dataPusher;
 
@@ -0,0 +1,361 @@
+/*!
+* @file
+* @brief Cascade
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "Cascade.h"
+#include <random>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include "Algorithms/Logging/Logger.h"
+
+namespace cqp
+{
+    namespace ec
+    {
+
+        uint64_t CascadeParameters::InitialBlockSize(double qber, uint64_t numBits)
+        {
+            // Too few errors to measure, assume a low error rate rather than one huge block
+            const double minimumQber = 0.005;
+            const uint64_t minimumBlockSize = 4;
+
+            const double errorRate = std::max(qber, minimumQber);
+            // this should leave 0.73 errors in each block on average
+            uint64_t result = static_cast<uint64_t>(std::ceil(0.73 / errorRate));
+
+            result = std::max(result, minimumBlockSize);
+            if(numBits > 0)
+            {
+                result = std::min(result, numBits);
+            }
+            return result;
+        }
+
+        CascadeKey::CascadeKey(const JaggedDataBlock& data, const CascadeParameters& parameters) :
+            parameters{parameters},
+            numBits{data.NumBits()}
+        {
+            if(numBits > std::numeric_limits<uint32_t>::max())
+            {
+                LOGERROR("Frame too large for cascade, truncating");
+                numBits = std::numeric_limits<uint32_t>::max();
+            }
+
+            shuffled.resize(parameters.passes);
+            positions.resize(parameters.passes);
+            indexes.resize(parameters.passes);
+
+            if(parameters.passes > 0)
+            {
+                shuffled[0] = PackBits(data);
+                shuffled[0].resize((numBits + bitsPerWord - 1) / bitsPerWord);
+            }
+
+            for(uint32_t pass = 1; pass < parameters.passes; pass++)
+            {
+                // mt19937_64 produces the same sequence on every platform for a given seed
+                // so both sides will produce the same shuffle
+                std::mt19937_64 shuffleRng(parameters.seed + pass);
+                auto& passPositions = positions[pass];
+                auto& passIndexes = indexes[pass];
+
+                passPositions.resize(numBits);
+                for(uint32_t index = 0; index < numBits; index++)
+                {
+                    passPositions[index] = index;
+                }
+
+                // Fisher-Yates, avoiding std::shuffle as its output is implementation defined
+                for(uint64_t index = numBits; index > 1; index--)
+                {
+                    const uint64_t other = shuffleRng() % index;
+                    std::swap(passPositions[index - 1], passPositions[other]);
+                }
+
+                passIndexes.resize(numBits);
+                auto& bits = shuffled[pass];
+                bits.resize(shuffled[0].size(), 0);
+
+                for(uint32_t index = 0; index < numBits; index++)
+                {
+                    passIndexes[passPositions[index]] = index;
+                    if(GetBit(shuffled[0], passPositions[index]))
+                    {
+                        FlipBit(bits, index);
+                    }
+                }
+            }
+        }
+
+        bool CascadeKey::Parity(const ParityBlock& block) const
+        {
+            bool result = false;
+            if(block.pass < shuffled.size() && block.start + block.length <= numBits)
+            {
+                result = RangeParity(shuffled[block.pass], block.start, block.length);
+            }
+            else
+            {
+                LOGERROR("Invalid parity block");
+            }
+            return result;
+        }
+
+        void CascadeKey::PassParities(uint32_t pass, std::vector<bool>& parities) const
+        {
+            const uint64_t blockSize = parameters.BlockSize(pass);
+            const uint64_t numBlocks = NumBlocks(pass);
+            parities.reserve(parities.size() + numBlocks);
+
+            for(uint64_t block = 0; block < numBlocks; block++)
+            {
+                const uint64_t start = block * blockSize;
+                parities.push_back(RangeParity(shuffled[pass], start, std::min(blockSize, numBits - start)));
+            }
+        }
+
+        uint64_t CascadeKey::NumBlocks(uint32_t pass) const
+        {
+            const uint64_t blockSize = parameters.BlockSize(pass);
+            return (numBits + blockSize - 1) / blockSize;
+        }
+
+        uint64_t CascadeKey::Position(uint32_t pass, uint64_t index) const
+        {
+            uint64_t result = index;
+            if(pass > 0)
+            {
+                result = positions[pass][index];
+            }
+            return result;
+        }
+
+        uint64_t CascadeKey::ShuffledIndex(uint32_t pass, uint64_t position) const
+        {
+            uint64_t result = position;
+            if(pass > 0)
+            {
+                result = indexes[pass][position];
+            }
+            return result;
+        }
+
+        void CascadeKey::Flip(uint64_t position)
+        {
+            if(!shuffled.empty())
+            {
+                FlipBit(shuffled[0], position);
+            }
+
+            for(uint32_t pass = 1; pass < shuffled.size(); pass++)
+            {
+                FlipBit(shuffled[pass], indexes[pass][position]);
+            }
+        }
+
+        JaggedDataBlock CascadeKey::GetKey() const
+        {
+            JaggedDataBlock result;
+            if(!shuffled.empty())
+            {
+                result = UnpackBits(shuffled[0], numBits);
+            }
+            return result;
+        }
+
+        CascadeCorrector::CascadeCorrector(CascadeKey& key) :
+            key{key}
+        {
+            const auto passes = key.GetParameters().passes;
+            theirParities.resize(passes);
+            mismatched.resize(passes);
+            searching.resize(passes);
+
+            if(key.NumBits() > 0)
+            {
+                // The top level parities don't depend on any corrections so get them all at once
+                for(uint32_t pass = 0; pass < passes; pass++)
+                {
+                    queries.wholePasses.push_back(pass);
+                }
+            }
+        }
+
+        bool CascadeCorrector::SetAnswers(const std::vector<bool>& parities)
+        {
+            size_t expected = queries.blocks.size();
+            for(auto pass : queries.wholePasses)
+            {
+                expected += key.NumBlocks(pass);
+            }
+
+            if(parities.size() != expected)
+            {
+                LOGERROR("Expected " + std::to_string(expected) + " parities, got " + std::to_string(parities.size()));
+                return false;
+            }
+
+            rounds++;
+            paritiesExchanged += parities.size();
+
+            auto answerIt = parities.begin();
+            for(auto pass : queries.wholePasses)
+            {
+                const auto numBlocks = key.NumBlocks(pass);
+                theirParities[pass].assign(answerIt, answerIt + static_cast<std::ptrdiff_t>(numBlocks));
+                answerIt += static_cast<std::ptrdiff_t>(numBlocks);
+            }
+            queries.wholePasses.clear();
+
+            // Move every search on by one step using our key as it was when the question was asked
+            std::vector<Search> completed;
+            std::vector<Search> stillSearching;
+            stillSearching.reserve(searches.size());
+
+            for(size_t index = 0; index < searches.size(); index++, answerIt++)
+            {
+                Search search = searches[index];
+                const ParityBlock& asked = queries.blocks[index];
+
+                if(*answerIt != key.Parity(asked))
+                {
+                    // the error is in the first half
+                    search.range.length = asked.length;
+                }
+                else
+                {
+                    // the error is in the second half
+                    search.range.start += asked.length;
+                    search.range.length -= asked.length;
+                }
+
+                if(search.range.length == 1)
+                {
+                    completed.push_back(search);
+                }
+                else
+                {
+                    stillSearching.push_back(search);
+                }
+            }
+
+            for(const auto& search : completed)
+            {
+                // the block may have been fixed by a search in another pass which found the same bit
+                if(searching[search.range.pass][search.topBlock])
+                {
+                    searching[search.range.pass][search.topBlock] = false;
+                    ApplyFlip(key.Position(search.range.pass, search.range.start));
+                }
+            }
+
+            // drop any searches whose block was changed by a correction
+            searches.clear();
+            for(const auto& search : stillSearching)
+            {
+                if(searching[search.range.pass][search.topBlock])
+                {
+                    searches.push_back(search);
+                }
+            }
+
+            PrepareQueries();
+            return true;
+        }
+
+        void CascadeCorrector::ApplyFlip(uint64_t position)
+        {
+            key.Flip(position);
+            errorsCorrected++;
+
+            for(uint32_t pass = 0; pass < passesStarted; pass++)
+            {
+                const auto block = key.ShuffledIndex(pass, position) / key.GetParameters().BlockSize(pass);
+                mismatched[pass][block] = !mismatched[pass][block];
+                // any search on this block can no longer be trusted
+                searching[pass][block] = false;
+            }
+        }
+
+        void CascadeCorrector::StartSearches()
+        {
+            bool changed = true;
+            while(changed)
+            {
+                changed = false;
+                for(uint32_t pass = 0; pass < passesStarted; pass++)
+                {
+                    const uint64_t blockSize = key.GetParameters().BlockSize(pass);
+                    for(uint64_t block = 0; block < mismatched[pass].size(); block++)
+                    {
+                        if(mismatched[pass][block] && !searching[pass][block])
+                        {
+                            const uint64_t start = block * blockSize;
+                            const uint64_t length = std::min(blockSize, key.NumBits() - start);
+                            if(length == 1)
+                            {
+                                // no need to ask, this is the bit
+                                ApplyFlip(key.Position(pass, start));
+                                changed = true;
+                            }
+                            else
+                            {
+                                searching[pass][block] = true;
+                                searches.push_back({block, {pass, start, length}});
+                            }
+                        }
+                    }
+                }
+
+                if(changed)
+                {
+                    // flipping may have invalidated searches
+                    searches.erase(std::remove_if(searches.begin(), searches.end(), [&](const Search& search)
+                    {
+                        return !searching[search.range.pass][search.topBlock];
+                    }), searches.end());
+                }
+            }
+        }
+
+        void CascadeCorrector::PrepareQueries()
+        {
+            StartSearches();
+
+            // move on to the next pass once everything is consistent
+            while(searches.empty() && passesStarted < theirParities.size())
+            {
+                const uint32_t pass = passesStarted;
+                std::vector<bool> ourParities;
+                key.PassParities(pass, ourParities);
+
+                mismatched[pass].resize(ourParities.size());
+                searching[pass].assign(ourParities.size(), false);
+                for(size_t block = 0; block < ourParities.size(); block++)
+                {
+                    mismatched[pass][block] = ourParities[block] != theirParities[pass][block];
+                }
+
+                passesStarted++;
+                StartSearches();
+            }
+
+            queries.blocks.clear();
+            queries.blocks.reserve(searches.size());
+            for(const auto& search : searches)
+            {
+                // ask for the first half of the range
+                queries.blocks.push_back({search.range.pass, search.range.start, search.range.length / 2});
+            }
+        }
+
+    } // namespace ec
+} // namespace cqp
@@ -0,0 +1,312 @@
+/*!
+* @file
+* @brief Cascade
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "Algorithms/Datatypes/Base.h"
+#include "Algorithms/Util/Bits.h"
+#include "CQPToolkit/cqptoolkit_export.h"
+
+namespace cqp
+{
+    namespace ec
+    {
+        /// The settings which both sides must agree on before running cascade on a frame
+        struct CascadeParameters
+        {
+            /// seed for the shuffles between passes
+            uint64_t seed = 0;
+            /// number of passes to perform
+            uint32_t passes = 4;
+            /// the block size for the first pass, it is doubled for each subsequent pass
+            uint64_t initialBlockSize = 16;
+
+            /**
+             * @brief BlockSize
+             * @param pass pass number starting from 0
+             * @return The size of the top level blocks for the pass
+             */
+            uint64_t BlockSize(uint32_t pass) const
+            {
+                return initialBlockSize << pass;
+            }
+
+            /**
+             * @brief InitialBlockSize
+             * Choose the block size for the first pass from the expected error rate
+             * @param qber Expected fraction of bits in error
+             * @param numBits The length of the key
+             * @return A block size which will contain ~0.73 errors
+             */
+            static uint64_t InitialBlockSize(double qber, uint64_t numBits);
+        };
+
+        /// A contiguous range of bits in the shuffled key of a pass
+        struct ParityBlock
+        {
+            /// The pass which this block belongs to
+            uint32_t pass;
+            /// first bit of the range in the shuffled key
+            uint64_t start;
+            /// The number of bits in the range
+            uint64_t length;
+        };
+
+        /// A batch of parity queries which can be answered in one round trip
+        struct ParityQueries
+        {
+            /// passes for which the parity of every top level block is needed
+            std::vector<uint32_t> wholePasses;
+            /// individual ranges to check
+            std::vector<ParityBlock> blocks;
+
+            /**
+             * @brief empty
+             * @return true if there are no queries
+             */
+            bool empty() const
+            {
+                return wholePasses.empty() && blocks.empty();
+            }
+        };
+
+        /**
+         * @brief The CascadeKey class
+         * Holds a bit packed key along with a shuffled copy for each pass so that the parity of
+         * any block can be calculated with a few whole word operations
+         */
+        class CQPTOOLKIT_EXPORT CascadeKey
+        {
+        public:
+            /**
+             * @brief CascadeKey
+             * Constructor
+             * @param data The sifted key
+             * @param parameters settings for shuffling the key
+             */
+            CascadeKey(const JaggedDataBlock& data, const CascadeParameters& parameters);
+
+            /**
+             * @brief NumBits
+             * @return The length of the key
+             */
+            uint64_t NumBits() const
+            {
+                return numBits;
+            }
+
+            /**
+             * @brief Parity
+             * @param block The range to check
+             * @return true if the range has odd parity
+             */
+            bool Parity(const ParityBlock& block) const;
+
+            /**
+             * @brief PassParities
+             * Calculate the parity of all top level blocks in a pass
+             * @param pass The pass to use
+             * @param[out] parities The parities are appended to this list
+             */
+            void PassParities(uint32_t pass, std::vector<bool>& parities) const;
+
+            /**
+             * @brief NumBlocks
+             * @param pass The pass to use
+             * @return The number of top level blocks in the pass
+             */
+            uint64_t NumBlocks(uint32_t pass) const;
+
+            /**
+             * @brief Position
+             * @param pass The pass to use
+             * @param index Bit index in the shuffled key
+             * @return The bit index in the original key
+             */
+            uint64_t Position(uint32_t pass, uint64_t index) const;
+
+            /**
+             * @brief ShuffledIndex
+             * @param pass The pass to use
+             * @param position Bit index in the original key
+             * @return The index of the bit in the shuffled key
+             */
+            uint64_t ShuffledIndex(uint32_t pass, uint64_t position) const;
+
+            /**
+             * @brief Flip
+             * Invert a bit in the key and all the shuffled copies
+             * @param position Bit index in the original key
+             */
+            void Flip(uint64_t position);
+
+            /**
+             * @brief GetKey
+             * @return The current key
+             */
+            JaggedDataBlock GetKey() const;
+
+            /**
+             * @brief GetParameters
+             * @return The settings used to create the key
+             */
+            const CascadeParameters& GetParameters() const
+            {
+                return parameters;
+            }
+
+        protected:
+            /// settings used to create the key
+            CascadeParameters parameters;
+            /// number of valid bits
+            uint64_t numBits = 0;
+            /// the key, shuffled for each pass, pass 0 is unshuffled
+            std::vector<PackedBits> shuffled;
+            /// maps shuffled index to original position for each pass > 0
+            std::vector<std::vector<uint32_t>> positions;
+            /// maps original position to shuffled index for each pass > 0
+            std::vector<std::vector<uint32_t>> indexes;
+        };
+
+        /**
+         * @brief The CascadeCorrector class
+         * Runs the cascade protocol on the side which is being corrected.
+         * All binary searches which are in progress move forward together so each step costs
+         * one round trip no matter how many blocks are being searched.
+         * @details
+         * @code
+         * CascadeCorrector corrector(key);
+         * while(!corrector.Complete())
+         * {
+         *     auto answers = AskOtherSide(corrector.GetQueries());
+         *     corrector.SetAnswers(answers);
+         * }
+         * @endcode
+         */
+        class CQPTOOLKIT_EXPORT CascadeCorrector
+        {
+        public:
+            /**
+             * @brief CascadeCorrector
+             * Constructor
+             * @param key The key to correct, must outlive this object
+             */
+            explicit CascadeCorrector(CascadeKey& key);
+
+            /**
+             * @brief GetQueries
+             * @return The parities needed from the other side to move on
+             */
+            const ParityQueries& GetQueries() const
+            {
+                return queries;
+            }
+
+            /**
+             * @brief SetAnswers
+             * Process the other sides parities for the current queries and prepare the next set
+             * @param parities One value for each top level block of each whole pass,
+             * followed by one value for each block in the order of the queries.
+             * @return false if the answers are the wrong size
+             */
+            bool SetAnswers(const std::vector<bool>& parities);
+
+            /**
+             * @brief Complete
+             * @return true once all passes have been performed
+             */
+            bool Complete() const
+            {
+                return queries.empty();
+            }
+
+            /**
+             * @brief ErrorsCorrected
+             * @return The number of bits which have been flipped
+             */
+            uint64_t ErrorsCorrected() const
+            {
+                return errorsCorrected;
+            }
+
+            /**
+             * @brief ParitiesExchanged
+             * @return The number of parity bits disclosed by the other side
+             */
+            uint64_t ParitiesExchanged() const
+            {
+                return paritiesExchanged;
+            }
+
+            /**
+             * @brief Rounds
+             * @return The number of times the queries have been answered
+             */
+            uint64_t Rounds() const
+            {
+                return rounds;
+            }
+
+        protected:
+            /// A binary search over part of a top level block which is known to have odd error parity
+            struct Search
+            {
+                /// the top level block the search started from
+                uint64_t topBlock;
+                /// the range which contains an odd number of errors
+                ParityBlock range;
+            };
+
+            /**
+             * @brief ApplyFlip
+             * Correct a bit and update the state of all top level blocks which contain it
+             * @param position Bit index in the original key
+             */
+            void ApplyFlip(uint64_t position);
+
+            /**
+             * @brief StartSearches
+             * Begin a search on every mismatched top level block which isn't already being searched
+             */
+            void StartSearches();
+
+            /**
+             * @brief PrepareQueries
+             * Build the queries for the searches which are in progress,
+             * moving on to the next pass when there is nothing left to do
+             */
+            void PrepareQueries();
+
+            /// The key being corrected
+            CascadeKey& key;
+            /// The queries waiting for answers
+            ParityQueries queries;
+            /// the searches waiting for the current queries to be answered
+            std::vector<Search> searches;
+            /// The other sides top level parities for each started pass
+            std::vector<std::vector<bool>> theirParities;
+            /// Whether the each top level block currently has a different parity to the other side
+            std::vector<std::vector<bool>> mismatched;
+            /// whether a search is running for each top level block
+            std::vector<std::vector<bool>> searching;
+            /// The number of passes which have been started
+            uint32_t passesStarted = 0;
+            /// statistics
+            uint64_t errorsCorrected = 0;
+            /// statistics
+            uint64_t paritiesExchanged = 0;
+            /// statistics
+            uint64_t rounds = 0;
+        };
+
+    } // namespace ec
+} // namespace cqp
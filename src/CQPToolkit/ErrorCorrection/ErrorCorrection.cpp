@@ -11,59 +11,622 @@
 */
 #include "ErrorCorrection.h"
 #include <cstddef>                             // for size_t
+#include <algorithm>                           // for count
 #include <ratio>                               // for ratio
 #include "CQPToolkit/ErrorCorrection/Stats.h"  // for Stats
+#include "CQPToolkit/Util/GrpcLogger.h"        // for LogStatus
 #include "Algorithms/Statistics/Stat.h"                   // for Stat
 #include "Algorithms/Logging/Logger.h"                       // for LOGTRACE
+#include "Algorithms/Util/Strings.h"                         // for ToLower
 
 namespace cqp
 {
     namespace ec
     {
+        /// The most passes the other side is allowed to ask for
+        static const uint32_t maxPasses = 16;
 
-        void ErrorCorrection::PublishCorrected()
+        /// The most efficient LDPC codes that will be tried
+        static const double minEfficiency = 1.05;
+        /// The least efficient LDPC codes that will be used
+        static const double maxEfficiency = 2.0;
+
+        /**
+         * @brief PackFlags
+         * Store flags one bit each
+         * @param flags values to store
+         * @return flags packed least significant bit first
+         */
+        static std::string PackFlags(const std::vector<bool>& flags)
         {
-            using namespace std::chrono;
-            using std::chrono::high_resolution_clock;
-            // record the start time
-            high_resolution_clock::time_point timerStart = high_resolution_clock::now();
+            std::string packed((flags.size() + 7) / 8, '\0');
+            for(size_t index = 0; index < flags.size(); index++)
+            {
+                if(flags[index])
+                {
+                    packed[index / 8] = static_cast<char>(packed[index / 8] | (1 << (index % 8)));
+                }
+            }
+            return packed;
+        }
+
+        /**
+         * @brief UnpackFlags
+         * @param packed the packed flags
+         * @param numFlags The number of flags stored in packed
+         * @return one bool for each flag
+         */
+        static std::vector<bool> UnpackFlags(const std::string& packed, size_t numFlags)
+        {
+            numFlags = std::min<size_t>(numFlags, packed.size() * 8);
+            std::vector<bool> result(numFlags);
+
+            for(size_t index = 0; index < numFlags; index++)
+            {
+                result[index] = (static_cast<uint8_t>(packed[index / 8]) >> (index % 8)) & 1u;
+            }
+            return result;
+        }
 
-            // package data ready for next stage
-            // TODO
-            SequenceNumber id = 0;
-            std::unique_ptr<DataBlock> corrected(new DataBlock);
-            // publish the corrected data
-            Emit(&IErrorCorrectCallback::OnCorrected, id, move(corrected));
+        /**
+         * @brief KeepBlocks
+         * Remove the blocks which couldn't be decoded
+         * @param bits The whole frame, padded to a whole number of blocks
+         * @param numBits The number of valid bits in bits
+         * @param blockLength The length of each block, a multiple of 64
+         * @param keep Which blocks to keep
+         * @return The kept blocks, joined together
+         */
+        static JaggedDataBlock KeepBlocks(const PackedBits& bits, size_t numBits, size_t blockLength, const std::vector<bool>& keep)
+        {
+            const size_t blockWords = blockLength / bitsPerWord;
+            PackedBits kept;
+            size_t keptBits = 0;
+            kept.reserve(bits.size());
 
-            // example stat publish
-            stats.TimeTaken.Update(high_resolution_clock::now() - timerStart);
-            stats.Errors.Update(0.0L);
+            for(size_t block = 0; block < keep.size(); block++)
+            {
+                if(keep[block])
+                {
+                    // all blocks start on a word boundary so they can be copied whole
+                    kept.insert(kept.end(), bits.begin() + static_cast<std::ptrdiff_t>(block * blockWords),
+                                bits.begin() + static_cast<std::ptrdiff_t>((block + 1) * blockWords));
+                    keptBits += std::min(blockLength, numBits - block * blockLength);
+                }
+            }
+            return UnpackBits(kept, keptBits);
+        }
 
+        ErrorCorrection::Mode ErrorCorrection::ParseMode(const std::string& name, Mode fallback)
+        {
+            Mode result = fallback;
+            const std::string lowerName = ToLower(name);
+            if(lowerName == ModeName(Mode::Cascade))
+            {
+                result = Mode::Cascade;
+            }
+            else if(lowerName == ModeName(Mode::Ldpc))
+            {
+                result = Mode::Ldpc;
+            }
+            else if(!name.empty())
+            {
+                LOGERROR("Unknown error correction mode: " + name);
+            }
+            return result;
+        }
+
+        std::string ErrorCorrection::ModeName(Mode mode)
+        {
+            std::string result;
+            switch (mode)
+            {
+            case Mode::Cascade:
+                result = "cascade";
+                break;
+            case Mode::Ldpc:
+                result = "ldpc";
+                break;
+            }
+            return result;
+        }
+
+        ErrorCorrection::ErrorCorrection(remote::Side::Type side, Mode mode) :
+            side{side},
+            mode{mode}
+        {
+            if(mode == Mode::Ldpc && side == remote::Side::Bob)
+            {
+                decoders.reset(new ProcessingQueue<bool>());
+            }
+        }
+
+        void ErrorCorrection::PublishCorrected(SequenceNumber id, const JaggedDataBlock& corrected, uint64_t errors, uint64_t bitsLeaked,
+                                               std::chrono::high_resolution_clock::duration timeTaken)
+        {
+            LOGTRACE("Publishing corrected frame " + std::to_string(id));
+            // package data ready for next stage, the next stage works in whole bytes so a partial last byte is dropped
+            auto end = corrected.end();
+            if(corrected.bitsInLastByte != 0 && !corrected.empty())
+            {
+                --end;
+            }
+            std::unique_ptr<DataBlock> correctedData(new DataBlock(corrected.begin(), end));
+            // publish the corrected data, the sifted frame id is the same on both sides
+            Emit(&IErrorCorrectCallback::OnCorrected, id, errors, bitsLeaked, move(correctedData));
+
+            stats.TimeTaken.Update(timeTaken);
+            stats.Errors.Update(errors);
+            stats.BitsLeaked.Update(bitsLeaked);
+            if(corrected.NumBits() > 0)
+            {
+                stats.QBER.Update(100.0 * static_cast<double>(errors) / static_cast<double>(corrected.NumBits()));
+            }
         } // PublishCorrected
 
-        void ErrorCorrection::OnSifted(const SequenceNumber id, double securityParmeter, std::unique_ptr<JaggedDataBlock> siftedData)
+        void ErrorCorrection::OnSifted(const SequenceNumber id, double, std::unique_ptr<JaggedDataBlock> siftedData)
         {
             LOGTRACE("Sifted data received");
-            // collect incoming data, notify listeners of new data
-            // TODO
-            //receivedDataCv.notify_one();
-            // just pass it on
-            std::unique_ptr<DataBlock> corrected(new DataBlock);
-            corrected->resize(siftedData->size());
-            std::copy(siftedData->begin(), siftedData->end(), corrected->begin());
-            Emit(&IErrorCorrectCallback::OnCorrected, id, move(corrected));
-
-            ecSeqId++;
+            /*lock scope*/
+            {
+                std::lock_guard<std::mutex> lock(siftedMutex);
+                if(siftedFrames.find(id) == siftedFrames.end())
+                {
+                    siftedFrames[id] = move(siftedData);
+                }
+                else
+                {
+                    LOGERROR("Duplicate sifted frame ID");
+                }
+            }/*lock scope*/
+
+            siftedCv.notify_all();
         } // OnSifted
 
-        void ErrorCorrection::Connect(std::shared_ptr<grpc::ChannelInterface>)
+        std::unique_ptr<JaggedDataBlock> ErrorCorrection::WaitForSifted(SequenceNumber id)
+        {
+            std::unique_ptr<JaggedDataBlock> result;
+            std::unique_lock<std::mutex> lock(siftedMutex);
+            // The other side may have finished sifting before us
+            const bool dataReady = siftedCv.wait_for(lock, receiveTimeout, [&]()
+            {
+                return siftedFrames.find(id) != siftedFrames.end();
+            });
+
+            if(dataReady)
+            {
+                result = move(siftedFrames[id]);
+                // the other side has given up on any earlier frames
+                siftedFrames.erase(siftedFrames.begin(), siftedFrames.upper_bound(id));
+            }
+            return result;
+        } // WaitForSifted
+
+        grpc::Status ErrorCorrection::GetParities(grpc::ServerContext*, const remote::ParityRequest* request, remote::ParityResponse* response)
+        {
+            using namespace std;
+            using std::chrono::high_resolution_clock;
+            grpc::Status result;
+            const SequenceNumber id = request->frameid();
+            CascadeKey* key = nullptr;
+            unique_ptr<JaggedDataBlock> newFrame;
+
+            /*lock scope*/
+            {
+                lock_guard<mutex> lock(siftedMutex);
+                auto active = activeFrames.find(id);
+                if(active != activeFrames.end())
+                {
+                    key = active->second.key.get();
+                }
+            }/*lock scope*/
+
+            if(!key && request->has_parameters())
+            {
+                // This is the start of a new frame, the sifted data may not have reached us yet
+                newFrame = WaitForSifted(id);
+            }
+
+            if(newFrame)
+            {
+                const auto& theirParams = request->parameters();
+                if(theirParams.passes() == 0 || theirParams.passes() > maxPasses || theirParams.initialblocksize() == 0)
+                {
+                    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Invalid cascade parameters");
+                }
+
+                CascadeParameters params;
+                params.seed = theirParams.seed();
+                params.passes = theirParams.passes();
+                params.initialBlockSize = theirParams.initialblocksize();
+
+                FrameState frame;
+                frame.started = high_resolution_clock::now();
+                // Building the shuffles is the expensive part, do it without holding the lock
+                frame.key.reset(new CascadeKey(*newFrame, params));
+                key = frame.key.get();
+
+                lock_guard<mutex> lock(siftedMutex);
+                // the other side has given up on any earlier frames
+                activeFrames.erase(activeFrames.begin(), activeFrames.lower_bound(id));
+                activeFrames[id] = move(frame);
+            }
+
+            // The frame can only be removed by the other side completing it,
+            // which it wont do until this request returns, so key is safe to use unlocked
+            if(key)
+            {
+                vector<bool> parities;
+                for(const auto pass : request->wholepasses())
+                {
+                    if(pass < key->GetParameters().passes)
+                    {
+                        key->PassParities(pass, parities);
+                    }
+                    else
+                    {
+                        return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Invalid pass");
+                    }
+                }
+
+                if(request->pass().size() != request->start().size() || request->pass().size() != request->length().size())
+                {
+                    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Mismatched block lists");
+                }
+
+                parities.reserve(parities.size() + static_cast<size_t>(request->pass().size()));
+                for(int index = 0; index < request->pass().size(); index++)
+                {
+                    parities.push_back(key->Parity({request->pass(index), request->start(index), request->length(index)}));
+                }
+
+                response->set_parities(PackFlags(parities));
+                response->set_numparities(parities.size());
+            }
+            else
+            {
+                result = grpc::Status(grpc::StatusCode::NOT_FOUND, "No sifted data for frame " + to_string(id));
+            }
+
+            return result;
+        } // GetParities
+
+        grpc::Status ErrorCorrection::CorrectionComplete(grpc::ServerContext*, const remote::CascadeResult* request, google::protobuf::Empty*)
+        {
+            using std::chrono::high_resolution_clock;
+            grpc::Status result;
+            FrameState frame;
+
+            /*lock scope*/
+            {
+                std::lock_guard<std::mutex> lock(siftedMutex);
+                auto active = activeFrames.find(request->frameid());
+                if(active != activeFrames.end())
+                {
+                    frame = std::move(active->second);
+                    activeFrames.erase(active);
+                }
+            }/*lock scope*/
+
+            if(frame.key)
+            {
+                // our key was never changed, it's the reference
+                PublishCorrected(request->frameid(), frame.key->GetKey(), request->errors(), request->bitsleaked(),
+                                 high_resolution_clock::now() - frame.started);
+            }
+            else
+            {
+                result = grpc::Status(grpc::StatusCode::NOT_FOUND, "Unknown frame " + std::to_string(request->frameid()));
+            }
+
+            return result;
+        } // CorrectionComplete
+
+        bool ErrorCorrection::CorrectFrame(SequenceNumber id, const JaggedDataBlock& siftedData)
         {
-            ecSeqId = 0;
+            using std::chrono::high_resolution_clock;
+            // record the start time
+            const high_resolution_clock::time_point timerStart = high_resolution_clock::now();
+            bool result = otherSide != nullptr;
+
+            if(!result)
+            {
+                LOGERROR("No error correction peer");
+            }
+            else if(siftedData.NumBits() == 0)
+            {
+                LOGWARN("Empty sifted frame");
+                result = false;
+            }
+
+            if(result)
+            {
+                CascadeParameters params;
+                params.seed = rng.RandULong();
+                params.passes = passes;
+                params.initialBlockSize = CascadeParameters::InitialBlockSize(expectedQber, siftedData.NumBits());
+
+                CascadeKey key(siftedData, params);
+                CascadeCorrector corrector(key);
+                bool firstRequest = true;
+
+                while(result && !corrector.Complete())
+                {
+                    remote::ParityRequest request;
+                    remote::ParityResponse response;
+                    const ParityQueries& queries = corrector.GetQueries();
+
+                    request.set_frameid(id);
+                    if(firstRequest)
+                    {
+                        // tell the other side how to shuffle its key
+                        request.mutable_parameters()->set_seed(params.seed);
+                        request.mutable_parameters()->set_passes(params.passes);
+                        request.mutable_parameters()->set_initialblocksize(params.initialBlockSize);
+                        firstRequest = false;
+                    }
+
+                    for(const auto pass : queries.wholePasses)
+                    {
+                        request.add_wholepasses(pass);
+                    }
+
+                    request.mutable_pass()->Reserve(static_cast<int>(queries.blocks.size()));
+                    request.mutable_start()->Reserve(static_cast<int>(queries.blocks.size()));
+                    request.mutable_length()->Reserve(static_cast<int>(queries.blocks.size()));
+                    for(const auto& block : queries.blocks)
+                    {
+                        request.add_pass(block.pass);
+                        request.add_start(block.start);
+                        request.add_length(block.length);
+                    }
+
+                    grpc::ClientContext ctx;
+                    result = LogStatus(otherSide->GetParities(&ctx, request, &response)).ok() &&
+                             corrector.SetAnswers(UnpackFlags(response.parities(), response.numparities()));
+                } // while not complete
+
+                if(result)
+                {
+                    remote::CascadeResult cascadeResult;
+                    google::protobuf::Empty response;
+                    grpc::ClientContext ctx;
+
+                    cascadeResult.set_frameid(id);
+                    cascadeResult.set_errors(corrector.ErrorsCorrected());
+                    cascadeResult.set_bitsleaked(corrector.ParitiesExchanged());
+                    result = LogStatus(otherSide->CorrectionComplete(&ctx, cascadeResult, &response)).ok();
+                }
+
+                if(result)
+                {
+                    // the next frame will probably have a similar error rate
+                    expectedQber = static_cast<double>(corrector.ErrorsCorrected()) / static_cast<double>(key.NumBits());
+                    stats.RoundTrips.Update(corrector.Rounds() + 1);
+                    PublishCorrected(id, key.GetKey(), corrector.ErrorsCorrected(), corrector.ParitiesExchanged(),
+                                     high_resolution_clock::now() - timerStart);
+                }
+                else
+                {
+                    LOGERROR("Failed to correct frame " + std::to_string(id));
+                }
+            }
+
+            return result;
+        } // CorrectFrame
+
+        bool ErrorCorrection::SendSyndromes(SequenceNumber id, const JaggedDataBlock& siftedData)
+        {
+            using std::chrono::high_resolution_clock;
+            const high_resolution_clock::time_point timerStart = high_resolution_clock::now();
+            const uint32_t numChecks = codes.ChecksFor(expectedQber, ldpcEfficiency);
+            const auto code = codes.GetCode(numChecks);
+            bool result = decoderSide != nullptr && code != nullptr;
+
+            if(!decoderSide)
+            {
+                LOGERROR("No error correction peer");
+            }
+            else if(siftedData.NumBits() == 0)
+            {
+                LOGWARN("Empty sifted frame");
+                result = false;
+            }
+
+            if(result)
+            {
+                const size_t blockLength = codes.BlockLength();
+                const size_t blockWords = blockLength / bitsPerWord;
+                const size_t numBlocks = (siftedData.NumBits() + blockLength - 1) / blockLength;
+
+                // the end of the last block is padded with 0 which the other side will do too
+                PackedBits bits = PackBits(siftedData);
+                bits.resize(numBlocks * blockWords, 0);
+
+                remote::SyndromeFrame request;
+                remote::DecodeResult response;
+                request.set_frameid(id);
+                request.mutable_parameters()->set_seed(codes.Seed());
+                request.mutable_parameters()->set_blocklength(codes.BlockLength());
+                request.mutable_parameters()->set_numchecks(numChecks);
+                request.mutable_parameters()->set_qber(expectedQber);
+                request.set_numbits(siftedData.NumBits());
+
+                std::string* syndromes = request.mutable_syndromes();
+                syndromes->reserve(numBlocks * ((numChecks + 7) / 8));
+                for(size_t block = 0; block < numBlocks; block++)
+                {
+                    const JaggedDataBlock syndrome = UnpackBits(code->Syndrome(bits, block * blockWords), numChecks);
+                    syndromes->append(syndrome.begin(), syndrome.end());
+                }
+
+                grpc::ClientContext ctx;
+                result = LogStatus(decoderSide->DecodeFrame(&ctx, request, &response)).ok();
+
+                if(result)
+                {
+                    const std::vector<bool> decoded = UnpackFlags(response.decoded(), numBlocks);
+                    const size_t numDecoded = static_cast<size_t>(std::count(decoded.begin(), decoded.end(), true));
+                    const JaggedDataBlock corrected = KeepBlocks(bits, siftedData.NumBits(), blockLength, decoded);
+
+                    // rate adaption: back off quickly when blocks fail, creep towards the limit when they don't
+                    if(numDecoded < numBlocks)
+                    {
+                        ldpcEfficiency = std::min(ldpcEfficiency + 0.05, maxEfficiency);
+                        stats.DecodeFailures.Update(numBlocks - numDecoded);
+                    }
+                    else
+                    {
+                        ldpcEfficiency = std::max(ldpcEfficiency - 0.01, minEfficiency);
+                    }
+
+                    if(corrected.NumBits() > 0)
+                    {
+                        expectedQber = static_cast<double>(response.errors()) / static_cast<double>(corrected.NumBits());
+                        stats.RoundTrips.Update(1);
+                        PublishCorrected(id, corrected, response.errors(), numDecoded * numChecks,
+                                         high_resolution_clock::now() - timerStart);
+                    }
+                    else
+                    {
+                        LOGWARN("No blocks decoded for frame " + std::to_string(id));
+                        result = false;
+                    }
+                }
+                else
+                {
+                    LOGERROR("Failed to correct frame " + std::to_string(id));
+                }
+            }
+
+            return result;
+        } // SendSyndromes
+
+        grpc::Status ErrorCorrection::DecodeFrame(grpc::ServerContext*, const remote::SyndromeFrame* request, remote::DecodeResult* response)
+        {
+            using namespace std;
+            using std::chrono::high_resolution_clock;
+            const high_resolution_clock::time_point timerStart = high_resolution_clock::now();
+            const auto& params = request->parameters();
+
+            if(!decoders || params.seed() != codes.Seed() || params.blocklength() != codes.BlockLength())
+            {
+                return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Incompatible LDPC codes");
+            }
+
+            const auto code = codes.GetCode(params.numchecks());
+            if(!code)
+            {
+                return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Invalid number of checks");
+            }
+
+            const unique_ptr<JaggedDataBlock> frame = WaitForSifted(request->frameid());
+            if(!frame)
+            {
+                return grpc::Status(grpc::StatusCode::NOT_FOUND, "No sifted data for frame " + to_string(request->frameid()));
+            }
+
+            const size_t blockLength = codes.BlockLength();
+            const size_t blockWords = blockLength / bitsPerWord;
+            const size_t numBits = frame->NumBits();
+            const size_t numBlocks = (numBits + blockLength - 1) / blockLength;
+            const size_t syndromeBytes = (params.numchecks() + 7) / 8;
+
+            if(request->numbits() != numBits || request->syndromes().size() != numBlocks * syndromeBytes)
+            {
+                return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Frame does not match");
+            }
+
+            PackedBits bits = PackBits(*frame);
+            bits.resize(numBlocks * blockWords, 0);
+            const PackedBits original = bits;
+
+            vector<future<bool>> results;
+            results.reserve(numBlocks);
+            for(size_t block = 0; block < numBlocks; block++)
+            {
+                // each block has it's own words in bits so they can be decoded in parallel
+                results.emplace_back(decoders->Enqueue([&, block]()
+                {
+                    const auto first = request->syndromes().begin() + static_cast<ptrdiff_t>(block * syndromeBytes);
+                    JaggedDataBlock syndrome;
+                    syndrome.assign(first, first + static_cast<ptrdiff_t>(syndromeBytes));
+                    syndrome.bitsInLastByte = static_cast<uint8_t>(params.numchecks() % 8);
+
+                    // the padding at the end of the last block is known to both sides
+                    const size_t blockEnd = (block + 1) * blockLength;
+                    const uint32_t knownBits = static_cast<uint32_t>(blockEnd > numBits ? blockEnd - numBits : 0);
+
+                    MinSumDecoder decoder(*code);
+                    return decoder.Decode(bits, block * blockWords, PackBits(syndrome), params.qber(), knownBits);
+                }));
+            }
+
+            vector<bool> decoded(numBlocks);
+            uint64_t errors = 0;
+            for(size_t block = 0; block < numBlocks; block++)
+            {
+                decoded[block] = results[block].get();
+                if(decoded[block])
+                {
+                    for(size_t word = block * blockWords; word < (block + 1) * blockWords; word++)
+                    {
+                        errors += PopCount(bits[word] ^ original[word]);
+                    }
+                }
+                else
+                {
+                    stats.DecodeFailures.Update(1);
+                }
+            }
+
+            const JaggedDataBlock corrected = KeepBlocks(bits, numBits, blockLength, decoded);
+            response->set_frameid(request->frameid());
+            response->set_decoded(PackFlags(decoded));
+            response->set_errors(errors);
+
+            if(corrected.NumBits() > 0)
+            {
+                const auto numDecoded = static_cast<uint64_t>(count(decoded.begin(), decoded.end(), true));
+                PublishCorrected(request->frameid(), corrected, errors, numDecoded * params.numchecks(),
+                                 high_resolution_clock::now() - timerStart);
+            }
+
+            return grpc::Status();
+        } // DecodeFrame
+
+        void ErrorCorrection::Connect(std::shared_ptr<grpc::ChannelInterface> channel)
+        {
+            /*lock scope*/
+            {
+                std::lock_guard<std::mutex> lock(siftedMutex);
+                siftedFrames.clear();
+                activeFrames.clear();
+            }/*lock scope*/
+
+            if(mode == Mode::Cascade && side == remote::Side::Bob)
+            {
+                // we drive the correction
+                otherSide = remote::ICascade::NewStub(channel);
+                Start();
+            }
+            else if(mode == Mode::Ldpc && side == remote::Side::Alice)
+            {
+                // we send the syndromes
+                decoderSide = remote::ILdpc::NewStub(channel);
+                Start();
+            }
         }
 
         void ErrorCorrection::Disconnect()
         {
-            ecSeqId = 0;
+            Stop(true);
+            otherSide = nullptr;
+            decoderSide = nullptr;
+
+            std::lock_guard<std::mutex> lock(siftedMutex);
+            siftedFrames.clear();
+            activeFrames.clear();
         }
 
         void ErrorCorrection::DoWork()
@@ -71,24 +634,38 @@ namespace cqp
             using namespace std;
             while(!ShouldStop())
             {
-                unique_lock<mutex> lock(accessMutex);
-                bool dataReady = false;
-                threadConditional.wait(lock, [&]
+                SequenceNumber id = 0;
+                unique_ptr<JaggedDataBlock> frame;
+
+                /*lock scope*/
                 {
-                    // check if data is ready
-                    return false || state == State::Stop; // TODO
-                });
+                    unique_lock<mutex> lock(siftedMutex);
+                    const bool dataReady = siftedCv.wait_for(lock, threadTimeout, [&]
+                    {
+                        return !siftedFrames.empty();
+                    });
 
-                if(dataReady)
+                    if(dataReady)
+                    {
+                        // frames are processed in order
+                        id = siftedFrames.begin()->first;
+                        frame = move(siftedFrames.begin()->second);
+                        siftedFrames.erase(siftedFrames.begin());
+                    }
+                }/*lock scope*/
+
+                if(frame)
                 {
-                    // TODO
                     // Converse with the other side
-                    //SequenceNumber id = 0;
-                    DataBlock parities;
-                    //verifier->NotifyDataParity(id, parities);
-
-                    PublishCorrected();
-                } // if(dataReady)
+                    if(mode == Mode::Ldpc)
+                    {
+                        SendSyndromes(id, *frame);
+                    }
+                    else
+                    {
+                        CorrectFrame(id, *frame);
+                    }
+                } // if(frame)
             } // while(!ShouldStop())
         } // DoWork
     } // namespace ec
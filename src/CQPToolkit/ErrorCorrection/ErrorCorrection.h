@@ -13,6 +13,7 @@
 #include <chrono>                                          // for seconds
 #include <condition_variable>                              // for condition_...
 #include <mutex>                                           // for mutex
+#include <map>                                             // for map
 #include "CQPToolkit/ErrorCorrection/Stats.h"              // for Stats
 #include "CQPToolkit/Interfaces/IErrorCorrectPublisher.h"  // for IErrorCorr...
 #include "CQPToolkit/Interfaces/ISiftedPublisher.h"        // for ISiftedCal...
@@ -20,7 +21,14 @@
 #include "Algorithms/Util/WorkerThread.h"                  // for WorkerThread
 #include "Algorithms/Datatypes/Base.h"                                // for SequenceNu...
 #include "QKDInterfaces/IErrorCorrect.grpc.pb.h"           // for IErrorCorrect
+#include "QKDInterfaces/Site.pb.h"                         // for Side
+#include "CQPToolkit/ICascade.grpc.pb.h"                   // for ICascade
+#include "CQPToolkit/ILdpc.grpc.pb.h"                      // for ILdpc
+#include "CQPToolkit/ErrorCorrection/Cascade.h"
+#include "CQPToolkit/ErrorCorrection/Ldpc.h"
+#include "Algorithms/Util/ProcessingQueue.h"
 #include "CQPToolkit/Interfaces/IRemoteComms.h"
+#include "Algorithms/Random/RandomNumber.h"
 
 
 namespace cqp
@@ -29,22 +37,54 @@ namespace cqp
     {
         /**
          * @brief The ErrorCorrection class
-         * Common code for error correction
+         * Corrects sifted frames using either the cascade protocol or one way LDPC codes.
+         * @details
+         * With cascade, Bob drives the protocol, asking Alice for the parities of blocks of her key,
+         * Alice only answers the questions and publishes her key once Bob is done.
+         * With LDPC, Alice sends the syndromes of her key in one message and Bob decodes each block
+         * on it's own thread, blocks which cannot be decoded are dropped by both sides.
          */
         class CQPTOOLKIT_EXPORT ErrorCorrection :
         /* Interfaces */
             virtual public ISiftedCallback, virtual public remote::IErrorCorrect::Service,
+            public remote::ICascade::Service, public remote::ILdpc::Service,
         /* parents */
             public Provider<IErrorCorrectCallback>, protected WorkerThread,
             public virtual IRemoteComms
         {
         public:
+            /// The protocols which can be used to correct the key
+            enum class Mode
+            {
+                /// Interactive, Bob asks Alice for parities
+                Cascade,
+                /// One way, Alice sends syndromes to Bob
+                Ldpc
+            };
 
             /**
-             * @brief Alignment
+             * @brief ErrorCorrection
              * Constructor
+             * @param side Bob corrects his key to match Alice's
+             * @param mode The protocol to use, both sides must use the same mode
+             */
+            explicit ErrorCorrection(remote::Side::Type side = remote::Side::Alice, Mode mode = Mode::Cascade);
+
+            /**
+             * @brief ParseMode
+             * Convert a setting, such as a url parameter, into a mode
+             * @param name "cascade" or "ldpc", case insensitive
+             * @param fallback The mode to use if name is empty or not recognised
+             * @return The mode named
              */
-            ErrorCorrection() = default;
+            static Mode ParseMode(const std::string& name, Mode fallback = Mode::Cascade);
+
+            /**
+             * @brief ModeName
+             * @param mode The mode to name
+             * @return The name of the mode as accepted by ParseMode
+             */
+            static std::string ModeName(Mode mode);
 
             /**
              * @brief ~ErrorCorrection
@@ -57,7 +97,11 @@ namespace cqp
 
             /**
              * @brief PublishCorrected
-             *
+             * @param id The sifted frame which has been corrected
+             * @param corrected The error free key
+             * @param errors number of bits which were changed
+             * @param bitsLeaked The number of parity bits disclosed
+             * @param timeTaken How long it took to correct the frame
              * @startuml PublishCorrectedBehaviour
              * [-> ErrorCorrection : PublishCorrected
              * activate ErrorCorrection
@@ -65,7 +109,8 @@ namespace cqp
              * deactivate ErrorCorrection
              * @enduml
              */
-            void PublishCorrected();
+            void PublishCorrected(SequenceNumber id, const JaggedDataBlock& corrected, uint64_t errors, uint64_t bitsLeaked,
+                                  std::chrono::high_resolution_clock::duration timeTaken);
 
             /// @{
             /// @name ISiftCallback Interface
@@ -87,6 +132,58 @@ namespace cqp
 
             /// @}
 
+            /// @{
+            /// @name remote::ICascade interface
+
+            /**
+             * @copydoc remote::ICascade::GetParities
+             * @param context Connection details from the server
+             * @return Status
+             * @details
+             * @startuml GetParitiesBehaviour
+             * [-> ErrorCorrection : GetParities
+             * activate ErrorCorrection
+             *  ErrorCorrection -> ErrorCorrection : Wait for sifted frame
+             *  ErrorCorrection -> CascadeKey : Parity
+             * [<-- ErrorCorrection : parities
+             * deactivate ErrorCorrection
+             * @enduml
+             */
+            grpc::Status GetParities(grpc::ServerContext* context, const remote::ParityRequest* request, remote::ParityResponse* response) override;
+
+            /**
+             * @copydoc remote::ICascade::CorrectionComplete
+             * @param context Connection details from the server
+             * @return Status
+             */
+            grpc::Status CorrectionComplete(grpc::ServerContext* context, const remote::CascadeResult* request, google::protobuf::Empty*) override;
+
+            /// @}
+
+            /// @{
+            /// @name remote::ILdpc interface
+
+            /**
+             * @copydoc remote::ILdpc::DecodeFrame
+             * @param context Connection details from the server
+             * @return Status
+             * @details
+             * @startuml DecodeFrameBehaviour
+             * [-> ErrorCorrection : DecodeFrame
+             * activate ErrorCorrection
+             *  ErrorCorrection -> ErrorCorrection : Wait for sifted frame
+             *  loop for each block
+             *      ErrorCorrection ->> ProcessingQueue : Enqueue(Decode)
+             *  end loop
+             *  ErrorCorrection -> ErrorCorrection : PublishCorrected
+             * [<-- ErrorCorrection : decoded blocks
+             * deactivate ErrorCorrection
+             * @enduml
+             */
+            grpc::Status DecodeFrame(grpc::ServerContext* context, const remote::SyndromeFrame* request, remote::DecodeResult* response) override;
+
+            /// @}
+
             /// @{
             /// @name IRemoteComms interface
 
@@ -114,8 +211,76 @@ namespace cqp
 
             /// @}
 
-            /// sequence id for the packet of data passed to the next stage
-            SequenceNumber ecSeqId = 0;
+            /**
+             * @brief CorrectFrame
+             * Run cascade on a frame against the other side
+             * @param id The frame to correct
+             * @param siftedData The frame data
+             * @return true if the frame was corrected
+             */
+            bool CorrectFrame(SequenceNumber id, const JaggedDataBlock& siftedData);
+
+            /**
+             * @brief SendSyndromes
+             * Have the other side decode a frame with LDPC codes
+             * @param id The frame to correct
+             * @param siftedData The frame data
+             * @return true if any of the frame was corrected
+             */
+            bool SendSyndromes(SequenceNumber id, const JaggedDataBlock& siftedData);
+
+            /**
+             * @brief WaitForSifted
+             * Take a frame from siftedFrames, waiting for it to arrive if needed.
+             * Any earlier frames are discarded.
+             * @param id The frame to wait for
+             * @return The frame or null if it did not arrive in time
+             */
+            std::unique_ptr<JaggedDataBlock> WaitForSifted(SequenceNumber id);
+
+            /// Which side of the exchange we are
+            const remote::Side::Type side;
+            /// The protocol being used
+            const Mode mode;
+            /// the number of passes to use
+            uint32_t passes = 4;
+            /// expected error rate of the next frame, updated from the result of each frame
+            double expectedQber = 0.05;
+            /// How long to wait for sifted data when the other side asks about it
+            std::chrono::milliseconds receiveTimeout {500};
+            /// How long to wait for new data before checking if the thread should be stopped
+            const std::chrono::seconds threadTimeout {1};
+
+            /// The other side when we are correcting
+            std::unique_ptr<remote::ICascade::Stub> otherSide;
+            /// The other side when we are sending syndromes
+            std::unique_ptr<remote::ILdpc::Stub> decoderSide;
+            /// The codes used in LDPC mode
+            LdpcCodeFamily codes;
+            /// How many more syndrome bits than the shannon limit to send, adjusted from the decoding results
+            double ldpcEfficiency = 1.4;
+            /// Threads for decoding the blocks of a frame in parallel
+            std::unique_ptr<ProcessingQueue<bool>> decoders;
+            /// source of shuffle seeds
+            RandomNumber rng;
+
+            /// protects sifted data
+            std::mutex siftedMutex;
+            /// used for waiting for new data to arrive
+            std::condition_variable siftedCv;
+            /// frames waiting to be corrected
+            std::map<SequenceNumber, std::unique_ptr<JaggedDataBlock>> siftedFrames;
+
+            /// The state of a frame being corrected by the other side
+            struct FrameState
+            {
+                /// our key with the shuffles requested by the other side
+                std::unique_ptr<CascadeKey> key;
+                /// when the first question was asked
+                std::chrono::high_resolution_clock::time_point started;
+            };
+            /// frames being corrected by the other side
+            std::map<SequenceNumber, FrameState> activeFrames;
 
         }; // ErrorCorrection
     } // namespace ec
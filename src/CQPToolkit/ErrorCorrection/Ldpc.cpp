@@ -0,0 +1,659 @@
+/*!
+* @file
+* @brief Ldpc
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "Ldpc.h"
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <cmath>
+#include <cstring>
+#include "Algorithms/Logging/Logger.h"
+#include "Algorithms/Util/CpuFeatures.h"
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define CQP_LDPC_AVX2
+    #define CQP_LDPC_AVX2_TARGET
+#elif defined(CQP_CPU_DISPATCH)
+    // build the AVX2 version anyway, it's only used if the processor has it
+    #include <immintrin.h>
+    #define CQP_LDPC_AVX2
+    #define CQP_LDPC_AVX2_TARGET CQP_CPU_TARGET("avx2")
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define CQP_LDPC_SSE2
+#endif
+
+namespace cqp
+{
+    namespace ec
+    {
+        /// The sign bit of a float
+        static const uint32_t signBit = 0x80000000u;
+        /// Value given to bits which are known, large enough to never be the minimum
+        static const float knownLlr = 1.0e6f;
+
+        LdpcCode::LdpcCode(uint32_t numBits, uint32_t numChecks, uint64_t seed) :
+            numBits{numBits},
+            numChecks{numChecks}
+        {
+            // Irregular column weights, the heavy columns converge quickly and pull the rest along
+            const uint32_t lightWeight = 2;
+            const uint32_t normalWeight = 3;
+            const uint32_t heavyWeight = 12;
+
+            if(numBits == 0 || numBits % bitsPerWord != 0 || numChecks < heavyWeight || numChecks >= numBits)
+            {
+                LOGERROR("Invalid LDPC code size");
+                this->numBits = 0;
+                this->numChecks = 0;
+                checkStart.push_back(0);
+                groupStart.push_back(0);
+                return;
+            }
+
+            // 10% weight 2, but not so many that they form cycles on their own, 15% weight 12, the rest weight 3
+            const uint32_t numLight = std::min(numBits / 10, numChecks / 2);
+            const uint32_t numHeavy = numBits * 15 / 100;
+            std::vector<uint32_t> colStart(numBits + 1, 0);
+            for(uint32_t column = 0; column < numBits; column++)
+            {
+                uint32_t weight = normalWeight;
+                if(column < numLight)
+                {
+                    weight = lightWeight;
+                }
+                else if(column >= numBits - numHeavy)
+                {
+                    weight = heavyWeight;
+                }
+                colStart[column + 1] = colStart[column] + weight;
+            }
+
+            // mt19937_64 produces the same sequence on every platform for a given seed
+            std::mt19937_64 rng(seed + numChecks);
+            std::vector<uint32_t> columns(colStart.back());
+
+            // Take the checks for each column from a shuffled pool of all checks so that
+            // every check ends up with the same number of edges, give or take one.
+            std::vector<uint32_t> pool(numChecks);
+            size_t poolNext = pool.size();
+            // The columns connected to each check so far
+            std::vector<std::vector<uint32_t>> checkColumns(numChecks);
+            // Checks which would create a 4 cycle are marked with the current column
+            std::vector<uint32_t> blocked(numChecks, std::numeric_limits<uint32_t>::max());
+            // give up avoiding cycles after this many random choices
+            const uint32_t maxTries = 64;
+
+            for(uint32_t column = 0; column < numBits; column++)
+            {
+                const auto colBegin = columns.begin() + static_cast<std::ptrdiff_t>(colStart[column]);
+                for(uint32_t edge = colStart[column]; edge < colStart[column + 1]; edge++)
+                {
+                    const auto colEnd = columns.begin() + static_cast<std::ptrdiff_t>(edge);
+                    if(poolNext == pool.size())
+                    {
+                        std::iota(pool.begin(), pool.end(), 0);
+                        // Fisher-Yates, avoiding std::shuffle as its output is implementation defined
+                        for(size_t index = pool.size(); index > 1; index--)
+                        {
+                            std::swap(pool[index - 1], pool[rng() % index]);
+                        }
+                        poolNext = 0;
+                    }
+
+                    // find a check which doesn't share a column with any check this column already uses
+                    size_t candidate = poolNext;
+                    while(candidate < pool.size() && blocked[pool[candidate]] == column)
+                    {
+                        candidate++;
+                    }
+
+                    uint32_t check;
+                    if(candidate < pool.size())
+                    {
+                        std::swap(pool[poolNext], pool[candidate]);
+                        check = pool[poolNext];
+                        poolNext++;
+                    }
+                    else
+                    {
+                        // the end of the pool only had bad choices, pick any other check
+                        uint32_t tries = 0;
+                        do
+                        {
+                            check = static_cast<uint32_t>(rng() % numChecks);
+                            tries++;
+                        }
+                        while(std::find(colBegin, colEnd, check) != colEnd ||
+                              (blocked[check] == column && tries < maxTries));
+                    }
+
+                    *colEnd = check;
+                    blocked[check] = column;
+                    for(const auto other : checkColumns[check])
+                    {
+                        for(auto otherEdge = colStart[other]; otherEdge < colStart[other + 1]; otherEdge++)
+                        {
+                            blocked[columns[otherEdge]] = column;
+                        }
+                    }
+                    checkColumns[check].push_back(column);
+                }
+            }
+
+            // build the list of variables for each check
+            checkStart.assign(numChecks + 1, 0);
+            for(const auto check : columns)
+            {
+                checkStart[check + 1]++;
+            }
+            std::partial_sum(checkStart.begin(), checkStart.end(), checkStart.begin());
+
+            checkVariables.resize(columns.size());
+            std::vector<uint32_t> filled(checkStart.begin(), checkStart.end() - 1);
+            for(uint32_t column = 0; column < numBits; column++)
+            {
+                for(uint32_t edge = colStart[column]; edge < colStart[column + 1]; edge++)
+                {
+                    checkVariables[filled[columns[edge]]++] = column;
+                }
+            }
+
+            // Group checks of the same degree together so that little padding is needed
+            std::vector<uint32_t> order(numChecks);
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&](uint32_t left, uint32_t right)
+            {
+                return checkStart[left + 1] - checkStart[left] > checkStart[right + 1] - checkStart[right];
+            });
+
+            const size_t numGroups = (numChecks + lanes - 1) / lanes;
+            groupStart.resize(numGroups + 1);
+            groupChecks.assign(numGroups * lanes, -1);
+            groupStart[0] = 0;
+
+            for(size_t group = 0; group < numGroups; group++)
+            {
+                // the first check in the group has the highest degree
+                const uint32_t first = order[group * lanes];
+                const uint32_t degree = checkStart[first + 1] - checkStart[first];
+                groupStart[group + 1] = groupStart[group] + static_cast<uint32_t>(degree * lanes);
+            }
+
+            edgeVariable.assign(groupStart.back(), static_cast<int32_t>(numBits));
+            for(size_t group = 0; group < numGroups; group++)
+            {
+                for(size_t lane = 0; lane < lanes && group * lanes + lane < numChecks; lane++)
+                {
+                    const uint32_t check = order[group * lanes + lane];
+                    groupChecks[group * lanes + lane] = static_cast<int32_t>(check);
+                    for(uint32_t edge = checkStart[check]; edge < checkStart[check + 1]; edge++)
+                    {
+                        edgeVariable[groupStart[group] + (edge - checkStart[check]) * lanes + lane] =
+                            static_cast<int32_t>(checkVariables[edge]);
+                    }
+                }
+            }
+        }
+
+        PackedBits LdpcCode::Syndrome(const PackedBits& bits, size_t firstWord) const
+        {
+            PackedBits result((numChecks + bitsPerWord - 1) / bitsPerWord, 0);
+            const size_t firstBit = firstWord * bitsPerWord;
+
+            for(uint32_t check = 0; check < numChecks; check++)
+            {
+                bool parity = false;
+                for(uint32_t edge = checkStart[check]; edge < checkStart[check + 1]; edge++)
+                {
+                    parity ^= GetBit(bits, firstBit + checkVariables[edge]);
+                }
+
+                if(parity)
+                {
+                    FlipBit(result, check);
+                }
+            }
+            return result;
+        }
+
+        MinSumDecoder::MinSumDecoder(const LdpcCode& code, uint32_t maxIterations, float scale) :
+            code{code},
+            maxIterations{maxIterations},
+            scale{scale},
+            kernel{BestKernel()}
+        {
+            uint32_t maxDegree = 0;
+            for(size_t group = 0; group < code.NumGroups(); group++)
+            {
+                maxDegree = std::max<uint32_t>(maxDegree, (code.groupStart[group + 1] - code.groupStart[group]) / LdpcCode::lanes);
+            }
+
+            // the extra variable is the padding for short checks
+            channel.resize(code.numBits + 1);
+            totals.resize(code.numBits + 1);
+            checkMessages.resize(code.edgeVariable.size());
+            variableMessages.resize(maxDegree * LdpcCode::lanes);
+            syndromeSigns.resize(code.groupChecks.size());
+            checkSyndrome.resize(code.numChecks);
+        }
+
+        bool MinSumDecoder::Decode(PackedBits& bits, size_t firstWord, const PackedBits& syndrome, double qber, uint32_t knownBits)
+        {
+            const size_t firstBit = firstWord * bitsPerWord;
+            const uint32_t numBits = code.numBits;
+            const uint32_t unknownBits = numBits - std::min(knownBits, numBits);
+
+            // the log likelihood ratio of a bit being 0
+            const double errorRate = std::min(std::max(qber, 0.0001), 0.4999);
+            const float llr = static_cast<float>(std::log((1.0 - errorRate) / errorRate));
+
+            for(uint32_t bit = 0; bit < unknownBits; bit++)
+            {
+                channel[bit] = GetBit(bits, firstBit + bit) ? -llr : llr;
+            }
+            std::fill(channel.begin() + unknownBits, channel.end(), knownLlr);
+
+            for(uint32_t check = 0; check < code.numChecks; check++)
+            {
+                checkSyndrome[check] = GetBit(syndrome, check);
+            }
+            for(size_t lane = 0; lane < code.groupChecks.size(); lane++)
+            {
+                const auto check = code.groupChecks[lane];
+                syndromeSigns[lane] = (check >= 0 && checkSyndrome[static_cast<size_t>(check)]) ? signBit : 0u;
+            }
+
+            std::fill(checkMessages.begin(), checkMessages.end(), 0.0f);
+            totals = channel;
+            iterations = 0;
+
+            bool result = SyndromeMatches();
+            while(!result && iterations < maxIterations)
+            {
+                CheckNodes();
+
+                // variable nodes: sum everything they've been told
+                std::copy(channel.begin(), channel.end(), totals.begin());
+                for(size_t edge = 0; edge < checkMessages.size(); edge++)
+                {
+                    totals[static_cast<size_t>(code.edgeVariable[edge])] += checkMessages[edge];
+                }
+                totals[numBits] = knownLlr;
+
+                iterations++;
+                result = SyndromeMatches();
+            }
+
+            if(result)
+            {
+                // take the hard decision
+                for(uint32_t bit = 0; bit < unknownBits; bit++)
+                {
+                    if(GetBit(bits, firstBit + bit) != (totals[bit] < 0.0f))
+                    {
+                        FlipBit(bits, firstBit + bit);
+                    }
+                }
+            }
+
+            return result;
+        }
+
+        bool MinSumDecoder::SyndromeMatches() const
+        {
+            bool result = true;
+            for(uint32_t check = 0; result && check < code.numChecks; check++)
+            {
+                bool parity = checkSyndrome[check] != 0;
+                for(uint32_t edge = code.checkStart[check]; edge < code.checkStart[check + 1]; edge++)
+                {
+                    parity ^= totals[code.checkVariables[edge]] < 0.0f;
+                }
+                result = !parity;
+            }
+            return result;
+        }
+
+        /// The buffers used by the check node update
+        struct CheckNodeBuffers
+        {
+            /// The first edge of each group, with an extra entry at the end
+            const uint32_t* groupStart;
+            /// The number of groups
+            size_t numGroups;
+            /// The variable of each edge
+            const int32_t* edgeVariable;
+            /// channel plus all check messages for each bit
+            const float* totals;
+            /// The messages from each check node
+            float* checkMessages;
+            /// scratch space for the messages from the variables of one group
+            float* variableMessages;
+            /// The syndrome of each lane as a float sign bit
+            const uint32_t* syndromeSigns;
+            /// min-sum normalisation
+            float scale;
+        };
+
+#if defined(CQP_LDPC_AVX2)
+        /// Update the check nodes 8 lanes at a time, the processor must support AVX2
+        CQP_LDPC_AVX2_TARGET
+        static void CheckNodesAvx2(const CheckNodeBuffers& buffers)
+        {
+            static_assert(LdpcCode::lanes == 8, "AVX2 check node update assumes 8 lanes");
+            const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32(static_cast<int>(signBit)));
+            const __m256 scaleVec = _mm256_set1_ps(buffers.scale);
+            float* vm = buffers.variableMessages;
+
+            for(size_t group = 0; group < buffers.numGroups; group++)
+            {
+                const size_t first = buffers.groupStart[group];
+                const size_t degree = (buffers.groupStart[group + 1] - first) / LdpcCode::lanes;
+                const int32_t* vars = &buffers.edgeVariable[first];
+                float* messages = &buffers.checkMessages[first];
+
+                __m256 min1 = _mm256_set1_ps(std::numeric_limits<float>::max());
+                __m256 min2 = min1;
+                __m256i minIndex = _mm256_setzero_si256();
+                __m256 signs = _mm256_loadu_ps(reinterpret_cast<const float*>(&buffers.syndromeSigns[group * LdpcCode::lanes]));
+
+                for(size_t edge = 0; edge < degree; edge++)
+                {
+                    const __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(vars + edge * LdpcCode::lanes));
+                    const __m256 msg = _mm256_sub_ps(_mm256_i32gather_ps(buffers.totals, index, 4),
+                                                     _mm256_loadu_ps(messages + edge * LdpcCode::lanes));
+                    _mm256_storeu_ps(vm + edge * LdpcCode::lanes, msg);
+
+                    signs = _mm256_xor_ps(signs, _mm256_and_ps(msg, signMask));
+                    const __m256 mag = _mm256_andnot_ps(signMask, msg);
+                    const __m256 lower = _mm256_cmp_ps(mag, min1, _CMP_LT_OQ);
+                    min2 = _mm256_blendv_ps(_mm256_min_ps(min2, mag), min1, lower);
+                    min1 = _mm256_blendv_ps(min1, mag, lower);
+                    minIndex = _mm256_blendv_epi8(minIndex, _mm256_set1_epi32(static_cast<int>(edge)), _mm256_castps_si256(lower));
+                }
+
+                min1 = _mm256_mul_ps(min1, scaleVec);
+                min2 = _mm256_mul_ps(min2, scaleVec);
+
+                for(size_t edge = 0; edge < degree; edge++)
+                {
+                    const __m256 msg = _mm256_loadu_ps(vm + edge * LdpcCode::lanes);
+                    const __m256 isMin = _mm256_castsi256_ps(_mm256_cmpeq_epi32(minIndex, _mm256_set1_epi32(static_cast<int>(edge))));
+                    const __m256 mag = _mm256_blendv_ps(min1, min2, isMin);
+                    const __m256 sign = _mm256_xor_ps(signs, _mm256_and_ps(msg, signMask));
+                    _mm256_storeu_ps(messages + edge * LdpcCode::lanes, _mm256_or_ps(mag, sign));
+                }
+            }
+        }
+#endif
+
+#if defined(CQP_LDPC_SSE2)
+        /// Update the check nodes 4 lanes at a time
+        static void CheckNodesSse2(const CheckNodeBuffers& buffers)
+        {
+            static_assert(LdpcCode::lanes % 4 == 0, "SSE2 check node update needs a multiple of 4 lanes");
+            const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(signBit)));
+            const __m128 scaleVec = _mm_set1_ps(buffers.scale);
+            float* vm = buffers.variableMessages;
+            const float* tot = buffers.totals;
+
+            for(size_t group = 0; group < buffers.numGroups; group++)
+            {
+                const size_t first = buffers.groupStart[group];
+                const size_t degree = (buffers.groupStart[group + 1] - first) / LdpcCode::lanes;
+
+                // SSE has 4 lanes, process the group in quarters
+                for(size_t lane = 0; lane < LdpcCode::lanes; lane += 4)
+                {
+                    const int32_t* vars = &buffers.edgeVariable[first + lane];
+                    float* messages = &buffers.checkMessages[first + lane];
+
+                    __m128 min1 = _mm_set1_ps(std::numeric_limits<float>::max());
+                    __m128 min2 = min1;
+                    __m128i minIndex = _mm_setzero_si128();
+                    __m128 signs = _mm_loadu_ps(reinterpret_cast<const float*>(&buffers.syndromeSigns[group * LdpcCode::lanes + lane]));
+
+                    for(size_t edge = 0; edge < degree; edge++)
+                    {
+                        const int32_t* index = vars + edge * LdpcCode::lanes;
+                        const __m128 gathered = _mm_setr_ps(tot[index[0]], tot[index[1]], tot[index[2]], tot[index[3]]);
+                        const __m128 msg = _mm_sub_ps(gathered, _mm_loadu_ps(messages + edge * LdpcCode::lanes));
+                        _mm_storeu_ps(vm + edge * LdpcCode::lanes + lane, msg);
+
+                        signs = _mm_xor_ps(signs, _mm_and_ps(msg, signMask));
+                        const __m128 mag = _mm_andnot_ps(signMask, msg);
+                        const __m128 lower = _mm_cmplt_ps(mag, min1);
+                        // SSE2 has no blend, select with masks
+                        min2 = _mm_or_ps(_mm_and_ps(lower, min1), _mm_andnot_ps(lower, _mm_min_ps(min2, mag)));
+                        min1 = _mm_or_ps(_mm_and_ps(lower, mag), _mm_andnot_ps(lower, min1));
+                        const __m128i lowerInt = _mm_castps_si128(lower);
+                        minIndex = _mm_or_si128(_mm_and_si128(lowerInt, _mm_set1_epi32(static_cast<int>(edge))),
+                                                _mm_andnot_si128(lowerInt, minIndex));
+                    }
+
+                    min1 = _mm_mul_ps(min1, scaleVec);
+                    min2 = _mm_mul_ps(min2, scaleVec);
+
+                    for(size_t edge = 0; edge < degree; edge++)
+                    {
+                        const __m128 msg = _mm_loadu_ps(vm + edge * LdpcCode::lanes + lane);
+                        const __m128 isMin = _mm_castsi128_ps(_mm_cmpeq_epi32(minIndex, _mm_set1_epi32(static_cast<int>(edge))));
+                        const __m128 mag = _mm_or_ps(_mm_and_ps(isMin, min2), _mm_andnot_ps(isMin, min1));
+                        const __m128 sign = _mm_xor_ps(signs, _mm_and_ps(msg, signMask));
+                        _mm_storeu_ps(messages + edge * LdpcCode::lanes, _mm_or_ps(mag, sign));
+                    }
+                }
+            }
+        }
+#endif
+
+        /// Update the check nodes one lane at a time
+        static void CheckNodesScalar(const CheckNodeBuffers& buffers)
+        {
+            const size_t lanes = LdpcCode::lanes;
+            float* vm = buffers.variableMessages;
+
+            for(size_t group = 0; group < buffers.numGroups; group++)
+            {
+                const size_t first = buffers.groupStart[group];
+                const size_t degree = (buffers.groupStart[group + 1] - first) / lanes;
+                const int32_t* vars = &buffers.edgeVariable[first];
+                float* messages = &buffers.checkMessages[first];
+
+                float min1[lanes];
+                float min2[lanes];
+                size_t minIndex[lanes];
+                uint32_t signs[lanes];
+
+                for(size_t lane = 0; lane < lanes; lane++)
+                {
+                    min1[lane] = std::numeric_limits<float>::max();
+                    min2[lane] = min1[lane];
+                    minIndex[lane] = 0;
+                    signs[lane] = buffers.syndromeSigns[group * lanes + lane];
+                }
+
+                for(size_t edge = 0; edge < degree; edge++)
+                {
+                    for(size_t lane = 0; lane < lanes; lane++)
+                    {
+                        const size_t offset = edge * lanes + lane;
+                        const float msg = buffers.totals[static_cast<size_t>(vars[offset])] - messages[offset];
+                        vm[offset] = msg;
+
+                        uint32_t msgBits;
+                        std::memcpy(&msgBits, &msg, sizeof(msgBits));
+                        signs[lane] ^= msgBits & signBit;
+
+                        const float mag = std::fabs(msg);
+                        if(mag < min1[lane])
+                        {
+                            min2[lane] = min1[lane];
+                            min1[lane] = mag;
+                            minIndex[lane] = edge;
+                        }
+                        else
+                        {
+                            min2[lane] = std::min(min2[lane], mag);
+                        }
+                    }
+                }
+
+                for(size_t lane = 0; lane < lanes; lane++)
+                {
+                    min1[lane] *= buffers.scale;
+                    min2[lane] *= buffers.scale;
+                }
+
+                for(size_t edge = 0; edge < degree; edge++)
+                {
+                    for(size_t lane = 0; lane < lanes; lane++)
+                    {
+                        const size_t offset = edge * lanes + lane;
+                        uint32_t msgBits;
+                        std::memcpy(&msgBits, &vm[offset], sizeof(msgBits));
+
+                        float result = minIndex[lane] == edge ? min2[lane] : min1[lane];
+                        uint32_t resultBits;
+                        std::memcpy(&resultBits, &result, sizeof(resultBits));
+                        resultBits |= signs[lane] ^ (msgBits & signBit);
+                        std::memcpy(&result, &resultBits, sizeof(result));
+                        messages[offset] = result;
+                    }
+                }
+            }
+        }
+
+        bool MinSumDecoder::KernelSupported(Kernel kernel)
+        {
+            bool result = false;
+            switch (kernel)
+            {
+            case Kernel::Scalar:
+                result = true;
+                break;
+            case Kernel::Sse2:
+#if defined(CQP_LDPC_SSE2)
+                result = true;
+#endif
+                break;
+            case Kernel::Avx2:
+#if defined(CQP_LDPC_AVX2)
+                result = cpu::HasAvx2();
+#endif
+                break;
+            }
+            return result;
+        }
+
+        MinSumDecoder::Kernel MinSumDecoder::BestKernel()
+        {
+            Kernel result = Kernel::Scalar;
+            if(KernelSupported(Kernel::Avx2))
+            {
+                result = Kernel::Avx2;
+            }
+            else if(KernelSupported(Kernel::Sse2))
+            {
+                result = Kernel::Sse2;
+            }
+            return result;
+        }
+
+        bool MinSumDecoder::SetKernel(Kernel newKernel)
+        {
+            const bool result = KernelSupported(newKernel);
+            if(result)
+            {
+                kernel = newKernel;
+            }
+            return result;
+        }
+
+        void MinSumDecoder::CheckNodes()
+        {
+            CheckNodeBuffers buffers;
+            buffers.groupStart = code.groupStart.data();
+            buffers.numGroups = code.NumGroups();
+            buffers.edgeVariable = code.edgeVariable.data();
+            buffers.totals = totals.data();
+            buffers.checkMessages = checkMessages.data();
+            buffers.variableMessages = variableMessages.data();
+            buffers.syndromeSigns = syndromeSigns.data();
+            buffers.scale = scale;
+
+            switch (kernel)
+            {
+#if defined(CQP_LDPC_AVX2)
+            case Kernel::Avx2:
+                CheckNodesAvx2(buffers);
+                break;
+#endif
+#if defined(CQP_LDPC_SSE2)
+            case Kernel::Sse2:
+                CheckNodesSse2(buffers);
+                break;
+#endif
+            default:
+                CheckNodesScalar(buffers);
+                break;
+            }
+        }
+
+        LdpcCodeFamily::LdpcCodeFamily(uint32_t blockLength, uint64_t seed) :
+            blockLength{blockLength},
+            seed{seed}
+        {
+        }
+
+        uint32_t LdpcCodeFamily::ChecksFor(double qber, double efficiency) const
+        {
+            // Beyond this the key is too noisy to be worth correcting
+            const uint32_t maxSteps = rateSteps * 3 / 4;
+            const double errorRate = std::min(std::max(qber, 0.001), 0.5);
+            // binary entropy, the minimum number of bits which must be disclosed per bit
+            const double entropy = -errorRate * std::log2(errorRate) - (1.0 - errorRate) * std::log2(1.0 - errorRate);
+            const uint32_t checksPerStep = blockLength / rateSteps;
+
+            uint32_t steps = static_cast<uint32_t>(std::ceil(efficiency * entropy * rateSteps));
+            steps = std::min(std::max(steps, 1u), maxSteps);
+            return steps * checksPerStep;
+        }
+
+        std::shared_ptr<const LdpcCode> LdpcCodeFamily::GetCode(uint32_t numChecks)
+        {
+            std::shared_ptr<const LdpcCode> result;
+            const uint32_t checksPerStep = blockLength / rateSteps;
+
+            if(checksPerStep > 0 && numChecks > 0 && numChecks % checksPerStep == 0 && numChecks < blockLength)
+            {
+                std::lock_guard<std::mutex> lock(codesMutex);
+                auto& code = codes[numChecks];
+                if(!code)
+                {
+                    code = std::make_shared<const LdpcCode>(blockLength, numChecks, seed);
+                }
+                result = code;
+            }
+            else
+            {
+                LOGERROR("Invalid number of checks: " + std::to_string(numChecks));
+            }
+
+            return result;
+        }
+
+    } // namespace ec
+} // namespace cqp
@@ -0,0 +1,292 @@
+/*!
+* @file
+* @brief Ldpc
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#pragma once
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include "Algorithms/Util/Bits.h"
+#include "CQPToolkit/cqptoolkit_export.h"
+
+namespace cqp
+{
+    namespace ec
+    {
+        /**
+         * @brief The LdpcCode class
+         * A sparse parity check matrix with irregular column weights, generated from a seed
+         * so that both sides can build the same code without exchanging it.
+         * @details
+         * The check nodes are sorted by degree and interleaved in groups of `lanes` so that the
+         * decoder can update a whole group with one vector instruction per edge.
+         */
+        class CQPTOOLKIT_EXPORT LdpcCode
+        {
+        public:
+            /// The number of check nodes which are updated together
+            static constexpr size_t lanes = 8;
+
+            /**
+             * @brief LdpcCode
+             * Constructor
+             * @param numBits The block length of the code, must be a multiple of 64
+             * @param numChecks The number of syndrome bits for each block
+             * @param seed Used to place the edges
+             */
+            LdpcCode(uint32_t numBits, uint32_t numChecks, uint64_t seed);
+
+            /**
+             * @brief NumBits
+             * @return The block length
+             */
+            uint32_t NumBits() const
+            {
+                return numBits;
+            }
+
+            /**
+             * @brief NumChecks
+             * @return The number of syndrome bits for each block
+             */
+            uint32_t NumChecks() const
+            {
+                return numChecks;
+            }
+
+            /**
+             * @brief Syndrome
+             * Calculate the syndrome of one block
+             * @param bits The source key
+             * @param firstWord The word in bits where the block starts
+             * @return numChecks bits
+             */
+            PackedBits Syndrome(const PackedBits& bits, size_t firstWord = 0) const;
+
+            /**
+             * @brief NumGroups
+             * @return The number of groups of lanes check nodes
+             */
+            size_t NumGroups() const
+            {
+                return groupStart.size() - 1;
+            }
+
+        protected:
+            friend class MinSumDecoder;
+
+            /// number of bits in a block
+            uint32_t numBits;
+            /// number of checks
+            uint32_t numChecks;
+            /// The start of each check nodes variables in checkVariables
+            std::vector<uint32_t> checkStart;
+            /// the variables connected to each check node
+            std::vector<uint32_t> checkVariables;
+
+            /// @{
+            /// @name Interleaved layout used by the decoder
+
+            /// The first edge of each group, edges are stored as [degree][lane]
+            std::vector<uint32_t> groupStart;
+            /// The variable of each edge, unused edges point to an extra variable at numBits
+            std::vector<int32_t> edgeVariable;
+            /// The check node of each lane in each group, or -1 for padding
+            std::vector<int32_t> groupChecks;
+
+            /// @}
+        }; // LdpcCode
+
+        /**
+         * @brief The MinSumDecoder class
+         * Normalised min-sum belief propagation with a flooding schedule.
+         * @details
+         * The check node update is vectorised with AVX2 when the processor supports it, otherwise SSE2.
+         * The decoder holds the message buffers so one should be created for each thread.
+         */
+        class CQPTOOLKIT_EXPORT MinSumDecoder
+        {
+        public:
+            /// The implementations of the check node update, they all produce the same messages
+            enum class Kernel
+            {
+                Scalar, Sse2, Avx2
+            };
+
+            /**
+             * @brief KernelSupported
+             * @param kernel The implementation to check
+             * @return true if the kernel is built into the library and this processor can run it
+             */
+            static bool KernelSupported(Kernel kernel);
+
+            /**
+             * @brief BestKernel
+             * @return The fastest kernel which this processor can run
+             */
+            static Kernel BestKernel();
+
+            /**
+             * @brief MinSumDecoder
+             * Constructor
+             * @param code The code to decode, must outlive the decoder
+             * @param maxIterations Stop trying to decode after this many iterations
+             * @param scale Normalisation factor for check node messages
+             */
+            explicit MinSumDecoder(const LdpcCode& code, uint32_t maxIterations = 60, float scale = 0.8f);
+
+            /**
+             * @brief Decode
+             * Correct a block so that it matches the syndrome
+             * @param[in,out] bits The key to correct
+             * @param firstWord The word in bits where the block starts
+             * @param syndrome The other sides syndrome for this block
+             * @param qber The expected error rate
+             * @param knownBits The number of bits at the end of the block which are known to be 0
+             * @return true if the block now matches the syndrome
+             */
+            bool Decode(PackedBits& bits, size_t firstWord, const PackedBits& syndrome, double qber, uint32_t knownBits = 0);
+
+            /**
+             * @brief Iterations
+             * @return The number of iterations used by the last call to Decode
+             */
+            uint32_t Iterations() const
+            {
+                return iterations;
+            }
+
+            /**
+             * @brief SetKernel
+             * Choose the check node implementation, the default is BestKernel()
+             * @param newKernel The implementation to use
+             * @return false if the kernel isn't supported, the kernel is not changed
+             */
+            bool SetKernel(Kernel newKernel);
+
+            /**
+             * @brief GetKernel
+             * @return The check node implementation in use
+             */
+            Kernel GetKernel() const
+            {
+                return kernel;
+            }
+
+        protected:
+            /**
+             * @brief CheckNodes
+             * Update the messages from every check node
+             */
+            void CheckNodes();
+
+            /**
+             * @brief SyndromeMatches
+             * Test the hard decision against the syndrome
+             * @return true if all checks are satisfied
+             */
+            bool SyndromeMatches() const;
+
+            /// The code being decoded
+            const LdpcCode& code;
+            /// max iterations to try
+            const uint32_t maxIterations;
+            /// min-sum normalisation
+            const float scale;
+            /// The check node implementation
+            Kernel kernel;
+            /// iterations used by the last decode
+            uint32_t iterations = 0;
+
+            /// channel information for each bit
+            std::vector<float> channel;
+            /// channel plus all check messages for each bit
+            std::vector<float> totals;
+            /// The messages from each check node
+            std::vector<float> checkMessages;
+            /// scratch space for the messages from the variables of one group
+            std::vector<float> variableMessages;
+            /// The syndrome of each lane as a float sign bit
+            std::vector<uint32_t> syndromeSigns;
+            /// The syndrome bit of each check
+            std::vector<uint8_t> checkSyndrome;
+        }; // MinSumDecoder
+
+        /**
+         * @brief The LdpcCodeFamily class
+         * A set of codes of the same length with different rates, codes are built the first time they're used
+         */
+        class CQPTOOLKIT_EXPORT LdpcCodeFamily
+        {
+        public:
+            /// The default block length
+            static constexpr uint32_t defaultBlockLength = 4096;
+            /// The default seed for building codes
+            static constexpr uint64_t defaultSeed = 0x51DE7A11u;
+            /// The rates of the codes are a multiple of 1/rateSteps
+            static constexpr uint32_t rateSteps = 64;
+
+            /**
+             * @brief LdpcCodeFamily
+             * Constructor
+             * @param blockLength The length of each code, must be a multiple of 64
+             * @param seed Seed for building the codes
+             */
+            explicit LdpcCodeFamily(uint32_t blockLength = defaultBlockLength, uint64_t seed = defaultSeed);
+
+            /**
+             * @brief ChecksFor
+             * Choose the code for an error rate
+             * @param qber The expected error rate
+             * @param efficiency How many more syndrome bits than the shannon limit to send
+             * @return The number of checks of the code to use
+             */
+            uint32_t ChecksFor(double qber, double efficiency) const;
+
+            /**
+             * @brief GetCode
+             * @param numChecks The number of checks, as returned by ChecksFor
+             * @return The code or null if numChecks is invalid
+             */
+            std::shared_ptr<const LdpcCode> GetCode(uint32_t numChecks);
+
+            /**
+             * @brief BlockLength
+             * @return The length of the codes
+             */
+            uint32_t BlockLength() const
+            {
+                return blockLength;
+            }
+
+            /**
+             * @brief Seed
+             * @return The seed for the codes
+             */
+            uint64_t Seed() const
+            {
+                return seed;
+            }
+
+        protected:
+            /// length of the codes
+            const uint32_t blockLength;
+            /// seed for the codes
+            const uint64_t seed;
+            /// protects codes
+            std::mutex codesMutex;
+            /// codes which have been built, by number of checks
+            std::map<uint32_t, std::shared_ptr<const LdpcCode>> codes;
+        }; // LdpcCodeFamily
+
+    } // namespace ec
+} // namespace cqp
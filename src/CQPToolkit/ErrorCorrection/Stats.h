@@ -26,7 +26,7 @@ namespace cqp
             /// The group to contain these stats
             static const constexpr char* parent = "ErrorCorrection";
             /// The number of errors corrected during this frame
-            stats::Stat<double> Errors {{parent, "Errors"}, stats::Units::Percentage};
+            stats::Stat<size_t> Errors {{parent, "Errors"}, stats::Units::Count};
 
             /// The time took to transmit the qubits
             stats::Stat<size_t> TimeTaken {{parent, "TimeTaken"}, stats::Units::Milliseconds};
@@ -34,12 +34,24 @@ namespace cqp
             /// The error rate of the quantum channel
             stats::Stat<double> QBER {{parent, "QBER"}, stats::Units::Percentage};
 
+            /// The number of bits disclosed to the other side while correcting this frame
+            stats::Stat<size_t> BitsLeaked {{parent, "BitsLeaked"}, stats::Units::Count};
+
+            /// The number of round trips needed to correct this frame
+            stats::Stat<size_t> RoundTrips {{parent, "RoundTrips"}, stats::Units::Count};
+
+            /// The number of LDPC blocks which could not be decoded and were discarded
+            stats::Stat<size_t> DecodeFailures {{parent, "DecodeFailures"}, stats::Units::Count};
+
             /// @copydoc stats::StatCollection::Add
             void Add(stats::IAllStatsCallback* statsCb) override
             {
                 Errors.Add(statsCb);
                 TimeTaken.Add(statsCb);
                 QBER.Add(statsCb);
+                BitsLeaked.Add(statsCb);
+                RoundTrips.Add(statsCb);
+                DecodeFailures.Add(statsCb);
             }
 
             /// @copydoc stats::StatCollection::Remove
@@ -48,6 +60,9 @@ namespace cqp
                 Errors.Remove(statsCb);
                 TimeTaken.Remove(statsCb);
                 QBER.Remove(statsCb);
+                BitsLeaked.Remove(statsCb);
+                RoundTrips.Remove(statsCb);
+                DecodeFailures.Remove(statsCb);
             }
 
         }; // struct Stats
@@ -28,11 +28,14 @@ namespace cqp
 
         /**
          * @brief OnCorrected
-         * @param blockId The block which has been checked
+         * @param blockId The block which has been checked, both sides use the same id for the same block
+         * @param errors The number of errors which were corrected
+         * @param bitsLeaked The number of bits disclosed while correcting the block
          * @param correctedData Error free data
          */
         virtual void OnCorrected(
             const ValidatedBlockID blockId,
+            uint64_t errors, uint64_t bitsLeaked,
             std::unique_ptr<DataBlock> correctedData) = 0;
 
         /// destructor
@@ -121,6 +121,12 @@ namespace cqp
             static CONSTSTRING switchName = "switchName";
             /// The name of the key size parameter
             static CONSTSTRING keybytes = "keybytes";
+            /// The name of the error correction mode parameter, see ec::ErrorCorrection::ParseMode
+            static CONSTSTRING errorCorrection = "errorCorrection";
+            /// The name of the parameter for how many sift requests can be waiting for an answer
+            static CONSTSTRING siftWindow = "siftWindow";
+            /// The name of the in process channel which links simulated devices, see sim::PhotonChannel::Shared
+            static CONSTSTRING simulatedChannel = "simulatedChannel";
             /// possible values for the side parameter
             struct SideValues
             {
@@ -3,39 +3,71 @@
 * @brief PrivacyAmplify
 *
 * @copyright Copyright (C) University of Bristol 2017
-*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. 
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
 *    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
 *    See LICENSE file for details.
 * @date 4/7/2017
 * @author Richard Collins <richard.collins@bristol.ac.uk>
 */
 #include "PrivacyAmplify.h"
+#include <algorithm>
+#include <cmath>
+#include <future>
 #include "Stats.h"
+#include "CQPToolkit/PrivacyAmp/Toeplitz.h"
+#include "CQPToolkit/Util/GrpcLogger.h"
+#include "Algorithms/Logging/Logger.h"
 
 namespace cqp
 {
     namespace privacy
     {
+        constexpr size_t PrivacyAmplify::defaultInputLength;
+        constexpr double PrivacyAmplify::defaultSecurityParameter;
 
-        void PrivacyAmplify::PublishPrivacyAmplify()
+        PrivacyAmplify::PrivacyAmplify(remote::Side::Type side, size_t inputLength, double securityParameter) :
+            side{side},
+            inputLength{inputLength},
+            securityParameter{securityParameter}
         {
-            // package data ready for next stage
-            using std::chrono::high_resolution_clock;
-            high_resolution_clock::time_point timerStart = high_resolution_clock::now();
-            std::unique_ptr<KeyList> keys(new KeyList());
-            keys->push_back(PSK());
+        }
 
-            // package data ready for next stage
-            for(std::unique_ptr<DataBlock>& block : incommingData)
+        size_t PrivacyAmplify::SecureKeyLength(size_t inputBits, uint64_t errors, uint64_t bitsLeaked, double securityParameter)
+        {
+            size_t result = 0;
+            if(inputBits > 0 && securityParameter > 0.0 && securityParameter < 1.0)
             {
-                (*keys)[0].insert((*keys)[0].end(), block->begin(), block->end());
+                const double n = static_cast<double>(inputBits);
+                const double errorRate = std::min(static_cast<double>(errors) / n, 0.5);
+                double entropy = 0.0;
+                if(errorRate > 0.0)
+                {
+                    entropy = -errorRate * std::log2(errorRate) - (1.0 - errorRate) * std::log2(1.0 - errorRate);
+                }
+
+                const double secure = n * (1.0 - entropy) - static_cast<double>(bitsLeaked) - 2.0 * std::log2(1.0 / securityParameter);
+                if(secure > 0.0)
+                {
+                    // keys are handled as bytes
+                    result = static_cast<size_t>(secure) / 8 * 8;
+                }
             }
+            return result;
+        } // SecureKeyLength
 
-            if(keys->empty() || (*keys)[0].empty())
+        void PrivacyAmplify::PublishPrivacyAmplify(const PackedBits& key, size_t keyBits,
+                std::chrono::high_resolution_clock::time_point timerStart)
+        {
+            using std::chrono::high_resolution_clock;
+            // package data ready for next stage
+            std::unique_ptr<KeyList> keys(new KeyList());
+            const JaggedDataBlock bytes = UnpackBits(key, keyBits);
+            keys->push_back(PSK(bytes));
+
+            if((*keys)[0].empty())
             {
                 LOGWARN("Empty key");
             }
-            incommingData.clear();
             LOGTRACE("Publishing key");
             const auto numKeys = keys->size();
             Emit(&IKeyCallback::OnKeyGeneration, move(keys));
@@ -44,36 +76,263 @@ namespace cqp
             stats.keysEmitted.Update(numKeys);
         } // PublishPrivacyAmplify
 
-        void PrivacyAmplify::OnCorrected(const ValidatedBlockID,
-            std::unique_ptr<DataBlock> correctedData)
+        void PrivacyAmplify::OnCorrected(const ValidatedBlockID blockId, uint64_t errors, uint64_t bitsLeaked,
+                                         std::unique_ptr<DataBlock> correctedData)
         {
             LOGTRACE("Corrected Data received.");
-            // collect incoming data, notify listeners of new data
-            // TODO
-            incommingData.push_back(std::move(correctedData));
-            PublishPrivacyAmplify();
-            //receivedDataCv.notify_one();
-        } // OnTimeTagReport
+            /*lock scope*/
+            {
+                std::lock_guard<std::mutex> lock(correctedMutex);
+                if(correctedBlocks.find(blockId) == correctedBlocks.end())
+                {
+                    correctedBits += correctedData->size() * 8;
+                    CorrectedBlock& block = correctedBlocks[blockId];
+                    block.data = move(correctedData);
+                    block.errors = errors;
+                    block.bitsLeaked = bitsLeaked;
+                }
+                else
+                {
+                    LOGERROR("Duplicate corrected block ID");
+                }
+            }/*lock scope*/
+
+            correctedCv.notify_all();
+        } // OnCorrected
+
+        PackedBits PrivacyAmplify::Join(const CorrectedBlocks& blocks)
+        {
+            JaggedDataBlock joined;
+            for(const auto& block : blocks)
+            {
+                joined.insert(joined.end(), block.second.data->begin(), block.second.data->end());
+            }
+            return PackBits(joined);
+        } // Join
+
+        bool PrivacyAmplify::Amplify(const CorrectedBlocks& blocks)
+        {
+            using std::chrono::high_resolution_clock;
+            const high_resolution_clock::time_point timerStart = high_resolution_clock::now();
+            remote::CompressRequest request;
+            google::protobuf::Empty response;
+            uint64_t errors = 0;
+            uint64_t bitsLeaked = 0;
+            size_t inputBits = 0;
+
+            for(const auto& block : blocks)
+            {
+                request.add_blockids(block.first);
+                errors += block.second.errors;
+                bitsLeaked += block.second.bitsLeaked;
+                inputBits += block.second.data->size() * 8;
+            }
+
+            const size_t outputBits = SecureKeyLength(inputBits, errors, bitsLeaked, securityParameter);
+            request.set_inputbits(inputBits);
+            request.set_outputbits(outputBits);
+
+            std::future<PackedBits> ourKey;
+            if(outputBits > 0)
+            {
+                DataBlock seedBytes;
+                rng.RandomBytes((ToeplitzHash::SeedLength(inputBits, outputBits) + 7) / 8, seedBytes);
+                request.set_seed(seedBytes.data(), seedBytes.size());
+
+                JaggedDataBlock seed;
+                seed.assign(seedBytes.begin(), seedBytes.end());
+                // hash our copy while the other side does the same
+                ourKey = std::async(std::launch::async, [&blocks, seed, inputBits, outputBits]()
+                {
+                    ToeplitzHash hasher;
+                    return hasher.Hash(Join(blocks), inputBits, PackBits(seed), outputBits);
+                });
+            }
+            else
+            {
+                LOGWARN("No secure key in " + std::to_string(inputBits) + " bits");
+            }
+
+            bool result = otherSide != nullptr;
+            if(result)
+            {
+                grpc::ClientContext ctx;
+                result = LogStatus(otherSide->Compress(&ctx, request, &response)).ok();
+            }
+            else
+            {
+                LOGERROR("No privacy amplification peer");
+            }
+
+            if(ourKey.valid())
+            {
+                const PackedBits key = ourKey.get();
+                if(result)
+                {
+                    PublishPrivacyAmplify(key, outputBits, timerStart);
+                }
+            }
+
+            if(result)
+            {
+                stats.bytesDiscarded.Update((inputBits - outputBits) / 8);
+            }
+            else
+            {
+                LOGERROR("Failed to amplify blocks");
+                stats.bytesDiscarded.Update(inputBits / 8);
+            }
+
+            return result;
+        } // Amplify
+
+        grpc::Status PrivacyAmplify::Compress(grpc::ServerContext*, const remote::CompressRequest* request, google::protobuf::Empty*)
+        {
+            using std::chrono::high_resolution_clock;
+            const high_resolution_clock::time_point timerStart = high_resolution_clock::now();
+            const size_t inputBits = request->inputbits();
+            const size_t outputBits = request->outputbits();
+
+            if(request->blockids().empty() || outputBits > inputBits)
+            {
+                return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Invalid lengths");
+            }
+            if(outputBits > 0 && request->seed().size() * 8 < ToeplitzHash::SeedLength(inputBits, outputBits))
+            {
+                return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Seed too short");
+            }
+
+            CorrectedBlocks blocks;
+            /*lock scope*/
+            {
+                std::unique_lock<std::mutex> lock(correctedMutex);
+                // The other side may have finished error correction before us
+                const bool dataReady = correctedCv.wait_for(lock, receiveTimeout, [&]()
+                {
+                    for(const auto id : request->blockids())
+                    {
+                        if(correctedBlocks.find(id) == correctedBlocks.end())
+                        {
+                            return false;
+                        }
+                    }
+                    return true;
+                });
+
+                for(const auto id : request->blockids())
+                {
+                    auto block = correctedBlocks.find(id);
+                    if(block != correctedBlocks.end())
+                    {
+                        correctedBits -= block->second.data->size() * 8;
+                        if(dataReady)
+                        {
+                            blocks[id] = std::move(block->second);
+                        }
+                        correctedBlocks.erase(block);
+                    }
+                }
+
+                // the other side has given up on any earlier blocks
+                const SequenceNumber lastId = *std::max_element(request->blockids().begin(), request->blockids().end());
+                for(auto block = correctedBlocks.begin(); block != correctedBlocks.end() && block->first < lastId;)
+                {
+                    correctedBits -= block->second.data->size() * 8;
+                    block = correctedBlocks.erase(block);
+                }
+
+                if(!dataReady)
+                {
+                    stats.bytesDiscarded.Update(inputBits / 8);
+                    return grpc::Status(grpc::StatusCode::NOT_FOUND, "Missing corrected blocks");
+                }
+            }/*lock scope*/
+
+            size_t ourBits = 0;
+            for(const auto& block : blocks)
+            {
+                ourBits += block.second.data->size() * 8;
+            }
+            if(ourBits != inputBits)
+            {
+                stats.bytesDiscarded.Update(ourBits / 8);
+                return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Blocks do not match");
+            }
+
+            if(outputBits > 0)
+            {
+                JaggedDataBlock seed;
+                seed.assign(request->seed().begin(), request->seed().end());
+
+                ToeplitzHash hasher;
+                PublishPrivacyAmplify(hasher.Hash(Join(blocks), inputBits, PackBits(seed), outputBits), outputBits, timerStart);
+            }
+            stats.bytesDiscarded.Update((inputBits - outputBits) / 8);
+
+            return grpc::Status();
+        } // Compress
+
+        void PrivacyAmplify::Connect(std::shared_ptr<grpc::ChannelInterface> channel)
+        {
+            /*lock scope*/
+            {
+                std::lock_guard<std::mutex> lock(correctedMutex);
+                correctedBlocks.clear();
+                correctedBits = 0;
+            }/*lock scope*/
+
+            if(side == remote::Side::Alice)
+            {
+                // we choose the seeds
+                otherSide = remote::IToeplitz::NewStub(channel);
+                Start();
+            }
+        }
+
+        void PrivacyAmplify::Disconnect()
+        {
+            Stop(true);
+            otherSide = nullptr;
+
+            std::lock_guard<std::mutex> lock(correctedMutex);
+            correctedBlocks.clear();
+            correctedBits = 0;
+        }
 
         void PrivacyAmplify::DoWork()
         {
             using namespace std;
             while(!ShouldStop())
             {
-                unique_lock<mutex> lock(accessMutex);
-                bool dataReady = false;
-                threadConditional.wait(lock, [&]
+                CorrectedBlocks blocks;
+
+                /*lock scope*/
                 {
-                    // check if data is ready
-                    return false || state == State::Stop; // TODO
-                });
+                    unique_lock<mutex> lock(correctedMutex);
+                    const bool dataReady = correctedCv.wait_for(lock, threadTimeout, [&]
+                    {
+                        return correctedBits >= inputLength;
+                    });
 
-                if(dataReady)
+                    if(dataReady)
+                    {
+                        // take the oldest blocks until there is enough to compress
+                        size_t bitsTaken = 0;
+                        while(bitsTaken < inputLength && !correctedBlocks.empty())
+                        {
+                            auto block = correctedBlocks.begin();
+                            bitsTaken += block->second.data->size() * 8;
+                            blocks[block->first] = move(block->second);
+                            correctedBlocks.erase(block);
+                        }
+                        correctedBits -= bitsTaken;
+                    }
+                }/*lock scope*/
+
+                if(!blocks.empty())
                 {
-                    // TODO
                     // Converse with the other side
-
-                    PublishPrivacyAmplify();
+                    Amplify(blocks);
                 } // if(dataReady)
             } // while(!ShouldStop())
         } // DoWork
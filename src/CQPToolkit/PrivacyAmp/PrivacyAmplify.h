@@ -3,18 +3,27 @@
 * @brief PrivacyAmplify
 *
 * @copyright Copyright (C) University of Bristol 2017
-*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. 
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
 *    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
 *    See LICENSE file for details.
 * @date 4/7/2017
 * @author Richard Collins <richard.collins@bristol.ac.uk>
 */
 #pragma once
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <map>
 #include "CQPToolkit/Interfaces/IErrorCorrectPublisher.h"
 #include "CQPToolkit/Interfaces/IKeyPublisher.h"
+#include "CQPToolkit/Interfaces/IRemoteComms.h"
 #include "Algorithms/Util/Provider.h"
 #include "Algorithms/Util/WorkerThread.h"
+#include "Algorithms/Util/Bits.h"
+#include "Algorithms/Random/RandomNumber.h"
 #include "QKDInterfaces/IPrivacyAmplify.grpc.pb.h"
+#include "QKDInterfaces/Site.pb.h"
+#include "CQPToolkit/IToeplitz.grpc.pb.h"
 #include "CQPToolkit/PrivacyAmp/Stats.h"
 
 namespace cqp
@@ -23,37 +32,117 @@ namespace cqp
     {
         /**
          * @brief The PrivacyAmplify class
-         * A simple example of aligning time tags as they are received.
+         * Compresses corrected key with a random toeplitz matrix to remove the information leaked to an eavesdropper.
+         * @details
+         * Alice collects corrected blocks until she has at least inputLength bits, works out how long the
+         * secure key can be from the errors and the bits leaked by error correction, then sends Bob
+         * a random seed for the matrix. Both sides hash the same blocks with the seed to produce the key.
          */
         class CQPTOOLKIT_EXPORT PrivacyAmplify :
         /* Interfaces */
             virtual public IErrorCorrectCallback, public remote::IPrivacyAmplify::Service,
+            public remote::IToeplitz::Service,
         /* parents */
-            public Provider<IKeyCallback>, public WorkerThread
+            public Provider<IKeyCallback>, public WorkerThread,
+            public virtual IRemoteComms
         {
         public:
+            /// The default number of bits to compress at once
+            static constexpr size_t defaultInputLength = size_t(1) << 20;
+            /// The default probability that the key is not secure
+            static constexpr double defaultSecurityParameter = 1e-10;
 
             /**
              * @brief PrivacyAmplify
              * Constructor
+             * @param side Alice chooses the seeds
+             * @param inputLength The minimum number of corrected bits to compress at once,
+             * the finite key effects are smaller for longer inputs.
+             * @param securityParameter The probability that the key is not secure
              */
-            PrivacyAmplify() = default;
+            explicit PrivacyAmplify(remote::Side::Type side = remote::Side::Alice,
+                                    size_t inputLength = defaultInputLength,
+                                    double securityParameter = defaultSecurityParameter);
 
             /**
-             * @brief PerformPrivacyAmplify
+             * @brief SecureKeyLength
+             * The length of key which can be extracted from corrected bits.
+             * n(1 - h(e)) - leaked - 2 log2(1/securityParameter), rounded down to whole bytes
+             * @param inputBits The number of corrected bits
+             * @param errors The number of errors which were corrected
+             * @param bitsLeaked The number of bits disclosed by error correction
+             * @param securityParameter The probability that the key is not secure
+             * @return The number of bits which can be kept, may be 0
+             */
+            static size_t SecureKeyLength(size_t inputBits, uint64_t errors, uint64_t bitsLeaked, double securityParameter);
+
+            /**
+             * @brief PublishPrivacyAmplify
+             * Pass the final key to the next stage
+             * @param key The compressed key
+             * @param keyBits The length of the key, a multiple of 8
+             * @param timerStart When the compression started
              *
              * @startuml PerformPrivacyAmplifyBehaviour
              * [-> PrivacyAmplify : PublishPrivacyAmplify
              * activate PrivacyAmplify
-             *  PrivacyAmplify -> PrivacyAmplify : Emit(alignedData)
+             *  PrivacyAmplify -> PrivacyAmplify : Emit(keys)
              * deactivate PrivacyAmplify
              * @enduml
              */
-            void PublishPrivacyAmplify();
+            void PublishPrivacyAmplify(const PackedBits& key, size_t keyBits,
+                                       std::chrono::high_resolution_clock::time_point timerStart);
 
             ~PrivacyAmplify() override {
                 Stop(true);
             }
+
+            /// @{
+            /// @name IErrorCorrectCallback interface
+
+            /// @copydoc IErrorCorrectCallback::OnCorrected
+            void OnCorrected(const ValidatedBlockID blockId, uint64_t errors, uint64_t bitsLeaked,
+                             std::unique_ptr<DataBlock> correctedData) override;
+
+            /// @}
+
+            /// @{
+            /// @name remote::IToeplitz interface
+
+            /**
+             * @copydoc remote::IToeplitz::Compress
+             * @param context Connection details from the server
+             * @return Status
+             * @details
+             * @startuml CompressBehaviour
+             * [-> PrivacyAmplify : Compress
+             * activate PrivacyAmplify
+             *  PrivacyAmplify -> PrivacyAmplify : Wait for corrected blocks
+             *  PrivacyAmplify -> ToeplitzHash : Hash
+             *  PrivacyAmplify -> PrivacyAmplify : PublishPrivacyAmplify
+             * deactivate PrivacyAmplify
+             * @enduml
+             */
+            grpc::Status Compress(grpc::ServerContext* context, const remote::CompressRequest* request, google::protobuf::Empty*) override;
+
+            /// @}
+
+            /// @{
+            /// @name IRemoteComms interface
+
+            /**
+             * @brief Connect
+             * @param channel channel to the other side
+             */
+            void Connect(std::shared_ptr<grpc::ChannelInterface> channel) override;
+
+            /**
+             * @brief Disconnect
+             */
+            void Disconnect() override;
+
+            ///@}
+
             /// the publisher for this instance
             Statistics stats;
 
@@ -66,11 +155,60 @@ namespace cqp
 
             /// @}
 
+            /// A block of key from error correction
+            struct CorrectedBlock
+            {
+                /// the error free key
+                std::unique_ptr<DataBlock> data;
+                /// number of errors corrected
+                uint64_t errors = 0;
+                /// number of bits disclosed
+                uint64_t bitsLeaked = 0;
+            };
+
+            /// blocks by id
+            using CorrectedBlocks = std::map<SequenceNumber, CorrectedBlock>;
+
+            /**
+             * @brief Amplify
+             * Agree a seed with the other side and compress the blocks
+             * @param blocks The blocks to compress
+             * @return true if the other side accepted the seed
+             */
+            bool Amplify(const CorrectedBlocks& blocks);
+
+            /**
+             * @brief Join
+             * Concatenate blocks for hashing
+             * @param blocks blocks to join
+             * @return The bits of all the blocks
+             */
+            static PackedBits Join(const CorrectedBlocks& blocks);
+
+            /// Which side of the exchange we are
+            const remote::Side::Type side;
+            /// minimum bits to compress
+            const size_t inputLength;
+            /// probability that the key is not secure
+            const double securityParameter;
+            /// How long to wait for corrected data when the other side asks about it
+            std::chrono::milliseconds receiveTimeout {500};
+            /// How long to wait for new data before checking if the thread should be stopped
+            const std::chrono::seconds threadTimeout {1};
+
+            /// The other side when we are choosing the seeds
+            std::unique_ptr<remote::IToeplitz::Stub> otherSide;
+            /// source of seeds
+            RandomNumber rng;
+
+            /// protects correctedBlocks
+            std::mutex correctedMutex;
+            /// used for waiting for new data to arrive
+            std::condition_variable correctedCv;
             /// data received from error correction
-            std::vector<std::unique_ptr<DataBlock>> incommingData;
-            // IErrorCorrectCallback interface
-        public:
-            void OnCorrected(const ValidatedBlockID blockId, std::unique_ptr<DataBlock> correctedData) override;
+            CorrectedBlocks correctedBlocks;
+            /// The total length of correctedBlocks
+            size_t correctedBits = 0;
         }; // PrivacyAmplify
     } // namespace privacy
 } // namespace cqp
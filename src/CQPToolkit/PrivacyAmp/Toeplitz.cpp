@@ -0,0 +1,286 @@
+/*!
+* @file
+* @brief Toeplitz
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "Toeplitz.h"
+#include <algorithm>
+#include "Algorithms/Logging/Logger.h"
+
+namespace cqp
+{
+    namespace privacy
+    {
+        /// 15 * 2^27 + 1, supports transforms up to 2^27 and is small enough for 32 bit montgomery arithmetic
+        static const uint32_t modulus = 2013265921u;
+        /// A generator of the multiplicative group
+        static const uint32_t generator = 31u;
+        /// The largest power of 2 which divides modulus - 1
+        static const size_t maxSupportedTransform = size_t(1) << 27;
+
+        /**
+         * @brief NegativeInverse
+         * @return -modulus^-1 mod 2^32
+         */
+        static uint32_t NegativeInverse()
+        {
+            // newton's method, each step doubles the number of correct bits
+            uint32_t inverse = modulus;
+            for(int step = 0; step < 4; step++)
+            {
+                inverse *= 2u - modulus * inverse;
+            }
+            return 0u - inverse;
+        }
+
+        /// -modulus^-1 mod 2^32
+        static const uint32_t negInverse = NegativeInverse();
+        /// 2^32 mod modulus, 1 in montgomery form
+        static const uint32_t montOne = static_cast<uint32_t>((uint64_t(1) << 32) % modulus);
+        /// 2^64 mod modulus, used to convert into montgomery form
+        static const uint32_t montR2 = static_cast<uint32_t>(uint64_t(montOne) * montOne % modulus);
+
+        /**
+         * @brief Reduce
+         * @param value less than modulus * 2^32
+         * @return value / 2^32 mod modulus
+         */
+        static inline uint32_t Reduce(uint64_t value)
+        {
+            const uint32_t m = static_cast<uint32_t>(value) * negInverse;
+            const uint32_t result = static_cast<uint32_t>((value + uint64_t(m) * modulus) >> 32);
+            return result >= modulus ? result - modulus : result;
+        }
+
+        /// @return left * right in montgomery form
+        static inline uint32_t Mul(uint32_t left, uint32_t right)
+        {
+            return Reduce(uint64_t(left) * right);
+        }
+
+        /// @return left + right mod modulus
+        static inline uint32_t Add(uint32_t left, uint32_t right)
+        {
+            const uint32_t result = left + right;
+            return result >= modulus ? result - modulus : result;
+        }
+
+        /// @return left - right mod modulus
+        static inline uint32_t Sub(uint32_t left, uint32_t right)
+        {
+            return left >= right ? left - right : left + modulus - right;
+        }
+
+        /// @return value in montgomery form
+        static inline uint32_t ToMont(uint32_t value)
+        {
+            return Mul(value, montR2);
+        }
+
+        /// @return base^exponent, both in montgomery form
+        static uint32_t Pow(uint32_t base, uint64_t exponent)
+        {
+            uint32_t result = montOne;
+            while(exponent > 0)
+            {
+                if(exponent & 1u)
+                {
+                    result = Mul(result, base);
+                }
+                base = Mul(base, base);
+                exponent >>= 1;
+            }
+            return result;
+        }
+
+        /**
+         * @brief LimitTransform
+         * @param requested The callers maximum transform size
+         * @return The largest power of 2 which is no more than requested and can be used
+         */
+        static size_t LimitTransform(size_t requested)
+        {
+            size_t result = 2;
+            while(result * 2 <= requested && result < maxSupportedTransform)
+            {
+                result *= 2;
+            }
+            return result;
+        }
+
+        ToeplitzHash::ToeplitzHash(size_t maxTransform) :
+            maxTransform{LimitTransform(maxTransform)}
+        {
+        }
+
+        void ToeplitzHash::Prepare(size_t size)
+        {
+            if(size != transformSize)
+            {
+                transformSize = size;
+                twiddles.resize(size);
+                inverseTwiddles.resize(size);
+
+                const uint32_t root = Pow(ToMont(generator), (modulus - 1) / size);
+                const uint32_t inverseRoot = Pow(root, modulus - 2);
+
+                for(size_t half = 1; half < size; half *= 2)
+                {
+                    // The root for this stage is root^(size / (2 * half))
+                    const uint32_t stageRoot = Pow(root, size / (2 * half));
+                    const uint32_t stageInverse = Pow(inverseRoot, size / (2 * half));
+                    uint32_t twiddle = montOne;
+                    uint32_t inverseTwiddle = montOne;
+                    for(size_t index = 0; index < half; index++)
+                    {
+                        twiddles[half + index] = twiddle;
+                        inverseTwiddles[half + index] = inverseTwiddle;
+                        twiddle = Mul(twiddle, stageRoot);
+                        inverseTwiddle = Mul(inverseTwiddle, stageInverse);
+                    }
+                }
+
+                sizeInverse = Pow(ToMont(static_cast<uint32_t>(size % modulus)), modulus - 2);
+            }
+        }
+
+        void ToeplitzHash::Forward(std::vector<uint32_t>& data) const
+        {
+            for(size_t half = transformSize / 2; half >= 1; half /= 2)
+            {
+                const uint32_t* stageTwiddles = &twiddles[half];
+                for(size_t start = 0; start < transformSize; start += 2 * half)
+                {
+                    uint32_t* low = &data[start];
+                    uint32_t* high = low + half;
+                    for(size_t index = 0; index < half; index++)
+                    {
+                        const uint32_t left = low[index];
+                        const uint32_t right = high[index];
+                        low[index] = Add(left, right);
+                        high[index] = Mul(Sub(left, right), stageTwiddles[index]);
+                    }
+                }
+            }
+        }
+
+        void ToeplitzHash::Inverse(std::vector<uint32_t>& data) const
+        {
+            for(size_t half = 1; half < transformSize; half *= 2)
+            {
+                const uint32_t* stageTwiddles = &inverseTwiddles[half];
+                for(size_t start = 0; start < transformSize; start += 2 * half)
+                {
+                    uint32_t* low = &data[start];
+                    uint32_t* high = low + half;
+                    for(size_t index = 0; index < half; index++)
+                    {
+                        const uint32_t left = low[index];
+                        const uint32_t right = Mul(high[index], stageTwiddles[index]);
+                        low[index] = Add(left, right);
+                        high[index] = Sub(left, right);
+                    }
+                }
+            }
+
+            for(auto& value : data)
+            {
+                value = Mul(value, sizeInverse);
+            }
+        }
+
+        PackedBits ToeplitzHash::Hash(const PackedBits& input, size_t inputBits, const PackedBits& seed, size_t outputBits)
+        {
+            PackedBits result;
+            if(inputBits == 0 || outputBits == 0)
+            {
+                LOGERROR("Nothing to hash");
+                return result;
+            }
+            if(input.size() * bitsPerWord < inputBits || seed.size() * bitsPerWord < SeedLength(inputBits, outputBits))
+            {
+                LOGERROR("Input or seed too short");
+                return result;
+            }
+
+            result.resize((outputBits + bitsPerWord - 1) / bitsPerWord, 0);
+
+            size_t size = 1;
+            while(size < SeedLength(inputBits, outputBits))
+            {
+                size *= 2;
+            }
+
+            // Split the matrix into pieces if the whole thing won't fit in one transform
+            size_t inputChunk = inputBits;
+            size_t outputChunk = outputBits;
+            if(size > maxTransform)
+            {
+                size = maxTransform;
+                inputChunk = size / 2;
+                outputChunk = size / 2;
+            }
+            Prepare(size);
+
+            std::vector<uint32_t> inputTransform(size);
+            std::vector<uint32_t> product(size);
+
+            for(size_t inputStart = 0; inputStart < inputBits; inputStart += inputChunk)
+            {
+                const size_t inputLength = std::min(inputChunk, inputBits - inputStart);
+                std::fill(inputTransform.begin(), inputTransform.end(), 0);
+                for(size_t bit = 0; bit < inputLength; bit++)
+                {
+                    if(GetBit(input, inputStart + bit))
+                    {
+                        inputTransform[bit] = montOne;
+                    }
+                }
+                Forward(inputTransform);
+
+                for(size_t outputStart = 0; outputStart < outputBits; outputStart += outputChunk)
+                {
+                    const size_t outputLength = std::min(outputChunk, outputBits - outputStart);
+                    // The part of the seed which touches this piece of the matrix
+                    const size_t seedStart = outputStart + inputBits - inputStart - inputLength;
+                    const size_t seedLength = outputLength + inputLength - 1;
+
+                    std::fill(product.begin(), product.end(), 0);
+                    for(size_t bit = 0; bit < seedLength; bit++)
+                    {
+                        if(GetBit(seed, seedStart + bit))
+                        {
+                            product[bit] = montOne;
+                        }
+                    }
+                    Forward(product);
+
+                    for(size_t index = 0; index < size; index++)
+                    {
+                        product[index] = Mul(product[index], inputTransform[index]);
+                    }
+                    Inverse(product);
+
+                    // The sums are at most inputLength so can't wrap, the hash is their parity
+                    // The transform is at least seedLength long so the cyclic wrap around doesn't reach these values
+                    for(size_t bit = 0; bit < outputLength; bit++)
+                    {
+                        if(Reduce(product[bit + inputLength - 1]) & 1u)
+                        {
+                            FlipBit(result, outputStart + bit);
+                        }
+                    }
+                }
+            }
+
+            return result;
+        }
+
+    } // namespace privacy
+} // namespace cqp
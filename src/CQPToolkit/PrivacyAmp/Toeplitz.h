@@ -0,0 +1,101 @@
+/*!
+* @file
+* @brief Toeplitz
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "Algorithms/Util/Bits.h"
+#include "CQPToolkit/cqptoolkit_export.h"
+
+namespace cqp
+{
+    namespace privacy
+    {
+        /**
+         * @brief The ToeplitzHash class
+         * Multiplies a bit string by a random Toeplitz matrix, a 2-universal hash used for privacy amplification.
+         * @details
+         * The matrix vector product over GF(2) is the middle of the convolution of the seed with the input,
+         * which is calculated with a number theoretic transform in O(n log n) rather than O(n*m).
+         * If the transform would be larger than maxTransform the product is split into pieces which each
+         * fit in a transform of that size, this bounds the memory used for very long inputs.
+         */
+        class CQPTOOLKIT_EXPORT ToeplitzHash
+        {
+        public:
+            /// The largest transform to use by default, 64MiB per buffer
+            static constexpr size_t defaultMaxTransform = size_t(1) << 24;
+
+            /**
+             * @brief ToeplitzHash
+             * Constructor
+             * @param maxTransform The largest transform to use, must be a power of 2 and no more than 2^27
+             */
+            explicit ToeplitzHash(size_t maxTransform = defaultMaxTransform);
+
+            /**
+             * @brief SeedLength
+             * @param inputBits length of the input
+             * @param outputBits length of the output
+             * @return The number of bits needed to define the matrix
+             */
+            static size_t SeedLength(size_t inputBits, size_t outputBits)
+            {
+                return inputBits + outputBits - 1;
+            }
+
+            /**
+             * @brief Hash
+             * Calculate output[i] = XOR over j of seed[i - j + inputBits - 1] & input[j]
+             * @param input The bits to compress
+             * @param inputBits The number of valid bits in input
+             * @param seed The first column and row of the matrix, must be SeedLength bits long
+             * @param outputBits The length of the result
+             * @return outputBits of hash, or empty if the parameters are invalid
+             */
+            PackedBits Hash(const PackedBits& input, size_t inputBits, const PackedBits& seed, size_t outputBits);
+
+        protected:
+            /**
+             * @brief Prepare
+             * Build the twiddle factors for a transform size
+             * @param size The transform size, a power of 2
+             */
+            void Prepare(size_t size);
+
+            /**
+             * @brief Forward
+             * Decimation in frequency transform, the result is in bit reversed order
+             * @param data values in montgomery form
+             */
+            void Forward(std::vector<uint32_t>& data) const;
+
+            /**
+             * @brief Inverse
+             * Decimation in time inverse transform, takes bit reversed input
+             * @param data values in montgomery form
+             */
+            void Inverse(std::vector<uint32_t>& data) const;
+
+            /// largest transform allowed
+            const size_t maxTransform;
+            /// The size of the transform the twiddles are for
+            size_t transformSize = 0;
+            /// Twiddles for each stage, stage with half size h starts at h
+            std::vector<uint32_t> twiddles;
+            /// Twiddles for the inverse transform
+            std::vector<uint32_t> inverseTwiddles;
+            /// 1 / transformSize in montgomery form
+            uint32_t sizeInverse = 0;
+        }; // ToeplitzHash
+
+    } // namespace privacy
+} // namespace cqp
@@ -16,6 +16,8 @@
 #include "Session/SessionController.h"                // for SessionController
 #include "Algorithms/Logging/Logger.h"                              // for LOGERROR
 #include "Alignment/NullAlignment.h"
+#include "Alignment/MarkerServer.h"
+#include "Alignment/SlotAlignment.h"
 #include "ErrorCorrection/ErrorCorrection.h"
 #include "Sift/Receiver.h"
 #include "Sift/Verifier.h"
@@ -23,6 +25,8 @@
 #include "KeyGen/KeyConverter.h"
 #include "CQPToolkit/Simulation/DummyTransmitter.h"
 #include "CQPToolkit/Simulation/DummyTimeTagger.h"
+#include "CQPToolkit/Simulation/SimulatedTransmitter.h"
+#include "CQPToolkit/Simulation/SimulatedTimeTagger.h"
 #include "CQPToolkit/Statistics/ReportServer.h"
 #include "DeviceUtils.h"
 
@@ -35,55 +39,109 @@ namespace cqp
     class DummyQKD::ProcessingChain
     {
     public:
+        /// The number of emissions in each frame sent through a simulated channel
+        static constexpr size_t SimulatedSlotsPerFrame = 1000000;
+        /// The number of drift samples taken in each frame received through a simulated channel
+        static constexpr uint64_t DriftSamplesPerFrame = 10;
+
         ProcessingChain(std::shared_ptr<grpc::ChannelCredentials> creds,
-                        IRandom* rng, remote::Side::Type side) :
+                        IRandom* rng, remote::Side::Type side, ec::ErrorCorrection::Mode ecMode,
+                        unsigned int siftWindow, const std::string& simulatedChannel,
+                        const sim::ChannelParameters& channelParameters) :
             alignment(std::make_shared<align::NullAlignment>()),
-            ec(std::make_shared<ec::ErrorCorrection>()),
-            privacy(std::make_shared<privacy::PrivacyAmplify>()),
+            ec(std::make_shared<ec::ErrorCorrection>(side, ecMode)),
+            privacy(std::make_shared<privacy::PrivacyAmplify>(side)),
             keyConverter(std::make_shared<keygen::KeyConverter>()),
             reportServer(std::make_shared<stats::ReportServer>())
         {
             using namespace std;
             session::SessionController::RemoteCommsList remotes;
             remotes.push_back(alignment);
+            remotes.push_back(ec);
+            remotes.push_back(privacy);
 
             // create the controller for this device
             switch (side)
             {
             case remote::Side::Alice:
             {
-                photonSource = make_shared<sim::DummyTransmitter>(rng, chrono::microseconds(10));
+                std::shared_ptr<IPhotonGenerator> source;
                 siftVerifier = std::make_shared<sift::Verifier>();
-                // build the pipeline
-                photonSource->Attach(siftVerifier.get());
+                if(simulatedChannel.empty())
+                {
+                    photonSource = make_shared<sim::DummyTransmitter>(rng, chrono::microseconds(10));
+                    // build the pipeline
+                    photonSource->Attach(siftVerifier.get());
+                    photonSource->stats.Add(reportServer.get());
+                    // let classes get notified when we are connected
+                    remotes.push_back(photonSource);
+                    source = photonSource;
+                }
+                else
+                {
+                    // the photons go straight to the detector in this process
+                    simulatedSource = make_shared<sim::SimulatedTransmitter>(sim::PhotonChannel::Shared(simulatedChannel, channelParameters),
+                                      rng->RandULong(), SimulatedSlotsPerFrame);
+                    // the detector needs markers to find which slot each detection belongs to
+                    markerServer = make_shared<align::MarkerServer>();
+                    simulatedSource->Attach(markerServer.get());
+                    markerServer->Attach(siftVerifier.get());
+                    simulatedSource->stats.Add(reportServer.get());
+                    source = simulatedSource;
+                }
                 siftVerifier->Attach(ec.get());
 
                 // send stats to our report server
-                photonSource->stats.Add(reportServer.get());
                 siftVerifier->stats.Add(reportServer.get());
                 // let classes get notified when we are connected
-                remotes.push_back(photonSource);
                 remotes.push_back(siftVerifier);
 
-                controller = make_shared<session::AliceSessionController>(creds, remotes, photonSource, reportServer);
+                controller = make_shared<session::AliceSessionController>(creds, remotes, source, reportServer);
 
             }
 
             break;
             case remote::Side::Bob:
             {
-                timeTagger = make_shared<sim::DummyTimeTagger>(rng);
-                siftReceiver = std::make_shared<sift::Receiver>();
-                // build the pipeline
-                timeTagger->Attach(siftReceiver.get());
+                siftReceiver = std::make_shared<sift::Receiver>(1, siftWindow);
+                if(simulatedChannel.empty())
+                {
+                    timeTagger = make_shared<sim::DummyTimeTagger>(rng);
+                    // build the pipeline
+                    timeTagger->Attach(siftReceiver.get());
+                    timeTagger->stats.Add(reportServer.get());
+                    // let classes get notified when we are connected
+                    remotes.push_back(timeTagger);
+                }
+                else
+                {
+                    // the photons come straight from the transmitter in this process
+                    auto channel = sim::PhotonChannel::Shared(simulatedChannel, channelParameters);
+                    const auto& actualParameters = channel->GetParameters();
+                    SystemParameters system;
+                    system.slotsPerFrame = SimulatedSlotsPerFrame;
+                    system.slotWidth = actualParameters.period;
+                    // the histogram needs a sensible number of bins even with no jitter
+                    system.pulseWidth = min(actualParameters.period,
+                                            max(actualParameters.jitter, actualParameters.period / 1000));
+
+                    simulatedTagger = make_shared<sim::SimulatedTimeTagger>(channel);
+                    // the time tags are turned into slots before sifting
+                    slotAlignment = make_shared<align::SlotAlignment>(system,
+                                    actualParameters.period * (SimulatedSlotsPerFrame / DriftSamplesPerFrame));
+                    simulatedTagger->Attach(slotAlignment.get());
+                    slotAlignment->Attach(siftReceiver.get());
+                    simulatedTagger->stats.Add(reportServer.get());
+                    slotAlignment->stats.Add(reportServer.get());
+                    // let classes get notified when we are connected
+                    remotes.push_back(slotAlignment);
+                }
                 siftReceiver->Attach(ec.get());
 
                 // send stats to our report server
-                timeTagger->stats.Add(reportServer.get());
                 siftReceiver->stats.Add(reportServer.get());
 
                 // let classes get notified when we are connected
-                remotes.push_back(timeTagger);
                 remotes.push_back(siftReceiver);
 
                 controller = make_shared<session::SessionController>(creds, remotes, reportServer);
@@ -112,14 +170,27 @@ namespace cqp
         void RegisterServices(grpc::ServerBuilder& builder)
         {
             builder.RegisterService(reportServer.get());
+            builder.RegisterService(static_cast<remote::ICascade::Service*>(ec.get()));
+            builder.RegisterService(static_cast<remote::ILdpc::Service*>(ec.get()));
+            builder.RegisterService(static_cast<remote::IPrivacyAmplify::Service*>(privacy.get()));
+            builder.RegisterService(static_cast<remote::IToeplitz::Service*>(privacy.get()));
             if(timeTagger)
             {
                 builder.RegisterService(static_cast<remote::IDetector::Service*>(timeTagger.get()));
                 builder.RegisterService(static_cast<remote::IPhotonSim::Service*>(timeTagger.get()));
             }
+            if(simulatedTagger)
+            {
+                builder.RegisterService(static_cast<remote::IDetector::Service*>(simulatedTagger.get()));
+            }
+            if(markerServer)
+            {
+                builder.RegisterService(static_cast<remote::IAlignment::Service*>(markerServer.get()));
+            }
             if(siftVerifier)
             {
-                builder.RegisterService(siftVerifier.get());
+                builder.RegisterService(static_cast<remote::ISift::Service*>(siftVerifier.get()));
+                builder.RegisterService(static_cast<remote::ICompactSift::Service*>(siftVerifier.get()));
             }
         }
 
@@ -140,12 +211,23 @@ namespace cqp
 
         /// detects photons
         std::shared_ptr<sim::DummyTimeTagger> timeTagger = nullptr;
+        /// Produces photons when being alice with a simulated channel
+        std::shared_ptr<sim::SimulatedTransmitter> simulatedSource = nullptr;
+        /// detects photons with a simulated channel
+        std::shared_ptr<sim::SimulatedTimeTagger> simulatedTagger = nullptr;
+        /// provides alignment markers when being alice with a simulated channel
+        std::shared_ptr<align::MarkerServer> markerServer = nullptr;
+        /// aligns the simulated time tags when being bob
+        std::shared_ptr<align::SlotAlignment> slotAlignment = nullptr;
 
         std::shared_ptr<session::SessionController> controller = nullptr;
 
         std::shared_ptr<stats::ReportServer> reportServer;
     };
 
+    constexpr size_t DummyQKD::ProcessingChain::SimulatedSlotsPerFrame;
+    constexpr uint64_t DummyQKD::ProcessingChain::DriftSamplesPerFrame;
+
     DummyQKD::DummyQKD(const std::string& address, std::shared_ptr<grpc::ChannelCredentials> creds)
     {
         const URI addrUri(address);
@@ -195,12 +277,46 @@ namespace cqp
                     LOGERROR(e.what());
                 }
             }
+            else if(param.first == Parameters::errorCorrection)
+            {
+                errorCorrection = param.second;
+            }
+            else if(param.first == Parameters::simulatedChannel)
+            {
+                simulatedChannel = param.second;
+            }
+            else if(param.first == Parameters::siftWindow)
+            {
+                try
+                {
+                    siftWindow = static_cast<unsigned int>(std::stoul(param.second));
+                }
+                catch (const std::exception& e)
+                {
+                    LOGERROR(e.what());
+                }
+            }
             else
             {
-                LOGWARN("Unknown parameter: " + param.first);
+                bool known = true;
+                try
+                {
+                    known = channelParameters.SetParameter(param.first, param.second);
+                }
+                catch (const std::exception& e)
+                {
+                    LOGERROR(e.what());
+                }
+
+                if(!known)
+                {
+                    LOGWARN("Unknown parameter: " + param.first);
+                }
             }
         }
-        processing = std::make_unique<ProcessingChain>(creds, &rng, config.side());
+        processing = std::make_unique<ProcessingChain>(creds, &rng, config.side(),
+                     ec::ErrorCorrection::ParseMode(errorCorrection), siftWindow, simulatedChannel,
+                     channelParameters);
 
         // reset any values that cant be changed
         config.set_kind(DriverName);
@@ -210,9 +326,17 @@ namespace cqp
         }
     }
 
-    DummyQKD::DummyQKD(const remote::DeviceConfig& initialConfig, std::shared_ptr<grpc::ChannelCredentials> creds):
-        processing{std::make_unique<ProcessingChain>(creds, &rng, initialConfig.side())},
-        config{initialConfig}
+    DummyQKD::DummyQKD(const remote::DeviceConfig& initialConfig, std::shared_ptr<grpc::ChannelCredentials> creds,
+                       const std::string& errorCorrection, unsigned int siftWindow,
+                       const std::string& simulatedChannel, const sim::ChannelParameters& channelParameters):
+        processing{std::make_unique<ProcessingChain>(creds, &rng, initialConfig.side(),
+                   ec::ErrorCorrection::ParseMode(errorCorrection), siftWindow, simulatedChannel,
+                   channelParameters)},
+        config{initialConfig},
+        errorCorrection{errorCorrection},
+        siftWindow{siftWindow},
+        simulatedChannel{simulatedChannel},
+        channelParameters{channelParameters}
     {
         // reset any values that cant be changed
         config.set_kind(DriverName);
@@ -236,7 +360,21 @@ namespace cqp
 
     URI cqp::DummyQKD::GetAddress() const
     {
-        return DeviceUtils::ConfigToUri(config);
+        URI result = DeviceUtils::ConfigToUri(config);
+        if(!errorCorrection.empty())
+        {
+            result.SetParameter(Parameters::errorCorrection, errorCorrection);
+        }
+        if(siftWindow > 1)
+        {
+            result.SetParameter(Parameters::siftWindow, std::to_string(siftWindow));
+        }
+        if(!simulatedChannel.empty())
+        {
+            result.SetParameter(Parameters::simulatedChannel, simulatedChannel);
+            channelParameters.ToURI(result);
+        }
+        return result;
 
     }
 
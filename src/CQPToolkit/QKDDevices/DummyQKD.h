@@ -16,6 +16,7 @@
 #include "QKDInterfaces/Site.pb.h"             // for Device, Side, Side::Type
 #include "Algorithms/Datatypes/URI.h"               // for URI
 #include "Algorithms/Random/RandomNumber.h"
+#include "CQPToolkit/Simulation/PhotonChannel.h"
 #include <grpcpp/security/credentials.h>
 
 namespace cqp
@@ -38,8 +39,16 @@ namespace cqp
          * Constructor
          * @param initialConfig config details
          * @param creds credentials to use when talking to peer
+         * @param errorCorrection The error correction mode, see ec::ErrorCorrection::ParseMode
+         * @param siftWindow How many sift requests Bob can have waiting for an answer
+         * @param simulatedChannel When set, photons are sent through the sim::PhotonChannel with this name
+         * to a device in the same process, instead of over the network
+         * @param channelParameters How the simulated channel behaves, if this device creates it
          */
-        DummyQKD(const remote::DeviceConfig& initialConfig, std::shared_ptr<grpc::ChannelCredentials> creds);
+        DummyQKD(const remote::DeviceConfig& initialConfig, std::shared_ptr<grpc::ChannelCredentials> creds,
+                 const std::string& errorCorrection = "", unsigned int siftWindow = 1,
+                 const std::string& simulatedChannel = "",
+                 const sim::ChannelParameters& channelParameters = {});
 
         /**
          * @brief DummyQKD
@@ -97,6 +106,14 @@ namespace cqp
         std::unique_ptr<ProcessingChain> processing;
         /// device configuration
         remote::DeviceConfig config;
+        /// The error correction mode, both sides must match
+        std::string errorCorrection;
+        /// How many sift requests Bob can have waiting for an answer
+        unsigned int siftWindow = 1;
+        /// The in process channel to send photons through, empty to use the network
+        std::string simulatedChannel;
+        /// How the simulated channel behaves, see sim::ChannelParameters::Names for the address parameters
+        sim::ChannelParameters channelParameters;
     };
 
 } // namespace cqp
@@ -36,12 +36,12 @@ namespace cqp
     class LEDAliceMk1::ProcessingChain
     {
     public:
-        ProcessingChain()
+        explicit ProcessingChain(ec::ErrorCorrection::Mode ecMode)
         {
             using namespace std;
             align = make_shared<align::TransmissionHandler>();
-            ec = make_shared<ec::ErrorCorrection>();
-            privacy = make_shared<privacy::PrivacyAmplify>();
+            ec = make_shared<ec::ErrorCorrection>(remote::Side::Alice, ecMode);
+            privacy = make_shared<privacy::PrivacyAmplify>(remote::Side::Alice);
             reportServer = make_shared<stats::ReportServer>();
 
             align->Attach(ec.get());
@@ -69,6 +69,7 @@ namespace cqp
             session::SessionController::RemoteCommsList remotes;
             remotes.push_back(align);
             remotes.push_back(ec);
+            remotes.push_back(privacy);
 
             return remotes;
         }
@@ -76,16 +77,21 @@ namespace cqp
         void RegisterServices(grpc::ServerBuilder& builder)
         {
             builder.RegisterService(align.get());
-            builder.RegisterService(ec.get());
-            builder.RegisterService(privacy.get());
+            builder.RegisterService(static_cast<remote::IErrorCorrect::Service*>(ec.get()));
+            builder.RegisterService(static_cast<remote::ICascade::Service*>(ec.get()));
+            builder.RegisterService(static_cast<remote::ILdpc::Service*>(ec.get()));
+            builder.RegisterService(static_cast<remote::IPrivacyAmplify::Service*>(privacy.get()));
+            builder.RegisterService(static_cast<remote::IToeplitz::Service*>(privacy.get()));
             builder.RegisterService(reportServer.get());
         }
     };
 
     LEDAliceMk1::LEDAliceMk1(std::shared_ptr<grpc::ChannelCredentials> creds,
-                             const std::string& controlName, const std::string& usbSerialNumber) :
-        processing{std::make_unique<ProcessingChain>()},
-        driver{std::make_shared<LEDDriver>(&rng, controlName, usbSerialNumber)}
+                             const std::string& controlName, const std::string& usbSerialNumber,
+                             const std::string& errorCorrection) :
+        processing{std::make_unique<ProcessingChain>(ec::ErrorCorrection::ParseMode(errorCorrection))},
+        driver{std::make_shared<LEDDriver>(&rng, controlName, usbSerialNumber)},
+        errorCorrection{errorCorrection}
     {
         // create the session controller
         sessionController = std::make_unique<session::AliceSessionController>(creds, processing->GetRemotes(), driver, processing->reportServer);
@@ -94,9 +100,11 @@ namespace cqp
     }
 
     LEDAliceMk1::LEDAliceMk1(std::shared_ptr<grpc::ChannelCredentials> creds,
-                             std::unique_ptr<Serial> controlPort, std::unique_ptr<Usb> dataPort):
-        processing{std::make_unique<ProcessingChain>()},
-        driver{std::make_shared<LEDDriver>(&rng, move(controlPort), move(dataPort))}
+                             std::unique_ptr<Serial> controlPort, std::unique_ptr<Usb> dataPort,
+                             const std::string& errorCorrection):
+        processing{std::make_unique<ProcessingChain>(ec::ErrorCorrection::ParseMode(errorCorrection))},
+        driver{std::make_shared<LEDDriver>(&rng, move(controlPort), move(dataPort))},
+        errorCorrection{errorCorrection}
     {
         // create the session controller
         sessionController = std::make_unique<session::AliceSessionController>(creds, processing->GetRemotes(), driver, processing->reportServer);
@@ -132,6 +140,10 @@ namespace cqp
         result.SetScheme(DriverName);
         result.SetParameter(IQKDDevice::Parameters::side, IQKDDevice::Parameters::SideValues::alice);
         result.SetParameter(IQKDDevice::Parameters::keybytes, "16");
+        if(!errorCorrection.empty())
+        {
+            result.SetParameter(IQKDDevice::Parameters::errorCorrection, errorCorrection);
+        }
         return result;
     }
 
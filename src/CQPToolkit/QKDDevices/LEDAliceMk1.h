@@ -39,8 +39,10 @@ namespace cqp
          * @param controlName Serial port for configuring the device
          * @param usbSerialNumber The serial number for the usb device
          * @param creds credentials to use for connections
+         * @param errorCorrection The error correction mode, see ec::ErrorCorrection::ParseMode
          */
-        LEDAliceMk1(std::shared_ptr<grpc::ChannelCredentials> creds, const std::string& controlName = "", const std::string& usbSerialNumber = "");
+        LEDAliceMk1(std::shared_ptr<grpc::ChannelCredentials> creds, const std::string& controlName = "", const std::string& usbSerialNumber = "",
+                    const std::string& errorCorrection = "");
 
         /**
          * @brief LEDAliceMk1
@@ -48,8 +50,10 @@ namespace cqp
          * @param controlPort Serial port for configuring the device
          * @param dataPort usb port for sending data
          * @param creds credentials to use for connections
+         * @param errorCorrection The error correction mode, see ec::ErrorCorrection::ParseMode
          */
-        LEDAliceMk1(std::shared_ptr<grpc::ChannelCredentials> creds, std::unique_ptr<Serial> controlPort, std::unique_ptr<Usb> dataPort);
+        LEDAliceMk1(std::shared_ptr<grpc::ChannelCredentials> creds, std::unique_ptr<Serial> controlPort, std::unique_ptr<Usb> dataPort,
+                    const std::string& errorCorrection = "");
 
         /// Destructor
         virtual ~LEDAliceMk1() override;
@@ -94,5 +98,7 @@ namespace cqp
         std::unique_ptr<session::AliceSessionController> sessionController;
         /// The driver which produces the photons
         std::shared_ptr<LEDDriver> driver;
+        /// The error correction mode, both sides must match
+        std::string errorCorrection;
     };
 }
@@ -34,12 +34,12 @@ namespace cqp
     class PhotonDetectorMk1::ProcessingChain
     {
     public:
-        ProcessingChain()
+        explicit ProcessingChain(ec::ErrorCorrection::Mode ecMode)
         {
             using namespace std;
             align = make_shared<align::DetectionReciever>();
-            ec = make_shared<ec::ErrorCorrection>();
-            privacy = make_shared<privacy::PrivacyAmplify>();
+            ec = make_shared<ec::ErrorCorrection>(remote::Side::Bob, ecMode);
+            privacy = make_shared<privacy::PrivacyAmplify>(remote::Side::Bob);
             reportServer = make_shared<stats::ReportServer>();
 
             align->Attach(ec.get());
@@ -67,21 +67,27 @@ namespace cqp
             session::SessionController::RemoteCommsList remotes;
             remotes.push_back(align);
             remotes.push_back(ec);
+            remotes.push_back(privacy);
             return remotes;
         }
 
         void RegisterServices(grpc::ServerBuilder& builder)
         {
-            builder.RegisterService(ec.get());
-            builder.RegisterService(privacy.get());
+            builder.RegisterService(static_cast<remote::IErrorCorrect::Service*>(ec.get()));
+            builder.RegisterService(static_cast<remote::ICascade::Service*>(ec.get()));
+            builder.RegisterService(static_cast<remote::ILdpc::Service*>(ec.get()));
+            builder.RegisterService(static_cast<remote::IPrivacyAmplify::Service*>(privacy.get()));
+            builder.RegisterService(static_cast<remote::IToeplitz::Service*>(privacy.get()));
             builder.RegisterService(reportServer.get()); // allow external clients to get stats
 
         }
     };
 
-    PhotonDetectorMk1::PhotonDetectorMk1(std::shared_ptr<grpc::ChannelCredentials> creds, const std::string& controlName, const std::string& usbSerialNumber) :
-        processing{std::make_unique<ProcessingChain>()},
-        driver{std::make_shared<UsbTagger>(controlName, usbSerialNumber)}
+    PhotonDetectorMk1::PhotonDetectorMk1(std::shared_ptr<grpc::ChannelCredentials> creds, const std::string& controlName, const std::string& usbSerialNumber,
+                                         const std::string& errorCorrection) :
+        processing{std::make_unique<ProcessingChain>(ec::ErrorCorrection::ParseMode(errorCorrection))},
+        driver{std::make_shared<UsbTagger>(controlName, usbSerialNumber)},
+        errorCorrection{errorCorrection}
     {
         // create the session controller
         sessionController = std::make_unique<session::SessionController>(creds, processing->GetRemotes(), processing->reportServer);
@@ -89,9 +95,11 @@ namespace cqp
         driver->Attach(processing->align.get());
     }
 
-    PhotonDetectorMk1::PhotonDetectorMk1(std::shared_ptr<grpc::ChannelCredentials> creds, std::unique_ptr<Serial> serialDev, std::unique_ptr<Usb> usbDev) :
-        processing{std::make_unique<ProcessingChain>()},
-        driver{std::make_shared<UsbTagger>(move(serialDev), move(usbDev))}
+    PhotonDetectorMk1::PhotonDetectorMk1(std::shared_ptr<grpc::ChannelCredentials> creds, std::unique_ptr<Serial> serialDev, std::unique_ptr<Usb> usbDev,
+                                         const std::string& errorCorrection) :
+        processing{std::make_unique<ProcessingChain>(ec::ErrorCorrection::ParseMode(errorCorrection))},
+        driver{std::make_shared<UsbTagger>(move(serialDev), move(usbDev))},
+        errorCorrection{errorCorrection}
     {
         // create the session controller
         sessionController = std::make_unique<session::SessionController>(creds, processing->GetRemotes(),
@@ -102,6 +110,11 @@ namespace cqp
 
     PhotonDetectorMk1::~PhotonDetectorMk1() = default;
 
+    bool PhotonDetectorMk1::SetArchive(const std::string& fileName)
+    {
+        return driver->SetArchive(fileName);
+    }
+
     string PhotonDetectorMk1::GetDriverName() const
     {
         return DriverName;
@@ -120,6 +133,10 @@ namespace cqp
         result.SetScheme(DriverName);
         result.SetParameter(IQKDDevice::Parameters::side, IQKDDevice::Parameters::SideValues::bob);
         result.SetParameter(IQKDDevice::Parameters::keybytes, "16");
+        if(!errorCorrection.empty())
+        {
+            result.SetParameter(IQKDDevice::Parameters::errorCorrection, errorCorrection);
+        }
         return result;
     }
 
@@ -37,8 +37,10 @@ namespace cqp
          * @param creds grpc channel credentials to use
          * @param controlName The path to the serial device
          * @param usbSerialNumber The serial number of the usb device, use blank to use the first device
+         * @param errorCorrection The error correction mode, see ec::ErrorCorrection::ParseMode
          */
-        explicit PhotonDetectorMk1(std::shared_ptr<grpc::ChannelCredentials> creds, const std::string& controlName = "", const std::string& usbSerialNumber = "");
+        explicit PhotonDetectorMk1(std::shared_ptr<grpc::ChannelCredentials> creds, const std::string& controlName = "", const std::string& usbSerialNumber = "",
+                                   const std::string& errorCorrection = "");
 
         /**
          * @brief PhotonDetectorMk1
@@ -46,14 +48,25 @@ namespace cqp
          * @param creds grpc channel credentials to use
          * @param usbDev usb data transfer device
          * @param serialDev serial control device
+         * @param errorCorrection The error correction mode, see ec::ErrorCorrection::ParseMode
          */
-        PhotonDetectorMk1(std::shared_ptr<grpc::ChannelCredentials> creds, std::unique_ptr<Serial> serialDev, std::unique_ptr<cqp::Usb> usbDev);
+        PhotonDetectorMk1(std::shared_ptr<grpc::ChannelCredentials> creds, std::unique_ptr<Serial> serialDev, std::unique_ptr<cqp::Usb> usbDev,
+                          const std::string& errorCorrection = "");
 
         /**
          * Destructor
          */
         ~PhotonDetectorMk1() override;
 
+        /**
+         * @brief SetArchive
+         * Record every detection report from the tagger so that it can be replayed
+         * @see UsbTagger::SetArchive
+         * @param fileName The archive to create, empty to stop recording
+         * @return true if the archive was created
+         */
+        bool SetArchive(const std::string& fileName);
+
         /// @name IQKDDevice interface
         /// @{
         /// The name of this driver
@@ -86,6 +99,8 @@ namespace cqp
         std::unique_ptr<session::SessionController> sessionController;
         /// The driver which detects the photons
         std::shared_ptr<UsbTagger> driver;
+        /// The error correction mode, both sides must match
+        std::string errorCorrection;
     };
 
 }
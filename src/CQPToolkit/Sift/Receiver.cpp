@@ -11,16 +11,18 @@
 */
 #include "Receiver.h"
 #include "CQPToolkit/Util/GrpcLogger.h"
+#include <algorithm>
 
 namespace cqp
 {
     namespace sift
     {
 
-        Receiver::Receiver(unsigned int framesBeforeVerify) :
+        Receiver::Receiver(unsigned int framesBeforeVerify, unsigned int maxInFlight) :
             WorkerThread (),
             SiftBase (statesMutex, statesCv),
-            minFramesBeforeVerify(framesBeforeVerify)
+            minFramesBeforeVerify(framesBeforeVerify),
+            maxRequestsInFlight(std::max(1u, maxInFlight))
         {
         }
 
@@ -34,6 +36,9 @@ namespace cqp
             }// lock scope
 
             verifier = remote::ISift::NewStub(channel);
+            // try the compact format first, this is dropped if the verifier doesn't support it
+            compactVerifier = remote::ICompactSift::NewStub(channel);
+            useCompact = true;
 
             if(verifier == nullptr)
             {
@@ -56,6 +61,7 @@ namespace cqp
 
             Stop(true);
             verifier = nullptr;
+            compactVerifier = nullptr;
         }
 
         void Receiver::OnPhotonReport(std::unique_ptr<ProtocolDetectionReport> report)
@@ -63,13 +69,16 @@ namespace cqp
             using namespace std;
             LOGTRACE("Received aligned qubits");
 
+            // keep the packed form, the report is freed
+            DetectedFrame frame = PackDetections(*report);
+
             // Lock scope
             {
                 std::lock_guard<std::mutex>  lock(statesMutex);
 
                 if(collectedStates.find(report->frame) == collectedStates.end())
                 {
-                    collectedStates[report->frame] = move(report);
+                    collectedStates.emplace(report->frame, move(frame));
                 } // if
                 else
                 {
@@ -91,21 +100,25 @@ namespace cqp
 
             SequenceNumber firstSeq = 0;
             bool result = true;
+            // requests which have been sent but not yet published, oldest first
+            std::deque<PendingSift> inFlight;
 
             while(!ShouldStop())
             {
                 StatesList statesToWorkOn;
-                IntensitiesByFrame intensitiesToWorkOn;
-                remote::BasisBySiftFrame basis;
-                remote::AnswersByFrame answers;
 
                 /*lock scope*/
                 {
                     std::unique_lock<std::mutex>  lock(statesMutex);
-                    // Wait for data to be available
-                    result = statesCv.wait_for(lock, threadTimeout, bind(&Receiver::ValidateIncomming, this, firstSeq));
+                    // Wait for data to be available or for the oldest request to finish
+                    result = statesCv.wait_for(lock, threadTimeout, [&]()
+                    {
+                        return (!inFlight.empty() && *inFlight.front().done) ||
+                               (inFlight.size() < maxRequestsInFlight && ValidateIncomming(firstSeq));
+                    });
 
-                    if(result && !collectedStates.empty())
+                    // don't take any more frames while the window is full, they will wait in collectedStates
+                    if(result && inFlight.size() < maxRequestsInFlight && ValidateIncomming(firstSeq))
                     {
                         auto it = collectedStates.find(firstSeq);
 
@@ -125,50 +138,128 @@ namespace cqp
                 }/*lock scope*/
                 // unlock to allow more to be added
 
-                // result will be false if it timed out
-                if(result)
+                if(!statesToWorkOn.empty())
                 {
-                    auto it = statesToWorkOn.begin();
-                    while(it != statesToWorkOn.end())
-                    {
-                        // extract the basis from the qubits
-                        auto& currentList = (*basis.mutable_basis())[it->first];
-
-                        for(auto& detection : it->second->detections)
-                        {
-                            // convert to basis value and add to the list
-                            auto newItem = currentList.mutable_indexedbasis()->Add();
-                            newItem->set_index(detection.time.count());
-                            newItem->set_basis(remote::Basis::Type((QubitHelper::Base(detection.value))));
-                        } // for
-
-                        ++it;
-                    } // while(it != end)
-
                     // send the bases to alice
                     if(verifier)
                     {
-                        grpc::ClientContext ctx;
-                        result = LogStatus(
-                                     verifier->VerifyBases(&ctx, basis, &answers)).ok();
-
-                        if(result)
+                        if(useCompact)
                         {
-                            // Process the results
-                            PublishStates(statesToWorkOn.begin(), statesToWorkOn.end(), answers);
+                            inFlight.push_back(SendCompact(move(statesToWorkOn)));
+                        }
+                        else
+                        {
+                            // the original interface has no frame ids so everything sent before must be published first
+                            FinishRequests(inFlight, true);
+                            SiftOriginal(statesToWorkOn, siftedSequence++);
                         }
-
                     } // if
                     else
                     {
                         LOGERROR("Sift: No verifier");
                     }
-                } // if(result)
+                } // if states
+
+                FinishRequests(inFlight, false);
             } // while(!ShouldStop())
 
+            // publish anything still outstanding
+            FinishRequests(inFlight, true);
             LOGTRACE("Transmitter DoWork Leaving");
         } // DoWork
 
+        Receiver::PendingSift Receiver::SendCompact(StatesList states)
+        {
+            PendingSift pending;
+            pending.siftedId = siftedSequence++;
+            pending.done = std::make_shared<bool>(false);
+
+            remote::CompactBasesByFrame request;
+            request.set_siftedframe(pending.siftedId);
+            for(const auto& frame : states)
+            {
+                EncodeBases(frame.second, (*request.mutable_basis())[frame.first]);
+            }
+            pending.states = std::move(states);
+
+            remote::ICompactSift::Stub* stub = compactVerifier.get();
+            std::shared_ptr<bool> done = pending.done;
+            pending.reply = std::async(std::launch::async, [this, stub, done, request = std::move(request)]()
+            {
+                CompactReply reply;
+                grpc::ClientContext ctx;
+                reply.status = stub->VerifyBasesCompact(&ctx, request, &reply.answers);
+
+                /*lock scope*/
+                {
+                    std::lock_guard<std::mutex> lock(statesMutex);
+                    *done = true;
+                }/*lock scope*/
+                // wake DoWork, the result will be ready by the time it calls get()
+                statesCv.notify_all();
+                return reply;
+            });
+
+            return pending;
+        } // SendCompact
+
+        void Receiver::FinishRequests(std::deque<PendingSift>& inFlight, bool wait)
+        {
+            while(!inFlight.empty() &&
+                    (wait || inFlight.front().reply.wait_for(std::chrono::seconds(0)) == std::future_status::ready))
+            {
+                PendingSift pending = std::move(inFlight.front());
+                inFlight.pop_front();
+                const CompactReply reply = pending.reply.get();
+
+                if(reply.status.error_code() == grpc::StatusCode::UNIMPLEMENTED)
+                {
+                    if(useCompact)
+                    {
+                        // the other side only understands the original format, stop trying
+                        LOGINFO("Verifier does not support compact sifting");
+                        useCompact = false;
+                    }
+                    SiftOriginal(pending.states, pending.siftedId);
+                }
+                else if(LogStatus(reply.status).ok())
+                {
+                    // Process the results
+                    PublishStates(pending.states.begin(), pending.states.end(), reply.answers, pending.siftedId);
+                }
+            }
+        } // FinishRequests
+
+        void Receiver::SiftOriginal(const StatesList& states, SequenceNumber siftedId)
+        {
+            remote::BasisBySiftFrame basis;
+            remote::AnswersByFrame answers;
+
+            auto it = states.begin();
+            while(it != states.end())
+            {
+                // extract the basis from the qubits
+                auto& currentList = (*basis.mutable_basis())[it->first];
+
+                for(size_t detection = 0; detection < it->second.slots.size(); detection++)
+                {
+                    // convert to basis value and add to the list
+                    auto newItem = currentList.mutable_indexedbasis()->Add();
+                    newItem->set_index(it->second.slots[detection]);
+                    newItem->set_basis(remote::Basis::Type(it->second.results.BasisAt(detection)));
+                } // for
+
+                ++it;
+            } // while(it != end)
+
+            grpc::ClientContext ctx;
+            if(LogStatus(verifier->VerifyBases(&ctx, basis, &answers)).ok())
+            {
+                // Process the results
+                PublishStates(states.begin(), states.end(), answers, siftedId);
+            }
+        } // SiftOriginal
+
         bool Receiver::ValidateIncomming(SequenceNumber firstSeq) const
         {
             bool result = false;
@@ -232,32 +323,61 @@ namespace cqp
             return result;
         } // ValidateIncomming
 
+        Receiver::DetectedFrame Receiver::PackDetections(const ProtocolDetectionReport& report)
+        {
+            DetectedFrame result;
+            QubitList values(report.detections.size());
+            result.slots.resize(report.detections.size());
+
+            for(size_t detection = 0; detection < report.detections.size(); detection++)
+            {
+                result.slots[detection] = static_cast<uint64_t>(report.detections[detection].time.count());
+                values[detection] = report.detections[detection].value;
+            }
+            result.results = PackedQubits(values);
+
+            return result;
+        }
+
+        void Receiver::EncodeBases(const DetectedFrame& frame, remote::CompactBases& bases)
+        {
+            const auto& slots = frame.slots;
+            auto& indexDeltas = *bases.mutable_indexdelta();
+            std::string& basisBytes = *bases.mutable_bases();
+
+            indexDeltas.Reserve(static_cast<int>(slots.size()));
+            basisBytes.assign((slots.size() + 3) / 4, 0);
+
+            uint64_t lastIndex = 0;
+            for(size_t detection = 0; detection < slots.size(); detection++)
+            {
+                const uint64_t index = slots[detection];
+                // detections are in time order so the differences are small
+                indexDeltas.AddAlreadyReserved(index - lastIndex);
+                lastIndex = index;
+
+                const unsigned basis = static_cast<uint8_t>(frame.results.BasisAt(detection)) >> 1;
+                basisBytes[detection / 4] = static_cast<char>(basisBytes[detection / 4] | (basis << (2 * (detection % 4))));
+            }
+        }
+
+        template<typename Answers>
         void Receiver::PublishStates(StatesList::const_iterator start, StatesList::const_iterator end,
-                                     const remote::AnswersByFrame& answers)
+                                     const Answers& answers, SequenceNumber siftedId)
         {
             using std::chrono::high_resolution_clock;
             high_resolution_clock::time_point timerStart = high_resolution_clock::now();
 
 
-            std::unique_ptr<JaggedDataBlock> siftedData(new JaggedDataBlock());
-            JaggedDataBlock::value_type value = 0;
-            uint_least8_t offset = 0;
+            PackedBits sifted;
+            size_t siftedBits = 0;
 
             for(auto listIt = start; listIt != end; listIt++)
             {
-                // grow the storage enough to fit the next set of data
-                siftedData->reserve(siftedData->size() + listIt->second->detections.size() / bitsPerValue);
-
                 auto answersIt = answers.answers().find(listIt->first);
                 if(answersIt != answers.answers().end())
                 {
-                    size_t index = 0;
-                    for(const auto& qubit : listIt->second->detections)
-                    {
-                        PackQubit(qubit.value, index, answersIt->second,
-                                  *siftedData, offset, value);
-                        index++;
-                    }// for qubits
+                    SiftQubits(listIt->second.results, answersIt->second, sifted, siftedBits);
                 }
                 else
                 {
@@ -265,13 +385,7 @@ namespace cqp
                 }
             }
 
-            if(offset != 0)
-            {
-                // There weren't enough bits to completely fill the last word,
-                // Add the remaining, the mask will show which bits are valid
-                siftedData->push_back(value);
-                siftedData->bitsInLastByte = offset;
-            } // if(offset != 0)
+            std::unique_ptr<JaggedDataBlock> siftedData(new JaggedDataBlock(UnpackBits(sifted, siftedBits)));
 
             if(siftedData->empty())
             {
@@ -282,9 +396,7 @@ namespace cqp
 
             double securityParameter = 0.0; // TODO
             // publish the results on our side
-            Emit(&ISiftedCallback::OnSifted, siftedSequence, securityParameter, move(siftedData));
-
-            siftedSequence++;
+            Emit(&ISiftedCallback::OnSifted, siftedId, securityParameter, move(siftedData));
 
             stats.publishTime.Update(high_resolution_clock::now() - timerStart);
             stats.bytesProduced.Update(bytesProduced);
@@ -13,7 +13,10 @@
 #include "Algorithms/Util/WorkerThread.h"
 #include "SiftBase.h"
 #include "QKDInterfaces/ISift.grpc.pb.h"
+#include "CQPToolkit/ICompactSift.grpc.pb.h"
 #include "CQPToolkit/Interfaces/IDetectionEventPublisher.h"
+#include <deque>
+#include <future>
 
 namespace cqp
 {
@@ -31,8 +34,10 @@ namespace cqp
              * @brief BB84Sifter
              * Constructor
              * @param framesBeforeVerify How many frames to collect before verifying data.
+             * @param maxInFlight How many requests can be sent to the verifier before waiting for an answer.
+             * Only used with ICompactSift, the original interface has one request at a time.
              */
-            explicit Receiver(unsigned int framesBeforeVerify = 1);
+            explicit Receiver(unsigned int framesBeforeVerify = 1, unsigned int maxInFlight = 1);
 
             /// @{
             /// @name IRemoteComms interface
@@ -64,6 +69,31 @@ namespace cqp
              */
             ~Receiver() override;
 
+            /// The detections of one frame, kept until they are sifted
+            struct DetectedFrame
+            {
+                /// The emission slot of each detection, in time order
+                std::vector<uint64_t> slots;
+                /// The qubit detected in each slot, packed to 3 bits per qubit
+                PackedQubits results;
+            };
+
+            /**
+             * @brief PackDetections
+             * Convert aligned detections to the form which is kept until they are sifted
+             * @param report The detections for one frame, the times are the emission slots
+             * @return The packed detections
+             */
+            static DetectedFrame PackDetections(const ProtocolDetectionReport& report);
+
+            /**
+             * @brief EncodeBases
+             * Pack the indexes and bases of detections for ICompactSift
+             * @param frame The detections for one frame
+             * @param[out] bases The packed detections
+             */
+            static void EncodeBases(const DetectedFrame& frame, remote::CompactBases& bases);
+
         protected:
             ///@{
             /// @name WorkerThread Override
@@ -76,7 +106,8 @@ namespace cqp
              * activate BB84Sifter
              *      BB84Sifter -> BB84Sifter : WaitForData
              *      BB84Sifter -> BB84Sifter : ProcessStates
-             *      BB84Sifter -> ISift : VerifyBases
+             *      BB84Sifter -> ICompactSift : VerifyBasesCompact
+             *      note right : up to maxInFlight requests are sent before waiting for an answer
              *      BB84Sifter -> BB84Sifter : Emit(validData)
              * deactivate BB84Sifter
              * @enduml
@@ -95,16 +126,77 @@ namespace cqp
             bool ValidateIncomming(SequenceNumber firstSeq) const;
 
         protected:
-            using StatesList = std::map<SequenceNumber, std::unique_ptr<ProtocolDetectionReport>>;
+            using StatesList = std::map<SequenceNumber, DetectedFrame>;
+
+            /// The result of a call to ICompactSift
+            struct CompactReply
+            {
+                /// The result of the call
+                grpc::Status status;
+                /// The answers from the verifier
+                remote::CompactAnswersByFrame answers;
+            };
+
+            /// A request to the verifier which hasn't been published
+            struct PendingSift
+            {
+                /// The frames in the request
+                StatesList states;
+                /// The id the result will be published with
+                SequenceNumber siftedId = 0;
+                /// Set, under statesMutex, when the call has returned
+                std::shared_ptr<bool> done;
+                /// The answers
+                std::future<CompactReply> reply;
+            };
+
+            /**
+             * @brief SendCompact
+             * Start a call to ICompactSift, the call runs in the background
+             * @param states The frames to verify
+             * @return The request
+             */
+            PendingSift SendCompact(StatesList states);
 
+            /**
+             * @brief FinishRequests
+             * Publish the oldest requests which have been answered, in the order they were sent
+             * @param inFlight The outstanding requests
+             * @param wait If true, wait for all requests to be answered
+             */
+            void FinishRequests(std::deque<PendingSift>& inFlight, bool wait);
+
+            /**
+             * @brief SiftOriginal
+             * Verify the frames with ISift and publish the result
+             * @param states The frames to verify
+             * @param siftedId The id to publish the result with
+             */
+            void SiftOriginal(const StatesList& states, SequenceNumber siftedId);
+
+            /**
+             * @brief PublishStates
+             * Sift the frames with the answers from the verifier and publish the result
+             * @param start The first frame
+             * @param end One past the last frame
+             * @param answers The answers in either format
+             * @param siftedId The id to publish the result with
+             */
+            template<typename Answers>
             void PublishStates(StatesList::const_iterator start, StatesList::const_iterator end,
-                               const remote::AnswersByFrame& answers);
+                               const Answers& answers, SequenceNumber siftedId);
             /// The other side to communicate with during sifting
             std::unique_ptr<remote::ISift::Stub> verifier;
+            /// The packed interface to the other side
+            std::unique_ptr<remote::ICompactSift::Stub> compactVerifier;
+            /// false once the verifier has said it doesn't support ICompactSift
+            bool useCompact = true;
             /// How long to wait for new data before checking if the thread should be stopped
             const std::chrono::seconds threadTimeout {1};
             /// How many aligned frames to receive before trying to generate a sifted frame
             const unsigned int minFramesBeforeVerify = 1;
+            /// How many compact requests can be waiting for an answer
+            const unsigned int maxRequestsInFlight = 1;
 
             /// a mutex for use with collectedStatesCv
             std::mutex statesMutex;
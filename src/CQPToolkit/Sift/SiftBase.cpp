@@ -10,55 +10,240 @@
 * @author Richard Collins <richard.collins@bristol.ac.uk>
 */
 #include "SiftBase.h"
+#include "Algorithms/Util/CpuFeatures.h"
+#include <algorithm>
+
+#if defined(__BMI2__)
+    #include <immintrin.h>
+    #define CQP_SIFT_BMI2
+    #define CQP_SIFT_BMI2_TARGET
+#elif defined(CQP_CPU_DISPATCH)
+    // build the PEXT version anyway, it's only used if the processor has it
+    #include <immintrin.h>
+    #define CQP_SIFT_BMI2
+    #define CQP_SIFT_BMI2_TARGET CQP_CPU_TARGET("bmi2")
+#endif
 
 namespace cqp
 {
     namespace sift
     {
 
+        /**
+         * @brief Extract
+         * Move the bits of value which are set in mask down to the bottom of the word
+         * @param value The bits to select from
+         * @param mask Which bits to select
+         * @return The selected bits, in order, starting at bit 0
+         */
+        static inline uint64_t Extract(uint64_t value, uint64_t mask) noexcept
+        {
+            uint64_t result = 0;
+            uint64_t outBit = 1;
+            // walk through the set bits of the mask, lowest first
+            while(mask != 0)
+            {
+                const uint64_t lowest = mask & (~mask + 1u);
+                if(value & lowest)
+                {
+                    result |= outBit;
+                }
+                outBit <<= 1;
+                mask &= mask - 1u;
+            }
+            return result;
+        }
+
+        /**
+         * @brief KeepMask
+         * @param keep Which bits to select
+         * @param word The word of keep to read
+         * @param numBits The number of bits in keep
+         * @return The word of keep with any bits past numBits cleared
+         */
+        static inline uint64_t KeepMask(const PackedBits& keep, size_t word, size_t numBits) noexcept
+        {
+            uint64_t mask = keep[word];
+            if(word == (numBits - 1) / bitsPerWord && numBits % bitsPerWord != 0)
+            {
+                mask &= (uint64_t(1) << (numBits % bitsPerWord)) - 1u;
+            }
+            return mask;
+        }
+
+        /**
+         * @brief AppendSelected
+         * Add the bits of one word, as returned by Extract, to the end of a bit string
+         * @param selected The selected bits
+         * @param count The number of bits selected
+         * @param[in,out] output The bit string to add to, must have room for the bits
+         * @param[in,out] outputBits The number of bits in output
+         */
+        static inline void AppendSelected(uint64_t selected, size_t count, PackedBits& output, size_t& outputBits) noexcept
+        {
+            const size_t shift = outputBits % bitsPerWord;
+            const size_t outWord = outputBits / bitsPerWord;
+
+            output[outWord] |= selected << shift;
+            if(shift != 0 && shift + count > bitsPerWord)
+            {
+                output[outWord + 1] = selected >> (bitsPerWord - shift);
+            }
+            outputBits += count;
+        }
+
+#if defined(CQP_SIFT_BMI2)
+        /// CompactBits using PEXT, the processor must support BMI2
+        CQP_SIFT_BMI2_TARGET
+        static void CompactWordsBmi2(const PackedBits& values, const PackedBits& keep, size_t numBits,
+                                     PackedBits& output, size_t& outputBits)
+        {
+            const size_t numWords = (numBits + bitsPerWord - 1) / bitsPerWord;
+            for(size_t word = 0; word < numWords; word++)
+            {
+                const uint64_t mask = KeepMask(keep, word, numBits);
+                if(mask != 0)
+                {
+                    AppendSelected(_pext_u64(values[word], mask), PopCount(mask), output, outputBits);
+                }
+            }
+        }
+#endif
+
+        /// CompactBits for any processor
+        static void CompactWords(const PackedBits& values, const PackedBits& keep, size_t numBits,
+                                 PackedBits& output, size_t& outputBits)
+        {
+            const size_t numWords = (numBits + bitsPerWord - 1) / bitsPerWord;
+            for(size_t word = 0; word < numWords; word++)
+            {
+                const uint64_t mask = KeepMask(keep, word, numBits);
+                if(mask != 0)
+                {
+                    AppendSelected(Extract(values[word], mask), PopCount(mask), output, outputBits);
+                }
+            }
+        }
+
         SiftBase::SiftBase(std::mutex& mutex, std::condition_variable& conditional):
             statesMutex{mutex}, statesCv{conditional}
         {
-
+            keptIntensities.fill(true);
         }
 
         void SiftBase::SetDiscardedIntensities(std::set<Intensity> intensities)
         {
             discardedIntensities = intensities;
+            keptIntensities.fill(true);
+            for(const auto intensity : discardedIntensities)
+            {
+                keptIntensities[intensity] = false;
+            }
         }
 
-        bool SiftBase::PackQubit(Qubit qubit, size_t index, const cqp::remote::BasisAnswers& answers,
-                                 JaggedDataBlock& siftedData,
-                                 uint_least8_t& offset, JaggedDataBlock::value_type& byteBuffer)
+        void SiftBase::CompactBits(const PackedBits& values, const PackedBits& keep, size_t numBits,
+                                   PackedBits& output, size_t& outputBits, bool useBmi2)
         {
-            bool result = false;
-            // test if this qubit is valid, ie the basis matched when they were compared.
-            if(index < answers.answers().size() && answers.answers(index) == true)
+            // make room for the worst case, the unused words are removed at the end
+            output.resize((outputBits + numBits + bitsPerWord - 1) / bitsPerWord, 0);
+
+#if defined(CQP_SIFT_BMI2)
+            if(useBmi2 && cpu::HasBmi2())
+            {
+                CompactWordsBmi2(values, keep, numBits, output, outputBits);
+            }
+            else
+#endif
             {
-                // pack the qubit if we're not using intensities or the intensity value is one we keep
-                if(answers.intensity().empty() ||
-                        discardedIntensities.find(answers.intensity(index)) == discardedIntensities.end())
+                CompactWords(values, keep, numBits, output, outputBits);
+            }
+
+            output.resize((outputBits + bitsPerWord - 1) / bitsPerWord);
+        }
+
+        /**
+         * @brief DiscardIntensities
+         * Clear the bits in keep for qubits which were sent with an intensity which isn't used
+         * @param[in,out] keep The qubits to keep
+         * @param numIntensities The number of intensities available, qubits beyond this are discarded
+         * @param keptIntensities true for each intensity which is kept
+         * @param intensityAt Returns the intensity of a qubit
+         */
+        template<typename IntensityAt>
+        static void DiscardIntensities(PackedBits& keep, size_t numIntensities,
+                                       const std::array<bool, std::numeric_limits<Intensity>::max() + 1>& keptIntensities,
+                                       IntensityAt intensityAt)
+        {
+            for(size_t word = 0; word < keep.size(); word++)
+            {
+                uint64_t mask = 0;
+                const size_t first = word * bitsPerWord;
+                const size_t last = std::min(first + bitsPerWord, numIntensities);
+                for(size_t index = first; index < last; index++)
                 {
-                    // we're using the qubit
-                    result = true;
-                    // shift the bit up to the next available slot and or it with the current value
-                    byteBuffer |= static_cast<JaggedDataBlock::value_type>(QubitHelper::BitValue(qubit)) << offset;
-                    // move to the next bit
-                    ++offset;
-
-                    // overflowing the byte, move to next byte
-                    if(offset == bitsPerValue)
-                    {
-                        // we have filled up a word, add it to the output and reset
-                        siftedData.push_back(byteBuffer);
-                        siftedData.bitsInLastByte = bitsPerValue;
-                        byteBuffer = 0;
-                        offset = 0;
-                    } // if overflow
-                } // if intensity is kept
-            } // if basis match
+                    const auto intensity = intensityAt(index);
+                    // values which can't be an Intensity can't have been discarded
+                    const bool kept = intensity > std::numeric_limits<Intensity>::max() ||
+                                      keptIntensities[intensity];
+                    mask |= static_cast<uint64_t>(kept) << (index - first);
+                }
+                keep[word] &= mask;
+            }
+        }
 
-            return result;
+        size_t SiftBase::SiftQubits(const PackedQubits& qubits, const remote::BasisAnswers& answers,
+                                    PackedBits& sifted, size_t& siftedBits) const
+        {
+            static_assert(sizeof(bool) == sizeof(Qubit), "Answers are read as bytes");
+            // anything without an answer is discarded
+            const size_t count = std::min<size_t>(qubits.size(), static_cast<size_t>(answers.answers().size()));
+            // the answers are 0 or 1 so they can be packed in the same way as the qubit values
+            PackedBits keep = PackedQubits::ExtractPlane(reinterpret_cast<const Qubit*>(answers.answers().data()),
+                              count, PackedQubits::Plane::Value);
+
+            if(!answers.intensity().empty())
+            {
+                // only keep the qubits which were sent with an intensity we use
+                DiscardIntensities(keep, std::min<size_t>(count, static_cast<size_t>(answers.intensity().size())),
+                                   keptIntensities, [&answers](size_t index)
+                {
+                    return answers.intensity(static_cast<int>(index));
+                });
+            }
+
+            const size_t before = siftedBits;
+            CompactBits(qubits.Values(), keep, count, sifted, siftedBits);
+            return siftedBits - before;
+        }
+
+        size_t SiftBase::SiftQubits(const PackedQubits& qubits, const remote::CompactAnswers& answers,
+                                    PackedBits& sifted, size_t& siftedBits) const
+        {
+            const std::string& answerBytes = answers.answers();
+            // anything without an answer is discarded
+            const size_t count = std::min<size_t>({qubits.size(), answers.numanswers(), answerBytes.size() * 8});
+
+            PackedBits keep((count + bitsPerWord - 1) / bitsPerWord, 0);
+            for(size_t index = 0; index < (count + 7) / 8; index++)
+            {
+                keep[index / sizeof(uint64_t)] |= static_cast<uint64_t>(static_cast<uint8_t>(answerBytes[index])) <<
+                                                 (8 * (index % sizeof(uint64_t)));
+            }
+
+            if(!answers.intensity().empty())
+            {
+                // only keep the qubits which were sent with an intensity we use
+                const std::string& intensities = answers.intensity();
+                DiscardIntensities(keep, std::min(count, intensities.size()), keptIntensities, [&intensities](size_t index)
+                {
+                    return static_cast<uint32_t>(static_cast<Intensity>(intensities[index]));
+                });
+            }
+
+            const size_t before = siftedBits;
+            // bits past count are ignored
+            CompactBits(qubits.Values(), keep, count, sifted, siftedBits);
+            return siftedBits - before;
         }
 
     } // namespace sift
@@ -13,10 +13,15 @@
 #include "CQPToolkit/Interfaces/ISiftedPublisher.h"
 #include "Algorithms/Util/Provider.h"
 #include "Algorithms/Datatypes/Qubits.h"
+#include "Algorithms/Datatypes/PackedQubits.h"
+#include "Algorithms/Util/Bits.h"
 #include "CQPToolkit/Sift/Stats.h"
 #include "QKDInterfaces/Qubits.pb.h"
+#include "CQPToolkit/ICompactSift.pb.h"
 #include "CQPToolkit/cqptoolkit_export.h"
 #include "CQPToolkit/Interfaces/IRemoteComms.h"
+#include <array>
+#include <limits>
 
 namespace cqp
 {
@@ -50,10 +55,45 @@ namespace cqp
 
             /// Statistics produced by this class
             Statistics stats;
+
+            /**
+             * @brief CompactBits
+             * Append the bits of values which are set in keep to the end of a bit string.
+             * Uses PEXT when the processor supports BMI2.
+             * @param values The bits to select from
+             * @param keep Which bits to select
+             * @param numBits The number of bits in values and keep
+             * @param[in,out] output The bit string to add to, bits past outputBits must be 0
+             * @param[in,out] outputBits The number of bits in output
+             * @param useBmi2 When false, the portable version is used even if PEXT is available
+             */
+            static void CompactBits(const PackedBits& values, const PackedBits& keep, size_t numBits,
+                                    PackedBits& output, size_t& outputBits, bool useBmi2 = true);
+
         protected:
-            bool PackQubit(Qubit qubit, size_t index, const cqp::remote::BasisAnswers& answers,
-                           JaggedDataBlock& siftedData,
-                           uint_least8_t& offset, JaggedDataBlock::value_type& byteBuffer);
+            /**
+             * @brief SiftQubits
+             * Append the values of the qubits which the other side accepted to the sifted key
+             * @param qubits The qubits of one frame
+             * @param answers The answers for the frame
+             * @param[in,out] sifted The sifted key
+             * @param[in,out] siftedBits The number of bits in sifted
+             * @return The number of qubits which were kept
+             */
+            size_t SiftQubits(const PackedQubits& qubits, const cqp::remote::BasisAnswers& answers,
+                              PackedBits& sifted, size_t& siftedBits) const;
+
+            /**
+             * @brief SiftQubits
+             * Append the values of the qubits which the other side accepted to the sifted key
+             * @param qubits The qubits of one frame
+             * @param answers The packed answers for the frame
+             * @param[in,out] sifted The sifted key
+             * @param[in,out] siftedBits The number of bits in sifted
+             * @return The number of qubits which were kept
+             */
+            size_t SiftQubits(const PackedQubits& qubits, const cqp::remote::CompactAnswers& answers,
+                              PackedBits& sifted, size_t& siftedBits) const;
 
             /// identifier for this instance
             std::string instance;
@@ -61,8 +101,8 @@ namespace cqp
             SequenceNumber siftedSequence = 0;
             /// which intensities should be ignored
             std::set<Intensity> discardedIntensities;
-            // calculate the number of bits in the current system.
-            static constexpr uint8_t bitsPerValue = sizeof(DataBlock::value_type) * CHAR_BIT;
+            /// true for each intensity which is kept, built from discardedIntensities
+            std::array<bool, std::numeric_limits<Intensity>::max() + 1> keptIntensities;
         private:
             /// a mutex for use with collectedStatesCv
             std::mutex& statesMutex;
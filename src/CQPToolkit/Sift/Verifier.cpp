@@ -11,6 +11,7 @@
 */
 #include "Verifier.h"
 #include <climits>
+#include <algorithm>
 #include "Stats.h"
 
 namespace cqp
@@ -24,21 +25,14 @@ namespace cqp
 
         }
 
-        grpc::Status Verifier::VerifyBases(grpc::ServerContext*, const remote::BasisBySiftFrame* request,
-                                           remote::AnswersByFrame* response)
+        template<typename Request>
+        bool Verifier::CollectStates(const Request& request, EmitterStateList& statesToWorkOn)
         {
-            LOGTRACE("");
-            using std::chrono::high_resolution_clock;
             using namespace std;
-            using google::protobuf::RepeatedField;
-            using grpc::Status;
+            bool dataReady = false;
 
-            Status result = grpc::Status(grpc::StatusCode::ABORTED, "Sift: No data available");
-            EmitterStateList statesToWorkOn;
-
-            if(!request->basis().empty())
+            if(!request.basis().empty())
             {
-                bool dataReady = false;
                 // wait for incoming data
                 /*lock scope*/
                 {
@@ -46,7 +40,7 @@ namespace cqp
                     dataReady = statesCv.wait_for(lock, receiveTimeout, [&]()
                     {
                         bool allFound = true;
-                        for(auto requested : request->basis())
+                        for(const auto& requested : request.basis())
                         {
                             if(collectedStates.find(requested.first) == collectedStates.end())
                             {
@@ -59,22 +53,34 @@ namespace cqp
 
                     if(dataReady)
                     {
-                        for(auto requested : request->basis())
+                        for(const auto& requested : request.basis())
                         {
-                            statesToWorkOn.emplace(requested.first,
-                                                   move(collectedStates.find(requested.first)->second));
-
+                            auto stateIt = collectedStates.find(requested.first);
+                            statesToWorkOn.emplace(requested.first, move(stateIt->second));
+                            // erase the item we're working on
+                            collectedStates.erase(stateIt);
                         } // for requested
-
-                        // erase the items we're working on
-                        for(auto requested : request->basis())
-                        {
-                            collectedStates.erase(requested.first);
-                        }
                     } // if dataReady
                 }/*lock scope*/
             } // if list !empty
 
+            return dataReady;
+        } // CollectStates
+
+        grpc::Status Verifier::VerifyBases(grpc::ServerContext*, const remote::BasisBySiftFrame* request,
+                                           remote::AnswersByFrame* response)
+        {
+            LOGTRACE("");
+            using std::chrono::high_resolution_clock;
+            using namespace std;
+            using google::protobuf::RepeatedField;
+            using grpc::Status;
+
+            Status result = grpc::Status(grpc::StatusCode::ABORTED, "Sift: No data available");
+            EmitterStateList statesToWorkOn;
+
+            CollectStates(*request, statesToWorkOn);
+
             for(auto& stateList : statesToWorkOn)
             {
                 high_resolution_clock::time_point timerStart = high_resolution_clock::now();
@@ -87,55 +93,161 @@ namespace cqp
                 // for each basis, compare to our basis, putting the answer in myAnswers
                 for(const auto& detected : theirList->second.indexedbasis())
                 {
-                    if(detected.index() < stateList.second->emissions.size())
+                    if(detected.index() < stateList.second.emissions.size())
                     {
-                        myBasesAnswers->Add(QubitHelper::Base(stateList.second->emissions[detected.index()]) ==
+                        myBasesAnswers->Add(stateList.second.emissions.BasisAt(detected.index()) ==
                                 Basis(detected.basis()));
                     } else {
                         LOGERROR("Invalid index: " + std::to_string(detected.index()));
                     }
                 }
 
-                if(!discardedIntensities.empty() && !stateList.second->intensities.empty())
+                if(!discardedIntensities.empty() && !stateList.second.intensities.empty())
                 {
                     RepeatedField<uint32_t>* myIntensityAnswers = (*response->mutable_answers())[theirList->first].mutable_intensity();
-                    myIntensityAnswers->Resize(stateList.second->intensities.size(),  0);
+                    myIntensityAnswers->Resize(stateList.second.intensities.size(),  0);
                     // copy the intensities into the answers
-                    copy(stateList.second->intensities.begin(), stateList.second->intensities.end(), myIntensityAnswers->begin());
+                    copy(stateList.second.intensities.begin(), stateList.second.intensities.end(), myIntensityAnswers->begin());
                 }
 
                 stats.comparisonTime.Update(high_resolution_clock::now() - timerStart);
 
             } // for statesToWorkOn
 
-            PublishStates(statesToWorkOn.begin(), statesToWorkOn.end(), *response);
+            /*lock scope*/
+            {
+                // the original interface is only used one request at a time so the ids are in order
+                std::lock_guard<std::mutex> lock(publishMutex);
+                PublishStates(statesToWorkOn.begin(), statesToWorkOn.end(), *response, siftedSequence++);
+            }/*lock scope*/
 
             return result;
         } // VerifyBases
 
+        grpc::Status Verifier::VerifyBasesCompact(grpc::ServerContext*, const remote::CompactBasesByFrame* request,
+                remote::CompactAnswersByFrame* response)
+        {
+            LOGTRACE("");
+            using std::chrono::high_resolution_clock;
+            using grpc::Status;
+
+            Status result = grpc::Status(grpc::StatusCode::ABORTED, "Sift: No data available");
+            EmitterStateList statesToWorkOn;
+
+            CollectStates(*request, statesToWorkOn);
+
+            for(auto& stateList : statesToWorkOn)
+            {
+                high_resolution_clock::time_point timerStart = high_resolution_clock::now();
+                result = grpc::Status::OK;
+
+                auto& myAnswers = (*response->mutable_answers())[stateList.first];
+                if(!CompareBases(request->basis().at(stateList.first), stateList.second.emissions, myAnswers))
+                {
+                    result = grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Sift: Invalid bases");
+                }
+
+                if(!discardedIntensities.empty() && !stateList.second.intensities.empty())
+                {
+                    // copy the intensities into the answers
+                    myAnswers.mutable_intensity()->assign(stateList.second.intensities.begin(), stateList.second.intensities.end());
+                }
+
+                stats.comparisonTime.Update(high_resolution_clock::now() - timerStart);
+            } // for statesToWorkOn
+
+            // failed requests still use up their id so that the ones after aren't held up
+            PublishInOrder(statesToWorkOn, *response, request->siftedframe(), result.ok());
+
+            return result;
+        } // VerifyBasesCompact
+
+        void Verifier::PublishInOrder(const EmitterStateList& states, const remote::CompactAnswersByFrame& answers,
+                                      SequenceNumber siftedId, bool valid)
+        {
+            /*lock scope*/
+            {
+                std::unique_lock<std::mutex> lock(publishMutex);
+                const bool ready = publishCv.wait_for(lock, publishTimeout, [&]()
+                {
+                    return siftedId <= siftedSequence;
+                });
+
+                if(!ready)
+                {
+                    LOGWARN("Sift: Request " + std::to_string(siftedSequence) + " never arrived, skipping to " +
+                            std::to_string(siftedId));
+                }
+
+                if(valid)
+                {
+                    PublishStates(states.begin(), states.end(), answers, siftedId);
+                }
+                siftedSequence = std::max(siftedSequence, siftedId + 1);
+            }/*lock scope*/
+
+            publishCv.notify_all();
+        } // PublishInOrder
+
+        bool Verifier::CompareBases(const remote::CompactBases& bases, const PackedQubits& emissions,
+                                    remote::CompactAnswers& answers)
+        {
+            bool result = true;
+            const size_t numDetections = static_cast<size_t>(bases.indexdelta().size());
+
+            if(bases.bases().size() * 4 < numDetections)
+            {
+                LOGERROR("Too few bases for the detections");
+                result = false;
+            }
+            else
+            {
+                std::string& answerBytes = *answers.mutable_answers();
+                answerBytes.assign((numDetections + 7) / 8, 0);
+                answers.set_numanswers(numDetections);
+
+                const std::string& basisBytes = bases.bases();
+                uint64_t index = 0;
+                for(size_t detection = 0; detection < numDetections; detection++)
+                {
+                    // unsigned arithmetic also undoes any negative steps
+                    index += bases.indexdelta(static_cast<int>(detection));
+                    const uint8_t basis = (static_cast<uint8_t>(basisBytes[detection / 4]) >> (2 * (detection % 4))) & 0x03u;
+
+                    if(index < emissions.size())
+                    {
+                        if(static_cast<uint8_t>(emissions.BasisAt(index)) >> 1 == basis)
+                        {
+                            answerBytes[detection / 8] = static_cast<char>(answerBytes[detection / 8] | (1u << (detection % 8)));
+                        }
+                    }
+                    else
+                    {
+                        // leave the answer as false so that the following answers still line up
+                        LOGERROR("Invalid index: " + std::to_string(index));
+                    }
+                }
+            }
+
+            return result;
+        } // CompareBases
+
+        template<typename Answers>
         void Verifier::PublishStates(EmitterStateList::const_iterator start, EmitterStateList::const_iterator end,
-                                     const remote::AnswersByFrame& answers)
+                                     const Answers& answers, SequenceNumber siftedId)
         {
             using std::chrono::high_resolution_clock;
             high_resolution_clock::time_point timerStart = high_resolution_clock::now();
 
-            std::unique_ptr<JaggedDataBlock> siftedData(new JaggedDataBlock());
-            JaggedDataBlock::value_type value = 0;
-            uint_least8_t offset = 0;
+            PackedBits sifted;
+            size_t siftedBits = 0;
 
             for(auto listIt = start; listIt != end; listIt++)
             {
-                // grow the storage enough to fit the next set of data
-                siftedData->reserve(siftedData->size() + listIt->second->emissions.size() / bitsPerValue);
-
                 auto answersIt = answers.answers().find(listIt->first);
                 if(answersIt != answers.answers().end())
                 {
-                    for(auto qubitIndex = 0u; qubitIndex < listIt->second->emissions.size(); qubitIndex++)
-                    {
-                        PackQubit(listIt->second->emissions[qubitIndex], qubitIndex, answersIt->second,
-                                  *siftedData, offset, value);
-                    }// for qubits
+                    SiftQubits(listIt->second.emissions, answersIt->second, sifted, siftedBits);
                 }
                 else
                 {
@@ -143,13 +255,7 @@ namespace cqp
                 }
             }
 
-            if(offset != 0)
-            {
-                // There weren't enough bits to completely fill the last word,
-                // Add the remaining, the mask will show which bits are valid
-                siftedData->push_back(value);
-                siftedData->bitsInLastByte = offset;
-            } // if(offset != 0)
+            std::unique_ptr<JaggedDataBlock> siftedData(new JaggedDataBlock(UnpackBits(sifted, siftedBits)));
 
             if(siftedData->empty())
             {
@@ -160,9 +266,7 @@ namespace cqp
 
             double securityParameter = 0.0; // TODO
             // publish the results on our side
-            Emit(&ISiftedCallback::OnSifted, siftedSequence, securityParameter, move(siftedData));
-
-            siftedSequence++;
+            Emit(&ISiftedCallback::OnSifted, siftedId, securityParameter, move(siftedData));
 
             stats.publishTime.Update(high_resolution_clock::now() - timerStart);
             stats.bytesProduced.Update(bytesProduced);
@@ -173,13 +277,18 @@ namespace cqp
             using namespace std;
             LOGTRACE("Received aligned qubits");
 
+            // keep the packed form, the report with a byte per qubit is freed
+            EmittedFrame frame;
+            frame.emissions = PackedQubits(report->emissions);
+            frame.intensities = move(report->intensities);
+
             // Lock scope
             {
                 std::lock_guard<std::mutex>  lock(statesMutex);
 
                 if(collectedStates.find(report->frame) == collectedStates.end())
                 {
-                    collectedStates[report->frame] = move(report);
+                    collectedStates.emplace(report->frame, move(frame));
                 } // if
                 else
                 {
@@ -192,16 +301,31 @@ namespace cqp
 
         void Verifier::Connect(std::shared_ptr<grpc::ChannelInterface>)
         {
-            std::lock_guard<std::mutex>  lock(statesMutex);
-            collectedStates.clear();
-            siftedSequence = 0;
+            /*lock scope*/
+            {
+                std::lock_guard<std::mutex>  lock(statesMutex);
+                collectedStates.clear();
+            }/*lock scope*/
+            /*lock scope*/
+            {
+                std::lock_guard<std::mutex>  lock(publishMutex);
+                siftedSequence = 0;
+            }/*lock scope*/
         }
 
         void Verifier::Disconnect()
         {
-            std::lock_guard<std::mutex>  lock(statesMutex);
-            collectedStates.clear();
-            siftedSequence = 0;
+            /*lock scope*/
+            {
+                std::lock_guard<std::mutex>  lock(statesMutex);
+                collectedStates.clear();
+            }/*lock scope*/
+            /*lock scope*/
+            {
+                std::lock_guard<std::mutex>  lock(publishMutex);
+                siftedSequence = 0;
+            }/*lock scope*/
+            publishCv.notify_all();
         }
 
     } // namespace Sift
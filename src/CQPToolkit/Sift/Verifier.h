@@ -12,6 +12,7 @@
 #pragma once
 #include "CQPToolkit/Sift/SiftBase.h"
 #include "QKDInterfaces/ISift.grpc.pb.h"
+#include "CQPToolkit/ICompactSift.grpc.pb.h"
 #include <CQPToolkit/Interfaces/IEmitterEventPublisher.h>
 
 namespace cqp
@@ -22,7 +23,7 @@ namespace cqp
         /// Accepts data inherently aligned data from the emitter and responds to requests from the
         /// Receiver to provide basis information and discard undetected qubits
         class CQPTOOLKIT_EXPORT Verifier : public virtual cqp::IEmitterEventCallback,
-            public SiftBase, public remote::ISift::Service
+            public SiftBase, public remote::ISift::Service, public remote::ICompactSift::Service
         {
         public:
 
@@ -52,6 +53,30 @@ namespace cqp
             grpc::Status VerifyBases(grpc::ServerContext* context, const remote::BasisBySiftFrame* request, remote::AnswersByFrame* response) override;
 
             ///@}
+
+            ///@{
+            /// @name remote::ICompactSift interface
+
+            /**
+             * @copydoc remote::ICompactSift::VerifyBasesCompact
+             * @param context Connection details from the server
+             * @return true on success
+             */
+            grpc::Status VerifyBasesCompact(grpc::ServerContext* context, const remote::CompactBasesByFrame* request,
+                                            remote::CompactAnswersByFrame* response) override;
+
+            ///@}
+
+            /**
+             * @brief CompareBases
+             * Compare the bases of detections against what was emitted
+             * @param bases The packed detections for one frame
+             * @param emissions The qubits which were sent for the frame
+             * @param[out] answers One bit per detection, set if the bases match
+             * @return false if bases is malformed
+             */
+            static bool CompareBases(const remote::CompactBases& bases, const PackedQubits& emissions,
+                                     remote::CompactAnswers& answers);
             /// @{
             /// @name IEmitterEventCallback interface
 
@@ -77,12 +102,60 @@ namespace cqp
 
         protected:
 
-            using EmitterStateList = std::map<SequenceNumber, std::unique_ptr<EmitterReport>>;
+            /// The emissions of one frame, kept until the receiver sends its bases
+            struct EmittedFrame
+            {
+                /// The qubits which were sent, packed to 3 bits per qubit
+                PackedQubits emissions;
+                /// The intensity levels
+                IntensityList intensities;
+            };
+
+            using EmitterStateList = std::map<SequenceNumber, EmittedFrame>;
+
+            /**
+             * @brief CollectStates
+             * Wait for all the frames in a request to arrive and take them from collectedStates
+             * @param request A request with a map of frames called basis
+             * @param[out] statesToWorkOn The frames for the request
+             * @return true if all the frames arrived in time
+             */
+            template<typename Request>
+            bool CollectStates(const Request& request, EmitterStateList& statesToWorkOn);
+
+            /**
+             * @brief PublishStates
+             * Sift the frames with the answers sent to the receiver and publish the result
+             * @param start The first frame
+             * @param end One past the last frame
+             * @param answers The answers in either format
+             * @param siftedId The id to publish the result with
+             */
+            template<typename Answers>
             void PublishStates(EmitterStateList::const_iterator start, EmitterStateList::const_iterator end,
-                               const remote::AnswersByFrame& answers);
+                               const Answers& answers, SequenceNumber siftedId);
+
+            /**
+             * @brief PublishInOrder
+             * Wait for the requests sent before this one to be published then publish this one.
+             * The receiver can have several requests in flight which are answered on different threads.
+             * @param states The frames in the request
+             * @param answers The answers sent to the receiver
+             * @param siftedId The id the receiver gave the request
+             * @param valid false if the request failed, the id is used up without publishing anything
+             */
+            void PublishInOrder(const EmitterStateList& states, const remote::CompactAnswersByFrame& answers,
+                                SequenceNumber siftedId, bool valid);
 
             /// How long to wait for incomming data
             std::chrono::milliseconds receiveTimeout {500};
+            /// How long to wait for an earlier request before giving up on it
+            std::chrono::milliseconds publishTimeout {2000};
+
+            /// held while publishing, protects siftedSequence which is the next id to publish
+            std::mutex publishMutex;
+            /// signalled when siftedSequence changes
+            std::condition_variable publishCv;
 
             /// a mutex for use with collectedStatesCv
             std::mutex statesMutex;
@@ -0,0 +1,203 @@
+/*!
+* @file
+* @brief DetectionReplay
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "DetectionReplay.h"
+#include "Algorithms/Logging/Logger.h"
+
+namespace cqp
+{
+    namespace sim
+    {
+        using std::chrono::high_resolution_clock;
+
+        DetectionReplay::DetectionReplay(const std::string& fileName, bool loop) :
+            loop{loop}
+        {
+            isOpen = reader.Open(fileName);
+            if(isOpen && reader.GetIndex().empty())
+            {
+                LOGWARN(fileName + " has no frames");
+            }
+        }
+
+        DetectionReplay::~DetectionReplay()
+        {
+            Stop();
+        }
+
+        grpc::Status DetectionReplay::StartDetecting(grpc::ServerContext*, const google::protobuf::Timestamp*, google::protobuf::Empty*)
+        {
+            std::lock_guard<std::mutex> lock(readerMutex);
+            epoc = high_resolution_clock::now();
+            return grpc::Status();
+        } // StartDetecting
+
+        grpc::Status DetectionReplay::StopDetecting(grpc::ServerContext*, const google::protobuf::Timestamp*, google::protobuf::Empty*)
+        {
+            grpc::Status result;
+            high_resolution_clock::time_point frameEpoc;
+            high_resolution_clock::time_point recordedEpoc;
+            {
+                /*lock scope*/
+                std::lock_guard<std::mutex> lock(readerMutex);
+                frameEpoc = epoc;
+            }/*lock scope*/
+
+            if(!EmitNext(frameEpoc, recordedEpoc))
+            {
+                result = grpc::Status(grpc::StatusCode::OUT_OF_RANGE, "No more recorded frames");
+            }
+            return result;
+        } // StopDetecting
+
+        bool DetectionReplay::PeekEpoc(high_resolution_clock::time_point& recordedEpoc, bool& restarted)
+        {
+            using namespace std::chrono;
+            std::lock_guard<std::mutex> lock(readerMutex);
+            const auto& index = reader.GetIndex();
+            restarted = false;
+            if(loop && nextBlock >= index.size())
+            {
+                nextBlock = 0;
+                restarted = true;
+            }
+
+            const bool result = nextBlock < index.size();
+            if(result)
+            {
+                recordedEpoc = high_resolution_clock::time_point(
+                                   duration_cast<high_resolution_clock::duration>(nanoseconds(index[nextBlock].epoc)));
+            }
+            return result;
+        } // PeekEpoc
+
+        bool DetectionReplay::EmitNext(high_resolution_clock::time_point frameEpoc, high_resolution_clock::time_point& recordedEpoc)
+        {
+            std::unique_ptr<ProtocolDetectionReport> report(new ProtocolDetectionReport);
+            bool result = false;
+            {
+                /*lock scope*/
+                std::lock_guard<std::mutex> lock(readerMutex);
+                if(loop && nextBlock >= reader.GetIndex().size())
+                {
+                    nextBlock = 0;
+                }
+                result = reader.ReadReport(nextBlock, *report);
+            }/*lock scope*/
+
+            if(result)
+            {
+                recordedEpoc = report->epoc;
+                report->epoc = frameEpoc;
+                stats.qubitsReceived.Update(report->detections.size());
+
+                Emit(&IDetectionEventCallback::OnPhotonReport, move(report));
+
+                stats.frameTime.Update(high_resolution_clock::now() - frameEpoc);
+            }
+            return result;
+        } // EmitNext
+
+        void DetectionReplay::Play(double speed)
+        {
+            Stop();
+            std::lock_guard<std::mutex> threadLock(threadMutex);
+            std::lock_guard<std::mutex> lock(playerMutex);
+            keepPlaying = true;
+            player = std::thread(&DetectionReplay::Player, this, speed);
+        } // Play
+
+        void DetectionReplay::JoinPlayer()
+        {
+            std::lock_guard<std::mutex> lock(threadMutex);
+            if(player.joinable())
+            {
+                player.join();
+            }
+        } // JoinPlayer
+
+        void DetectionReplay::Stop()
+        {
+            {
+                /*lock scope*/
+                std::lock_guard<std::mutex> lock(playerMutex);
+                keepPlaying = false;
+            }/*lock scope*/
+            playerCv.notify_all();
+
+            JoinPlayer();
+        } // Stop
+
+        void DetectionReplay::WaitForEnd()
+        {
+            std::unique_lock<std::mutex> lock(playerMutex);
+            playerCv.wait(lock, [&]()
+            {
+                return !keepPlaying;
+            });
+            lock.unlock();
+
+            JoinPlayer();
+        } // WaitForEnd
+
+        void DetectionReplay::Player(double speed)
+        {
+            using namespace std::chrono;
+            // the first frame is sent straight away
+            high_resolution_clock::time_point firstRecorded;
+            high_resolution_clock::time_point started = high_resolution_clock::now();
+            bool restarted = false;
+            bool more = PeekEpoc(firstRecorded, restarted);
+
+            while(more)
+            {
+                high_resolution_clock::time_point recordedEpoc;
+                more = PeekEpoc(recordedEpoc, restarted);
+                if(restarted)
+                {
+                    // the archive has looped, keep the recorded spacing from the first frame again
+                    firstRecorded = recordedEpoc;
+                    started = high_resolution_clock::now();
+                }
+
+                // keep the recorded spacing between frames, scaled by the speed
+                high_resolution_clock::time_point due = started;
+                if(speed > 0.0)
+                {
+                    due += duration_cast<high_resolution_clock::duration>((recordedEpoc - firstRecorded) / speed);
+                }
+
+                {
+                    /*lock scope*/
+                    std::unique_lock<std::mutex> lock(playerMutex);
+                    playerCv.wait_until(lock, due, [&]()
+                    {
+                        return !keepPlaying;
+                    });
+                    more = more && keepPlaying;
+                }/*lock scope*/
+
+                if(more)
+                {
+                    more = EmitNext(due, recordedEpoc);
+                }
+            } // while more
+
+            {
+                /*lock scope*/
+                std::lock_guard<std::mutex> lock(playerMutex);
+                keepPlaying = false;
+            }/*lock scope*/
+            playerCv.notify_all();
+        } // Player
+
+    } // namespace sim
+} // namespace cqp
@@ -0,0 +1,148 @@
+/*!
+* @file
+* @brief DetectionReplay
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#pragma once
+#include "CQPToolkit/Interfaces/IDetectionEventPublisher.h"
+#include "Algorithms/Util/Provider.h"
+#include "Algorithms/Util/DetectionArchive.h"
+#include "QKDInterfaces/IDetector.grpc.pb.h"
+#include "CQPToolkit/Statistics/Frames.h"
+#include <condition_variable>
+#include <thread>
+
+namespace cqp
+{
+    namespace sim
+    {
+        /**
+         * @brief The DetectionReplay class
+         * Provides a fake time tagger which sends the frames recorded in a detection archive.
+         * @details
+         * Frames can be sent one at a time with the IDetector interface, in the same way as a time tagger,
+         * or Play can be used to send all the frames with the recorded spacing, or faster.
+         * The epoc of each report is moved to the time it is sent.
+         * @see fs::DetectionArchiveWriter, UsbTagger::SetArchive
+         */
+        class CQPTOOLKIT_EXPORT DetectionReplay :
+            public remote::IDetector::Service,
+            public Provider<IDetectionEventCallback>
+        {
+        public:
+            /**
+             * @brief DetectionReplay
+             * Constructor
+             * @param fileName The archive to replay
+             * @param loop Start again from the first frame when the end is reached
+             */
+            explicit DetectionReplay(const std::string& fileName, bool loop = false);
+
+            /// Destructor
+            ~DetectionReplay() override;
+
+            /// @return true if the archive could be read
+            bool IsOpen() const
+            {
+                return isOpen;
+            }
+
+            ///@{
+            /// @name remote::IDetector interface
+
+            /// @copydoc remote::IDetector::StartDetecting
+            /// @param context Connection details from the server
+            grpc::Status StartDetecting(grpc::ServerContext* context, const google::protobuf::Timestamp* request, google::protobuf::Empty*) override;
+            /// @copydoc remote::IDetector::StopDetecting
+            /// @details Sends the next recorded frame
+            /// @param context Connection details from the server
+            grpc::Status StopDetecting(grpc::ServerContext* context, const google::protobuf::Timestamp* request, google::protobuf::Empty*) override;
+            ///@}
+
+            /**
+             * @brief Play
+             * Send the remaining frames from a background thread
+             * @param speed How many times faster than recorded to send the frames, 0 = as fast as possible
+             */
+            void Play(double speed = 1.0);
+
+            /**
+             * @brief Stop
+             * Stop sending frames started by Play
+             */
+            void Stop();
+
+            /**
+             * @brief WaitForEnd
+             * Wait for Play to send all the frames
+             */
+            void WaitForEnd();
+
+            /// Statistics produced by this class
+            stats::Frames stats;
+
+        protected: // methods
+            /**
+             * @brief EmitNext
+             * Read the next frame and send it
+             * @param epoc The epoc to give the frame
+             * @param[out] recordedEpoc The epoc the frame was recorded with
+             * @return false if there are no more frames
+             */
+            bool EmitNext(std::chrono::high_resolution_clock::time_point epoc,
+                          std::chrono::high_resolution_clock::time_point& recordedEpoc);
+
+            /**
+             * @brief PeekEpoc
+             * @param[out] recordedEpoc The recorded epoc of the next frame
+             * @param[out] restarted Set to true if the archive has looped back to the first frame
+             * @return false if there are no more frames
+             */
+            bool PeekEpoc(std::chrono::high_resolution_clock::time_point& recordedEpoc, bool& restarted);
+
+            /**
+             * @brief JoinPlayer
+             * Wait for the player thread to exit
+             */
+            void JoinPlayer();
+
+            /**
+             * @brief Player
+             * Sends frames until the end or Stop is called
+             * @param speed How many times faster than recorded to send the frames, 0 = as fast as possible
+             */
+            void Player(double speed);
+
+        protected: // members
+            /// The recorded frames
+            fs::DetectionArchiveReader reader;
+            /// whether the archive could be read
+            bool isOpen = false;
+            /// Start again when the end is reached
+            const bool loop;
+            /// The next block in the archive to read
+            size_t nextBlock = 0;
+            /// protects reader and nextBlock
+            std::mutex readerMutex;
+            /// The time StartDetecting was called
+            std::chrono::high_resolution_clock::time_point epoc;
+
+            /// whether the player should keep sending
+            bool keepPlaying = false;
+            /// protects keepPlaying
+            std::mutex playerMutex;
+            /// wakes the player when it's stopped
+            std::condition_variable playerCv;
+            /// sends frames for Play
+            std::thread player;
+            /// protects player from being started or joined by more than one thread
+            std::mutex threadMutex;
+        }; // class DetectionReplay
+    } // namespace sim
+} // namespace cqp
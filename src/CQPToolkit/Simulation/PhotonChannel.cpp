@@ -0,0 +1,447 @@
+/*!
+* @file
+* @brief PhotonChannel
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "PhotonChannel.h"
+#include "Algorithms/Datatypes/URI.h"
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+namespace cqp
+{
+    namespace sim
+    {
+
+        constexpr size_t PhotonChannel::ChunkSize;
+        constexpr const char* ChannelParameters::Names::loss;
+        constexpr const char* ChannelParameters::Names::darkCounts;
+        constexpr const char* ChannelParameters::Names::jitter;
+        constexpr const char* ChannelParameters::Names::drift;
+        constexpr const char* ChannelParameters::Names::offset;
+        constexpr const char* ChannelParameters::Names::qber;
+
+        /// M_PI isn't part of standard C++
+        constexpr double pi = 3.14159265358979323846;
+
+        /// Separates the random numbers used for different purposes
+        enum class Stream : uint32_t
+        {
+            Emissions = 1,
+            Channel = 2
+        };
+
+        /**
+         * @brief The Sampler class
+         * Draws from the distributions needed by the channel.
+         * The distributions are calculated here rather than with the standard library
+         * so that the results are the same with every compiler.
+         */
+        class Sampler
+        {
+        public:
+            /**
+             * @brief Sampler
+             * Constructor
+             * @param seed The users seed
+             * @param stream What the numbers are for
+             * @param frame The frame being sent
+             * @param firstSlot The first emission the numbers are for
+             */
+            Sampler(uint64_t seed, Stream stream, SequenceNumber frame, uint64_t firstSlot)
+            {
+                std::seed_seq sequence
+                {
+                    static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32),
+                    static_cast<uint32_t>(stream),
+                    static_cast<uint32_t>(frame), static_cast<uint32_t>(frame >> 32),
+                    static_cast<uint32_t>(firstSlot), static_cast<uint32_t>(firstSlot >> 32)
+                };
+                engine.seed(sequence);
+            }
+
+            /// @return 64 random bits
+            uint64_t Bits()
+            {
+                return engine();
+            }
+
+            /// @return A value in the range (0, 1]
+            double Uniform()
+            {
+                return static_cast<double>((engine() >> 11) + 1) * (1.0 / 9007199254740992.0);
+            }
+
+            /**
+             * @brief Geometric
+             * @param logMiss log(1 - p) for the probability p of success
+             * @param limit Values above this are returned as limit
+             * @return The number of failures before the first success
+             */
+            uint64_t Geometric(double logMiss, uint64_t limit)
+            {
+                const double failures = std::floor(std::log(Uniform()) / logMiss);
+                return failures < static_cast<double>(limit) ? static_cast<uint64_t>(failures) : limit;
+            }
+
+            /**
+             * @brief Exponential
+             * @param rate The rate of events
+             * @return The time to the next event
+             */
+            double Exponential(double rate)
+            {
+                return -std::log(Uniform()) / rate;
+            }
+
+            /// @return A value from the standard normal distribution
+            double Normal()
+            {
+                double result = spare;
+                if(hasSpare)
+                {
+                    hasSpare = false;
+                }
+                else
+                {
+                    // Box-Muller produces two values at a time
+                    const double radius = std::sqrt(-2.0 * std::log(Uniform()));
+                    const double angle = 2.0 * pi * Uniform();
+                    result = radius * std::cos(angle);
+                    spare = radius * std::sin(angle);
+                    hasSpare = true;
+                }
+                return result;
+            }
+
+        protected:
+            /// The source of random bits
+            std::mt19937_64 engine;
+            /// The second value from the last Box-Muller transform
+            double spare = 0.0;
+            /// Whether spare is waiting to be used
+            bool hasSpare = false;
+        };
+
+        /**
+         * @brief ForEachChunk
+         * Split a burst into chunks of ChunkSize and process them in parallel
+         * @tparam Action Callable taking the chunk number, the first index and the number of items
+         * @param count The number of items
+         * @param action Processes one chunk
+         */
+        template<typename Action>
+        static void ForEachChunk(size_t count, Action action)
+        {
+            using namespace std;
+            const size_t numChunks = (count + PhotonChannel::ChunkSize - 1) / PhotonChannel::ChunkSize;
+            const size_t numThreads = max<size_t>(1, min<size_t>(thread::hardware_concurrency(), numChunks));
+
+            auto worker = [&](size_t firstChunk)
+            {
+                for(auto chunk = firstChunk; chunk < numChunks; chunk += numThreads)
+                {
+                    const auto first = chunk * PhotonChannel::ChunkSize;
+                    action(chunk, first, min(PhotonChannel::ChunkSize, count - first));
+                }
+            };
+
+            vector<future<void>> tasks;
+            for(auto thread = 1u; thread < numThreads; thread++)
+            {
+                tasks.emplace_back(async(launch::async, worker, thread));
+            }
+            worker(0);
+            for(auto& task : tasks)
+            {
+                task.wait();
+            }
+        } // ForEachChunk
+
+        /**
+         * @brief ProbabilityOfDetection
+         * @param parameters The channel
+         * @return The probability of at least one photon from an emission being detected
+         */
+        static double ProbabilityOfDetection(const ChannelParameters& parameters)
+        {
+            const double transmission = std::pow(10.0, -parameters.lossDb / 10.0) * parameters.detectorEfficiency;
+            return std::min(1.0, std::max(0.0, 1.0 - std::exp(-parameters.meanPhotonNumber * transmission)));
+        }
+
+        /**
+         * @brief ParseNumber
+         * @param name The parameter being parsed, for the error message
+         * @param value The text to parse
+         * @param minimum The smallest value allowed
+         * @param maximum The largest value allowed
+         * @return The value
+         */
+        static double ParseNumber(const std::string& name, const std::string& value,
+                                  double minimum = std::numeric_limits<double>::lowest(),
+                                  double maximum = std::numeric_limits<double>::max())
+        {
+            const double result = std::stod(value);
+            if(!(result >= minimum && result <= maximum))
+            {
+                throw std::out_of_range("Channel parameter " + name + " is out of range: " + value);
+            }
+            return result;
+        } // ParseNumber
+
+        /**
+         * @brief NumberToString
+         * @param value A number
+         * @return The number with enough digits to be parsed back to the same value
+         */
+        static std::string NumberToString(double value)
+        {
+            std::ostringstream result;
+            result.precision(std::numeric_limits<double>::max_digits10);
+            result << value;
+            return result.str();
+        } // NumberToString
+
+        bool ChannelParameters::SetParameter(const std::string& name, const std::string& value)
+        {
+            bool result = true;
+            if(name == Names::loss)
+            {
+                lossDb = ParseNumber(name, value);
+            }
+            else if(name == Names::darkCounts)
+            {
+                darkCountRate = ParseNumber(name, value, 0.0);
+            }
+            else if(name == Names::jitter)
+            {
+                jitter = PicoSeconds(static_cast<PicoSeconds::rep>(std::llround(ParseNumber(name, value, 0.0))));
+            }
+            else if(name == Names::drift)
+            {
+                drift = ParseNumber(name, value, -1.0, 1.0);
+            }
+            else if(name == Names::offset)
+            {
+                offset = PicoSecondOffset(static_cast<PicoSecondOffset::rep>(std::llround(ParseNumber(name, value))));
+            }
+            else if(name == Names::qber)
+            {
+                qber = ParseNumber(name, value, 0.0, 1.0);
+            }
+            else
+            {
+                result = false;
+            }
+            return result;
+        } // SetParameter
+
+        void ChannelParameters::ToURI(URI& uri) const
+        {
+            uri.SetParameter(Names::loss, NumberToString(lossDb));
+            uri.SetParameter(Names::darkCounts, NumberToString(darkCountRate));
+            uri.SetParameter(Names::jitter, std::to_string(jitter.count()));
+            uri.SetParameter(Names::drift, NumberToString(drift));
+            uri.SetParameter(Names::offset, std::to_string(offset.count()));
+            uri.SetParameter(Names::qber, NumberToString(qber));
+        } // ToURI
+
+        PhotonChannel::PhotonChannel(const ChannelParameters& parameters, uint64_t seed) :
+            parameters{parameters}, seed{seed},
+            detectionProbability{ProbabilityOfDetection(parameters)}
+        {
+        }
+
+        std::shared_ptr<PhotonChannel> PhotonChannel::Shared(const std::string& name, const ChannelParameters& parameters)
+        {
+            static std::mutex sharedMutex;
+            static std::unordered_map<std::string, std::weak_ptr<PhotonChannel>> channels;
+
+            std::lock_guard<std::mutex> lock(sharedMutex);
+            auto result = channels[name].lock();
+            if(!result)
+            {
+                // FNV-1a so that the seed is the same with every compiler
+                uint64_t seed = 14695981039346656037ull;
+                for(const auto letter : name)
+                {
+                    seed = (seed ^ static_cast<unsigned char>(letter)) * 1099511628211ull;
+                }
+                result = std::make_shared<PhotonChannel>(parameters, seed);
+                channels[name] = result;
+            }
+
+            return result;
+        } // Shared
+
+        double PhotonChannel::DetectionProbability() const
+        {
+            return detectionProbability;
+        }
+
+        void PhotonChannel::Emissions(uint64_t seed, SequenceNumber frame, uint64_t firstSlot, size_t count,
+                                      QubitList& emissions)
+        {
+            emissions.resize(count);
+            ForEachChunk(count, [&](size_t, size_t first, size_t chunkCount)
+            {
+                Sampler rng(seed, Stream::Emissions, frame, firstSlot + first);
+                Qubit* output = &emissions[first];
+                uint64_t bits = 0;
+                for(size_t index = 0; index < chunkCount; index++)
+                {
+                    // each value uses 2 bits
+                    if(index % 32 == 0)
+                    {
+                        bits = rng.Bits();
+                    }
+                    output[index] = static_cast<Qubit>(bits & 0b11);
+                    bits >>= 2;
+                }
+            });
+        } // Emissions
+
+        void PhotonChannel::PropagateChunk(SequenceNumber frame, uint64_t firstSlot, const Qubit* emissions, size_t count,
+                                           DetectionReportList& detections) const
+        {
+            Sampler rng(seed, Stream::Channel, frame, firstSlot);
+            const double period = static_cast<double>(parameters.period.count());
+            const double clockRate = 1.0 + parameters.drift;
+            const double offset = static_cast<double>(parameters.offset.count());
+            const double jitter = static_cast<double>(parameters.jitter.count());
+
+            // convert a time on the transmitters clock to the detectors clock
+            auto addDetection = [&](double emitted, Qubit value)
+            {
+                double time = emitted * clockRate + offset;
+                if(jitter > 0.0)
+                {
+                    time += jitter * rng.Normal();
+                }
+                if(time >= 0.0)
+                {
+                    detections.push_back({PicoSeconds(static_cast<PicoSeconds::rep>(std::llround(time))), value});
+                }
+            };
+
+            detections.reserve(static_cast<size_t>(count * detectionProbability * 1.1) + 16);
+
+            if(detectionProbability > 0.0)
+            {
+                // skip straight to the next detected emission rather than testing each one
+                const double logMiss = std::log1p(-detectionProbability);
+                const uint64_t limit = count;
+                uint64_t index = detectionProbability < 1.0 ? rng.Geometric(logMiss, limit) : 0;
+                while(index < count)
+                {
+                    Qubit value = emissions[index];
+                    if(parameters.randomBasis && (rng.Bits() & 1))
+                    {
+                        // measured in the other basis, the result is random
+                        value = static_cast<Qubit>(((value ^ 0b10) & 0b10) | (rng.Bits() & 1));
+                    }
+                    else if(rng.Uniform() <= parameters.qber)
+                    {
+                        value ^= 1;
+                    }
+
+                    addDetection(static_cast<double>(firstSlot + index) * period, value);
+                    index += 1 + (detectionProbability < 1.0 ? rng.Geometric(logMiss, limit) : 0);
+                }
+            }
+
+            if(parameters.darkCountRate > 0.0)
+            {
+                // dark counts arrive at random over the time taken to send the chunk
+                const double ratePerPicoSecond = parameters.darkCountRate * 1.0e-12;
+                const double chunkEnd = static_cast<double>(firstSlot + count) * period;
+                double time = static_cast<double>(firstSlot) * period + rng.Exponential(ratePerPicoSecond);
+                while(time < chunkEnd)
+                {
+                    addDetection(time, static_cast<Qubit>(rng.Bits() & 0b11));
+                    time += rng.Exponential(ratePerPicoSecond);
+                }
+            }
+
+            // jitter and dark counts put the detections out of order
+            std::stable_sort(detections.begin(), detections.end(), [](const DetectionReport& left, const DetectionReport& right)
+            {
+                return left.time < right.time;
+            });
+        } // PropagateChunk
+
+        void PhotonChannel::Propagate(SequenceNumber frame, uint64_t firstSlot, const QubitList& emissions,
+                                      DetectionReportList& detections) const
+        {
+            using namespace std;
+            const size_t numChunks = (emissions.size() + ChunkSize - 1) / ChunkSize;
+            vector<DetectionReportList> chunkDetections(numChunks);
+
+            ForEachChunk(emissions.size(), [&](size_t chunk, size_t first, size_t count)
+            {
+                PropagateChunk(frame, firstSlot + first, &emissions[first], count, chunkDetections[chunk]);
+            });
+
+            size_t total = detections.size();
+            for(const auto& chunk : chunkDetections)
+            {
+                total += chunk.size();
+            }
+            detections.reserve(total);
+            for(const auto& chunk : chunkDetections)
+            {
+                detections.insert(detections.end(), chunk.begin(), chunk.end());
+            }
+        } // Propagate
+
+        void PhotonChannel::Transmit(SequenceNumber frame, uint64_t firstSlot, const QubitList& emissions)
+        {
+            DetectionReportList detections;
+            Propagate(frame, firstSlot, emissions, detections);
+
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            if(pending.empty())
+            {
+                pending = std::move(detections);
+            }
+            else
+            {
+                pending.insert(pending.end(), detections.begin(), detections.end());
+            }
+        } // Transmit
+
+        void PhotonChannel::Collect(DetectionReportList& detections)
+        {
+            /*lock scope*/
+            {
+                std::lock_guard<std::mutex> lock(pendingMutex);
+                detections.clear();
+                detections.swap(pending);
+            } /*lock scope*/
+
+            // detections near the edge of a chunk may have been moved past each other
+            auto byTime = [](const DetectionReport& left, const DetectionReport& right)
+            {
+                return left.time < right.time;
+            };
+            if(!std::is_sorted(detections.begin(), detections.end(), byTime))
+            {
+                std::stable_sort(detections.begin(), detections.end(), byTime);
+            }
+        } // Collect
+
+    } // namespace sim
+} // namespace cqp
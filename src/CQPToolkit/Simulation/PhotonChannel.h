@@ -0,0 +1,200 @@
+/*!
+* @file
+* @brief PhotonChannel
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#pragma once
+#include "CQPToolkit/cqptoolkit_export.h"
+#include "Algorithms/Datatypes/DetectionReport.h"
+#include "Algorithms/Util/Strings.h"
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace cqp
+{
+    class URI;
+
+    namespace sim
+    {
+        /**
+         * @brief The ChannelParameters struct
+         * Describes the link between a simulated transmitter and detector
+         */
+        struct CQPTOOLKIT_EXPORT ChannelParameters
+        {
+            /// Time between emissions
+            PicoSeconds period {std::chrono::nanoseconds(10)};
+            /// The average number of photons in each emission
+            double meanPhotonNumber = 0.5;
+            /// Loss between the transmitter and the detector in dB
+            double lossDb = 10.0;
+            /// The probability (0 - 1) of a photon which reaches the detector being detected
+            double detectorEfficiency = 0.2;
+            /// The rate of detections with no photon, in counts per second, across all detectors
+            double darkCountRate = 1000.0;
+            /// The standard deviation of the error in each detection time
+            PicoSeconds jitter {50};
+            /// How fast the detector clock runs compared to the transmitter in seconds per second
+            double drift = 0.0;
+            /// Added to every detection time, detections which end up before 0 are lost
+            PicoSecondOffset offset {0};
+            /// The probability (0 - 1) of a detection in the emitted basis having the wrong value
+            double qber = 0.02;
+            /// The detector picks a basis at random, otherwise the emitted basis is always measured
+            bool randomBasis = true;
+
+            /// The names of the values when they are part of a device address
+            struct Names
+            {
+                /// The name of the loss parameter, in dB
+                static CONSTSTRING loss = "loss";
+                /// The name of the dark count parameter, in counts per second
+                static CONSTSTRING darkCounts = "darkCounts";
+                /// The name of the jitter parameter, in picoseconds
+                static CONSTSTRING jitter = "jitter";
+                /// The name of the drift parameter, in seconds per second
+                static CONSTSTRING drift = "drift";
+                /// The name of the offset parameter, in picoseconds
+                static CONSTSTRING offset = "offset";
+                /// The name of the qber parameter, from 0 to 1
+                static CONSTSTRING qber = "qber";
+            };
+
+            /**
+             * @brief SetParameter
+             * Change a value using its name from a device address
+             * @param name One of the Names
+             * @param value The new value
+             * @return false if name is not a channel parameter
+             * @throws std::invalid_argument if the value cannot be parsed
+             * @throws std::out_of_range if the value is not allowed
+             */
+            bool SetParameter(const std::string& name, const std::string& value);
+
+            /**
+             * @brief ToURI
+             * Store the values which can be set with SetParameter
+             * @param[in,out] uri The address to add the parameters to
+             */
+            void ToURI(URI& uri) const;
+        };
+
+        /**
+         * @brief The PhotonChannel class
+         * Models the path from a transmitter to a detector in process, without any network calls or delays.
+         * @details
+         * Emissions are turned into detections by applying loss, detector efficiency, basis choice,
+         * errors, dark counts, jitter, drift and offset.
+         * The output is determined by the seed, the frame and the position of the emissions in the frame,
+         * so a run can be repeated exactly. Large bursts are split into fixed size chunks which are
+         * processed in parallel, the chunks do not depend on the number of threads.
+         * @see SimulatedTransmitter, SimulatedTimeTagger
+         */
+        class CQPTOOLKIT_EXPORT PhotonChannel
+        {
+        public:
+            /// The number of emissions processed together with one random sequence
+            static constexpr size_t ChunkSize = 1u << 20;
+
+            /**
+             * @brief PhotonChannel
+             * Constructor
+             * @param parameters How the channel behaves
+             * @param seed Determines the random choices made by the channel
+             */
+            explicit PhotonChannel(const ChannelParameters& parameters = {}, uint64_t seed = 0);
+
+            /**
+             * @brief Shared
+             * Get a channel which can be found by name from anywhere in the process,
+             * used to link a SimulatedTransmitter and a SimulatedTimeTagger which are created separately.
+             * The channel has a seed based on the name. It lasts while it's in use.
+             * @param name Identifies the channel
+             * @param parameters How the channel behaves if it is created by this call,
+             * an existing channel keeps the parameters it was created with
+             * @return The channel with that name, created if needed
+             */
+            static std::shared_ptr<PhotonChannel> Shared(const std::string& name, const ChannelParameters& parameters = {});
+
+            /// @return How the channel behaves
+            const ChannelParameters& GetParameters() const
+            {
+                return parameters;
+            }
+
+            /// @return The probability of an emission being detected
+            double DetectionProbability() const;
+
+            /**
+             * @brief Emissions
+             * Generate random qubits for a transmitter
+             * @param seed Determines the values
+             * @param frame The frame being sent
+             * @param firstSlot The position of the first emission in the frame
+             * @param count The number of emissions
+             * @param[out] emissions The qubits, it will be resized to count
+             */
+            static void Emissions(uint64_t seed, SequenceNumber frame, uint64_t firstSlot, size_t count,
+                                  QubitList& emissions);
+
+            /**
+             * @brief Propagate
+             * Produce the detections for some emissions
+             * @param frame The frame being sent
+             * @param firstSlot The position of the first emission in the frame
+             * @param emissions The emitted qubits
+             * @param[out] detections The detections will be appended to this, in time order within each chunk
+             */
+            void Propagate(SequenceNumber frame, uint64_t firstSlot, const QubitList& emissions,
+                           DetectionReportList& detections) const;
+
+            /**
+             * @brief Transmit
+             * Propagate the emissions and hold the detections until they are collected
+             * @param frame The frame being sent
+             * @param firstSlot The position of the first emission in the frame
+             * @param emissions The emitted qubits
+             */
+            void Transmit(SequenceNumber frame, uint64_t firstSlot, const QubitList& emissions);
+
+            /**
+             * @brief Collect
+             * Take the detections which have been transmitted
+             * @param[out] detections The detections in time order
+             */
+            void Collect(DetectionReportList& detections);
+
+        protected: // methods
+            /**
+             * @brief PropagateChunk
+             * Produce the detections for one chunk of emissions
+             * @param frame The frame being sent
+             * @param firstSlot The position of the first emission of the chunk in the frame
+             * @param emissions The first emission of the chunk
+             * @param count The number of emissions in the chunk
+             * @param[out] detections The detections in time order
+             */
+            void PropagateChunk(SequenceNumber frame, uint64_t firstSlot, const Qubit* emissions, size_t count,
+                                DetectionReportList& detections) const;
+
+        protected: // members
+            /// How the channel behaves
+            const ChannelParameters parameters;
+            /// Determines the random choices made by the channel
+            const uint64_t seed;
+            /// The probability of an emission being detected
+            const double detectionProbability;
+            /// Detections waiting to be collected
+            DetectionReportList pending;
+            /// protects pending
+            std::mutex pendingMutex;
+        }; // class PhotonChannel
+    } // namespace sim
+} // namespace cqp
@@ -0,0 +1,56 @@
+/*!
+* @file
+* @brief SimulatedTimeTagger
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "SimulatedTimeTagger.h"
+
+namespace cqp
+{
+    namespace sim
+    {
+        using std::chrono::high_resolution_clock;
+
+        SimulatedTimeTagger::SimulatedTimeTagger(std::shared_ptr<PhotonChannel> channel) :
+            channel{std::move(channel)}
+        {
+        }
+
+        grpc::Status SimulatedTimeTagger::StartDetecting(grpc::ServerContext*, const google::protobuf::Timestamp*, google::protobuf::Empty*)
+        {
+            std::lock_guard<std::mutex> lock(frameMutex);
+            epoc = high_resolution_clock::now();
+            return grpc::Status();
+        } // StartDetecting
+
+        grpc::Status SimulatedTimeTagger::StopDetecting(grpc::ServerContext*, const google::protobuf::Timestamp*, google::protobuf::Empty*)
+        {
+            std::unique_ptr<ProtocolDetectionReport> report(new ProtocolDetectionReport);
+
+            {
+                /*lock scope*/
+                std::lock_guard<std::mutex> lock(frameMutex);
+                report->epoc = epoc;
+                report->frame = frame;
+                frame++;
+            }/*lock scope*/
+
+            channel->Collect(report->detections);
+
+            const auto frameStart = report->epoc;
+            stats.qubitsReceived.Update(report->detections.size());
+
+            Emit(&IDetectionEventCallback::OnPhotonReport, move(report));
+
+            stats.frameTime.Update(high_resolution_clock::now() - frameStart);
+            return grpc::Status();
+        } // StopDetecting
+
+    } // namespace sim
+} // namespace cqp
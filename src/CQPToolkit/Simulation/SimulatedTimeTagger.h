@@ -0,0 +1,66 @@
+/*!
+* @file
+* @brief SimulatedTimeTagger
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#pragma once
+#include "CQPToolkit/Interfaces/IDetectionEventPublisher.h"
+#include "Algorithms/Util/Provider.h"
+#include "QKDInterfaces/IDetector.grpc.pb.h"
+#include "CQPToolkit/Simulation/PhotonChannel.h"
+#include "CQPToolkit/Statistics/Frames.h"
+
+namespace cqp
+{
+    namespace sim
+    {
+        /**
+         * @brief The SimulatedTimeTagger class
+         * Provides a fake time tagger which detects the photons sent by a SimulatedTransmitter
+         * through a PhotonChannel in the same process.
+         * @details The detections produced between StartDetecting and StopDetecting are sent as one frame.
+         */
+        class CQPTOOLKIT_EXPORT SimulatedTimeTagger :
+            public remote::IDetector::Service,
+            public Provider<IDetectionEventCallback>
+        {
+        public:
+            /**
+             * @brief SimulatedTimeTagger
+             * Constructor
+             * @param channel Where the photons arrive from, shared with the SimulatedTransmitter
+             */
+            explicit SimulatedTimeTagger(std::shared_ptr<PhotonChannel> channel);
+
+            ///@{
+            /// @name remote::IDetector interface
+
+            /// @copydoc remote::IDetector::StartDetecting
+            /// @param context Connection details from the server
+            grpc::Status StartDetecting(grpc::ServerContext* context, const google::protobuf::Timestamp* request, google::protobuf::Empty*) override;
+            /// @copydoc remote::IDetector::StopDetecting
+            /// @param context Connection details from the server
+            grpc::Status StopDetecting(grpc::ServerContext* context, const google::protobuf::Timestamp* request, google::protobuf::Empty*) override;
+            ///@}
+
+            /// Statistics produced by this class
+            stats::Frames stats;
+
+        protected:
+            /// Where the photons arrive from
+            std::shared_ptr<PhotonChannel> channel;
+            /// protects epoc and frame
+            std::mutex frameMutex;
+            /// The point at which the frame was started
+            std::chrono::high_resolution_clock::time_point epoc;
+            /// current frame number
+            SequenceNumber frame = 1;
+        }; // class SimulatedTimeTagger
+    } // namespace sim
+} // namespace cqp
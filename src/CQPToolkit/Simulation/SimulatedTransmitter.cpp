@@ -0,0 +1,63 @@
+/*!
+* @file
+* @brief SimulatedTransmitter
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "SimulatedTransmitter.h"
+
+namespace cqp
+{
+    namespace sim
+    {
+        using std::chrono::high_resolution_clock;
+
+        SimulatedTransmitter::SimulatedTransmitter(std::shared_ptr<PhotonChannel> channel, uint64_t seed,
+                size_t photonsPerBurst) :
+            channel{std::move(channel)}, seed{seed}, photonsPerBurst{photonsPerBurst}
+        {
+        }
+
+        bool SimulatedTransmitter::Fire()
+        {
+            const auto timerStart = high_resolution_clock::now();
+
+            std::unique_ptr<EmitterReport> report(new EmitterReport);
+            report->epoc = epoc;
+            report->frame = frame;
+            report->period = channel->GetParameters().period;
+
+            PhotonChannel::Emissions(seed, frame, nextSlot, photonsPerBurst, report->emissions);
+            channel->Transmit(frame, nextSlot, report->emissions);
+            nextSlot += report->emissions.size();
+
+            // tell the listeners what we sent.
+            const auto qubitsTransmitted = report->emissions.size();
+
+            Emit(&IEmitterEventCallback::OnEmitterReport, move(report));
+
+            stats.timeTaken.Update(high_resolution_clock::now() - timerStart);
+            stats.qubitsTransmitted.Update(qubitsTransmitted);
+
+            return true;
+        } // Fire
+
+        void SimulatedTransmitter::StartFrame()
+        {
+            epoc = high_resolution_clock::now();
+            nextSlot = 0;
+        } // StartFrame
+
+        void SimulatedTransmitter::EndFrame()
+        {
+            stats.frameTime.Update(high_resolution_clock::now() - epoc);
+            frame++;
+        } // EndFrame
+
+    } // namespace sim
+} // namespace cqp
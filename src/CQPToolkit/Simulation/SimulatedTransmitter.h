@@ -0,0 +1,80 @@
+/*!
+* @file
+* @brief SimulatedTransmitter
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#pragma once
+#include "Algorithms/Util/Provider.h"
+#include "CQPToolkit/Interfaces/IPhotonGenerator.h"
+#include "CQPToolkit/Interfaces/IEmitterEventPublisher.h"
+#include "CQPToolkit/Simulation/PhotonChannel.h"
+#include "CQPToolkit/Statistics/Frames.h"
+
+namespace cqp
+{
+    namespace sim
+    {
+
+        /**
+         * @brief The SimulatedTransmitter class
+         * Provides a fake transmitter which sends its qubits through a PhotonChannel
+         * to a SimulatedTimeTagger in the same process.
+         * @details
+         * Unlike DummyTransmitter, there are no network calls and no delay between bursts, whole frames
+         * are generated as fast as possible. The qubits are determined by the seed, frame and burst sizes.
+         */
+        class CQPTOOLKIT_EXPORT SimulatedTransmitter : public virtual IPhotonGenerator,
+        // publish the details of the photons generated
+            public Provider<IEmitterEventCallback>
+        {
+        public:
+            /// Statistics produced by this class
+            stats::Frames stats;
+
+            /**
+             * @brief SimulatedTransmitter
+             * Constructor
+             * @param channel Where to send the photons, shared with the SimulatedTimeTagger
+             * @param seed Determines the qubits sent
+             * @param photonsPerBurst How many photons to send each time Fire() is called
+             */
+            SimulatedTransmitter(std::shared_ptr<PhotonChannel> channel, uint64_t seed = 0,
+                                 size_t photonsPerBurst = 1000000);
+
+            ///@{
+            /// @name IPhotonGenerator Interface
+
+            /// @copydoc IPhotonGenerator::Fire
+            bool Fire() override;
+
+            /// @copydoc IPhotonGenerator::StartFrame
+            void StartFrame() override;
+
+            /// @copydoc IPhotonGenerator::EndFrame
+            void EndFrame() override;
+
+            ///@}
+
+        protected:
+            /// Where to send the photons
+            std::shared_ptr<PhotonChannel> channel;
+            /// Determines the qubits sent
+            const uint64_t seed;
+            /// how many photons to send in one go
+            const size_t photonsPerBurst;
+            /// The point at which the frame was started
+            std::chrono::high_resolution_clock::time_point epoc;
+            /// current frame number
+            SequenceNumber frame = 1;
+            /// The position in the frame of the next emission
+            uint64_t nextSlot = 0;
+        }; // SimulatedTransmitter
+
+    } // namespace sim
+} // namespace cqp
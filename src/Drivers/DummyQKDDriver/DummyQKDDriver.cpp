@@ -78,7 +78,8 @@ int DummyQKDDriver::Main(const std::vector<std::string>& args)
             config.mutable_controlparams()->mutable_config()->set_side(remote::Side_Type::Side_Type_Bob);
         }
 
-        device = make_shared<DummyQKD>(config.controlparams().config(), channelCreds);
+        device = make_shared<DummyQKD>(config.controlparams().config(), channelCreds, config.errorcorrection(),
+                                       config.siftwindow());
         adaptor = make_unique<RemoteQKDDevice>(device, serverCreds);
 
         // get the real settings which have been corrected by the device driuver
@@ -26,6 +26,7 @@ struct FreespaceBobDriver::FreespaceNames
 {
     static CONSTSTRING device = "device";
     static CONSTSTRING usbDevice = "usb-device";
+    static CONSTSTRING archive = "archive";
     static CONSTSTRING writeConfig = "write-config";
 };
 
@@ -44,6 +45,8 @@ FreespaceBobDriver::FreespaceBobDriver() :
     .Bind();
     definedArguments.AddOption(FreespaceNames::usbDevice, "u", "The serial number for the usb device to use, otherwise use the first detected")
     .Bind();
+    definedArguments.AddOption(FreespaceNames::archive, "a", "Record the detections to this file so that they can be replayed")
+    .Bind();
     definedArguments.AddOption(FreespaceNames::writeConfig, "", "Output the resulting config to a file")
     .Bind();
 
@@ -69,6 +72,7 @@ int FreespaceBobDriver::Main(const std::vector<std::string>& args)
     {
         definedArguments.GetProp(FreespaceNames::device, *config.mutable_devicename());
         definedArguments.GetProp(FreespaceNames::usbDevice, *config.mutable_usbdevicename());
+        definedArguments.GetProp(FreespaceNames::archive, *config.mutable_detectionarchive());
 
         // any changes to config need to be applied by now
         if(definedArguments.HasProp(FreespaceNames::writeConfig))
@@ -77,7 +81,11 @@ int FreespaceBobDriver::Main(const std::vector<std::string>& args)
             WriteConfigFile(config, definedArguments.GetStringProp(FreespaceNames::writeConfig));
         } // if write config file
 
-        device = make_shared<PhotonDetectorMk1>(channelCreds, config.devicename(), config.usbdevicename());
+        device = make_shared<PhotonDetectorMk1>(channelCreds, config.devicename(), config.usbdevicename(), config.errorcorrection());
+        if(!config.detectionarchive().empty() && !device->SetArchive(config.detectionarchive()))
+        {
+            LOGERROR("Failed to create detection archive: " + config.detectionarchive());
+        }
         adaptor = make_unique<RemoteQKDDevice>(device, serverCreds);
 
         // get the real settings which have been corrected by the device driuver
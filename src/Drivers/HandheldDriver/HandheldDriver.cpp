@@ -80,7 +80,7 @@ int HandheldDriver::Main(const std::vector<std::string>& args)
             WriteConfigFile(config, definedArguments.GetStringProp(HandheldNames::writeConfig));
         } // if write config file
 
-        device = make_shared<LEDAliceMk1>(channelCreds, config.devicename(), config.usbdevicename());
+        device = make_shared<LEDAliceMk1>(channelCreds, config.devicename(), config.usbdevicename(), config.errorcorrection());
         adaptor = make_unique<RemoteQKDDevice>(device, serverCreds);
 
         // get the real settings which have been corrected by the device driuver
@@ -2,6 +2,7 @@
 #include "KeyManagement/KeyStores/YubiHSM.h"
 #include "KeyManagement/KeyStores/HSMStore.h"
 #include "KeyManagement/KeyStores/FileStore.h"
+#include "KeyManagement/KeyStores/JournalStore.h"
 #include "Algorithms/Util/Strings.h"
 #include "Algorithms/Logging/Logger.h"
 
@@ -31,6 +32,19 @@ namespace cqp
                 result.reset(new keygen::FileStore(filename));
             }
             else
+#endif
+#if defined(__unix__)
+                if(backingStoreType == "journal")
+                {
+                    std::string directory = bsUrl.GetHost() + bsUrl.GetPath();
+                    if(directory.empty())
+                    {
+                        LOGDEBUG("Using default directory: keys.journal");
+                        directory = "keys.journal";
+                    }
+                    result.reset(new keygen::JournalStore(directory));
+                }
+                else
 #endif
                 if(backingStoreType == "pkcs11")
                 {
@@ -21,6 +21,7 @@ namespace cqp {
              * @details
              * Possible valid url schemas are:
              *  - `file://<filename>` An SQLite database stored in a file
+             *  - `journal://<directory>` Memory mapped journal files in a directory
              *  - `pkcs11:<pkcs11 string>` A PKCS#11 compatible HSM
              *  - `yubihsm2:<pkcs11 string>` A YubiHSM2 device with the PKCS#11 bridge
              * @param url The address for the backing store
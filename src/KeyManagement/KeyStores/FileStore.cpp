@@ -12,6 +12,7 @@
 #include "FileStore.h"
 #if defined(SQLITE3_FOUND)
 #include <sqlite3.h>                   // for sqlite3_bind_int64, sqlite3_exec
+#include <algorithm>                   // for max, min
 #include <limits>                      // for numeric_limits
 #include <utility>                     // for pair
 #include "Algorithms/Util/Hash.h"      // for FNV1aHash
@@ -73,6 +74,8 @@ namespace cqp
                                          "        `SiteB`	TEXT NOT NULL UNIQUE,"
                                          "        PRIMARY KEY(`LinkID`)"
                                          ");"
+                                         // lets the per link queries seek instead of scanning the whole table
+                                         "CREATE INDEX IF NOT EXISTS `keysByLink` ON `keys` (`LinkID`, `InUse`, `ID`);"
                                          "COMMIT;"
                                          "PRAGMA OPTIMIZE;"
                                          "PRAGMA writable_schema = 0;";
@@ -84,30 +87,46 @@ namespace cqp
             // create statements
             if(result == SQLITE_OK)
             {
+                // the bulk statements share the link id as ?1
+                std::string insertRows;
+                std::string idList;
+                for(size_t row = 0; row < BulkRows; row++)
+                {
+                    const std::string separator = row == 0 ? "" : ", ";
+                    insertRows += separator + "(?1, ?" + std::to_string(row * 2 + 2) + ", ?" + std::to_string(row * 2 + 3) + ")";
+                    idList += separator + "?" + std::to_string(row + 2);
+                }
+
                 std::string command = "INSERT INTO keys (LinkID, ID, Value)"
                                       " VALUES (?, ?, ?)";
                 result |= CheckSQLite(sqlite3_prepare_v2(db, command.c_str(), command.length(), &insertStmt, nullptr));
 
+                command = "INSERT INTO keys (LinkID, ID, Value) VALUES " + insertRows;
+                result |= CheckSQLite(sqlite3_prepare_v2(db, command.c_str(), command.length(), &insertManyStmt, nullptr));
+
                 command = "INSERT OR IGNORE INTO links (LinkID, SiteB) VALUES (?, ?)";
                 result |= CheckSQLite(sqlite3_prepare_v2(db, command.c_str(), command.length(), &insertLinkStmt, nullptr));
 
                 command = "SELECT (Value) FROM keys where LinkID = ? AND ID = ?";
                 result |= CheckSQLite(sqlite3_prepare_v2(db, command.c_str(), command.length(), &getKeyStmt, nullptr));
 
-                command = "SELECT (ID) FROM keys WHERE (LinkID = ?1 AND InUse = 0) ORDER BY ID LIMIT 1";
-                result |= CheckSQLite(sqlite3_prepare_v2(db, command.c_str(), command.length(), &getAvailableKeyStmt, nullptr));
+                command = "SELECT ID, Value FROM keys WHERE LinkID = ?1 AND ID IN (" + idList + ")";
+                result |= CheckSQLite(sqlite3_prepare_v2(db, command.c_str(), command.length(), &getManyStmt, nullptr));
+
+                command = "SELECT (ID) FROM keys WHERE (LinkID = ?1 AND InUse = 0) ORDER BY ID LIMIT ?2";
+                result |= CheckSQLite(sqlite3_prepare_v2(db, command.c_str(), command.length(), &getAvailableKeysStmt, nullptr));
 
-                command = "UPDATE OR FAIL keys SET InUse = 1 WHERE (LinkID = ?1 AND ID = ?2)";
+                command = "UPDATE OR FAIL keys SET InUse = 1 WHERE (LinkID = ?1 AND InUse = 0 AND ID <= ?2)";
                 result |= CheckSQLite(sqlite3_prepare_v2(db, command.c_str(), command.length(), &markInUseStmt, nullptr));
 
                 command = "DELETE FROM keys WHERE LinkID = ?1 AND ID = ?2";
                 result |= CheckSQLite(sqlite3_prepare_v2(db, command.c_str(), command.length(), &deleteKeyStmt, nullptr));
 
-                command = "SELECT COUNT(*) FROM keys WHERE LinkID = ?";
-                result |= CheckSQLite(sqlite3_prepare_v2(db, command.c_str(), command.length(), &countKeysStmt, nullptr));
+                command = "DELETE FROM keys WHERE LinkID = ?1 AND ID IN (" + idList + ")";
+                result |= CheckSQLite(sqlite3_prepare_v2(db, command.c_str(), command.length(), &deleteManyStmt, nullptr));
 
-                command = "SELECT MAX(ID) FROM keys GROUP BY LinkID HAVING LinkID = ?";
-                result |= CheckSQLite(sqlite3_prepare_v2(db, command.c_str(), command.length(), &getNextIdStmt, nullptr));
+                command = "SELECT COUNT(*), MAX(ID) FROM keys WHERE LinkID = ?";
+                result |= CheckSQLite(sqlite3_prepare_v2(db, command.c_str(), command.length(), &countKeysStmt, nullptr));
 
                 // if you add a statement, add a finalize call to the destructor
             }
@@ -124,22 +143,66 @@ namespace cqp
             CheckSQLite(sqlite3_exec(db, "PRAGMA OPTIMIZE; VACUUM;", nullptr, nullptr, nullptr));
             // cleanup statements
             CheckSQLite(sqlite3_finalize(insertStmt));
+            CheckSQLite(sqlite3_finalize(insertManyStmt));
             CheckSQLite(sqlite3_finalize(getKeyStmt));
-            CheckSQLite(sqlite3_finalize(getAvailableKeyStmt));
+            CheckSQLite(sqlite3_finalize(getManyStmt));
+            CheckSQLite(sqlite3_finalize(getAvailableKeysStmt));
             CheckSQLite(sqlite3_finalize(markInUseStmt));
             CheckSQLite(sqlite3_finalize(deleteKeyStmt));
+            CheckSQLite(sqlite3_finalize(deleteManyStmt));
             CheckSQLite(sqlite3_finalize(insertLinkStmt));
             CheckSQLite(sqlite3_finalize(countKeysStmt));
-            CheckSQLite(sqlite3_finalize(getNextIdStmt));
 
             CheckSQLite(sqlite3_close(db));
         }
 
+        FileStore::LinkCounters& FileStore::Counters(uint64_t link)
+        {
+            auto found = counters.find(link);
+            if(found == counters.end())
+            {
+                // first time this link has been seen, count what is already in the database
+                LinkCounters linkCounters;
+                CheckSQLite(sqlite3_bind_int64(countKeysStmt, 1, link));
+                if(CheckSQLite(sqlite3_step(countKeysStmt)) == SQLITE_ROW)
+                {
+                    linkCounters.stored = sqlite3_column_int64(countKeysStmt, 0);
+                    if(sqlite3_column_type(countKeysStmt, 1) != SQLITE_NULL)
+                    {
+                        linkCounters.nextId = sqlite3_column_int64(countKeysStmt, 1) + 1;
+                    }
+                }
+                CheckSQLite(sqlite3_reset(countKeysStmt));
+                found = counters.emplace(link, linkCounters).first;
+            }
+            return found->second;
+        }
+
+        void FileStore::BindIds(sqlite3_stmt* stmt, uint64_t link, Keys::const_iterator first, Keys::const_iterator last)
+        {
+            CheckSQLite(sqlite3_bind_int64(stmt, 1, link));
+            int param = 2;
+            for(auto key = first; key != last; key++)
+            {
+                CheckSQLite(sqlite3_bind_int64(stmt, param++, key->first));
+            }
+            // null never matches so the rest of the list is ignored
+            for(; param < static_cast<int>(BulkRows) + 2; param++)
+            {
+                CheckSQLite(sqlite3_bind_null(stmt, param));
+            }
+        }
+
         bool FileStore::StoreKeys(const std::string& destination, Keys& keys)
         {
             // Note: binds are indexed from 1, columns are indexed from 0
             // hash the destination to get the link id
             const uint64_t link = FNV1aHash(destination);
+            std::lock_guard<std::mutex> lock(queryMutex);
+            LinkCounters& linkCounters = Counters(link);
+            uint64_t stored = 0;
+            uint64_t nextId = linkCounters.nextId;
+            Keys failed;
 
             // start a transaction
             // suspect using a prepared statement he would cause issues with multiple threads
@@ -152,20 +215,69 @@ namespace cqp
             bool result = SQLiteOk(sqlite3_step(insertLinkStmt));
             CheckSQLite(sqlite3_reset(insertLinkStmt));
 
-            for(auto key : keys)
+            auto first = keys.cbegin();
+            while(first != keys.cend())
             {
-                // load the incoming values in to the statement
-                CheckSQLite(sqlite3_bind_int64(insertStmt, 1, link));
-                CheckSQLite(sqlite3_bind_int64(insertStmt, 2, key.first));
-                CheckSQLite(sqlite3_bind_blob(insertStmt, 3, key.second.data(), key.second.size(), nullptr));
-                // store the key
-                result &= SQLiteOk(sqlite3_step(insertStmt));
-                CheckSQLite(sqlite3_reset(insertStmt));
-            } // for keys
+                const bool fullBatch = static_cast<size_t>(keys.cend() - first) >= BulkRows;
+                const auto last = fullBatch ? first + BulkRows : keys.cend();
+                bool batchStored = false;
+
+                if(fullBatch)
+                {
+                    // store the whole batch with one statement
+                    CheckSQLite(sqlite3_bind_int64(insertManyStmt, 1, link));
+                    int param = 2;
+                    for(auto key = first; key != last; key++)
+                    {
+                        CheckSQLite(sqlite3_bind_int64(insertManyStmt, param++, key->first));
+                        CheckSQLite(sqlite3_bind_blob(insertManyStmt, param++, key->second.data(), key->second.size(), nullptr));
+                    }
+                    // a failure, such as a duplicate key, only undoes this statement
+                    batchStored = sqlite3_step(insertManyStmt) == SQLITE_DONE;
+                    sqlite3_reset(insertManyStmt);
+                }
+
+                for(auto key = first; key != last; key++)
+                {
+                    bool keyStored = batchStored;
+                    if(!batchStored)
+                    {
+                        // store the keys one at a time so that the ones which fail can be found
+                        CheckSQLite(sqlite3_bind_int64(insertStmt, 1, link));
+                        CheckSQLite(sqlite3_bind_int64(insertStmt, 2, key->first));
+                        CheckSQLite(sqlite3_bind_blob(insertStmt, 3, key->second.data(), key->second.size(), nullptr));
+                        keyStored = SQLiteOk(sqlite3_step(insertStmt));
+                        CheckSQLite(sqlite3_reset(insertStmt));
+                    }
+
+                    if(keyStored)
+                    {
+                        stored++;
+                        nextId = std::max(nextId, key->first + 1);
+                    }
+                    else
+                    {
+                        failed.push_back(*key);
+                    }
+                } // for keys
+
+                first = last;
+            } // while keys
 
             // commit the transaction
-            CheckSQLite(sqlite3_exec(db, "COMMIT", nullptr, nullptr, nullptr));
-            keys.clear();
+            if(SQLiteOk(sqlite3_exec(db, "COMMIT", nullptr, nullptr, nullptr)))
+            {
+                linkCounters.stored += stored;
+                linkCounters.nextId = nextId;
+                // leave anything which wasn't stored in the list
+                result &= failed.empty();
+                keys = std::move(failed);
+            }
+            else
+            {
+                CheckSQLite(sqlite3_exec(db, "ROLLBACK", nullptr, nullptr, nullptr));
+                result = false;
+            }
 
             return result;
         } // StoreKeys
@@ -176,6 +288,8 @@ namespace cqp
             bool result = false;
             const uint64_t link = FNV1aHash(destination);
             bool doCommit = false;
+            std::lock_guard<std::mutex> lock(queryMutex);
+            LinkCounters& linkCounters = Counters(link);
 
             // from docs: After a BEGIN IMMEDIATE, no other database connection will be able to write to the database or do a BEGIN IMMEDIATE or BEGIN EXCLUSIVE. Other processes can continue to read from the database, however.
             CheckSQLite(sqlite3_exec(db, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr));
@@ -200,6 +314,11 @@ namespace cqp
             {
                 result = SQLiteOk(sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr));
             }
+
+            if(result)
+            {
+                linkCounters.stored--;
+            }
             else
             {
                 CheckSQLite(sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr));
@@ -212,75 +331,115 @@ namespace cqp
             // Note: binds are indexed from 1, columns are indexed from 0
             bool result = false;
             const uint64_t link = FNV1aHash(destination);
-            bool doCommit = false;
-
-            CheckSQLite(sqlite3_bind_int64(getKeyStmt, 1, link));
+            uint64_t removed = 0;
+            std::lock_guard<std::mutex> lock(queryMutex);
+            LinkCounters& linkCounters = Counters(link);
 
             // from docs: After a BEGIN IMMEDIATE, no other database connection will be able to write to the database or do a BEGIN IMMEDIATE or BEGIN EXCLUSIVE. Other processes can continue to read from the database, however.
             CheckSQLite(sqlite3_exec(db, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr));
-            for(auto& key : keys)
+
+            for(auto first = keys.begin(); first != keys.end(); )
             {
-                CheckSQLite(sqlite3_bind_int64(getKeyStmt, 2, key.first));
-                if(CheckSQLite(sqlite3_step(getKeyStmt)) == SQLITE_ROW)
+                const auto last = static_cast<size_t>(keys.end() - first) > BulkRows ? first + BulkRows : keys.end();
+                // the rows can come back in any order
+                std::unordered_map<KeyID, PSK*> batch;
+                for(auto key = first; key != last; key++)
                 {
-                    const auto keyBytes = sqlite3_column_text(getKeyStmt, 0);
-                    key.second.assign(keyBytes, keyBytes + sqlite3_column_bytes(getKeyStmt, 0));
+                    batch[key->first] = &key->second;
+                }
 
-                    CheckSQLite(sqlite3_bind_int64(deleteKeyStmt, 1, link));
-                    CheckSQLite(sqlite3_bind_int64(deleteKeyStmt, 2, key.first));
-                    CheckSQLite(sqlite3_step(deleteKeyStmt));
-                    doCommit = true;
+                BindIds(getManyStmt, link, first, last);
+                while(CheckSQLite(sqlite3_step(getManyStmt)) == SQLITE_ROW)
+                {
+                    const auto keyValue = static_cast<const unsigned char*>(sqlite3_column_blob(getManyStmt, 1));
+                    const auto numBytes = sqlite3_column_bytes(getManyStmt, 1);
+                    batch[sqlite3_column_int64(getManyStmt, 0)]->assign(keyValue, keyValue + numBytes);
                 }
-                CheckSQLite(sqlite3_reset(getKeyStmt));
-                CheckSQLite(sqlite3_reset(deleteKeyStmt));
+                CheckSQLite(sqlite3_reset(getManyStmt));
+
+                BindIds(deleteManyStmt, link, first, last);
+                CheckSQLite(sqlite3_step(deleteManyStmt));
+                removed += sqlite3_changes(db);
+                CheckSQLite(sqlite3_reset(deleteManyStmt));
+
+                first = last;
             }
 
-            if(doCommit)
+            if(removed > 0 && SQLiteOk(sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr)))
             {
-                CheckSQLite(sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr));
+                linkCounters.stored -= removed;
+                result = removed == keys.size();
             }
             else
             {
                 CheckSQLite(sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr));
+                // nothing has been removed
+                for(auto& key : keys)
+                {
+                    key.second.clear();
+                }
             }
             return result;
-        } // RemoveKey
+        } // RemoveKeys
 
         bool FileStore::ReserveKey(const std::string& destination, KeyID& identity)
         {
-            // Note: binds are indexed from 1, columns are indexed from 0
             bool result = false;
+            std::vector<KeyID> reserved;
+            if(ReserveKeys(destination, 1, reserved) == 1)
+            {
+                identity = reserved.front();
+                result = true;
+            }
+            return result;
+        } // ReserveKey
+
+        size_t FileStore::ReserveKeys(const std::string& destination, size_t maxKeys, std::vector<KeyID>& keyIds)
+        {
+            // Note: binds are indexed from 1, columns are indexed from 0
+            size_t result = 0;
             const uint64_t link = FNV1aHash(destination);
+            KeyID lastId = 0;
+            std::lock_guard<std::mutex> lock(queryMutex);
+
             // from docs: After a BEGIN IMMEDIATE, no other database connection will be able to write to the database or do a BEGIN IMMEDIATE or BEGIN EXCLUSIVE. Other processes can continue to read from the database, however.
             CheckSQLite(sqlite3_exec(db, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr));
 
-            // Find an unused key
-            CheckSQLite(sqlite3_bind_int64(getAvailableKeyStmt, 1, link));
+            // Find the lowest unused keys
+            CheckSQLite(sqlite3_bind_int64(getAvailableKeysStmt, 1, link));
+            CheckSQLite(sqlite3_bind_int64(getAvailableKeysStmt, 2,
+                                           static_cast<sqlite3_int64>(std::min<size_t>(maxKeys, std::numeric_limits<sqlite3_int64>::max()))));
+            while(CheckSQLite(sqlite3_step(getAvailableKeysStmt)) == SQLITE_ROW)
+            {
+                lastId = sqlite3_column_int64(getAvailableKeysStmt, 0);
+                keyIds.push_back(lastId);
+                result++;
+            }
+            CheckSQLite(sqlite3_reset(getAvailableKeysStmt));
 
-            if(CheckSQLite(sqlite3_step(getAvailableKeyStmt)) == SQLITE_ROW)
+            if(result > 0)
             {
-                // a row exists, use it's key to mark it
-                identity = sqlite3_column_int64(getAvailableKeyStmt, 0);
-                // set the key as in use
+                // they are the only unused keys up to the last one so mark them all at once
                 CheckSQLite(sqlite3_bind_int64(markInUseStmt, 1, link));
-                CheckSQLite(sqlite3_bind_int64(markInUseStmt, 2, identity));
+                CheckSQLite(sqlite3_bind_int64(markInUseStmt, 2, lastId));
                 CheckSQLite(sqlite3_step(markInUseStmt));
                 CheckSQLite(sqlite3_reset(markInUseStmt));
 
-                CheckSQLite(sqlite3_reset(getAvailableKeyStmt));
-                result = SQLiteOk(sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr));
-
+                if(!SQLiteOk(sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr)))
+                {
+                    keyIds.resize(keyIds.size() - result);
+                    result = 0;
+                }
             }
-            else
+
+            if(result == 0)
             {
                 // no free keys, abort the transaction
-                result = false;
-                CheckSQLite(sqlite3_reset(getAvailableKeyStmt));
                 CheckSQLite(sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr));
             }
 
             return result;
-        } // ReserveKey
+        } // ReserveKeys
 
         void FileStore::GetCounts(const std::string& destination, uint64_t& availableKeys, uint64_t& remainingCapacity)
         {
@@ -288,33 +447,17 @@ namespace cqp
             // no storage restrictions
             remainingCapacity = std::numeric_limits<uint64_t>::max();
 
-            // Note: binds are indexed from 1, columns are indexed from 0
             // serialise the calls, the same statement cannot be used by more than thread at a time.
             std::lock_guard<std::mutex> lock(queryMutex);
-
-            CheckSQLite(sqlite3_bind_int64(countKeysStmt, 1, link));
-            if(CheckSQLite(sqlite3_step(countKeysStmt)) == SQLITE_ROW)
-            {
-                availableKeys = sqlite3_column_int64(countKeysStmt, 0);
-            }
-            CheckSQLite(sqlite3_reset(countKeysStmt));
+            availableKeys = Counters(link).stored;
         }
 
         uint64_t FileStore::GetNextKeyId(const std::string& destination)
         {
             const uint64_t link = FNV1aHash(destination);
-            // Note: binds are indexed from 1, columns are indexed from 0
-            uint64_t result = 1;
             // serialise the calls, the same statement cannot be used by more than thread at a time.
             std::lock_guard<std::mutex> lock(queryMutex);
-
-            CheckSQLite(sqlite3_bind_int64(getNextIdStmt, 1, link));
-            if(CheckSQLite(sqlite3_step(getNextIdStmt)) == SQLITE_ROW)
-            {
-                result = sqlite3_column_int64(getNextIdStmt, 0) + 1;
-            }
-            CheckSQLite(sqlite3_reset(getNextIdStmt));
-            return result;
+            return Counters(link).nextId;
         }
     } // namespace keygen
 } // namespace cqp
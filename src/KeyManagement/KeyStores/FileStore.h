@@ -13,6 +13,7 @@
 #if defined(SQLITE3_FOUND)
 #include <mutex>                                  // for mutex
 #include <string>                                 // for string
+#include <unordered_map>                          // for unordered_map
 #include "Algorithms/Datatypes/Keys.h"            // for KeyID
 #include "KeyManagement/KeyStores/IBackingStore.h"
 #include "KeyManagement/keymanagement_export.h"
@@ -56,36 +57,79 @@ namespace cqp
             /// @copydoc IBackingStore::ReserveKey
             bool ReserveKey(const std::string& destination, KeyID& keyId) override;
 
+            /// @copydoc IBackingStore::ReserveKeys
+            size_t ReserveKeys(const std::string& destination, size_t maxKeys, std::vector<KeyID>& keyIds) override;
+
             /// @copydoc IBackingStore::GetCounts
             void GetCounts(const std::string& destination, uint64_t& availableKeys, uint64_t& remainingCapacity) override;
             /// @copydoc IBackingStore::GetNextKeyId
             virtual uint64_t GetNextKeyId(const std::string& destination) override;
             ///@}
+
+            /// The number of keys inserted or deleted by each bulk statement
+            static constexpr size_t BulkRows = 128;
+
+        protected: // types
+            /// Values which are kept in memory to avoid scanning the table
+            struct LinkCounters
+            {
+                /// The number of keys stored for the link
+                uint64_t stored = 0;
+                /// One more than the highest key id which has been stored
+                uint64_t nextId = 1;
+            };
+
         protected: // members
             /// The database object
             sqlite3* db = nullptr;
             /// prepared statement to insert a key
             sqlite3_stmt* insertStmt = nullptr;
+            /// prepared statement to insert BulkRows keys
+            sqlite3_stmt* insertManyStmt = nullptr;
             /// prepared statement to get a key
             sqlite3_stmt* getKeyStmt = nullptr;
-            /// prepared statement to get an unused key
-            sqlite3_stmt* getAvailableKeyStmt = nullptr;
-            /// prepared statement to marka  key as in use so getAvailableKeyStmt will ignore it
+            /// prepared statement to get up to BulkRows keys
+            sqlite3_stmt* getManyStmt = nullptr;
+            /// prepared statement to get a number of unused keys
+            sqlite3_stmt* getAvailableKeysStmt = nullptr;
+            /// prepared statement to mark all unused keys up to an id as in use so getAvailableKeysStmt will ignore them
             sqlite3_stmt* markInUseStmt = nullptr;
             /// prepared statement to remove a key
             sqlite3_stmt* deleteKeyStmt = nullptr;
+            /// prepared statement to remove up to BulkRows keys
+            sqlite3_stmt* deleteManyStmt = nullptr;
             /// prepared statement to add a mapping from destination to link id
             sqlite3_stmt* insertLinkStmt = nullptr;
-            /// prepared statement to count keys in the database
+            /// prepared statement to count the keys and find the highest id for a link
             sqlite3_stmt* countKeysStmt = nullptr;
-            /// prepared statement to update the next key id
-            sqlite3_stmt* getNextIdStmt = nullptr;
 
-            /// protect against the select statement being used my multiple threads
+            /// The counters for each link id, loaded the first time the link is used
+            std::unordered_map<uint64_t, LinkCounters> counters;
+
+            /// protect against the statements being used by multiple threads and the counters
+            /// being changed outside of a transaction
             std::mutex queryMutex;
 
         protected: // methods
 
+            /**
+             * @brief Counters
+             * Get the counters for a link, reading them from the database if needed. queryMutex must be held
+             * @param link The link id
+             * @return The counters for the link
+             */
+            LinkCounters& Counters(uint64_t link);
+
+            /**
+             * @brief BindIds
+             * Bind a list of ids to a bulk statement, any unused parameters are set to null
+             * @param stmt The statement to bind, the first parameter is the link id
+             * @param link The link id
+             * @param first The first key to bind
+             * @param last One past the last key to bind
+             */
+            static void BindIds(sqlite3_stmt* stmt, uint64_t link, Keys::const_iterator first, Keys::const_iterator last);
+
             /**
              * @brief CheckSQLite
              * If the result from a sqlite command is an error - print the error message
@@ -10,7 +10,9 @@
 * @author Richard Collins <richard.collins@bristol.ac.uk>
 */
 #include "HSMStore.h"
+#include <algorithm>                   // for find_if, max, partition
 #include <chrono>                      // for high_resolution_clock
+#include <iterator>                    // for make_move_iterator
 #include <map>                         // for map, _Rb_tree_iterator, map<>:...
 #include <memory>                      // for allocator, __shared_ptr_access
 #include <utility>                     // for pair, move
@@ -150,20 +152,31 @@ namespace cqp
         {
             using namespace std;
             using namespace p11;
-            bool result = InitSlot();
+            lock_guard<mutex> lock(loginLock);
 
-            if(slot)
+            if(tokenRemoved.exchange(false))
             {
-                if(session == nullptr)
+                // the sessions and handles are no longer valid
+                /*lock scope*/
                 {
-                    session = Session::Create(slot, Session::DefaultFlags, this, &HSMStore::SessionEventCallback);
-                }
-
-                if(session->IsLoggedIn())
+                    lock_guard<mutex> sessionLock(sessionsLock);
+                    openSessions -= idleSessions.size();
+                    idleSessions.clear();
+                    sessionGeneration++;
+                }/*lock scope*/
+                /*lock scope*/
                 {
-                    result = true;
-                }
-                else
+                    lock_guard<mutex> indexLock(linksLock);
+                    links.clear();
+                }/*lock scope*/
+                loggedIn = false;
+            }
+
+            if(InitSlot() && !loggedIn)
+            {
+                uint64_t generation = 0;
+                auto session = AcquireSession(generation);
+                if(session)
                 {
                     if(pinValue.empty() && pinSource.empty() && pinCallback)
                     {
@@ -173,18 +186,19 @@ namespace cqp
 
                     if(!pinValue.empty())
                     {
-                        result = CheckP11(session->Login(static_cast<CK_USER_TYPE>(login), pinValue)) == CKR_OK;
+                        CheckP11(session->Login(static_cast<CK_USER_TYPE>(login), pinValue));
+                        loggedIn = session->IsLoggedIn();
                     } // if pin-value
                     else if(!pinSource.empty())
                     {
                         if(fs::ReadEntireFile(pinSource, pinValue, pinLengthLimit))
                         {
                             trim(pinValue);
-                            result = CheckP11(session->Login(static_cast<CK_USER_TYPE>(login), pinValue)) == CKR_OK;
+                            CheckP11(session->Login(static_cast<CK_USER_TYPE>(login), pinValue));
+                            loggedIn = session->IsLoggedIn();
                         } // if read ok
                         else
                         {
-                            result = false;
                             LOGERROR("Failed to read pin from " + pinSource);
                         } // if read !ok
 
@@ -193,20 +207,235 @@ namespace cqp
                     {
                         LOGERROR("No pin provided");
                     }// if pin-source
-                }// if !logged in
-            } // if slot ok
 
+                    ReleaseSession(session, generation);
+                } // if session
+            }// if !logged in
+
+            return loggedIn;
+        }
+
+        void HSMStore::SetMaxSessions(size_t sessions)
+        {
+            /*lock scope*/
+            {
+                std::lock_guard<std::mutex> lock(sessionsLock);
+                maxSessions = std::max<size_t>(1, sessions);
+            }/*lock scope*/
+            sessionReturned.notify_all();
+        }
+
+        std::shared_ptr<p11::Session> HSMStore::AcquireSession(uint64_t& generation)
+        {
+            using namespace std;
+            using namespace p11;
+            shared_ptr<Session> result;
+            const auto thisThread = this_thread::get_id();
+
+            /*lock scope*/
+            {
+                unique_lock<mutex> lock(sessionsLock);
+                sessionReturned.wait(lock, [&]
+                {
+                    return !idleSessions.empty() || openSessions < maxSessions;
+                });
+                generation = sessionGeneration;
+
+                if(!idleSessions.empty())
+                {
+                    // prefer the session this thread used last
+                    auto chosen = find_if(idleSessions.begin(), idleSessions.end(), [&](const pair<thread::id, shared_ptr<Session>>& idle)
+                    {
+                        return idle.first == thisThread;
+                    });
+                    if(chosen == idleSessions.end())
+                    {
+                        chosen = idleSessions.end() - 1;
+                    }
+                    result = move(chosen->second);
+                    idleSessions.erase(chosen);
+                }
+                else
+                {
+                    // count the session now so that other threads don't go over the limit while it's being opened
+                    openSessions++;
+                }
+            }/*lock scope*/
+
+            if(!result && slot)
+            {
+                result = Session::Create(slot, Session::DefaultFlags, this, &HSMStore::SessionEventCallback);
+                if(result->GetSessionHandle() == CK_INVALID_HANDLE)
+                {
+                    result.reset();
+                }
+            }
+
+            if(!result)
+            {
+                LOGERROR("Failed to open session");
+                ReleaseSession(nullptr, generation);
+            }
+            return result;
+        }
+
+        void HSMStore::ReleaseSession(std::shared_ptr<p11::Session> session, uint64_t generation)
+        {
+            /*lock scope*/
+            {
+                std::lock_guard<std::mutex> lock(sessionsLock);
+                if(session && generation == sessionGeneration)
+                {
+                    idleSessions.emplace_back(std::this_thread::get_id(), std::move(session));
+                }
+                else
+                {
+                    // the session failed or is from before the token was removed
+                    openSessions--;
+                }
+            }/*lock scope*/
+            sessionReturned.notify_one();
+        }
+
+        HSMStore::PooledSession::PooledSession(HSMStore& store) :
+            store(store)
+        {
+            if(store.InitSession())
+            {
+                session = store.AcquireSession(generation);
+            }
+        }
+
+        HSMStore::PooledSession::~PooledSession()
+        {
+            if(session)
+            {
+                store.ReleaseSession(std::move(session), generation);
+            }
+        }
+
+        HSMStore::LinkIndex& HSMStore::Index(const PooledSession& session, const std::string& destination)
+        {
+            using namespace p11;
+            using namespace std;
+            auto found = links.find(destination);
+            if(found == links.end())
+            {
+                // first time this destination has been seen, read what's already on the device
+                LinkIndex index;
+                AttributeList attrList{*findObjDefaults};
+                attrList.Set(CKA_LABEL, destination);
+                ObjectList allKeys;
+                CheckP11(session->FindObjects(attrList, std::numeric_limits<unsigned long>::max(), allKeys));
+
+                set<ObjectHandle> unreserved;
+                if(storeReservations)
+                {
+                    ObjectList unreservedKeys;
+                    attrList.Set(CKA_START_DATE, zeroStartDate);
+                    CheckP11(session->FindObjects(attrList, std::numeric_limits<unsigned long>::max(), unreservedKeys));
+                    for(const auto& obj : unreservedKeys)
+                    {
+                        unreserved.insert(obj.Handle());
+                    }
+                }
+
+                for(auto& obj : allKeys)
+                {
+                    KeyID keyId = 0;
+                    if(obj.GetAttributeValue(CKA_ID, keyId) == CKR_OK)
+                    {
+                        FixKeyID(keyId);
+                        if(!storeReservations || unreserved.count(obj.Handle()) > 0)
+                        {
+                            index.available[keyId] = obj.Handle();
+                        }
+                        else
+                        {
+                            index.reserved[keyId] = obj.Handle();
+                        }
+                        index.nextId = max(index.nextId, keyId + 1);
+                    } // if has id
+                } // for allKeys
+
+                found = links.emplace(destination, move(index)).first;
+            }
+            return found->second;
+        }
+
+        bool HSMStore::TakeHandle(const PooledSession& session, const std::string& destination, KeyID keyId,
+                                  ObjectHandle& handle, bool& wasReserved)
+        {
+            bool result = false;
+            std::lock_guard<std::mutex> lock(linksLock);
+            auto& index = Index(session, destination);
+
+            for(auto* keys :
+                    {
+                        &index.available, &index.reserved
+                    })
+            {
+                auto keyFound = keys->find(keyId);
+                if(keyFound != keys->end())
+                {
+                    handle = keyFound->second;
+                    wasReserved = keys == &index.reserved;
+                    keys->erase(keyFound);
+                    result = true;
+                    break; // for
+                }
+            }
             return result;
         }
 
+        bool HSMStore::FindHandle(const PooledSession& session, const std::string& destination, KeyID keyId, ObjectHandle& handle)
+        {
+            bool result = false;
+            std::lock_guard<std::mutex> lock(linksLock);
+            auto& index = Index(session, destination);
+
+            for(const auto* keys :
+                    {
+                        &index.available, &index.reserved
+                    })
+            {
+                auto keyFound = keys->find(keyId);
+                if(keyFound != keys->end())
+                {
+                    handle = keyFound->second;
+                    result = true;
+                    break; // for
+                }
+            }
+            return result;
+        }
+
+        void HSMStore::RestoreHandle(const std::string& destination, KeyID keyId, ObjectHandle handle, bool reserved)
+        {
+            std::lock_guard<std::mutex> lock(linksLock);
+            auto found = links.find(destination);
+            if(found != links.end())
+            {
+                if(reserved)
+                {
+                    found->second.reserved[keyId] = handle;
+                }
+                else
+                {
+                    found->second.available[keyId] = handle;
+                }
+            }
+        }
+
         unsigned int HSMStore::DeleteAllKeys()
         {
             using namespace p11;
             using namespace std;
             ObjectList found;
             unsigned int numDeleted = 0;
+            PooledSession session(*this);
 
-            if(InitSession())
+            if(session)
             {
                 // setup the search parameters
                 AttributeList attrList{*findObjDefaults};
@@ -214,7 +443,7 @@ namespace cqp
                 bool result = true;
 
                 // search for the object
-                while(result && session->FindObjects(attrList, 100, found) == CKR_OK && !found.empty())
+                while(result && session->FindObjects(attrList, Session::FindBatchSize, found) == CKR_OK && !found.empty())
                 {
                     for(auto obj : found)
                     {
@@ -230,6 +459,10 @@ namespace cqp
                     } // for found
                     found.clear();
                 } // while found
+
+                // the index will be rebuilt from whatever is left
+                lock_guard<mutex> lock(linksLock);
+                links.clear();
             }
             else
             {
@@ -242,22 +475,20 @@ namespace cqp
         {
             using namespace p11;
             using namespace std;
-            ObjectList found;
             bool result = false;
+            PooledSession session(*this);
 
-            if(InitSession())
+            if(session)
             {
-                // setup the search parameters
-                AttributeList attrList{*findObjDefaults};
-                attrList.Set(CKA_LABEL, destination);
-                SetID(attrList, keyId);
-                // search for the object
-                if(session->FindObjects(attrList, 1, found) == CKR_OK && !found.empty())
+                ObjectHandle handle = 0;
+                bool wasReserved = false;
+                if(TakeHandle(session, destination, keyId, handle, wasReserved))
                 {
-                    if(found[0].DestroyObject() != CKR_OK)
+                    result = CheckP11(DataObject(session.Get(), handle).DestroyObject()) == CKR_OK;
+                    if(!result)
                     {
                         LOGERROR("Failed to destroy removed key: 0x" + ToHexString(keyId));
-                        result = false;
+                        RestoreHandle(destination, keyId, handle, wasReserved);
                     }
                 }
                 else
@@ -278,8 +509,9 @@ namespace cqp
             using namespace std;
             ObjectList found;
             std::set<std::string> result;
+            PooledSession session(*this);
 
-            if(InitSession())
+            if(session)
             {
                 // setup the search parameters
                 AttributeList attrList{*findObjDefaults};
@@ -318,8 +550,8 @@ namespace cqp
                     {
                         if(!(info.flags & CKF_TOKEN_PRESENT))
                         {
-                            // token has been removed
-                            self->session.reset();
+                            // token has been removed, the sessions will be dropped the next time one is needed
+                            self->tokenRemoved = true;
                         }
                     } // if info ok
                 } // if pApp
@@ -507,10 +739,10 @@ namespace cqp
 
         HSMStore::~HSMStore()
         {
-            if(session && session->IsLoggedIn())
+            if(loggedIn && !idleSessions.empty())
             {
                 LOGTRACE("Logging Out");
-                session->Logout();
+                idleSessions.front().second->Logout();
             }
         }
 
@@ -518,19 +750,15 @@ namespace cqp
         {
             using namespace p11;
             using namespace std;
-            ObjectList found;
             bool result = false;
+            PooledSession session(*this);
 
-            if(InitSession())
+            if(session)
             {
-                // setup the search parameters
-                AttributeList attrList{*findObjDefaults};
-                attrList.Set(CKA_LABEL, destination);
-                SetID(attrList, keyId);
-                // search for the object
-                if(CheckP11(session->FindObjects(attrList, 1, found)) == CKR_OK && !found.empty())
+                ObjectHandle handle = 0;
+                if(FindHandle(session, destination, keyId, handle))
                 {
-                    result = found[0].GetAttributeValue(CKA_VALUE, output) == CKR_OK;
+                    result = DataObject(session.Get(), handle).GetAttributeValue(CKA_VALUE, output) == CKR_OK;
                 }
                 else
                 {
@@ -548,24 +776,38 @@ namespace cqp
         {
             using namespace p11;
             using namespace std;
-            ObjectList found;
             bool result = false;
+            PooledSession session(*this);
 
-            if(InitSession())
+            if(session)
             {
-                // setup the search parameters
-                AttributeList attrList{*findObjDefaults};
-                attrList.Set(CKA_LABEL, destination);
-                if(keyId != 0)
+                ObjectHandle handle = 0;
+                if(keyId == 0)
+                {
+                    // any key will do
+                    lock_guard<mutex> lock(linksLock);
+                    auto& index = Index(session, destination);
+                    for(const auto* keys :
+                            {
+                                &index.available, &index.reserved
+                            })
+                    {
+                        if(!keys->empty() && (!result || keys->begin()->first < keyId))
+                        {
+                            keyId = keys->begin()->first;
+                            handle = keys->begin()->second;
+                            result = true;
+                        }
+                    }
+                }
+                else
                 {
-                    SetID(attrList, keyId);
+                    result = FindHandle(session, destination, keyId, handle);
                 }
-                // search for the object
-                if(CheckP11(session->FindObjects(attrList, 1, found)) == CKR_OK && !found.empty())
+
+                if(result)
                 {
-                    result = found[0].GetAttributeValue(CKA_ID, keyId) == CKR_OK;
-                    FixKeyID(keyId);
-                    result &= found[0].GetAttributeValue(CKA_VALUE, output) == CKR_OK;
+                    result = DataObject(session.Get(), handle).GetAttributeValue(CKA_VALUE, output) == CKR_OK;
                 }
                 else
                 {
@@ -581,21 +823,13 @@ namespace cqp
 
         bool HSMStore::KeyExists(const std::string& destination, KeyID keyId)
         {
-            using namespace p11;
-            using namespace std;
-            ObjectList found;
             bool result = false;
+            PooledSession session(*this);
 
-            if(InitSession())
+            if(session)
             {
-                // setup the search parameters
-                AttributeList attrList{*findObjDefaults};
-                attrList.Set(CKA_LABEL, destination);
-                SetID(attrList, keyId);
-
-                // search for the object
-                CheckP11(session->FindObjects(attrList, 1, found));
-                result = !found.empty();
+                ObjectHandle handle = 0;
+                result = FindHandle(session, destination, keyId, handle);
             }
             else
             {
@@ -606,36 +840,65 @@ namespace cqp
 
         bool HSMStore::StoreKeys(const std::string& destination, Keys& keys)
         {
+            using namespace p11;
+            using namespace std;
             bool result = false;
-            if(InitSession())
+            PooledSession session(*this);
+
+            if(session)
             {
-                for(auto key = keys.begin(); key != keys.end(); key++)
-                {
-                    LOGDEBUG("Storing key 0x" + ToHexString(key->first) + " for " + destination);
-                    using namespace p11;
-                    using namespace std;
-                    AttributeList keyProps{*newObjDefaults};
+                Keys failed;
+                std::vector<std::pair<KeyID, ObjectHandle>> created;
+                created.reserve(keys.size());
 
-                    keyProps.Set(CKA_LABEL, destination);
-                    SetID(keyProps, key->first);
+                /*lock scope*/
+                {
+                    // don't create a second object with the same id
+                    lock_guard<mutex> lock(linksLock);
+                    auto& index = Index(session, destination);
+                    auto duplicate = partition(keys.begin(), keys.end(), [&](const Key& key)
+                    {
+                        return index.available.count(key.first) == 0 && index.reserved.count(key.first) == 0;
+                    });
+                    failed.assign(make_move_iterator(duplicate), make_move_iterator(keys.end()));
+                    keys.erase(duplicate, keys.end());
+                }/*lock scope*/
+
+                // the objects are all created with the same session and the index is only locked once
+                AttributeList keyProps{*newObjDefaults};
+                keyProps.Set(CKA_LABEL, destination);
+                for(auto& key : keys)
+                {
+                    LOGDEBUG("Storing key 0x" + ToHexString(key.first) + " for " + destination);
+                    SetID(keyProps, key.first);
+                    keyProps.Set(CKA_VALUE, key.second);
 
-                    keyProps.Set(CKA_VALUE, key->second);
-                    DataObject newKey(session);
-                    result = CheckP11(newKey.CreateObject(keyProps)) == CKR_OK;
-                    if(!result && key != keys.begin())
+                    DataObject newKey(session.Get());
+                    if(CheckP11(newKey.CreateObject(keyProps)) == CKR_OK)
                     {
-                        // something went wrong, remove the completed keys from the list
-                        keys.erase(keys.begin(), key - 1);
-                        break;
+                        created.emplace_back(key.first, newKey.Handle());
+                    }
+                    else
+                    {
+                        failed.push_back(move(key));
                     }
-
                 } // for keys
 
-                if(result)
+                /*lock scope*/
                 {
-                    keys.clear();
-                }
-            } // if InitSession
+                    lock_guard<mutex> lock(linksLock);
+                    auto& index = Index(session, destination);
+                    for(const auto& key : created)
+                    {
+                        index.available[key.first] = key.second;
+                        index.nextId = max(index.nextId, key.first + 1);
+                    }
+                }/*lock scope*/
+
+                // leave anything which wasn't stored in the list
+                result = failed.empty();
+                keys = move(failed);
+            } // if session
             else
             {
                 LOGERROR("Not in a session");
@@ -648,26 +911,26 @@ namespace cqp
         {
             using namespace p11;
             using namespace std;
-            ObjectList found;
             bool result = false;
+            PooledSession session(*this);
 
-            if(InitSession())
+            if(session)
             {
-                // setup the search parameters
-                AttributeList attrList{*findObjDefaults};
-                attrList.Set(CKA_LABEL, destination);
-                SetID(attrList, keyId);
-                // search for the object
-                if(session->FindObjects(attrList, 1, found) == CKR_OK && !found.empty())
+                ObjectHandle handle = 0;
+                bool wasReserved = false;
+                if(TakeHandle(session, destination, keyId, handle, wasReserved))
                 {
-                    result = found[0].GetAttributeValue(CKA_VALUE, output) == CKR_OK;
-                    if(result)
+                    DataObject key(session.Get(), handle);
+                    result = key.GetAttributeValue(CKA_VALUE, output) == CKR_OK;
+                    if(result && key.DestroyObject() != CKR_OK)
                     {
-                        if(found[0].DestroyObject() != CKR_OK)
-                        {
-                            LOGERROR("Failed to destroy removed key: 0x" + ToHexString(keyId));
-                            result = false;
-                        }
+                        LOGERROR("Failed to destroy removed key: 0x" + ToHexString(keyId));
+                        result = false;
+                    }
+
+                    if(!result)
+                    {
+                        RestoreHandle(destination, keyId, handle, wasReserved);
                     }
                 }
                 else
@@ -684,44 +947,125 @@ namespace cqp
 
         bool HSMStore::RemoveKeys(const std::string& destination, Keys& keys)
         {
-            bool result = true;
-            for(auto key : keys)
+            using namespace p11;
+            using namespace std;
+            bool result = false;
+            PooledSession session(*this);
+
+            if(session)
+            {
+                // claim all the keys at once then remove them with the same session
+                vector<pair<ObjectHandle, bool>> handles(keys.size(), {0, false});
+                vector<bool> claimed(keys.size(), false);
+                /*lock scope*/
+                {
+                    lock_guard<mutex> lock(linksLock);
+                    auto& index = Index(session, destination);
+                    for(size_t keyIndex = 0; keyIndex < keys.size(); keyIndex++)
+                    {
+                        for(auto* list :
+                                {
+                                    &index.available, &index.reserved
+                                })
+                        {
+                            auto keyFound = list->find(keys[keyIndex].first);
+                            if(keyFound != list->end())
+                            {
+                                handles[keyIndex] = {keyFound->second, list == &index.reserved};
+                                claimed[keyIndex] = true;
+                                list->erase(keyFound);
+                                break; // for
+                            }
+                        }
+                    }
+                }/*lock scope*/
+
+                result = true;
+                for(size_t keyIndex = 0; keyIndex < keys.size(); keyIndex++)
+                {
+                    auto& key = keys[keyIndex];
+                    bool removed = false;
+                    if(claimed[keyIndex])
+                    {
+                        DataObject obj(session.Get(), handles[keyIndex].first);
+                        removed = obj.GetAttributeValue(CKA_VALUE, key.second) == CKR_OK &&
+                                  obj.DestroyObject() == CKR_OK;
+                        if(!removed)
+                        {
+                            LOGERROR("Failed to remove key: 0x" + ToHexString(key.first));
+                            key.second.clear();
+                            RestoreHandle(destination, key.first, handles[keyIndex].first, handles[keyIndex].second);
+                        }
+                    }
+                    result &= removed;
+                } // for keys
+            }
+            else
             {
-                result &= RemoveKey(destination, key.first, key.second);
+                LOGERROR("Not in a session");
             }
             return result;
         }
 
         bool HSMStore::ReserveKey(const std::string& destination, KeyID& keyId)
+        {
+            bool result = false;
+            std::vector<KeyID> reserved;
+            if(ReserveKeys(destination, 1, reserved) == 1)
+            {
+                keyId = reserved.front();
+                result = true;
+            }
+            else
+            {
+                LOGERROR("Key not found");
+            }
+            return result;
+        }
+
+        size_t HSMStore::ReserveKeys(const std::string& destination, size_t maxKeys, std::vector<KeyID>& keyIds)
         {
             using namespace p11;
             using namespace std;
-            ObjectList found;
-            bool result = false;
+            size_t result = 0;
+            PooledSession session(*this);
 
-            if(InitSession())
+            if(session)
             {
-                AttributeList attrList {*findObjDefaults};
-                attrList.Set(CKA_LABEL, destination);
-                // use the sensitive status to denote whether it's in use
-                attrList.Set(CKA_START_DATE, zeroStartDate);
-
-                if(session->FindObjects(attrList, 1, found) == CKR_OK && !found.empty())
+                KeyHandles taken;
+                /*lock scope*/
                 {
-                    // set the object to sensitive to denote that it's in use.
-                    AttributeList updateModifiable;
-                    updateModifiable.Set(CKA_START_DATE, std::chrono::system_clock::now());
-                    result = CheckP11(found[0].SetAttributeValue(updateModifiable)) == CKR_OK;
-                    if(result)
+                    lock_guard<mutex> lock(linksLock);
+                    auto& index = Index(session, destination);
+                    // the lowest ids are used first
+                    while(taken.size() < maxKeys && !index.available.empty())
                     {
-                        result = CheckP11(found[0].GetAttributeValue(CKA_ID, keyId)) == CKR_OK;
-                        FixKeyID(keyId);
+                        auto first = index.available.begin();
+                        taken.insert(*first);
+                        index.reserved.insert(*first);
+                        index.available.erase(first);
                     }
-                }
-                else
+                }/*lock scope*/
+
+                AttributeList updateModifiable;
+                // use the start date to denote whether it's in use
+                updateModifiable.Set(CKA_START_DATE, std::chrono::system_clock::now());
+                for(const auto& key : taken)
                 {
-                    LOGERROR("Key not found");
-                }
+                    if(!storeReservations ||
+                            CheckP11(DataObject(session.Get(), key.second).SetAttributeValue(updateModifiable)) == CKR_OK)
+                    {
+                        keyIds.push_back(key.first);
+                        result++;
+                    }
+                    else
+                    {
+                        lock_guard<mutex> lock(linksLock);
+                        auto& index = Index(session, destination);
+                        index.reserved.erase(key.first);
+                        index.available.insert(key);
+                    }
+                } // for taken
             }
             else
             {
@@ -733,56 +1077,30 @@ namespace cqp
 
         void HSMStore::GetCounts(const std::string& destination, uint64_t& availableKeys, uint64_t& remainingCapacity)
         {
-            CK_TOKEN_INFO tokenInfo;
-            if(slot->GetTokenInfo(tokenInfo) == CKR_OK)
+            PooledSession session(*this);
+            if(session)
             {
-                remainingCapacity = tokenInfo.ulFreePrivateMemory;
-            }
-
-            using namespace p11;
-            using namespace std;
+                CK_TOKEN_INFO tokenInfo;
+                if(slot->GetTokenInfo(tokenInfo) == CKR_OK)
+                {
+                    remainingCapacity = tokenInfo.ulFreePrivateMemory;
+                }
 
-            ObjectList found;
-            if(InitSession())
-            {
-                // setup the search parameters
-                AttributeList attrList {*findObjDefaults};
-                attrList.Set(CKA_LABEL, destination);
-                // search for the objects
-                session->FindObjects(attrList, std::numeric_limits<unsigned long>::max(), found);
-                availableKeys = found.size();
+                std::lock_guard<std::mutex> lock(linksLock);
+                const auto& index = Index(session, destination);
+                availableKeys = index.available.size() + index.reserved.size();
             }
         }
 
         uint64_t HSMStore::GetNextKeyId(const std::string& destination)
         {
-            using namespace p11;
-            using namespace std;
-            ObjectList found;
             uint64_t result = 1;
+            PooledSession session(*this);
 
-            if(InitSession())
+            if(session)
             {
-                // setup the search parameters
-                AttributeList attrList {*findObjDefaults};
-                attrList.Set(CKA_LABEL, destination);
-                // search for the objects
-
-                if(session->FindObjects(attrList, std::numeric_limits<unsigned long>::max(), found) == CKR_OK && !found.empty())
-                {
-                    for(auto obj : found)
-                    {
-                        uint64_t nextKeyId = 0;
-                        if(obj.GetAttributeValue(CKA_ID, nextKeyId) == CKR_OK)
-                        {
-                            FixKeyID(nextKeyId);
-                            if(nextKeyId > result)
-                            {
-                                result = nextKeyId;
-                            } // if bigger
-                        } // if has id
-                    } // for found
-                } // if found
+                std::lock_guard<std::mutex> lock(linksLock);
+                result = Index(session, destination).nextId;
             }
             else
             {
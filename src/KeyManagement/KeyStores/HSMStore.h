@@ -20,6 +20,12 @@
 #include "Algorithms/Datatypes/Keys.h"                       // for KeyID, PSK (ptr only)
 #include <chrono>
 #include <set>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 namespace cqp
 {
@@ -61,6 +67,13 @@ namespace cqp
         /**
          * @brief The HSMStore class
          * Provide an IBackingStore interface to standard PPKCS#11 hardware security modules
+         * @details
+         * Calls are spread over a pool of sessions so that many threads can use the device at once,
+         * a thread is given the session it used last when it is free.
+         * The object handles for each destination are read from the device the first time the
+         * destination is used and kept up to date as keys are stored and removed, so individual keys
+         * don't need to be searched for. This assumes that no one else is changing the keys for the
+         * destination while the store is open.
          */
         class KEYMANAGEMENT_EXPORT HSMStore : public virtual IBackingStore
         {
@@ -104,6 +117,9 @@ namespace cqp
              */
             HSMStore(const URI& pkcsUrl, IPinCallback* callback = nullptr, const void* moduleLoadOptions = nullptr);
 
+            /// The most sessions which will be opened by default
+            static constexpr size_t DefaultMaxSessions = 4;
+
             /**
              * @brief SetPinCallback
              * Sets the object to called when a pin is required to log in
@@ -168,11 +184,19 @@ namespace cqp
 
             /**
              * @brief InitSession
-             * prepare the session for use
+             * prepare the token for use and log in
              * @return true on success
              */
             bool InitSession();
 
+            /**
+             * @brief SetMaxSessions
+             * Change the number of sessions which can be open at once.
+             * Threads will wait for a session if this many are in use.
+             * @param sessions The most sessions to open, at least 1
+             */
+            void SetMaxSessions(size_t sessions);
+
             /**
              * @brief DeleteAllKeys
              * Delete all objects which match the type stored by this class
@@ -220,6 +244,9 @@ namespace cqp
             /// @copydoc IBackingStore::ReserveKey
             bool ReserveKey(const std::string& destination, KeyID& keyId) override;
 
+            /// @copydoc IBackingStore::ReserveKeys
+            size_t ReserveKeys(const std::string& destination, size_t maxKeys, std::vector<KeyID>& keyIds) override;
+
             /// @copydoc IBackingStore::GetCounts
             void GetCounts(const std::string& destination, uint64_t& availableKeys, uint64_t& remainingCapacity) override;
 
@@ -228,13 +255,75 @@ namespace cqp
 
             ///@}
             ///
+        protected: // types
+            /// Defines an object on the device
+            using ObjectHandle = unsigned long;
+            /// Object handles by key id
+            using KeyHandles = std::map<KeyID, ObjectHandle>;
+
+            /// The keys on the device for one destination
+            struct LinkIndex
+            {
+                /// Keys which can be reserved
+                KeyHandles available;
+                /// Keys which have been reserved
+                KeyHandles reserved;
+                /// One more than the highest key id seen
+                KeyID nextId = 1;
+            };
+
+            /**
+             * @brief The PooledSession class
+             * Borrows a logged in session from the pool and gives it back when destroyed
+             */
+            class PooledSession
+            {
+            public:
+                /**
+                 * @brief PooledSession
+                 * Log in to the token if needed and take a session from the pool
+                 * @param store The store which owns the pool
+                 */
+                explicit PooledSession(HSMStore& store);
+
+                /// Return the session to the pool
+                ~PooledSession();
+
+                PooledSession(const PooledSession&) = delete;
+                PooledSession& operator=(const PooledSession&) = delete;
+
+                /// @return true if a session is available
+                explicit operator bool() const
+                {
+                    return session != nullptr;
+                }
+
+                /// @return The session
+                p11::Session* operator->() const
+                {
+                    return session.get();
+                }
+
+                /// @return The session
+                const std::shared_ptr<p11::Session>& Get() const
+                {
+                    return session;
+                }
+
+            protected:
+                /// The store which owns the pool
+                HSMStore& store;
+                /// The borrowed session
+                std::shared_ptr<p11::Session> session;
+                /// The value of sessionGeneration when the session was taken
+                uint64_t generation = 0;
+            };
+
         protected: // members
             /// The library used to access the HSM
             std::shared_ptr<p11::Module> module;
             /// The interface to the token
             std::shared_ptr<p11::Slot> slot;
-            /// current session
-            std::shared_ptr<p11::Session> session;
 
             /// The slot number
 			unsigned long slotId = 0;
@@ -268,6 +357,32 @@ namespace cqp
             using SessionHandle = unsigned long;
             /// Defines an event type
             using Notification = unsigned long;
+            /// If false the device cannot store the reserved state of keys so it is only held in memory
+            bool storeReservations = true;
+
+            /// Sessions which aren't in use with the thread which used them last
+            std::vector<std::pair<std::thread::id, std::shared_ptr<p11::Session>>> idleSessions;
+            /// The number of sessions which are open, including the ones in use
+            size_t openSessions = 0;
+            /// The most sessions to open at once
+            size_t maxSessions = DefaultMaxSessions;
+            /// Incremented when the token is removed so that old sessions are dropped when they are returned
+            uint64_t sessionGeneration = 0;
+            /// Protects the session pool
+            std::mutex sessionsLock;
+            /// Signalled when a session is returned to the pool
+            std::condition_variable sessionReturned;
+            /// Prevents more than one thread logging in at once
+            std::mutex loginLock;
+            /// True once the token has been logged into, the login is shared by all sessions
+            bool loggedIn = false;
+            /// Set by the session callback when the token has gone
+            std::atomic_bool tokenRemoved {false};
+
+            /// The keys for each destination
+            std::unordered_map<std::string, LinkIndex> links;
+            /// Protects links
+            std::mutex linksLock;
 
         protected: // methods
             /**
@@ -276,6 +391,66 @@ namespace cqp
              */
             bool InitSlot();
 
+            /**
+             * @brief AcquireSession
+             * Take a session from the pool, a new one is opened if there are none free, waits if
+             * the pool is at it's limit. Use PooledSession rather than calling this directly.
+             * @param[out] generation The generation of the session
+             * @return The session or null on failure
+             */
+            std::shared_ptr<p11::Session> AcquireSession(uint64_t& generation);
+
+            /**
+             * @brief ReleaseSession
+             * Give a session back to the pool
+             * @param session The session to return
+             * @param generation The generation from AcquireSession
+             */
+            void ReleaseSession(std::shared_ptr<p11::Session> session, uint64_t generation);
+
+            /**
+             * @brief Index
+             * Get the keys for a destination, reading them from the device if needed. linksLock must be held
+             * @param session A session to read the device with
+             * @param destination The paired site
+             * @return The keys for the destination
+             */
+            LinkIndex& Index(const PooledSession& session, const std::string& destination);
+
+            /**
+             * @brief TakeHandle
+             * Remove a key from the index so that no one else can use it
+             * @param session A session to read the device with
+             * @param destination The paired site
+             * @param keyId The key to take
+             * @param[out] handle The object for the key
+             * @param[out] wasReserved Whether the key had been reserved
+             * @return true if the key was found
+             */
+            bool TakeHandle(const PooledSession& session, const std::string& destination, KeyID keyId,
+                            ObjectHandle& handle, bool& wasReserved);
+
+            /**
+             * @brief FindHandle
+             * Find a key without removing it from the index
+             * @param session A session to read the device with
+             * @param destination The paired site
+             * @param keyId The key to find
+             * @param[out] handle The object for the key
+             * @return true if the key was found
+             */
+            bool FindHandle(const PooledSession& session, const std::string& destination, KeyID keyId, ObjectHandle& handle);
+
+            /**
+             * @brief RestoreHandle
+             * Put a key back into the index after failing to remove it
+             * @param destination The paired site
+             * @param keyId The key
+             * @param handle The object for the key
+             * @param reserved Whether the key was reserved
+             */
+            void RestoreHandle(const std::string& destination, KeyID keyId, ObjectHandle handle, bool reserved);
+
             /**
              * @brief SessionEventCallback
              * Receives callbacks from the pkcs11 layer
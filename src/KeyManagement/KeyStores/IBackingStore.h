@@ -72,6 +72,27 @@ namespace cqp
              */
             virtual bool ReserveKey(const std::string& destination, KeyID& keyId) = 0;
 
+            /**
+             * @brief ReserveKeys
+             * Reserve a number of keys at once, as if ReserveKey had been called for each one.
+             * Stores which can reserve many keys more efficiently should override this.
+             * @param[in] destination The far end point which these keys have been shared with
+             * @param[in] maxKeys The most keys to reserve
+             * @param[out] keyIds The ids of the reserved keys are added to this
+             * @return The number of keys reserved
+             */
+            virtual size_t ReserveKeys(const std::string& destination, size_t maxKeys, std::vector<KeyID>& keyIds)
+            {
+                size_t result = 0;
+                KeyID keyId = 0;
+                while(result < maxKeys && ReserveKey(destination, keyId))
+                {
+                    keyIds.push_back(keyId);
+                    result++;
+                }
+                return result;
+            }
+
             /**
              * @brief GetCounts
              * Returns the usage of the store
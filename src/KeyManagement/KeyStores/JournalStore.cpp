@@ -0,0 +1,521 @@
+/*!
+* @file
+* @brief JournalStore
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "JournalStore.h"
+#if defined(__unix__)
+#include <sys/mman.h>                       // for mmap
+#include <sys/stat.h>                       // for fstat
+#include <fcntl.h>                          // for open
+#include <unistd.h>                         // for ftruncate
+#include <algorithm>                        // for max
+#include <cstring>                          // for memcpy
+#include <limits>                           // for numeric_limits
+#include "Algorithms/Util/Hash.h"           // for FNV1aHash
+#include "Algorithms/Util/FileIO.h"         // for ListChildren
+#include "Algorithms/Util/SecureErase.h"    // for SecureErase
+#include "Algorithms/Logging/Logger.h"      // for LOGERROR
+
+namespace cqp
+{
+    namespace keygen
+    {
+        /// Identifies a segment file
+        static constexpr uint64_t segmentMagic = 0x314C4E524A505143ull; // "CQPJRNL1"
+        /// The header and bitmap are padded to this size so that the records are page aligned
+        static constexpr size_t pageSize = 4096;
+        /// Segment files are named prefix + id + suffix
+        static const std::string segmentPrefix = "segment-";
+        /// Segment files are named prefix + id + suffix
+        static const std::string segmentSuffix = ".journal";
+
+        /**
+         * @brief RoundUp
+         * @param value
+         * @param multiple
+         * @return value rounded up to a multiple of multiple
+         */
+        static size_t RoundUp(size_t value, size_t multiple)
+        {
+            return (value + multiple - 1) / multiple * multiple;
+        }
+
+        JournalStore::JournalStore(const std::string& directory, size_t maxKeyBytes, size_t segmentRecords) :
+            directory(directory),
+            recordSize(RoundUp(sizeof(RecordHeader) + maxKeyBytes, sizeof(uint64_t))),
+            segmentRecords(RoundUp(std::max<size_t>(segmentRecords, 1), 8)),
+            maxKeyBytes(maxKeyBytes)
+        {
+            if(!fs::IsDirectory(directory) && !fs::CreateDirectory(directory))
+            {
+                LOGERROR("Failed to create journal directory: " + directory);
+            }
+
+            // load the existing segments in order
+            std::map<uint64_t, std::string> existing;
+            for(const auto& child : fs::ListChildren(directory))
+            {
+                if(child.size() > segmentPrefix.size() + segmentSuffix.size() &&
+                        child.compare(0, segmentPrefix.size(), segmentPrefix) == 0 &&
+                        child.compare(child.size() - segmentSuffix.size(), segmentSuffix.size(), segmentSuffix) == 0)
+                {
+                    try
+                    {
+                        const auto id = std::stoull(child.substr(segmentPrefix.size(),
+                                                    child.size() - segmentPrefix.size() - segmentSuffix.size()));
+                        existing[id] = directory + fs::GetPathSep() + child;
+                    }
+                    catch(const std::exception&)
+                    {
+                        LOGWARN("Ignoring journal file: " + child);
+                    }
+                }
+            }
+
+            for(const auto& file : existing)
+            {
+                OpenSegment(file.second, file.first);
+                nextSegmentId = file.first + 1;
+            }
+
+            // keep appending to the last segment if it has room
+            std::lock_guard<std::mutex> lock(journalMutex);
+            if(!segments.empty())
+            {
+                Segment* last = segments.rbegin()->second.get();
+                if(last->header->used < last->header->numRecords &&
+                        last->header->recordSize == recordSize)
+                {
+                    active = last;
+                }
+            }
+
+            // remove any segments which are now empty
+            for(auto segIt = segments.begin(); segIt != segments.end();)
+            {
+                Segment* segment = (segIt++)->second.get();
+                if(segment->live == 0 && segment != active)
+                {
+                    ReclaimSegment(segment);
+                }
+            }
+        }
+
+        JournalStore::~JournalStore()
+        {
+            std::lock_guard<std::mutex> lock(journalMutex);
+            for(auto& segment : segments)
+            {
+                ::msync(segment.second->data, segment.second->mapSize, MS_SYNC);
+                ::munmap(segment.second->data, segment.second->mapSize);
+                ::close(segment.second->file);
+            }
+            segments.clear();
+        }
+
+        bool JournalStore::MapSegment(Segment& segment, size_t size)
+        {
+            bool result = false;
+            segment.file = ::open(segment.filename.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+            if(segment.file >= 0)
+            {
+                if(size == 0)
+                {
+                    struct stat fileStat {};
+                    if(::fstat(segment.file, &fileStat) == 0)
+                    {
+                        size = static_cast<size_t>(fileStat.st_size);
+                    }
+                }
+                else if(::ftruncate(segment.file, static_cast<off_t>(size)) != 0)
+                {
+                    size = 0;
+                }
+
+                if(size >= pageSize)
+                {
+                    void* mapped = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, segment.file, 0);
+                    if(mapped != MAP_FAILED)
+                    {
+                        segment.data = static_cast<uint8_t*>(mapped);
+                        segment.mapSize = size;
+                        segment.header = reinterpret_cast<SegmentHeader*>(segment.data);
+                        result = true;
+                    }
+                }
+
+                if(!result)
+                {
+                    ::close(segment.file);
+                    segment.file = -1;
+                }
+            }
+
+            if(!result)
+            {
+                LOGERROR("Failed to map journal segment: " + segment.filename);
+            }
+            return result;
+        }
+
+        bool JournalStore::OpenSegment(const std::string& filename, uint64_t id)
+        {
+            std::unique_ptr<Segment> segment(new Segment());
+            segment->id = id;
+            segment->filename = filename;
+
+            bool result = MapSegment(*segment, 0);
+            if(result)
+            {
+                const SegmentHeader& header = *segment->header;
+                const size_t bitmapSize = RoundUp((header.numRecords + 7) / 8, pageSize);
+                result = header.magic == segmentMagic && header.recordSize > sizeof(RecordHeader) &&
+                         header.used <= header.numRecords &&
+                         pageSize + bitmapSize + header.numRecords * header.recordSize <= segment->mapSize;
+
+                if(result)
+                {
+                    segment->tombstones = segment->data + pageSize;
+                    segment->records = segment->tombstones + bitmapSize;
+
+                    std::lock_guard<std::mutex> lock(journalMutex);
+                    for(size_t index = 0; index < header.used; index++)
+                    {
+                        if((segment->tombstones[index / 8] & (1u << (index % 8))) == 0)
+                        {
+                            const RecordHeader* record = Record(*segment, index);
+                            Link& link = links[record->link];
+                            auto existing = link.available.find(record->keyId);
+                            if(existing != link.available.end())
+                            {
+                                // the key was moved by a compaction which didn't finish
+                                Erase(existing->second);
+                            }
+                            link.available[record->keyId] = {segment.get(), index};
+                            link.nextId = std::max(link.nextId, record->keyId + 1);
+                            segment->live++;
+                        }
+                    }
+                    segments[id] = std::move(segment);
+                }
+                else
+                {
+                    LOGERROR("Invalid journal segment: " + filename);
+                    ::munmap(segment->data, segment->mapSize);
+                    ::close(segment->file);
+                }
+            }
+
+            return result;
+        }
+
+        bool JournalStore::CreateSegment()
+        {
+            std::unique_ptr<Segment> segment(new Segment());
+            segment->id = nextSegmentId++;
+            segment->filename = directory + fs::GetPathSep() + segmentPrefix + std::to_string(segment->id) + segmentSuffix;
+
+            const size_t bitmapSize = RoundUp(segmentRecords / 8, pageSize);
+            bool result = MapSegment(*segment, pageSize + bitmapSize + segmentRecords * recordSize);
+            if(result)
+            {
+                // the file is created full of zeros so only the header needs writing
+                segment->header->magic = segmentMagic;
+                segment->header->recordSize = recordSize;
+                segment->header->numRecords = segmentRecords;
+                segment->header->used = 0;
+                segment->tombstones = segment->data + pageSize;
+                segment->records = segment->tombstones + bitmapSize;
+
+                if(active)
+                {
+                    // write out the full segment in the background
+                    ::msync(active->data, active->mapSize, MS_ASYNC);
+                }
+                active = segment.get();
+                segments[segment->id] = std::move(segment);
+            }
+            return result;
+        }
+
+        bool JournalStore::Append(uint64_t link, KeyID keyId, const PSK& value, Location& location)
+        {
+            bool result = value.size() <= maxKeyBytes;
+            if(result && (active == nullptr || active->header->used >= active->header->numRecords))
+            {
+                result = CreateSegment();
+            }
+
+            if(result)
+            {
+                const size_t index = active->header->used;
+                RecordHeader* record = Record(*active, index);
+                record->link = link;
+                record->keyId = keyId;
+                record->length = value.size();
+                std::memcpy(record + 1, value.data(), value.size());
+                // the record is only valid once the count includes it
+                active->header->used = index + 1;
+                active->live++;
+
+                location = {active, index};
+            }
+
+            return result;
+        }
+
+        void JournalStore::Erase(const Location& location)
+        {
+            Segment* segment = location.segment;
+            RecordHeader* record = Record(*segment, location.index);
+            SecureErase(record + 1, static_cast<unsigned int>(segment->header->recordSize - sizeof(RecordHeader)));
+            segment->tombstones[location.index / 8] |= static_cast<uint8_t>(1u << (location.index % 8));
+            segment->live--;
+
+            if(segment->live == 0 && segment != active)
+            {
+                ReclaimSegment(segment);
+            }
+        }
+
+        bool JournalStore::Take(Link& link, KeyID keyId, PSK& output)
+        {
+            bool result = false;
+            for(KeyLocations* keys :
+                    {
+                        &link.available, &link.reserved
+                    })
+            {
+                auto keyIt = keys->find(keyId);
+                if(keyIt != keys->end())
+                {
+                    const Location location = keyIt->second;
+                    const RecordHeader* record = Record(*location.segment, location.index);
+                    const uint8_t* value = reinterpret_cast<const uint8_t*>(record + 1);
+                    output.assign(value, value + record->length);
+
+                    keys->erase(keyIt);
+                    Erase(location);
+                    result = true;
+                    break; // for
+                }
+            }
+            return result;
+        }
+
+        void JournalStore::ReclaimSegment(Segment* segment)
+        {
+            // make sure no key material is left on the disk
+            SecureErase(segment->data, static_cast<unsigned int>(segment->mapSize));
+            ::msync(segment->data, segment->mapSize, MS_SYNC);
+            ::munmap(segment->data, segment->mapSize);
+            ::close(segment->file);
+
+            if(!fs::Delete(segment->filename))
+            {
+                LOGERROR("Failed to delete journal segment: " + segment->filename);
+            }
+            if(segment == active)
+            {
+                active = nullptr;
+            }
+            segments.erase(segment->id);
+        }
+
+        void JournalStore::CompactSegment(Segment* segment)
+        {
+            bool finished = segment->live == 0;
+            for(size_t index = 0; !finished && index < segment->header->used; index++)
+            {
+                if((segment->tombstones[index / 8] & (1u << (index % 8))) == 0)
+                {
+                    const RecordHeader* record = Record(*segment, index);
+                    Link& link = links[record->link];
+                    auto keyIt = link.available.find(record->keyId);
+                    if(keyIt == link.available.end())
+                    {
+                        keyIt = link.reserved.find(record->keyId);
+                    }
+
+                    const uint8_t* value = reinterpret_cast<const uint8_t*>(record + 1);
+                    const PSK keyValue(value, value + record->length);
+                    Location moved {};
+                    // the old record is erased after the new one is written so a crash wont loose the key
+                    if(Append(record->link, record->keyId, keyValue, moved))
+                    {
+                        keyIt->second = moved;
+                        // the segment is deleted when the last key is erased
+                        finished = segment->live == 1;
+                        Erase({segment, index});
+                    }
+                    else
+                    {
+                        finished = true;
+                    }
+                }
+            }
+        }
+
+        void JournalStore::CompactLocked()
+        {
+            std::vector<Segment*> sparse;
+            for(const auto& segment : segments)
+            {
+                if(segment.second.get() != active &&
+                        segment.second->live * 100 < segment.second->header->numRecords * CompactBelowPercent)
+                {
+                    sparse.push_back(segment.second.get());
+                }
+            }
+
+            for(Segment* segment : sparse)
+            {
+                // segment is deleted once the last key is moved
+                CompactSegment(segment);
+            }
+        }
+
+        void JournalStore::Compact()
+        {
+            std::lock_guard<std::mutex> lock(journalMutex);
+            CompactLocked();
+        }
+
+        size_t JournalStore::NumSegments()
+        {
+            std::lock_guard<std::mutex> lock(journalMutex);
+            return segments.size();
+        }
+
+        bool JournalStore::StoreKeys(const std::string& destination, Keys& keys)
+        {
+            const uint64_t linkId = FNV1aHash(destination);
+            Keys notStored;
+
+            /*lock scope*/
+            {
+                std::lock_guard<std::mutex> lock(journalMutex);
+                Link& link = links[linkId];
+                const Segment* const wasActive = active;
+
+                for(auto& key : keys)
+                {
+                    Location location {};
+                    if(link.available.find(key.first) == link.available.end() &&
+                            link.reserved.find(key.first) == link.reserved.end() &&
+                            Append(linkId, key.first, key.second, location))
+                    {
+                        link.available[key.first] = location;
+                        link.nextId = std::max(link.nextId, key.first + 1);
+                    }
+                    else
+                    {
+                        notStored.push_back(std::move(key));
+                    }
+                } // for keys
+
+                if(active != wasActive)
+                {
+                    // a segment has been filled, tidy up the older ones
+                    CompactLocked();
+                }
+            }/*lock scope*/
+
+            if(!notStored.empty())
+            {
+                LOGERROR("Failed to store " + std::to_string(notStored.size()) + " keys");
+            }
+
+            keys.swap(notStored);
+            return keys.empty();
+        } // StoreKeys
+
+        bool JournalStore::RemoveKey(const std::string& destination, KeyID keyId, PSK& output)
+        {
+            const uint64_t linkId = FNV1aHash(destination);
+            bool result = false;
+
+            std::lock_guard<std::mutex> lock(journalMutex);
+            auto linkIt = links.find(linkId);
+            if(linkIt != links.end())
+            {
+                result = Take(linkIt->second, keyId, output);
+            }
+            return result;
+        } // RemoveKey
+
+        bool JournalStore::RemoveKeys(const std::string& destination, Keys& keys)
+        {
+            const uint64_t linkId = FNV1aHash(destination);
+            bool result = false;
+
+            std::lock_guard<std::mutex> lock(journalMutex);
+            auto linkIt = links.find(linkId);
+            if(linkIt != links.end())
+            {
+                result = true;
+                for(auto& key : keys)
+                {
+                    result &= Take(linkIt->second, key.first, key.second);
+                }
+            }
+            return result;
+        } // RemoveKeys
+
+        bool JournalStore::ReserveKey(const std::string& destination, KeyID& keyId)
+        {
+            const uint64_t linkId = FNV1aHash(destination);
+            bool result = false;
+
+            std::lock_guard<std::mutex> lock(journalMutex);
+            auto linkIt = links.find(linkId);
+            if(linkIt != links.end() && !linkIt->second.available.empty())
+            {
+                Link& link = linkIt->second;
+                auto keyIt = link.available.begin();
+                keyId = keyIt->first;
+                link.reserved.insert(*keyIt);
+                link.available.erase(keyIt);
+                result = true;
+            }
+            return result;
+        } // ReserveKey
+
+        void JournalStore::GetCounts(const std::string& destination, uint64_t& availableKeys, uint64_t& remainingCapacity)
+        {
+            const uint64_t linkId = FNV1aHash(destination);
+            // no storage restrictions
+            remainingCapacity = std::numeric_limits<uint64_t>::max();
+            availableKeys = 0;
+
+            std::lock_guard<std::mutex> lock(journalMutex);
+            auto linkIt = links.find(linkId);
+            if(linkIt != links.end())
+            {
+                availableKeys = linkIt->second.available.size() + linkIt->second.reserved.size();
+            }
+        }
+
+        uint64_t JournalStore::GetNextKeyId(const std::string& destination)
+        {
+            const uint64_t linkId = FNV1aHash(destination);
+            uint64_t result = 1;
+
+            std::lock_guard<std::mutex> lock(journalMutex);
+            auto linkIt = links.find(linkId);
+            if(linkIt != links.end())
+            {
+                result = linkIt->second.nextId;
+            }
+            return result;
+        }
+    } // namespace keygen
+} // namespace cqp
+#endif // unix
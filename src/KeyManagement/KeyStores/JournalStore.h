@@ -0,0 +1,277 @@
+/*!
+* @file
+* @brief JournalStore
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#pragma once
+#if defined(__unix__)
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "Algorithms/Datatypes/Keys.h"
+#include "KeyManagement/KeyStores/IBackingStore.h"
+#include "KeyManagement/keymanagement_export.h"
+
+namespace cqp
+{
+    namespace keygen
+    {
+
+        /**
+         * @brief The JournalStore class
+         * Stores keys in fixed size records appended to memory mapped segment files.
+         * @details
+         * Each segment file in the directory has a header, a bitmap of removed records and the records.
+         * Removed keys are overwritten in place and marked in the bitmap, segments which have few keys
+         * left are compacted by moving the keys to the newest segment. Empty segments are overwritten
+         * before being deleted.
+         * An index of the keys is kept in memory and rebuilt from the segments when the store is opened.
+         * Reservations are not stored.
+         */
+        class KEYMANAGEMENT_EXPORT JournalStore : public virtual IBackingStore
+        {
+        public:
+            /// The largest key which can be stored by default
+            static constexpr size_t DefaultKeyBytes = 32;
+            /// The number of records in each segment by default
+            static constexpr size_t DefaultSegmentRecords = 1u << 16;
+            /// Segments with less than this percentage of their records in use are compacted
+            static constexpr size_t CompactBelowPercent = 25;
+
+            /**
+             * @brief JournalStore
+             * Constructor
+             * @param directory Where to store the segment files, it will be created if needed
+             * @param maxKeyBytes The largest key which can be stored
+             * @param segmentRecords The number of records in each new segment
+             */
+            explicit JournalStore(const std::string& directory, size_t maxKeyBytes = DefaultKeyBytes,
+                                  size_t segmentRecords = DefaultSegmentRecords);
+
+            /// Destructor
+            ~JournalStore() override;
+
+            /// @{
+            ///@name  IBackingStore interface
+
+            /// @copydoc IBackingStore::StoreKeys
+            bool StoreKeys(const std::string& destination, Keys& keys) override;
+
+            /// @copydoc IBackingStore::RemoveKey
+            bool RemoveKey(const std::string& destination, KeyID keyId, PSK& output) override;
+
+            /// @copydoc IBackingStore::RemoveKeys
+            bool RemoveKeys(const std::string& destination, Keys& keys) override;
+
+            /// @copydoc IBackingStore::ReserveKey
+            bool ReserveKey(const std::string& destination, KeyID& keyId) override;
+
+            /// @copydoc IBackingStore::GetCounts
+            void GetCounts(const std::string& destination, uint64_t& availableKeys, uint64_t& remainingCapacity) override;
+
+            /// @copydoc IBackingStore::GetNextKeyId
+            uint64_t GetNextKeyId(const std::string& destination) override;
+            ///@}
+
+            /**
+             * @brief Compact
+             * Move the keys out of segments which are mostly empty and delete them.
+             * This is done automatically each time a new segment is started.
+             */
+            void Compact();
+
+            /**
+             * @brief NumSegments
+             * @return The number of segment files in use
+             */
+            size_t NumSegments();
+
+        protected: // types
+
+            /// Stored at the start of each segment file
+            struct SegmentHeader
+            {
+                /// Identifies the file type
+                uint64_t magic;
+                /// The size of each record in bytes
+                uint64_t recordSize;
+                /// The number of records the segment can hold
+                uint64_t numRecords;
+                /// The number of records which have been written
+                uint64_t used;
+            };
+
+            /// Stored at the start of each record, followed by the key value
+            struct RecordHeader
+            {
+                /// The hash of the destination
+                uint64_t link;
+                /// The id of the key
+                uint64_t keyId;
+                /// The number of bytes in the key value
+                uint64_t length;
+            };
+
+            /// A mapped segment file
+            struct Segment
+            {
+                /// The order of the segment
+                uint64_t id = 0;
+                /// Full path to the file
+                std::string filename;
+                /// The open file
+                int file = -1;
+                /// The whole file mapped into memory
+                uint8_t* data = nullptr;
+                /// The number of bytes mapped
+                size_t mapSize = 0;
+                /// The segment details, points into data
+                SegmentHeader* header = nullptr;
+                /// One bit for each record, set if the record has been removed, points into data
+                uint8_t* tombstones = nullptr;
+                /// The start of the first record, points into data
+                uint8_t* records = nullptr;
+                /// The number of records which haven't been removed
+                size_t live = 0;
+            };
+
+            /// Where a key is stored
+            struct Location
+            {
+                /// The segment holding the record
+                Segment* segment;
+                /// The record number within the segment
+                size_t index;
+            };
+
+            /// Maps key ids to where they are stored
+            using KeyLocations = std::map<KeyID, Location>;
+
+            /// The keys for one destination
+            struct Link
+            {
+                /// Keys which can be reserved
+                KeyLocations available;
+                /// Keys which have been reserved
+                KeyLocations reserved;
+                /// One more than the highest id seen
+                KeyID nextId = 1;
+            };
+
+        protected: // methods
+
+            /**
+             * @brief OpenSegment
+             * Map an existing segment file and add it's keys to the index
+             * @param filename The file to open
+             * @param id The order of the segment
+             * @return true on success
+             */
+            bool OpenSegment(const std::string& filename, uint64_t id);
+
+            /**
+             * @brief CreateSegment
+             * Create a new segment file and make it the active segment
+             * @return true on success
+             */
+            bool CreateSegment();
+
+            /**
+             * @brief MapSegment
+             * Open and map a segment file
+             * @param segment The segment to map, the filename must be set
+             * @param size The size of the file, 0 to use the existing size
+             * @return true on success
+             */
+            static bool MapSegment(Segment& segment, size_t size);
+
+            /**
+             * @brief Record
+             * @param segment The segment to look in
+             * @param index The record number
+             * @return The start of the record
+             */
+            static RecordHeader* Record(const Segment& segment, size_t index)
+            {
+                return reinterpret_cast<RecordHeader*>(segment.records + index * segment.header->recordSize);
+            }
+
+            /**
+             * @brief Append
+             * Write a key to the active segment, journalMutex must be held
+             * @param link The hash of the destination
+             * @param keyId The id of the key
+             * @param value The key value
+             * @param[out] location Where the key was written
+             * @return true on success
+             */
+            bool Append(uint64_t link, KeyID keyId, const PSK& value, Location& location);
+
+            /**
+             * @brief Erase
+             * Overwrite a record and mark it as removed, journalMutex must be held
+             * @param location The record to remove
+             */
+            void Erase(const Location& location);
+
+            /**
+             * @brief Take
+             * Read and erase a key, journalMutex must be held
+             * @param link The keys for the destination
+             * @param keyId The key to remove
+             * @param[out] output The key value
+             * @return true if the key was found
+             */
+            bool Take(Link& link, KeyID keyId, PSK& output);
+
+            /**
+             * @brief CompactSegment
+             * Move the keys out of a segment and delete it, journalMutex must be held
+             * @param segment The segment to empty
+             */
+            void CompactSegment(Segment* segment);
+
+            /**
+             * @brief ReclaimSegment
+             * Overwrite and delete an empty segment, journalMutex must be held
+             * @param segment The segment to delete
+             */
+            void ReclaimSegment(Segment* segment);
+
+            /**
+             * @brief CompactLocked
+             * Compact any segments which are mostly empty, journalMutex must be held
+             */
+            void CompactLocked();
+
+        protected: // members
+            /// Where the segment files are stored
+            const std::string directory;
+            /// The size of records in new segments
+            const size_t recordSize;
+            /// The number of records in new segments
+            const size_t segmentRecords;
+            /// The largest key which can be stored
+            const size_t maxKeyBytes;
+            /// All open segments by id
+            std::map<uint64_t, std::unique_ptr<Segment>> segments;
+            /// The segment which new keys are written to
+            Segment* active = nullptr;
+            /// The id for the next segment
+            uint64_t nextSegmentId = 1;
+            /// The index of the keys for each destination by link id
+            std::unordered_map<uint64_t, Link> links;
+            /// Protects access to the segments and index
+            std::mutex journalMutex;
+        };
+    } // namespace keygen
+} // namespace cqp
+#endif // unix
@@ -0,0 +1,307 @@
+/*!
+* @file
+* @brief KeyPool
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "KeyPool.h"
+
+namespace cqp
+{
+    namespace keygen
+    {
+
+        KeyPool::KeyPool(size_t numShards) :
+            mask{RoundUpPowerOf2(numShards) - 1},
+            shards{new Shard[mask + 1]}
+        {
+        }
+
+        KeyPool::Placed KeyPool::Add(KeyID id, const PSK& value, bool full)
+        {
+            Placed result = Placed::NotPlaced;
+            auto& shard = ShardFor(id);
+
+            /*lock scope*/
+            {
+                std::lock_guard<std::mutex> lock(shard.lock);
+                auto reservedIt = shard.reserved.find(id);
+                if(reservedIt != shard.reserved.end())
+                {
+                    // key has already been marked as reserved
+                    reservedIt->second = value;
+                    result = Placed::Reserved;
+                }
+                else if(shard.unused.find(id) != shard.unused.end())
+                {
+                    result = Placed::Duplicate;
+                }
+                else if(!full)
+                {
+                    shard.unused.emplace(id, value);
+                    numUnused++;
+                    result = Placed::Unused;
+                }
+            }/*lock scope*/
+
+            return result;
+        }
+
+        bool KeyPool::ReserveAny(KeyID& id)
+        {
+            bool result = false;
+            const size_t first = nextShard.fetch_add(1, std::memory_order_relaxed);
+
+            for(size_t offset = 0; !result && offset <= mask && NumUnused() > 0; offset++)
+            {
+                auto& shard = shards[(first + offset) & mask];
+                std::lock_guard<std::mutex> lock(shard.lock);
+                if(!shard.unused.empty())
+                {
+                    auto keyFound = shard.unused.begin();
+                    id = keyFound->first;
+                    shard.reserved[id] = std::move(keyFound->second);
+                    shard.unused.erase(keyFound);
+                    numUnused--;
+                    numReserved++;
+                    result = true;
+                }
+            }
+
+            return result;
+        }
+
+        size_t KeyPool::ReserveMany(size_t maxKeys, std::vector<KeyID>& ids)
+        {
+            size_t count = 0;
+            bool progress = true;
+
+            while(progress && count < maxKeys && NumUnused() > 0)
+            {
+                // find the lowest unused id
+                bool found = false;
+                KeyID lowest = 0;
+                for(size_t index = 0; index <= mask; index++)
+                {
+                    auto& shard = shards[index];
+                    std::lock_guard<std::mutex> lock(shard.lock);
+                    if(!shard.unused.empty() && (!found || shard.unused.begin()->first < lowest))
+                    {
+                        lowest = shard.unused.begin()->first;
+                        found = true;
+                    }
+                }
+
+                // take the run of consecutive ids which starts there
+                progress = false;
+                for(KeyID id = lowest; found && count < maxKeys && Reserve(id); id++)
+                {
+                    ids.push_back(id);
+                    count++;
+                    progress = true;
+                }
+            }
+
+            return count;
+        }
+
+        bool KeyPool::Reserve(KeyID id)
+        {
+            bool result = false;
+            auto& shard = ShardFor(id);
+            std::lock_guard<std::mutex> lock(shard.lock);
+
+            auto keyFound = shard.unused.find(id);
+            if(keyFound != shard.unused.end())
+            {
+                shard.reserved[id] = std::move(keyFound->second);
+                shard.unused.erase(keyFound);
+                numUnused--;
+                numReserved++;
+                result = true;
+            }
+
+            return result;
+        }
+
+        KeyPool::Claimed KeyPool::Claim(KeyID id)
+        {
+            Claimed result = Claimed::AlreadyReserved;
+            auto& shard = ShardFor(id);
+            std::lock_guard<std::mutex> lock(shard.lock);
+
+            if(shard.reserved.find(id) == shard.reserved.end())
+            {
+                auto keyFound = shard.unused.find(id);
+                if(keyFound != shard.unused.end())
+                {
+                    shard.reserved[id] = std::move(keyFound->second);
+                    shard.unused.erase(keyFound);
+                    numUnused--;
+                    result = Claimed::Reserved;
+                }
+                else
+                {
+                    // make sure the key isn't used elsewhere when it arrives
+                    shard.reserved[id] = PSK();
+                    result = Claimed::Placeholder;
+                }
+                numReserved++;
+            }
+
+            return result;
+        }
+
+        bool KeyPool::IsReserved(KeyID id) const
+        {
+            auto& shard = ShardFor(id);
+            std::lock_guard<std::mutex> lock(shard.lock);
+            return shard.reserved.find(id) != shard.reserved.end();
+        }
+
+        bool KeyPool::IsUnused(KeyID id) const
+        {
+            auto& shard = ShardFor(id);
+            std::lock_guard<std::mutex> lock(shard.lock);
+            return shard.unused.find(id) != shard.unused.end();
+        }
+
+        bool KeyPool::StoreReserved(KeyID id, const PSK& value)
+        {
+            bool result = false;
+            auto& shard = ShardFor(id);
+
+            /*lock scope*/
+            {
+                std::lock_guard<std::mutex> lock(shard.lock);
+                if(shard.unused.find(id) == shard.unused.end())
+                {
+                    if(shard.reserved.find(id) == shard.reserved.end())
+                    {
+                        numReserved++;
+                    }
+                    shard.reserved[id] = value;
+                    result = true;
+                }
+            }/*lock scope*/
+
+            if(result && !value.empty())
+            {
+                Notify();
+            }
+            return result;
+        }
+
+        bool KeyPool::TakeReserved(KeyID id, PSK& value)
+        {
+            bool result = false;
+            auto& shard = ShardFor(id);
+            std::lock_guard<std::mutex> lock(shard.lock);
+
+            auto keyFound = shard.reserved.find(id);
+            // an empty value is a placeholder for a key which hasn't arrived
+            if(keyFound != shard.reserved.end() && !keyFound->second.empty())
+            {
+                value = std::move(keyFound->second);
+                shard.reserved.erase(keyFound);
+                numReserved--;
+                result = true;
+            }
+
+            return result;
+        }
+
+        bool KeyPool::Take(KeyID id, PSK& value)
+        {
+            bool result = false;
+            auto& shard = ShardFor(id);
+            std::lock_guard<std::mutex> lock(shard.lock);
+
+            auto keyFound = shard.unused.find(id);
+            if(keyFound != shard.unused.end())
+            {
+                value = std::move(keyFound->second);
+                shard.unused.erase(keyFound);
+                numUnused--;
+                result = true;
+            }
+            else
+            {
+                keyFound = shard.reserved.find(id);
+                if(keyFound != shard.reserved.end() && !keyFound->second.empty())
+                {
+                    value = std::move(keyFound->second);
+                    shard.reserved.erase(keyFound);
+                    numReserved--;
+                    result = true;
+                }
+            }
+
+            return result;
+        }
+
+        void KeyPool::Release(KeyID id)
+        {
+            auto& shard = ShardFor(id);
+            std::lock_guard<std::mutex> lock(shard.lock);
+            if(shard.reserved.erase(id) > 0)
+            {
+                numReserved--;
+            }
+        }
+
+        bool KeyPool::Unreserve(KeyID id)
+        {
+            bool result = false;
+            auto& shard = ShardFor(id);
+            std::lock_guard<std::mutex> lock(shard.lock);
+
+            auto keyFound = shard.reserved.find(id);
+            if(keyFound != shard.reserved.end())
+            {
+                if(!keyFound->second.empty())
+                {
+                    shard.unused[id] = std::move(keyFound->second);
+                    numUnused++;
+                    result = true;
+                }
+                shard.reserved.erase(keyFound);
+                numReserved--;
+            }
+
+            return result;
+        }
+
+        void KeyPool::Drain(IBackingStore::Keys& keys)
+        {
+            for(size_t index = 0; index <= mask; index++)
+            {
+                auto& shard = shards[index];
+                std::lock_guard<std::mutex> lock(shard.lock);
+
+                for(auto& key : shard.unused)
+                {
+                    keys.emplace_back(key.first, std::move(key.second));
+                }
+                for(auto& key : shard.reserved)
+                {
+                    if(!key.second.empty())
+                    {
+                        keys.emplace_back(key.first, std::move(key.second));
+                    }
+                }
+
+                numUnused -= shard.unused.size();
+                numReserved -= shard.reserved.size();
+                shard.unused.clear();
+                shard.reserved.clear();
+            }
+        }
+
+    } // namespace keygen
+} // namespace cqp
@@ -0,0 +1,265 @@
+/*!
+* @file
+* @brief KeyPool
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#pragma once
+#include "Algorithms/Datatypes/Keys.h"
+#include "Algorithms/Datatypes/LockFreeQueue.h"
+#include "KeyManagement/KeyStores/IBackingStore.h"
+#include "KeyManagement/keymanagement_export.h"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace cqp
+{
+    namespace keygen
+    {
+
+        /**
+         * @brief The KeyPool class
+         * Holds the unused and reserved keys for a KeyStore.
+         * The keys are split between shards by their id, each with it's own lock, so that keys can be
+         * added and taken by many threads at once without waiting on each other.
+         * A reserved key with an empty value is a placeholder for a key which hasn't arrived yet.
+         * All methods are thread safe.
+         */
+        class KEYMANAGEMENT_EXPORT KeyPool
+        {
+        public:
+            /// The number of shards used by default
+            static constexpr size_t DefaultShards = 16;
+
+            /// Where a key ended up after Add
+            enum class Placed
+            {
+                /// The key filled a reservation
+                Reserved,
+                /// The key is available for use
+                Unused,
+                /// A key with the same id is already available, the key was dropped
+                Duplicate,
+                /// The key was not stored as the caller said the pool was full
+                NotPlaced
+            };
+
+            /// The result of Claim
+            enum class Claimed
+            {
+                /// The key was already reserved
+                AlreadyReserved,
+                /// The key was unused and is now reserved
+                Reserved,
+                /// The key hasn't arrived, a placeholder has been reserved for it
+                Placeholder
+            };
+
+            /**
+             * @brief KeyPool
+             * Constructor
+             * @param numShards The number of shards, rounded up to a power of 2
+             */
+            explicit KeyPool(size_t numShards = DefaultShards);
+
+            /**
+             * @brief Add
+             * Store a new key
+             * @param id The key id
+             * @param value The key value
+             * @param full If true the key will only be stored if it has been reserved
+             * @return where the key was stored
+             */
+            Placed Add(KeyID id, const PSK& value, bool full);
+
+            /**
+             * @brief ReserveAny
+             * Move an unused key into the reserved list
+             * @param[out] id The id of the reserved key
+             * @return true if a key was reserved
+             */
+            bool ReserveAny(KeyID& id);
+
+            /**
+             * @brief ReserveMany
+             * Move up to maxKeys unused keys into the reserved list, the lowest ids are taken first
+             * so that the ids form runs
+             * @param maxKeys The most keys to reserve
+             * @param[out] ids The ids of the reserved keys are added to this in ascending order
+             * @return The number of keys reserved
+             */
+            size_t ReserveMany(size_t maxKeys, std::vector<KeyID>& ids);
+
+            /**
+             * @brief Reserve
+             * Move a specific key from the unused list into the reserved list
+             * @param id The key to reserve
+             * @return true if the key was unused and is now reserved
+             */
+            bool Reserve(KeyID id);
+
+            /**
+             * @brief Claim
+             * Reserve a specific key, or a placeholder for it if it hasn't arrived
+             * @param id The key to reserve
+             * @return What was reserved
+             */
+            Claimed Claim(KeyID id);
+
+            /**
+             * @brief IsReserved
+             * @param id The key to find
+             * @return true if the key, or a placeholder for it, is reserved
+             */
+            bool IsReserved(KeyID id) const;
+
+            /**
+             * @brief IsUnused
+             * @param id The key to find
+             * @return true if the key is available
+             */
+            bool IsUnused(KeyID id) const;
+
+            /**
+             * @brief StoreReserved
+             * Put a key in the reserved list, replacing any existing reservation
+             * @param id The key id
+             * @param value The key value, empty for a placeholder
+             * @return false if the key is in the unused list
+             */
+            bool StoreReserved(KeyID id, const PSK& value);
+
+            /**
+             * @brief TakeReserved
+             * Remove a reserved key which has arrived
+             * @param id The key to remove
+             * @param[out] value The key value
+             * @return true if the key was reserved and it's value has arrived
+             */
+            bool TakeReserved(KeyID id, PSK& value);
+
+            /**
+             * @brief Take
+             * Remove a key whether it is reserved or not
+             * @param id The key to remove
+             * @param[out] value The key value
+             * @return true if the key was found
+             */
+            bool Take(KeyID id, PSK& value);
+
+            /**
+             * @brief Release
+             * Remove a reservation without taking the key
+             * @param id The key to release
+             */
+            void Release(KeyID id);
+
+            /**
+             * @brief Unreserve
+             * Move a reserved key back to the unused list, a placeholder is removed
+             * @param id The key to unreserve
+             * @return true if the key is now unused
+             */
+            bool Unreserve(KeyID id);
+
+            /**
+             * @brief Drain
+             * Remove all keys, placeholders are dropped
+             * @param[out] keys The keys which were removed are added to this
+             */
+            void Drain(IBackingStore::Keys& keys);
+
+            /**
+             * @brief NumUnused
+             * @return The number of keys available
+             */
+            size_t NumUnused() const
+            {
+                return numUnused.load(std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief NumReserved
+             * @return The number of reserved keys, including placeholders
+             */
+            size_t NumReserved() const
+            {
+                return numReserved.load(std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief WaitFor
+             * Wait until ready returns true, it is checked each time the pool changes
+             * @param timeout How long to wait
+             * @param ready Checks the pool
+             * @return The result of ready
+             */
+            template<typename Predicate>
+            bool WaitFor(const std::chrono::microseconds& timeout, Predicate ready)
+            {
+                return changed.WaitFor(timeout, ready);
+            }
+
+            /**
+             * @brief Notify
+             * Wake any threads in WaitFor, call after adding keys
+             */
+            void Notify()
+            {
+                changed.Notify();
+            }
+
+        protected: // types
+            /// Maps key ids to the key data
+            using KeyMap = std::map<KeyID, PSK>;
+
+            /// A subset of the keys
+            struct Shard
+            {
+                /// Protects the maps
+                mutable std::mutex lock;
+                /// Keys which are available
+                KeyMap unused;
+                /// Keys which can only be retrieved by id
+                KeyMap reserved;
+                /// Keep shards on separate cache lines
+                char padding[cacheLineSize];
+            };
+
+        protected: // methods
+
+            /**
+             * @brief ShardFor
+             * @param id A key id
+             * @return The shard which holds the key
+             */
+            Shard& ShardFor(KeyID id) const
+            {
+                return shards[id & mask];
+            }
+
+        protected: // members
+            /// numShards - 1
+            const size_t mask;
+            /// The keys
+            std::unique_ptr<Shard[]> shards;
+            /// The shard to look in first for ReserveAny, spreads threads between shards
+            std::atomic<size_t> nextShard {0};
+            /// The number of keys available
+            std::atomic<size_t> numUnused {0};
+            /// The number of keys reserved
+            std::atomic<size_t> numReserved {0};
+            /// Wakes threads waiting for keys
+            QueueSignal changed;
+        };
+
+    } // namespace keygen
+} // namespace cqp
@@ -14,6 +14,7 @@
 #include "CQPToolkit/KeyGen/Stats.h"
 #include "KeyManagement/KeyStores/KeyStoreFactory.h"
 #include <numeric>
+#include <algorithm>
 #include <thread>
 #include "Algorithms/Util/Hash.h"
 #include "Algorithms/Net/DNS.h"
@@ -27,6 +28,53 @@ namespace cqp
         using google::protobuf::Empty;
         using grpc::ClientContext;
 
+        /// The most keys which will be accepted in one lease message
+        static constexpr size_t maxLeaseKeys = 1u << 20;
+
+        constexpr size_t KeyStore::minLeaseSize;
+
+        /**
+         * @brief ToRanges
+         * Store key ids as runs of consecutive ids
+         * @param ids The ids in ascending order
+         * @param[out] ranges destination
+         */
+        static void ToRanges(const std::vector<KeyID>& ids, remote::KeyRanges& ranges)
+        {
+            for(size_t index = 0; index < ids.size();)
+            {
+                size_t count = 1;
+                while(index + count < ids.size() && ids[index + count] == ids[index] + count)
+                {
+                    count++;
+                }
+                ranges.add_first(ids[index]);
+                ranges.add_count(count);
+                index += count;
+            }
+        }
+
+        /**
+         * @brief FromRanges
+         * Expand runs of consecutive ids
+         * @param ranges The runs of ids
+         * @param[out] ids The ids are added to this
+         * @return false if the ranges are malformed or too large
+         */
+        static bool FromRanges(const remote::KeyRanges& ranges, std::vector<KeyID>& ids)
+        {
+            bool result = ranges.first_size() == ranges.count_size();
+            for(int index = 0; result && index < ranges.first_size(); index++)
+            {
+                result = ranges.count(index) <= maxLeaseKeys - ids.size();
+                for(uint64_t offset = 0; result && offset < ranges.count(index); offset++)
+                {
+                    ids.push_back(ranges.first(index) + offset);
+                }
+            }
+            return result;
+        }
+
         KeyStore::KeyStore(const std::string& thisSiteAddress, std::shared_ptr<grpc::ChannelCredentials> creds, const std::string& destination,
                            KeyStoreFactory* ksf, std::shared_ptr<IBackingStore> bs, uint64_t cacheLimit) :
             mySiteFrom(thisSiteAddress),
@@ -48,18 +96,33 @@ namespace cqp
             {
                 // create a connection to the other site agent
                 partnerFactory = remote::IKeyFactory::NewStub(channel);
+                partnerLease = remote::IKeyLease::NewStub(channel);
             }
             else
             {
                 LOGERROR("Failed to connect to other site agent");
             }
+
+            leaseTimer = std::thread(&KeyStore::LeaseTimer, this);
         }
 
         KeyStore::~KeyStore()
         {
+            // the keys would otherwise be dropped by the peer once the lease expires
+            ReturnLease();
+            /*lock scope*/
+            {
+                std::lock_guard<std::mutex> lock(heldLeaseLock);
+                shutdown = true;
+            }/*lock scope*/
+            leaseTimerCv.notify_all();
+            if(leaseTimer.joinable())
+            {
+                leaseTimer.join();
+            }
+
             FlushCache();
-            shutdown = true;
-            allKeys_cv.notify_all();
+            keys.Notify();
 
         } // KeyStore
 
@@ -68,25 +131,14 @@ namespace cqp
             LOGTRACE("ID:" + std::to_string(identity));
             grpc::Status result = Status(StatusCode::NOT_FOUND, "No key found within timeout.");
 
-            std::unique_lock<std::mutex> lock(allKeys_lock);
-            bool waitResult = allKeys_cv.wait_for(lock, waitTimeout, [&]
+            bool waitResult = keys.WaitFor(waitTimeout, [&]
             {
                 bool result = shutdown;
                 if(!shutdown)
                 {
-                    auto internal = reservedKeys.find(identity);
-
-                    if(internal != reservedKeys.end())
-                    {
-                        output = internal->second;
-                        reservedKeys.erase(internal);
-                        result = true;
-                    }
-                    else if(backingStore != nullptr)
-                    {
-                        // try the backing store
-                        result = backingStore->RemoveKey(mySiteTo, identity, output);
-                    }
+                    // a placeholder will be filled when the key arrives
+                    result = keys.TakeReserved(identity, output) ||
+                    (backingStore != nullptr && backingStore->RemoveKey(mySiteTo, identity, output));
                 }
                 return result;
             });
@@ -102,11 +154,18 @@ namespace cqp
         bool KeyStore::GetNewKey(KeyID& identity, PSK& output, bool waitForKey)
         {
             LOGTRACE("");
+            bool hasPath = false;
+            /*lock scope*/
+            {
+                std::lock_guard<std::mutex> lock(pathLock);
+                hasPath = !myPath.empty();
+            }/*lock scope*/
+
             // see if we've already got some key
             // if there's no path, wait until key arrives
-            bool result = GetNewDirectKey(identity, output, myPath.empty() && waitForKey);
+            bool result = GetNewDirectKey(identity, output, !hasPath && waitForKey);
 
-            if(!result && !myPath.empty())
+            if(!result && hasPath)
             {
                 // no locally defined keys
                 // build key from path
@@ -116,25 +175,42 @@ namespace cqp
             return result;
         }
 
-        bool KeyStore::ReserveNewKey(std::unique_lock<std::mutex>&, KeyID& keyID)
+        bool KeyStore::ReserveNewKey(KeyID& keyID)
         {
             LOGTRACE("");
-            bool result = !unusedKeys.empty();
-            if(result)
+            bool result = keys.ReserveAny(keyID);
+            if(!result && backingStore != nullptr)
             {
-                KeyMap::iterator keyFound = unusedKeys.begin();
-                keyID = keyFound->first;
-                reservedKeys[keyFound->first] = keyFound->second;
+                // refill the pool from the backing store so that the following requests don't have to
+                std::vector<KeyID> ids;
+                IBackingStore::Keys fetched;
+                const size_t batch = std::max<size_t>(1, std::min<uint64_t>(backingStoreBatch, cacheThreashold));
 
-                // remove the key from the list
-                unusedKeys.erase(keyFound);
-            }
-            else if(backingStore != nullptr)
-            {
-                result = backingStore->ReserveKey(mySiteTo, keyID);
-                if(result)
+                backingStore->ReserveKeys(mySiteTo, batch, ids);
+                for(const auto id : ids)
                 {
-                    result = backingStore->RemoveKey(mySiteTo, keyID, reservedKeys[keyID]);
+                    fetched.emplace_back(id, PSK());
+                }
+                if(!fetched.empty())
+                {
+                    backingStore->RemoveKeys(mySiteTo, fetched);
+                }
+
+                for(const auto& key : fetched)
+                {
+                    if(key.second.empty())
+                    {
+                        LOGERROR("Reserved key missing from backing store:" + std::to_string(key.first));
+                    }
+                    else if(!result && keys.StoreReserved(key.first, key.second))
+                    {
+                        keyID = key.first;
+                        result = true;
+                    }
+                    else
+                    {
+                        keys.Add(key.first, key.second, false);
+                    }
                 }
             }
             return result;
@@ -146,21 +222,8 @@ namespace cqp
             {
                 IBackingStore::Keys backingStoreKeys;
 
-                /*lock scope*/
-                {
-                    std::unique_lock<std::mutex> lock(allKeys_lock);
-
-                    // move the keys out to the backing store
-                    for(KeyMap* list :
-                            {
-                                &unusedKeys, &reservedKeys
-                            })
-                    {
-                        std::copy(list->begin(), list->end(), std::back_inserter(backingStoreKeys));
-
-                        list->clear();
-                    } // for list
-                } /*lock scope*/
+                // move the keys out to the backing store
+                keys.Drain(backingStoreKeys);
 
                 if(!backingStore->StoreKeys(mySiteTo, backingStoreKeys))
                 {
@@ -181,31 +244,31 @@ namespace cqp
                 return false;
             }
 
-            /*lock scope*/
+            if(TakeLeasedKey(identity, output))
             {
-                std::unique_lock<std::mutex> lock(allKeys_lock);
-
-                if(waitForKey)
-                {
-                    result = allKeys_cv.wait_for(lock, waitTimeout, [&]
-                    {
-                        return shutdown || ReserveNewKey(lock, keyID);
-                    });
-                }
-                else
-                {
-                    // fail immediately if there's no key available
-                    result = ReserveNewKey(lock, keyID);
-                }
+                // the other side has already reserved this key for us
+                stats.keyUsed.Update(1);
+                return true;
+            }
 
-                if(result)
+            if(waitForKey)
+            {
+                keys.WaitFor(waitTimeout, [&]
                 {
-                    stats.keyUsed.Update(1);
-                }
-            }/*lock scope*/
+                    result = !shutdown && ReserveNewKey(keyID);
+                    return shutdown || result;
+                });
+            }
+            else
+            {
+                // fail immediately if there's no key available
+                result = ReserveNewKey(keyID);
+            }
 
             if(result)
             {
+                stats.keyUsed.Update(1);
+
                 ClientContext ctx;
                 remote::KeyRequest request;
                 request.set_siteto(mySiteFrom);
@@ -221,54 +284,32 @@ namespace cqp
                     {
                         LOGDEBUG("Reserved original key " + std::to_string(keyID));
                         // our key has been reserved on the other side
-                        std::lock_guard<std::mutex> lock(allKeys_lock);
-
                         identity = keyID;
-                        output = reservedKeys[keyID];
-                        reservedKeys.erase(keyID);
-                        result = true;
+                        result = keys.TakeReserved(keyID, output);
                     } // if keyids match
                     else
                     {
-                        allKeys_cv.notify_all();
                         LOGDEBUG("Reserved alternate key " + std::to_string(response.keyid()));
                         // the key is already in use but an alternative has been supplied
+                        const KeyID alternative = response.keyid();
 
-                        std::unique_lock<std::mutex> lock(allKeys_lock);
-                        bool result = allKeys_cv.wait_for(lock, waitTimeout, [&]
+                        result = keys.WaitFor(waitTimeout, [&]
                         {
                             bool result = shutdown;
                             if(!shutdown)
                             {
-                                KeyMap::iterator keyFound = unusedKeys.find(response.keyid());
-                                KeyMap::iterator keyFoundReserved = reservedKeys.find(response.keyid());
-                                if(keyFound != unusedKeys.end())
-                                {
-                                    // The key has arrived on our side so use it.
-                                    identity = keyFound->first;
-                                    output = keyFound->second;
-                                    // remove the key from the list
-                                    unusedKeys.erase(keyFound);
-                                    result = true;
-                                }
-                                else if(keyFoundReserved != reservedKeys.end())
-                                {
-                                    // The key has arrived on our side so use it.
-                                    identity = keyFoundReserved->first;
-                                    output = keyFoundReserved->second;
-                                    // remove the key from the list
-                                    reservedKeys.erase(keyFoundReserved);
-                                    result = true;
-                                }
-                                else if(backingStore != nullptr)
-                                {
-                                    result = backingStore->RemoveKey(mySiteTo, response.keyid(), output);
-                                }
+                                // The key may have arrived on our side, reserved or not
+                                result = keys.Take(alternative, output) ||
+                                (backingStore != nullptr && backingStore->RemoveKey(mySiteTo, alternative, output));
                             }
                             return result;
-                        });
+                        }) && !shutdown;
 
-                        if(!result)
+                        if(result)
+                        {
+                            identity = alternative;
+                        }
+                        else
                         {
                             LOGERROR("Failed to find unused key. Please retry.");
                         } // else key found
@@ -292,10 +333,14 @@ namespace cqp
             remote::KeyPathRequest request;
 
             (*request.mutable_sites()->mutable_urls()->Add()) = mySiteFrom;
-            for(const auto& element : myPath)
+            /*lock scope*/
             {
-                (*request.mutable_sites()->mutable_urls()->Add()) = element;
-            }
+                std::lock_guard<std::mutex> lock(pathLock);
+                for(const auto& element : myPath)
+                {
+                    (*request.mutable_sites()->mutable_urls()->Add()) = element;
+                }
+            }/*lock scope*/
             (*request.mutable_sites()->mutable_urls()->Add()) = mySiteTo;
 
             const std::string& nextHopAddress = *(request.sites().urls().begin() + 1);
@@ -324,8 +369,8 @@ namespace cqp
 
                 stats.keyUsed.Update(1);
                 stats.keyGenerated.Update(1);
-                stats.unusedKeysAvailable.Update(unusedKeys.size());
-                stats.reservedKeys.Update(reservedKeys.size());
+                stats.unusedKeysAvailable.Update(keys.NumUnused());
+                stats.reservedKeys.Update(keys.NumReserved());
             }
 
             return result;
@@ -337,80 +382,51 @@ namespace cqp
             grpc::Status result;
             bool reserveAlternative = false;
 
-            std::unique_lock<std::mutex> lock(allKeys_lock);
-
-            auto reservedIt = reservedKeys.find(identity);
-            auto unusedIt = unusedKeys.find(identity);
-            if(reservedIt != reservedKeys.end())
+            switch(keys.Claim(identity))
+            {
+            case KeyPool::Claimed::AlreadyReserved:
             {
                 // The key has been reserved by our GetNewKey
                 // reserve an alternative if we are unlucky
                 // the other side gets to keep it
-                net::IPAddress from;
-                net::IPAddress to;
-                URI fromUri(mySiteFrom);
-                URI toUri(mySiteTo);
-
-                fromUri.ResolveAddress(from);
-                toUri.ResolveAddress(to);
-                reserveAlternative = FNV1aHash(from.ToString() + std::to_string(fromUri.GetPort())) >
-                                     FNV1aHash(to.ToString() + std::to_string(toUri.GetPort()));
+                reserveAlternative = WonLottery();
                 if(!reserveAlternative)
                 {
                     LOGTRACE("I lost the lottery");
-                    alternative = reservedIt->first;
+                    alternative = identity;
                 }
             }
-            else if(unusedIt != unusedKeys.end())
-            {
-                // good to go, reserve the key
-                reservedKeys[unusedIt->first] = unusedIt->second;
-                alternative = unusedIt->first;
-                unusedKeys.erase(unusedIt);
-            }
-            // try getting it from the backing store
-            else if(backingStore && backingStore->RemoveKey(mySiteTo, identity, reservedKeys[identity]))
-            {
-                // key was extracted from the backing store
-                alternative = identity;
-            }
-            else // if(reservedIt == reservedKeys.end())
-            {
-                // key hasn't arrived yet or it's already taken
-                // add a placeholder to make sure the key isn't used elsewhere
-                reservedKeys[identity] = PSK();
-                // wait for key to arrive
+            break;
 
-                bool keyFound = allKeys_cv.wait_for(lock, waitTimeout, [&]
-                {
-                    // now there is a placeholder in reserved, it wont be sent to the backing store
-                    reservedIt = reservedKeys.find(identity);
-                    return shutdown || reservedIt != reservedKeys.end();
-                });
+            case KeyPool::Claimed::Reserved:
+                // good to go, the key has been reserved
+                alternative = identity;
+                break;
 
-                if(keyFound)
-                {
-                    // good to go, the key has been reserved
-                    alternative = identity;
-                }
-                else
+            case KeyPool::Claimed::Placeholder:
+            {
+                // key hasn't arrived yet, the placeholder makes sure it isn't used elsewhere
+                // try getting it from the backing store
+                PSK value;
+                if(backingStore && backingStore->RemoveKey(mySiteTo, identity, value))
                 {
-                    // timeout, looks like the key was already taken
-                    reserveAlternative = true;
-                    // remove the stale reservation
-                    reservedKeys.erase(identity);
+                    // key was extracted from the backing store
+                    keys.StoreReserved(identity, value);
                 }
+                alternative = identity;
+            }
+            break;
             }
 
             if(reserveAlternative)
             {
-                bool keyFound = allKeys_cv.wait_for(lock, waitTimeout, [&]
+                bool keyFound = keys.WaitFor(waitTimeout, [&]
                 {
                     // this will move the key to the reserved list
-                    return shutdown || ReserveNewKey(lock, alternative);
+                    return shutdown || ReserveNewKey(alternative);
                 });
 
-                if(keyFound)
+                if(keyFound && !shutdown)
                 {
                     result = Status(StatusCode::OK, "Key already reserved, alternative supplied.");
                 }
@@ -425,13 +441,10 @@ namespace cqp
 
         bool KeyStore::StoreReservedKey(const KeyID& id, const PSK& keyValue)
         {
-            bool result = false;
-            std::lock_guard<std::mutex> lock(allKeys_lock);
-            if(unusedKeys.find(id) == unusedKeys.end())
+            const bool result = keys.StoreReserved(id, keyValue);
+            if(result)
             {
-                reservedKeys[id] = keyValue;
-                result = true;
-                stats.reservedKeys.Update(reservedKeys.size());
+                stats.reservedKeys.Update(keys.NumReserved());
             }
             return result;
         }
@@ -441,33 +454,26 @@ namespace cqp
             LOGTRACE(mySiteFrom + " to " + mySiteTo + " receiving " + std::to_string(keyData->size()) + " key(s)");
             IBackingStore::Keys backingStoreKeys;
 
-            /*lock scope*/
+            ReclaimExpiredLeases();
+
+            for(const PSK& key : *keyData)
             {
-                std::lock_guard<std::mutex> lock(allKeys_lock);
+                const KeyID nextId = nextKeyId.fetch_add(1);
+                const bool full = backingStore && keys.NumUnused() >= cacheThreashold;
 
-                for(PSK key : *keyData)
+                switch(keys.Add(nextId, key, full))
                 {
-                    KeyID nextId = nextKeyId.fetch_add(1);
-                    if(reservedKeys.find(nextId) != reservedKeys.end())
-                    {
-                        // key has already been marked as reserved
-                        reservedKeys[nextId] = key;
-                    }
-                    else if(unusedKeys.find(nextId) != unusedKeys.end())
-                    {
-                        LOGERROR("KeyID already in use:" + std::to_string(nextId));
-                    }
-                    else if(unusedKeys.size() >= cacheThreashold && backingStore)
-                    {
-                        backingStoreKeys.push_back({nextId, key});
-                    }
-                    else
-                    {
-                        unusedKeys[nextId] = key;
-                    }
-
-                } // for keyData
-            }/*lock scope*/
+                case KeyPool::Placed::Duplicate:
+                    LOGERROR("KeyID already in use:" + std::to_string(nextId));
+                    break;
+                case KeyPool::Placed::NotPlaced:
+                    backingStoreKeys.push_back({nextId, key});
+                    break;
+                case KeyPool::Placed::Reserved:
+                case KeyPool::Placed::Unused:
+                    break;
+                }
+            } // for keyData
 
             if(!backingStoreKeys.empty())
             {
@@ -476,12 +482,12 @@ namespace cqp
                     LOGWARN("Failed to send keys to backing store, storing locally");
                     for(const auto& key : backingStoreKeys)
                     {
-                        unusedKeys[key.first] = key.second;
+                        keys.Add(key.first, key.second, false);
                     }
                 }
             }
             // we've changed the list so notify any waiting threads
-            allKeys_cv.notify_all();
+            keys.Notify();
 
             uint64_t unusedAvailable = 0;
             if(backingStore)
@@ -489,20 +495,358 @@ namespace cqp
                 uint64_t remainingCapacity = 0;
                 backingStore->GetCounts(mySiteTo, unusedAvailable, remainingCapacity);
             }
-            unusedAvailable += unusedKeys.size();
+            unusedAvailable += keys.NumUnused();
             // publish some stats
             stats.keyGenerated.Update(keyData->size());
             stats.unusedKeysAvailable.Update(unusedAvailable);
-            stats.reservedKeys.Update(reservedKeys.size());
+            stats.reservedKeys.Update(keys.NumReserved());
+        }
+
+        bool KeyStore::WonLottery()
+        {
+            // resolving the addresses is slow so only do it once
+            std::call_once(lotteryDrawn, [&]
+            {
+                net::IPAddress from;
+                net::IPAddress to;
+                URI fromUri(mySiteFrom);
+                URI toUri(mySiteTo);
+
+                fromUri.ResolveAddress(from);
+                toUri.ResolveAddress(to);
+                lotteryWon = FNV1aHash(from.ToString() + std::to_string(fromUri.GetPort())) >
+                             FNV1aHash(to.ToString() + std::to_string(toUri.GetPort()));
+            });
+
+            return lotteryWon;
+        }
+
+        bool KeyStore::TakeLeasedKey(KeyID& identity, PSK& output)
+        {
+            bool result = false;
+
+            if(leaseSize > 0 && leasingSupported && partnerLease)
+            {
+                std::unique_lock<std::mutex> lock(heldLeaseLock);
+
+                while(!result)
+                {
+                    if(heldLease.keys.empty() || std::chrono::steady_clock::now() >= heldLease.expires)
+                    {
+                        const HeldLease expired = DetachHeldLease();
+                        // leave some keys for the other side to use
+                        const size_t wanted = std::min<size_t>(std::min<size_t>(leaseSize, leaseDemand), keys.NumUnused() / 2);
+                        const auto duration = leaseDuration;
+                        HeldLease fresh;
+
+                        // other threads can use the lease while the peer is being called
+                        lock.unlock();
+                        ReturnHeldLease(expired);
+                        const bool leased = RequestLease(wanted, duration, fresh);
+                        lock.lock();
+
+                        if(!leased)
+                        {
+                            break; // while
+                        }
+
+                        if(heldLease.keys.empty())
+                        {
+                            heldLease = std::move(fresh);
+                            // start the countdown to returning the lease
+                            leaseTimerCv.notify_all();
+                        }
+                        else
+                        {
+                            // another thread got there first, keep its lease
+                            lock.unlock();
+                            ReturnHeldLease(fresh);
+                            lock.lock();
+                        }
+                        continue; // while
+                    }
+
+                    const KeyID keyID = heldLease.keys.front();
+                    heldLease.keys.pop_front();
+                    // the key will be missing if the cache has been flushed
+                    result = keys.TakeReserved(keyID, output);
+                    if(result)
+                    {
+                        identity = keyID;
+                    }
+                }
+            }
+
+            return result;
         }
 
+        bool KeyStore::RequestLease(size_t wanted, std::chrono::milliseconds duration, HeldLease& lease)
+        {
+            std::vector<KeyID> reserved;
+
+            if(wanted > 0 && keys.ReserveMany(wanted, reserved) > 0)
+            {
+                remote::LeaseRequest request;
+                request.set_siteto(mySiteFrom);
+                request.set_durationms(static_cast<uint64_t>(duration.count()));
+                ToRanges(reserved, *request.mutable_keys());
+
+                ClientContext ctx;
+                ctx.set_deadline(std::chrono::system_clock::now() + waitTimeout);
+                remote::Lease response;
+                std::vector<KeyID> granted;
+
+                Status leaseResult = partnerLease->LeaseKeys(&ctx, request, &response);
+                if(leaseResult.ok() && FromRanges(response.granted(), granted))
+                {
+                    LOGDEBUG("Leased " + std::to_string(granted.size()) + " of " + std::to_string(reserved.size()) + " keys");
+                    // any keys which weren't granted are being used by the other side,
+                    // they stay reserved so that they can be collected with GetExistingKey
+                    lease.id = response.leaseid();
+                    lease.keys.assign(granted.begin(), granted.end());
+                    lease.granted = granted.size();
+                    lease.expires = std::chrono::steady_clock::now() + duration;
+                }
+                else
+                {
+                    if(leaseResult.error_code() == StatusCode::UNIMPLEMENTED)
+                    {
+                        // the other side only understands MarkKeyInUse, stop trying
+                        LOGINFO("Key store at " + mySiteTo + " does not support key leases");
+                        leasingSupported = false;
+                    }
+                    else
+                    {
+                        LogStatus(leaseResult, "Failed to lease keys");
+                    }
+
+                    for(const auto keyID : reserved)
+                    {
+                        keys.Unreserve(keyID);
+                    }
+                    keys.Notify();
+                }
+            }
+
+            return !lease.keys.empty();
+        }
+
+        KeyStore::HeldLease KeyStore::DetachHeldLease()
+        {
+            if(heldLease.granted > 0)
+            {
+                const size_t used = heldLease.granted - heldLease.keys.size();
+                // ask for enough to last a lease period next time, more if this one ran out
+                leaseDemand = std::max(minLeaseSize, heldLease.keys.empty() ? used * 2 : used);
+            }
+
+            HeldLease result = std::move(heldLease);
+            heldLease = HeldLease();
+            return result;
+        }
+
+        void KeyStore::ReturnHeldLease(const HeldLease& lease)
+        {
+            if(!lease.keys.empty())
+            {
+                std::vector<KeyID> unused(lease.keys.begin(), lease.keys.end());
+
+                remote::LeaseReturn request;
+                request.set_siteto(mySiteFrom);
+                request.set_leaseid(lease.id);
+                ToRanges(unused, *request.mutable_unused());
+
+                ClientContext ctx;
+                ctx.set_deadline(std::chrono::system_clock::now() + waitTimeout);
+                Empty response;
+
+                const bool returned = LogStatus(partnerLease->ReturnKeys(&ctx, request, &response),
+                                                "Failed to return leased keys").ok();
+                for(const auto keyID : unused)
+                {
+                    if(returned)
+                    {
+                        keys.Unreserve(keyID);
+                    }
+                    else
+                    {
+                        // the other side may have dropped the keys, they can't be used safely
+                        keys.Release(keyID);
+                    }
+                }
+                keys.Notify();
+            }
+        }
+
+        void KeyStore::ReturnLease()
+        {
+            HeldLease lease;
+            /*lock scope*/
+            {
+                std::lock_guard<std::mutex> lock(heldLeaseLock);
+                lease = DetachHeldLease();
+            }/*lock scope*/
+            ReturnHeldLease(lease);
+        }
+
+        grpc::Status KeyStore::LeaseKeys(const remote::LeaseRequest& request, remote::Lease& response)
+        {
+            ReclaimExpiredLeases();
+
+            std::vector<KeyID> requested;
+            if(!FromRanges(request.keys(), requested))
+            {
+                return Status(StatusCode::INVALID_ARGUMENT, "Invalid key ranges");
+            }
+
+            GrantedLease lease;
+            for(const auto keyID : requested)
+            {
+                switch(keys.Claim(keyID))
+                {
+                case KeyPool::Claimed::AlreadyReserved:
+                    // we're using this key too, the other side keeps it if we lose
+                    if(!WonLottery())
+                    {
+                        lease.keys.push_back(keyID);
+                    }
+                    break;
+
+                case KeyPool::Claimed::Placeholder:
+                {
+                    PSK value;
+                    if(backingStore && backingStore->RemoveKey(mySiteTo, keyID, value))
+                    {
+                        keys.StoreReserved(keyID, value);
+                    }
+                    lease.keys.push_back(keyID);
+                }
+                break;
+
+                case KeyPool::Claimed::Reserved:
+                    lease.keys.push_back(keyID);
+                    break;
+                }
+            }
+
+            ToRanges(lease.keys, *response.mutable_granted());
+            // give the other side time to collect any keys handed out just before the lease expired
+            lease.reclaimAt = std::chrono::steady_clock::now() +
+                              std::chrono::milliseconds(request.durationms()) + waitTimeout;
+
+            /*lock scope*/
+            {
+                std::lock_guard<std::mutex> lock(grantedLeasesLock);
+                response.set_leaseid(nextLeaseId);
+                grantedLeases[nextLeaseId++] = std::move(lease);
+            }/*lock scope*/
+
+            stats.reservedKeys.Update(keys.NumReserved());
+            return Status();
+        }
+
+        grpc::Status KeyStore::ReturnLeasedKeys(const remote::LeaseReturn& request)
+        {
+            std::vector<KeyID> unused;
+            if(!FromRanges(request.unused(), unused))
+            {
+                return Status(StatusCode::INVALID_ARGUMENT, "Invalid key ranges");
+            }
+
+            GrantedLease lease;
+            /*lock scope*/
+            {
+                std::lock_guard<std::mutex> lock(grantedLeasesLock);
+                auto leaseIt = grantedLeases.find(request.leaseid());
+                if(leaseIt == grantedLeases.end())
+                {
+                    return Status(StatusCode::NOT_FOUND, "Unknown lease " + std::to_string(request.leaseid()));
+                }
+                lease = std::move(leaseIt->second);
+                grantedLeases.erase(leaseIt);
+            }/*lock scope*/
+
+            for(const auto keyID : unused)
+            {
+                // only keys which were part of the lease can be released
+                if(std::binary_search(lease.keys.begin(), lease.keys.end(), keyID))
+                {
+                    keys.Unreserve(keyID);
+                }
+            }
+            keys.Notify();
+
+            return Status();
+        }
+
+        void KeyStore::ReclaimExpiredLeases()
+        {
+            std::vector<KeyID> expired;
+            const auto now = std::chrono::steady_clock::now();
+
+            /*lock scope*/
+            {
+                std::lock_guard<std::mutex> lock(grantedLeasesLock);
+                for(auto leaseIt = grantedLeases.begin(); leaseIt != grantedLeases.end();)
+                {
+                    if(leaseIt->second.reclaimAt <= now)
+                    {
+                        expired.insert(expired.end(), leaseIt->second.keys.begin(), leaseIt->second.keys.end());
+                        leaseIt = grantedLeases.erase(leaseIt);
+                    }
+                    else
+                    {
+                        leaseIt++;
+                    }
+                }
+            }/*lock scope*/
+
+            if(!expired.empty())
+            {
+                LOGWARN("Lease to " + mySiteTo + " was not returned, dropping " + std::to_string(expired.size()) + " keys");
+                for(const auto keyID : expired)
+                {
+                    // the other side may have handed these keys out so they can't be reused
+                    keys.Release(keyID);
+                }
+            }
+        }
+
+        void KeyStore::LeaseTimer()
+        {
+            std::unique_lock<std::mutex> lock(heldLeaseLock);
+            while(!shutdown)
+            {
+                if(heldLease.keys.empty())
+                {
+                    // wake up now and then to reclaim leases granted to the peer
+                    leaseTimerCv.wait_for(lock, std::max(leaseDuration, std::chrono::milliseconds(100)));
+                }
+                else
+                {
+                    leaseTimerCv.wait_until(lock, heldLease.expires);
+                }
+
+                HeldLease expired;
+                if(!shutdown && !heldLease.keys.empty() && std::chrono::steady_clock::now() >= heldLease.expires)
+                {
+                    LOGDEBUG("Returning expired lease from " + mySiteTo);
+                    expired = DetachHeldLease();
+                }
+
+                lock.unlock();
+                ReturnHeldLease(expired);
+                ReclaimExpiredLeases();
+                lock.lock();
+            }
+        } // LeaseTimer
+
         bool KeyStore::SetPath(const std::vector<std::string>& path)
         {
             bool result = false;
             /* lock scope */
             {
-                // make sure we're not in the middle of key generation
-                std::lock_guard<std::mutex> lock(allKeys_lock);
+                std::lock_guard<std::mutex> lock(pathLock);
                 myPath = path;
                 result = true;
             }/* lock scope */
@@ -13,12 +13,16 @@
 #include "KeyManagement/KeyStores/IKeyStore.h"
 #include "CQPToolkit/Interfaces/IKeyPublisher.h"
 #include "QKDInterfaces/IKeyFactory.grpc.pb.h"
+#include "KeyManagement/IKeyLease.grpc.pb.h"
 #include "KeyManagement/KeyStores/IBackingStore.h"
+#include "KeyManagement/KeyStores/KeyPool.h"
 #include "CQPToolkit/KeyGen/Stats.h"
-#include <map>
 #include <mutex>
-#include <condition_variable>
 #include <chrono>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <condition_variable>
 
 namespace cqp
 {
@@ -105,17 +109,56 @@ namespace cqp
              */
             size_t GetNumberUnusedKeys() const
             {
-                return unusedKeys.size();
+                return keys.NumUnused();
             }
 
             /**
              * @brief ReserveNewKey
              * Move an unused key into the reserved list and return it's id
-             * @param allKeysLock
              * @param keyID
              * @return True if a key was reserved
              */
-            bool ReserveNewKey(std::unique_lock<std::mutex>& allKeysLock, KeyID& keyID);
+            bool ReserveNewKey(KeyID& keyID);
+
+            /**
+             * @brief LeaseKeys
+             * Reserve keys requested by the peer so that it can hand them out without calling MarkKeyInUse
+             * @param request The keys which the peer has reserved
+             * @param[out] response The keys which the peer may use
+             * @return The result of the operation
+             */
+            grpc::Status LeaseKeys(const remote::LeaseRequest& request, remote::Lease& response);
+
+            /**
+             * @brief ReturnLeasedKeys
+             * Release keys from a lease granted by LeaseKeys which the peer didn't use
+             * @param request The unused keys
+             * @return The result of the operation
+             */
+            grpc::Status ReturnLeasedKeys(const remote::LeaseReturn& request);
+
+            /**
+             * @brief ReturnLease
+             * Give back any keys from the current lease on the peer, they will be available to both sides again.
+             * A new lease will be requested when a key is next needed.
+             * This is done automatically when the lease expires and when the key store is destroyed.
+             */
+            void ReturnLease();
+
+            /**
+             * @brief SetLeaseSize
+             * Sets the largest number of keys which will be reserved with the peer in one call.
+             * At most half of the unused keys are leased at once. Each lease is sized by the number of keys
+             * used from the last one so an idle key store only holds a few keys.
+             * @param size The number of keys, 0 will disable leases
+             * @param duration How long the keys of a lease can be handed out for before they are returned
+             */
+            void SetLeaseSize(size_t size, std::chrono::milliseconds duration = std::chrono::seconds(10))
+            {
+                std::lock_guard<std::mutex> lock(heldLeaseLock);
+                leaseSize = size;
+                leaseDuration = duration;
+            }
 
             /**
              * @brief FlushCache
@@ -149,18 +192,61 @@ namespace cqp
                 /// The authentication token which this key belongs to.
                 std::string authToken;
             };
-            /// Maps key ids to the key data
-            using KeyMap = std::map<KeyID, PSK>;
-            /// Stores all currently available keys
-            KeyMap unusedKeys;
-            /// Stores keys which can only be retrieved by id
-            KeyMap reservedKeys;
-            /// Protects access to allKeys
-            std::mutex allKeys_lock;
-            /// variable to wait on for changes
-            std::condition_variable allKeys_cv;
+            /// Stores the available and reserved keys
+            KeyPool keys;
             /// The keystore factory at the other site
             std::unique_ptr<remote::IKeyFactory::Stub> partnerFactory;
+            /// Leases keys from the keystore factory at the other site
+            std::unique_ptr<remote::IKeyLease::Stub> partnerLease;
+
+            /// Keys which the peer has reserved for our use
+            struct HeldLease
+            {
+                /// The id given by the peer
+                uint64_t id = 0;
+                /// Reserved keys which have not been handed out
+                std::deque<KeyID> keys;
+                /// When the keys must be returned
+                std::chrono::steady_clock::time_point expires;
+                /// How many keys the peer granted
+                size_t granted = 0;
+            };
+            /// Keys we have reserved for the peers use
+            struct GrantedLease
+            {
+                /// The keys in the lease in ascending order
+                std::vector<KeyID> keys;
+                /// If the lease hasn't been returned by this time the keys are unreserved
+                std::chrono::steady_clock::time_point reclaimAt;
+            };
+            /// The most keys to lease at once
+            std::atomic<size_t> leaseSize {1000};
+            /// How long to hand out leased keys for
+            std::chrono::milliseconds leaseDuration = std::chrono::seconds(10);
+            /// The fewest keys to ask for in a lease
+            static constexpr size_t minLeaseSize = 16;
+            /// How many keys to ask for in the next lease, based on how many were used from the last one
+            size_t leaseDemand = minLeaseSize;
+            /// Whether the peer understands IKeyLease
+            std::atomic_bool leasingSupported {true};
+            /// The lease we are using
+            HeldLease heldLease;
+            /// Protects access to heldLease
+            std::mutex heldLeaseLock;
+            /// Used to wake leaseTimer when a lease is taken or the key store is shutting down
+            std::condition_variable leaseTimerCv;
+            /// Returns the held lease when it expires
+            std::thread leaseTimer;
+            /// Leases given to the peer by lease id
+            std::unordered_map<uint64_t, GrantedLease> grantedLeases;
+            /// The id of the next lease to be granted
+            uint64_t nextLeaseId = 1;
+            /// Protects access to grantedLeases
+            std::mutex grantedLeasesLock;
+            /// For deciding who keeps a key reserved by both sides
+            std::once_flag lotteryDrawn;
+            /// True if we keep keys which are reserved by both sides
+            bool lotteryWon = false;
             /// Endpoint which this keystore is holding keys for
             const std::string mySiteFrom;
             /// Endpoint which this keystore is holding keys for
@@ -168,12 +254,16 @@ namespace cqp
             /// The hops needed to create a key
             /// @details 2 hops = direct key exchange
             std::vector<std::string> myPath;
+            /// Protects access to myPath
+            std::mutex pathLock;
             /// The keys store where we can get direct key stores from
             KeyStoreFactory* keystoreFactory = nullptr;
             /// where the keys are archived to
             std::shared_ptr<IBackingStore> backingStore;
             /// How many keys to store locally before sending them to the backing store
             uint64_t cacheThreashold;
+            /// How many keys to fetch from the backing store at once when there are none left locally
+            size_t backingStoreBatch = 128;
             /// a counter for assigning incoming keys an id
             std::atomic_uint64_t nextKeyId {1};
             /// for stopping internal threads
@@ -198,6 +288,62 @@ namespace cqp
              * @return true if a key was successfully created
              */
             bool GetNewIndirectKey(KeyID& identity, PSK& output);
+
+            /**
+             * @brief TakeLeasedKey
+             * Hand out a key from the lease, a new lease is requested if needed.
+             * @param[out] identity The key id allocated
+             * @param[out] output The key value
+             * @return true if a key was taken from a lease
+             */
+            bool TakeLeasedKey(KeyID& identity, PSK& output);
+
+            /**
+             * @brief RequestLease
+             * Reserve keys with the peer, heldLeaseLock must not be held
+             * @param wanted The number of keys to ask for
+             * @param duration How long the keys can be handed out for
+             * @param[out] lease The keys which were granted
+             * @return true if any keys were leased
+             */
+            bool RequestLease(size_t wanted, std::chrono::milliseconds duration, HeldLease& lease);
+
+            /**
+             * @brief DetachHeldLease
+             * Take the current lease out of heldLease and size the next one by how much of it was used,
+             * heldLeaseLock must be held
+             * @return The lease which was held
+             */
+            HeldLease DetachHeldLease();
+
+            /**
+             * @brief ReturnHeldLease
+             * Give back the unused keys of a lease taken by DetachHeldLease or RequestLease,
+             * heldLeaseLock must not be held
+             * @param lease The lease to return
+             */
+            void ReturnHeldLease(const HeldLease& lease);
+
+            /**
+             * @brief ReclaimExpiredLeases
+             * Unreserve keys in leases granted to the peer which have not been returned in time
+             */
+            void ReclaimExpiredLeases();
+
+            /**
+             * @brief LeaseTimer
+             * Return the held lease when it expires, so that the peer doesn't have to drop the keys,
+             * and reclaim leases granted to the peer which haven't been returned.
+             * Runs until shutdown is set
+             */
+            void LeaseTimer();
+
+            /**
+             * @brief WonLottery
+             * Decide which side keeps a key reserved by both sides, the result is the same for every key.
+             * @return true if we keep the key
+             */
+            bool WonLottery();
         };
 
     } // namespace keygen
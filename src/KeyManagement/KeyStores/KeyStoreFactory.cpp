@@ -18,6 +18,7 @@
 #include "Algorithms/Util/Strings.h"
 #include "Algorithms/Datatypes/URI.h"
 #include "google/protobuf/util/json_util.h"
+#include <future>
 
 namespace cqp
 {
@@ -185,11 +186,46 @@ namespace cqp
             return result;
         } // MarkKeyInUse
 
+        grpc::Status KeyStoreFactory::LeaseKeys(grpc::ServerContext*, const remote::LeaseRequest* request, remote::Lease* response)
+        {
+            grpc::Status result;
+            auto keystore = GetKeyStore(request->siteto());
+            if(keystore)
+            {
+                result = keystore->LeaseKeys(*request, *response);
+            }
+            else
+            {
+                result = Status(StatusCode::INVALID_ARGUMENT, "Unknown keystore path: " + siteAddress + " -> " + request->siteto());
+            }
+
+            return result;
+        } // LeaseKeys
+
+        grpc::Status KeyStoreFactory::ReturnKeys(grpc::ServerContext*, const remote::LeaseReturn* request, google::protobuf::Empty*)
+        {
+            grpc::Status result;
+            auto keystore = GetKeyStore(request->siteto());
+            if(keystore)
+            {
+                result = keystore->ReturnLeasedKeys(*request);
+            }
+            else
+            {
+                result = Status(StatusCode::INVALID_ARGUMENT, "Unknown keystore path: " + siteAddress + " -> " + request->siteto());
+            }
+
+            return result;
+        } // ReturnKeys
+
         grpc::Status KeyStoreFactory::BuildXorKey(grpc::ServerContext*, const remote::KeyPathRequest* request, google::protobuf::Empty*)
         {
             using namespace std;
             // alias for readability
             const auto& siteList = request->sites().urls();
+            // sites are numbered from the originating site, 0, to this site, last.
+            // The link between site i and site i + 1 is link i
+            const int lastSite = siteList.size() - 1;
 
             PSK finalKey;
 
@@ -197,60 +233,118 @@ namespace cqp
             // check the parameters make sense
             if(siteList.size() > 2 && *siteList.rbegin() == siteAddress)
             {
-                // Set the initial values for the first run of DoCombinedKey
-                KeyID leftKeyID = 0; // don't know this for the first run
-                bool leftKeyIDKnown = false;
-                KeyID rightKeyID = 0;
-
-                if(GetKeyStore(*(siteList.rbegin() + 1))->GetNewKey(rightKeyID, finalKey, true))
+                // Each middle site needs to be told the id of one of its keys, so the combined keys are requested
+                // from both ends of the path at once. The two chains meet at meetingSite, which is told both ids.
+                const int meetingSite = lastSite / 2;
+                // the id of the key on link meetingSite - 1, found by the left chain
+                KeyID leftChainKeyID = request->originatingkeyid();
+                // the combination of all the keys from the left chain
+                PSK leftChainKey;
+
+                // the left chain walks forwards from the site after the originating site, the key with the
+                // previous site is known, a new key is used with the next one.
+                // The request is made with left and right swapped as the combination is the same either way.
+                auto leftChain = async(launch::async, [&]()
                 {
-
-                    // loop backwards through each site, skip our site and the first site
-                    for(auto middleAddress = siteList.rbegin() + 1; middleAddress != siteList.rend() - 1; middleAddress++)
+                    Status chainResult;
+                    for(int middleSite = 1; middleSite < meetingSite && chainResult.ok(); middleSite++)
                     {
+                        KeyID newKeyID = 0;
                         std::string combinedKey;
-                        // The site before the previous site
-                        const auto leftAddress = middleAddress + 1;
-                        const auto rightAddress = middleAddress - 1; // starts as our address
 
-                        if(leftAddress == siteList.rend() - 1)
+                        chainResult = DoCombinedKey(
+                                          siteList[middleSite],
+                                          siteList[middleSite + 1],
+                                          newKeyID,     /*out*/
+                                          false,
+                                          siteList[middleSite - 1],
+                                          leftChainKeyID,
+                                          combinedKey    /*out*/
+                                      );
+
+                        if(chainResult.ok())
                         {
-                            // left address is now alpha, we know this key id
-                            leftKeyID = request->originatingkeyid();
-                            leftKeyIDKnown = true;
-                        }
-                        else
-                        {
-                            leftKeyID = 0;
-                            leftKeyIDKnown = false;
+                            leftChainKeyID = newKeyID;
+                            if(leftChainKey.empty())
+                            {
+                                leftChainKey.assign(combinedKey.begin(), combinedKey.end());
+                            }
+                            else
+                            {
+                                leftChainKey ^= combinedKey;
+                            }
                         }
+                    } // for middle addresses
+                    return chainResult;
+                });
+
+                // the id of the key on link meetingSite, found by the right chain
+                KeyID rightKeyID = 0;
+
+                if(GetKeyStore(siteList[lastSite - 1])->GetNewKey(rightKeyID, finalKey, true))
+                {
+                    // the right chain walks backwards from the site before this site, skip our site
+                    for(int middleSite = lastSite - 1; middleSite > meetingSite && result.ok(); middleSite--)
+                    {
+                        KeyID leftKeyID = 0;
+                        std::string combinedKey;
 
                         result = DoCombinedKey(
-                                     *middleAddress,
-                                     *leftAddress,
-                                     leftKeyID,     /*in out*/
-                                     leftKeyIDKnown,
-                                     *rightAddress,
+                                     siteList[middleSite],
+                                     siteList[middleSite - 1],
+                                     leftKeyID,     /*out*/
+                                     false,
+                                     siteList[middleSite + 1],
                                      rightKeyID,
                                      combinedKey    /*out*/
                                  );
-                        LOGDEBUG(*leftAddress + "[" + to_string(leftKeyID) + "], " + *rightAddress + "[" + to_string(rightKeyID) + "]" + " = " + to_string(static_cast<unsigned char>(combinedKey[0])));
 
                         if(result.ok())
                         {
                             // shift the key ids
                             rightKeyID = leftKeyID;
-
-                            // calculate the partial key
+                            // calculate the partial key as it arrives
                             finalKey ^= combinedKey;
                         }
-                        else
-                        {
-                            LOGERROR("Failed to get combined key");
-                            break; // for
-                        }
                     } // for middle addresses
+                } // if got new key
+                else
+                {
+                    LOGERROR("Failed to get a new key");
+                    result = Status(StatusCode::RESOURCE_EXHAUSTED, "Failed to get a new key");
+                }
+
+                const Status leftResult = leftChain.get();
+                if(result.ok())
+                {
+                    result = leftResult;
+                }
+
+                if(result.ok())
+                {
+                    // both key ids are known for the meeting site
+                    KeyID leftKeyID = leftChainKeyID;
+                    std::string combinedKey;
+
+                    result = DoCombinedKey(
+                                 siteList[meetingSite],
+                                 siteList[meetingSite - 1],
+                                 leftKeyID,
+                                 true,
+                                 siteList[meetingSite + 1],
+                                 rightKeyID,
+                                 combinedKey    /*out*/
+                             );
+
+                    if(result.ok())
+                    {
+                        finalKey ^= combinedKey;
+                        finalKey ^= leftChainKey;
+                    }
+                }
 
+                if(result.ok())
+                {
                     shared_ptr<keygen::KeyStore> finalKeystore = GetKeyStore(*siteList.begin());
                     if(finalKeystore)
                     {
@@ -263,12 +357,10 @@ namespace cqp
                     {
                         result = Status(StatusCode::NOT_FOUND, "No keystore available");
                     }
-
-                } // if got new key
+                }
                 else
                 {
-                    LOGERROR("Failed to get a new key");
-                    result = Status(StatusCode::RESOURCE_EXHAUSTED, "Failed to get a new key");
+                    LOGERROR("Failed to get combined key");
                 }
             }
             else
@@ -315,9 +407,10 @@ namespace cqp
                     leftKeyID = combinedKeyResponse.leftid();
                 }
                 combinedKey = combinedKeyResponse.combinedkey();
+                LOGDEBUG(leftAddress + "[" + to_string(leftKeyID) + "], " + rightAddress + "[" + to_string(rightKeyID) + "] combined by " + otherSiteAddress);
             }
             return result;
-        }
+        } // DoCombinedKey
 
         grpc::Status KeyStoreFactory::GetCombinedKey(grpc::ServerContext*, const remote::CombinedKeyRequest* request, remote::CombinedKeyResponse* response)
         {
@@ -370,6 +463,8 @@ namespace cqp
         std::shared_ptr<grpc::Channel> KeyStoreFactory::GetSiteChannel(const std::string& connectionAddress)
         {
             using namespace grpc;
+            // combined keys are requested from more than one thread
+            std::lock_guard<std::mutex> lock(otherSitesMutex);
             std::shared_ptr<grpc::Channel> result = otherSites[connectionAddress];
 
             if(result == nullptr)
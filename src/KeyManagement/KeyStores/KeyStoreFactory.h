@@ -14,6 +14,8 @@
 #include <memory>
 #include "QKDInterfaces/IKeyFactory.grpc.pb.h"
 #include "QKDInterfaces/IKey.grpc.pb.h"
+#include "KeyManagement/IKeyLease.grpc.pb.h"
+#include <mutex>
 #include <unordered_map>
 #include <grpcpp/security/credentials.h>
 #include "Algorithms/Datatypes/Keys.h"
@@ -36,7 +38,8 @@ namespace cqp
         /**
          * @brief The KeyStoreFactory class
          */
-        class KEYMANAGEMENT_EXPORT KeyStoreFactory : public remote::IKeyFactory::Service, public remote::IKey::Service
+        class KEYMANAGEMENT_EXPORT KeyStoreFactory : public remote::IKeyFactory::Service, public remote::IKey::Service,
+            public remote::IKeyLease::Service
         {
         public:
             /**
@@ -95,6 +98,17 @@ namespace cqp
             /// @param context Connection details from the server
             grpc::Status GetCombinedKey(grpc::ServerContext* context, const remote::CombinedKeyRequest* request, remote::CombinedKeyResponse* response) override;
             /// @}
+            ///@{
+            /// @name remote::IKeyLease interface
+
+            /// @copydoc remote::IKeyLease::LeaseKeys
+            /// @param context Connection details from the server
+            grpc::Status LeaseKeys(grpc::ServerContext* context, const remote::LeaseRequest* request, remote::Lease* response) override;
+
+            /// @copydoc remote::IKeyLease::ReturnKeys
+            /// @param context Connection details from the server
+            grpc::Status ReturnKeys(grpc::ServerContext* context, const remote::LeaseReturn* request, google::protobuf::Empty*) override;
+            /// @}
 
             /**
              * @brief AddReportingCallback
@@ -152,6 +166,8 @@ namespace cqp
         protected: // members
             /// communication channels to other site agents for creating stubs
             std::unordered_map<std::string, std::shared_ptr<grpc::Channel> > otherSites;
+            /// protects otherSites
+            std::mutex otherSitesMutex;
             /// Storage for all the created key stores
             std::unordered_map<std::string, std::shared_ptr<KeyStore>> keystores;
 
@@ -318,6 +318,8 @@ namespace cqp
             return result;
         }
 
+        constexpr unsigned long Session::FindBatchSize;
+
         Session::Session(std::shared_ptr<Slot> slot, CK_FLAGS flags, void* callbackData, const CK_NOTIFY callback):
             mySlot(slot),
             functions(slot->GetModule()->P11Lib())
@@ -351,7 +353,8 @@ namespace cqp
                                             reinterpret_cast<CK_UTF8CHAR*>(const_cast<char*>(pin.data())),
                                             pin.size()
                                            );
-                loggedIn = result == CKR_OK;
+                // the login is shared by all sessions with the token
+                loggedIn = result == CKR_OK || result == CKR_USER_ALREADY_LOGGED_IN;
             }
             return result;
         }
@@ -398,7 +401,7 @@ namespace cqp
                 if(result == CKR_OK)
                 {
                     // cap the amount we reserve each time we get more results.
-                    const unsigned long numToGetEachTime = std::min(100ul, maxResults);
+                    const unsigned long numToGetEachTime = std::min(FindBatchSize, maxResults);
                     unsigned long numThisTime = 0;
                     unsigned long numSoFar = 0;
                     std::vector<CK_OBJECT_HANDLE> objHandles;
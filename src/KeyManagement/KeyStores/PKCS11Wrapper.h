@@ -259,6 +259,8 @@ namespace cqp
 
             /// Default open flags
             static const CK_FLAGS DefaultFlags = CKF_RW_SESSION | CKF_SERIAL_SESSION;
+            /// The most handles FindObjects will ask for in each call to the device
+            static constexpr unsigned long FindBatchSize = 1024;
 
             /**
              * @brief Create
@@ -24,7 +24,8 @@ namespace cqp
          * @brief The YubiHSM class
          * This provides easy access to the YubiHSM2 device
          * This device is not a capable or true HSM so some features are handled in class.
-         * The keys can only be stored with a 2 byte ID and a 40 byte label with no other meta data.
+         * The keys can only be stored with a 2 byte ID and a 40 byte label with no other meta data,
+         * so reservations are only stored in memory.
          *
          * **Example pkcs11 urls**
          *
@@ -47,21 +48,6 @@ namespace cqp
 
             /// Distructor
             virtual ~YubiHSM() override = default;
-
-            ///@{
-            /// @name HSMStore overrides
-
-            /// @copydoc HSMStore::ReserveKey
-            /// @details YubiHSM2 does not permit storing any metadata, so they reservation is only stored internally
-            bool ReserveKey(const std::string& destination, KeyID& keyId) override;
-
-            /// @copydoc HSMStore::RemoveKey
-            bool RemoveKey(const std::string& destination, KeyID keyId, PSK& output) override;
-
-            /// @}
-        protected: // members
-            /// Keys currently held for other requests
-            std::map<std::string, std::vector<KeyID>> reservedKeys;
         }; //class YubiHSM
 
     } // namespace keygen
@@ -171,6 +171,7 @@ namespace cqp
         builder.RegisterService(this);
         builder.RegisterService(static_cast<remote::IKeyFactory::Service*>(keystoreFactory.get()));
         builder.RegisterService(static_cast<remote::IKey::Service*>(keystoreFactory.get()));
+        builder.RegisterService(static_cast<remote::IKeyLease::Service*>(keystoreFactory.get()));
         builder.RegisterService(reportServer.get());
         // ^^^ Add new services here ^^^ //
 
@@ -32,6 +32,35 @@ namespace cqp
     namespace tunnels
     {
 
+        /**
+         * @brief ConfigureTransfer
+         * Apply any TransferParams in the client data port uri to the builder
+         * @param builder The tunnel to configure
+         * @param details The settings for this end of the tunnel
+         */
+        static void ConfigureTransfer(TunnelBuilder& builder, const remote::tunnels::TunnelEndDetails& details)
+        {
+            const URI clientUri(details.clientdataporturi());
+            uint64_t aggregate = 0;
+            uint64_t aggregateLatency = 500;
+            uint64_t keyPrefetch = 0;
+            uint64_t keyGracePeriod = 2000;
+
+            if(clientUri.GetFirstParameter(TransferParams::aggregate, aggregate))
+            {
+                clientUri.GetFirstParameter(TransferParams::aggregateLatency, aggregateLatency);
+                LOGDEBUG("Aggregating up to " + std::to_string(aggregate) + " bytes");
+                builder.SetAggregation(aggregate, std::chrono::microseconds(aggregateLatency));
+            }
+
+            const bool prefetchSet = clientUri.GetFirstParameter(TransferParams::keyPrefetch, keyPrefetch);
+            if(clientUri.GetFirstParameter(TransferParams::keyGracePeriod, keyGracePeriod) || prefetchSet)
+            {
+                LOGDEBUG("Prefetching " + std::to_string(keyPrefetch) + " keys");
+                builder.SetKeyPrefetch(keyPrefetch, std::chrono::milliseconds(keyGracePeriod));
+            }
+        } // ConfigureTransfer
+
         Controller::Controller(const remote::tunnels::ControllerDetails& initialSettings)
             : settings(initialSettings)
         {
@@ -222,6 +251,7 @@ namespace cqp
 
                     auto newBuilder = std::make_shared<TunnelBuilder>(tunSettings.tunnel().encryptionmethod(),
                                       LoadChannelCredentials(settings.credentials()));
+                    ConfigureTransfer(*newBuilder, tunSettings.tunnel().startnode());
                     tunnelBuilders.emplace(name, newBuilder);
 
                     // try and find the controller by ID first
@@ -338,6 +368,7 @@ namespace cqp
                     auto newBuilder = make_shared<TunnelBuilder>(request->tunnel().encryptionmethod(), request->tunnel().remoteencryptedlistenaddress(),
                                       LoadServerCredentials(settings.credentials()),
                                       LoadChannelCredentials(settings.credentials()));
+                    ConfigureTransfer(*newBuilder, request->tunnel().endnode());
                     // tell the remote node how to connect to this node
                     response->set_encryptedconnectionuri(newBuilder->GetListenAddress());
 
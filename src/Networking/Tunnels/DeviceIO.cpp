@@ -40,6 +40,33 @@ namespace cqp
             return result;
         } // Put2
 
+        bool DeviceIO::ReadPackets(std::vector<net::PacketBuffer>& packets, size_t& packetsReceived)
+        {
+            bool result = true;
+            packetsReceived = 0;
+            if(!packets.empty())
+            {
+                result = Read(packets[0].data, packets[0].length, packets[0].bytes);
+                if(result && packets[0].bytes > 0)
+                {
+                    packetsReceived = 1;
+                }
+            }
+
+            return result;
+        } // ReadPackets
+
+        bool DeviceIO::WritePackets(const std::vector<net::PacketBuffer>& packets, size_t numPackets)
+        {
+            bool result = true;
+            for(size_t index = 0; result && index < numPackets && index < packets.size(); index++)
+            {
+                result = Write(packets[index].data, packets[index].bytes);
+            }
+
+            return result;
+        } // WritePackets
+
     } // namespace tunnels
 } // namespace cqp
 
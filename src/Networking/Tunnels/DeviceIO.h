@@ -14,7 +14,9 @@
 
 #include <chrono>
 #include <condition_variable>
+#include <vector>
 #include <cryptopp/filters.h>
+#include "Algorithms/Net/Sockets/Socket.h"
 #include "Networking/networking_export.h"
 
 namespace cqp
@@ -55,6 +57,39 @@ namespace cqp
              */
             virtual bool Write(const void* data, size_t length) = 0;
 
+            /**
+             * @brief ReadPackets
+             * Read as many packets as are available, up to the size of packets.
+             * Devices which can receive many packets with one call should override this,
+             * by default one packet is read.
+             * @param[in,out] packets Destinations for the packets, bytes is set for each packet received
+             * @param[out] packetsReceived The number of packets read
+             * @return true on success
+             */
+            virtual bool ReadPackets(std::vector<net::PacketBuffer>& packets, size_t& packetsReceived);
+
+            /**
+             * @brief WritePackets
+             * Send a number of packets to the device.
+             * Devices which can send many packets with one call should override this,
+             * by default Write is called for each packet.
+             * @param packets The packets to send, the first bytes of each one is sent
+             * @param numPackets The number of packets to send from the start of packets
+             * @return true on success
+             */
+            virtual bool WritePackets(const std::vector<net::PacketBuffer>& packets, size_t numPackets);
+
+            /**
+             * @brief OpenQueue
+             * Open another queue for the device which can be read and written by a different thread.
+             * Devices which can split their packets between queues should override this.
+             * @return A new queue, or nullptr if the device only has one queue
+             */
+            virtual DeviceIO* OpenQueue()
+            {
+                return nullptr;
+            }
+
             ///@{
             /// BufferedTransformation interface
 
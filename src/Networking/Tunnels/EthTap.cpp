@@ -74,7 +74,10 @@ namespace cqp
 
         EthTap::~EthTap()
         {
-            net::Device::Down(name);
+            if(ownsDevice)
+            {
+                net::Device::Down(name);
+            }
             close(handle);
         }
 
@@ -142,19 +145,17 @@ namespace cqp
             return result;
         }
 
-        EthTap::EthTap(const std::string& deviceName, Mode mode,
-                       const std::string& address, const std::string& netMask, bool persist)
+        int EthTap::Open(std::string& deviceName, Mode mode, bool multiQueue, size_t& mtu)
         {
-            LOGDEBUG("Creating device with name:" + deviceName + " setting ip to:" + address + "/" + netMask);
-
-            handle = open(clonedev, O_RDWR);
-            if(handle >= 0)
+            int result = open(clonedev, O_RDWR);
+            if(result >= 0)
             {
                 struct ifreq ifr {};
                 /* Flags: IFF_TUN   - TUN device (no Ethernet headers)
                  *        IFF_TAP   - TAP device
                  *
                  *        IFF_NO_PI - Do not provide packet information
+                 *        IFF_MULTI_QUEUE - Allow more than one handle to be attached
                  */
                 // use tap to ack like an Ethernet switch, all Ethernet packets are handled
                 ifr.ifr_flags = IFF_NO_PI;
@@ -169,36 +170,84 @@ namespace cqp
                     break;
                 }
 
+                if(multiQueue)
+                {
+                    // see https://git.kernel.org/pub/scm/linux/kernel/git/torvalds/linux.git/tree/Documentation/networking/tuntap.txt?id=HEAD
+                    ifr.ifr_ifru.ifru_flags |= IFF_MULTI_QUEUE;
+                }
+
                 if(!deviceName.empty())
                 {
                     LOGDEBUG("Forcing name to: " + deviceName);
                     deviceName.copy(ifr.ifr_name, sizeof(ifr.ifr_name));
                 }
 
-                if(ioctl(handle, TUNSETIFF, &ifr) < 0)
+                if(ioctl(result, TUNSETIFF, &ifr) < 0)
                 {
                     LOGERROR("Failed to setup tunnel");
                     LOGERROR(::strerror(errno));
-                    close(handle);
-                    handle = -1;
+                    close(result);
+                    result = -1;
                 }
                 else
                 {
-
                     // get the real name of the device
-                    name = ifr.ifr_name;
-                    LOGINFO("Created tun device " + name);
-                    // TODO: use multi queue interface to speed up data transfer, see https://git.kernel.org/pub/scm/linux/kernel/git/torvalds/linux.git/tree/Documentation/networking/tuntap.txt?id=HEAD
-                    bufferSize = static_cast<size_t>(ifr.ifr_ifru.ifru_mtu);
+                    deviceName = ifr.ifr_name;
+                    mtu = static_cast<size_t>(ifr.ifr_ifru.ifru_mtu);
+                }
+            }
 
-                    net::Device::SetAddress(name, address, netMask);
-                    net::Device::Up(name);
-                    SetPersist(persist);
+            return result;
+        }
 
-                    ready = true;
-                    readyCv.notify_all();
+        EthTap::EthTap(const std::string& deviceName, Mode mode,
+                       const std::string& address, const std::string& netMask, bool persist,
+                       bool multiQueue) :
+            name{deviceName}, mode{mode}, multiQueue{multiQueue}
+        {
+            LOGDEBUG("Creating device with name:" + deviceName + " setting ip to:" + address + "/" + netMask);
+
+            handle = Open(name, mode, multiQueue, bufferSize);
+            if(handle >= 0)
+            {
+                LOGINFO("Created tun device " + name);
+
+                net::Device::SetAddress(name, address, netMask);
+                net::Device::Up(name);
+                SetPersist(persist);
+
+                ready = true;
+                readyCv.notify_all();
+            }
+        }
+
+        EthTap* EthTap::OpenQueue()
+        {
+            EthTap* result = nullptr;
+            if(!multiQueue || handle < 0)
+            {
+                LOGERROR("Device " + name + " does not support multiple queues");
+            }
+            else
+            {
+                std::string queueName = name;
+                size_t queueMtu = 0;
+                int queueHandle = Open(queueName, mode, true, queueMtu);
+                if(queueHandle >= 0)
+                {
+                    result = new EthTap();
+                    result->handle = queueHandle;
+                    result->name = queueName;
+                    result->bufferSize = bufferSize;
+                    result->mode = mode;
+                    result->multiQueue = true;
+                    result->ownsDevice = false;
+                    result->ready = true;
+                    LOGDEBUG("Opened another queue for " + name);
                 }
             }
+
+            return result;
         }
 
         EthTap* EthTap::Create(const URI& uri)
@@ -210,8 +259,10 @@ namespace cqp
             }
             bool persist = false;
             uri.GetFirstParameter(Params::persist, persist);
+            uint64_t queues = 1;
+            uri.GetFirstParameter(Params::queues, queues);
 
-            return new EthTap(uri[Params::name], mode, uri.GetHost(), uri[Params::netmask], persist);
+            return new EthTap(uri[Params::name], mode, uri.GetHost(), uri[Params::netmask], persist, queues > 1);
         }
 
     } // namespace tunnels
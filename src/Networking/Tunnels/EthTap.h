@@ -49,6 +49,8 @@ namespace cqp
                 static CONSTSTRING mode_tap = "tap";
                 /// keep the device after shutdown
                 static CONSTSTRING persist = "persist";
+                /// the number of queues which will be used, more than 1 creates the device with IFF_MULTI_QUEUE
+                static CONSTSTRING queues = "queues";
             };
 
             /**
@@ -58,8 +60,11 @@ namespace cqp
              * @param mode How the device will handle packets
              * @param address An ip address to assign to the device
              * @param netMask the mask to apply if an ip address is specified
+             * @param persist keep the device after shutdown
+             * @param multiQueue Create the device with IFF_MULTI_QUEUE so that OpenQueue can be used
              */
-            EthTap(const std::string& deviceName, Mode mode, const std::string& address, const std::string& netMask, bool persist = false);
+            EthTap(const std::string& deviceName, Mode mode, const std::string& address, const std::string& netMask, bool persist = false,
+                   bool multiQueue = false);
 
             /**
              * @brief Create
@@ -104,6 +109,16 @@ namespace cqp
              */
             bool SetOwner(int user = -1, int group = -1);
 
+            /**
+             * @brief OpenQueue
+             * Attach another queue to the device. The kernel spreads packets between the queues by flow,
+             * so each queue can be read and written by its own thread.
+             * The device must have been created with multiQueue set.
+             * @return A new queue for the same device, or nullptr on failure. The queue must be destroyed
+             * before the object which created the device.
+             */
+            EthTap* OpenQueue() override;
+
             /**
              * @brief ~EthTap
              * Destructor
@@ -140,6 +155,29 @@ namespace cqp
             std::string name;
             /// available buffer
             size_t bufferSize = 0;
+            /// The kind of device
+            Mode mode = Mode::Tap;
+            /// was the device created with IFF_MULTI_QUEUE
+            bool multiQueue = false;
+            /// false if this is an extra queue for a device owned by another instance
+            bool ownsDevice = true;
+
+            /**
+             * @brief EthTap
+             * Constructor for extra queues
+             */
+            EthTap() = default;
+
+            /**
+             * @brief Open
+             * Open a handle to the clone device and attach it to a tun/tap device, creating it if needed
+             * @param[in,out] deviceName The name to request, set to the real name on success
+             * @param mode How the device will handle packets
+             * @param multiQueue Set IFF_MULTI_QUEUE
+             * @param[out] mtu The size of packets for the device
+             * @return The new handle or -1 on failure
+             */
+            static int Open(std::string& deviceName, Mode mode, bool multiQueue, size_t& mtu);
 
         };
     } // namespace tunnels
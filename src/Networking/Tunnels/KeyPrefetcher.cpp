@@ -0,0 +1,224 @@
+/*!
+* @file
+* @brief KeyPrefetcher
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "KeyPrefetcher.h"
+#include "Algorithms/Logging/Logger.h"
+#include "CQPToolkit/Util/GrpcLogger.h"
+#include <algorithm>
+
+namespace cqp
+{
+    namespace tunnels
+    {
+        using std::chrono::high_resolution_clock;
+
+        KeyPrefetcher::KeyPrefetcher(remote::IKey::Stub* keyFactory, const std::string& siteTo, size_t depth, Statistics& stats) :
+            keyFactory{keyFactory}, siteTo{siteTo}, depth{depth}, stats{stats}
+        {
+            worker = std::thread(&KeyPrefetcher::Worker, this);
+        }
+
+        KeyPrefetcher::~KeyPrefetcher()
+        {
+            Stop();
+            if(worker.joinable())
+            {
+                worker.join();
+            }
+        }
+
+        void KeyPrefetcher::Stop()
+        {
+            std::lock_guard<std::mutex> lock(changeMutex);
+            keepGoing = false;
+            if(fetchContext)
+            {
+                fetchContext->TryCancel();
+            }
+            changed.notify_all();
+        } // Stop
+
+        bool KeyPrefetcher::NextKey(remote::SharedKey& key, std::chrono::milliseconds timeout)
+        {
+            bool result = false;
+            const auto started = high_resolution_clock::now();
+
+            if(depth == 0)
+            {
+                // nothing is fetched in advance
+                grpc::ClientContext ctx;
+                remote::KeyRequest request;
+                request.set_siteto(siteTo);
+                result = LogStatus(keyFactory->GetSharedKey(&ctx, request, &key)).ok();
+            }
+            else
+            {
+                std::unique_lock<std::mutex> lock(changeMutex);
+                const bool stalled = newKeys.empty();
+
+                changed.wait_for(lock, timeout, [&]()
+                {
+                    return !newKeys.empty() || !keepGoing;
+                });
+
+                if(!newKeys.empty())
+                {
+                    key = std::move(newKeys.front());
+                    newKeys.pop_front();
+                    result = true;
+                    // let the worker replace it
+                    changed.notify_all();
+                }
+
+                if(stalled)
+                {
+                    RecordStall(started);
+                }
+            }
+
+            return result;
+        } // NextKey
+
+        std::vector<uint64_t> KeyPrefetcher::TakeNewKeyIds()
+        {
+            std::vector<uint64_t> result;
+            std::lock_guard<std::mutex> lock(changeMutex);
+            result.swap(unannouncedIds);
+            return result;
+        } // TakeNewKeyIds
+
+        void KeyPrefetcher::Prefetch(uint64_t keyId)
+        {
+            std::lock_guard<std::mutex> lock(changeMutex);
+            if(existingKeys.find(keyId) == existingKeys.end() && fetchingId != keyId &&
+                    std::find(wantedIds.begin(), wantedIds.end(), keyId) == wantedIds.end())
+            {
+                wantedIds.push_back(keyId);
+                changed.notify_all();
+            }
+        } // Prefetch
+
+        bool KeyPrefetcher::GetKey(uint64_t keyId, remote::SharedKey& key)
+        {
+            bool result = false;
+            bool stalled = false;
+            const auto started = high_resolution_clock::now();
+            std::unique_lock<std::mutex> lock(changeMutex);
+
+            while(!result && keepGoing)
+            {
+                auto found = existingKeys.find(keyId);
+                if(found != existingKeys.end())
+                {
+                    key = std::move(found->second);
+                    existingKeys.erase(found);
+                    result = true;
+                }
+                else if(fetchingId == keyId || std::find(wantedIds.begin(), wantedIds.end(), keyId) != wantedIds.end())
+                {
+                    // it's on its way
+                    stalled = true;
+                    changed.wait(lock);
+                }
+                else
+                {
+                    break; // while
+                }
+            }
+
+            if(!result && keepGoing)
+            {
+                // the key wasn't announced or the prefetch failed, get it now
+                stalled = true;
+                lock.unlock();
+                grpc::ClientContext ctx;
+                remote::KeyRequest request;
+                request.set_siteto(siteTo);
+                request.set_keyid(keyId);
+                result = LogStatus(keyFactory->GetSharedKey(&ctx, request, &key)).ok();
+                lock.lock();
+            }
+
+            if(stalled)
+            {
+                RecordStall(started);
+            }
+
+            return result;
+        } // GetKey
+
+        void KeyPrefetcher::RecordStall(high_resolution_clock::time_point started)
+        {
+            stats.keyStalls.Update(1);
+            stats.keyStallTime.Update(high_resolution_clock::now() - started);
+        } // RecordStall
+
+        void KeyPrefetcher::Worker()
+        {
+            std::unique_lock<std::mutex> lock(changeMutex);
+            while(keepGoing)
+            {
+                uint64_t keyId = 0;
+                // keys the far side is waiting for come first
+                if(!wantedIds.empty())
+                {
+                    keyId = wantedIds.front();
+                    wantedIds.pop_front();
+                }
+                else if(newKeys.size() >= depth)
+                {
+                    changed.wait(lock);
+                    continue; // while
+                }
+
+                grpc::ClientContext ctx;
+                remote::KeyRequest request;
+                remote::SharedKey key;
+                request.set_siteto(siteTo);
+                if(keyId != 0)
+                {
+                    request.set_keyid(keyId);
+                }
+                fetchingId = keyId;
+                fetchContext = &ctx;
+
+                lock.unlock();
+                grpc::Status status = keyFactory->GetSharedKey(&ctx, request, &key);
+                lock.lock();
+
+                fetchingId = 0;
+                fetchContext = nullptr;
+
+                if(status.ok())
+                {
+                    if(keyId != 0)
+                    {
+                        existingKeys[keyId] = std::move(key);
+                    }
+                    else
+                    {
+                        unannouncedIds.push_back(key.keyid());
+                        newKeys.push_back(std::move(key));
+                    }
+                    changed.notify_all();
+                }
+                else if(keepGoing)
+                {
+                    LogStatus(status, "Failed to prefetch key");
+                    // wake anyone waiting for an existing key so they can fetch it themselves
+                    changed.notify_all();
+                    changed.wait_for(lock, retryDelay);
+                }
+            } // while keepGoing
+        } // Worker
+
+    } // namespace tunnels
+} // namespace cqp
@@ -0,0 +1,141 @@
+/*!
+* @file
+* @brief KeyPrefetcher
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "QKDInterfaces/IKey.grpc.pb.h"
+#include "Networking/Tunnels/Stats.h"
+#include "Networking/networking_export.h"
+
+namespace cqp
+{
+    namespace tunnels
+    {
+        /**
+         * @brief The KeyPrefetcher class
+         * Fetches keys from a key store in the background so that changing the key on a tunnel
+         * does not have to wait for the key store.
+         * @details
+         * New keys, used for encrypting, are fetched until depth keys are waiting.
+         * Existing keys, which the far side has said it will use, are fetched once they are requested
+         * with Prefetch.
+         * Each time a caller has to wait for a key, the stall is recorded in the statistics.
+         */
+        class NETWORKING_EXPORT KeyPrefetcher
+        {
+        public:
+            /**
+             * @brief KeyPrefetcher
+             * Constructor, starts the fetching thread
+             * @param keyFactory Where to get keys from, must outlive this object
+             * @param siteTo The key store the keys are shared with
+             * @param depth The number of new keys to keep ready, 0 = only fetch new keys when asked for
+             * @param stats Where to record stalls
+             */
+            KeyPrefetcher(remote::IKey::Stub* keyFactory, const std::string& siteTo, size_t depth, Statistics& stats);
+
+            /// Destructor
+            ~KeyPrefetcher();
+
+            /**
+             * @brief NextKey
+             * Get an unused key for encrypting
+             * @param[out] key The new key
+             * @param timeout How long to wait if there are no keys ready
+             * @return true if a key was returned
+             */
+            bool NextKey(remote::SharedKey& key, std::chrono::milliseconds timeout);
+
+            /**
+             * @brief TakeNewKeyIds
+             * @return The ids of the new keys which have been fetched since the last call.
+             * These can be passed to the far side so that it can Prefetch them
+             */
+            std::vector<uint64_t> TakeNewKeyIds();
+
+            /**
+             * @brief Prefetch
+             * Start fetching an existing key in the background
+             * @param keyId The id of the key
+             */
+            void Prefetch(uint64_t keyId);
+
+            /**
+             * @brief GetKey
+             * Get an existing key, if it has not been prefetched it is fetched now
+             * @param keyId The id of the key
+             * @param[out] key The key
+             * @return true if the key was found
+             */
+            bool GetKey(uint64_t keyId, remote::SharedKey& key);
+
+            /**
+             * @brief Stop
+             * Stop fetching keys, any waiting callers will return
+             */
+            void Stop();
+
+        protected: // members
+            /// Where to get keys from
+            remote::IKey::Stub* keyFactory;
+            /// The key store the keys are shared with
+            const std::string siteTo;
+            /// The number of new keys to keep ready
+            const size_t depth;
+            /// Where to record stalls
+            Statistics& stats;
+
+            /// new keys ready to be used
+            std::deque<remote::SharedKey> newKeys;
+            /// ids of new keys which haven't been returned by TakeNewKeyIds
+            std::vector<uint64_t> unannouncedIds;
+            /// ids of existing keys which need fetching
+            std::deque<uint64_t> wantedIds;
+            /// existing keys which have been fetched
+            std::unordered_map<uint64_t, remote::SharedKey> existingKeys;
+            /// The existing key being fetched by the worker, 0 = none
+            uint64_t fetchingId = 0;
+            /// The request being made by the worker so that it can be cancelled
+            grpc::ClientContext* fetchContext = nullptr;
+            /// should the worker keep running
+            bool keepGoing = true;
+            /// protects the members
+            std::mutex changeMutex;
+            /// signalled when the keys change
+            std::condition_variable changed;
+            /// The thread which fetches the keys
+            std::thread worker;
+
+            /// How long to wait before trying again when the key store fails
+            const std::chrono::milliseconds retryDelay {500};
+
+        protected: // methods
+            /**
+             * @brief Worker
+             * Fetch keys until Stop is called
+             */
+            void Worker();
+
+            /**
+             * @brief RecordStall
+             * Update the statistics after a caller had to wait for a key. changeMutex must be held
+             * @param started When the caller started waiting
+             */
+            void RecordStall(std::chrono::high_resolution_clock::time_point started);
+        };
+    } // namespace tunnels
+} // namespace cqp
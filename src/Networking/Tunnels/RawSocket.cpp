@@ -223,6 +223,16 @@ namespace cqp
             return Socket::Write(data, length);
         }
 
+        bool RawSocket::ReadPackets(std::vector<net::PacketBuffer>& packets, size_t& packetsReceived)
+        {
+            return Socket::ReadMany(packets, packetsReceived);
+        }
+
+        bool RawSocket::WritePackets(const std::vector<net::PacketBuffer>& packets, size_t numPackets)
+        {
+            return Socket::WriteMany(packets, numPackets);
+        }
+
         void RawSocket::Close()
         {
             Socket::Close();
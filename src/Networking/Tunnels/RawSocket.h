@@ -89,6 +89,10 @@ namespace cqp
             bool Read(void* data, size_t length, size_t& bytesReceived) override;
             /// @copydoc DeviceIO::Write
             bool Write(const void* data, size_t length) override;
+            /// @copydoc DeviceIO::ReadPackets
+            bool ReadPackets(std::vector<net::PacketBuffer>& packets, size_t& packetsReceived) override;
+            /// @copydoc DeviceIO::WritePackets
+            bool WritePackets(const std::vector<net::PacketBuffer>& packets, size_t numPackets) override;
 
             /// @}
 
@@ -0,0 +1,65 @@
+/*!
+* @file
+* @brief RecentKeys
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "RecentKeys.h"
+#include <algorithm>
+
+namespace cqp
+{
+    namespace tunnels
+    {
+        using std::chrono::steady_clock;
+
+        RecentKeys::RecentKeys(std::chrono::milliseconds gracePeriod) :
+            gracePeriod{gracePeriod}
+        {
+        }
+
+        void RecentKeys::Add(remote::SharedKey&& key)
+        {
+            const auto now = steady_clock::now();
+            RemoveExpired(now);
+            if(!key.keyvalue().empty())
+            {
+                keys.emplace_back(now + gracePeriod, std::move(key));
+            }
+        } // Add
+
+        bool RecentKeys::Take(uint64_t keyId, remote::SharedKey& key)
+        {
+            bool result = false;
+            RemoveExpired(steady_clock::now());
+
+            auto found = std::find_if(keys.begin(), keys.end(), [&](const std::pair<steady_clock::time_point, remote::SharedKey>& entry)
+            {
+                return entry.second.keyid() == keyId;
+            });
+
+            if(found != keys.end())
+            {
+                key = std::move(found->second);
+                keys.erase(found);
+                result = true;
+            }
+
+            return result;
+        } // Take
+
+        void RecentKeys::RemoveExpired(steady_clock::time_point now)
+        {
+            while(!keys.empty() && keys.front().first <= now)
+            {
+                keys.pop_front();
+            }
+        } // RemoveExpired
+
+    } // namespace tunnels
+} // namespace cqp
@@ -0,0 +1,69 @@
+/*!
+* @file
+* @brief RecentKeys
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#pragma once
+#include <chrono>
+#include <deque>
+#include <utility>
+#include "QKDInterfaces/IKey.grpc.pb.h"
+#include "Networking/networking_export.h"
+
+namespace cqp
+{
+    namespace tunnels
+    {
+        /**
+         * @brief The RecentKeys class
+         * Holds keys which have been replaced for a grace period so that messages which were
+         * already in flight when the far side changed key can still be decrypted.
+         */
+        class NETWORKING_EXPORT RecentKeys
+        {
+        public:
+            /**
+             * @brief RecentKeys
+             * Constructor
+             * @param gracePeriod How long a key is kept after it is added
+             */
+            explicit RecentKeys(std::chrono::milliseconds gracePeriod);
+
+            /**
+             * @brief Add
+             * Keep a key which has just been replaced. Empty keys are ignored
+             * @param key The old key
+             */
+            void Add(remote::SharedKey&& key);
+
+            /**
+             * @brief Take
+             * Remove a key if it's still within its grace period
+             * @param keyId The id of the key
+             * @param[out] key The key
+             * @return true if the key was found
+             */
+            bool Take(uint64_t keyId, remote::SharedKey& key);
+
+        protected: // members
+            /// How long a key is kept after it is added
+            const std::chrono::milliseconds gracePeriod;
+            /// keys and when they stop being accepted, oldest first
+            std::deque<std::pair<std::chrono::steady_clock::time_point, remote::SharedKey>> keys;
+
+        protected: // methods
+            /**
+             * @brief RemoveExpired
+             * Drop the keys whose grace period has passed
+             * @param now The current time
+             */
+            void RemoveExpired(std::chrono::steady_clock::time_point now);
+        }; // class RecentKeys
+    } // namespace tunnels
+} // namespace cqp
@@ -0,0 +1,127 @@
+/*!
+* @file
+* @brief RecordBatch
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "RecordBatch.h"
+#include "Algorithms/Logging/Logger.h"
+
+namespace cqp
+{
+    namespace tunnels
+    {
+        using std::chrono::high_resolution_clock;
+
+        RecordBatch::RecordBatch(size_t maxBytes, std::chrono::microseconds latency, SendFunction send, Statistics& stats) :
+            maxBytes{maxBytes}, latency{latency}, send{std::move(send)}, stats{stats}
+        {
+            flusher = std::thread(&RecordBatch::Flusher, this);
+        }
+
+        RecordBatch::~RecordBatch()
+        {
+            Stop();
+        }
+
+        bool RecordBatch::Add(uint64_t keyId, size_t recordSize, const AppendFunction& append)
+        {
+            std::lock_guard<std::mutex> lock(batchMutex);
+            // all the records in a message share a key and the message is kept within the size limit
+            if(batch.keyid() != keyId || batch.payload().size() + recordSize > maxBytes)
+            {
+                SendBatch();
+            }
+
+            if(batch.payload().empty())
+            {
+                batch.set_keyid(keyId);
+                batchStarted = high_resolution_clock::now();
+                batchCv.notify_one();
+            }
+
+            append(*batch.mutable_payload());
+            recordsInBatch++;
+
+            if(batch.payload().size() >= maxBytes)
+            {
+                SendBatch();
+            }
+
+            return !sendFailed;
+        } // Add
+
+        bool RecordBatch::Send(const remote::EncryptedDataValues& message)
+        {
+            std::lock_guard<std::mutex> lock(batchMutex);
+            // keep the message behind the records which came before it
+            SendBatch();
+            if(!send(message))
+            {
+                LOGERROR("Failed to send message");
+                sendFailed = true;
+            }
+            return !sendFailed;
+        } // Send
+
+        void RecordBatch::Stop()
+        {
+            {
+                /*lock scope*/
+                std::lock_guard<std::mutex> lock(batchMutex);
+                keepGoing = false;
+                batchCv.notify_one();
+            }/*lock scope*/
+
+            if(flusher.joinable())
+            {
+                flusher.join();
+            }
+
+            // anything left over is sent so the far side is not missing the end of the data
+            std::lock_guard<std::mutex> lock(batchMutex);
+            SendBatch();
+        } // Stop
+
+        void RecordBatch::SendBatch()
+        {
+            if(!batch.payload().empty())
+            {
+                if(!send(batch))
+                {
+                    LOGERROR("Failed to send encrypted message");
+                    sendFailed = true;
+                }
+                stats.packetsPerMessage.Update(recordsInBatch);
+                batch.clear_payload();
+                recordsInBatch = 0;
+            }
+        } // SendBatch
+
+        void RecordBatch::Flusher()
+        {
+            std::unique_lock<std::mutex> lock(batchMutex);
+            while(keepGoing)
+            {
+                if(batch.payload().empty())
+                {
+                    batchCv.wait(lock);
+                }
+                else if(high_resolution_clock::now() >= batchStarted + latency)
+                {
+                    SendBatch();
+                }
+                else
+                {
+                    batchCv.wait_until(lock, batchStarted + latency);
+                }
+            }
+        } // Flusher
+
+    } // namespace tunnels
+} // namespace cqp
@@ -0,0 +1,121 @@
+/*!
+* @file
+* @brief RecordBatch
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "QKDInterfaces/ITransfer.grpc.pb.h"
+#include "Networking/Tunnels/Stats.h"
+#include "Networking/networking_export.h"
+
+namespace cqp
+{
+    namespace tunnels
+    {
+        /**
+         * @brief The RecordBatch class
+         * Collects records into aggregated messages so that small packets don't each need a message.
+         * @details
+         * A message is sent when the next record won't fit, when the key changes or when the oldest
+         * record has waited for the latency given to the constructor.
+         * All messages, including those passed to Send, go through the same lock so they reach
+         * the far side in order.
+         */
+        class NETWORKING_EXPORT RecordBatch
+        {
+        public:
+            /// Sends a message to the far side, returns false if the message could not be sent
+            using SendFunction = std::function<bool(const remote::EncryptedDataValues&)>;
+            /// Writes a record onto the end of the payload
+            using AppendFunction = std::function<void(std::string& payload)>;
+
+            /**
+             * @brief RecordBatch
+             * Constructor, starts the thread which sends late messages
+             * @param maxBytes The largest payload for a message
+             * @param latency The longest a record will wait for the message to fill
+             * @param send Where to send the messages
+             * @param stats Where to record the number of records in each message
+             */
+            RecordBatch(size_t maxBytes, std::chrono::microseconds latency, SendFunction send, Statistics& stats);
+
+            /// Destructor, sends anything left
+            ~RecordBatch();
+
+            /**
+             * @brief Add
+             * Add a record to the current message
+             * @param keyId The key the record was encrypted with
+             * @param recordSize The number of bytes append will add to the payload
+             * @param append Writes the record, called with the batch locked
+             * @return false if a message failed to send
+             */
+            bool Add(uint64_t keyId, size_t recordSize, const AppendFunction& append);
+
+            /**
+             * @brief Send
+             * Send a message straight away, after any records which have already been added
+             * @param message The message to send
+             * @return false if a message failed to send
+             */
+            bool Send(const remote::EncryptedDataValues& message);
+
+            /**
+             * @brief Stop
+             * Stop the sending thread and send anything left
+             */
+            void Stop();
+
+        protected: // members
+            /// The largest payload for a message
+            const size_t maxBytes;
+            /// The longest a record will wait for the message to fill
+            const std::chrono::microseconds latency;
+            /// Where to send the messages
+            SendFunction send;
+            /// Where to record the number of records in each message
+            Statistics& stats;
+
+            /// The message being filled
+            remote::EncryptedDataValues batch;
+            /// The number of records in batch
+            uint64_t recordsInBatch = 0;
+            /// When the first record was added to batch
+            std::chrono::high_resolution_clock::time_point batchStarted;
+            /// Has any message failed to send
+            bool sendFailed = false;
+            /// should the flusher keep running
+            bool keepGoing = true;
+            /// protects the members
+            std::mutex batchMutex;
+            /// signalled when a new message is started or when stopping
+            std::condition_variable batchCv;
+            /// sends messages which have waited too long
+            std::thread flusher;
+
+        protected: // methods
+            /**
+             * @brief SendBatch
+             * Send the current message if it has any records. batchMutex must be held
+             */
+            void SendBatch();
+
+            /**
+             * @brief Flusher
+             * Send messages which have waited for latency until Stop is called
+             */
+            void Flusher();
+        }; // class RecordBatch
+    } // namespace tunnels
+} // namespace cqp
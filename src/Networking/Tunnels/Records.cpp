@@ -0,0 +1,118 @@
+/*!
+* @file
+* @brief Records
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "Records.h"
+#include "Algorithms/Logging/Logger.h"
+#include "CQPToolkit/Util/GrpcLogger.h"
+#include <cryptopp/cryptlib.h>
+#include <algorithm>
+
+namespace cqp
+{
+    namespace tunnels
+    {
+        using grpc::Status;
+        using grpc::StatusCode;
+
+        constexpr size_t Records::HeaderSize;
+        constexpr size_t Records::MacSize;
+
+        void Records::EncryptRecord(CryptoPP::AuthenticatedSymmetricCipher& cypher,
+                                    const unsigned char* iv, size_t ivLength,
+                                    const unsigned char* data, size_t length, unsigned char* output)
+        {
+            // only the iv is reset, the key schedule is kept from the last SetKey
+            cypher.EncryptAndAuthenticate(output, output + length, MacSize,
+                                          iv, static_cast<int>(ivLength), nullptr, 0,
+                                          data, length);
+        } // EncryptRecord
+
+        Status Records::DecryptRecord(CryptoPP::AuthenticatedSymmetricCipher& cypher,
+                                      const unsigned char* iv, size_t ivLength,
+                                      const unsigned char* data, size_t length, unsigned char* output)
+        {
+            Status result;
+
+            try
+            {
+                if(length < MacSize ||
+                        !cypher.DecryptAndVerify(output, data + length - MacSize, MacSize,
+                                                 iv, static_cast<int>(ivLength), nullptr, 0,
+                                                 data, length - MacSize))
+                {
+                    result = LogStatus(Status(StatusCode::DATA_LOSS, "Decryption failed", "Packet failed authentication"));
+                }
+            }
+            catch(const std::exception& e)
+            {
+                LOGERROR(e.what());
+                result = Status(StatusCode::DATA_LOSS, "Decryption failed", e.what());
+            }
+
+            return result;
+        } // DecryptRecord
+
+        void Records::AppendRecord(std::string& payload, CryptoPP::AuthenticatedSymmetricCipher& cypher,
+                                   const unsigned char* iv, size_t ivLength,
+                                   const unsigned char* data, size_t length)
+        {
+            const size_t recordSize = ivLength + length + MacSize;
+            const size_t recordStart = payload.size();
+            payload.resize(recordStart + HeaderSize + recordSize);
+
+            auto* record = reinterpret_cast<unsigned char*>(&payload[recordStart]);
+            for(size_t index = 0; index < HeaderSize; index++)
+            {
+                record[index] = static_cast<unsigned char>((recordSize >> ((HeaderSize - index - 1) * 8)) & 0xFF);
+            }
+            record += HeaderSize;
+            std::copy(iv, iv + ivLength, record);
+            record += ivLength;
+            // encrypt straight into the message
+            EncryptRecord(cypher, iv, ivLength, data, length, record);
+        } // AppendRecord
+
+        Status Records::ParseRecords(const std::string& payload, size_t ivLength, const RecordHandler& handler)
+        {
+            Status result;
+            const auto* data = reinterpret_cast<const unsigned char*>(payload.data());
+            const size_t payloadSize = payload.size();
+            size_t offset = 0;
+
+            while(result.ok() && offset < payloadSize)
+            {
+                uint32_t recordSize = 0;
+                if(payloadSize - offset >= HeaderSize)
+                {
+                    for(size_t index = 0; index < HeaderSize; index++)
+                    {
+                        recordSize = (recordSize << 8) | data[offset + index];
+                    }
+                    offset += HeaderSize;
+                }
+
+                // every record has at least an iv and a mac and must fit in what's left
+                if(recordSize >= ivLength + MacSize && recordSize <= payloadSize - offset)
+                {
+                    result = handler(&data[offset], ivLength, &data[offset + ivLength], recordSize - ivLength);
+                    offset += recordSize;
+                }
+                else
+                {
+                    result = LogStatus(Status(StatusCode::DATA_LOSS, "Malformed aggregated message"));
+                }
+            } // while records
+
+            return result;
+        } // ParseRecords
+
+    } // namespace tunnels
+} // namespace cqp
@@ -0,0 +1,121 @@
+/*!
+* @file
+* @brief Records
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <grpcpp/support/status.h>
+#include "Networking/networking_export.h"
+
+namespace CryptoPP
+{
+    class AuthenticatedSymmetricCipher;
+}
+
+namespace cqp
+{
+    namespace tunnels
+    {
+        /**
+         * @brief The Records class
+         * Encodes the packets sent through a tunnel.
+         * @details
+         * Each packet is encrypted to a record of: cypher text | mac
+         * Several records can be sent in one aggregated message, each one is:
+         *   length (4 bytes, big endian) | iv | cypher text | mac
+         * where the length covers the iv, cypher text and mac
+         */
+        class NETWORKING_EXPORT Records
+        {
+        public:
+            /// The size of the length which comes before each record in an aggregated message
+            static constexpr size_t HeaderSize = sizeof(uint32_t);
+            /// The size of the authentication tag which follows the cypher text of each packet
+            static constexpr size_t MacSize = 16;
+
+            /**
+             * Called for each record found in an aggregated message
+             * @param iv The initialisation vector for the packet
+             * @param ivLength The size of iv
+             * @param data The cypher text followed by the MAC
+             * @param length The size of data
+             * @return status, parsing stops at the first failure
+             */
+            using RecordHandler = std::function<grpc::Status(const unsigned char* iv, size_t ivLength,
+                                  const unsigned char* data, size_t length)>;
+
+            /**
+             * @brief EncryptRecord
+             * Encrypt and authenticate one packet with the key already loaded into the cypher
+             * @param cypher An encrypting cypher with its key set
+             * @param iv The initialisation vector for the packet
+             * @param ivLength The size of iv
+             * @param data The plain text
+             * @param length The size of data
+             * @param[out] output Destination for the cypher text and mac, must hold length + MacSize bytes
+             */
+            static void EncryptRecord(CryptoPP::AuthenticatedSymmetricCipher& cypher,
+                                      const unsigned char* iv, size_t ivLength,
+                                      const unsigned char* data, size_t length, unsigned char* output);
+
+            /**
+             * @brief DecryptRecord
+             * Decrypt and authenticate one packet with the key already loaded into the cypher
+             * @param cypher A decrypting cypher with its key set
+             * @param iv The initialisation vector for the packet
+             * @param ivLength The size of iv
+             * @param data The cypher text followed by the MAC
+             * @param length The size of data
+             * @param[out] output Destination for the plain text, must hold length - MacSize bytes
+             * @return DATA_LOSS if the record is too short or fails authentication
+             */
+            static grpc::Status DecryptRecord(CryptoPP::AuthenticatedSymmetricCipher& cypher,
+                                              const unsigned char* iv, size_t ivLength,
+                                              const unsigned char* data, size_t length, unsigned char* output);
+
+            /**
+             * @brief RecordSize
+             * @param ivLength The size of the iv
+             * @param length The size of the plain text
+             * @return The number of bytes AppendRecord will add to an aggregated message
+             */
+            static constexpr size_t RecordSize(size_t ivLength, size_t length)
+            {
+                return HeaderSize + ivLength + length + MacSize;
+            }
+
+            /**
+             * @brief AppendRecord
+             * Encrypt a packet onto the end of an aggregated message
+             * @param[in,out] payload The aggregated message
+             * @param cypher An encrypting cypher with its key set
+             * @param iv The initialisation vector for the packet
+             * @param ivLength The size of iv
+             * @param data The plain text
+             * @param length The size of data
+             */
+            static void AppendRecord(std::string& payload, CryptoPP::AuthenticatedSymmetricCipher& cypher,
+                                     const unsigned char* iv, size_t ivLength,
+                                     const unsigned char* data, size_t length);
+
+            /**
+             * @brief ParseRecords
+             * Split an aggregated message into its records
+             * @param payload The aggregated message
+             * @param ivLength The size of the iv at the start of each record
+             * @param handler Called for each record in order
+             * @return DATA_LOSS if the message is malformed, otherwise the first failure from handler
+             */
+            static grpc::Status ParseRecords(const std::string& payload, size_t ivLength, const RecordHandler& handler);
+        }; // class Records
+    } // namespace tunnels
+} // namespace cqp
@@ -35,6 +35,12 @@ namespace cqp
             stats::Stat<double> decryptTime {{parent, "Decryption Time"}, stats::Units::Count};
             /// The time taken to change the encryption key
             stats::Stat<double> keyChangeTime {{parent, "Key Change Time"}, stats::Units::Count};
+            /// The number of times the tunnel had to wait for a key
+            stats::Stat<size_t> keyStalls {{parent, "Key Stalls"}, stats::Units::Count};
+            /// The time spent waiting for a key which wasn't ready
+            stats::Stat<double> keyStallTime {{parent, "Key Stall Time"}, stats::Units::Count};
+            /// The number of packets sent in each aggregated message
+            stats::Stat<size_t> packetsPerMessage {{parent, "Packets Per Message"}, stats::Units::Count};
 
             /// @copydoc stats::StatCollection::Add
             virtual void Add(stats::IAllStatsCallback* statsCb) override
@@ -43,6 +49,9 @@ namespace cqp
                 encryptTime.Add(statsCb);
                 decryptTime.Add(statsCb);
                 keyChangeTime.Add(statsCb);
+                keyStalls.Add(statsCb);
+                keyStallTime.Add(statsCb);
+                packetsPerMessage.Add(statsCb);
             }
 
             /// @copydoc stats::StatCollection::Remove
@@ -52,6 +61,9 @@ namespace cqp
                 encryptTime.Remove(statsCb);
                 decryptTime.Remove(statsCb);
                 keyChangeTime.Remove(statsCb);
+                keyStalls.Remove(statsCb);
+                keyStallTime.Remove(statsCb);
+                packetsPerMessage.Remove(statsCb);
             }
 
         }; // struct Statistics
@@ -15,6 +15,10 @@
 #include "Networking/Tunnels/TCPServerTunnel.h"
 #include "Networking/Tunnels/TCPTunnel.h"
 #include "Networking/Tunnels/UDPTunnel.h"
+#include "Networking/Tunnels/KeyPrefetcher.h"
+#include "Networking/Tunnels/Records.h"
+#include "Networking/Tunnels/RecordBatch.h"
+#include "Networking/Tunnels/RecentKeys.h"
 #include "Algorithms/Logging/Logger.h"
 #include "KeyManagement/KeyStores/KeyStoreFactory.h"
 #include "KeyManagement/KeyStores/KeyStore.h"
@@ -53,6 +57,7 @@ using cqp::remote::tunnels::TunnelEndDetails;
 #include "Algorithms/Net/DNS.h"
 
 #include <thread>
+#include <future>
 using grpc::Status;
 using grpc::StatusCode;
 using google::protobuf::Empty;
@@ -63,6 +68,8 @@ namespace cqp
     namespace tunnels
     {
         const unsigned long rawInputBufferSize = 2_MiB;
+        /// The most packets to take from the client device at once, each gets an equal share of the input buffer
+        const size_t packetsPerRead = 32;
 
         TunnelBuilder::~TunnelBuilder()
         {
@@ -71,72 +78,86 @@ namespace cqp
             {
                 encodeThread.join();
             }
+            CloseQueues();
         }
 
         TunnelBuilder::TunnelBuilder(const remote::tunnels::CryptoScheme& crypto,
                                      std::shared_ptr<grpc::ChannelCredentials> clientCreds) :
-            clientCreds{clientCreds}
+            cryptoScheme{crypto}, clientCreds{clientCreds}
         {
-            using namespace CryptoPP;
             LOGDEBUG("Cipher Mode=" + crypto.mode() + ", SubMode=" + crypto.submode() + ", BlockCypher=" + crypto.blockcypher());
 
-            // create the process which will encrypt/decrypt data
-            if(crypto.mode() == Modes::GCM && crypto.blockcypher() == BlockCiphers::AES)
+            //  client <--> crypto <--> Serialiser <-> dataChannel
+            //               ^
+            //      keyGen --'
+            // packets are encrypted/decrypted directly between the client buffers and the messages
+            // by the cyphers, see WriteEncrypted and ReadEncrypted
+            // each queue on the client device gets its own cyphers, see NewQueue
+            const auto check = NewQueue(nullptr);
+            if(!check->encryptor || !check->decryptor)
             {
-                if(crypto.submode() == SubModes::Tables2K)
-                {
-                    encryptorCypher.reset(new GCM<AES, GCM_2K_Tables>::Encryption());
-                    decryptorCypher.reset(new GCM<AES, GCM_2K_Tables>::Decryption());
-                }
-                else if(crypto.submode() == SubModes::Tables64K)
-                {
-                    encryptorCypher.reset(new GCM<AES, GCM_64K_Tables>::Encryption());
-                    decryptorCypher.reset(new GCM<AES, GCM_64K_Tables>::Decryption());
-                }
+                // no encryption
+                LOGERROR("No valid encryption selected");
             }
+        }
 
-            if(encryptorCypher)
-            {
-                //  client <--> crypto <--> Serialiser <-> dataChannel
-                //               ^
-                //      keyGen --'
-
-                // the encryption filter uses the encryptorCypher to encrypt the data and put it in the encryptorOutput
+        std::unique_ptr<TunnelBuilder::Queue> TunnelBuilder::NewQueue(DeviceIO* device) const
+        {
+            using namespace CryptoPP;
+            std::unique_ptr<Queue> result{new Queue()};
+            result->device.reset(device);
 
-                try
+            // create the process which will encrypt/decrypt data
+            if(cryptoScheme.mode() == Modes::GCM && cryptoScheme.blockcypher() == BlockCiphers::AES)
+            {
+                if(cryptoScheme.submode() == SubModes::Tables2K)
                 {
-                    encryptor.reset(new AuthenticatedEncryptionFilter(*encryptorCypher, nullptr, /*putAAD*/ false, AES::BLOCKSIZE));
+                    result->encryptor.reset(new GCM<AES, GCM_2K_Tables>::Encryption());
+                    result->decryptor.reset(new GCM<AES, GCM_2K_Tables>::Decryption());
                 }
-                catch (const Exception& e)
+                else if(cryptoScheme.submode() == SubModes::Tables64K)
                 {
-                    LOGERROR(e.what());
+                    result->encryptor.reset(new GCM<AES, GCM_64K_Tables>::Encryption());
+                    result->decryptor.reset(new GCM<AES, GCM_64K_Tables>::Decryption());
                 }
             }
-            else
-            {
-                // no encryption
-                LOGERROR("No valid encryption selected");
-            }
 
-            if(decryptorCypher)
+            result->rng.reset(new AutoSeededX917RNG<AES>());
+
+            if(!result->rng)
             {
-                decryptor.reset(new AuthenticatedDecryptionFilter(
-                                    *decryptorCypher,
-                                    nullptr, // attach will be called when the client is created
-                                    AuthenticatedDecryptionFilter::MAC_AT_END, AES::BLOCKSIZE
-                                ));
+                LOGWARN("Falling back to AutoSeededRandomPool");
+                result->rng.reset(new AutoSeededRandomPool());
             }
-            using namespace CryptoPP;
 
-            rng = new AutoSeededX917RNG<AES>();
+            return result;
+        } // NewQueue
 
-            if(rng == nullptr)
+        TunnelBuilder::Queue* TunnelBuilder::AcquireQueue()
+        {
+            Queue* result = nullptr;
+            std::lock_guard<std::mutex> lock(queuesMutex);
+            for(auto& queue : queues)
             {
-                LOGWARN("Falling back to AutoSeededRandomPool");
-                rng = new AutoSeededRandomPool();
+                if(!queue->inUse)
+                {
+                    queue->inUse = true;
+                    result = queue.get();
+                    break; // for
+                }
             }
+            return result;
+        } // AcquireQueue
 
-        }
+        void TunnelBuilder::CloseQueues()
+        {
+            std::lock_guard<std::mutex> lock(queuesMutex);
+            // the first queue takes the device down when it's destroyed
+            while(!queues.empty())
+            {
+                queues.pop_back();
+            }
+        } // CloseQueues
 
         TunnelBuilder::TunnelBuilder(const remote::tunnels::CryptoScheme& crypto,
                                      const std::string& transferListenAddress,
@@ -211,11 +232,31 @@ namespace cqp
                 // channel for getting keys
                 myKeyFactoryChannel = keyFactoryChannel;
 
+                CloseQueues();
                 // create the device which will read/write unencrypted data
-                client = UriToTunnel(details.clientdataporturi());
+                const URI clientUri(details.clientdataporturi());
+                DeviceIO* client = UriToTunnel(clientUri);
+                std::unique_ptr<Queue> primary = NewQueue(client);
 
-                if(client && encryptor && decryptor)
+                if(client && primary->encryptor && primary->decryptor)
                 {
+                    std::lock_guard<std::mutex> lock(queuesMutex);
+                    queues.push_back(std::move(primary));
+
+                    uint64_t numQueues = 1;
+                    clientUri.GetFirstParameter(TransferParams::queues, numQueues);
+                    while(queues.size() < numQueues)
+                    {
+                        // each extra queue is served by its own stream
+                        DeviceIO* extra = client->OpenQueue();
+                        if(!extra)
+                        {
+                            LOGWARN("Only " + std::to_string(queues.size()) + " of " + std::to_string(numQueues) + " queues could be opened");
+                            break; // while
+                        }
+                        queues.push_back(NewQueue(extra));
+                    }
+
                     keepGoing = true;
                     result = Status();
                 }
@@ -232,9 +273,15 @@ namespace cqp
         void TunnelBuilder::StartTransfer(const std::string& farSide)
         {
             LOGTRACE("");
-            if(client && encryptor && decryptor)
+            bool configured = false;
+            /*lock scope*/
+            {
+                std::lock_guard<std::mutex> lock(queuesMutex);
+                configured = !queues.empty();
+            }/*lock scope*/
+
+            if(configured)
             {
-                decryptor->Attach(new CryptoPP::Redirector(*client));
                 keepGoing = true;
                 encodeThread = std::thread(&TunnelBuilder::EncodingWorker, this, farSide);
             }
@@ -249,55 +296,127 @@ namespace cqp
             }
         } // Shutdown
 
+        void TunnelBuilder::SetAggregation(size_t maxBytes, std::chrono::microseconds flushLatency)
+        {
+            aggregateBytes = maxBytes;
+            aggregateLatency = flushLatency;
+        } // SetAggregation
+
+        void TunnelBuilder::SetKeyPrefetch(size_t depth, std::chrono::milliseconds gracePeriod)
+        {
+            keyPrefetchDepth = depth;
+            keyGracePeriod = gracePeriod;
+        } // SetKeyPrefetch
+
         Status TunnelBuilder::ReadEncrypted(::grpc::internal::ReaderInterface<remote::EncryptedDataValues>* stream,
-                                            remote::IKey::Stub* keyFactory)
+                                            remote::IKey::Stub* keyFactory, Queue& queue)
         {
             LOGTRACE("Starting");
             using namespace CryptoPP;
             Status result;
             remote::SharedKey sharedKey;
             remote::EncryptedDataValues incomming;
+            // decrypted packets are collected so that they can be passed to the client together
+            // the buffer only grows when a larger message arrives
+            SecByteBlock plainText;
+            size_t plainTextUsed = 0;
+            std::vector<size_t> packetEnds;
+            std::vector<net::PacketBuffer> packets;
+            // has the key in sharedKey been loaded into the cypher
+            bool keyScheduled = false;
+            // fetches the keys which the far side announces before they are used
+            KeyPrefetcher keys(keyFactory, currentKeyStoreTo, 0, stats);
+            // keys which were replaced recently
+            RecentKeys recentKeys(keyGracePeriod);
+
+            auto decrypt = [&](const unsigned char* iv, size_t ivLength, const unsigned char* data, size_t length)
+            {
+                Status status = Records::DecryptRecord(*queue.decryptor, iv, ivLength, data, length,
+                                                       plainText.data() + plainTextUsed);
+                if(status.ok())
+                {
+                    plainTextUsed += length - Records::MacSize;
+                    packetEnds.push_back(plainTextUsed);
+                }
+                return status;
+            };
+
             // read encrypted data from the stream
-            while(result.ok() && stream->Read(&incomming) && client && keepGoing)
+            while(result.ok() && stream->Read(&incomming) && keepGoing)
             {
+                if(incomming.iv().empty() && incomming.payload().empty())
+                {
+                    // the far side has a new key ready, fetch our copy before it is used
+                    keys.Prefetch(incomming.keyid());
+                    continue; // while
+                }
+
                 if(incomming.keyid() != sharedKey.keyid())
                 {
-                    LOGDEBUG("Getting key: " + std::to_string(incomming.keyid()));
+                    // keep the old key for a while in case messages using it are still arriving
+                    recentKeys.Add(std::move(sharedKey));
                     sharedKey.Clear();
-                    grpc::ClientContext keyGenContext;
-                    remote::KeyRequest request;
-                    request.set_siteto(currentKeyStoreTo);
-                    request.set_keyid(incomming.keyid());
-                    sharedKey.Clear();
-                    // get the for this data block
-                    if(!LogStatus(keyFactory->GetSharedKey(&keyGenContext, request, &sharedKey)).ok())
+                    keyScheduled = false;
+
+                    if(!recentKeys.Take(incomming.keyid(), sharedKey))
                     {
-                        LOGERROR("Failed to get key " + std::to_string(incomming.keyid()));
+                        LOGDEBUG("Getting key: " + std::to_string(incomming.keyid()));
+                        // get the for this data block, this will have been prefetched if it was announced
+                        if(!keys.GetKey(incomming.keyid(), sharedKey))
+                        {
+                            LOGERROR("Failed to get key " + std::to_string(incomming.keyid()));
+                            sharedKey.Clear();
+                        }
                     }
                 }
 
-                if(decryptorCypher->IsValidKeyLength(sharedKey.keyvalue().size()))
+                if(queue.decryptor->IsValidKeyLength(sharedKey.keyvalue().size()))
                 {
                     using std::chrono::high_resolution_clock;
                     high_resolution_clock::time_point timerStart = high_resolution_clock::now();
 
-                    decryptorCypher->SetKeyWithIV(
-                        reinterpret_cast<const unsigned char*>(sharedKey.keyvalue().data()),
-                        sharedKey.keyvalue().size(),
-                        reinterpret_cast<const unsigned char*>(incomming.iv().data()),
-                        incomming.iv().size());
+                    if(!keyScheduled)
+                    {
+                        // expand the key once, each packet only changes the iv
+                        queue.decryptor->SetKey(reinterpret_cast<const unsigned char*>(sharedKey.keyvalue().data()),
+                                                sharedKey.keyvalue().size());
+                        keyScheduled = true;
+                    }
+                    // the plain text is never longer than the cypher text
+                    plainText.CleanGrow(incomming.payload().size());
 
-                    try
+                    if(!incomming.iv().empty())
                     {
-                        // send data to the input filter
-                        StringSource decryptorInput(incomming.payload(), true, new Redirector(*decryptor));
-                        // because of attachment, the data flows to the decryptor and out to the client
-                        // see ConfigureEndpoint for pipeline setup
+                        // a single packet
+                        result = decrypt(reinterpret_cast<const unsigned char*>(incomming.iv().data()),
+                                         incomming.iv().size(),
+                                         reinterpret_cast<const unsigned char*>(incomming.payload().data()),
+                                         incomming.payload().size());
                     }
-                    catch(const std::exception& e)
+                    else
+                    {
+                        // an aggregated message
+                        result = Records::ParseRecords(incomming.payload(), AES::BLOCKSIZE, decrypt);
+                    } // else
+
+                    if(!packetEnds.empty())
                     {
-                        LOGERROR(e.what());
-                        result = Status(StatusCode::DATA_LOSS, "Decryption failed", e.what());
+                        packets.resize(packetEnds.size());
+                        size_t packetStart = 0;
+                        for(size_t index = 0; index < packetEnds.size(); index++)
+                        {
+                            packets[index].data = plainText.data() + packetStart;
+                            packets[index].bytes = packetEnds[index] - packetStart;
+                            packetStart = packetEnds[index];
+                        }
+
+                        // hand all the packets from the message to the client at once
+                        if(!queue.device->WritePackets(packets, packetEnds.size()))
+                        {
+                            LOGERROR("Failed to send decrypted data to client");
+                        }
+                        plainTextUsed = 0;
+                        packetEnds.clear();
                     }
 
                     stats.decryptTime.Update(high_resolution_clock::now() - timerStart);
@@ -319,29 +438,57 @@ namespace cqp
             // stub for getting existing keys
             auto keyFactory = remote::IKey::NewStub(myKeyFactoryChannel);
 
-            while(!client || !client->WaitUntilReady(std::chrono::milliseconds(1000)))
+            bool configured = false;
+            Queue* queue = nullptr;
+            do
+            {
+                /*lock scope*/
+                {
+                    std::lock_guard<std::mutex> lock(queuesMutex);
+                    configured = !queues.empty();
+                }/*lock scope*/
+
+                // each stream from the far side serves one queue
+                queue = AcquireQueue();
+                if(!queue)
+                {
+                    if(configured)
+                    {
+                        return LogStatus(Status(StatusCode::RESOURCE_EXHAUSTED, "Every queue is in use, the far side has more queues"));
+                    }
+                    LOGINFO("Waiting for client data channel");
+                    std::this_thread::sleep_for(std::chrono::seconds(1));
+                }
+            }
+            while(!queue);
+
+            while(!queue->device->WaitUntilReady(std::chrono::milliseconds(1000)))
             {
                 LOGINFO("Waiting for client data channel");
-                std::this_thread::sleep_for(std::chrono::seconds(1));
             }
 
-            decryptor->Attach(new CryptoPP::Redirector(*client));
             keepGoing = true;
 
             // start reading encrypted data
             auto reader = std::async(std::launch::async, [&]()
             {
-                return LogStatus(ReadEncrypted(stream, keyFactory.get()));
+                return LogStatus(ReadEncrypted(stream, keyFactory.get(), *queue));
             });
 
             // encrypt data and send it
-            result = LogStatus(WriteEncrypted(stream, keyFactory.get()));
+            result = LogStatus(WriteEncrypted(stream, keyFactory.get(), *queue));
             ctx->TryCancel();
             keepGoing = false;
             LOGTRACE("Waiting for reader to finish");
             // wait for reader to stop
             reader.wait();
 
+            /*lock scope*/
+            {
+                std::lock_guard<std::mutex> lock(queuesMutex);
+                queue->inUse = false;
+            }/*lock scope*/
+
             LOGDEBUG("Decryptor finished");
 
             return Status();
@@ -416,7 +563,7 @@ namespace cqp
         }
 
         Status TunnelBuilder::WriteEncrypted(::grpc::internal::WriterInterface<remote::EncryptedDataValues>* stream,
-                                             remote::IKey::Stub* keyFactory)
+                                             remote::IKey::Stub* keyFactory, Queue& queue)
         {
             LOGTRACE("Starting");
             using namespace std;
@@ -428,9 +575,31 @@ namespace cqp
             remote::SharedKey sharedKey;
             uint64_t bytesUsedOnKey = 0;
             high_resolution_clock::time_point timeKeyGenerated;
+            // split the buffer up so that several packets can be read at once
             SecByteBlock buffer(rawInputBufferSize);
-            std::string payload;
-            encryptor->Attach(new StringSink(payload));
+            std::vector<net::PacketBuffer> packets(packetsPerRead);
+            for(size_t index = 0; index < packets.size(); index++)
+            {
+                packets[index].length = buffer.size() / packets.size();
+                packets[index].data = buffer.data() + index * packets[index].length;
+            }
+            // has the key in sharedKey been loaded into the cypher
+            bool keyScheduled = false;
+            SecByteBlock iv(AES::BLOCKSIZE);
+            // reused for each packet when not aggregating so that the payload keeps its storage
+            remote::EncryptedDataValues messageData;
+            // keeps keys ready so that changing key doesn't stall
+            KeyPrefetcher keys(keyFactory, currentKeyStoreTo, keyPrefetchDepth, stats);
+
+            // packets waiting to be sent when aggregating
+            std::unique_ptr<RecordBatch> batch;
+            if(aggregateBytes > 0)
+            {
+                batch.reset(new RecordBatch(aggregateBytes, aggregateLatency, [stream](const remote::EncryptedDataValues& message)
+                {
+                    return stream->Write(message);
+                }, stats));
+            }
 
             while(keyFactory && keepGoing && stream)
             {
@@ -447,15 +616,13 @@ namespace cqp
 
                         LOGDEBUG("Getting new shared key");
 
-                        // try and get a key
+                        // try and get a key, normally one is already waiting
                         do
                         {
-                            grpc::ClientContext keyGenContext;
-                            remote::KeyRequest request;
-                            request.set_siteto(currentKeyStoreTo);
                             // if the Get succeeds, update the trigger values
-                            if(LogStatus(keyFactory->GetSharedKey(&keyGenContext, request, &sharedKey)).ok())
+                            if(keys.NextKey(sharedKey, std::chrono::milliseconds(1000)))
                             {
+                                keyScheduled = false;
                                 bytesUsedOnKey = 0;
                                 timeKeyGenerated = high_resolution_clock::now();
                                 stats.keyChangeTime.Update(high_resolution_clock::now() - timerStart);
@@ -472,55 +639,87 @@ namespace cqp
 
                     } // if
 
-                    if(encryptorCypher->IsValidKeyLength(sharedKey.keyvalue().size()))
+                    // tell the far side about keys we will use so that it can fetch them in advance
+                    for(const auto keyId : keys.TakeNewKeyIds())
                     {
-                        size_t numRead = 0;
-                        if(!client->Read(buffer.begin(), buffer.SizeInBytes(), numRead))
+                        remote::EncryptedDataValues announcement;
+                        announcement.set_keyid(keyId);
+                        // when aggregating, the batch keeps the announcement in order with the records
+                        if(!(batch ? batch->Send(announcement) : stream->Write(announcement)))
                         {
-                            LOGERROR("Client Socket closed.");
+                            LOGERROR("Failed to send key announcement");
                             keepGoing = false;
                         }
+                    }
 
-                        if(numRead > 0)
+                    if(queue.encryptor->IsValidKeyLength(sharedKey.keyvalue().size()))
+                    {
+                        if(!keyScheduled)
                         {
-                            using std::chrono::high_resolution_clock;
-                            high_resolution_clock::time_point timerStart = high_resolution_clock::now();
+                            // expand the key once, each packet only changes the iv
+                            queue.encryptor->SetKey(reinterpret_cast<const unsigned char*>(sharedKey.keyvalue().data()),
+                                                    sharedKey.keyvalue().size());
+                            keyScheduled = true;
+                        }
 
-                            SecByteBlock iv(AES::BLOCKSIZE);
-                            rng->GenerateBlock(iv, iv.size());
+                        size_t packetsRead = 0;
+                        if(!queue.device->ReadPackets(packets, packetsRead))
+                        {
+                            LOGERROR("Client Socket closed.");
+                            keepGoing = false;
+                        }
 
-                            encryptorCypher->SetKeyWithIV(
-                                reinterpret_cast<const unsigned char*>(sharedKey.keyvalue().data()),
-                                sharedKey.keyvalue().size(),
-                                iv,
-                                iv.size());
+                        for(size_t packet = 0; packet < packetsRead; packet++)
+                        {
+                            const auto* packetData = static_cast<const unsigned char*>(packets[packet].data);
+                            const size_t numRead = packets[packet].bytes;
 
-                            remote::EncryptedDataValues messageData;
-                            // build data to send to the other side
-                            messageData.set_keyid(sharedKey.keyid());
-                            messageData.mutable_iv()->assign(reinterpret_cast<const char*>(iv.data()), iv.size());
+                            using std::chrono::high_resolution_clock;
+                            high_resolution_clock::time_point timerStart = high_resolution_clock::now();
 
-                            // push data into the encryptor
-                            encryptor->Put2(buffer.data(), numRead, -1, true);
-                            // because of earlier attachment, the encryptor output will be put into the message payload
-                            messageData.set_payload(payload);
+                            queue.rng->GenerateBlock(iv, iv.size());
 
-                            // send for decryption at the other side
-                            if(!stream->Write(messageData))
+                            if(!batch)
                             {
-                                LOGERROR("Failed to send encrypted message");
-                                keepGoing = false;
+                                // build data to send to the other side
+                                messageData.set_keyid(sharedKey.keyid());
+                                messageData.mutable_iv()->assign(reinterpret_cast<const char*>(iv.data()), iv.size());
+                                std::string& cypherText = *messageData.mutable_payload();
+                                cypherText.resize(numRead + Records::MacSize);
+                                // encrypt straight into the message: cypher text | mac
+                                Records::EncryptRecord(*queue.encryptor, iv, iv.size(), packetData, numRead,
+                                                       reinterpret_cast<unsigned char*>(&cypherText[0]));
+
+                                // send for decryption at the other side
+                                if(!stream->Write(messageData))
+                                {
+                                    LOGERROR("Failed to send encrypted message");
+                                    keepGoing = false;
+                                }
                             }
+                            else
+                            {
+                                // add the record to the current message: length | iv | cypher text | mac
+                                const bool sent = batch->Add(sharedKey.keyid(), Records::RecordSize(iv.size(), numRead),
+                                                             [&](std::string& payload)
+                                {
+                                    Records::AppendRecord(payload, *queue.encryptor, iv, iv.size(), packetData, numRead);
+                                });
+
+                                if(!sent)
+                                {
+                                    keepGoing = false;
+                                }
+                            } // else
 
                             // track the number of bytes this key has encrypted
                             bytesUsedOnKey += numRead;
 
-                            payload.clear();
-                            buffer.CleanNew(buffer.size());
+                            SecureWipeBuffer(static_cast<unsigned char*>(packets[packet].data), numRead);
 
                             stats.encryptTime.Update(high_resolution_clock::now() - timerStart);
                             stats.bytesEncrypted.Update(numRead);
-                        }
+                        } // for packets
 
                     }
                     else
@@ -536,13 +735,48 @@ namespace cqp
 
             } // while(keepGoing)
 
+            if(batch)
+            {
+                // anything left over is sent so the far side is not missing the end of the data
+                batch->Stop();
+            }
+
             LOGTRACE("Ending");
             return result;
         }
 
+        void TunnelBuilder::TransferQueue(remote::ITransfer::Stub* farSide, remote::IKey::Stub* keyFactory, Queue& queue)
+        {
+            grpc::ClientContext transferContext;
+            auto farSideStream = farSide->Transfer(&transferContext);
+
+            // launch a thread to decrypt the data
+            auto reader = std::async(std::launch::async, [&]()
+            {
+                return LogStatus(ReadEncrypted(farSideStream.get(), keyFactory, queue));
+            });
+
+            // read data an encrypt it
+            LogStatus(WriteEncrypted(farSideStream.get(), keyFactory, queue));
+            // the tunnel stops when any of its queues stop
+            keepGoing = false;
+
+            transferContext.TryCancel();
+            // encryptor has finished, wait for reader to finish
+            if(farSideStream)
+            {
+                farSideStream->WritesDone();
+            }
+            reader.wait();
+
+            if(farSideStream)
+            {
+                LogStatus(farSideStream->Finish());
+            }
+        } // TransferQueue
+
         void TunnelBuilder::EncodingWorker(std::string farSide)
         {
-            Status result;
             auto keyFactory = remote::IKey::NewStub(myKeyFactoryChannel);
             // channel for transferring the encrypted data
             // communication with peer
@@ -554,35 +788,33 @@ namespace cqp
                 auto farSide = remote::ITransfer::NewStub(farSideEP);
 
                 // create a pipeline which will react to data from the client and pass it to the encryptor
-
-                while(!client->WaitUntilReady())
+                std::vector<Queue*> myQueues;
+                for(Queue* queue = AcquireQueue(); queue != nullptr; queue = AcquireQueue())
                 {
-                    LOGINFO("Waiting for client");
+                    myQueues.push_back(queue);
                 }
 
-                grpc::ClientContext transferContext;
-                auto farSideStream = farSide->Transfer(&transferContext);
-
-                // launch a thread to decrypt the data
-                auto reader = std::async(std::launch::async, [&]()
+                if(!myQueues.empty())
                 {
-                    return LogStatus(ReadEncrypted(farSideStream.get(), keyFactory.get()));
-                });
+                    while(!myQueues[0]->device->WaitUntilReady())
+                    {
+                        LOGINFO("Waiting for client");
+                    }
 
-                // read data an encrypt it
-                result = LogStatus(WriteEncrypted(farSideStream.get(), keyFactory.get()));
+                    // each extra queue has its own stream and cyphers so that they don't contend
+                    std::vector<std::future<void>> workers;
+                    for(size_t index = 1; index < myQueues.size(); index++)
+                    {
+                        workers.push_back(std::async(std::launch::async, &TunnelBuilder::TransferQueue, this,
+                                                     farSide.get(), keyFactory.get(), std::ref(*myQueues[index])));
+                    }
 
-                transferContext.TryCancel();
-                // encryptor has finished, wait for reader to finish
-                if(farSideStream)
-                {
-                    farSideStream->WritesDone();
-                }
-                reader.wait();
+                    TransferQueue(farSide.get(), keyFactory.get(), *myQueues[0]);
 
-                if(farSideStream)
-                {
-                    LogStatus(farSideStream->Finish());
+                    for(auto& worker : workers)
+                    {
+                        worker.wait();
+                    }
                 }
             }
             else
@@ -590,8 +822,7 @@ namespace cqp
                 LOGERROR("Failed to connect to far side");
             }
 
-            delete client;
-            client = nullptr;
+            CloseQueues();
             keepGoing = false;
 
             LOGDEBUG("Encryptor finished");
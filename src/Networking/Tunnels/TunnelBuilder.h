@@ -18,6 +18,10 @@
 #include <cryptopp/secblock.h>
 #include <cryptopp/filters.h>
 #include <thread>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <memory>
 #include <grpc++/security/server_credentials.h>
 #include "Algorithms/Util/Strings.h"
 #include <grpcpp/security/credentials.h>
@@ -96,6 +100,20 @@ namespace cqp
             /// clavis 2 QKD device
             CONSTSTRING clavis2 = "clavis2";
         }
+        /// Parameters in the client data port uri which control how the encrypted data is sent
+        namespace TransferParams
+        {
+            /// The largest number of bytes to pack into one message, see TunnelBuilder::SetAggregation
+            CONSTSTRING aggregate = "aggregate";
+            /// The longest time in microseconds a packet will wait to be sent, see TunnelBuilder::SetAggregation
+            CONSTSTRING aggregateLatency = "aggregateLatency";
+            /// The number of keys to fetch in advance, see TunnelBuilder::SetKeyPrefetch
+            CONSTSTRING keyPrefetch = "keyPrefetch";
+            /// How long in milliseconds to accept the previous keys for, see TunnelBuilder::SetKeyPrefetch
+            CONSTSTRING keyGracePeriod = "keyGracePeriod";
+            /// The number of device queues to serve, each has its own stream and thread. Both ends must match
+            CONSTSTRING queues = "queues";
+        }
         /**
          * @brief The TunnelBuilder class
          * Constructs the sockets needed to transfer the data
@@ -151,6 +169,35 @@ namespace cqp
              */
             void Shutdown();
 
+            /**
+             * @brief SetAggregation
+             * Pack several encrypted packets into each message sent to the peer, reducing the number of
+             * writes to the stream when there are many small packets.
+             * @details
+             * Each packet is still encrypted and authenticated with its own IV. A message is sent once
+             * it reaches maxBytes or its first packet has waited for flushLatency.
+             * The receiving side handles either kind of message, so only the sender needs to enable this.
+             * Takes effect on the next transfer.
+             * @param maxBytes The largest payload to send in one message, 0 sends each packet on its own
+             * @param flushLatency The longest time a packet will wait for others to join it
+             */
+            void SetAggregation(size_t maxBytes, std::chrono::microseconds flushLatency = std::chrono::microseconds(500));
+
+            /**
+             * @brief SetKeyPrefetch
+             * Control how keys are fetched ahead of being needed.
+             * @details
+             * The encrypting side keeps depth keys ready and tells the far side their ids so that it
+             * can fetch them before they are used. Once the far side changes key, the old key is kept for
+             * gracePeriod so that messages which were already in flight can still be decrypted.
+             * The announcements are messages with no iv or payload, which peers without this support
+             * reject, so prefetching is off until this is called with a depth on the encrypting side.
+             * Takes effect on the next transfer.
+             * @param depth The number of keys to fetch in advance, 0 fetches each key when it's needed
+             * @param gracePeriod How long to accept the previous keys for
+             */
+            void SetKeyPrefetch(size_t depth, std::chrono::milliseconds gracePeriod = std::chrono::milliseconds(2000));
+
             ///@{
             /// ITransfer interface
 
@@ -185,10 +232,10 @@ namespace cqp
                         end note
                         alt the key has changed
                             TunnelBuilder -> KeyFactory : GetSharedKey(keyId)
+                            TunnelBuilder -> decryptorCypher : SetKey
                         end alt
-                        TunnelBuilder -> decryptorCypher : SetKeyWithIV
-                        TunnelBuilder -> decryptorCypher : Decrypt(payload)
-                        TunnelBuilder -> client : Send
+                        TunnelBuilder -> decryptorCypher : DecryptAndVerify(iv, payload)
+                        TunnelBuilder -> client : WritePackets
 
                     end loop
 
@@ -206,6 +253,52 @@ namespace cqp
             /// stats created my this class
             Statistics stats;
         protected:
+            /// A queue on the client device with everything needed to encrypt and decrypt its packets
+            /// so that it can be served by its own thread
+            struct Queue
+            {
+                /// endpoint to send/receive unencrypted data
+                std::unique_ptr<DeviceIO> device;
+                /// encryptor cypher, the key schedule is only rebuilt when the key changes
+                std::unique_ptr<CryptoPP::AuthenticatedSymmetricCipher> encryptor;
+                /// decryptor cypher, the key schedule is only rebuilt when the key changes
+                std::unique_ptr<CryptoPP::AuthenticatedSymmetricCipher> decryptor;
+                /// random number generator for the ivs
+                std::unique_ptr<CryptoPP::RandomNumberGenerator> rng;
+                /// true while a transfer is using the queue
+                bool inUse = false;
+            };
+
+            /**
+             * @brief NewQueue
+             * Create the cyphers for a device queue
+             * @param device The queue, ownership is taken
+             * @return A queue, the cyphers are null if the crypto scheme isn't supported
+             */
+            std::unique_ptr<Queue> NewQueue(DeviceIO* device) const;
+
+            /**
+             * @brief AcquireQueue
+             * Find a queue which isn't being used by a transfer and mark it as in use
+             * @return The queue or nullptr if they are all in use
+             */
+            Queue* AcquireQueue();
+
+            /**
+             * @brief CloseQueues
+             * Destroy the queues, extra queues are destroyed before the one which created the device
+             */
+            void CloseQueues();
+
+            /**
+             * @brief TransferQueue
+             * Open a stream to the far side and pass the packets for one queue over it until the tunnel stops
+             * @param farSide The peer
+             * @param keyFactory source of keys
+             * @param queue The queue to serve
+             */
+            void TransferQueue(remote::ITransfer::Stub* farSide, remote::IKey::Stub* keyFactory, Queue& queue);
+
             /**
              * @brief UriToTunnel
              * Construct a suitable io device for the url specified
@@ -236,17 +329,19 @@ namespace cqp
                     loop
                         alt Key needs changing
                             TunnelBuilder -> KeyFactory : GetSharedKey()
+                            TunnelBuilder -> encryptorCypher : SetKey()
                         end alt
-                        TunnelBuilder -> rng : GenerateBlock()
-                        note right : Create a new IV
-                        TunnelBuilder -> encryptorCypher : SetKeyWithIV()
 
-                        TunnelBuilder -> client : Read()
+                        TunnelBuilder -> client : ReadPackets()
                         note over TunnelBuilder
                             Wait for incoming data
                         end note
-                        TunnelBuilder -> encryptorCypher : PushData()
-                        TunnelBuilder -> ITransfer : Transfer(encryptedData)
+                        loop each packet
+                            TunnelBuilder -> rng : GenerateBlock()
+                            note right : Create a new IV
+                            TunnelBuilder -> encryptorCypher : EncryptAndAuthenticate(iv, packet)
+                            TunnelBuilder -> ITransfer : Transfer(encryptedData)
+                        end loop
 
                     end loop
 
@@ -265,17 +360,12 @@ namespace cqp
                                   uint64_t bytesUsedOnKey,
                                   const std::chrono::high_resolution_clock::time_point& timeKeyGenerated);
 
-            /// encryptor cypher
-            std::unique_ptr<CryptoPP::AuthenticatedSymmetricCipher> encryptorCypher = nullptr;
-            /// encryptor
-            std::unique_ptr<CryptoPP::StreamTransformationFilter> encryptor = nullptr;
-            /// decryptor cypher
-            std::unique_ptr<CryptoPP::AuthenticatedSymmetricCipher> decryptorCypher = nullptr;
-            /// decryptor
-            std::unique_ptr<CryptoPP::AuthenticatedDecryptionFilter> decryptor = nullptr;
-
-            /// endpoint to send/receive unencrypted data
-            DeviceIO* client = nullptr;
+            /// The kind of encryption to use, each queue has its own cyphers
+            remote::tunnels::CryptoScheme cryptoScheme;
+            /// Queues on the client device, the first one created the device
+            std::vector<std::unique_ptr<Queue>> queues;
+            /// protects queues
+            std::mutex queuesMutex;
             /// source of keys
             std::shared_ptr<grpc::Channel> myKeyFactoryChannel;
             /// when to change keys
@@ -286,8 +376,6 @@ namespace cqp
             std::thread encodeThread;
             /// should the encryptor stop
             std::atomic_bool keepGoing {true};
-            /// random number generator
-            CryptoPP::RandomNumberGenerator* rng = nullptr;
             /// our server for our peer to connect to
             std::shared_ptr<grpc::Server> server;
             /// how to connect to our peer
@@ -295,11 +383,19 @@ namespace cqp
             std::string transferListenHost;
             /// The port the transfer service is listening on
             int transferListenPort = 0;
+            /// the largest payload for aggregated messages, 0 = no aggregation
+            size_t aggregateBytes = 0;
+            /// the longest a packet will be held waiting for an aggregated message to fill
+            std::chrono::microseconds aggregateLatency {500};
+            /// the number of keys to fetch before they are needed, 0 = off as older peers can't handle the announcements
+            size_t keyPrefetchDepth = 0;
+            /// how long old keys are accepted for after the far side changes key
+            std::chrono::milliseconds keyGracePeriod {2000};
         private:
             grpc::Status ReadEncrypted(::grpc::internal::ReaderInterface<remote::EncryptedDataValues>* stream,
-                                       remote::IKey::Stub* keyFactory);
+                                       remote::IKey::Stub* keyFactory, Queue& queue);
             grpc::Status WriteEncrypted(::grpc::internal::WriterInterface<remote::EncryptedDataValues>* stream,
-                                        remote::IKey::Stub* keyFactory);
+                                        remote::IKey::Stub* keyFactory, Queue& queue);
         };
 
     }
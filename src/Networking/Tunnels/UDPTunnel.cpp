@@ -49,6 +49,16 @@ namespace cqp
             return Datagram::Write(data, length);
         }
 
+        bool UDPTunnel::ReadPackets(std::vector<net::PacketBuffer>& packets, size_t& packetsReceived)
+        {
+            return Datagram::ReadMany(packets, packetsReceived);
+        }
+
+        bool UDPTunnel::WritePackets(const std::vector<net::PacketBuffer>& packets, size_t numPackets)
+        {
+            return Datagram::WriteMany(packets, numPackets);
+        }
+
     } // namespace tunnels
 } // namespace cqp
 
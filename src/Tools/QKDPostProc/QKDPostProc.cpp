@@ -46,6 +46,8 @@ struct Names
     static CONSTSTRING filterFineCutoff = "filter-fine";
     static CONSTSTRING filterStride = "filter-stride";
     static CONSTSTRING rawOut = "out";
+    static CONSTSTRING offsetMax = "offset-max";
+    static CONSTSTRING offsetBruteForce = "offset-brute";
 };
 
 QKDPostProc::QKDPostProc()
@@ -94,6 +96,9 @@ QKDPostProc::QKDPostProc()
     .Bind();
     definedArguments.AddOption(Names::rawOut, "o", "Output final raw qubits to file")
     .Bind();
+    definedArguments.AddOption(Names::offsetMax, "O", "The largest slot offset to search for")
+    .Bind();
+    definedArguments.AddOption(Names::offsetBruteForce, "B", "Compare every offset individually instead of checking candidates found by correlation");
 }
 
 void QKDPostProc::DisplayHelp(const CommandArgs::Option&)
@@ -273,10 +278,17 @@ int QKDPostProc::Main(const std::vector<std::string>& args)
                 else
                 {
 
-                    align::Offsetting offsetting(10000);
+                    uint64_t offsetMax = 8000;
+                    definedArguments.GetProp(Names::offsetMax, offsetMax);
+                    auto method = align::Offsetting::Method::CoarseToFine;
+                    if(definedArguments.IsSet(Names::offsetBruteForce))
+                    {
+                        method = align::Offsetting::Method::BruteForce;
+                    }
+                    align::Offsetting offsetting(10000, method);
 
                     const auto startTime = std::chrono::high_resolution_clock::now();
-                    align::Offsetting::Confidence highest = offsetting.HighestValue(aliceQubits, validSlots, receiverResults, 0, 8000);
+                    align::Offsetting::Confidence highest = offsetting.HighestValue(aliceQubits, validSlots, receiverResults, 0, static_cast<int64_t>(offsetMax));
 
                     const auto offsettingTime = std::chrono::high_resolution_clock::now() - startTime;
                     cout << "Offsetting Offset = " << highest.offset << "\n";
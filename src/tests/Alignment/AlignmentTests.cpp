@@ -28,6 +28,7 @@
 #include <chrono>
 #include "Algorithms/Util/DataFile.h"
 #include "Algorithms/Alignment/Filter.h"
+#include "Algorithms/Datatypes/DetectionFrame.h"
 
 namespace cqp
 {
@@ -294,6 +295,265 @@ namespace cqp
             ASSERT_EQ(testData.emissions, alignedDetections);
         }
 
+        TEST_F(AlignmentTests, GatingPeakAtSlotEdge)
+        {
+            const PicoSeconds pulseWidth            {100};
+            const PicoSeconds slotWidth             {std::chrono::nanoseconds(10)};
+
+            // the peak is on the edge of the slot then in the middle of it
+            for(const auto phase : {PicoSeconds(0), slotWidth / 2})
+            {
+                const QubitList emissions = rng->RandQubitList(10000);
+                DetectionReportList detections;
+                align::Gating::ValidSlots expectedSlots;
+                QubitList expectedValues;
+
+                if(phase > PicoSeconds(0))
+                {
+                    // a dark count starts the frame so the slots are counted from half a slot before the peak
+                    detections.push_back({PicoSeconds(0), rng->RandQubit()});
+                }
+
+                for(auto index = 0u; index < emissions.size(); index++)
+                {
+                    if(index == 0 || rng->SRandInt() % 2)
+                    {
+                        // spread the detections both sides of the centre of the peak
+                        const int64_t spread = index == 0 ? 0 : static_cast<int64_t>(rng->SRandInt() % 121) - 60;
+                        const auto time = static_cast<int64_t>((slotWidth * index + phase).count()) + spread;
+                        detections.push_back({PicoSeconds(static_cast<PicoSeconds::rep>(time)), emissions[index]});
+                        expectedSlots.push_back(phase > PicoSeconds(0) ? index + 1 : index);
+                        expectedValues.push_back(emissions[index]);
+                    }
+                }
+
+                align::Gating gating(rng, slotWidth, pulseWidth);
+                align::Gating::ValidSlots validSlots;
+                QubitList results;
+                gating.ExtractQubits(detections.cbegin(), detections.cend(), validSlots, results);
+
+                // every detection in the peak should be in the slot it was sent in
+                ASSERT_EQ(validSlots, expectedSlots);
+                ASSERT_EQ(results, expectedValues);
+            }
+        }
+
+        TEST_F(AlignmentTests, FlatGating)
+        {
+            const PicoSeconds pulseWidth            {100};
+            const std::chrono::nanoseconds slotWidth  {10};
+            DetectionReportList detections;
+
+            // enough detections to be split between threads
+            PicoSeconds time{1};
+            for(auto index = 0u; index < 300000; index++)
+            {
+                const auto roll = rng->SRandInt() % 4;
+                if(roll == 0)
+                {
+                    // noise, away from the peak
+                    detections.push_back({time + PicoSeconds(5000), rng->RandQubit()});
+                }
+                else if(roll != 1)
+                {
+                    detections.push_back({time, rng->RandQubit()});
+                }
+                time += slotWidth;
+            }
+
+            align::Gating gating(rng, slotWidth, pulseWidth);
+            gating.SetDrift(1.0e-6);
+
+            align::Gating::CountsByBin referenceCounts;
+            align::Gating::ResultsByBinBySlot resultsBySlot;
+            align::Gating::ValidSlots referenceSlots;
+            QubitList referenceResults;
+            double referenceWidth = 0.0;
+            gating.CountDetections(detections.cbegin()->time, detections.cbegin(), detections.cend(), referenceCounts, resultsBySlot);
+            gating.GateResults(referenceCounts, resultsBySlot, referenceSlots, referenceResults, &referenceWidth);
+
+            align::Gating::CountsByBin counts;
+            align::Gating::SlotsByDetection slots;
+            align::Gating::BinsByDetection bins;
+            align::Gating::ValidSlots validSlots;
+            QubitList results;
+            double peakWidth = 0.0;
+            gating.CountDetections(detections.cbegin()->time, detections.cbegin(), detections.cend(), counts, slots, bins);
+            gating.GateResults(counts, detections.cbegin(), slots, bins, validSlots, results, &peakWidth);
+
+            // there is at most one detection per slot so the results should be identical
+            ASSERT_EQ(counts, referenceCounts);
+            ASSERT_EQ(peakWidth, referenceWidth);
+            ASSERT_LT(validSlots.size(), detections.size());
+            ASSERT_EQ(validSlots, referenceSlots);
+            ASSERT_EQ(results, referenceResults);
+        }
+
+        TEST_F(AlignmentTests, DetectionFrame)
+        {
+            const PicoSeconds pulseWidth            {100};
+            const std::chrono::nanoseconds slotWidth  {10};
+            DetectionReportList detections;
+
+            // sparse noise either side of a transmission with drift
+            PicoSeconds time{1};
+            for(auto index = 0u; index < 5000; index++)
+            {
+                detections.push_back({time, rng->RandQubit()});
+                time += PicoSeconds(1000000 + rng->SRandInt() % 1000);
+            }
+            for(auto index = 0u; index < 200000; index++)
+            {
+                if(rng->SRandInt() % 2)
+                {
+                    detections.push_back({time, rng->RandQubit()});
+                }
+                time += slotWidth + PicoSeconds(1);
+            }
+            for(auto index = 0u; index < 5000; index++)
+            {
+                time += PicoSeconds(1000000 + rng->SRandInt() % 1000);
+                detections.push_back({time, rng->RandQubit()});
+            }
+
+            const DetectionFrame frame(detections);
+            ASSERT_EQ(frame.size(), detections.size());
+            DetectionReportList roundTrip;
+            frame.ToReports(roundTrip);
+            ASSERT_EQ(roundTrip, detections);
+
+            // both forms should produce the same results
+            align::Filter filter;
+            DetectionReportList::const_iterator listStart;
+            DetectionReportList::const_iterator listEnd;
+            size_t frameStart = 0;
+            size_t frameEnd = 0;
+            const bool listIsolated = filter.Isolate(detections, listStart, listEnd);
+            ASSERT_EQ(filter.Isolate(frame, frameStart, frameEnd), listIsolated);
+            ASSERT_EQ(frameStart, static_cast<size_t>(std::distance(detections.cbegin(), listStart)));
+            ASSERT_EQ(frameEnd, static_cast<size_t>(std::distance(detections.cbegin(), listEnd)));
+            ASSERT_LT(frameStart, frameEnd);
+
+            const DetectionView transmission = DetectionView(frame).Slice(frameStart, frameEnd);
+            align::Drift drift(slotWidth, pulseWidth, slotWidth * 100);
+            const double listDrift = drift.Calculate(listStart, listEnd);
+            const double frameDrift = drift.Calculate(transmission);
+            ASSERT_NE(listDrift, 0.0);
+            // the samples are split in the same way so the results are identical
+            ASSERT_EQ(frameDrift, listDrift);
+            ASSERT_EQ(drift.ChannelFindPeak(transmission), drift.ChannelFindPeak(listStart, listEnd));
+
+            align::Gating gating(rng, slotWidth, pulseWidth);
+            gating.SetDrift(listDrift);
+            align::Gating::ValidSlots listSlots;
+            QubitList listResults;
+            gating.ExtractQubits(listStart, listEnd, listSlots, listResults);
+
+            align::Gating::ValidSlots frameSlots;
+            QubitList frameResults;
+            gating.ExtractQubits(transmission, frameSlots, frameResults);
+
+            ASSERT_GT(frameSlots.size(), 0);
+            ASSERT_EQ(frameSlots, listSlots);
+            ASSERT_EQ(frameResults, listResults);
+        }
+
+        TEST_F(AlignmentTests, CorrelationOffset)
+        {
+            const size_t trueOffset = 1234;
+            QubitList truth = rng->RandQubitList(100000);
+            std::vector<SlotID> validSlots;
+            QubitList irregular;
+            QubitsBySlot markers;
+
+            for(auto slot = 0u; slot + trueOffset < truth.size(); slot++)
+            {
+                if(rng->SRandInt() % 4 == 0)
+                {
+                    validSlots.push_back(slot);
+                    // add some errors
+                    if(rng->SRandInt() % 20 == 0)
+                    {
+                        irregular.push_back(rng->RandQubit());
+                    }
+                    else
+                    {
+                        irregular.push_back(truth[slot + trueOffset]);
+                    }
+                }
+            }
+            for(auto slot = 0u; slot < truth.size(); slot += 10)
+            {
+                markers.emplace(slot, truth[slot]);
+            }
+
+            // every value is used so the scores are identical
+            align::Offsetting bruteForce(irregular.size());
+            align::Offsetting correlation(irregular.size(), align::Offsetting::Method::Correlation);
+
+            const auto expected = bruteForce.HighestValue(truth, validSlots, irregular, 0, 2000);
+            const auto highest = correlation.HighestValue(truth, validSlots, irregular, 0, 2000);
+            ASSERT_EQ(expected.offset, static_cast<int64_t>(trueOffset));
+            ASSERT_EQ(highest.offset, static_cast<int64_t>(trueOffset));
+            ASSERT_DOUBLE_EQ(highest.value, expected.value);
+
+            for(const auto& candidate : correlation.Correlate(truth, validSlots, irregular, -500, 20000, 0, 10))
+            {
+                ASSERT_DOUBLE_EQ(candidate.value, bruteForce.CompareValues(truth, validSlots, irregular, candidate.offset));
+            }
+
+            align::Offsetting markerCorrelation(0, align::Offsetting::Method::Correlation);
+            const auto markerBest = markerCorrelation.Correlate(markers, validSlots, irregular, 0, 20000, 0, 3);
+            ASSERT_EQ(markerBest.size(), 3u);
+            ASSERT_EQ(markerBest[0].offset, static_cast<int64_t>(trueOffset));
+            for(const auto& candidate : markerBest)
+            {
+                ASSERT_DOUBLE_EQ(candidate.value, markerCorrelation.CompareValues(markers, validSlots, irregular, candidate.offset));
+            }
+
+            // a range which would be too slow to check by brute force
+            align::Offsetting coarseToFine(align::Offsetting::DefaultSamples, align::Offsetting::Method::CoarseToFine);
+            const auto wide = coarseToFine.HighestValue(truth, validSlots, irregular, -50000, 50000);
+            ASSERT_EQ(wide.offset, static_cast<int64_t>(trueOffset));
+            ASSERT_GT(wide.value, 0.9);
+        }
+
+        TEST_F(AlignmentTests, SparseMarkerOffset)
+        {
+            // a long, lossy frame with markers requested the way DetectionReciever does
+            const size_t trueOffset = 1234;
+            const size_t numEmissions = 16000000;
+            const QubitList truth = rng->RandQubitList(numEmissions + trueOffset);
+            std::vector<SlotID> validSlots;
+            QubitList irregular;
+
+            for(auto slot = 0u; slot < numEmissions; slot++)
+            {
+                // 1% of the photons are detected
+                if(rng->SRandInt() % 100 == 0)
+                {
+                    validSlots.push_back(slot);
+                    irregular.push_back(truth[slot + trueOffset]);
+                }
+            }
+
+            QubitsBySlot markers;
+            const size_t numMarkers = static_cast<size_t>(validSlots.size() * 0.1);
+            while(markers.size() < numMarkers)
+            {
+                const auto slot = rng->RandULong() % truth.size();
+                markers.emplace(slot, truth[slot]);
+            }
+
+            align::Offsetting offsetting(0, align::Offsetting::Method::Correlation);
+            // too few markers overlap the detections within MaxCorrelationSpan to score any offset
+            ASSERT_TRUE(offsetting.Correlate(markers, validSlots, irregular, 1000, 1500, 0).empty());
+
+            const auto highest = offsetting.HighestValue(markers, validSlots, irregular, 1000, 1500);
+            ASSERT_EQ(highest.offset, static_cast<int64_t>(trueOffset));
+            ASSERT_DOUBLE_EQ(highest.value, 1.0);
+        }
+
         TEST_F(AlignmentTests, SimlatedSource)
         {
             RandomNumber rng;
@@ -0,0 +1,98 @@
+/*!
+* @file
+* @brief BenchErrorCorrection
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+
+#include "benchmark/benchmark.h"
+#include "CQPToolkit/ErrorCorrection/Ldpc.h"
+#include <random>
+
+namespace cqp
+{
+    namespace tests
+    {
+        /**
+         * @brief MakeBlocks
+         * Create a key and a copy with errors
+         * @param numBits Length of the keys
+         * @param qber The fraction of bits to change
+         * @param[out] alice The original key
+         * @param[out] bob The key with errors
+         */
+        static void MakeBlocks(size_t numBits, double qber, PackedBits& alice, PackedBits& bob)
+        {
+            std::mt19937_64 rng(1234);
+            std::bernoulli_distribution errorDist(qber);
+            alice.resize(numBits / bitsPerWord);
+            for(auto& word : alice)
+            {
+                word = rng();
+            }
+
+            bob = alice;
+            for(size_t bit = 0; bit < numBits; bit++)
+            {
+                if(errorDist(rng))
+                {
+                    FlipBit(bob, bit);
+                }
+            }
+        }
+
+        static void BM_LdpcSyndrome(benchmark::State& state)
+        {
+            const double qber = static_cast<double>(state.range(0)) / 1000.0;
+            ec::LdpcCodeFamily codes;
+            const auto code = codes.GetCode(codes.ChecksFor(qber, 1.4));
+            PackedBits alice;
+            PackedBits bob;
+            MakeBlocks(code->NumBits(), qber, alice, bob);
+
+            for(auto _ : state)
+            {
+                benchmark::DoNotOptimize(code->Syndrome(alice));
+            }
+
+            state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * code->NumBits()));
+            state.SetLabel("Syndrome of one block, items are bits");
+        }
+        BENCHMARK(BM_LdpcSyndrome)->Arg(10)->Arg(30)->Arg(60);
+
+        static void BM_LdpcDecode(benchmark::State& state)
+        {
+            const double qber = static_cast<double>(state.range(0)) / 1000.0;
+            ec::LdpcCodeFamily codes;
+            const auto code = codes.GetCode(codes.ChecksFor(qber, 1.4));
+            PackedBits alice;
+            PackedBits bob;
+            MakeBlocks(code->NumBits(), qber, alice, bob);
+            const PackedBits syndrome = code->Syndrome(alice);
+            ec::MinSumDecoder decoder(*code);
+            size_t iterations = 0;
+            size_t failures = 0;
+
+            for(auto _ : state)
+            {
+                PackedBits corrected = bob;
+                if(!decoder.Decode(corrected, 0, syndrome, qber))
+                {
+                    failures++;
+                }
+                iterations += decoder.Iterations();
+            }
+
+            state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * code->NumBits()));
+            state.counters["Iterations"] = benchmark::Counter(static_cast<double>(iterations), benchmark::Counter::kAvgIterations);
+            state.counters["Failures"] = static_cast<double>(failures);
+            state.SetLabel("Min-sum decode of one block, items are bits");
+        }
+        BENCHMARK(BM_LdpcDecode)->Arg(10)->Arg(30)->Arg(60);
+    }
+}
@@ -14,6 +14,7 @@
 
 #include "KeyManagement/KeyStores/KeyStoreFactory.h"
 #include "KeyManagement/KeyStores/KeyStore.h"
+#include "KeyManagement/KeyStores/JournalStore.h"
 #include "Algorithms/Util/FileIO.h"
 #include "Algorithms/Random/RandomNumber.h"
 
@@ -29,17 +30,16 @@ namespace cqp
 
             RandomNumber rng;
             rng.RandomBytes(32, aKey);
-            keyData.push_back({1, aKey});
-
+            KeyID id = 1;
 
             fs::Delete("FileStoreTest.db");
             keygen::FileStore fileStore("FileStoreTest.db");
 
             for(auto _ : state)
             {
+                // stored keys are removed from the list
+                keyData.push_back({id++, aKey});
                 fileStore.StoreKeys(dest, keyData);
-
-                keyData[0].first++;
             }
             state.SetLabel("Storing key to a backing store on disk");
         }
@@ -72,5 +72,74 @@ namespace cqp
             state.SetLabel("Getting key from a backing store on disk");
         }
         BENCHMARK(BM_RetrieveKeyFromFileStore);
+
+        static void BM_StoreKeyInJournalStore(benchmark::State& state)
+        {
+            const std::string dest = "SiteB";
+            keygen::IBackingStore::Keys keyData;
+            PSK aKey;
+
+            RandomNumber rng;
+            rng.RandomBytes(32, aKey);
+            KeyID id = 1;
+
+            const std::string directory = fs::MakeTemp(true);
+            keygen::JournalStore journalStore(directory);
+
+            for(auto _ : state)
+            {
+                keyData.push_back({id++, aKey});
+                journalStore.StoreKeys(dest, keyData);
+            }
+            state.SetLabel("Storing key to a journal on disk");
+        }
+        BENCHMARK(BM_StoreKeyInJournalStore);
+
+        static void BM_RetrieveKeyFromJournalStore(benchmark::State& state)
+        {
+            const std::string dest = "SiteB";
+            keygen::IBackingStore::Keys keyData;
+            PSK aKey;
+
+            RandomNumber rng;
+            rng.RandomBytes(32, aKey);
+
+            const std::string directory = fs::MakeTemp(true);
+            keygen::JournalStore journalStore(directory);
+
+            for(auto i = 0u; i < state.max_iterations; i++)
+            {
+                keyData.push_back({i, aKey});
+            }
+            journalStore.StoreKeys(dest, keyData);
+
+            KeyID id = 0;
+
+            for(auto _ : state)
+            {
+                journalStore.RemoveKey(dest, id++, aKey);
+            }
+            state.SetLabel("Getting key from a journal on disk");
+        }
+        BENCHMARK(BM_RetrieveKeyFromJournalStore);
+
+        static void BM_XorKeys(benchmark::State& state)
+        {
+            PSK left;
+            PSK right;
+
+            RandomNumber rng;
+            rng.RandomBytes(static_cast<size_t>(state.range(0)), left);
+            rng.RandomBytes(static_cast<size_t>(state.range(0)), right);
+
+            for(auto _ : state)
+            {
+                left ^= right;
+                benchmark::DoNotOptimize(left.data());
+            }
+            state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+            state.SetLabel("Combining keys");
+        }
+        BENCHMARK(BM_XorKeys)->Arg(32)->Arg(1024)->Arg(1024 * 1024);
     } // namespace tests
 } // namespace cqp
@@ -0,0 +1,49 @@
+/*!
+* @file
+* @brief BenchPrivacyAmp
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+
+#include "benchmark/benchmark.h"
+#include "CQPToolkit/PrivacyAmp/Toeplitz.h"
+#include <random>
+
+namespace cqp
+{
+    namespace tests
+    {
+        static void BM_ToeplitzHash(benchmark::State& state)
+        {
+            const size_t inputBits = static_cast<size_t>(state.range(0));
+            // a typical compression ratio
+            const size_t outputBits = inputBits / 2;
+            std::mt19937_64 rng(1234);
+            PackedBits input(inputBits / bitsPerWord);
+            PackedBits seed((privacy::ToeplitzHash::SeedLength(inputBits, outputBits) + bitsPerWord - 1) / bitsPerWord);
+            for(auto& word : input)
+            {
+                word = rng();
+            }
+            for(auto& word : seed)
+            {
+                word = rng();
+            }
+            privacy::ToeplitzHash hasher;
+
+            for(auto _ : state)
+            {
+                benchmark::DoNotOptimize(hasher.Hash(input, inputBits, seed, outputBits));
+            }
+
+            state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * inputBits));
+            state.SetLabel("Toeplitz hash to half the length, items are input bits");
+        }
+        BENCHMARK(BM_ToeplitzHash)->Arg(1 << 16)->Arg(1 << 20)->Arg(1 << 23)->Unit(benchmark::kMillisecond);
+    }
+}
@@ -0,0 +1,160 @@
+/*!
+* @file
+* @brief TestDetectionReplay
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "gtest/gtest.h"
+#include "CQPToolkit/Simulation/DetectionReplay.h"
+#include "Algorithms/Util/FileIO.h"
+#include <mutex>
+#include <thread>
+
+namespace cqp
+{
+    namespace tests
+    {
+        /// Collects the reports from the replay
+        class ReplayListener : public IDetectionEventCallback
+        {
+        public:
+            /// @copydoc IDetectionEventCallback::OnPhotonReport
+            void OnPhotonReport(std::unique_ptr<ProtocolDetectionReport> report) override
+            {
+                std::lock_guard<std::mutex> lock(reportsMutex);
+                reports.push_back(std::move(report));
+                arrived.push_back(std::chrono::high_resolution_clock::now());
+            }
+
+            /// @return The number of reports which have arrived
+            size_t Count()
+            {
+                std::lock_guard<std::mutex> lock(reportsMutex);
+                return reports.size();
+            }
+
+            /// protects reports
+            std::mutex reportsMutex;
+            /// The reports which have arrived
+            std::vector<std::unique_ptr<ProtocolDetectionReport>> reports;
+            /// When each report arrived
+            std::vector<std::chrono::high_resolution_clock::time_point> arrived;
+        };
+
+        /**
+         * @test
+         * @brief TEST
+         */
+        TEST(DetectionReplay, Replay)
+        {
+            using namespace std::chrono;
+            const auto fileName = fs::MakeTemp();
+            const auto frameSpacing = milliseconds(100);
+
+            // frames recorded 100ms apart
+            std::vector<ProtocolDetectionReport> recorded(3);
+            for(size_t frame = 0; frame < recorded.size(); frame++)
+            {
+                recorded[frame].frame = frame + 1;
+                recorded[frame].epoc = high_resolution_clock::time_point(frameSpacing * frame);
+                for(size_t index = 0; index < 100 * (frame + 1); index++)
+                {
+                    recorded[frame].detections.push_back({PicoSeconds(index * 1000), static_cast<Qubit>(index % 4)});
+                }
+            }
+
+            {
+                fs::DetectionArchiveWriter writer;
+                ASSERT_TRUE(writer.Open(fileName));
+                for(const auto& report : recorded)
+                {
+                    ASSERT_TRUE(writer.Write(report));
+                }
+            }
+
+            {
+                // one frame at a time
+                sim::DetectionReplay replay(fileName, true);
+                ASSERT_TRUE(replay.IsOpen());
+                ReplayListener listener;
+                replay.Attach(&listener);
+
+                for(size_t frame = 0; frame < recorded.size() + 1; frame++)
+                {
+                    ASSERT_TRUE(replay.StartDetecting(nullptr, nullptr, nullptr).ok());
+                    ASSERT_TRUE(replay.StopDetecting(nullptr, nullptr, nullptr).ok());
+                }
+
+                ASSERT_EQ(listener.reports.size(), recorded.size() + 1);
+                for(size_t frame = 0; frame < listener.reports.size(); frame++)
+                {
+                    ASSERT_EQ(listener.reports[frame]->detections, recorded[frame % recorded.size()].detections);
+                }
+            }
+
+            {
+                // faster than recorded
+                sim::DetectionReplay replay(fileName);
+                ReplayListener listener;
+                replay.Attach(&listener);
+
+                const auto started = high_resolution_clock::now();
+                replay.Play(10.0);
+                replay.WaitForEnd();
+                const auto taken = high_resolution_clock::now() - started;
+
+                ASSERT_GE(taken, frameSpacing * 2 / 10);
+                ASSERT_EQ(listener.reports.size(), recorded.size());
+                for(size_t frame = 0; frame < recorded.size(); frame++)
+                {
+                    ASSERT_EQ(listener.reports[frame]->frame, recorded[frame].frame);
+                    ASSERT_EQ(listener.reports[frame]->detections, recorded[frame].detections);
+                    if(frame > 0)
+                    {
+                        ASSERT_GE(listener.reports[frame]->epoc - listener.reports[frame - 1]->epoc, frameSpacing / 10);
+                    }
+                }
+
+                // the end of the archive
+                ASSERT_EQ(replay.StopDetecting(nullptr, nullptr, nullptr).error_code(), grpc::StatusCode::OUT_OF_RANGE);
+            }
+
+            {
+                // every pass of a looped archive keeps the recorded spacing
+                sim::DetectionReplay replay(fileName, true);
+                ReplayListener listener;
+                replay.Attach(&listener);
+
+                const size_t passes = 3;
+                replay.Play(10.0);
+                const auto timeout = high_resolution_clock::now() + seconds(5);
+                while(listener.Count() < recorded.size() * passes && high_resolution_clock::now() < timeout)
+                {
+                    std::this_thread::sleep_for(milliseconds(1));
+                }
+                // stop from another thread while waiting for the end
+                std::thread waiter(&sim::DetectionReplay::WaitForEnd, &replay);
+                replay.Stop();
+                waiter.join();
+
+                std::lock_guard<std::mutex> lock(listener.reportsMutex);
+                ASSERT_GE(listener.reports.size(), recorded.size() * passes);
+                for(size_t pass = 0; pass < passes; pass++)
+                {
+                    const size_t first = pass * recorded.size();
+                    ASSERT_EQ(listener.reports[first]->frame, recorded[0].frame);
+                    // the first frame of a pass is sent straight away, allow for it being late
+                    ASSERT_GE(listener.arrived[first + recorded.size() - 1] - listener.arrived[first],
+                              frameSpacing * 2 / 10 - milliseconds(5));
+                }
+            }
+
+            ASSERT_TRUE(fs::Delete(fileName));
+        }
+    } // namespace tests
+} // namespace cqp
@@ -0,0 +1,217 @@
+/*!
+* @file
+* @brief TestPhotonChannel
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "gtest/gtest.h"
+#include "CQPToolkit/Simulation/PhotonChannel.h"
+#include "CQPToolkit/Simulation/SimulatedTransmitter.h"
+#include "CQPToolkit/Simulation/SimulatedTimeTagger.h"
+#include "Algorithms/Datatypes/URI.h"
+#include <cmath>
+#include <stdexcept>
+
+namespace cqp
+{
+    namespace tests
+    {
+        /// Collects the reports from the simulators
+        class SimulationListener : public IDetectionEventCallback, public IEmitterEventCallback
+        {
+        public:
+            /// @copydoc IDetectionEventCallback::OnPhotonReport
+            void OnPhotonReport(std::unique_ptr<ProtocolDetectionReport> report) override
+            {
+                detections.push_back(std::move(report));
+            }
+
+            /// @copydoc IEmitterEventCallback::OnEmitterReport
+            void OnEmitterReport(std::unique_ptr<EmitterReport> report) override
+            {
+                emissions.push_back(std::move(report));
+            }
+
+            /// The detector reports which have arrived
+            std::vector<std::unique_ptr<ProtocolDetectionReport>> detections;
+            /// The emitter reports which have arrived
+            std::vector<std::unique_ptr<EmitterReport>> emissions;
+        };
+
+        /**
+         * @test
+         * @brief TEST
+         */
+        TEST(PhotonChannel, Deterministic)
+        {
+            // enough for more than one chunk
+            const size_t numEmissions = sim::PhotonChannel::ChunkSize * 2 + 1000;
+            QubitList emissions;
+            QubitList sameEmissions;
+            QubitList otherEmissions;
+            sim::PhotonChannel::Emissions(1234, 1, 0, numEmissions, emissions);
+            sim::PhotonChannel::Emissions(1234, 1, 0, numEmissions, sameEmissions);
+            sim::PhotonChannel::Emissions(4321, 1, 0, numEmissions, otherEmissions);
+            ASSERT_EQ(emissions.size(), numEmissions);
+            ASSERT_EQ(emissions, sameEmissions);
+            ASSERT_NE(emissions, otherEmissions);
+
+            sim::PhotonChannel channel({}, 99);
+            sim::PhotonChannel sameChannel({}, 99);
+            sim::PhotonChannel otherChannel({}, 100);
+            DetectionReportList detections;
+            DetectionReportList sameDetections;
+            DetectionReportList otherDetections;
+            channel.Propagate(1, 0, emissions, detections);
+            sameChannel.Propagate(1, 0, emissions, sameDetections);
+            otherChannel.Propagate(1, 0, emissions, otherDetections);
+
+            ASSERT_GT(detections.size(), 0);
+            ASSERT_EQ(detections, sameDetections);
+            ASSERT_NE(detections, otherDetections);
+        }
+
+        /**
+         * @test
+         * @brief TEST
+         */
+        TEST(PhotonChannel, Model)
+        {
+            sim::ChannelParameters parameters;
+            parameters.period = PicoSeconds(10000);
+            parameters.lossDb = 3.0;
+            parameters.detectorEfficiency = 0.5;
+            parameters.meanPhotonNumber = 0.5;
+            parameters.darkCountRate = 0.0;
+            parameters.jitter = PicoSeconds(0);
+            parameters.drift = 1.0e-5;
+            parameters.offset = PicoSecondOffset(2500);
+            parameters.qber = 0.05;
+            parameters.randomBasis = false;
+
+            const size_t numEmissions = 4000000;
+            QubitList emissions;
+            sim::PhotonChannel::Emissions(1, 1, 0, numEmissions, emissions);
+
+            sim::PhotonChannel channel(parameters, 1);
+            DetectionReportList detections;
+            channel.Propagate(1, 0, emissions, detections);
+
+            const double expected = channel.DetectionProbability() * numEmissions;
+            ASSERT_NEAR(detections.size(), expected, expected * 0.02);
+
+            // without jitter each detection can be traced back to its emission
+            size_t errors = 0;
+            for(const auto& detection : detections)
+            {
+                const double emitted = (static_cast<double>(detection.time.count()) - parameters.offset.count()) / (1.0 + parameters.drift);
+                const auto slot = static_cast<size_t>(std::llround(emitted / parameters.period.count()));
+                ASSERT_LT(slot, numEmissions);
+                ASSERT_NEAR(emitted, slot * static_cast<double>(parameters.period.count()), 1.0);
+                ASSERT_EQ(QubitHelper::Base(detection.value), QubitHelper::Base(emissions[slot]));
+                errors += detection.value != emissions[slot];
+            }
+            ASSERT_NEAR(static_cast<double>(errors) / detections.size(), parameters.qber, 0.005);
+
+            // only dark counts
+            parameters.meanPhotonNumber = 0.0;
+            parameters.darkCountRate = 100000.0;
+            sim::PhotonChannel darkChannel(parameters, 1);
+            detections.clear();
+            darkChannel.Propagate(1, 0, emissions, detections);
+            // 40ms of transmission
+            ASSERT_NEAR(detections.size(), 4000.0, 400.0);
+        }
+
+        /**
+         * @test
+         * @brief TEST
+         */
+        TEST(PhotonChannel, SimulatorPair)
+        {
+            auto channel = std::make_shared<sim::PhotonChannel>(sim::ChannelParameters(), 7);
+            sim::SimulatedTransmitter transmitter(channel, 7, 100000);
+            sim::SimulatedTimeTagger timeTagger(channel);
+            SimulationListener listener;
+            transmitter.Attach(&listener);
+            timeTagger.Attach(&listener);
+
+            for(auto frame = 0u; frame < 2; frame++)
+            {
+                transmitter.StartFrame();
+                ASSERT_TRUE(timeTagger.StartDetecting(nullptr, nullptr, nullptr).ok());
+                ASSERT_TRUE(transmitter.Fire());
+                ASSERT_TRUE(transmitter.Fire());
+                ASSERT_TRUE(timeTagger.StopDetecting(nullptr, nullptr, nullptr).ok());
+                transmitter.EndFrame();
+            }
+
+            ASSERT_EQ(listener.emissions.size(), 4);
+            ASSERT_EQ(listener.detections.size(), 2);
+            for(auto frame = 0u; frame < 2; frame++)
+            {
+                const auto& report = listener.detections[frame];
+                ASSERT_EQ(report->frame, listener.emissions[frame * 2]->frame);
+                ASSERT_GT(report->detections.size(), 0);
+                ASSERT_TRUE(std::is_sorted(report->detections.begin(), report->detections.end(),
+                                           [](const DetectionReport& left, const DetectionReport& right)
+                {
+                    return left.time < right.time;
+                }));
+                // the second burst carries on from the first
+                ASSERT_GT(report->detections.back().time, PicoSeconds(listener.emissions[frame * 2]->period * 100000));
+            }
+        }
+
+        /**
+         * @test
+         * @brief TEST
+         */
+        TEST(PhotonChannel, Parameters)
+        {
+            sim::ChannelParameters parameters;
+            ASSERT_TRUE(parameters.SetParameter(sim::ChannelParameters::Names::loss, "13.5"));
+            ASSERT_TRUE(parameters.SetParameter(sim::ChannelParameters::Names::darkCounts, "20000"));
+            ASSERT_TRUE(parameters.SetParameter(sim::ChannelParameters::Names::jitter, "300"));
+            ASSERT_TRUE(parameters.SetParameter(sim::ChannelParameters::Names::drift, "1e-7"));
+            ASSERT_TRUE(parameters.SetParameter(sim::ChannelParameters::Names::offset, "-123456"));
+            ASSERT_TRUE(parameters.SetParameter(sim::ChannelParameters::Names::qber, "0.04"));
+            ASSERT_FALSE(parameters.SetParameter("side", "alice"));
+            ASSERT_THROW(parameters.SetParameter(sim::ChannelParameters::Names::qber, "2"), std::out_of_range);
+            ASSERT_THROW(parameters.SetParameter(sim::ChannelParameters::Names::loss, "lots"), std::invalid_argument);
+
+            ASSERT_EQ(parameters.lossDb, 13.5);
+            ASSERT_EQ(parameters.darkCountRate, 20000.0);
+            ASSERT_EQ(parameters.jitter, PicoSeconds(300));
+            ASSERT_EQ(parameters.drift, 1e-7);
+            ASSERT_EQ(parameters.offset, PicoSecondOffset(-123456));
+            ASSERT_EQ(parameters.qber, 0.04);
+
+            // the values survive a trip through a device address
+            URI address("dummyqkd://localhost:8000");
+            parameters.ToURI(address);
+            sim::ChannelParameters parsed;
+            for(const auto& param : URI(address.ToString()).GetQueryParameters())
+            {
+                ASSERT_TRUE(parsed.SetParameter(param.first, param.second)) << param.first;
+            }
+            ASSERT_EQ(parsed.lossDb, parameters.lossDb);
+            ASSERT_EQ(parsed.darkCountRate, parameters.darkCountRate);
+            ASSERT_EQ(parsed.jitter, parameters.jitter);
+            ASSERT_EQ(parsed.drift, parameters.drift);
+            ASSERT_EQ(parsed.offset, parameters.offset);
+            ASSERT_EQ(parsed.qber, parameters.qber);
+
+            // the first user of a shared channel decides how it behaves
+            auto channel = sim::PhotonChannel::Shared("ParametersTest", parameters);
+            auto sameChannel = sim::PhotonChannel::Shared("ParametersTest");
+            ASSERT_EQ(channel, sameChannel);
+            ASSERT_EQ(sameChannel->GetParameters().lossDb, parameters.lossDb);
+        }
+    } // namespace tests
+} // namespace cqp
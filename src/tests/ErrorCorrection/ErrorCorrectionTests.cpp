@@ -0,0 +1,318 @@
+/*!
+* @file
+* @brief Error Correction Tests
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "ErrorCorrectionTests.h"
+#include <algorithm>
+#include "Algorithms/Logging/ConsoleLogger.h"
+#include "Algorithms/Util/Bits.h"
+#include "CQPToolkit/ErrorCorrection/Cascade.h"
+#include "CQPToolkit/ErrorCorrection/Ldpc.h"
+#include "CQPToolkit/ErrorCorrection/ErrorCorrection.h"
+
+namespace cqp
+{
+    namespace tests
+    {
+
+        ErrorCorrectionTests::ErrorCorrectionTests()
+        {
+            ConsoleLogger::Enable();
+            DefaultLogger().SetOutputLevel(LogLevel::Info);
+        }
+
+        size_t ErrorCorrectionTests::MakeKeys(size_t numBits, double qber, JaggedDataBlock& alice, JaggedDataBlock& bob)
+        {
+            alice.resize((numBits + 7) / 8);
+            for(auto& byte : alice)
+            {
+                byte = static_cast<uint8_t>(rng());
+            }
+            alice.bitsInLastByte = numBits % 8;
+            if(alice.bitsInLastByte != 0)
+            {
+                // bits past the end are always 0
+                alice.back() &= static_cast<uint8_t>((1u << alice.bitsInLastByte) - 1u);
+            }
+
+            bob = alice;
+            std::bernoulli_distribution errorDist(qber);
+            size_t errors = 0;
+            for(size_t bit = 0; bit < numBits; bit++)
+            {
+                if(errorDist(rng))
+                {
+                    bob[bit / 8] ^= static_cast<uint8_t>(1u << (bit % 8));
+                    errors++;
+                }
+            }
+            return errors;
+        }
+
+        TEST_F(ErrorCorrectionTests, RangeParity)
+        {
+            PackedBits bits(20);
+            for(auto& word : bits)
+            {
+                word = rng();
+            }
+
+            for(size_t test = 0; test < 1000; test++)
+            {
+                const size_t start = rng() % (bits.size() * bitsPerWord);
+                const size_t length = rng() % (bits.size() * bitsPerWord - start + 1);
+                bool expected = false;
+                for(size_t bit = start; bit < start + length; bit++)
+                {
+                    expected ^= GetBit(bits, bit);
+                }
+                ASSERT_EQ(RangeParity(bits, start, length), expected) << "start=" << start << " length=" << length;
+            }
+        }
+
+        TEST_F(ErrorCorrectionTests, PackBits)
+        {
+            JaggedDataBlock alice;
+            JaggedDataBlock bob;
+            MakeKeys(1001, 0.0, alice, bob);
+
+            const PackedBits packed = PackBits(alice);
+            ASSERT_EQ(packed.size(), 16u);
+            ASSERT_EQ(UnpackBits(packed, alice.NumBits()), alice);
+        }
+
+        TEST_F(ErrorCorrectionTests, CascadeShuffle)
+        {
+            using namespace ec;
+            JaggedDataBlock alice;
+            JaggedDataBlock bob;
+            MakeKeys(5000, 0.0, alice, bob);
+
+            CascadeParameters params;
+            params.seed = 42;
+            CascadeKey aliceKey(alice, params);
+            CascadeKey bobKey(bob, params);
+
+            for(uint32_t pass = 0; pass < params.passes; pass++)
+            {
+                for(uint64_t index = 0; index < aliceKey.NumBits(); index++)
+                {
+                    ASSERT_EQ(aliceKey.Position(pass, index), bobKey.Position(pass, index));
+                    ASSERT_EQ(aliceKey.ShuffledIndex(pass, aliceKey.Position(pass, index)), index);
+                }
+                std::vector<bool> aliceParities;
+                std::vector<bool> bobParities;
+                aliceKey.PassParities(pass, aliceParities);
+                bobKey.PassParities(pass, bobParities);
+                ASSERT_EQ(aliceParities, bobParities);
+            }
+        }
+
+        TEST_F(ErrorCorrectionTests, Cascade)
+        {
+            using namespace ec;
+            const size_t numBits = 100000;
+
+            for(double qber :
+                    {
+                        0.01, 0.03, 0.06
+                    })
+            {
+                JaggedDataBlock alice;
+                JaggedDataBlock bob;
+                const size_t errors = MakeKeys(numBits, qber, alice, bob);
+
+                CascadeParameters params;
+                params.seed = rng();
+                params.initialBlockSize = CascadeParameters::InitialBlockSize(qber, numBits);
+
+                const CascadeKey aliceKey(alice, params);
+                CascadeKey bobKey(bob, params);
+                CascadeCorrector corrector(bobKey);
+
+                while(!corrector.Complete())
+                {
+                    // answer the queries as the other side would
+                    const ParityQueries& queries = corrector.GetQueries();
+                    std::vector<bool> answers;
+                    for(auto pass : queries.wholePasses)
+                    {
+                        aliceKey.PassParities(pass, answers);
+                    }
+                    for(const auto& block : queries.blocks)
+                    {
+                        answers.push_back(aliceKey.Parity(block));
+                    }
+                    ASSERT_TRUE(corrector.SetAnswers(answers));
+                }
+
+                ASSERT_EQ(bobKey.GetKey(), alice) << "qber=" << qber;
+                ASSERT_EQ(corrector.ErrorsCorrected(), errors);
+                // efficiency should be well below the 1.5 * h(qber) of the original protocol
+                const double h = -qber * std::log2(qber) - (1 - qber) * std::log2(1 - qber);
+                EXPECT_LT(static_cast<double>(corrector.ParitiesExchanged()) / (numBits * h), 1.5);
+                // round trips should be bound by the block sizes, not the number of errors
+                EXPECT_LT(corrector.Rounds(), 100u);
+                LOGINFO("qber=" + std::to_string(qber) + " errors=" + std::to_string(errors) +
+                        " leaked=" + std::to_string(corrector.ParitiesExchanged()) +
+                        " rounds=" + std::to_string(corrector.Rounds()));
+            }
+        }
+
+        TEST_F(ErrorCorrectionTests, CascadeBadAnswers)
+        {
+            using namespace ec;
+            JaggedDataBlock alice;
+            JaggedDataBlock bob;
+            MakeKeys(1000, 0.05, alice, bob);
+
+            CascadeKey bobKey(bob, CascadeParameters());
+            CascadeCorrector corrector(bobKey);
+            ASSERT_FALSE(corrector.SetAnswers({true, false}));
+            ASSERT_FALSE(corrector.Complete());
+        }
+
+        TEST_F(ErrorCorrectionTests, Ldpc)
+        {
+            using namespace ec;
+            const double qber = 0.03;
+            LdpcCodeFamily codes;
+            const auto code = codes.GetCode(codes.ChecksFor(qber, 1.5));
+            ASSERT_NE(code, nullptr);
+            ASSERT_EQ(code->NumBits(), codes.BlockLength());
+
+            const size_t numBlocks = 20;
+            const size_t blockWords = code->NumBits() / bitsPerWord;
+            JaggedDataBlock alice;
+            JaggedDataBlock bob;
+            MakeKeys(numBlocks * code->NumBits(), qber, alice, bob);
+            const PackedBits aliceBits = PackBits(alice);
+            PackedBits bobBits = PackBits(bob);
+
+            MinSumDecoder decoder(*code);
+            size_t decoded = 0;
+            for(size_t block = 0; block < numBlocks; block++)
+            {
+                const PackedBits syndrome = code->Syndrome(aliceBits, block * blockWords);
+                if(decoder.Decode(bobBits, block * blockWords, syndrome, qber))
+                {
+                    decoded++;
+                    ASSERT_EQ(code->Syndrome(bobBits, block * blockWords), syndrome);
+                    ASSERT_TRUE(std::equal(aliceBits.begin() + block * blockWords, aliceBits.begin() + (block + 1) * blockWords,
+                                           bobBits.begin() + block * blockWords));
+                }
+            }
+            // some failures are expected with short codes, but not many
+            EXPECT_GE(decoded, numBlocks - 2);
+        }
+
+        TEST_F(ErrorCorrectionTests, LdpcShortened)
+        {
+            using namespace ec;
+            const double qber = 0.05;
+            LdpcCodeFamily codes;
+            const auto code = codes.GetCode(codes.ChecksFor(qber, 1.5));
+            ASSERT_NE(code, nullptr);
+
+            // a partial block padded with 0
+            const size_t numBits = code->NumBits() / 2 + 5;
+            JaggedDataBlock alice;
+            JaggedDataBlock bob;
+            MakeKeys(numBits, qber, alice, bob);
+            PackedBits aliceBits = PackBits(alice);
+            PackedBits bobBits = PackBits(bob);
+            aliceBits.resize(code->NumBits() / bitsPerWord, 0);
+            bobBits.resize(code->NumBits() / bitsPerWord, 0);
+
+            MinSumDecoder decoder(*code);
+            ASSERT_TRUE(decoder.Decode(bobBits, 0, code->Syndrome(aliceBits), qber, static_cast<uint32_t>(code->NumBits() - numBits)));
+            ASSERT_EQ(bobBits, aliceBits);
+        }
+
+        TEST_F(ErrorCorrectionTests, LdpcKernels)
+        {
+            using namespace ec;
+            using Kernel = MinSumDecoder::Kernel;
+            // high enough that some blocks need many iterations and some fail
+            const double qber = 0.06;
+            LdpcCodeFamily codes;
+            const auto code = codes.GetCode(codes.ChecksFor(qber, 1.2));
+            ASSERT_NE(code, nullptr);
+            ASSERT_TRUE(MinSumDecoder::KernelSupported(Kernel::Scalar));
+            ASSERT_TRUE(MinSumDecoder::KernelSupported(MinSumDecoder::BestKernel()));
+
+            const size_t numBlocks = 10;
+            const size_t blockWords = code->NumBits() / bitsPerWord;
+            JaggedDataBlock alice;
+            JaggedDataBlock bob;
+            MakeKeys(numBlocks * code->NumBits(), qber, alice, bob);
+            const PackedBits aliceBits = PackBits(alice);
+            const PackedBits bobBits = PackBits(bob);
+
+            MinSumDecoder reference(*code);
+            ASSERT_TRUE(reference.SetKernel(Kernel::Scalar));
+            ASSERT_EQ(reference.GetKernel(), Kernel::Scalar);
+
+            for(const auto kernel : {Kernel::Sse2, Kernel::Avx2})
+            {
+                MinSumDecoder decoder(*code);
+                if(!decoder.SetKernel(kernel))
+                {
+                    LOGINFO("Check node kernel " + std::to_string(static_cast<int>(kernel)) + " not supported");
+                    continue; // for
+                }
+
+                PackedBits expected = bobBits;
+                PackedBits actual = bobBits;
+                for(size_t block = 0; block < numBlocks; block++)
+                {
+                    const PackedBits syndrome = code->Syndrome(aliceBits, block * blockWords);
+                    const bool expectedResult = reference.Decode(expected, block * blockWords, syndrome, qber);
+                    // any difference in the messages would change the number of iterations
+                    ASSERT_EQ(decoder.Decode(actual, block * blockWords, syndrome, qber), expectedResult) << "block " << block;
+                    ASSERT_EQ(decoder.Iterations(), reference.Iterations()) << "block " << block;
+                }
+                ASSERT_EQ(actual, expected);
+            }
+        }
+
+        TEST_F(ErrorCorrectionTests, LdpcCodeFamily)
+        {
+            using namespace ec;
+            LdpcCodeFamily codes;
+            // lower error rates need fewer checks
+            ASSERT_LT(codes.ChecksFor(0.01, 1.2), codes.ChecksFor(0.05, 1.2));
+            ASSERT_LT(codes.ChecksFor(0.05, 1.2), codes.ChecksFor(0.05, 1.5));
+            // both sides build the same code
+            LdpcCodeFamily otherCodes;
+            const uint32_t numChecks = codes.ChecksFor(0.02, 1.3);
+            PackedBits bits(codes.BlockLength() / bitsPerWord);
+            for(auto& word : bits)
+            {
+                word = rng();
+            }
+            ASSERT_EQ(codes.GetCode(numChecks)->Syndrome(bits), otherCodes.GetCode(numChecks)->Syndrome(bits));
+            ASSERT_EQ(codes.GetCode(numChecks), codes.GetCode(numChecks));
+            ASSERT_EQ(codes.GetCode(numChecks + 1), nullptr);
+        }
+
+        TEST_F(ErrorCorrectionTests, ParseMode)
+        {
+            using ec::ErrorCorrection;
+            ASSERT_EQ(ErrorCorrection::ParseMode(""), ErrorCorrection::Mode::Cascade);
+            ASSERT_EQ(ErrorCorrection::ParseMode("LDPC"), ErrorCorrection::Mode::Ldpc);
+            ASSERT_EQ(ErrorCorrection::ParseMode("bogus", ErrorCorrection::Mode::Ldpc), ErrorCorrection::Mode::Ldpc);
+            for(auto mode : {ErrorCorrection::Mode::Cascade, ErrorCorrection::Mode::Ldpc})
+            {
+                ASSERT_EQ(ErrorCorrection::ParseMode(ErrorCorrection::ModeName(mode)), mode);
+            }
+        }
+    } // namespace tests
+} // namespace cqp
@@ -0,0 +1,53 @@
+/*!
+* @file
+* @brief Error Correction Tests
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#pragma once
+#include "gtest/gtest.h"
+#include "Algorithms/Datatypes/Base.h"
+#include <random>
+
+namespace cqp
+{
+    namespace tests
+    {
+
+        /**
+         * @test
+         * @brief The ErrorCorrectionTests class
+         * For testing error correction algorithms
+         */
+        class ErrorCorrectionTests : public testing::Test
+        {
+        public:
+            /**
+             * @brief ErrorCorrectionTests
+             * Constructor
+             */
+            ErrorCorrectionTests();
+
+        protected:
+            /**
+             * @brief MakeKeys
+             * Create a random key and a copy with errors in it
+             * @param numBits length of the keys
+             * @param qber fraction of bits to change
+             * @param[out] alice The original key
+             * @param[out] bob The key with errors
+             * @return The number of errors added
+             */
+            size_t MakeKeys(size_t numBits, double qber, JaggedDataBlock& alice, JaggedDataBlock& bob);
+
+            /// source of test data, fixed seed so that failures can be reproduced
+            std::mt19937_64 rng {1234};
+        };
+
+    } // namespace tests
+} // namespace cqp
@@ -12,12 +12,17 @@
 #include "TestKeyMan.h"
 #include "KeyManagement/KeyStores/KeyStoreFactory.h"
 #include "KeyManagement/KeyStores/KeyStore.h"
+#include "KeyManagement/KeyStores/KeyPool.h"
+#include "KeyManagement/KeyStores/JournalStore.h"
 #include <grpcpp/server_builder.h>
 #include <grpcpp/server.h>
 #include "CQPToolkit/Util/GrpcLogger.h"
 #include "KeyManagement/KeyStores/FileStore.h"
 #include "Algorithms/Util/FileIO.h"
 #include "Algorithms/Net/DNS.h"
+#include <future>
+#include <set>
+#include <thread>
 
 namespace cqp
 {
@@ -60,6 +65,126 @@ namespace cqp
                 ASSERT_EQ(key, keyData[i].second);
                 key.clear();
             }
+
+            uint64_t available = 0;
+            uint64_t capacity = 0;
+            fileStore.GetCounts(dest, available, capacity);
+            ASSERT_EQ(available, 0u);
+
+            keyDataCopy = keyData;
+            ASSERT_TRUE(fileStore.StoreKeys(dest, keyDataCopy));
+            ASSERT_TRUE(keyDataCopy.empty());
+            fileStore.GetCounts(dest, available, capacity);
+            ASSERT_EQ(available, numberOfKeys);
+            ASSERT_EQ(fileStore.GetNextKeyId(dest), numberOfKeys);
+
+            // keys which are already stored are left in the list
+            keyDataCopy.assign(keyData.begin(), keyData.begin() + 200);
+            keyDataCopy.push_back({numberOfKeys, PSK(32, 1)});
+            ASSERT_FALSE(fileStore.StoreKeys(dest, keyDataCopy));
+            ASSERT_EQ(keyDataCopy.size(), 200u);
+            fileStore.GetCounts(dest, available, capacity);
+            ASSERT_EQ(available, numberOfKeys + 1);
+            ASSERT_EQ(fileStore.GetNextKeyId(dest), numberOfKeys + 1);
+
+            std::vector<KeyID> reserved;
+            ASSERT_EQ(fileStore.ReserveKeys(dest, 300, reserved), 300u);
+            ASSERT_EQ(reserved.front(), 0u);
+            ASSERT_EQ(reserved.back(), 299u);
+            KeyID nextReserved = 0;
+            ASSERT_TRUE(fileStore.ReserveKey(dest, nextReserved));
+            ASSERT_EQ(nextReserved, 300u);
+
+            keygen::IBackingStore::Keys removing;
+            for(auto id : reserved)
+            {
+                removing.push_back({id, PSK()});
+            }
+            ASSERT_TRUE(fileStore.RemoveKeys(dest, removing));
+            for(uint i = 0; i < removing.size(); i++)
+            {
+                ASSERT_EQ(removing[i].second, keyData[i].second);
+            }
+            fileStore.GetCounts(dest, available, capacity);
+            ASSERT_EQ(available, numberOfKeys + 1 - 300);
+
+            // the keys have gone
+            ASSERT_FALSE(fileStore.RemoveKeys(dest, removing));
+            ASSERT_TRUE(removing.front().second.empty());
+
+            // the counters are read from the database when a link is first used
+            keygen::FileStore reopened("FileStoreTest.db");
+            reopened.GetCounts(dest, available, capacity);
+            ASSERT_EQ(available, numberOfKeys + 1 - 300);
+            ASSERT_EQ(reopened.GetNextKeyId(dest), numberOfKeys + 1);
+        }
+
+        TEST(KeyMan, JournalStore)
+        {
+            const size_t numberOfKeys = 10000;
+            const size_t segmentRecords = 1024;
+            const std::string dest = "SiteB";
+            const std::string directory = fs::MakeTemp(true);
+            keygen::IBackingStore::Keys keyData;
+            for(KeyID id = 1; id <= numberOfKeys; id++)
+            {
+                PSK aKey;
+                for(uint8_t i = 0; i < 32; i++)
+                {
+                    aKey.push_back(rand());
+                }
+                keyData.push_back({id, aKey});
+            }
+
+            /*scope*/
+            {
+                keygen::JournalStore journal(directory, 32, segmentRecords);
+                auto keyDataCopy = keyData;
+                ASSERT_TRUE(journal.StoreKeys(dest, keyDataCopy));
+                ASSERT_TRUE(keyDataCopy.empty());
+
+                // keys which can't be stored are left in the list
+                keyDataCopy.push_back(keyData[0]);
+                keyDataCopy.push_back({numberOfKeys + 1, PSK(33, 0)});
+                ASSERT_FALSE(journal.StoreKeys(dest, keyDataCopy));
+                ASSERT_EQ(keyDataCopy.size(), 2u);
+            }/*scope*/
+
+            keygen::JournalStore journal(directory, 32, segmentRecords);
+            uint64_t available = 0;
+            uint64_t capacity = 0;
+            journal.GetCounts(dest, available, capacity);
+            ASSERT_EQ(available, numberOfKeys);
+            ASSERT_EQ(journal.GetNextKeyId(dest), numberOfKeys + 1);
+
+            KeyID reserved = 0;
+            ASSERT_TRUE(journal.ReserveKey(dest, reserved));
+            ASSERT_EQ(reserved, 1u);
+            ASSERT_TRUE(journal.ReserveKey(dest, reserved));
+            ASSERT_EQ(reserved, 2u);
+
+            // remove most of the keys so that the segments are compacted
+            PSK key;
+            for(size_t index = 0; index < numberOfKeys; index++)
+            {
+                if(index % 10 != 0)
+                {
+                    ASSERT_TRUE(journal.RemoveKey(dest, keyData[index].first, key));
+                    ASSERT_EQ(key, keyData[index].second);
+                }
+            }
+            ASSERT_FALSE(journal.RemoveKey(dest, keyData[1].first, key));
+            journal.Compact();
+            ASSERT_LE(journal.NumSegments(), 2u);
+
+            keygen::JournalStore reopened(directory, 32, segmentRecords);
+            reopened.GetCounts(dest, available, capacity);
+            ASSERT_EQ(available, numberOfKeys / 10);
+            for(size_t index = 0; index < numberOfKeys; index += 10)
+            {
+                ASSERT_TRUE(reopened.RemoveKey(dest, keyData[index].first, key));
+                ASSERT_EQ(key, keyData[index].second);
+            }
         }
 
         TEST(KeyMan, Factory)
@@ -149,5 +274,164 @@ namespace cqp
             LOGINFO("Retrieving " + std::to_string(numKeys) + " Keys took:" + std::to_string(timeTakenns2) + "ns, " + std::to_string(timeTakenns2 / (numKeys)) + "ns per key.");
             server2->Shutdown();
         }
+
+        TEST(KeyMan, Lease)
+        {
+            keygen::KeyStoreFactory factory1(grpc::InsecureChannelCredentials());
+            keygen::KeyStoreFactory factory2(grpc::InsecureChannelCredentials());
+
+            // create the server for second factory
+            grpc::ServerBuilder builder;
+            int server2ListenPort = 0;
+            builder.AddListeningPort("localhost:0", grpc::InsecureServerCredentials(), &server2ListenPort);
+            builder.RegisterService(static_cast<remote::IKeyFactory::Service*>(&factory2));
+            builder.RegisterService(static_cast<remote::IKeyLease::Service*>(&factory2));
+            auto server2 = builder.BuildAndStart();
+            ASSERT_NE(server2, nullptr);
+
+            factory1.SetSiteAddress("localhost:0");
+            factory2.SetSiteAddress("localhost:" + std::to_string(server2ListenPort));
+
+            auto keyStore1 = factory1.GetKeyStore("localhost:" + std::to_string(server2ListenPort));
+            auto keyStore2 = factory2.GetKeyStore("localhost:0");
+            keyStore1->SetLeaseSize(10);
+
+            const size_t numKeys = 100;
+            KeyList keyData;
+            for(size_t i = 0; i < numKeys; i++)
+            {
+                keyData.push_back(PSK(32, static_cast<uint8_t>(i)));
+            }
+            keyStore1->OnKeyGeneration(std::unique_ptr<KeyList>(new KeyList(keyData)));
+            keyStore2->OnKeyGeneration(std::unique_ptr<KeyList>(new KeyList(keyData)));
+
+            // each key is handed out once and can be collected from the other side
+            std::set<KeyID> used;
+            for(size_t i = 0; i < 25; i++)
+            {
+                KeyID keyId = 0;
+                PSK value;
+                PSK otherValue;
+                ASSERT_TRUE(keyStore1->GetNewKey(keyId, value));
+                ASSERT_TRUE(used.insert(keyId).second);
+                ASSERT_TRUE(keyStore2->GetExistingKey(keyId, otherValue).ok());
+                ASSERT_EQ(value, otherValue);
+            }
+
+            // the leased keys which weren't used can be used by either side again
+            keyStore1->ReturnLease();
+            ASSERT_EQ(keyStore1->GetNumberUnusedKeys(), numKeys - used.size());
+            ASSERT_EQ(keyStore2->GetNumberUnusedKeys(), numKeys - used.size());
+
+            // an idle lease is returned when it expires rather than being dropped by the peer
+            keyStore1->SetLeaseSize(10, std::chrono::milliseconds(100));
+            KeyID keyId = 0;
+            PSK value;
+            PSK otherValue;
+            ASSERT_TRUE(keyStore1->GetNewKey(keyId, value));
+            ASSERT_TRUE(used.insert(keyId).second);
+            ASSERT_TRUE(keyStore2->GetExistingKey(keyId, otherValue).ok());
+            ASSERT_EQ(value, otherValue);
+            ASSERT_LT(keyStore1->GetNumberUnusedKeys(), numKeys - used.size());
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            ASSERT_EQ(keyStore1->GetNumberUnusedKeys(), numKeys - used.size());
+            ASSERT_EQ(keyStore2->GetNumberUnusedKeys(), numKeys - used.size());
+            server2->Shutdown();
+        }
+
+        TEST(KeyMan, KeyPool)
+        {
+            using keygen::KeyPool;
+            const size_t numKeys = 100000;
+            const size_t numThreads = 4;
+            KeyPool pool;
+
+            PSK value;
+            // a placeholder is filled when the key arrives and can't be taken before
+            ASSERT_EQ(pool.Claim(numKeys + 1), KeyPool::Claimed::Placeholder);
+            ASSERT_FALSE(pool.TakeReserved(numKeys + 1, value));
+            ASSERT_EQ(pool.Add(numKeys + 1, PSK({1, 2, 3}), false), KeyPool::Placed::Reserved);
+            ASSERT_TRUE(pool.TakeReserved(numKeys + 1, value));
+            ASSERT_EQ(value, PSK({1, 2, 3}));
+            ASSERT_EQ(pool.Add(numKeys + 2, PSK({4}), true), KeyPool::Placed::NotPlaced);
+            ASSERT_EQ(pool.NumReserved(), 0u);
+            ASSERT_EQ(pool.NumUnused(), 0u);
+
+            // blocks of keys are reserved lowest first and can be put back
+            for(KeyID id = 1; id <= 40; id++)
+            {
+                pool.Add(id, PSK({static_cast<uint8_t>(id)}), false);
+            }
+            std::vector<KeyID> block;
+            ASSERT_EQ(pool.ReserveMany(20, block), 20u);
+            for(KeyID id = 1; id <= 20; id++)
+            {
+                ASSERT_EQ(block[id - 1], id);
+                ASSERT_TRUE(pool.Unreserve(id));
+            }
+            ASSERT_EQ(pool.NumUnused(), 40u);
+            for(KeyID id = 1; id <= 40; id++)
+            {
+                ASSERT_TRUE(pool.Take(id, value));
+            }
+
+            // producers and consumers working at once should see every key exactly once
+            std::vector<std::future<void>> producers;
+            std::vector<std::future<std::vector<KeyID>>> consumers;
+            for(size_t thread = 0; thread < numThreads; thread++)
+            {
+                producers.push_back(std::async(std::launch::async, [&, thread]
+                {
+                    for(KeyID id = thread; id < numKeys; id += numThreads)
+                    {
+                        pool.Add(id, PSK(8, static_cast<uint8_t>(id)), false);
+                        pool.Notify();
+                    }
+                }));
+
+                consumers.push_back(std::async(std::launch::async, [&]
+                {
+                    std::vector<KeyID> taken;
+                    KeyID id = 0;
+                    PSK key;
+                    bool found = true;
+                    while(found)
+                    {
+                        found = pool.WaitFor(std::chrono::milliseconds(500), [&]
+                        {
+                            return pool.ReserveAny(id);
+                        });
+
+                        if(found && pool.TakeReserved(id, key) && key == PSK(8, static_cast<uint8_t>(id)))
+                        {
+                            taken.push_back(id);
+                        }
+                    }
+                    return taken;
+                }));
+            }
+
+            for(auto& producer : producers)
+            {
+                producer.get();
+            }
+
+            std::vector<bool> seen(numKeys, false);
+            size_t totalTaken = 0;
+            for(auto& consumer : consumers)
+            {
+                for(auto id : consumer.get())
+                {
+                    ASSERT_LT(id, numKeys);
+                    ASSERT_FALSE(seen[id]) << "Key " << id << " taken twice";
+                    seen[id] = true;
+                    totalTaken++;
+                }
+            }
+
+            ASSERT_EQ(totalTaken, numKeys);
+            ASSERT_EQ(pool.NumUnused(), 0u);
+            ASSERT_EQ(pool.NumReserved(), 0u);
+        }
     }
 }
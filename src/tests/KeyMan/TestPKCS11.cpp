@@ -12,6 +12,8 @@
 #include "TestPKCS11.h"
 #include "KeyManagement/KeyStores/PKCS11Wrapper.h"
 #include "KeyManagement/KeyStores/HSMStore.h"
+#include <set>
+#include <thread>
 
 #define YH_ALGO_AES256_CCM_WRAP 42
 
@@ -92,9 +94,10 @@ namespace cqp
             keys.push_back({1003, {185, 182, 156, 211,  87, 183,  52, 248,  47, 214, 120, 101,  47,  71, 154, 186,
                                    103,  36, 132, 218, 119, 190,  28, 185,  89, 168,  29, 124,  29, 211, 132, 210
                                   }});
+            KeyID storedId = keys[0].first;
             ASSERT_TRUE(store.StoreKeys(dest, keys)) << "Key storage failed";
             PSK foundKey;
-            ASSERT_TRUE(store.FindKey(dest, keys[0].first, foundKey)) << "Failed to find key";
+            ASSERT_TRUE(store.FindKey(dest, storedId, foundKey)) << "Failed to find key";
             KeyID nextId = 0;
             ASSERT_TRUE(store.ReserveKey(dest, nextId)) << "Failed to reserve key";
             PSK retrievedKey;
@@ -116,5 +119,88 @@ namespace cqp
             ASSERT_TRUE(store.RemoveKey(dest, nextId, retrievedKey)) << "RemoveKey Failed";
         }
 
+        TEST(KeyMan, HSMSessionPool)
+        {
+            const std::string dest = "siteC:654";
+            const size_t numThreads = 8;
+            const size_t keysPerThread = 50;
+            const size_t totalKeys = numThreads * keysPerThread;
+            keygen::HSMStore store("pkcs:module-name=libsofthsm2.so;token=SoftHSM2Token?pin-value=1234");
+            store.SetMaxSessions(3);
+            store.DeleteAllKeys();
+            ASSERT_EQ(store.GetNextKeyId(dest), 1u);
+
+            std::vector<std::thread> threads;
+            for(size_t threadId = 0; threadId < numThreads; threadId++)
+            {
+                threads.emplace_back([&store, &dest, threadId, keysPerThread]()
+                {
+                    keygen::IBackingStore::Keys keys;
+                    for(KeyID id = 1; id <= keysPerThread; id++)
+                    {
+                        keys.push_back({threadId * keysPerThread + id, PSK(32, static_cast<uint8_t>(threadId))});
+                    }
+                    EXPECT_TRUE(store.StoreKeys(dest, keys));
+                    EXPECT_TRUE(keys.empty());
+                });
+            }
+            for(auto& thread : threads)
+            {
+                thread.join();
+            }
+            threads.clear();
+
+            uint64_t available = 0;
+            uint64_t capacity = 0;
+            store.GetCounts(dest, available, capacity);
+            ASSERT_EQ(available, totalKeys);
+            ASSERT_EQ(store.GetNextKeyId(dest), totalKeys + 1);
+
+            // keys which are already stored are left in the list
+            keygen::IBackingStore::Keys duplicate {{1, PSK(32, 0)}};
+            ASSERT_FALSE(store.StoreKeys(dest, duplicate));
+            ASSERT_EQ(duplicate.size(), 1u);
+
+            // every key should be handed out once
+            std::vector<std::vector<KeyID>> taken(numThreads);
+            for(size_t threadId = 0; threadId < numThreads; threadId++)
+            {
+                threads.emplace_back([&store, &dest, &taken, threadId, keysPerThread]()
+                {
+                    std::vector<KeyID> ids;
+                    while(store.ReserveKeys(dest, 7, ids) > 0)
+                    {
+                        keygen::IBackingStore::Keys keys;
+                        for(auto id : ids)
+                        {
+                            keys.push_back({id, PSK()});
+                        }
+                        EXPECT_TRUE(store.RemoveKeys(dest, keys));
+                        for(const auto& key : keys)
+                        {
+                            EXPECT_EQ(key.second, PSK(32, static_cast<uint8_t>((key.first - 1) / keysPerThread)));
+                        }
+                        taken[threadId].insert(taken[threadId].end(), ids.begin(), ids.end());
+                        ids.clear();
+                    }
+                });
+            }
+            for(auto& thread : threads)
+            {
+                thread.join();
+            }
+
+            std::set<KeyID> allTaken;
+            for(const auto& ids : taken)
+            {
+                allTaken.insert(ids.begin(), ids.end());
+            }
+            ASSERT_EQ(allTaken.size(), totalKeys);
+            store.GetCounts(dest, available, capacity);
+            ASSERT_EQ(available, 0u);
+            // ids aren't reused
+            ASSERT_EQ(store.GetNextKeyId(dest), totalKeys + 1);
+        }
+
     }
 }
@@ -0,0 +1,304 @@
+/*!
+* @file
+* @brief TestRecords
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "gtest/gtest.h"
+#include "Networking/Tunnels/Records.h"
+#include "Networking/Tunnels/RecordBatch.h"
+#include <cryptopp/aes.h>
+#include <cryptopp/gcm.h>
+#include <cryptopp/osrng.h>
+#include <cryptopp/secblock.h>
+#include <thread>
+#include <vector>
+
+namespace cqp
+{
+    namespace tests
+    {
+        using tunnels::Records;
+        using tunnels::RecordBatch;
+        using namespace CryptoPP;
+
+        /// The records found by ParseRecords
+        struct ParsedRecord
+        {
+            /// the iv for the record
+            std::string iv;
+            /// the cypher text and mac
+            std::string data;
+        };
+
+        /// A handler which collects the records
+        static Records::RecordHandler Collect(std::vector<ParsedRecord>& records)
+        {
+            return [&records](const unsigned char* iv, size_t ivLength, const unsigned char* data, size_t length)
+            {
+                records.push_back({std::string(reinterpret_cast<const char*>(iv), ivLength),
+                                   std::string(reinterpret_cast<const char*>(data), length)});
+                return grpc::Status();
+            };
+        }
+
+        /// Write a big endian record length
+        static void AppendLength(std::string& payload, uint32_t length)
+        {
+            for(size_t index = 0; index < Records::HeaderSize; index++)
+            {
+                payload.push_back(static_cast<char>((length >> ((Records::HeaderSize - index - 1) * 8)) & 0xFF));
+            }
+        }
+
+        /**
+         * @test
+         * @brief TEST
+         */
+        TEST(Records, RoundTrip)
+        {
+            AutoSeededRandomPool rng;
+            SecByteBlock key(AES::DEFAULT_KEYLENGTH);
+            rng.GenerateBlock(key, key.size());
+            GCM<AES>::Encryption encryptor;
+            GCM<AES>::Decryption decryptor;
+            encryptor.SetKey(key, key.size());
+            decryptor.SetKey(key, key.size());
+
+            const std::vector<std::string> packets = {"first packet", "", std::string(1500, 'x'), "last"};
+            std::string payload;
+            SecByteBlock iv(AES::BLOCKSIZE);
+            for(const auto& packet : packets)
+            {
+                rng.GenerateBlock(iv, iv.size());
+                const size_t before = payload.size();
+                Records::AppendRecord(payload, encryptor, iv, iv.size(),
+                                      reinterpret_cast<const unsigned char*>(packet.data()), packet.size());
+                ASSERT_EQ(payload.size() - before, Records::RecordSize(iv.size(), packet.size()));
+            }
+
+            std::vector<std::string> received;
+            auto status = Records::ParseRecords(payload, AES::BLOCKSIZE, [&](const unsigned char* recordIv, size_t ivLength,
+                                                const unsigned char* data, size_t length)
+            {
+                std::string plainText(length - Records::MacSize, '\0');
+                auto result = Records::DecryptRecord(decryptor, recordIv, ivLength, data, length,
+                                                     reinterpret_cast<unsigned char*>(&plainText[0]));
+                received.push_back(plainText);
+                return result;
+            });
+
+            ASSERT_TRUE(status.ok());
+            ASSERT_EQ(received, packets);
+        }
+
+        /**
+         * @test
+         * @brief TEST
+         */
+        TEST(Records, Authentication)
+        {
+            AutoSeededRandomPool rng;
+            SecByteBlock key(AES::DEFAULT_KEYLENGTH);
+            SecByteBlock iv(AES::BLOCKSIZE);
+            rng.GenerateBlock(key, key.size());
+            rng.GenerateBlock(iv, iv.size());
+            GCM<AES>::Encryption encryptor;
+            GCM<AES>::Decryption decryptor;
+            encryptor.SetKey(key, key.size());
+            decryptor.SetKey(key, key.size());
+
+            const std::string packet = "Some plain text which needs protecting";
+            std::string record(packet.size() + Records::MacSize, '\0');
+            auto* recordData = reinterpret_cast<unsigned char*>(&record[0]);
+            Records::EncryptRecord(encryptor, iv, iv.size(),
+                                   reinterpret_cast<const unsigned char*>(packet.data()), packet.size(), recordData);
+            ASSERT_NE(record.substr(0, packet.size()), packet);
+
+            std::string plainText(packet.size(), '\0');
+            auto* plainTextData = reinterpret_cast<unsigned char*>(&plainText[0]);
+
+            // round trip
+            ASSERT_TRUE(Records::DecryptRecord(decryptor, iv, iv.size(), recordData, record.size(), plainTextData).ok());
+            ASSERT_EQ(plainText, packet);
+
+            // flipped bit in the cypher text
+            recordData[3] ^= 0x10;
+            ASSERT_EQ(Records::DecryptRecord(decryptor, iv, iv.size(), recordData, record.size(), plainTextData).error_code(),
+                      grpc::StatusCode::DATA_LOSS);
+            recordData[3] ^= 0x10;
+
+            // flipped bit in the tag
+            recordData[record.size() - 1] ^= 0x01;
+            ASSERT_EQ(Records::DecryptRecord(decryptor, iv, iv.size(), recordData, record.size(), plainTextData).error_code(),
+                      grpc::StatusCode::DATA_LOSS);
+            recordData[record.size() - 1] ^= 0x01;
+
+            // wrong iv
+            SecByteBlock otherIv(iv);
+            otherIv[0] ^= 0x01;
+            ASSERT_EQ(Records::DecryptRecord(decryptor, otherIv, otherIv.size(), recordData, record.size(), plainTextData).error_code(),
+                      grpc::StatusCode::DATA_LOSS);
+
+            // too short to hold a tag
+            ASSERT_EQ(Records::DecryptRecord(decryptor, iv, iv.size(), recordData, Records::MacSize - 1, plainTextData).error_code(),
+                      grpc::StatusCode::DATA_LOSS);
+
+            // the original still decrypts once the bits are restored
+            ASSERT_TRUE(Records::DecryptRecord(decryptor, iv, iv.size(), recordData, record.size(), plainTextData).ok());
+            ASSERT_EQ(plainText, packet);
+        }
+
+        /**
+         * @test
+         * @brief TEST
+         */
+        TEST(Records, Malformed)
+        {
+            const size_t ivLength = AES::BLOCKSIZE;
+            std::vector<ParsedRecord> records;
+
+            // a valid record holding 4 bytes of cypher text
+            std::string payload;
+            AppendLength(payload, ivLength + 4 + Records::MacSize);
+            payload.append(ivLength, 'i');
+            payload.append(4 + Records::MacSize, 'd');
+            ASSERT_TRUE(Records::ParseRecords(payload, ivLength, Collect(records)).ok());
+            ASSERT_EQ(records.size(), 1);
+            ASSERT_EQ(records[0].iv, std::string(ivLength, 'i'));
+            ASSERT_EQ(records[0].data, std::string(4 + Records::MacSize, 'd'));
+
+            // truncated record
+            records.clear();
+            std::string truncated = payload + payload;
+            truncated.pop_back();
+            ASSERT_EQ(Records::ParseRecords(truncated, ivLength, Collect(records)).error_code(), grpc::StatusCode::DATA_LOSS);
+            // the first record is still passed on
+            ASSERT_EQ(records.size(), 1);
+
+            // truncated header
+            records.clear();
+            std::string truncatedHeader = payload;
+            truncatedHeader.append(Records::HeaderSize - 1, '\0');
+            ASSERT_EQ(Records::ParseRecords(truncatedHeader, ivLength, Collect(records)).error_code(), grpc::StatusCode::DATA_LOSS);
+            ASSERT_EQ(records.size(), 1);
+
+            // zero length record
+            records.clear();
+            std::string zeroLength;
+            AppendLength(zeroLength, 0);
+            zeroLength += payload;
+            ASSERT_EQ(Records::ParseRecords(zeroLength, ivLength, Collect(records)).error_code(), grpc::StatusCode::DATA_LOSS);
+            ASSERT_EQ(records.size(), 0);
+
+            // too short to hold an iv and a mac
+            records.clear();
+            std::string tooShort;
+            AppendLength(tooShort, ivLength + Records::MacSize - 1);
+            tooShort.append(ivLength + Records::MacSize - 1, 'd');
+            ASSERT_EQ(Records::ParseRecords(tooShort, ivLength, Collect(records)).error_code(), grpc::StatusCode::DATA_LOSS);
+            ASSERT_EQ(records.size(), 0);
+
+            // length prefix larger than the message
+            records.clear();
+            std::string oversized;
+            AppendLength(oversized, 0xFFFFFFFF);
+            oversized.append(ivLength + Records::MacSize, 'd');
+            ASSERT_EQ(Records::ParseRecords(oversized, ivLength, Collect(records)).error_code(), grpc::StatusCode::DATA_LOSS);
+            ASSERT_EQ(records.size(), 0);
+
+            // errors from the handler stop the parsing
+            size_t calls = 0;
+            auto status = Records::ParseRecords(payload + payload, ivLength, [&](const unsigned char*, size_t, const unsigned char*, size_t)
+            {
+                calls++;
+                return grpc::Status(grpc::StatusCode::DATA_LOSS, "bad record");
+            });
+            ASSERT_FALSE(status.ok());
+            ASSERT_EQ(calls, 1);
+        }
+
+        /**
+         * @test
+         * @brief TEST
+         */
+        TEST(Records, BatchFlush)
+        {
+            using std::chrono::milliseconds;
+            std::mutex sentMutex;
+            std::vector<remote::EncryptedDataValues> sent;
+            tunnels::Statistics stats;
+            const size_t maxBytes = 100;
+            const auto latency = milliseconds(200);
+
+            RecordBatch batch(maxBytes, latency, [&](const remote::EncryptedDataValues& message)
+            {
+                std::lock_guard<std::mutex> lock(sentMutex);
+                sent.push_back(message);
+                return true;
+            }, stats);
+
+            auto append = [](char value, size_t length)
+            {
+                return [value, length](std::string& payload)
+                {
+                    payload.append(length, value);
+                };
+            };
+
+            // a partly filled message waits for the latency
+            ASSERT_TRUE(batch.Add(1, 10, append('a', 10)));
+            ASSERT_TRUE(batch.Add(1, 10, append('b', 10)));
+            {
+                std::lock_guard<std::mutex> lock(sentMutex);
+                ASSERT_EQ(sent.size(), 0);
+            }
+
+            std::this_thread::sleep_for(latency * 3);
+            {
+                std::lock_guard<std::mutex> lock(sentMutex);
+                ASSERT_EQ(sent.size(), 1);
+                ASSERT_EQ(sent[0].keyid(), 1);
+                ASSERT_EQ(sent[0].payload(), std::string(10, 'a') + std::string(10, 'b'));
+                sent.clear();
+            }
+
+            // a new key starts a new message
+            ASSERT_TRUE(batch.Add(1, 10, append('c', 10)));
+            ASSERT_TRUE(batch.Add(2, 10, append('d', 10)));
+            // a record which doesn't fit starts a new message
+            ASSERT_TRUE(batch.Add(2, 100, append('e', 100)));
+            // messages which are sent straight away follow the records already added
+            remote::EncryptedDataValues announcement;
+            announcement.set_keyid(3);
+            ASSERT_TRUE(batch.Send(announcement));
+            {
+                std::lock_guard<std::mutex> lock(sentMutex);
+                ASSERT_EQ(sent.size(), 4);
+                ASSERT_EQ(sent[0].keyid(), 1);
+                ASSERT_EQ(sent[0].payload(), std::string(10, 'c'));
+                ASSERT_EQ(sent[1].keyid(), 2);
+                ASSERT_EQ(sent[1].payload(), std::string(10, 'd'));
+                // a full message is sent straight away
+                ASSERT_EQ(sent[2].payload(), std::string(100, 'e'));
+                ASSERT_EQ(sent[3].keyid(), 3);
+                ASSERT_TRUE(sent[3].payload().empty());
+                sent.clear();
+            }
+
+            // anything left is sent when stopping
+            ASSERT_TRUE(batch.Add(3, 10, append('f', 10)));
+            batch.Stop();
+            {
+                std::lock_guard<std::mutex> lock(sentMutex);
+                ASSERT_EQ(sent.size(), 1);
+                ASSERT_EQ(sent[0].payload(), std::string(10, 'f'));
+            }
+        }
+    } // namespace tests
+} // namespace cqp
@@ -20,6 +20,8 @@
 #include "Algorithms/Datatypes/URI.h"
 #include "Networking/Tunnels/RawSocket.h"
 #include "Algorithms/Logging/Logger.h"
+#include <sys/socket.h>
+#include <cstring>
 
 namespace cqp
 {
@@ -83,6 +85,131 @@ namespace cqp
             ASSERT_EQ(sent, std::string(received));
         }
 
+        /// Provides access to one end of a socket pair
+        class PairedSocket : public net::Socket
+        {
+        public:
+            /// Constructor, takes ownership of the handle
+            explicit PairedSocket(int pairHandle)
+            {
+                handle = pairHandle;
+            }
+        };
+
+        TEST(Net, ReadMany)
+        {
+            int handles[2] {};
+            ASSERT_EQ(::socketpair(AF_UNIX, SOCK_DGRAM, 0, handles), 0);
+            PairedSocket sender(handles[0]);
+            PairedSocket receiver(handles[1]);
+
+            const std::vector<std::string> sent = {"one", "two", "three", "four", "five"};
+            for(const auto& message : sent)
+            {
+                ASSERT_TRUE(sender.Write(message.data(), message.size()));
+            }
+
+            // more buffers than packets, all the waiting packets are returned
+            std::vector<char> storage(8 * 64);
+            std::vector<net::PacketBuffer> packets(8);
+            for(size_t index = 0; index < packets.size(); index++)
+            {
+                packets[index].data = &storage[index * 64];
+                packets[index].length = 64;
+            }
+
+            size_t packetsReceived = 0;
+            ASSERT_TRUE(receiver.ReadMany(packets, packetsReceived));
+            ASSERT_EQ(packetsReceived, sent.size());
+            for(size_t index = 0; index < packetsReceived; index++)
+            {
+                ASSERT_EQ(std::string(static_cast<const char*>(packets[index].data), packets[index].bytes), sent[index]);
+            }
+
+            // fewer buffers than packets, the rest are left for the next read
+            for(const auto& message : sent)
+            {
+                ASSERT_TRUE(sender.Write(message.data(), message.size()));
+            }
+            packets.resize(2);
+            ASSERT_TRUE(receiver.ReadMany(packets, packetsReceived));
+            ASSERT_EQ(packetsReceived, 2);
+            ASSERT_EQ(std::string(static_cast<const char*>(packets[1].data), packets[1].bytes), sent[1]);
+            packets.resize(8);
+            ASSERT_TRUE(receiver.ReadMany(packets, packetsReceived));
+            ASSERT_EQ(packetsReceived, 3);
+            ASSERT_EQ(std::string(static_cast<const char*>(packets[0].data), packets[0].bytes), sent[2]);
+
+            // nothing waiting is a timeout, not an error
+            ASSERT_TRUE(receiver.SetBlocking(false));
+            ASSERT_TRUE(receiver.ReadMany(packets, packetsReceived));
+            ASSERT_EQ(packetsReceived, 0);
+        }
+
+        TEST(Net, WriteMany)
+        {
+            int handles[2] {};
+            ASSERT_EQ(::socketpair(AF_UNIX, SOCK_DGRAM, 0, handles), 0);
+            PairedSocket sender(handles[0]);
+            PairedSocket receiver(handles[1]);
+
+            // far more than the socket can hold so that sendmmsg only takes some of them
+            const size_t numPackets = 4000;
+            const size_t packetSize = 1024;
+            std::vector<char> storage(numPackets * packetSize);
+            std::vector<net::PacketBuffer> packets(numPackets);
+            for(size_t index = 0; index < numPackets; index++)
+            {
+                packets[index].data = &storage[index * packetSize];
+                packets[index].length = packetSize;
+                // packets have different lengths and contents
+                packets[index].bytes = sizeof(uint32_t) + index % 100;
+                const auto value = static_cast<uint32_t>(index);
+                std::memcpy(packets[index].data, &value, sizeof(value));
+            }
+
+            // the partial results from the non blocking socket must be retried until all are sent
+            ASSERT_TRUE(sender.SetBlocking(false));
+            std::future<bool> writer = std::async(std::launch::async, [&]()
+            {
+                return sender.WriteMany(packets, numPackets);
+            });
+
+            std::vector<char> readStorage(16 * packetSize);
+            std::vector<net::PacketBuffer> readPackets(16);
+            for(size_t index = 0; index < readPackets.size(); index++)
+            {
+                readPackets[index].data = &readStorage[index * packetSize];
+                readPackets[index].length = packetSize;
+            }
+
+            // stop waiting if the writer gives up
+            ASSERT_TRUE(receiver.SetReceiveTimeout(std::chrono::milliseconds(1000)));
+            size_t expected = 0;
+            while(expected < numPackets)
+            {
+                size_t packetsReceived = 0;
+                ASSERT_TRUE(receiver.ReadMany(readPackets, packetsReceived));
+                ASSERT_GT(packetsReceived, 0);
+                for(size_t index = 0; index < packetsReceived; index++)
+                {
+                    uint32_t value = 0;
+                    std::memcpy(&value, readPackets[index].data, sizeof(value));
+                    ASSERT_EQ(value, expected);
+                    ASSERT_EQ(readPackets[index].bytes, sizeof(uint32_t) + expected % 100);
+                    expected++;
+                }
+            }
+
+            ASSERT_TRUE(writer.get());
+            // only the number of packets asked for are sent
+            ASSERT_TRUE(sender.WriteMany(packets, 1));
+            ASSERT_TRUE(receiver.SetBlocking(false));
+            size_t packetsReceived = 0;
+            ASSERT_TRUE(receiver.ReadMany(readPackets, packetsReceived));
+            ASSERT_EQ(packetsReceived, 1);
+        }
+
         TEST(Net, DISABLED_Raw)
         {
             DefaultLogger().SetOutputLevel(LogLevel::Trace);
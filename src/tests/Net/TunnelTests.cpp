@@ -11,11 +11,15 @@
 */
 #include "TunnelTests.h"
 #include "Networking/Tunnels/Controller.h"
+#include "Networking/Tunnels/KeyPrefetcher.h"
+#include "Networking/Tunnels/RecentKeys.h"
 #include "Algorithms/Logging/ConsoleLogger.h"
 #include "Algorithms/Random/RandomNumber.h"
 #include "CQPToolkit/Util/GrpcLogger.h"
 #include "Algorithms/Net/Sockets/Stream.h"
 #include <gmock/gmock.h>
+#include <grpcpp/create_channel.h>
+#include <thread>
 
 namespace cqp
 {
@@ -179,5 +183,110 @@ namespace cqp
                 }
             }
         }
+
+        TEST_F(TunnelTests, KeyPrefetcher)
+        {
+            using std::chrono::milliseconds;
+            const std::string site1 = "127.0.0.1:" + std::to_string(server1ListenPort);
+            const std::string site2 = "127.0.0.1:" + std::to_string(server2ListenPort);
+            auto keyFactory1 = remote::IKey::NewStub(grpc::CreateChannel(site1, grpc::InsecureChannelCredentials()));
+            auto keyFactory2 = remote::IKey::NewStub(grpc::CreateChannel(site2, grpc::InsecureChannelCredentials()));
+            tunnels::Statistics stats1;
+            tunnels::Statistics stats2;
+
+            {
+                // without a depth, keys are fetched when asked for and nothing is announced
+                tunnels::KeyPrefetcher onDemand(keyFactory1.get(), site2, 0, stats1);
+                tunnels::KeyPrefetcher farSide(keyFactory2.get(), site1, 0, stats2);
+                remote::SharedKey key;
+                ASSERT_TRUE(onDemand.NextKey(key, milliseconds(1000)));
+                ASSERT_FALSE(key.keyvalue().empty());
+                ASSERT_TRUE(onDemand.TakeNewKeyIds().empty());
+
+                // keys which weren't announced can still be fetched by the far side
+                remote::SharedKey farKey;
+                ASSERT_TRUE(farSide.GetKey(key.keyid(), farKey));
+                ASSERT_EQ(farKey.keyvalue(), key.keyvalue());
+            }
+
+            tunnels::KeyPrefetcher encryptor(keyFactory1.get(), site2, 3, stats1);
+            tunnels::KeyPrefetcher decryptor(keyFactory2.get(), site1, 0, stats2);
+            std::vector<remote::SharedKey> used;
+            std::vector<uint64_t> announced;
+
+            for(int count = 0; count < 10; count++)
+            {
+                remote::SharedKey key;
+                ASSERT_TRUE(encryptor.NextKey(key, milliseconds(5000)));
+                used.push_back(key);
+                // pass the ids on as the tunnel would
+                for(const auto keyId : encryptor.TakeNewKeyIds())
+                {
+                    announced.push_back(keyId);
+                    decryptor.Prefetch(keyId);
+                }
+            }
+
+            for(size_t index = 0; index < used.size(); index++)
+            {
+                // every key is announced before it's used and is only used once
+                ASSERT_THAT(announced, Contains(used[index].keyid()));
+                for(size_t other = index + 1; other < used.size(); other++)
+                {
+                    ASSERT_NE(used[index].keyid(), used[other].keyid());
+                }
+
+                remote::SharedKey farKey;
+                ASSERT_TRUE(decryptor.GetKey(used[index].keyid(), farKey));
+                ASSERT_EQ(farKey.keyvalue(), used[index].keyvalue());
+            }
+        }
+
+        TEST(RecentKeys, GracePeriod)
+        {
+            using std::chrono::milliseconds;
+            tunnels::RecentKeys recentKeys(milliseconds(500));
+
+            remote::SharedKey key;
+            key.set_keyid(1);
+            key.set_keyvalue("first");
+            recentKeys.Add(std::move(key));
+            // empty keys aren't kept
+            key.Clear();
+            key.set_keyid(2);
+            recentKeys.Add(std::move(key));
+
+            remote::SharedKey found;
+            ASSERT_FALSE(recentKeys.Take(2, found));
+            ASSERT_FALSE(recentKeys.Take(3, found));
+            ASSERT_TRUE(recentKeys.Take(1, found));
+            ASSERT_EQ(found.keyvalue(), "first");
+            // each key can only be taken once
+            ASSERT_FALSE(recentKeys.Take(1, found));
+
+            key.Clear();
+            key.set_keyid(1);
+            key.set_keyvalue("first");
+            recentKeys.Add(std::move(key));
+            std::this_thread::sleep_for(milliseconds(300));
+
+            key.Clear();
+            key.set_keyid(4);
+            key.set_keyvalue("second");
+            recentKeys.Add(std::move(key));
+            std::this_thread::sleep_for(milliseconds(300));
+
+            // the first key has expired, the second is still in its grace period
+            ASSERT_FALSE(recentKeys.Take(1, found));
+            ASSERT_TRUE(recentKeys.Take(4, found));
+            ASSERT_EQ(found.keyvalue(), "second");
+
+            key.Clear();
+            key.set_keyid(5);
+            key.set_keyvalue("third");
+            recentKeys.Add(std::move(key));
+            std::this_thread::sleep_for(milliseconds(600));
+            ASSERT_FALSE(recentKeys.Take(5, found));
+        }
     } // namespace tests
 } // namespace cqp
@@ -0,0 +1,111 @@
+/*!
+* @file
+* @brief Privacy Amplification Tests
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "PrivacyAmpTests.h"
+#include "Algorithms/Logging/ConsoleLogger.h"
+#include "CQPToolkit/PrivacyAmp/Toeplitz.h"
+#include "CQPToolkit/PrivacyAmp/PrivacyAmplify.h"
+
+namespace cqp
+{
+    namespace tests
+    {
+
+        PrivacyAmpTests::PrivacyAmpTests()
+        {
+            ConsoleLogger::Enable();
+            DefaultLogger().SetOutputLevel(LogLevel::Info);
+        }
+
+        PackedBits PrivacyAmpTests::RandomBits(size_t numBits)
+        {
+            PackedBits result((numBits + bitsPerWord - 1) / bitsPerWord);
+            for(auto& word : result)
+            {
+                word = rng();
+            }
+            if(numBits % bitsPerWord != 0)
+            {
+                result.back() &= (uint64_t(1) << (numBits % bitsPerWord)) - 1u;
+            }
+            return result;
+        }
+
+        PackedBits PrivacyAmpTests::NaiveHash(const PackedBits& input, size_t inputBits, const PackedBits& seed, size_t outputBits)
+        {
+            PackedBits result((outputBits + bitsPerWord - 1) / bitsPerWord, 0);
+            for(size_t row = 0; row < outputBits; row++)
+            {
+                bool bit = false;
+                for(size_t column = 0; column < inputBits; column++)
+                {
+                    bit ^= GetBit(seed, row + inputBits - 1 - column) && GetBit(input, column);
+                }
+                if(bit)
+                {
+                    FlipBit(result, row);
+                }
+            }
+            return result;
+        }
+
+        TEST_F(PrivacyAmpTests, Toeplitz)
+        {
+            privacy::ToeplitzHash hasher;
+            for(const size_t inputBits : {1u, 64u, 100u, 1000u, 4099u})
+            {
+                const size_t outputBits = inputBits / 2 + 1;
+                const PackedBits input = RandomBits(inputBits);
+                const PackedBits seed = RandomBits(privacy::ToeplitzHash::SeedLength(inputBits, outputBits));
+
+                ASSERT_EQ(hasher.Hash(input, inputBits, seed, outputBits), NaiveHash(input, inputBits, seed, outputBits))
+                        << "inputBits: " << inputBits;
+            }
+        }
+
+        TEST_F(PrivacyAmpTests, ToeplitzSplit)
+        {
+            // force the product to be calculated in pieces
+            privacy::ToeplitzHash hasher(64);
+            const size_t inputBits = 1000;
+            const PackedBits input = RandomBits(inputBits);
+            for(const size_t outputBits : {1u, 31u, 333u, 1500u})
+            {
+                const PackedBits seed = RandomBits(privacy::ToeplitzHash::SeedLength(inputBits, outputBits));
+
+                ASSERT_EQ(hasher.Hash(input, inputBits, seed, outputBits), NaiveHash(input, inputBits, seed, outputBits))
+                        << "outputBits: " << outputBits;
+            }
+
+            // invalid lengths give an empty result
+            ASSERT_TRUE(hasher.Hash(input, inputBits, PackedBits(1), 10).empty());
+            ASSERT_TRUE(hasher.Hash(input, 0, input, 10).empty());
+        }
+
+        TEST_F(PrivacyAmpTests, SecureKeyLength)
+        {
+            using privacy::PrivacyAmplify;
+            // no errors and nothing leaked only costs the security parameter
+            ASSERT_EQ(PrivacyAmplify::SecureKeyLength(1000000, 0, 0, 1e-10), 999928u);
+
+            const size_t withErrors = PrivacyAmplify::SecureKeyLength(1000000, 30000, 200000, 1e-10);
+            ASSERT_EQ(withErrors % 8, 0u);
+            ASSERT_GT(withErrors, 600000u);
+            ASSERT_LT(withErrors, 610000u);
+
+            // too many errors leaves nothing
+            ASSERT_EQ(PrivacyAmplify::SecureKeyLength(1000000, 110000, 600000, 1e-10), 0u);
+            ASSERT_EQ(PrivacyAmplify::SecureKeyLength(64, 0, 0, 1e-10), 0u);
+            ASSERT_EQ(PrivacyAmplify::SecureKeyLength(0, 0, 0, 1e-10), 0u);
+        }
+
+    } // namespace tests
+} // namespace cqp
@@ -0,0 +1,60 @@
+/*!
+* @file
+* @brief Privacy Amplification Tests
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#pragma once
+#include "gtest/gtest.h"
+#include "Algorithms/Util/Bits.h"
+#include <random>
+
+namespace cqp
+{
+    namespace tests
+    {
+
+        /**
+         * @test
+         * @brief The PrivacyAmpTests class
+         * For testing privacy amplification
+         */
+        class PrivacyAmpTests : public testing::Test
+        {
+        public:
+            /**
+             * @brief PrivacyAmpTests
+             * Constructor
+             */
+            PrivacyAmpTests();
+
+        protected:
+            /**
+             * @brief RandomBits
+             * @param numBits The number of bits to create
+             * @return random bits, the unused bits at the end are 0
+             */
+            PackedBits RandomBits(size_t numBits);
+
+            /**
+             * @brief NaiveHash
+             * Multiply by the toeplitz matrix one bit at a time
+             * @param input The bits to compress
+             * @param inputBits The number of valid bits in input
+             * @param seed The first column and row of the matrix
+             * @param outputBits The length of the result
+             * @return The hash
+             */
+            static PackedBits NaiveHash(const PackedBits& input, size_t inputBits, const PackedBits& seed, size_t outputBits);
+
+            /// source of test data, fixed seed so that failures can be reproduced
+            std::mt19937_64 rng {1234};
+        };
+
+    } // namespace tests
+} // namespace cqp
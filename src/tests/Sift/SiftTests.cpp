@@ -11,6 +11,7 @@
 */
 #include "SiftTests.h"
 #include "Algorithms/Logging/ConsoleLogger.h"
+#include "Algorithms/Util/CpuFeatures.h"
 #include "CQPToolkit/Sift/Receiver.h"
 #include "CQPToolkit/Sift/Verifier.h"
 
@@ -21,6 +22,8 @@
 #include <grpc++/client_context.h>
 #include <grpc++/security/credentials.h>
 #include <gmock/gmock-actions.h>
+#include <random>
+#include <algorithm>
 
 namespace cqp
 {
@@ -191,7 +194,8 @@ namespace cqp
             ServerBuilder builder;
             int listenPort = 0;
             builder.AddListeningPort("localhost:0", grpc::InsecureServerCredentials(), &listenPort);
-            builder.RegisterService(&reciever);
+            builder.RegisterService(static_cast<remote::ISift::Service*>(&reciever));
+            builder.RegisterService(static_cast<remote::ICompactSift::Service*>(&reciever));
 
             std::unique_ptr<Server> server(builder.BuildAndStart());
 
@@ -269,5 +273,226 @@ namespace cqp
             }
         }
 
+        TEST_P(SiftTests, Pipelined)
+        {
+            using namespace cqp::sift;
+            using namespace std;
+            using namespace grpc;
+            // without ICompactSift the receiver has to fall back to ISift
+            const bool useCompact = GetParam();
+            const size_t numFrames = 20;
+            const size_t frameSize = 1000;
+
+            Verifier reciever;
+            ServerBuilder builder;
+            int listenPort = 0;
+            builder.AddListeningPort("localhost:0", grpc::InsecureServerCredentials(), &listenPort);
+            builder.RegisterService(static_cast<remote::ISift::Service*>(&reciever));
+            if(useCompact)
+            {
+                builder.RegisterService(static_cast<remote::ICompactSift::Service*>(&reciever));
+            }
+            std::unique_ptr<Server> server(builder.BuildAndStart());
+            ASSERT_NE(server, nullptr);
+
+            map<SequenceNumber, JaggedDataBlock> aliceResults;
+            map<SequenceNumber, JaggedDataBlock> bobResults;
+            // the order alice published in
+            vector<SequenceNumber> aliceOrder;
+            EXPECT_CALL(aliceCallback, OnSifted2(_, _, _)).WillRepeatedly(Invoke([this, &aliceResults, &aliceOrder](const SequenceNumber id, double,
+                    const JaggedDataBlock* siftedData)
+            {
+                {
+                    lock_guard<mutex> lock(m);
+                    aliceResults[id] = *siftedData;
+                    aliceOrder.push_back(id);
+                }
+                cv.notify_one();
+            }));
+            EXPECT_CALL(bobCallback, OnSifted2(_, _, _)).WillRepeatedly(Invoke([this, &bobResults](const SequenceNumber id, double,
+                    const JaggedDataBlock* siftedData)
+            {
+                {
+                    lock_guard<mutex> lock(m);
+                    bobResults[id] = *siftedData;
+                }
+                cv.notify_one();
+            }));
+
+            // allow several requests to be outstanding
+            Receiver transitter(1, 4);
+            transitter.Connect(grpc::CreateChannel("localhost:" + std::to_string(listenPort), grpc::InsecureChannelCredentials()));
+            reciever.Attach(&aliceCallback);
+            transitter.Attach(&bobCallback);
+
+            std::mt19937 rng(1234);
+            vector<unique_ptr<EmitterReport>> emitterReports;
+            for(SequenceNumber frame = 0; frame < numFrames; frame++)
+            {
+                auto emitterReport = make_unique<EmitterReport>();
+                emitterReport->frame = frame;
+                emitterReport->emissions.resize(frameSize);
+                auto photonReport = make_unique<ProtocolDetectionReport>();
+                photonReport->frame = frame;
+                for(size_t index = 0; index < frameSize; index++)
+                {
+                    emitterReport->emissions[index] = static_cast<Qubit>(rng() % 4);
+                    // bob measures in a random basis
+                    const Qubit measured = (rng() % 2) ? emitterReport->emissions[index] : static_cast<Qubit>(rng() % 4);
+                    photonReport->detections.push_back({PicoSeconds(index), measured});
+                }
+                emitterReports.push_back(move(emitterReport));
+                transitter.OnPhotonReport(move(photonReport));
+            }
+            // give alice the frames backwards so that the later requests are answered first
+            for(auto report = emitterReports.rbegin(); report != emitterReports.rend(); report++)
+            {
+                reciever.OnEmitterReport(move(*report));
+            }
+
+            bool gotLock = false;
+            {
+                unique_lock<mutex> lock(m);
+                gotLock = cv.wait_for(lock, chrono::seconds(10), [&]()
+                {
+                    return aliceResults.size() == numFrames && bobResults.size() == numFrames;
+                });
+            }
+            transitter.Disconnect();
+            server->Shutdown();
+
+            ASSERT_TRUE(gotLock) << "Alice: " << aliceResults.size() << " Bob: " << bobResults.size();
+            // alice publishes in the order the requests were sent, whichever was answered first
+            ASSERT_TRUE(is_sorted(aliceOrder.begin(), aliceOrder.end()));
+            for(const auto& result : bobResults)
+            {
+                ASSERT_FALSE(result.second.empty());
+                ASSERT_EQ(result.second, aliceResults[result.first]) << "Sifted frame " << result.first;
+            }
+        }
+
+        TEST(SiftKernel, CompactBits)
+        {
+            std::mt19937_64 rng(1234);
+            PackedBits output;
+            size_t outputBits = 0;
+            std::vector<bool> expected;
+
+            // lengths which start and end part way through a word
+            for(const size_t numBits : {0u, 1u, 63u, 64u, 65u, 100u, 1000u})
+            {
+                PackedBits values((numBits + bitsPerWord - 1) / bitsPerWord);
+                PackedBits keep(values.size());
+                for(size_t word = 0; word < values.size(); word++)
+                {
+                    values[word] = rng();
+                    // vary the density, including words with nothing kept
+                    keep[word] = (word % 3 == 0) ? 0 : rng() & rng();
+                }
+
+                for(size_t index = 0; index < numBits; index++)
+                {
+                    if(GetBit(keep, index))
+                    {
+                        expected.push_back(GetBit(values, index));
+                    }
+                }
+
+                sift::SiftBase::CompactBits(values, keep, numBits, output, outputBits);
+                ASSERT_EQ(outputBits, expected.size());
+                ASSERT_EQ(output.size(), (outputBits + bitsPerWord - 1) / bitsPerWord);
+                for(size_t index = 0; index < expected.size(); index++)
+                {
+                    ASSERT_EQ(GetBit(output, index), expected[index]) << "index: " << index;
+                }
+                if(outputBits % bitsPerWord != 0)
+                {
+                    // the unused bits are clear
+                    ASSERT_EQ(output.back() >> (outputBits % bitsPerWord), 0u);
+                }
+            }
+        }
+
+        TEST(SiftKernel, CompactBitsBmi2)
+        {
+            if(!cpu::HasBmi2())
+            {
+                LOGINFO("BMI2 not supported, only the portable version can be tested");
+            }
+
+            std::mt19937_64 rng(4321);
+            PackedBits pextOutput;
+            size_t pextBits = 0;
+            PackedBits portableOutput;
+            size_t portableBits = 0;
+
+            for(const size_t numBits : {0u, 1u, 63u, 64u, 65u, 100u, 1000u, 4099u})
+            {
+                PackedBits values((numBits + bitsPerWord - 1) / bitsPerWord);
+                PackedBits keep(values.size());
+                for(size_t word = 0; word < values.size(); word++)
+                {
+                    values[word] = rng();
+                    switch (word % 4)
+                    {
+                    case 0:
+                        keep[word] = 0;
+                        break;
+                    case 1:
+                        keep[word] = ~uint64_t(0);
+                        break;
+                    default:
+                        keep[word] = rng() & rng();
+                        break;
+                    }
+                }
+
+                // both versions append to what's already there
+                sift::SiftBase::CompactBits(values, keep, numBits, pextOutput, pextBits, true);
+                sift::SiftBase::CompactBits(values, keep, numBits, portableOutput, portableBits, false);
+                ASSERT_EQ(pextBits, portableBits) << "numBits: " << numBits;
+                ASSERT_EQ(pextOutput, portableOutput) << "numBits: " << numBits;
+            }
+        }
+
+        TEST(SiftKernel, CompactBases)
+        {
+            std::mt19937 rng(1234);
+            QubitList emissions(1000);
+            for(auto& qubit : emissions)
+            {
+                qubit = static_cast<Qubit>(rng() % 4);
+            }
+
+            // sparse detections, one of them out of range
+            ProtocolDetectionReport report;
+            for(size_t index = 0; index < emissions.size(); index += 1 + rng() % 20)
+            {
+                report.detections.push_back({PicoSeconds(index), static_cast<Qubit>(rng() % 4)});
+            }
+            report.detections.push_back({PicoSeconds(emissions.size()), static_cast<Qubit>(BB84::Zero)});
+
+            remote::CompactBases bases;
+            sift::Receiver::EncodeBases(sift::Receiver::PackDetections(report), bases);
+            ASSERT_EQ(static_cast<size_t>(bases.indexdelta().size()), report.detections.size());
+            ASSERT_EQ(bases.bases().size(), (report.detections.size() + 3) / 4);
+
+            remote::CompactAnswers answers;
+            ASSERT_TRUE(sift::Verifier::CompareBases(bases, PackedQubits(emissions), answers));
+            ASSERT_EQ(answers.numanswers(), report.detections.size());
+            for(size_t index = 0; index < report.detections.size(); index++)
+            {
+                const auto& detection = report.detections[index];
+                const size_t emission = static_cast<size_t>(detection.time.count());
+                const bool expected = emission < emissions.size() &&
+                                      QubitHelper::Base(emissions[emission]) == QubitHelper::Base(detection.value);
+                ASSERT_EQ((static_cast<uint8_t>(answers.answers()[index / 8]) >> (index % 8)) & 1u, expected) << "index: " << index;
+            }
+
+            // too few bases is rejected
+            bases.mutable_bases()->resize(1);
+            ASSERT_FALSE(sift::Verifier::CompareBases(bases, PackedQubits(emissions), answers));
+        }
+
     } // namespace tests
 } // namespace cqp
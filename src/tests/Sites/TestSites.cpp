@@ -48,7 +48,9 @@ namespace cqp
 
         struct SiteTestCollection
         {
-            SiteTestCollection(remote::Side::Type side, const std::string& siteAgentAddress)
+            SiteTestCollection(remote::Side::Type side, const std::string& siteAgentAddress,
+                               const std::string& simulatedChannel = "",
+                               const sim::ChannelParameters& channelParameters = {})
             {
 
                 using namespace std;
@@ -56,7 +58,8 @@ namespace cqp
                 LOGTRACE("Creating Device");
                 remote::DeviceConfig config;
                 config.set_side(side);
-                device = make_shared<DummyQKD>(config, grpc::InsecureChannelCredentials());
+                device = make_shared<DummyQKD>(config, grpc::InsecureChannelCredentials(), "", 1,
+                                               simulatedChannel, channelParameters);
                 LOGTRACE("Creating adaptor");
                 adaptor = make_shared<RemoteQKDDevice>(device, serverCreds);
                 if(adaptor->StartControlServer("localhost:0", siteAgentAddress))
@@ -164,6 +167,76 @@ namespace cqp
             site2bob.adaptor.reset();
         }
 
+        /**
+         * @test
+         * @brief Generate key with photons sent through a lossy simulated channel
+         */
+        TEST(SiteTest, SimulatedChannel)
+        {
+            using namespace std;
+
+            sim::ChannelParameters channelParameters;
+            channelParameters.lossDb = 13.0;
+            channelParameters.darkCountRate = 5000.0;
+            channelParameters.jitter = PicoSeconds(100);
+            channelParameters.offset = PicoSecondOffset(-12345);
+
+            SiteAgentBuilder site1("Site1", 8001);
+            SiteTestCollection site1alice(remote::Side::Alice, site1.agent->GetConnectionAddress(),
+                                          "SiteTestSimulatedChannel", channelParameters);
+            ASSERT_TRUE(site1alice.result.ok());
+
+            SiteAgentBuilder site2("Site2", 8002);
+            SiteTestCollection site2bob(remote::Side::Bob, site2.agent->GetConnectionAddress(),
+                                        "SiteTestSimulatedChannel", channelParameters);
+            ASSERT_TRUE(site2bob.result.ok());
+
+            // setup complete
+
+            auto channel = grpc::CreateChannel(site2.agent->GetConnectionAddress(), grpc::InsecureChannelCredentials());
+            auto site2Stub = remote::ISiteAgent::NewStub(channel);
+
+            remote::PhysicalPath request;
+
+            auto hop = request.add_hops();
+            hop->mutable_first()->set_site(site2.agent->GetConnectionAddress());
+            hop->mutable_first()->set_deviceid(site2bob.device->GetDeviceDetails().id());
+            hop->mutable_second()->set_site(site1.agent->GetConnectionAddress());
+            hop->mutable_second()->set_deviceid(site1alice.device->GetDeviceDetails().id());
+
+            {
+                grpc::ClientContext ctx;
+                google::protobuf::Empty response;
+
+                ASSERT_TRUE(LogStatus(site2Stub->StartNode(&ctx, request, &response)).ok());
+            }
+
+            auto ks1 = site1.agent->GetKeyStoreFactory()->GetKeyStore(site2.agent->GetConnectionAddress());
+            ASSERT_NE(ks1, nullptr);
+            KeyID key1Id;
+            PSK key1Value;
+            ASSERT_TRUE(ks1->GetNewKey(key1Id, key1Value, true));
+            ASSERT_GT(key1Value.size(), 0);
+
+            auto ks2 = site2.agent->GetKeyStoreFactory()->GetKeyStore(site1.agent->GetConnectionAddress());
+            ASSERT_NE(ks2, nullptr);
+            PSK key2Value;
+            ASSERT_TRUE(ks2->GetExistingKey(key1Id, key2Value).ok());
+
+            ASSERT_EQ(key1Value, key2Value);
+
+            {
+                grpc::ClientContext ctx;
+                google::protobuf::Empty response;
+                // bring the system down
+                ASSERT_TRUE(LogStatus(site2Stub->EndKeyExchange(&ctx, request, &response)).ok());
+            }
+
+            // this should cause the device to be unregistered
+            site1alice.adaptor.reset();
+            site2bob.adaptor.reset();
+        }
+
         /**
          * @test
          * @brief TEST
@@ -0,0 +1,142 @@
+/*!
+* @file
+* @brief TestLockFreeQueue
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "gtest/gtest.h"
+#include "Algorithms/Datatypes/LockFreeQueue.h"
+#include <thread>
+#include <vector>
+
+namespace cqp
+{
+    namespace tests
+    {
+        /**
+         * @test
+         * @brief TEST
+         */
+        TEST(LockFreeQueue, SpscOrder)
+        {
+            using namespace std::chrono;
+            const size_t count = 100000;
+            // small enough that the producer has to wait
+            SpscQueue<std::unique_ptr<size_t>> queue(16);
+            ASSERT_EQ(queue.capacity(), 16u);
+
+            std::thread producer([&]()
+            {
+                for(size_t index = 0; index < count; index++)
+                {
+                    ASSERT_TRUE(queue.Push(std::make_unique<size_t>(index), seconds(5)));
+                }
+            });
+
+            std::unique_ptr<size_t> value;
+            for(size_t index = 0; index < count; index++)
+            {
+                ASSERT_TRUE(queue.Pop(value, seconds(5)));
+                ASSERT_EQ(*value, index);
+            }
+            producer.join();
+
+            ASSERT_TRUE(queue.empty());
+            ASSERT_FALSE(queue.TryPop(value));
+            ASSERT_FALSE(queue.Pop(value, milliseconds(1)));
+        }
+
+        /**
+         * @test
+         * @brief TEST
+         */
+        TEST(LockFreeQueue, Batches)
+        {
+            SpscQueue<int> spsc(8);
+            MpmcQueue<int> mpmc(8);
+            std::vector<int> input {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+
+            // only the first 8 fit
+            ASSERT_EQ(spsc.PushBatch(input.begin(), input.size()), 8u);
+            ASSERT_EQ(mpmc.PushBatch(input.begin(), input.size()), 8u);
+            ASSERT_EQ(spsc.size(), 8u);
+            ASSERT_EQ(mpmc.size(), 8u);
+            int rejected = 42;
+            ASSERT_FALSE(spsc.TryPush(std::move(rejected)));
+            ASSERT_FALSE(mpmc.TryPush(std::move(rejected)));
+
+            std::vector<int> output;
+            ASSERT_EQ(spsc.PopBatch(std::back_inserter(output), 5), 5u);
+            ASSERT_EQ(spsc.PopBatch(std::back_inserter(output), 5), 3u);
+            ASSERT_EQ(output, std::vector<int>(input.begin(), input.begin() + 8));
+
+            output.clear();
+            ASSERT_EQ(mpmc.PopBatch(std::back_inserter(output), 100), 8u);
+            ASSERT_EQ(output, std::vector<int>(input.begin(), input.begin() + 8));
+            ASSERT_TRUE(mpmc.empty());
+        }
+
+        /**
+         * @test
+         * @brief TEST
+         */
+        TEST(LockFreeQueue, MpmcThreads)
+        {
+            using namespace std::chrono;
+            const size_t numThreads = 4;
+            const size_t perThread = 50000;
+            MpmcQueue<std::unique_ptr<size_t>> queue(64);
+            std::vector<std::thread> threads;
+            std::vector<size_t> seen(numThreads * perThread, 0);
+            std::vector<std::vector<size_t>> received(numThreads);
+
+            for(size_t thread = 0; thread < numThreads; thread++)
+            {
+                threads.emplace_back([&, thread]()
+                {
+                    for(size_t index = 0; index < perThread; index++)
+                    {
+                        ASSERT_TRUE(queue.Push(std::make_unique<size_t>(thread * perThread + index), seconds(5)));
+                    }
+                });
+                threads.emplace_back([&, thread]()
+                {
+                    std::unique_ptr<size_t> value;
+                    for(size_t index = 0; index < perThread; index++)
+                    {
+                        ASSERT_TRUE(queue.Pop(value, seconds(5)));
+                        received[thread].push_back(*value);
+                    }
+                });
+            }
+
+            for(auto& thread : threads)
+            {
+                thread.join();
+            }
+
+            // every value comes out exactly once and each producers values stay in order
+            for(const auto& values : received)
+            {
+                std::vector<size_t> last(numThreads, 0);
+                for(const auto value : values)
+                {
+                    seen[value]++;
+                    const size_t producer = value / perThread;
+                    ASSERT_GE(value + 1, last[producer]);
+                    last[producer] = value + 1;
+                }
+            }
+            for(const auto count : seen)
+            {
+                ASSERT_EQ(count, 1u);
+            }
+            ASSERT_TRUE(queue.empty());
+        }
+    } // namespace tests
+} // namespace cqp
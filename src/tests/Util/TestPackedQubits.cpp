@@ -0,0 +1,134 @@
+/*!
+* @file
+* @brief TestPackedQubits
+*
+* @copyright Copyright (C) University of Bristol 2026
+*    This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0.
+*    If a copy of the MPL was not distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*    See LICENSE file for details.
+* @date 16/10/2026
+* @author Richard Collins <richard.collins@bristol.ac.uk>
+*/
+#include "gtest/gtest.h"
+#include "Algorithms/Datatypes/PackedQubits.h"
+#include <random>
+
+namespace cqp
+{
+    namespace tests
+    {
+        /**
+         * @brief RandomQubits
+         * @param count number of qubits
+         * @param rng source of randomness
+         * @return random BB84 qubits, including circular and invalid
+         */
+        static QubitList RandomQubits(size_t count, std::mt19937& rng)
+        {
+            QubitList result(count);
+            for(auto& qubit : result)
+            {
+                qubit = static_cast<Qubit>(rng() % (static_cast<unsigned>(BB84::_Last) + 1));
+            }
+            return result;
+        }
+
+        /**
+         * @test
+         * @brief TEST
+         */
+        TEST(PackedQubitsTest, Planes)
+        {
+            std::mt19937 rng(1234);
+            // lengths either side of the word and vector sizes
+            for(const size_t count : {0u, 1u, 7u, 8u, 17u, 31u, 32u, 33u, 63u, 64u, 65u, 1000u})
+            {
+                const QubitList qubits = RandomQubits(count, rng);
+                const PackedQubits packed(qubits);
+                ASSERT_EQ(packed.size(), count);
+                ASSERT_EQ(packed.ToQubitList(), qubits);
+
+                const PackedBits diagonal = packed.BasisMask(Basis::Diagonal);
+                for(size_t index = 0; index < count; index++)
+                {
+                    ASSERT_EQ(GetBit(packed.Values(), index), QubitHelper::BitValue(qubits[index]));
+                    ASSERT_EQ(GetBit(diagonal, index), QubitHelper::Base(qubits[index]) == Basis::Diagonal);
+                    ASSERT_EQ(packed.BasisAt(index), QubitHelper::Base(qubits[index]));
+                }
+
+                // the unused bits are clear
+                if(count % bitsPerWord != 0)
+                {
+                    ASSERT_EQ(diagonal.back() >> (count % bitsPerWord), 0u);
+                }
+            }
+        }
+
+        /**
+         * @test
+         * @brief TEST
+         */
+        TEST(PackedQubitsTest, Append)
+        {
+            std::mt19937 rng(1234);
+            const QubitList qubits = RandomQubits(500, rng);
+            PackedQubits packed;
+            size_t added = 0;
+            while(added < qubits.size())
+            {
+                // uneven pieces so that appends start part way through a word
+                const size_t count = std::min<size_t>(qubits.size() - added, 1 + rng() % 70);
+                packed.Append(&qubits[added], count);
+                added += count;
+            }
+            ASSERT_EQ(packed.ToQubitList(), qubits);
+
+            packed.Set(10, static_cast<Qubit>(BB84::Left));
+            ASSERT_EQ(packed[10], static_cast<Qubit>(BB84::Left));
+            packed.resize(100);
+            packed.resize(200);
+            ASSERT_EQ(packed[150], static_cast<Qubit>(BB84::Zero));
+        }
+
+        /**
+         * @test
+         * @brief TEST
+         */
+        TEST(PackedQubitsTest, Matches)
+        {
+            std::mt19937 rng(1234);
+            for(const size_t count : {5u, 64u, 99u, 1000u})
+            {
+                const QubitList left = RandomQubits(count, rng);
+                const QubitList right = RandomQubits(count, rng);
+                size_t basesExpected = 0;
+                size_t valuesExpected = 0;
+                for(size_t index = 0; index < count; index++)
+                {
+                    if(QubitHelper::Base(left[index]) == QubitHelper::Base(right[index]))
+                    {
+                        basesExpected++;
+                        if(left[index] == right[index])
+                        {
+                            valuesExpected++;
+                        }
+                    }
+                }
+
+                size_t basesMatched = 0;
+                size_t valuesMatched = 0;
+                PackedQubits::CountMatches(left.data(), right.data(), count, basesMatched, valuesMatched);
+                ASSERT_EQ(basesMatched, basesExpected);
+                ASSERT_EQ(valuesMatched, valuesExpected);
+
+                const PackedBits matches = PackedQubits(left).BasisMatches(PackedQubits(right));
+                size_t matchCount = 0;
+                for(const auto word : matches)
+                {
+                    matchCount += PopCount(word);
+                }
+                ASSERT_EQ(matchCount, basesExpected);
+            }
+        }
+    } // namespace tests
+} // namespace cqp
@@ -23,6 +23,10 @@
 #include "Algorithms/Util/FileIO.h"
 #include "Algorithms/Util/Hash.h"
 #include "Algorithms/Util/Env.h"
+#include "Algorithms/Util/DataFile.h"
+#include "Algorithms/Util/DataStream.h"
+#include "Algorithms/Util/DetectionArchive.h"
+#include <random>
 #include "testResource.rc.h"
 
 namespace cqp
@@ -285,6 +289,362 @@ namespace cqp
             ASSERT_NE(FNV1aHash("HelloHashy"), FNV1aHash("HelloHashx"));
         }
 
+        TEST(UtilsTest, XorKeys)
+        {
+            // cover the vector, word and byte loops and unaligned starts
+            for(size_t length : {0u, 1u, 7u, 8u, 15u, 16u, 31u, 32u, 33u, 100u, 1027u})
+            {
+                for(size_t offset = 0; offset < 3; offset++)
+                {
+                    PSK left;
+                    DataBlock right;
+                    for(size_t index = 0; index < length + offset; index++)
+                    {
+                        left.push_back(static_cast<uint8_t>(index * 7 + 3));
+                        right.push_back(static_cast<uint8_t>(index * 13 + length));
+                    }
+
+                    DataBlock expected(left.begin() + offset, left.end());
+                    for(size_t index = 0; index < length; index++)
+                    {
+                        expected[index] ^= right[index + offset];
+                    }
+
+                    XorBytes(left.data() + offset, right.data() + offset, length);
+                    ASSERT_EQ(DataBlock(left.begin() + offset, left.end()), expected);
+                }
+            }
+
+            // the shorter length is used
+            PSK key {1, 2, 3, 4};
+            key ^= std::string("\x01\x01");
+            ASSERT_EQ(key, PSK({0, 3, 3, 4}));
+        }
+
+        TEST(UtilsTest, NoxDecode)
+        {
+            using NoxReport = fs::DataFile::NoxReport;
+            std::mt19937_64 rng(1234);
+            const std::vector<Qubit> mappings {3, 2, 1, 0};
+
+            // cover the vector blocks and the tail
+            for(size_t count : {0u, 1u, 3u, 4u, 5u, 8u, 63u, 1000u})
+            {
+                DataBlock raw(count * NoxReport::messageBytes);
+                for(size_t offset = 0; offset < raw.size(); offset += NoxReport::messageBytes)
+                {
+                    uint64_t word = rng();
+                    for(size_t index = 0; index < NoxReport::messageBytes; index++)
+                    {
+                        raw[offset + index] = static_cast<uint8_t>(word >> (8 * index));
+                    }
+                    // mostly detections, some config and some rubbish
+                    const auto type = word % 8;
+                    if(type < 6)
+                    {
+                        raw[offset] = static_cast<uint8_t>(NoxReport::MessageType::Detection);
+                    }
+                    else if(type == 6)
+                    {
+                        raw[offset] = static_cast<uint8_t>(NoxReport::MessageType::Config);
+                    }
+                }
+
+                // decode one at a time
+                DetectionReportList expected {{PicoSeconds(1), 1}};
+                size_t expectedDropped = 0;
+                for(size_t offset = 0; offset < raw.size(); offset += NoxReport::messageBytes)
+                {
+                    NoxReport report;
+                    const bool loaded = report.LoadRaw(&raw[offset]);
+                    if(loaded && report.messageType == NoxReport::MessageType::Detection && report.detection.channel < mappings.size())
+                    {
+                        expected.push_back({report.GetTime(), mappings[report.detection.channel]});
+                    }
+                    else if(!loaded || report.messageType != NoxReport::MessageType::Config)
+                    {
+                        expectedDropped++;
+                    }
+                }
+
+                // existing detections are kept
+                DetectionReportList output {{PicoSeconds(1), 1}};
+                ASSERT_EQ(fs::DataFile::DecodeNoxDetections(mappings, raw.data(), raw.size(), output), expectedDropped);
+                ASSERT_EQ(output, expected);
+            }
+        }
+
+        TEST(UtilsTest, DataFiles)
+        {
+            using NoxReport = fs::DataFile::NoxReport;
+            std::mt19937_64 rng(4321);
+            const auto fileName = fs::MakeTemp();
+
+            // detection report lists
+            DetectionReportList detections(1001);
+            for(auto& detection : detections)
+            {
+                detection.time = PicoSeconds(rng());
+                detection.value = static_cast<Qubit>(rng() % 4);
+            }
+            ASSERT_TRUE(fs::DataFile::WriteDetectionReportList(detections, fileName));
+            DetectionReportList readDetections;
+            ASSERT_TRUE(fs::DataFile::ReadDetectionReportList(fileName, readDetections));
+            ASSERT_EQ(readDetections, detections);
+
+            {
+                fs::DetectionStream stream(fileName, fs::DetectionStream::Format::DetectionReportList);
+                ASSERT_TRUE(stream.IsOpen());
+                DetectionReportList block;
+                ASSERT_TRUE(stream.Next(block, 100));
+                ASSERT_EQ(block.size(), 100u);
+                DetectionReportList streamed(block.begin(), block.end());
+                for(const auto& detection : stream)
+                {
+                    streamed.push_back(detection);
+                }
+                ASSERT_EQ(streamed, detections);
+            }
+
+            // NOX captures, with some detections before the first config message
+            DataBlock raw(2000 * NoxReport::messageBytes);
+            for(size_t offset = 0; offset < raw.size(); offset += NoxReport::messageBytes)
+            {
+                const uint64_t word = rng();
+                for(size_t index = 0; index < NoxReport::messageBytes; index++)
+                {
+                    raw[offset + index] = static_cast<uint8_t>(word >> (8 * index));
+                }
+                raw[offset] = static_cast<uint8_t>(NoxReport::MessageType::Detection);
+                // channels 1 to 4
+                raw[offset + 6] = static_cast<uint8_t>(((word % 4 + 1) << 4) | (raw[offset + 6] & 0x0F));
+            }
+            raw[10 * NoxReport::messageBytes] = static_cast<uint8_t>(NoxReport::MessageType::Config);
+            ASSERT_TRUE(fs::WriteEntireFile(fileName, std::string(raw.begin(), raw.end())));
+
+            DetectionReportList expected;
+            fs::DataFile::DecodeNoxDetections(fs::DataFile::DefaultCahnnelMappings, &raw[11 * NoxReport::messageBytes],
+                                              raw.size() - 11 * NoxReport::messageBytes, expected);
+            readDetections.clear();
+            ASSERT_TRUE(fs::DataFile::ReadNOXDetections(fileName, readDetections));
+            ASSERT_EQ(readDetections, expected);
+
+            {
+                fs::DetectionStream stream(fileName, fs::DetectionStream::Format::Nox);
+                const DetectionReportList streamed(stream.begin(), stream.end());
+                ASSERT_EQ(streamed, expected);
+            }
+
+            // stop at the coarse time of a detection half way through
+            NoxReport limit;
+            ASSERT_TRUE(limit.LoadRaw(&raw[1000 * NoxReport::messageBytes]));
+            readDetections.clear();
+            ASSERT_TRUE(fs::DataFile::ReadNOXDetections(fileName, readDetections, fs::DataFile::DefaultCahnnelMappings, true, limit.detection.coarse));
+            size_t expectedCount = 0;
+            for(size_t offset = 11 * NoxReport::messageBytes; offset < raw.size(); offset += NoxReport::messageBytes)
+            {
+                NoxReport report;
+                report.LoadRaw(&raw[offset]);
+                if(report.detection.coarse >= limit.detection.coarse)
+                {
+                    break; // for
+                }
+                expectedCount++;
+            }
+            ASSERT_EQ(readDetections, DetectionReportList(expected.begin(), expected.begin() + static_cast<ptrdiff_t>(expectedCount)));
+
+            // packed qubits, read with the first qubit in the top bits
+            ASSERT_TRUE(fs::WriteEntireFile(fileName, std::string(raw.begin(), raw.begin() + 101)));
+            QubitList qubits;
+            ASSERT_TRUE(fs::DataFile::ReadPackedQubits(fileName, qubits));
+            ASSERT_EQ(qubits.size(), 404u);
+            for(size_t index = 0; index < qubits.size(); index++)
+            {
+                ASSERT_EQ(qubits[index], (raw[index / 4] >> (6 - 2 * (index % 4))) & 0b11);
+            }
+
+            QubitList someQubits;
+            ASSERT_TRUE(fs::DataFile::ReadPackedQubits(fileName, someQubits, 103));
+            ASSERT_EQ(someQubits, QubitList(qubits.begin(), qubits.begin() + 103));
+
+            {
+                fs::QubitStream stream(fileName);
+                const QubitList streamed(stream.begin(), stream.end());
+                ASSERT_EQ(streamed, qubits);
+            }
+
+            ASSERT_TRUE(fs::Delete(fileName));
+        }
+
+        TEST(UtilsTest, DataFileChunks)
+        {
+            using NoxReport = fs::DataFile::NoxReport;
+            std::mt19937_64 rng(2468);
+            const auto fileName = fs::MakeTemp();
+            // force small files to be split between several threads
+            const auto oldMinBytes = fs::DataFile::minBytesPerThread;
+            const auto oldMaxThreads = fs::DataFile::maxThreads;
+            fs::DataFile::minBytesPerThread = 1;
+            fs::DataFile::maxThreads = 4;
+
+            // empty files
+            ASSERT_TRUE(fs::DataFile::WriteDetectionReportList({}, fileName));
+            DetectionReportList readDetections {{PicoSeconds(1), 1}};
+            ASSERT_TRUE(fs::DataFile::ReadDetectionReportList(fileName, readDetections));
+            ASSERT_EQ(readDetections, DetectionReportList({{PicoSeconds(1), 1}}));
+            QubitList qubits {2};
+            ASSERT_TRUE(fs::DataFile::ReadPackedQubits(fileName, qubits));
+            ASSERT_EQ(qubits, QubitList({2}));
+
+            // detection report lists are joined onto the existing values
+            DetectionReportList detections(1001);
+            for(auto& detection : detections)
+            {
+                detection.time = PicoSeconds(rng());
+                detection.value = static_cast<Qubit>(rng() % 4);
+            }
+            ASSERT_TRUE(fs::DataFile::WriteDetectionReportList(detections, fileName));
+            ASSERT_TRUE(fs::DataFile::ReadDetectionReportList(fileName, readDetections));
+            ASSERT_EQ(readDetections.size(), detections.size() + 1);
+            ASSERT_EQ(DetectionReportList(readDetections.begin() + 1, readDetections.end()), detections);
+
+            // packed qubits, including a partial byte at the end
+            DataBlock packed(1001);
+            for(auto& byte : packed)
+            {
+                byte = static_cast<uint8_t>(rng());
+            }
+            ASSERT_TRUE(fs::WriteEntireFile(fileName, std::string(packed.begin(), packed.end())));
+            qubits.clear();
+            ASSERT_TRUE(fs::DataFile::ReadPackedQubits(fileName, qubits, 4003));
+            ASSERT_EQ(qubits.size(), 4003u);
+            for(size_t index = 0; index < qubits.size(); index++)
+            {
+                ASSERT_EQ(qubits[index], (packed[index / 4] >> (6 - 2 * (index % 4))) & 0b11);
+            }
+
+            // NOX captures with rising times which wrap in the last of four chunks
+            DataBlock raw(2000 * NoxReport::messageBytes);
+            for(size_t record = 0; record < 2000; record++)
+            {
+                const uint64_t coarse = record < 1500 ? record + 100 : record - 1400;
+                // type, 36 bits of coarse time, 4 blank bits, channel 1 to 4, 12 bits of fine time
+                const uint64_t word = (static_cast<uint64_t>(NoxReport::MessageType::Detection) << 56) |
+                                      (coarse << 20) |
+                                      ((rng() % 4 + 1) << 12) | (rng() & 0xFFF);
+                for(size_t index = 0; index < NoxReport::messageBytes; index++)
+                {
+                    raw[record * NoxReport::messageBytes + index] = static_cast<uint8_t>(word >> (8 * (7 - index)));
+                }
+            }
+            raw[0] = static_cast<uint8_t>(NoxReport::MessageType::Config);
+            ASSERT_TRUE(fs::WriteEntireFile(fileName, std::string(raw.begin(), raw.end())));
+
+            DetectionReportList expected;
+            fs::DataFile::DecodeNoxDetections(fs::DataFile::DefaultCahnnelMappings, &raw[NoxReport::messageBytes],
+                                              raw.size() - NoxReport::messageBytes, expected);
+            ASSERT_EQ(expected.size(), 1999u);
+            readDetections.clear();
+            ASSERT_TRUE(fs::DataFile::ReadNOXDetections(fileName, readDetections));
+            ASSERT_EQ(readDetections, expected);
+
+            // stop in the third chunk, the wrapped times after it must not be read
+            NoxReport limit;
+            ASSERT_TRUE(limit.LoadRaw(&raw[1300 * NoxReport::messageBytes]));
+            ASSERT_EQ(limit.detection.coarse, 1400u);
+            readDetections.clear();
+            ASSERT_TRUE(fs::DataFile::ReadNOXDetections(fileName, readDetections, fs::DataFile::DefaultCahnnelMappings, true, limit.detection.coarse));
+            ASSERT_EQ(readDetections, DetectionReportList(expected.begin(), expected.begin() + 1299));
+
+            fs::DataFile::minBytesPerThread = oldMinBytes;
+            fs::DataFile::maxThreads = oldMaxThreads;
+            ASSERT_TRUE(fs::Delete(fileName));
+        }
+
+        TEST(UtilsTest, DetectionArchive)
+        {
+            std::mt19937_64 rng(5678);
+            const auto fileName = fs::MakeTemp();
+
+            // frames which fill several blocks, an empty frame and times which go backwards
+            std::vector<ProtocolDetectionReport> reports(4);
+            for(size_t frame = 0; frame < reports.size(); frame++)
+            {
+                auto& report = reports[frame];
+                report.frame = frame + 1;
+                report.epoc = std::chrono::high_resolution_clock::time_point(std::chrono::seconds(frame * 10));
+                const size_t count = (frame == 2) ? 0 : 1000 + frame * 300;
+                uint64_t time = rng() >> 8;
+                for(size_t index = 0; index < count; index++)
+                {
+                    time += rng() % 100000;
+                    if(index % 97 == 0)
+                    {
+                        time -= 50000;
+                    }
+                    report.detections.push_back({PicoSeconds(time), static_cast<Qubit>(rng() % 4)});
+                }
+            }
+            reports[3].detections.push_back({PicoSeconds(~0ull), 3});
+            reports[3].detections.push_back({PicoSeconds(0), 0});
+
+            {
+                fs::DetectionArchiveWriter writer(500);
+                ASSERT_TRUE(writer.Open(fileName));
+                for(const auto& report : reports)
+                {
+                    ASSERT_TRUE(writer.Write(report));
+                }
+
+                ProtocolDetectionReport invalid;
+                invalid.detections.push_back({PicoSeconds(1), 4});
+                ASSERT_FALSE(writer.Write(invalid));
+                ASSERT_TRUE(writer.Close());
+            }
+
+            // the blocks are much smaller than the 9 bytes per detection of WriteDetectionReportList
+            size_t numDetections = 0;
+            for(const auto& report : reports)
+            {
+                numDetections += report.detections.size();
+            }
+            std::string contents;
+            ASSERT_TRUE(fs::ReadEntireFile(fileName, contents));
+            ASSERT_LT(contents.size(), numDetections * 5);
+
+            auto checkArchive = [&]()
+            {
+                fs::DetectionArchiveReader reader;
+                ASSERT_TRUE(reader.Open(fileName));
+                ASSERT_EQ(reader.GetIndex().size(), 2u + 3u + 1u + 4u);
+
+                size_t nextBlock = 0;
+                for(const auto& expected : reports)
+                {
+                    ProtocolDetectionReport report;
+                    ASSERT_TRUE(reader.ReadReport(nextBlock, report));
+                    ASSERT_EQ(report.frame, expected.frame);
+                    ASSERT_EQ(report.epoc, expected.epoc);
+                    ASSERT_EQ(report.detections, expected.detections);
+                }
+                ProtocolDetectionReport report;
+                ASSERT_FALSE(reader.ReadReport(nextBlock, report));
+
+                // blocks can be read on their own
+                DetectionReportList block;
+                ASSERT_TRUE(reader.ReadBlock(4, block));
+                ASSERT_EQ(block, DetectionReportList(reports[1].detections.begin() + 1000, reports[1].detections.end()));
+            };
+            checkArchive();
+
+            // remove the index, as if the writer had not been closed
+            const size_t indexBytes = 10 * fs::archive::indexEntryBytes + fs::archive::footerBytes;
+            ASSERT_TRUE(fs::WriteEntireFile(fileName, contents.substr(0, contents.size() - indexBytes)));
+            checkArchive();
+
+            ASSERT_TRUE(fs::Delete(fileName));
+        }
+
         TEST(UtilsTest, Environment)
         {
             ASSERT_NE(cqp::ApplicationName(), "");